@@ -39,3 +39,18 @@ macro(check_yasm_support _object_format _good_result _better_result)
     message(STATUS "Found Yasm: better -- capable of assembling AVX2")
   endif()
 endmacro()
+
+# yasm does not know AVX-512, the isa-l kernels for it are assembled by nasm
+macro(check_nasm_avx512_support _object_format _result)
+  execute_process(COMMAND nasm -f ${_object_format} -DHAVE_AS_KNOWS_AVX512
+    -i ${CMAKE_SOURCE_DIR}/src/isa-l/include/
+    ${CMAKE_SOURCE_DIR}/src/isa-l/erasure_code/gf_vect_dot_prod_avx512.asm
+    -o /dev/null
+    RESULT_VARIABLE rc
+    OUTPUT_QUIET
+    ERROR_QUIET)
+  if(NOT rc)
+    set(${_result} TRUE)
+    message(STATUS "Found Nasm: capable of assembling AVX-512")
+  endif()
+endmacro()
@@ -143,6 +143,20 @@ function bench_run() {
             done
         done
     done
+    for technique in ${TECHNIQUES} ; do
+        for plugin in ${PLUGINS} ; do
+            eval technique_parameter=\$${plugin}2technique_${technique}
+            echo "serie delta_${technique}_${plugin}"
+            for k in $ks ; do
+                for m in ${k2ms[$k]} ; do
+                    bench $plugin $k $m delta $(($TOTAL_SIZE / $SIZE)) $SIZE 0 \
+                        --parameter packetsize=$(packetsize $k $w $VECTOR_WORDSIZE $SIZE) \
+                        ${PARAMETERS} \
+                        --parameter technique=$technique_parameter
+                done
+            done
+        done
+    done
 }
 
 function fplot() {
@@ -158,7 +172,7 @@ function fplot() {
             echo "var $serie = ["
         else
             local x
-            if [ $workload = encode ] ; then
+            if [ $workload != decode ] ; then
                 x=$k/$m
             else
                 x=$k/$m/$erasures
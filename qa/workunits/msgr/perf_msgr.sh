@@ -0,0 +1,86 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+# Run ceph_perf_msgr_client against ceph_perf_msgr_server over a sweep of
+# message sizes, queue depths, connection modes, stacks and worker counts,
+# one tab separated line per run.  From sources:
+#
+#  CEPH_PERF_MSGR_CLIENT=build/bin/ceph_perf_msgr_client \
+#  CEPH_PERF_MSGR_SERVER=build/bin/ceph_perf_msgr_server \
+#      qa/workunits/msgr/perf_msgr.sh
+#
+# The server is started locally unless SERVER_ADDR is set, in which case
+# ceph_perf_msgr_server must already be running there with the same
+# --ms_type, --ms_async_op_threads and --ms_service_mode=crc,secure.
+#
+set -e
+
+: ${CEPH_PERF_MSGR_CLIENT:=ceph_perf_msgr_client}
+: ${CEPH_PERF_MSGR_SERVER:=ceph_perf_msgr_server}
+: ${SERVER_ADDR:=}
+: ${STACKS:=async+posix}
+: ${MODES:=crc secure}
+: ${THREADS:=1 3 8}
+: ${SIZES:=4096 65536 4194304}
+: ${DEPTHS:=1 16 128}
+: ${JOBS:=1}
+: ${OPS:=10000}
+
+function run_one() {
+    local addr=$1 stack=$2 mode=$3 threads=$4 size=$5 depth=$6
+    local ops=$OPS
+    if [ $size -ge 1048576 ] ; then
+        ops=$((ops / 10))
+    fi
+    $CEPH_PERF_MSGR_CLIENT --ms_type $stack --ms_async_op_threads $threads \
+        --ms_client_mode $mode $addr $JOBS $depth $ops 0 $size |
+        awk -v stack=$stack -v mode=$mode -v threads=$threads \
+            -v size=$size -v depth=$depth '
+            /Throughput/ { ops = $2; mb = $4 }
+            /Latency/ { p50 = $3; p99 = $5; p999 = $7 }
+            /CPU/ { cpu = $4 }
+            END { print stack "\t" mode "\t" threads "\t" size "\t" depth "\t" \
+                  ops "\t" mb "\t" p50 "\t" p99 "\t" p999 "\t" cpu }'
+}
+
+function main() {
+    echo -e "stack\tmode\tthreads\tsize\tdepth\top/s\tMB/s\tp50us\tp99us\tp999us\tcpuus/op"
+    local port=7070
+    for stack in $STACKS ; do
+        for threads in $THREADS ; do
+            local addr=$SERVER_ADDR
+            local pid=
+            if [ -z "$addr" ] ; then
+                addr=127.0.0.1:$port
+                port=$((port + 1))
+                $CEPH_PERF_MSGR_SERVER --ms_type $stack \
+                    --ms_async_op_threads $threads \
+                    --ms_service_mode crc,secure $addr 1 0 2>/dev/null &
+                pid=$!
+                sleep 1
+            fi
+            for mode in $MODES ; do
+                for size in $SIZES ; do
+                    for depth in $DEPTHS ; do
+                        run_one $addr $stack $mode $threads $size $depth
+                    done
+                done
+            done
+            if [ -n "$pid" ] ; then
+                kill $pid
+                wait $pid || true
+            fi
+        done
+    done
+}
+
+main "$@"
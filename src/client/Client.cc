@@ -1573,11 +1573,13 @@ int Client::verify_reply_trace(int r, MetaSession *session,
      created_ino = ocres.created_ino;
      /*
       * The userland cephfs client doesn't have a way to do an async create
-      * (yet), so just discard delegated_inos for now. Eventually we should
-      * store them and use them in create calls, even if they are synchronous,
-      * if only for testing purposes.
+      * (yet), but it uses the delegated_inos in its synchronous creates,
+      * so the mds does not have to pick the ino of each new inode.
       */
      ldout(cct, 10) << "delegated_inos: " << ocres.delegated_inos << dendl;
+     session->delegated_inos.union_of(ocres.delegated_inos);
+     if (session->delegated_inos.contains(created_ino))
+       session->delegated_inos.erase(created_ino);
     } else {
      // u64 containing number of created ino
      decode(created_ino, extra_bl);
@@ -2209,6 +2211,17 @@ void Client::send_request(MetaRequest *request, MetaSession *session,
     if (request->target)
       r->head.ino = request->target->ino;
   } else {
+    switch (r->head.op) {
+    case CEPH_MDS_OP_CREATE:
+    case CEPH_MDS_OP_MKNOD:
+    case CEPH_MDS_OP_MKDIR:
+    case CEPH_MDS_OP_SYMLINK:
+      // the delegated inos are only valid on the session they came from,
+      // a request resent elsewhere takes one of the new target
+      if (!r->head.ino && session->state == MetaSession::STATE_OPEN)
+	r->head.ino = session->take_delegated_ino();
+      break;
+    }
     encode_cap_releases(request, mds);
     if (drop_cap_releases) // we haven't send cap reconnect yet, drop cap releases
       request->cap_releases.clear();
@@ -2776,6 +2789,9 @@ void Client::send_reconnect(MetaSession *session)
 
   session->release.reset();
 
+  // the mds does not keep the delegations across a restart
+  session->delegated_inos.clear();
+
   // reset my cap seq number
   session->seq = 0;
   //connect to the mds' offload targets
@@ -9231,7 +9247,8 @@ retry:
 
   if (!conf->client_debug_force_sync_read &&
       conf->client_oc &&
-      (have & (CEPH_CAP_FILE_CACHE | CEPH_CAP_FILE_LAZYIO))) {
+      (have & (CEPH_CAP_FILE_CACHE | CEPH_CAP_FILE_LAZYIO)) &&
+      !_should_read_direct(in, offset, size)) {
 
     if (f->flags & O_RSYNC) {
       _flush_range(in, offset, size);
@@ -9340,14 +9357,9 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
   C_SaferCond onfinish("Client::_read_async flock");
   r = objectcacher->file_read(&in->oset, &in->layout, in->snapid,
 			      off, len, bl, 0, &onfinish);
-  if (r == 0) {
-    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
-    client_lock.unlock();
-    r = onfinish.wait();
-    client_lock.lock();
-    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
-  }
 
+  // start the readahead before waiting for the read, so that the objects
+  // of the window are read in parallel with the ones the caller wants
   if(f->readahead.get_min_readahead_size() > 0) {
     pair<uint64_t, uint64_t> readahead_extent = f->readahead.update(off, len, in->size);
     if (readahead_extent.second > 0) {
@@ -9367,9 +9379,33 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
     }
   }
 
+  if (r == 0) {
+    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
+    client_lock.unlock();
+    r = onfinish.wait();
+    client_lock.lock();
+    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
+  }
+
   return r;
 }
 
+/*
+ * Large reads aligned to the stripe unit go straight to the osds, as for
+ * O_DIRECT, instead of being copied through the ObjectCacher, unless the
+ * cache has dirty data of the file that the read would miss.
+ */
+bool Client::_should_read_direct(Inode *in, uint64_t off, uint64_t len)
+{
+  uint64_t min = cct->_conf.get_val<Option::size_t>("client_direct_read_min");
+  if (!min || len < min)
+    return false;
+  uint64_t su = in->layout.stripe_unit;
+  if (!su || off % su || len % su)
+    return false;
+  return in->oset.dirty_or_tx == 0;
+}
+
 int Client::_read_sync(Fh *f, uint64_t off, uint64_t len, bufferlist *bl,
 		       bool *checkeof)
 {
@@ -9451,6 +9487,11 @@ void Client::_sync_write_commit(Inode *in)
 
 int Client::write(int fd, const char *buf, loff_t size, loff_t offset) 
 {
+  /* We can't return bytes written larger than INT_MAX, clamp size to that */
+  size = std::min(size, (loff_t)INT_MAX);
+  // copy the data before taking the client_lock
+  bufferlist bl = copy_write_data(buf, size, NULL, 0);
+
   std::lock_guard lock(client_lock);
   tout(cct) << "write" << std::endl;
   tout(cct) << fd << std::endl;
@@ -9467,9 +9508,7 @@ int Client::write(int fd, const char *buf, loff_t size, loff_t offset)
   if (fh->flags & O_PATH)
     return -EBADF;
 #endif
-  /* We can't return bytes written larger than INT_MAX, clamp size to that */
-  size = std::min(size, (loff_t)INT_MAX);
-  int r = _write(fh, offset, size, buf, NULL, false);
+  int r = _write(fh, offset, size, std::move(bl));
   ldout(cct, 3) << "write(" << fd << ", \"...\", " << size << ", " << offset << ") = " << r << dendl;
   return r;
 }
@@ -9483,7 +9522,7 @@ int Client::pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset)
 
 int64_t Client::_preadv_pwritev_locked(Fh *fh, const struct iovec *iov,
 				   unsigned iovcnt, int64_t offset, bool write,
-				   bool clamp_to_int)
+				   bool clamp_to_int, bufferlist *data)
 {
 #if defined(__linux__) && defined(O_PATH)
     if (fh->flags & O_PATH)
@@ -9503,7 +9542,8 @@ int64_t Client::_preadv_pwritev_locked(Fh *fh, const struct iovec *iov,
       totallen = std::min(totallen, (loff_t)INT_MAX);
     }
     if (write) {
-        int64_t w = _write(fh, offset, totallen, NULL, iov, iovcnt);
+        int64_t w = data ? _write(fh, offset, totallen, std::move(*data)) :
+                           _write(fh, offset, totallen, NULL, iov, iovcnt);
         ldout(cct, 3) << "pwritev(" << fh << ", \"...\", " << totallen << ", " << offset << ") = " << w << dendl;
         return w;
     } else {
@@ -9530,6 +9570,11 @@ int64_t Client::_preadv_pwritev_locked(Fh *fh, const struct iovec *iov,
 
 int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write)
 {
+    // copy the data to write before taking the client_lock
+    bufferlist bl;
+    if (write)
+      bl = copy_write_data(NULL, 0, iov, iovcnt);
+
     std::lock_guard lock(client_lock);
     tout(cct) << fd << std::endl;
     tout(cct) << offset << std::endl;
@@ -9540,11 +9585,40 @@ int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, in
     Fh *fh = get_filehandle(fd);
     if (!fh)
         return -EBADF;
-    return _preadv_pwritev_locked(fh, iov, iovcnt, offset, write, true);
+    return _preadv_pwritev_locked(fh, iov, iovcnt, offset, write, true,
+                                  write ? &bl : nullptr);
+}
+
+/*
+ * Copy the data of a write into a fresh buffer (since our write may be
+ * resub, async). The callers without the client_lock do it before taking
+ * it, so that the copy of large writes does not serialize the I/O of the
+ * other files.
+ */
+bufferlist Client::copy_write_data(const char *buf, int64_t size,
+                                   const struct iovec *iov, int iovcnt)
+{
+  bufferlist bl;
+  if (buf) {
+    if (size > 0)
+      bl.append(buf, size);
+  } else if (iov){
+    for (int i = 0; i < iovcnt; i++) {
+      if (iov[i].iov_len > 0) {
+        bl.append((const char *)iov[i].iov_base, iov[i].iov_len);
+      }
+    }
+  }
+  return bl;
 }
 
 int64_t Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
 	                const struct iovec *iov, int iovcnt)
+{
+  return _write(f, offset, size, copy_write_data(buf, size, iov, iovcnt));
+}
+
+int64_t Client::_write(Fh *f, int64_t offset, uint64_t size, bufferlist&& bl)
 {
   uint64_t fpos = 0;
 
@@ -9604,19 +9678,6 @@ int64_t Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
     ceph_assert(in->inline_version > 0);
   }
 
-  // copy into fresh buffer (since our write may be resub, async)
-  bufferlist bl;
-  if (buf) {
-    if (size > 0)
-      bl.append(buf, size);
-  } else if (iov){
-    for (int i = 0; i < iovcnt; i++) {
-      if (iov[i].iov_len > 0) {
-        bl.append((const char *)iov[i].iov_base, iov[i].iov_len);
-      }
-    }
-  }
-
   utime_t lat;
   uint64_t totalwritten;
   int want, have;
@@ -13457,6 +13518,11 @@ int Client::ll_commit_blocks(Inode *in,
 
 int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
 {
+  /* We can't return bytes written larger than INT_MAX, clamp len to that */
+  len = std::min(len, (loff_t)INT_MAX);
+  // copy the data before taking the client_lock
+  bufferlist bl = copy_write_data(data, len, NULL, 0);
+
   std::lock_guard lock(client_lock);
   ldout(cct, 3) << "ll_write " << fh << " " << fh->inode->ino << " " << off <<
     "~" << len << dendl;
@@ -13468,9 +13534,7 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
   if (unmounting)
     return -ENOTCONN;
 
-  /* We can't return bytes written larger than INT_MAX, clamp len to that */
-  len = std::min(len, (loff_t)INT_MAX);
-  int r = _write(fh, off, len, data, NULL, 0);
+  int r = _write(fh, off, len, std::move(bl));
   ldout(cct, 3) << "ll_write " << fh << " " << off << "~" << len << " = " << r
 		<< dendl;
   return r;
@@ -13478,10 +13542,13 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
 
 int64_t Client::ll_writev(struct Fh *fh, const struct iovec *iov, int iovcnt, int64_t off)
 {
+  // copy the data before taking the client_lock
+  bufferlist bl = copy_write_data(NULL, 0, iov, iovcnt);
+
   std::lock_guard lock(client_lock);
   if (unmounting)
    return -ENOTCONN;
-  return _preadv_pwritev_locked(fh, iov, iovcnt, off, true, false);
+  return _preadv_pwritev_locked(fh, iov, iovcnt, off, true, false, &bl);
 }
 
 int64_t Client::ll_readv(struct Fh *fh, const struct iovec *iov, int iovcnt, int64_t off)
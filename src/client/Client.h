@@ -1056,6 +1056,7 @@ private:
 
   int _read_sync(Fh *f, uint64_t off, uint64_t len, bufferlist *bl, bool *checkeof);
   int _read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl);
+  bool _should_read_direct(Inode *in, uint64_t off, uint64_t len);
 
   // internal interface
   //   call these with client_lock held!
@@ -1116,10 +1117,14 @@ private:
 
   loff_t _lseek(Fh *fh, loff_t offset, int whence);
   int64_t _read(Fh *fh, int64_t offset, uint64_t size, bufferlist *bl);
+  static bufferlist copy_write_data(const char *buf, int64_t size,
+                                    const struct iovec *iov, int iovcnt);
   int64_t _write(Fh *fh, int64_t offset, uint64_t size, const char *buf,
           const struct iovec *iov, int iovcnt);
+  int64_t _write(Fh *fh, int64_t offset, uint64_t size, bufferlist&& bl);
   int64_t _preadv_pwritev_locked(Fh *f, const struct iovec *iov,
-	      unsigned iovcnt, int64_t offset, bool write, bool clamp_to_int);
+	      unsigned iovcnt, int64_t offset, bool write, bool clamp_to_int,
+	      bufferlist *data = nullptr);
   int _preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write);
   int _flush(Fh *fh);
   int _fsync(Fh *fh, bool syncdataonly);
@@ -31,9 +31,19 @@ void MetaSession::dump(Formatter *f) const
   f->dump_stream("last_cap_renew_request") << last_cap_renew_request;
   f->dump_unsigned("cap_renew_seq", cap_renew_seq);
   f->dump_int("num_caps", caps.size());
+  f->dump_unsigned("num_delegated_inos", delegated_inos.size());
   f->dump_string("state", get_state_name());
 }
 
+inodeno_t MetaSession::take_delegated_ino()
+{
+  if (delegated_inos.empty())
+    return 0;
+  inodeno_t ino = delegated_inos.range_start();
+  delegated_inos.erase(ino);
+  return ino;
+}
+
 void MetaSession::enqueue_cap_release(inodeno_t ino, uint64_t cap_id, ceph_seq_t iseq,
     ceph_seq_t mseq, epoch_t osd_barrier)
 {
@@ -54,6 +54,9 @@ struct MetaSession {
   xlist<MetaRequest*> unsafe_requests;
   std::set<ceph_tid_t> flushing_caps_tids;
 
+  // the numbers the mds delegated to us for the inodes we create
+  interval_set<inodeno_t> delegated_inos;
+
   ceph::ref_t<MClientCapRelease> release;
 
   MetaSession(mds_rank_t mds_num, ConnectionRef con,
@@ -68,6 +71,9 @@ struct MetaSession {
 
   void dump(Formatter *f) const;
 
+  // a delegated ino for a create, or 0 if none is left
+  inodeno_t take_delegated_ino();
+
   void enqueue_cap_release(inodeno_t ino, uint64_t cap_id, ceph_seq_t iseq,
       ceph_seq_t mseq, epoch_t osd_barrier);
 };
@@ -574,6 +574,19 @@ static void fuse_ll_link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent,
   cfuse->iput(nin);
 }
 
+/*
+ * With the writeback cache the kernel reads the pages it writes partially,
+ * even through the files opened write only, so open those read-write too.
+ */
+static int writeback_open_flags(CephFuse::Handle *cfuse, int flags)
+{
+  auto fuse_writeback_cache = cfuse->client->cct->_conf.get_val<bool>(
+    "fuse_writeback_cache");
+  if (fuse_writeback_cache && (flags & O_ACCMODE) == O_WRONLY)
+    return (flags & ~O_ACCMODE) | O_RDWR;
+  return flags;
+}
+
 static void fuse_ll_open(fuse_req_t req, fuse_ino_t ino,
 			 struct fuse_file_info *fi)
 {
@@ -584,7 +597,12 @@ static void fuse_ll_open(fuse_req_t req, fuse_ino_t ino,
   UserPerm perms(ctx->uid, ctx->gid);
   get_fuse_groups(perms, req);
 
-  int r = cfuse->client->ll_open(in, fi->flags, &fh, perms);
+  int flags = writeback_open_flags(cfuse, fi->flags);
+  int r = cfuse->client->ll_open(in, flags, &fh, perms);
+  if (r == -EACCES && flags != fi->flags) {
+    // no read permission, the kernel will not cache the partial writes
+    r = cfuse->client->ll_open(in, fi->flags, &fh, perms);
+  }
   if (r == 0) {
     fi->fh = (uint64_t)fh;
 #if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 8)
@@ -612,10 +630,18 @@ static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
   Fh *fh = reinterpret_cast<Fh*>(fi->fh);
   bufferlist bl;
   int r = cfuse->client->ll_read(fh, off, size, &bl);
-  if (r >= 0)
-    fuse_reply_buf(req, bl.c_str(), bl.length());
-  else
+  if (r < 0) {
     fuse_reply_err(req, -r);
+    return;
+  }
+  // reply with the buffers of the read, rather than rebuilding them into
+  // a contiguous one
+  std::vector<struct iovec> iov;
+  iov.reserve(bl.get_num_buffers());
+  for (auto& p : bl.buffers()) {
+    iov.push_back({const_cast<char*>(p.c_str()), p.length()});
+  }
+  fuse_reply_iov(req, iov.data(), iov.size());
 }
 
 static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
@@ -630,6 +656,38 @@ static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
     fuse_reply_err(req, -r);
 }
 
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+static void fuse_ll_write_buf(fuse_req_t req, fuse_ino_t ino,
+			      struct fuse_bufvec *bufv, off_t off,
+			      struct fuse_file_info *fi)
+{
+  CephFuse::Handle *cfuse = fuse_ll_req_prepare(req);
+  Fh *fh = reinterpret_cast<Fh*>(fi->fh);
+  size_t size = fuse_buf_size(bufv);
+  int r;
+  if (bufv->count == 1 && bufv->idx == 0 && bufv->off == 0 &&
+      !(bufv->buf[0].flags & FUSE_BUF_IS_FD)) {
+    // libfuse read the request into memory
+    r = cfuse->client->ll_write(fh, off, size, (const char *)bufv->buf[0].mem);
+  } else {
+    // the data is still in the pipe it was spliced to, move it to our
+    // buffer without going through the one of libfuse
+    bufferptr bp = buffer::create(size);
+    struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+    dst.buf[0].mem = bp.c_str();
+    ssize_t copied = fuse_buf_copy(&dst, bufv, (enum fuse_buf_copy_flags)0);
+    if (copied < 0)
+      r = copied;
+    else
+      r = cfuse->client->ll_write(fh, off, copied, bp.c_str());
+  }
+  if (r >= 0)
+    fuse_reply_write(req, r);
+  else
+    fuse_reply_err(req, -r);
+}
+#endif
+
 static void fuse_ll_flush(fuse_req_t req, fuse_ino_t ino,
 			  struct fuse_file_info *fi)
 {
@@ -803,8 +861,10 @@ static void fuse_ll_create(fuse_req_t req, fuse_ino_t parent, const char *name,
   memset(&fe, 0, sizeof(fe));
 
   // pass &i2 for the created inode so that ll_create takes an initial ll_ref
-  int r = cfuse->client->ll_create(i1, name, mode, fi->flags, &fe.attr, &i2,
-				   &fh, perms);
+  // the new file is ours, it can be opened read-write for the writeback cache
+  int r = cfuse->client->ll_create(i1, name, mode,
+				   writeback_open_flags(cfuse, fi->flags),
+				   &fe.attr, &i2, &fh, perms);
   if (r == 0) {
     fi->fh = (uint64_t)fh;
     fe.ino = cfuse->make_fake_ino(fe.attr.st_ino, fe.attr.st_dev);
@@ -990,6 +1050,23 @@ static void do_init(void *data, fuse_conn_info *conn)
     conn->want |= FUSE_CAP_EXPORT_SUPPORT;
 #endif
 
+#ifdef FUSE_CAP_SPLICE_READ
+  // have the data of the writes spliced from /dev/fuse, for write_buf
+  auto fuse_splice_read = client->cct->_conf.get_val<bool>(
+    "fuse_splice_read");
+  if (fuse_splice_read && (conn->capable & FUSE_CAP_SPLICE_READ)) {
+    conn->want |= FUSE_CAP_SPLICE_READ;
+    if (conn->capable & FUSE_CAP_SPLICE_MOVE)
+      conn->want |= FUSE_CAP_SPLICE_MOVE;
+  }
+#endif
+#ifdef FUSE_CAP_WRITEBACK_CACHE
+  auto fuse_writeback_cache = client->cct->_conf.get_val<bool>(
+    "fuse_writeback_cache");
+  if (fuse_writeback_cache && (conn->capable & FUSE_CAP_WRITEBACK_CACHE))
+    conn->want |= FUSE_CAP_WRITEBACK_CACHE;
+#endif
+
   if (cfuse->fd_on_success) {
     //cout << "fuse init signaling on fd " << fd_on_success << std::endl;
     // see Preforker::daemonize(), ceph-fuse's parent process expects a `-1`
@@ -1054,7 +1131,7 @@ const static struct fuse_lowlevel_ops fuse_ll_oper = {
  poll: 0,
 #endif
 #if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
- write_buf: 0,
+ write_buf: fuse_ll_write_buf,
  retrieve_reply: 0,
  forget_multi: 0,
  flock: fuse_ll_flock,
@@ -1256,7 +1333,10 @@ int CephFuse::Handle::loop()
     "fuse_multithreaded");
   if (fuse_multithreaded) {
 #if FUSE_VERSION >= FUSE_MAKE_VERSION(3, 0)
-    return fuse_session_loop_mt(se, opts.clone_fd);
+    // with clone_fd each worker thread reads its own /dev/fuse channel
+    auto fuse_clone_fd = client->cct->_conf.get_val<bool>(
+      "fuse_clone_fd");
+    return fuse_session_loop_mt(se, opts.clone_fd || fuse_clone_fd);
 #else
     return fuse_session_loop_mt(se);
 #endif
@@ -154,8 +154,6 @@ static int cls_log_list(cls_method_context_t hctx, bufferlist *in, bufferlist *o
     return -EINVAL;
   }
 
-  map<string, bufferlist> keys;
-
   string from_index;
   string to_index;
 
@@ -176,33 +174,33 @@ static int cls_log_list(cls_method_context_t hctx, bufferlist *in, bufferlist *o
 
   cls_log_list_ret ret;
 
-  int rc = cls_cxx_map_get_vals(hctx, from_index, log_index_prefix, max_entries, &keys, &ret.truncated);
-  if (rc < 0)
-    return rc;
-
   auto& entries = ret.entries;
-  auto iter = keys.begin();
-
   string marker;
-
-  for (; iter != keys.end(); ++iter) {
-    const string& index = iter->first;
-    marker = index;
-    if (use_time_boundary && index.compare(0, to_index.size(), to_index) >= 0) {
-      ret.truncated = false;
-      break;
-    }
-
-    bufferlist& bl = iter->second;
-    auto biter = bl.cbegin();
-    try {
-      cls_log_entry e;
-      decode(e, biter);
-      entries.push_back(e);
-    } catch (ceph::buffer::error& err) {
-      CLS_LOG(0, "ERROR: cls_log_list: could not decode entry, index=%s", index.c_str());
-    }
-  }
+  bool past_boundary = false;
+
+  // stop at the time boundary instead of reading the entries after it
+  int rc = cls_cxx_map_iterate(hctx, from_index, log_index_prefix, max_entries,
+    [&](const string& index, const bufferlist& bl) {
+      marker = index;
+      if (use_time_boundary && index.compare(0, to_index.size(), to_index) >= 0) {
+        past_boundary = true;
+        return false;
+      }
+
+      auto biter = bl.cbegin();
+      try {
+        cls_log_entry e;
+        decode(e, biter);
+        entries.push_back(e);
+      } catch (ceph::buffer::error& err) {
+        CLS_LOG(0, "ERROR: cls_log_list: could not decode entry, index=%s", index.c_str());
+      }
+      return true;
+    }, &ret.truncated);
+  if (rc < 0)
+    return rc;
+  if (past_boundary)
+    ret.truncated = false;
 
   ret.marker = marker;
 
@@ -34,6 +34,8 @@
 #include "include/uuid.h"
 #include "common/bit_vector.hpp"
 #include "common/errno.h"
+#include "compressor/Compressor.h"
+#include "global/global_context.h"
 #include "objclass/objclass.h"
 #include "osd/osd_types.h"
 #include "include/rbd_types.h"
@@ -8077,6 +8079,105 @@ int sparsify(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
   return 0;
 }
 
+/**
+ * Read the data of extents, skipping the zeroed blocks, as one optionally
+ * compressed buffer
+ *
+ * Input:
+ * @param extents extents (offset, length) to read
+ * @param sparse_size minimal zeroed block to skip
+ * @param compressor name of the compressor, or empty to not compress
+ *
+ * Output:
+ * @param extent_maps per extent map of the data read
+ * @param compressor name of the compressor of the data, or empty if it
+ *                   could not be compressed
+ * @param raw_length length of the data once decompressed
+ * @param data data (compressed) of all of the extent maps
+ * @returns -ENOENT if the object does not exist
+ * @returns 0 on success, negative error code on failure
+ */
+int compressed_read(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  std::vector<std::pair<uint64_t, uint64_t>> extents;
+  uint64_t sparse_size;
+  std::string compressor_name;
+  try {
+    auto iter = in->cbegin();
+    decode(extents, iter);
+    decode(sparse_size, iter);
+    decode(compressor_name, iter);
+  } catch (const ceph::buffer::error &err) {
+    return -EINVAL;
+  }
+
+  if (sparse_size == 0) {
+    return -EINVAL;
+  }
+
+  std::vector<std::map<uint64_t, uint64_t>> extent_maps;
+  extent_maps.reserve(extents.size());
+  bufferlist data;
+  for (auto& [extent_offset, extent_length] : extents) {
+    bufferlist bl;
+    int r = cls_cxx_read(hctx, extent_offset, extent_length, &bl);
+    if (r < 0) {
+      if (r != -ENOENT) {
+        CLS_ERR("failed to read data off of disk: %s", cpp_strerror(r).c_str());
+      }
+      return r;
+    }
+
+    auto& extent_map = extent_maps.emplace_back();
+    if (bl.length() == 0 || bl.is_zero()) {
+      continue;
+    }
+
+    bl.rebuild(ceph::buffer::ptr_node::create(bl.length()));
+    size_t read_offset = 0;
+    size_t read_length = 0;
+    size_t offset = 0;
+    size_t length = bl.length();
+    const auto& ptr = bl.front();
+    while (offset < length) {
+      if (calc_sparse_extent(ptr, sparse_size, length, &read_offset,
+                             &read_length, &offset)) {
+        extent_map[extent_offset + read_offset] = read_length;
+        data.push_back(ceph::buffer::ptr_node::create(ptr, read_offset,
+                                                      read_length));
+        read_offset = offset;
+        read_length = 0;
+      }
+    }
+  }
+
+  uint32_t raw_length = data.length();
+  if (!compressor_name.empty() && raw_length > 0) {
+    auto compressor = Compressor::create(g_ceph_context, compressor_name);
+    bufferlist compressed_data;
+    if (!compressor) {
+      CLS_LOG(10, "compressor %s is not available", compressor_name.c_str());
+      compressor_name.clear();
+    } else if (compressor->compress(data, compressed_data) < 0 ||
+               compressed_data.length() >= raw_length) {
+      CLS_LOG(20, "data is not compressible");
+      compressor_name.clear();
+    } else {
+      CLS_LOG(20, "compressed %u to %u bytes", raw_length,
+              compressed_data.length());
+      data = std::move(compressed_data);
+    }
+  } else {
+    compressor_name.clear();
+  }
+
+  encode(extent_maps, *out);
+  encode(compressor_name, *out);
+  encode(raw_length, *out);
+  encode(data, *out);
+  return 0;
+}
+
 CLS_INIT(rbd)
 {
   CLS_LOG(20, "Loaded rbd class!");
@@ -8212,6 +8313,7 @@ CLS_INIT(rbd)
   cls_method_handle_t h_sparse_copyup;
   cls_method_handle_t h_assert_snapc_seq;
   cls_method_handle_t h_sparsify;
+  cls_method_handle_t h_compressed_read;
 
   cls_register("rbd", &h_class);
   cls_register_cxx_method(h_class, "create",
@@ -8625,4 +8727,6 @@ CLS_INIT(rbd)
   cls_register_cxx_method(h_class, "sparsify",
 			  CLS_METHOD_RD | CLS_METHOD_WR,
 			  sparsify, &h_sparsify);
+  cls_register_cxx_method(h_class, "compressed_read", CLS_METHOD_RD,
+                          compressed_read, &h_compressed_read);
 }
@@ -2959,5 +2959,54 @@ int sparsify(librados::IoCtx *ioctx, const std::string &oid, size_t sparse_size,
   return ioctx->operate(oid, &op);
 }
 
+void compressed_read_start(
+    librados::ObjectReadOperation *op,
+    const std::vector<std::pair<uint64_t, uint64_t>> &extents,
+    uint64_t sparse_size, const std::string &compressor)
+{
+  bufferlist bl;
+  encode(extents, bl);
+  encode(sparse_size, bl);
+  encode(compressor, bl);
+  op->exec("rbd", "compressed_read", bl);
+}
+
+int compressed_read_finish(
+    bufferlist::const_iterator *it,
+    std::vector<std::map<uint64_t, uint64_t>> *extent_maps,
+    std::string *compressor, uint32_t *raw_length, bufferlist *data)
+{
+  try {
+    decode(*extent_maps, *it);
+    decode(*compressor, *it);
+    decode(*raw_length, *it);
+    decode(*data, *it);
+  } catch (const ceph::buffer::error &err) {
+    return -EBADMSG;
+  }
+  return 0;
+}
+
+int compressed_read(
+    librados::IoCtx *ioctx, const std::string &oid,
+    const std::vector<std::pair<uint64_t, uint64_t>> &extents,
+    uint64_t sparse_size, const std::string &compressor,
+    std::vector<std::map<uint64_t, uint64_t>> *extent_maps,
+    std::string *out_compressor, uint32_t *raw_length, bufferlist *data)
+{
+  librados::ObjectReadOperation op;
+  compressed_read_start(&op, extents, sparse_size, compressor);
+
+  bufferlist out_bl;
+  int r = ioctx->operate(oid, &op, &out_bl);
+  if (r < 0) {
+    return r;
+  }
+
+  auto it = out_bl.cbegin();
+  return compressed_read_finish(&it, extent_maps, out_compressor, raw_length,
+                                data);
+}
+
 } // namespace cls_client
 } // namespace librbd
@@ -649,6 +649,22 @@ void sparsify(librados::ObjectWriteOperation *op, size_t sparse_size,
 int sparsify(librados::IoCtx *ioctx, const std::string &oid, size_t sparse_size,
              bool remove_empty);
 
+void compressed_read_start(
+    librados::ObjectReadOperation *op,
+    const std::vector<std::pair<uint64_t, uint64_t>> &extents,
+    uint64_t sparse_size, const std::string &compressor);
+int compressed_read_finish(
+    ceph::buffer::list::const_iterator *it,
+    std::vector<std::map<uint64_t, uint64_t>> *extent_maps,
+    std::string *compressor, uint32_t *raw_length, ceph::buffer::list *data);
+int compressed_read(
+    librados::IoCtx *ioctx, const std::string &oid,
+    const std::vector<std::pair<uint64_t, uint64_t>> &extents,
+    uint64_t sparse_size, const std::string &compressor,
+    std::vector<std::map<uint64_t, uint64_t>> *extent_maps,
+    std::string *out_compressor, uint32_t *raw_length,
+    ceph::buffer::list *data);
+
 } // namespace cls_client
 } // namespace librbd
 
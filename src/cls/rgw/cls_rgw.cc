@@ -45,13 +45,15 @@ CLS_NAME(rgw)
 #define BI_BUCKET_LOG_INDEX           1
 #define BI_BUCKET_OBJ_INSTANCE_INDEX  2
 #define BI_BUCKET_OLH_DATA_INDEX      3
+#define BI_BUCKET_RESHARD_LOG_INDEX   4
 
-#define BI_BUCKET_LAST_INDEX          4
+#define BI_BUCKET_LAST_INDEX          5
 
 static std::string bucket_index_prefixes[] = { "", /* special handling for the objs list index */
                                           "0_",     /* bucket log index */
                                           "1000_",  /* obj instance index */
                                           "1001_",  /* olh data index */
+                                          "2000_",  /* reshard log index */
 
                                           /* this must be the last index */
                                           "9999_",};
@@ -496,6 +498,13 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
   bool done = false;   // whether we need to keep calling get_obj_vals
   bool more = true;    // output parameter of get_obj_vals
   bool has_delimiter = !op.delimiter.empty();
+  bool end_reached = false; // whether we stopped at op.end_key
+
+  // the caller merges the shards' results and does not need the entries
+  // past the ones it has from the other shards yet
+  auto past_end = [&op](const string& key) {
+    return !op.end_key.empty() && key >= op.end_key;
+  };
 
   if (has_delimiter &&
       boost::algorithm::ends_with(start_after_key, op.delimiter)) {
@@ -528,6 +537,11 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         break;
       }
 
+      if (past_end(kiter->first)) {
+	end_reached = done = true;
+	break;
+      }
+
       rgw_bucket_dir_entry entry;
       try {
 	const bufferlist& entrybl = kiter->second;
@@ -620,7 +634,7 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
     } // for (auto kiter...
   } // for (int attempt...
 
-  ret.is_truncated = more && !done;
+  ret.is_truncated = end_reached || (more && !done);
   encode(ret, *out);
   return 0;
 } // rgw_bucket_list
@@ -701,6 +715,49 @@ static int write_bucket_header(cls_method_context_t hctx, rgw_bucket_dir_header
 }
 
 
+static void reshard_log_prefix(string *key)
+{
+  *key = BI_PREFIX_CHAR;
+  key->append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+}
+
+/*
+ * while the shard is copied to the new shards of a resharding, remember
+ * the names of the entries changed, so they are copied again; a name
+ * logged twice takes a single key
+ */
+static int reshard_log_record(cls_method_context_t hctx,
+			      const rgw_bucket_dir_header& header,
+			      const string& name)
+{
+  if (!header.new_instance.resharding_in_logrecord()) {
+    return 0;
+  }
+
+  string key;
+  reshard_log_prefix(&key);
+  key.append(name);
+
+  bufferlist empty;
+  int ret = cls_cxx_map_set_val(hctx, key, &empty);
+  if (ret < 0) {
+    CLS_LOG(0, "ERROR: %s(): failed to log %s ret=%d", __func__,
+	    escape_str(name).c_str(), ret);
+  }
+  return ret;
+}
+
+static int reshard_log_record(cls_method_context_t hctx, const string& name)
+{
+  rgw_bucket_dir_header header;
+  int ret = read_bucket_header(hctx, &header);
+  if (ret < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to read header\n", __func__);
+    return ret;
+  }
+  return reshard_log_record(hctx, header, name);
+}
+
 int rgw_bucket_rebuild_index(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   rgw_bucket_dir_header existing_header;
@@ -742,6 +799,15 @@ int rgw_bucket_update_stats(cls_method_context_t hctx, bufferlist *in, bufferlis
       dest.actual_size += s.second.actual_size;
     }
   }
+  if (!op.absolute) {
+    for (auto& s : op.dec_stats) {
+      auto& dest = header.stats[s.first];
+      dest.total_size -= s.second.total_size;
+      dest.total_size_rounded -= s.second.total_size_rounded;
+      dest.num_entries -= s.second.num_entries;
+      dest.actual_size -= s.second.actual_size;
+    }
+  }
 
   return write_bucket_header(hctx, &header);
 }
@@ -940,34 +1006,24 @@ static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key,
   return 0;
 }
 
-int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+/*
+ * apply a completed op to its entry and to the header, which the caller
+ * writes out if *update_header is set
+ */
+static int complete_op(cls_method_context_t hctx, rgw_cls_obj_complete_op& op,
+		       rgw_bucket_dir_header& header, bool *update_header)
 {
-  // decode request
-  rgw_cls_obj_complete_op op;
-  auto iter = in->cbegin();
-  try {
-    decode(op, iter);
-  } catch (ceph::buffer::error& err) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
-    return -EINVAL;
-  }
   CLS_LOG(1, "rgw_bucket_complete_op(): request: op=%d name=%s instance=%s ver=%lu:%llu tag=%s\n",
           op.op, op.key.name.c_str(), op.key.instance.c_str(),
           (unsigned long)op.ver.pool, (unsigned long long)op.ver.epoch,
           op.tag.c_str());
 
-  rgw_bucket_dir_header header;
-  int rc = read_bucket_header(hctx, &header);
-  if (rc < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
-    return -EINVAL;
-  }
-
+  *update_header = false;
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
   string idx;
-  rc = read_key_entry(hctx, op.key, &idx, &entry);
+  int rc = read_key_entry(hctx, op.key, &idx, &entry);
   if (rc == -ENOENT) {
     entry.key = op.key;
     entry.ver = op.ver;
@@ -1016,6 +1072,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return 0;
   }
 
+  *update_header = true;
   if (entry.exists) {
     unaccount_entry(header, entry);
   }
@@ -1062,6 +1119,11 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     break;
   }
 
+  rc = reshard_log_record(hctx, header, op.key.name);
+  if (rc < 0) {
+    return rc;
+  }
+
   if (op.log_op && !header.syncstopped) {
     rc = log_index_operation(hctx, op.key, op.op, op.tag, entry.meta.mtime, entry.ver,
                              CLS_RGW_STATE_COMPLETE, header.ver, header.max_marker, op.bilog_flags, NULL, NULL, &op.zones_trace);
@@ -1089,6 +1151,11 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 	    int(remove_entry.meta.category));
     unaccount_entry(header, remove_entry);
 
+    ret = reshard_log_record(hctx, header, remove_key.name);
+    if (ret < 0) {
+      return ret;
+    }
+
     if (op.log_op && !header.syncstopped) {
       ++header.ver; // increment index version, or we'll overwrite keys previously written
       rc = log_index_operation(hctx, remove_key, CLS_RGW_OP_DEL, op.tag, remove_entry.meta.mtime,
@@ -1104,6 +1171,86 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     }
   }
 
+  return 0;
+}
+
+int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_obj_complete_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
+    return -EINVAL;
+  }
+
+  bool update_header;
+  rc = complete_op(hctx, op, header, &update_header);
+  if (rc < 0 || !update_header) {
+    return rc;
+  }
+  return write_bucket_header(hctx, &header);
+}
+
+/*
+ * the completions of several ops on the shard, in one call: the header is
+ * read and written once and each op gets its own result. The entries
+ * written by an op are not visible to the reads of the next ones, so the
+ * ops must be on distinct keys.
+ */
+int rgw_bucket_complete_ops(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  rgw_cls_obj_complete_ops_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode request\n", __func__);
+    return -EINVAL;
+  }
+
+  std::set<cls_rgw_obj_key> keys;
+  for (auto& o : op.ops) {
+    if (!keys.insert(o.key).second) {
+      CLS_LOG(1, "ERROR: %s(): duplicate key name=%s instance=%s\n", __func__,
+	      o.key.name.c_str(), o.key.instance.c_str());
+      return -EINVAL;
+    }
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to read header\n", __func__);
+    return -EINVAL;
+  }
+
+  rgw_cls_obj_complete_ops_ret ret;
+  bool header_dirty = false;
+  for (auto& o : op.ops) {
+    if (header_dirty) {
+      // take the version a header write between the ops would have given
+      ++header.ver;
+    }
+    bool update_header;
+    rc = complete_op(hctx, o, header, &update_header);
+    ret.results.push_back(rc);
+    header_dirty = header_dirty || (rc >= 0 && update_header);
+  }
+
+  encode(ret, *out);
+  if (!header_dirty) {
+    return 0;
+  }
   return write_bucket_header(hctx, &header);
 }
 
@@ -1530,11 +1677,16 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return -EINVAL;
   }
 
+  int ret = reshard_log_record(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   BIVerObjEntry obj(hctx, op.key);
   BIOLHEntry olh(hctx, op.key);
 
   /* read instance entry */
-  int ret = obj.init(op.delete_marker);
+  ret = obj.init(op.delete_marker);
   bool existed = (ret == 0);
   if (ret == -ENOENT && op.delete_marker) {
     ret = 0;
@@ -1727,6 +1879,11 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return -EINVAL;
   }
 
+  int ret = reshard_log_record(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   cls_rgw_obj_key dest_key = op.key;
   if (dest_key.instance == "null") {
     dest_key.instance.clear();
@@ -1735,7 +1892,7 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
   BIVerObjEntry obj(hctx, dest_key);
   BIOLHEntry olh(hctx, dest_key);
 
-  int ret = obj.init();
+  ret = obj.init();
   if (ret == -ENOENT) {
     return 0; /* already removed */
   }
@@ -1947,6 +2104,11 @@ static int rgw_bucket_trim_olh_log(cls_method_context_t hctx, bufferlist *in, bu
     return -ECANCELED;
   }
 
+  ret = reshard_log_record(hctx, op.olh.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   /* remove all versions up to and including ver from the pending map */
   auto& log = olh_data_entry.pending_log;
   auto liter = log.begin();
@@ -1998,6 +2160,11 @@ static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, buffe
     return -ECANCELED;
   }
 
+  ret = reshard_log_record(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   ret = cls_cxx_map_remove_key(hctx, olh_data_key);
   if (ret < 0) {
     CLS_LOG(1, "NOTICE: %s(): can't remove key %s ret=%d", __func__, olh_data_key.c_str(), ret);
@@ -2071,6 +2238,11 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
     if (ret < 0 && ret != -ENOENT)
       return -EINVAL;
 
+    ret = reshard_log_record(hctx, header, cur_change.key.name);
+    if (ret < 0) {
+      return ret;
+    }
+
     if (ret == -ENOENT) {
       continue;
     }
@@ -4009,7 +4181,8 @@ static int rgw_guard_bucket_resharding(cls_method_context_t hctx, bufferlist *in
     return rc;
   }
 
-  if (header.resharding()) {
+  // the writes go on while the shard records the entries they change
+  if (header.resharding() && !header.new_instance.resharding_in_logrecord()) {
     return op.ret_err;
   }
 
@@ -4044,6 +4217,70 @@ static int rgw_get_bucket_resharding(cls_method_context_t hctx,
   return 0;
 }
 
+static int rgw_reshard_log_list(cls_method_context_t hctx,
+				bufferlist *in, bufferlist *out)
+{
+  cls_rgw_reshard_log_list_op op;
+
+  auto in_iter = in->cbegin();
+  try {
+    decode(op, in_iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode entry\n", __func__);
+    return -EINVAL;
+  }
+
+  string prefix;
+  reshard_log_prefix(&prefix);
+  string start_after_key = prefix + op.marker;
+
+  map<string, bufferlist> keys;
+  cls_rgw_reshard_log_list_ret op_ret;
+#define MAX_RESHARD_LOG_LIST_ENTRIES 1000
+  uint32_t max = std::min<uint32_t>(op.max, MAX_RESHARD_LOG_LIST_ENTRIES);
+  int ret = cls_cxx_map_get_vals(hctx, start_after_key, prefix, max,
+				 &keys, &op_ret.is_truncated);
+  if (ret < 0) {
+    return ret;
+  }
+
+  for (auto& key : keys) {
+    op_ret.entries.push_back(key.first.substr(prefix.size()));
+  }
+
+  encode(op_ret, *out);
+
+  return 0;
+}
+
+static int rgw_reshard_log_trim(cls_method_context_t hctx,
+				bufferlist *in, bufferlist *out)
+{
+  cls_rgw_reshard_log_trim_op op;
+
+  auto in_iter = in->cbegin();
+  try {
+    decode(op, in_iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode entry\n", __func__);
+    return -EINVAL;
+  }
+
+  string prefix;
+  reshard_log_prefix(&prefix);
+
+  for (auto& name : op.entries) {
+    int ret = cls_cxx_map_remove_key(hctx, prefix + name);
+    if (ret < 0 && ret != -ENOENT) {
+      CLS_LOG(1, "ERROR: %s(): failed to remove %s ret=%d\n", __func__,
+	      escape_str(name).c_str(), ret);
+      return ret;
+    }
+  }
+
+  return 0;
+}
+
 CLS_INIT(rgw)
 {
   CLS_LOG(1, "Loaded rgw class!");
@@ -4057,6 +4294,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bucket_update_stats;
   cls_method_handle_t h_rgw_bucket_prepare_op;
   cls_method_handle_t h_rgw_bucket_complete_op;
+  cls_method_handle_t h_rgw_bucket_complete_ops;
   cls_method_handle_t h_rgw_bucket_link_olh;
   cls_method_handle_t h_rgw_bucket_unlink_instance_op;
   cls_method_handle_t h_rgw_bucket_read_olh_log;
@@ -4095,6 +4333,8 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_clear_bucket_resharding;
   cls_method_handle_t h_rgw_guard_bucket_resharding;
   cls_method_handle_t h_rgw_get_bucket_resharding;
+  cls_method_handle_t h_rgw_reshard_log_list;
+  cls_method_handle_t h_rgw_reshard_log_trim;
 
   cls_register(RGW_CLASS, &h_class);
 
@@ -4107,6 +4347,7 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BUCKET_UPDATE_STATS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_update_stats, &h_rgw_bucket_update_stats);
   cls_register_cxx_method(h_class, RGW_BUCKET_PREPARE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_prepare_op, &h_rgw_bucket_prepare_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_op, &h_rgw_bucket_complete_op);
+  cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OPS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_ops, &h_rgw_bucket_complete_ops);
   cls_register_cxx_method(h_class, RGW_BUCKET_LINK_OLH, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_link_olh, &h_rgw_bucket_link_olh);
   cls_register_cxx_method(h_class, RGW_BUCKET_UNLINK_INSTANCE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_unlink_instance, &h_rgw_bucket_unlink_instance_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_READ_OLH_LOG, CLS_METHOD_RD, rgw_bucket_read_olh_log, &h_rgw_bucket_read_olh_log);
@@ -4165,6 +4406,10 @@ CLS_INIT(rgw)
 			  rgw_guard_bucket_resharding, &h_rgw_guard_bucket_resharding);
   cls_register_cxx_method(h_class, RGW_GET_BUCKET_RESHARDING, CLS_METHOD_RD ,
 			  rgw_get_bucket_resharding, &h_rgw_get_bucket_resharding);
+  cls_register_cxx_method(h_class, RGW_RESHARD_LOG_LIST, CLS_METHOD_RD,
+			  rgw_reshard_log_list, &h_rgw_reshard_log_list);
+  cls_register_cxx_method(h_class, RGW_RESHARD_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR,
+			  rgw_reshard_log_trim, &h_rgw_reshard_log_trim);
 
   return;
 }
@@ -161,11 +161,15 @@ int CLSRGWIssueSetTagTimeout::issue_op(int shard_id, const string& oid)
 
 void cls_rgw_bucket_update_stats(librados::ObjectWriteOperation& o,
 				 bool absolute,
-                                 const map<RGWObjCategory, rgw_bucket_category_stats>& stats)
+                                 const map<RGWObjCategory, rgw_bucket_category_stats>& stats,
+                                 const map<RGWObjCategory, rgw_bucket_category_stats>* dec_stats)
 {
   rgw_cls_bucket_update_stats_op call;
   call.absolute = absolute;
   call.stats = stats;
+  if (dec_stats) {
+    call.dec_stats = *dec_stats;
+  }
   bufferlist in;
   encode(call, in);
   o.exec(RGW_CLASS, RGW_BUCKET_UPDATE_STATS, in);
@@ -215,13 +219,43 @@ void cls_rgw_bucket_complete_op(ObjectWriteOperation& o, RGWModifyOp op, string&
   o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OP, in);
 }
 
+void cls_rgw_bucket_complete_ops(ObjectWriteOperation& o,
+                                 const vector<rgw_cls_obj_complete_op>& ops,
+                                 bufferlist *out, int *prval)
+{
+  bufferlist in;
+  rgw_cls_obj_complete_ops_op call;
+  call.ops = ops;
+  encode(call, in);
+  if (out) {
+    o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OPS, in, out, prval);
+  } else {
+    o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OPS, in);
+  }
+}
+
+int cls_rgw_bucket_complete_ops_decode(const bufferlist& out,
+                                       vector<int32_t> *results)
+{
+  rgw_cls_obj_complete_ops_ret ret;
+  try {
+    auto iter = out.cbegin();
+    decode(ret, iter);
+  } catch (ceph::buffer::error& err) {
+    return -EIO;
+  }
+  *results = std::move(ret.results);
+  return 0;
+}
+
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
                             const std::string& delimiter,
                             uint32_t num_entries,
                             bool list_versions,
-                            rgw_cls_list_ret* result)
+                            rgw_cls_list_ret* result,
+                            const std::string& end_key)
 {
   bufferlist in;
   rgw_cls_list_op call;
@@ -230,6 +264,7 @@ void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
   call.delimiter = delimiter;
   call.num_entries = num_entries;
   call.list_versions = list_versions;
+  call.end_key = end_key;
   encode(call, in);
 
   op.exec(RGW_CLASS, RGW_BUCKET_LIST, in,
@@ -1062,6 +1097,31 @@ void cls_rgw_guard_bucket_resharding(librados::ObjectOperation& op, int ret_err)
   op.exec(RGW_CLASS, RGW_GUARD_BUCKET_RESHARDING, in);
 }
 
+void cls_rgw_reshard_log_list(librados::ObjectReadOperation& op,
+                              const string& marker, uint32_t max,
+                              cls_rgw_reshard_log_list_ret *pdata, int *ret)
+{
+  cls_rgw_reshard_log_list_op call;
+  call.marker = marker;
+  call.max = max;
+
+  bufferlist in;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_RESHARD_LOG_LIST, in,
+	  new ClsBucketIndexOpCtx<cls_rgw_reshard_log_list_ret>(pdata, ret));
+}
+
+void cls_rgw_reshard_log_trim(librados::ObjectWriteOperation& op,
+                              const list<string>& entries)
+{
+  cls_rgw_reshard_log_trim_op call;
+  call.entries = entries;
+
+  bufferlist in;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_RESHARD_LOG_TRIM, in);
+}
+
 static bool issue_set_bucket_resharding(librados::IoCtx& io_ctx, const string& oid,
                                         const cls_rgw_bucket_instance_entry& entry,
                                         BucketIndexAioManager *manager) {
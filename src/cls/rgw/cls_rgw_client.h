@@ -353,7 +353,8 @@ public:
 
 void cls_rgw_bucket_update_stats(librados::ObjectWriteOperation& o,
                                  bool absolute,
-                                 const std::map<RGWObjCategory, rgw_bucket_category_stats>& stats);
+                                 const std::map<RGWObjCategory, rgw_bucket_category_stats>& stats,
+                                 const std::map<RGWObjCategory, rgw_bucket_category_stats>* dec_stats = nullptr);
 
 void cls_rgw_bucket_prepare_op(librados::ObjectWriteOperation& o, RGWModifyOp op, std::string& tag,
                                const cls_rgw_obj_key& key, const std::string& locator, bool log_op,
@@ -366,6 +367,15 @@ void cls_rgw_bucket_complete_op(librados::ObjectWriteOperation& o, RGWModifyOp o
 				std::list<cls_rgw_obj_key> *remove_objs, bool log_op,
                                 uint16_t bilog_op, rgw_zone_set *zones_trace);
 
+/* the results of the ops are only returned to operate() with the
+ * OPERATION_RETURNVEC flag */
+void cls_rgw_bucket_complete_ops(librados::ObjectWriteOperation& o,
+                                 const std::vector<rgw_cls_obj_complete_op>& ops,
+                                 ceph::buffer::list *out = nullptr,
+                                 int *prval = nullptr);
+int cls_rgw_bucket_complete_ops_decode(const ceph::buffer::list& out,
+                                       std::vector<int32_t> *results);
+
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, std::list<std::string>& keep_attr_prefixes);
 void cls_rgw_obj_store_pg_ver(librados::ObjectWriteOperation& o, const std::string& attr);
 void cls_rgw_obj_check_attrs_prefix(librados::ObjectOperation& o, const std::string& prefix, bool fail_if_exist);
@@ -459,7 +469,8 @@ void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
 			    const std::string& delimiter,
                             uint32_t num_entries,
                             bool list_versions,
-                            rgw_cls_list_ret* result);
+                            rgw_cls_list_ret* result,
+                            const std::string& end_key = std::string());
 
 void cls_rgw_bilog_list(librados::ObjectReadOperation& op,
                         const std::string& marker, uint32_t max,
@@ -629,6 +640,14 @@ int cls_rgw_reshard_get(librados::IoCtx& io_ctx, const std::string& oid, cls_rgw
 
 /* resharding attribute on bucket index shard headers */
 void cls_rgw_guard_bucket_resharding(librados::ObjectOperation& op, int ret_err);
+
+/* names of the entries changed on a bucket index shard while resharding */
+void cls_rgw_reshard_log_list(librados::ObjectReadOperation& op,
+                              const std::string& marker, uint32_t max,
+                              cls_rgw_reshard_log_list_ret *pdata,
+                              int *ret = nullptr);
+void cls_rgw_reshard_log_trim(librados::ObjectWriteOperation& op,
+                              const std::list<std::string>& entries);
 // these overloads which call io_ctx.operate() should not be called in the rgw.
 // rgw_rados_operate() should be called after the overloads w/o calls to io_ctx.operate()
 #ifndef CLS_CLIENT_HIDE_IOCTX
@@ -157,6 +157,37 @@ void rgw_cls_obj_complete_op::dump(Formatter *f) const
   encode_json("zones_trace", zones_trace, f);
 }
 
+void rgw_cls_obj_complete_ops_op::generate_test_instances(list<rgw_cls_obj_complete_ops_op*>& o)
+{
+  rgw_cls_obj_complete_ops_op *op = new rgw_cls_obj_complete_ops_op;
+  list<rgw_cls_obj_complete_op*> l;
+  rgw_cls_obj_complete_op::generate_test_instances(l);
+  for (auto i : l) {
+    op->ops.push_back(*i);
+    delete i;
+  }
+  o.push_back(op);
+  o.push_back(new rgw_cls_obj_complete_ops_op);
+}
+
+void rgw_cls_obj_complete_ops_op::dump(Formatter *f) const
+{
+  encode_json("ops", ops, f);
+}
+
+void rgw_cls_obj_complete_ops_ret::generate_test_instances(list<rgw_cls_obj_complete_ops_ret*>& o)
+{
+  rgw_cls_obj_complete_ops_ret *r = new rgw_cls_obj_complete_ops_ret;
+  r->results = {0, -ENOENT};
+  o.push_back(r);
+  o.push_back(new rgw_cls_obj_complete_ops_ret);
+}
+
+void rgw_cls_obj_complete_ops_ret::dump(Formatter *f) const
+{
+  encode_json("results", results, f);
+}
+
 void rgw_cls_link_olh_op::generate_test_instances(list<rgw_cls_link_olh_op*>& o)
 {
   rgw_cls_link_olh_op *op = new rgw_cls_link_olh_op;
@@ -304,6 +335,7 @@ void rgw_cls_list_op::dump(Formatter *f) const
 {
   f->dump_string("start_obj", start_obj.name);
   f->dump_unsigned("num_entries", num_entries);
+  f->dump_string("end_key", end_key);
 }
 
 void rgw_cls_list_ret::generate_test_instances(list<rgw_cls_list_ret*>& o)
@@ -375,6 +407,11 @@ void rgw_cls_bucket_update_stats_op::dump(Formatter *f) const
     s[(int)entry.first] = entry.second;
   }
   encode_json("stats", s, f);
+  map<int, rgw_bucket_category_stats> d;
+  for (auto& entry : dec_stats) {
+    d[(int)entry.first] = entry.second;
+  }
+  encode_json("dec_stats", d, f);
 }
 
 void cls_rgw_bi_log_list_op::dump(Formatter *f) const
@@ -545,3 +582,46 @@ void cls_rgw_get_bucket_resharding_op::generate_test_instances(
 void cls_rgw_get_bucket_resharding_op::dump(Formatter *f) const
 {
 }
+
+void cls_rgw_reshard_log_list_op::generate_test_instances(
+  list<cls_rgw_reshard_log_list_op*>& ls)
+{
+  ls.push_back(new cls_rgw_reshard_log_list_op);
+  ls.push_back(new cls_rgw_reshard_log_list_op);
+  ls.back()->max = 1000;
+  ls.back()->marker = "foo";
+}
+
+void cls_rgw_reshard_log_list_op::dump(Formatter *f) const
+{
+  encode_json("max", max, f);
+  encode_json("marker", marker, f);
+}
+
+void cls_rgw_reshard_log_list_ret::generate_test_instances(
+  list<cls_rgw_reshard_log_list_ret*>& ls)
+{
+  ls.push_back(new cls_rgw_reshard_log_list_ret);
+  ls.push_back(new cls_rgw_reshard_log_list_ret);
+  ls.back()->entries.push_back("foo");
+  ls.back()->is_truncated = true;
+}
+
+void cls_rgw_reshard_log_list_ret::dump(Formatter *f) const
+{
+  encode_json("entries", entries, f);
+  encode_json("is_truncated", is_truncated, f);
+}
+
+void cls_rgw_reshard_log_trim_op::generate_test_instances(
+  list<cls_rgw_reshard_log_trim_op*>& ls)
+{
+  ls.push_back(new cls_rgw_reshard_log_trim_op);
+  ls.push_back(new cls_rgw_reshard_log_trim_op);
+  ls.back()->entries.push_back("foo");
+}
+
+void cls_rgw_reshard_log_trim_op::dump(Formatter *f) const
+{
+  encode_json("entries", entries, f);
+}
@@ -721,7 +721,10 @@ WRITE_CLASS_ENCODER(rgw_bucket_category_stats)
 enum class cls_rgw_reshard_status : uint8_t {
   NOT_RESHARDING  = 0,
   IN_PROGRESS     = 1,
-  DONE            = 2
+  DONE            = 2,
+  // the index shard takes writes and records the names of the entries
+  // they change, for them to be copied again to the new shards
+  IN_LOGRECORD    = 3
 };
 
 inline std::string to_string(const cls_rgw_reshard_status status)
@@ -736,6 +739,9 @@ inline std::string to_string(const cls_rgw_reshard_status status)
   case cls_rgw_reshard_status::DONE:
     return "done";
     break;
+  case cls_rgw_reshard_status::IN_LOGRECORD:
+    return "in-logrecord";
+    break;
   };
   return "Unknown reshard status";
 }
@@ -787,6 +793,9 @@ struct cls_rgw_bucket_instance_entry {
   bool resharding_in_progress() const {
     return reshard_status == RESHARD_STATUS::IN_PROGRESS;
   }
+  bool resharding_in_logrecord() const {
+    return reshard_status == RESHARD_STATUS::IN_LOGRECORD;
+  }
 };
 WRITE_CLASS_ENCODER(cls_rgw_bucket_instance_entry)
 
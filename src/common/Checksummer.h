@@ -6,6 +6,7 @@
 
 #include "include/buffer.h"
 #include "include/byteorder.h"
+#include "include/crc32c.h"
 #include "include/ceph_assert.h"
 
 #include "xxHash/xxhash.h"
@@ -90,6 +91,14 @@ public:
       ) {
       return p.crc32c(len, init_value);
     }
+    static init_value_t calc(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      const char *data
+      ) {
+      return ceph_crc32c(init_value, (const unsigned char*)data, len);
+    }
   };
 
   struct crc32c_16 {
@@ -111,6 +120,14 @@ public:
       ) {
       return p.crc32c(len, init_value) & 0xffff;
     }
+    static init_value_t calc(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      const char *data
+      ) {
+      return ceph_crc32c(init_value, (const unsigned char*)data, len) & 0xffff;
+    }
   };
 
   struct crc32c_8 {
@@ -132,6 +149,14 @@ public:
       ) {
       return p.crc32c(len, init_value) & 0xff;
     }
+    static init_value_t calc(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      const char *data
+      ) {
+      return ceph_crc32c(init_value, (const unsigned char*)data, len) & 0xff;
+    }
   };
 
   struct xxhash32 {
@@ -161,6 +186,15 @@ public:
       }
       return XXH32_digest(state);
     }
+    static init_value_t calc(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      const char *data
+      ) {
+      // the one-shot variant skips the streaming state bookkeeping
+      return XXH32(data, len, init_value);
+    }
   };
 
   struct xxhash64 {
@@ -190,8 +224,29 @@ public:
       }
       return XXH64_digest(state);
     }
+    static init_value_t calc(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      const char *data
+      ) {
+      // the one-shot variant skips the streaming state bookkeeping
+      return XXH64(data, len, init_value);
+    }
   };
 
+  /// number of whole blocks (up to max) available in the current buffer
+  /// segment, those are checksummed straight from memory in one go
+  static size_t contiguous_blocks(
+    const ceph::buffer::list::const_iterator& p,
+    size_t csum_block_size,
+    size_t max) {
+    const char *data;
+    auto q = p;
+    size_t l = q.get_ptr_and_advance(max * csum_block_size, &data);
+    return l / csum_block_size;
+  }
+
   template<class Alg>
   static int calculate(
     size_t csum_block_size,
@@ -225,9 +280,22 @@ public:
     typename Alg::value_t *pv =
       reinterpret_cast<typename Alg::value_t*>(csum_data->c_str());
     pv += offset / csum_block_size;
-    while (blocks--) {
-      *pv = Alg::calc(state, init_value, csum_block_size, p);
-      ++pv;
+    while (blocks) {
+      size_t n = contiguous_blocks(p, csum_block_size, blocks);
+      if (n) {
+	const char *data;
+	p.get_ptr_and_advance(n * csum_block_size, &data);
+	blocks -= n;
+	while (n--) {
+	  *pv = Alg::calc(state, init_value, csum_block_size, data);
+	  data += csum_block_size;
+	  ++pv;
+	}
+      } else {
+	*pv = Alg::calc(state, init_value, csum_block_size, p);
+	++pv;
+	--blocks;
+      }
     }
     Alg::fini(&state);
     return 0;
@@ -253,18 +321,40 @@ public:
       reinterpret_cast<const typename Alg::value_t*>(csum_data.c_str());
     pv += offset / csum_block_size;
     size_t pos = offset;
-    while (length > 0) {
-      typename Alg::init_value_t v = Alg::calc(state, -1, csum_block_size, p);
-      if (*pv != v) {
-	if (bad_csum) {
-	  *bad_csum = v;
+    size_t blocks = length / csum_block_size;
+    while (blocks) {
+      size_t n = contiguous_blocks(p, csum_block_size, blocks);
+      if (n) {
+	const char *data;
+	p.get_ptr_and_advance(n * csum_block_size, &data);
+	blocks -= n;
+	while (n--) {
+	  typename Alg::init_value_t v =
+	    Alg::calc(state, -1, csum_block_size, data);
+	  if (*pv != v) {
+	    if (bad_csum) {
+	      *bad_csum = v;
+	    }
+	    Alg::fini(&state);
+	    return pos;
+	  }
+	  data += csum_block_size;
+	  ++pv;
+	  pos += csum_block_size;
+	}
+      } else {
+	typename Alg::init_value_t v = Alg::calc(state, -1, csum_block_size, p);
+	if (*pv != v) {
+	  if (bad_csum) {
+	    *bad_csum = v;
+	  }
+	  Alg::fini(&state);
+	  return pos;
 	}
-	Alg::fini(&state);
-	return pos;
+	++pv;
+	pos += csum_block_size;
+	--blocks;
       }
-      ++pv;
-      pos += csum_block_size;
-      length -= csum_block_size;
     }
     Alg::fini(&state);
     return -1;  // no errors
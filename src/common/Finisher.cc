@@ -94,3 +94,34 @@ void *Finisher::finisher_thread_entry()
   return 0;
 }
 
+
+ShardedFinisher::ShardedFinisher(CephContext *cct, const std::string& name,
+				 const std::string& tn, unsigned n)
+{
+  ceph_assert(n > 0);
+  for (unsigned i = 0; i < n; ++i) {
+    finishers.emplace_back(new Finisher(cct, name + "-" + std::to_string(i),
+					tn + "-" + std::to_string(i)));
+  }
+}
+
+void ShardedFinisher::start()
+{
+  for (auto& f : finishers) {
+    f->start();
+  }
+}
+
+void ShardedFinisher::stop()
+{
+  for (auto& f : finishers) {
+    f->stop();
+  }
+}
+
+void ShardedFinisher::wait_for_empty()
+{
+  for (auto& f : finishers) {
+    f->wait_for_empty();
+  }
+}
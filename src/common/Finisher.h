@@ -167,6 +167,40 @@ class Finisher {
   }
 };
 
+/** @brief Several Finishers, each with a thread of its own.
+ * Contexts queued with the same key complete in the order they were
+ * queued, on the same thread; those with different keys may complete in
+ * parallel.
+ */
+class ShardedFinisher {
+  std::vector<std::unique_ptr<Finisher>> finishers;
+
+public:
+  /// Construct n named Finishers, logging their queue lengths as
+  /// finisher-<name>-<i>, with thread names <tn>-<i>.
+  ShardedFinisher(CephContext *cct, const std::string& name,
+		  const std::string& tn, unsigned n);
+
+  Finisher* get_finisher(uint64_t key) {
+    // keys are often pointers, mix the bits above their alignment in
+    key ^= key >> 17;
+    key *= 0x9e3779b97f4a7c15ull;
+    return finishers[(key >> 32) % finishers.size()].get();
+  }
+
+  void queue(uint64_t key, Context *c, int r = 0) {
+    get_finisher(key)->queue(c, r);
+  }
+
+  unsigned size() const {
+    return finishers.size();
+  }
+
+  void start();
+  void stop();
+  void wait_for_empty();
+};
+
 /// Context that is completed asynchronously on the supplied finisher.
 class C_OnFinisher : public Context {
   Context *con;
@@ -1,6 +1,8 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <cmath>
+
 #include "include/scope_guard.h"
 
 #include "common/Throttle.h"
@@ -38,6 +40,8 @@ enum {
   l_throttle_put,
   l_throttle_put_sum,
   l_throttle_wait,
+  l_throttle_get_locked,
+  l_throttle_put_locked,
   l_throttle_last,
 };
 
@@ -65,6 +69,10 @@ Throttle::Throttle(CephContext *cct, const std::string& n, int64_t m,
     b.add_u64_counter(l_throttle_put, "put", "Puts");
     b.add_u64_counter(l_throttle_put_sum, "put_sum", "Put data");
     b.add_time_avg(l_throttle_wait, "wait", "Waiting latency");
+    b.add_u64_counter(l_throttle_get_locked, "get_locked",
+		      "Gets that took the lock, as they were close to max or behind waiters");
+    b.add_u64_counter(l_throttle_put_locked, "put_locked",
+		      "Puts that took the lock to wake up waiters");
 
     logger = { b.create_perf_counters(), cct };
     cct->get_perfcounters_collection()->add(logger.get());
@@ -97,8 +105,10 @@ bool Throttle::_wait(int64_t c, std::unique_lock<std::mutex>& l)
   if (_should_wait(c) || !conds.empty()) { // always wait behind other waiters.
     {
       auto cv = conds.emplace(conds.end());
+      ++num_waiters;
       auto w = make_scope_guard([this, cv]() {
 	  conds.erase(cv);
+	  --num_waiters;
 	});
       waited = true;
       ldout(cct, 2) << "_wait waiting..." << dendl;
@@ -119,6 +129,21 @@ bool Throttle::_wait(int64_t c, std::unique_lock<std::mutex>& l)
   return waited;
 }
 
+bool Throttle::_try_get_fast(int64_t c)
+{
+  // queue up behind waiters, and let them wake each other up
+  if (num_waiters) {
+    return false;
+  }
+  int64_t cur = count;
+  do {
+    if (_should_wait(c, cur)) {
+      return false;
+    }
+  } while (!count.compare_exchange_weak(cur, cur + c));
+  return true;
+}
+
 bool Throttle::wait(int64_t m)
 {
   if (0 == max && 0 == m) {
@@ -163,8 +188,11 @@ bool Throttle::get(int64_t c, int64_t m)
     logger->inc(l_throttle_get_started);
   }
   bool waited = false;
-  {
+  if (m || !_try_get_fast(c)) {
     std::unique_lock l(lock);
+    if (logger) {
+      logger->inc(l_throttle_get_locked);
+    }
     if (m) {
       ceph_assert(m > 0);
       _reset_max(m);
@@ -191,7 +219,20 @@ bool Throttle::get_or_fail(int64_t c)
   }
 
   assert (c >= 0);
+  if (_try_get_fast(c)) {
+    ldout(cct, 10) << "get_or_fail " << c << " success" << dendl;
+    if (logger) {
+      logger->inc(l_throttle_get_or_fail_success);
+      logger->inc(l_throttle_get);
+      logger->inc(l_throttle_get_sum, c);
+      logger->set(l_throttle_val, count);
+    }
+    return true;
+  }
   std::lock_guard l(lock);
+  if (logger) {
+    logger->inc(l_throttle_get_locked);
+  }
   if (_should_wait(c) || !conds.empty()) {
     ldout(cct, 10) << "get_or_fail " << c << " failed" << dendl;
     if (logger) {
@@ -222,13 +263,20 @@ int64_t Throttle::put(int64_t c)
   ceph_assert(c >= 0);
   ldout(cct, 10) << "put " << c << " (" << count.load() << " -> "
 		 << (count.load()-c) << ")" << dendl;
-  std::lock_guard l(lock);
   if (c) {
-    if (!conds.empty())
-      conds.front().notify_one();
     // if count goes negative, we failed somewhere!
-    ceph_assert(count >= c);
-    count -= c;
+    auto was = count.fetch_sub(c);
+    ceph_assert(was >= c);
+    // a waiter counts itself before it looks at count, so that either it
+    // sees what we put or we see it
+    if (num_waiters) {
+      std::lock_guard l(lock);
+      if (!conds.empty())
+	conds.front().notify_one();
+      if (logger) {
+	logger->inc(l_throttle_put_locked);
+      }
+    }
     if (logger) {
       logger->inc(l_throttle_put);
       logger->inc(l_throttle_put_sum, c);
@@ -260,6 +308,8 @@ enum {
   l_backoff_throttle_put,
   l_backoff_throttle_put_sum,
   l_backoff_throttle_wait,
+  l_backoff_throttle_get_locked,
+  l_backoff_throttle_put_locked,
   l_backoff_throttle_last,
 };
 
@@ -284,6 +334,10 @@ BackoffThrottle::BackoffThrottle(CephContext *cct, const std::string& n,
     b.add_u64_counter(l_backoff_throttle_put, "put", "Puts");
     b.add_u64_counter(l_backoff_throttle_put_sum, "put_sum", "Put data");
     b.add_time_avg(l_backoff_throttle_wait, "wait", "Waiting latency");
+    b.add_u64_counter(l_backoff_throttle_get_locked, "get_locked",
+		      "Gets that took the lock, as they were past low_threshold or behind waiters");
+    b.add_u64_counter(l_backoff_throttle_put_locked, "put_locked",
+		      "Puts that took the lock to wake up waiters");
 
     logger = { b.create_perf_counters(), cct };
     cct->get_perfcounters_collection()->add(logger.get());
@@ -395,6 +449,7 @@ bool BackoffThrottle::set_params(
     high_threshold = 1;
     s1 = 0;
   }
+  no_delay_below = std::ceil(low_threshold * max);
 
   _kick_waiters();
   return true;
@@ -419,12 +474,34 @@ ceph::timespan BackoffThrottle::_get_delay(uint64_t c) const
 
 ceph::timespan BackoffThrottle::get(uint64_t c)
 {
+  if (logger) {
+    logger->inc(l_backoff_throttle_get);
+    logger->inc(l_backoff_throttle_get_sum, c);
+  }
+
+  // faster path: no delay, no waiters, nothing to lock for
+  if (!num_waiters) {
+    uint64_t cur = current;
+    while (true) {
+      uint64_t m = max;
+      if (m != 0 &&
+	  (cur >= no_delay_below || (cur != 0 && cur + c > m))) {
+	break;
+      }
+      if (current.compare_exchange_weak(cur, cur + c)) {
+	if (logger) {
+	  logger->set(l_backoff_throttle_val, cur + c);
+	}
+	return ceph::make_timespan(0);
+      }
+    }
+  }
+
   locker l(lock);
   auto delay = _get_delay(c);
 
   if (logger) {
-    logger->inc(l_backoff_throttle_get);
-    logger->inc(l_backoff_throttle_get_sum, c);
+    logger->inc(l_backoff_throttle_get_locked);
   }
 
   // fast path
@@ -471,6 +548,7 @@ ceph::timespan BackoffThrottle::get(uint64_t c)
     }
   }
   waiters.pop_front();
+  --num_waiters;
   _kick_waiters();
 
   current += c;
@@ -487,43 +565,47 @@ ceph::timespan BackoffThrottle::get(uint64_t c)
 
 uint64_t BackoffThrottle::put(uint64_t c)
 {
-  locker l(lock);
-  ceph_assert(current >= c);
-  current -= c;
-  _kick_waiters();
+  auto was = current.fetch_sub(c);
+  ceph_assert(was >= c);
+  // a waiter counts itself before it looks at current, so that either it
+  // sees what we put or we see it
+  if (num_waiters) {
+    locker l(lock);
+    _kick_waiters();
+    if (logger) {
+      logger->inc(l_backoff_throttle_put_locked);
+    }
+  }
 
   if (logger) {
     logger->inc(l_backoff_throttle_put);
     logger->inc(l_backoff_throttle_put_sum, c);
-    logger->set(l_backoff_throttle_val, current);
+    logger->set(l_backoff_throttle_val, was - c);
   }
 
-  return current;
+  return was - c;
 }
 
 uint64_t BackoffThrottle::take(uint64_t c)
 {
-  locker l(lock);
-  current += c;
+  auto now = current += c;
 
   if (logger) {
     logger->inc(l_backoff_throttle_take);
     logger->inc(l_backoff_throttle_take_sum, c);
-    logger->set(l_backoff_throttle_val, current);
+    logger->set(l_backoff_throttle_val, now);
   }
 
-  return current;
+  return now;
 }
 
 uint64_t BackoffThrottle::get_current()
 {
-  locker l(lock);
   return current;
 }
 
 uint64_t BackoffThrottle::get_max()
 {
-  locker l(lock);
   return max;
 }
 
@@ -32,6 +32,9 @@ class Throttle final : public ThrottleInterface {
   std::atomic<int64_t> count = { 0 }, max = { 0 };
   std::mutex lock;
   std::list<std::condition_variable> conds;
+  /// conds.size(), for get() and put() to tell whether they can do
+  /// without the lock
+  std::atomic<size_t> num_waiters = { 0 };
   const bool use_perf;
 
 public:
@@ -41,8 +44,10 @@ public:
 private:
   void _reset_max(int64_t m);
   bool _should_wait(int64_t c) const {
+    return _should_wait(c, count);
+  }
+  bool _should_wait(int64_t c, int64_t cur) const {
     int64_t m = max;
-    int64_t cur = count;
     return
       m &&
       ((c <= m && cur + c > m) || // normally stay under max
@@ -50,6 +55,8 @@ private:
   }
 
   bool _wait(int64_t c, std::unique_lock<std::mutex>& l);
+  /// add c to count if that does not have to wait, without taking the lock
+  bool _try_get_fast(int64_t c);
 
 public:
   /**
@@ -167,10 +174,15 @@ class BackoffThrottle {
   /// pointers into conds
   std::list<std::condition_variable*> waiters;
 
+  /// waiters.size(), for get() and put() to tell whether they can do
+  /// without the lock
+  std::atomic<size_t> num_waiters = { 0 };
+
   std::list<std::condition_variable*>::iterator _push_waiter() {
     unsigned next = next_cond++;
     if (next_cond == conds.size())
       next_cond = 0;
+    ++num_waiters;
     return waiters.insert(waiters.end(), &(conds[next]));
   }
 
@@ -192,8 +204,10 @@ class BackoffThrottle {
   double s1 = 0; ///< (m - e)/(1 - h), 1 != h, 0 otherwise
 
   /// max
-  uint64_t max = 0;
-  uint64_t current = 0;
+  std::atomic<uint64_t> max = { 0 };
+  std::atomic<uint64_t> current = { 0 };
+  /// ceil(low_threshold * max): get() is not delayed below it
+  std::atomic<uint64_t> no_delay_below = { 0 };
 
   ceph::timespan _get_delay(uint64_t c) const;
 
@@ -11,6 +11,7 @@
  */
 
 #include "TrackedOp.h"
+#include "include/random.h"
 
 #define dout_context cct
 #define dout_subsys ceph_subsys_optracker
@@ -267,6 +268,10 @@ bool OpTracker::register_inflight_op(TrackedOp *i)
   uint32_t shard_index = current_seq % num_optracker_shards;
   ShardedTrackingData* sdata = sharded_in_flight_list[shard_index];
   ceph_assert(NULL != sdata);
+  if (uint32_t rate = sample_rate; rate > 1) {
+    i->events_tracked =
+      ceph::util::generate_random_number<uint32_t>(0, rate - 1) == 0;
+  }
   {
     std::lock_guard locker(sdata->ops_in_flight_lock_sharded);
     sdata->ops_in_flight_sharded.push_back(*i);
@@ -459,6 +464,8 @@ void TrackedOp::mark_event(std::string_view event, utime_t stamp)
 {
   if (!state)
     return;
+  if (!events_tracked && !_maybe_track_events(stamp))
+    return;
 
   {
     std::lock_guard l(lock);
@@ -472,6 +479,20 @@ void TrackedOp::mark_event(std::string_view event, utime_t stamp)
   _event_marked();
 }
 
+bool TrackedOp::_maybe_track_events(utime_t stamp)
+{
+  if (stamp - initiated_at < tracker->get_track_events_after())
+    return false;
+  std::lock_guard l(lock);
+  if (!events_tracked) {
+    // the events up to now were not recorded, start from the beginning
+    events.reserve(OPTRACKER_PREALLOC_EVENTS);
+    events.emplace_back(initiated_at, "initiated");
+    events_tracked = true;
+  }
+  return true;
+}
+
 void TrackedOp::dump(utime_t now, Formatter *f) const
 {
   // Ignore if still in the constructor
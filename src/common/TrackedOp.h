@@ -106,7 +106,12 @@ class OpTracker {
   uint32_t num_optracker_shards;
   float complaint_time;
   int log_threshold;
+  uint32_t slow_op_threshold = 0;
   std::atomic<bool> tracking_enabled;
+  /// track the events of one in this many ops from the start
+  std::atomic<uint32_t> sample_rate = {1};
+  /// and those of the others once they are this old
+  std::atomic<double> track_events_after = {0};
   ceph::shared_mutex lock = ceph::make_shared_mutex("OpTracker::lock");
 
 public:
@@ -116,12 +121,15 @@ public:
   void set_complaint_and_threshold(float time, int threshold) {
     complaint_time = time;
     log_threshold = threshold;
+    track_events_after = std::min<double>(complaint_time, slow_op_threshold);
   }
   void set_history_size_and_duration(uint32_t new_size, uint32_t new_duration) {
     history.set_size_and_duration(new_size, new_duration);
   }
   void set_history_slow_op_size_and_threshold(uint32_t new_size, uint32_t new_threshold) {
     history.set_slow_op_size_and_threshold(new_size, new_threshold);
+    slow_op_threshold = new_threshold;
+    track_events_after = std::min<double>(complaint_time, slow_op_threshold);
   }
   bool is_tracking() const {
     return tracking_enabled;
@@ -129,6 +137,18 @@ public:
   void set_tracking(bool enable) {
     tracking_enabled = enable;
   }
+  /**
+   * Record the events of one in every rate ops, chosen at random, and keep
+   * them in the history.  The other ops are still in flight for the slow op
+   * checks and dumps, but record no events, and do not make the history,
+   * unless they last long enough to be slow ops.
+   */
+  void set_sample_rate(uint32_t rate) {
+    sample_rate = std::max(rate, 1u);
+  }
+  double get_track_events_after() const {
+    return track_events_after;
+  }
   bool dump_ops_in_flight(ceph::Formatter *f, bool print_only_blocked = false, std::set<std::string> filters = {""});
   bool dump_historic_ops(ceph::Formatter *f, bool by_duration = false, std::set<std::string> filters = {""});
   bool dump_historic_slow_ops(ceph::Formatter *f, std::set<std::string> filters = {""});
@@ -258,6 +278,8 @@ protected:
     STATE_HISTORY
   };
   std::atomic<int> state = {STATE_UNTRACKED};
+  /// false for an op out of the sample until it gets old
+  std::atomic<bool> events_tracked = {true};
 
   mutable std::string desc_str;   ///< protected by lock
   mutable const char *desc = nullptr;  ///< readable without lock
@@ -266,9 +288,7 @@ protected:
   TrackedOp(OpTracker *_tracker, const utime_t& initiated) :
     tracker(_tracker),
     initiated_at(initiated)
-  {
-    events.reserve(OPTRACKER_PREALLOC_EVENTS);
-  }
+  {}
 
   /// output any type-specific data you want to get when dump() is called
   virtual void _dump(ceph::Formatter *f) const {}
@@ -306,7 +326,7 @@ public:
 	mark_event("done");
 	tracker->unregister_inflight_op(this);
 	_unregistered();
-	if (!tracker->is_tracking()) {
+	if (!tracker->is_tracking() || !events_tracked) {
 	  delete this;
 	} else {
 	  state = TrackedOp::STATE_HISTORY;
@@ -360,6 +380,9 @@ public:
   }
 
   void mark_event(std::string_view event, utime_t stamp=ceph_clock_now());
+private:
+  bool _maybe_track_events(utime_t stamp);
+public:
 
   void mark_nowarn() {
     warn_interval_multiplier = 0;
@@ -374,7 +397,10 @@ public:
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
-      events.emplace_back(initiated_at, "initiated");
+      if (events_tracked) {
+	events.reserve(OPTRACKER_PREALLOC_EVENTS);
+	events.emplace_back(initiated_at, "initiated");
+      }
       state = STATE_LIVE;
     }
   }
@@ -67,6 +67,9 @@ int get_device_by_path(const char *path, char* partition, char* device,
 #include <linux/fs.h>
 #include <linux/kdev_t.h>
 #include <blkid/blkid.h>
+#ifdef HAVE_LINUX_BLKZONED_H
+#include <linux/blkzoned.h>
+#endif
 
 #include <set>
 
@@ -222,6 +225,81 @@ bool BlkDev::is_rotational() const
   return get_int_property("queue/rotational") > 0;
 }
 
+bool BlkDev::is_host_managed_zoned() const
+{
+  char buf[32] = {0};
+  return get_string_property("queue/zoned", buf, sizeof(buf)) == 0 &&
+    strcmp(buf, "host-managed") == 0;
+}
+
+int64_t BlkDev::get_zone_size() const
+{
+  int64_t sectors = get_int_property("queue/chunk_sectors");
+  if (sectors < 0)
+    return sectors;
+  return sectors * 512;
+}
+
+int BlkDev::scheduler(char *sched, size_t max) const
+{
+  return get_string_property("queue/scheduler", sched, max);
+}
+
+int BlkDev::report_zones(std::vector<zone_t> *zones) const
+{
+#ifdef HAVE_LINUX_BLKZONED_H
+  static constexpr unsigned batch = 4096;
+  std::vector<char> buf(sizeof(blk_zone_report) + batch * sizeof(blk_zone));
+  auto report = reinterpret_cast<blk_zone_report*>(buf.data());
+  int64_t size = 0;
+  if (int r = get_size(&size); r < 0)
+    return r;
+  zones->clear();
+  uint64_t sector = 0;
+  while (sector * 512 < (uint64_t)size) {
+    memset(buf.data(), 0, buf.size());
+    report->sector = sector;
+    report->nr_zones = batch;
+    if (::ioctl(fd, BLKREPORTZONE, report) < 0)
+      return -errno;
+    if (report->nr_zones == 0)
+      break;
+    for (unsigned i = 0; i < report->nr_zones; ++i) {
+      const blk_zone& z = report->zones[i];
+      zone_t t;
+      t.start = z.start * 512;
+      t.length = z.len * 512;
+      t.conventional = z.type == BLK_ZONE_TYPE_CONVENTIONAL;
+      if (t.conventional) {
+	t.written = 0;
+      } else if (z.cond == BLK_ZONE_COND_FULL) {
+	// the write pointer of a full zone is undefined
+	t.written = t.length;
+      } else {
+	t.written = (z.wp - z.start) * 512;
+      }
+      zones->push_back(t);
+      sector = z.start + z.len;
+    }
+  }
+  return 0;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
+
+int BlkDev::reset_zone(uint64_t offset, uint64_t length) const
+{
+#ifdef HAVE_LINUX_BLKZONED_H
+  blk_zone_range range = {offset / 512, length / 512};
+  if (::ioctl(fd, BLKRESETZONE, &range) < 0)
+    return -errno;
+  return 0;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
+
 int BlkDev::get_numa_node(int *node) const
 {
   int numa = get_int_property("device/device/numa_node");
@@ -861,6 +939,31 @@ int BlkDev::get_numa_node(int *node) const
   return -1;
 }
 
+bool BlkDev::is_host_managed_zoned() const
+{
+  return false;
+}
+
+int64_t BlkDev::get_zone_size() const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::scheduler(char *sched, size_t max) const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::report_zones(std::vector<zone_t> *zones) const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::reset_zone(uint64_t offset, uint64_t length) const
+{
+  return -EOPNOTSUPP;
+}
+
 int BlkDev::model(char *model, size_t max) const
 {
   return -EOPNOTSUPP;
@@ -1015,6 +1118,31 @@ int BlkDev::get_numa_node(int *node) const
   return 0;
 }
 
+bool BlkDev::is_host_managed_zoned() const
+{
+  return false;
+}
+
+int64_t BlkDev::get_zone_size() const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::scheduler(char *sched, size_t max) const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::report_zones(std::vector<zone_t> *zones) const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::reset_zone(uint64_t offset, uint64_t length) const
+{
+  return -EOPNOTSUPP;
+}
+
 int BlkDev::model(char *model, size_t max) const
 {
   struct diocgattr_arg arg;
@@ -1185,6 +1313,31 @@ bool BlkDev::is_rotational(const char *devname) const
   return false;
 }
 
+bool BlkDev::is_host_managed_zoned() const
+{
+  return false;
+}
+
+int64_t BlkDev::get_zone_size() const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::scheduler(char *sched, size_t max) const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::report_zones(std::vector<zone_t> *zones) const
+{
+  return -EOPNOTSUPP;
+}
+
+int BlkDev::reset_zone(uint64_t offset, uint64_t length) const
+{
+  return -EOPNOTSUPP;
+}
+
 int BlkDev::model(char *model, size_t max) const
 {
   return -EOPNOTSUPP;
@@ -7,6 +7,7 @@
 #include <set>
 #include <map>
 #include <string>
+#include <vector>
 #include "json_spirit/json_spirit_value.h"
 
 extern int get_device_by_path(const char *path, char* partition, char* device, size_t max);
@@ -54,9 +55,22 @@ public:
   int get_size(int64_t *psize) const;
   int get_devid(dev_t *id) const;
   int partition(char* partition, size_t max) const;
+  struct zone_t {
+    uint64_t start = 0;          ///< bytes
+    uint64_t length = 0;
+    uint64_t written = 0;        ///< bytes before the write pointer
+    bool conventional = false;   ///< takes random writes
+  };
+  int report_zones(std::vector<zone_t> *zones) const;
+  int reset_zone(uint64_t offset, uint64_t length) const;
   // from a device (e.g., "sdb")
   bool support_discard() const;
   bool is_rotational() const;
+  /// only accepts sequential writes within each zone
+  bool is_host_managed_zoned() const;
+  int64_t get_zone_size() const;
+  /// the io schedulers, the one in use in brackets
+  int scheduler(char *sched, size_t max) const;
   int get_numa_node(int *node) const;
   int dev(char *dev, size_t max) const;
   int vendor(char *vendor, size_t max) const;
@@ -168,28 +168,187 @@ static ceph::spinlock debug_lock;
   };
 
 #ifndef __CYGWIN__
+namespace {
+  /*
+   * Page aligned buffers of the sizes BlueStore and the messengers use
+   * most are kept on per-thread free lists instead of going back to the
+   * allocator.  A buffer freed by another thread than the one that
+   * allocated it is queued back to the owner, which takes the queue over
+   * once its own list runs dry.  Buffers sitting on the lists are counted
+   * in mempool buffer_pool.
+   */
+  class aligned_pool_t {
+  public:
+    static constexpr unsigned num_classes = 2;
+
+  private:
+    static constexpr unsigned class_len[num_classes] = { 4096, 65536 };
+    static constexpr unsigned class_max[num_classes] = { 256, 32 };
+
+    struct free_list_t {
+      std::vector<char*> local;
+      ceph::spinlock lock;
+      std::vector<char*> returned;  ///< freed by other threads, under lock
+    };
+    free_list_t lists[num_classes];
+    /// the owning thread and the buffers handed out
+    std::atomic<unsigned> nref = { 1 };
+    bool orphaned = false;  ///< the owning thread is gone, under every lock
+
+    static void account(int n, unsigned c) {
+      mempool::get_pool(mempool::mempool_buffer_pool).adjust_count(
+	n, n * (int)class_len[c]);
+    }
+    void unref() {
+      if (--nref == 0) {
+	delete this;
+      }
+    }
+
+    aligned_pool_t() {
+      for (unsigned c = 0; c < num_classes; ++c) {
+	lists[c].local.reserve(class_max[c]);
+	lists[c].returned.reserve(class_max[c]);
+      }
+    }
+    ~aligned_pool_t() = default;
+
+    struct holder_t {
+      aligned_pool_t* pool = new aligned_pool_t;
+      ~holder_t() {
+	pool->orphan();
+      }
+    };
+
+    void orphan() {
+      for (unsigned c = 0; c < num_classes; ++c) {
+	auto& l = lists[c];
+	std::lock_guard g{l.lock};
+	orphaned = true;
+	l.local.insert(l.local.end(), l.returned.begin(), l.returned.end());
+	l.returned.clear();
+	account(-(int)l.local.size(), c);
+	for (auto p : l.local) {
+	  ::free(p);
+	}
+	l.local.clear();
+      }
+      unref();
+    }
+
+  public:
+    /// size class of a buffer, or -1 if it is not pooled
+    static int get_class(unsigned len, unsigned align) {
+#ifdef WITH_SEASTAR
+      return -1;
+#else
+      if (align > CEPH_PAGE_SIZE) {
+	return -1;
+      }
+      for (unsigned c = 0; c < num_classes; ++c) {
+	if (len == class_len[c]) {
+	  return c;
+	}
+      }
+      return -1;
+#endif
+    }
+
+    static aligned_pool_t* get_thread_pool() {
+      static thread_local holder_t holder;
+      return holder.pool;
+    }
+
+    /// a buffer of class c, or nullptr if there is none on the lists
+    char* get(unsigned c) {
+      auto& l = lists[c];
+      if (l.local.empty()) {
+	std::lock_guard g{l.lock};
+	l.local.swap(l.returned);
+      }
+      if (l.local.empty()) {
+	return nullptr;
+      }
+      char* p = l.local.back();
+      l.local.pop_back();
+      account(-1, c);
+      nref++;
+      return p;
+    }
+
+    /// take back a buffer that put() will later return
+    void add_ref() {
+      nref++;
+    }
+
+    /// return a buffer handed out by get() or accounted by add_ref()
+    void put(unsigned c, char* p) {
+      auto& l = lists[c];
+      if (this == get_thread_pool()) {
+	if (!orphaned && l.local.size() < class_max[c]) {
+	  l.local.push_back(p);
+	  account(1, c);
+	  p = nullptr;
+	}
+      } else {
+	std::lock_guard g{l.lock};
+	if (!orphaned && l.returned.size() < class_max[c]) {
+	  l.returned.push_back(p);
+	  account(1, c);
+	  p = nullptr;
+	}
+      }
+      if (p) {
+	::free(p);
+      }
+      unref();
+    }
+  };
+}
+
   class buffer::raw_posix_aligned : public buffer::raw {
     unsigned align;
+    int pool_class;
+    aligned_pool_t* pool = nullptr;
   public:
     MEMPOOL_CLASS_HELPERS();
 
     raw_posix_aligned(unsigned l, unsigned _align) : raw(l) {
       align = _align;
       ceph_assert((align >= sizeof(void *)) && (align & (align - 1)) == 0);
+      unsigned alloc_align = align;
+      pool_class = aligned_pool_t::get_class(len, align);
+      if (pool_class >= 0) {
+	pool = aligned_pool_t::get_thread_pool();
+	data = pool->get(pool_class);
+	if (data) {
+	  return;
+	}
+	// allocate it page aligned, whatever was asked for, so that it can
+	// be handed out for any request of its class
+	alloc_align = CEPH_PAGE_SIZE;
+      }
 #ifdef DARWIN
       data = (char *) valloc(len);
 #else
-      int r = ::posix_memalign((void**)(void*)&data, align, len);
+      int r = ::posix_memalign((void**)(void*)&data, alloc_align, len);
       if (r)
 	throw bad_alloc();
 #endif /* DARWIN */
       if (!data)
 	throw bad_alloc();
+      if (pool) {
+	pool->add_ref();
+      }
       bdout << "raw_posix_aligned " << this << " alloc " << (void *)data
 	    << " l=" << l << ", align=" << align << bendl;
     }
     ~raw_posix_aligned() override {
-      ::free(data);
+      if (pool) {
+	pool->put(pool_class, data);
+      } else {
+	::free(data);
+      }
       bdout << "raw_posix_aligned " << this << " free " << (void *)data << bendl;
     }
     raw* clone_empty() override {
@@ -576,6 +735,12 @@ static ceph::spinlock debug_lock;
     return mem_is_zero(c_str(), _len);
   }
 
+  void buffer::ptr::set_crc32c(uint32_t seed, uint32_t crc) const
+  {
+    ceph_assert(_raw);
+    _raw->set_crc(make_pair(_off, _off + _len), make_pair(seed, crc));
+  }
+
   unsigned buffer::ptr::append(char c)
   {
     ceph_assert(_raw);
@@ -1952,12 +2117,16 @@ __u32 buffer::list::crc32c(__u32 crc) const
     if (node.length()) {
       raw* const r = node._raw;
       pair<size_t, size_t> ofs(node.offset(), node.offset() + node.length());
+      pair<size_t, size_t> cached;
       pair<uint32_t, uint32_t> ccrc;
-      if (r->get_crc(ofs, &ccrc)) {
+      if (r->get_crc_within(ofs, &cached, &ccrc)) {
+	uint32_t base = crc;
+	auto data = (const unsigned char*)node.c_str();
+	// the part before the cached range, if the node covers more
+	crc = ceph_crc32c(crc, data, cached.first - ofs.first);
 	if (ccrc.first == crc) {
 	  // got it already
 	  crc = ccrc.second;
-	  cache_hits++;
 	} else {
 	  /* If we have cached crc32c(buf, v) for initial value v,
 	   * we can convert this to a different initial value v' by:
@@ -1967,7 +2136,18 @@ __u32 buffer::list::crc32c(__u32 crc) const
 	   * http://crcutil.googlecode.com/files/crc-doc.1.0.pdf
 	   * note, u for our crc32c implementation is 0
 	   */
-	  crc = ccrc.second ^ ceph_crc32c(ccrc.first ^ crc, NULL, node.length());
+	  crc = ceph_crc32c_combine(ccrc.first ^ crc, ccrc.second,
+				    cached.second - cached.first);
+	}
+	// and the part after it
+	crc = ceph_crc32c(crc, data + (cached.second - ofs.first),
+			  ofs.second - cached.second);
+	if (cached != ofs) {
+	  r->set_crc(ofs, make_pair(base, crc));
+	  cache_adjusts++;
+	} else if (ccrc.first == base) {
+	  cache_hits++;
+	} else {
 	  cache_adjusts++;
 	}
       } else {
@@ -2137,6 +2317,58 @@ buffer::ptr_node::create_hypercombined(ceph::unique_leakable_ptr<buffer::raw> r)
     new ptr_node(std::move(r)));
 }
 
+namespace {
+#ifndef WITH_SEASTAR
+struct ptr_node_stash_t {
+  static constexpr unsigned max_nodes = 256;
+  void* nodes[max_nodes];
+  unsigned count = 0;
+
+  ~ptr_node_stash_t();
+};
+
+// ptr_node_stash is gone once this thread's thread_locals are destroyed;
+// lists destroyed after that free their nodes directly.
+thread_local bool ptr_node_stash_gone = false;
+thread_local ptr_node_stash_t ptr_node_stash;
+
+ptr_node_stash_t::~ptr_node_stash_t()
+{
+  ptr_node_stash_gone = true;
+  while (count) {
+    ::operator delete(nodes[--count]);
+  }
+}
+#endif
+}
+
+void* buffer::ptr_node::operator new(size_t size)
+{
+#ifndef WITH_SEASTAR
+  if (likely(!ptr_node_stash_gone) && size == sizeof(ptr_node)) {
+    auto& stash = ptr_node_stash;
+    if (stash.count) {
+      return stash.nodes[--stash.count];
+    }
+  }
+#endif
+  return ::operator new(size);
+}
+
+void buffer::ptr_node::operator delete(void* p)
+{
+#ifndef WITH_SEASTAR
+  if (likely(!ptr_node_stash_gone)) {
+    auto& stash = ptr_node_stash;
+    if (stash.count < stash.max_nodes) {
+      stash.nodes[stash.count++] = p;
+      return;
+    }
+  }
+#endif
+  ::operator delete(p);
+}
+
 buffer::ptr_node* buffer::ptr_node::cloner::operator()(
   const buffer::ptr_node& clone_this)
 {
@@ -43,6 +43,7 @@
 #include "common/config.h"
 #include "common/config_obs.h"
 #include "common/PluginRegistry.h"
+#include "common/stack_profiler.h"
 #include "common/valgrind.h"
 #include "include/spinlock.h"
 
@@ -159,6 +160,7 @@ public:
   const char** get_tracked_conf_keys() const override {
     static const char *KEYS[] = {
       "mempool_debug",
+      "mempool_sample_shift",
       NULL
     };
     return KEYS;
@@ -170,6 +172,10 @@ public:
     if (changed.count("mempool_debug")) {
       mempool::set_debug_mode(cct->_conf->mempool_debug);
     }
+    if (changed.count("mempool_sample_shift")) {
+      mempool::set_sample_shift(
+	conf.get_val<uint64_t>("mempool_sample_shift"));
+    }
   }
 
   // AdminSocketHook
@@ -226,6 +232,16 @@ public:
 
       // refresh the perf coutners
       _cct->_refresh_perf_values();
+
+      // and publish them to whoever maps perf_shm_path
+      int r = _cct->get_perfcounters_collection()->publish_shm(
+	_cct->_conf.get_val<std::string>("perf_shm_path"));
+      if (r < 0 && r != _publish_shm_r) {
+	lderr(_cct) << "failed to publish perf counters to "
+		    << _cct->_conf.get_val<std::string>("perf_shm_path")
+		    << ": " << cpp_strerror(r) << dendl;
+      }
+      _publish_shm_r = r;
     }
     return NULL;
   }
@@ -249,6 +265,8 @@ private:
   ceph::condition_variable _cond;
   bool _reopen_logs;
   bool _exit_thread;
+  /// result of the last publish_shm(), to complain once only
+  int _publish_shm_r = 0;
   CephContext *_cct;
 };
 }
@@ -274,6 +292,7 @@ public:
       "log_file",
       "log_max_new",
       "log_max_recent",
+      "log_thread_ring_size",
       "log_to_file",
       "log_to_syslog",
       "err_to_syslog",
@@ -331,6 +350,11 @@ public:
       log->set_max_recent(conf->log_max_recent);
     }
 
+    if (changed.count("log_thread_ring_size")) {
+      log->set_thread_ring_size(
+	conf.get_val<uint64_t>("log_thread_ring_size"));
+    }
+
     // graylog
     if (changed.count("log_to_graylog") || changed.count("err_to_graylog")) {
       int l = conf->log_to_graylog ? 99 : (conf->err_to_graylog ? -1 : -2);
@@ -519,6 +543,17 @@ int CephContext::_do_command(
   else if (command == "perf histogram schema") {
     _perf_counters_collection->dump_formatted_histograms(f, true);
   }
+  else if (command == "profile stacks") {
+    int64_t seconds = 10;
+    int64_t frequency = 99;
+    cmd_getval(cmdmap, "seconds", seconds);
+    cmd_getval(cmdmap, "frequency", frequency);
+    r = ceph::common::profile_stacks(this, std::chrono::seconds(seconds),
+				     frequency, f);
+    if (r < 0) {
+      ss << "unable to sample any thread: " << cpp_strerror(r);
+    }
+  }
   else if (command == "perf reset") {
     std::string var;
     std::string section(command);
@@ -704,6 +739,7 @@ CephContext::CephContext(uint32_t module_type_,
   _admin_socket->register_command("2", _admin_hook, "");
   _admin_socket->register_command("perf schema", _admin_hook, "dump perfcounters schema");
   _admin_socket->register_command("perf histogram schema", _admin_hook, "dump perf histogram schema");
+  _admin_socket->register_command("profile stacks name=seconds,type=CephInt,req=false,range=1|300 name=frequency,type=CephInt,req=false,range=1|1000", _admin_hook, "sample the stacks of all threads for <seconds> (default 10) at <frequency> Hz (default 99), folded for flame graphs");
   _admin_socket->register_command("perf reset name=var,type=CephString", _admin_hook, "perf reset <name>: perf reset all or one perfcounter name");
   _admin_socket->register_command("config show", _admin_hook, "dump current config settings");
   _admin_socket->register_command("config help name=var,type=CephString,req=false", _admin_hook, "get config setting schema and descriptions");
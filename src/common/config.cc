@@ -271,6 +271,59 @@ void md_config_t::set_val_default(ConfigValues& values,
   ceph_assert(r >= 0);
 }
 
+void md_config_t::_set_mon_val(CephContext *cct,
+    ConfigValues& values,
+    const ConfigTracker& tracker,
+    const string& name,
+    const string& val,
+    config_callback config_cb)
+{
+  if (config_cb) {
+    if (config_cb(name, val)) {
+      ldout(cct, 4) << __func__ << " callback consumed " << name << dendl;
+      return;
+    }
+    ldout(cct, 4) << __func__ << " callback ignored " << name << dendl;
+  }
+  const Option *o = find_option(name);
+  if (!o) {
+    ldout(cct,10) << __func__ << " " << name << " = " << val
+		  << " (unrecognized option)" << dendl;
+    return;
+  }
+  if (o->has_flag(Option::FLAG_NO_MON_UPDATE)) {
+    ignored_mon_values.emplace(name, val);
+    return;
+  }
+  std::string err;
+  int r = _set_val(values, tracker, val, *o, CONF_MON, &err);
+  if (r < 0) {
+    ldout(cct, 4) << __func__ << " failed to set " << name << " = "
+		  << val << ": " << err << dendl;
+    ignored_mon_values.emplace(name, val);
+  } else if (r == ConfigValues::SET_NO_CHANGE ||
+	     r == ConfigValues::SET_NO_EFFECT) {
+    ldout(cct,20) << __func__ << " " << name << " = " << val
+		  << " (no change)" << dendl;
+  } else if (r == ConfigValues::SET_HAVE_EFFECT) {
+    ldout(cct,10) << __func__ << " " << name << " = " << val << dendl;
+  } else {
+    ceph_abort();
+  }
+}
+
+void md_config_t::_rm_mon_val(CephContext *cct,
+    ConfigValues& values,
+    const string& name)
+{
+  ldout(cct,10) << __func__ << " " << name << " cleared" << dendl;
+  if (values.rm_val(name, CONF_MON) == ConfigValues::SET_HAVE_EFFECT) {
+    // propagate to the legacy field or the subsys, and notify the observers
+    const Option *o = find_option(name);
+    _refresh(values, *o);
+  }
+}
+
 int md_config_t::set_mon_vals(CephContext *cct,
     ConfigValues& values,
     const ConfigTracker& tracker,
@@ -284,38 +337,7 @@ int md_config_t::set_mon_vals(CephContext *cct,
   }
 
   for (auto& i : kv) {
-    if (config_cb) {
-      if (config_cb(i.first, i.second)) {
-	ldout(cct, 4) << __func__ << " callback consumed " << i.first << dendl;
-	continue;
-      }
-      ldout(cct, 4) << __func__ << " callback ignored " << i.first << dendl;
-    }
-    const Option *o = find_option(i.first);
-    if (!o) {
-      ldout(cct,10) << __func__ << " " << i.first << " = " << i.second
-		    << " (unrecognized option)" << dendl;
-      continue;
-    }
-    if (o->has_flag(Option::FLAG_NO_MON_UPDATE)) {
-      ignored_mon_values.emplace(i);
-      continue;
-    }
-    std::string err;
-    int r = _set_val(values, tracker, i.second, *o, CONF_MON, &err);
-    if (r < 0) {
-      ldout(cct, 4) << __func__ << " failed to set " << i.first << " = "
-		    << i.second << ": " << err << dendl;
-      ignored_mon_values.emplace(i);
-    } else if (r == ConfigValues::SET_NO_CHANGE ||
-	       r == ConfigValues::SET_NO_EFFECT) {
-      ldout(cct,20) << __func__ << " " << i.first << " = " << i.second
-		    << " (no change)" << dendl;
-    } else if (r == ConfigValues::SET_HAVE_EFFECT) {
-      ldout(cct,10) << __func__ << " " << i.first << " = " << i.second << dendl;
-    } else {
-      ceph_abort();
-    }
+    _set_mon_val(cct, values, tracker, i.first, i.second, config_cb);
   }
   values.for_each([&] (auto name, auto configs) {
     auto config = configs.find(CONF_MON);
@@ -340,6 +362,33 @@ int md_config_t::set_mon_vals(CephContext *cct,
   return 0;
 }
 
+int md_config_t::update_mon_vals(CephContext *cct,
+    ConfigValues& values,
+    const ConfigTracker& tracker,
+    const map<string,string,less<>>& changed,
+    const std::set<string>& removed,
+    config_callback config_cb)
+{
+  if (!config_cb) {
+    ldout(cct, 4) << __func__ << " no callback set" << dendl;
+  }
+
+  // only the options of the delta are touched; their legacy fields are
+  // refreshed by _set_val() and _refresh()
+  for (auto& name : removed) {
+    ignored_mon_values.erase(name);
+    if (schema.count(name)) {
+      _rm_mon_val(cct, values, name);
+    }
+  }
+  for (auto& i : changed) {
+    ignored_mon_values.erase(i.first);
+    _set_mon_val(cct, values, tracker, i.first, i.second, config_cb);
+  }
+  values_bl.clear();
+  return 0;
+}
+
 int md_config_t::parse_config_files(ConfigValues& values,
 				    const ConfigTracker& tracker,
 				    const char *conf_files_str,
@@ -16,6 +16,7 @@
 #define CEPH_CONFIG_H
 
 #include <map>
+#include <set>
 #include <boost/container/small_vector.hpp>
 #include "common/ConfUtils.h"
 #include "common/code_environment.h"
@@ -154,6 +155,14 @@ public:
 		   const std::map<std::string,std::string, std::less<>>& kv,
 		   config_callback config_cb);
 
+  /// Apply a delta of the values from mon: the changed and the removed ones
+  int update_mon_vals(CephContext *cct,
+		      ConfigValues& values,
+		      const ConfigTracker& tracker,
+		      const std::map<std::string,std::string, std::less<>>& changed,
+		      const std::set<std::string>& removed,
+		      config_callback config_cb);
+
   // Called by the Ceph daemons to make configuration changes at runtime
   int injectargs(ConfigValues& values,
 		 const ConfigTracker& tracker,
@@ -262,6 +271,16 @@ private:
 
   void _refresh(ConfigValues& values, const Option& opt);
 
+  void _set_mon_val(CephContext *cct,
+		    ConfigValues& values,
+		    const ConfigTracker& tracker,
+		    const std::string& name,
+		    const std::string& val,
+		    config_callback config_cb);
+  void _rm_mon_val(CephContext *cct,
+		   ConfigValues& values,
+		   const std::string& name);
+
   void _show_config(const ConfigValues& values,
 		    std::ostream *out, ceph::Formatter *f) const;
 
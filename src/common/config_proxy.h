@@ -295,6 +295,21 @@ public:
     call_observers(locker, rev_obs);
     return ret;
   }
+  int update_mon_vals(CephContext *cct,
+		      const std::map<std::string,std::string,std::less<>>& changed,
+		      const std::set<std::string>& removed,
+		      md_config_t::config_callback config_cb) {
+    std::unique_lock locker(lock);
+    int ret = config.update_mon_vals(cct, values, obs_mgr, changed, removed,
+				     config_cb);
+
+    rev_obs_map_t rev_obs;
+    _gather_changes(values.changed, &rev_obs, nullptr);
+    values.changed.clear();
+
+    call_observers(locker, rev_obs);
+    return ret;
+  }
   int injectargs(const std::string &s, std::ostream *oss) {
     std::unique_lock locker(lock);
     int ret = config.injectargs(values, obs_mgr, s, oss);
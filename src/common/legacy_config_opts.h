@@ -955,7 +955,9 @@ OPTION(bluestore_min_alloc_size_ssd, OPT_U32)
 OPTION(bluestore_max_alloc_size, OPT_U32)
 OPTION(bluestore_prefer_deferred_size, OPT_U32)
 OPTION(bluestore_prefer_deferred_size_hdd, OPT_U32)
+OPTION(bluestore_defrag_interval, OPT_DOUBLE)
 OPTION(bluestore_prefer_deferred_size_ssd, OPT_U32)
+OPTION(bluestore_prefer_deferred_size_pmem, OPT_U32)
 OPTION(bluestore_compression_mode, OPT_STR)  // force|aggressive|passive|none
 OPTION(bluestore_compression_algorithm, OPT_STR)
 OPTION(bluestore_compression_min_blob_size, OPT_U32)
@@ -980,6 +982,7 @@ OPTION(bluestore_gc_enable_total_threshold, OPT_INT)
 OPTION(bluestore_max_blob_size, OPT_U32)
 OPTION(bluestore_max_blob_size_hdd, OPT_U32)
 OPTION(bluestore_max_blob_size_ssd, OPT_U32)
+OPTION(bluestore_adaptive_write_sizing, OPT_BOOL)
 /*
  * Require the net gain of compression at least to be at this ratio,
  * otherwise we don't compress.
@@ -994,6 +997,9 @@ OPTION(bluestore_extent_map_inline_shard_prealloc_size, OPT_U32)
 OPTION(bluestore_cache_trim_interval, OPT_DOUBLE)
 OPTION(bluestore_cache_trim_max_skip_pinned, OPT_U32) // skip this many onodes pinned in cache before we give up
 OPTION(bluestore_cache_type, OPT_STR)   // lru, 2q
+OPTION(bluestore_cache_unload_cold_extents, OPT_BOOL)
+OPTION(bluestore_cache_onode_admission, OPT_BOOL)
+OPTION(bluestore_onode_prefetch, OPT_BOOL)
 OPTION(bluestore_2q_cache_kin_ratio, OPT_DOUBLE)    // kin page slot size / max page slot size
 OPTION(bluestore_2q_cache_kout_ratio, OPT_DOUBLE)   // number of kout page slot / total number of page slot
 OPTION(bluestore_cache_size, OPT_U64)
@@ -1004,6 +1010,7 @@ OPTION(bluestore_cache_kv_ratio, OPT_DOUBLE)
 OPTION(bluestore_alloc_stats_dump_interval, OPT_DOUBLE)
 OPTION(bluestore_kvbackend, OPT_STR)
 OPTION(bluestore_allocator, OPT_STR)     // stupid | bitmap
+OPTION(bluestore_allocator_snapshot, OPT_BOOL)
 OPTION(bluestore_freelist_blocks_per_key, OPT_INT)
 OPTION(bluestore_bitmapallocator_blocks_per_zone, OPT_INT) // must be power of 2 aligned, e.g., 512, 1024, 2048...
 OPTION(bluestore_bitmapallocator_span_size, OPT_INT) // must be power of 2 aligned, e.g., 512, 1024, 2048...
@@ -1018,8 +1025,10 @@ OPTION(bluestore_fsck_on_umount_deep, OPT_BOOL)
 OPTION(bluestore_fsck_on_mkfs, OPT_BOOL)
 OPTION(bluestore_fsck_on_mkfs_deep, OPT_BOOL)
 OPTION(bluestore_sync_submit_transaction, OPT_BOOL) // submit kv txn in queueing thread (not kv_sync_thread)
+OPTION(bluestore_kv_sync_shards, OPT_U64)
 OPTION(bluestore_fsck_read_bytes_cap, OPT_U64)
 OPTION(bluestore_fsck_quick_fix_threads, OPT_INT)
+OPTION(bluestore_fsck_deep_threads, OPT_INT)
 OPTION(bluestore_throttle_bytes, OPT_U64)
 OPTION(bluestore_throttle_deferred_bytes, OPT_U64)
 OPTION(bluestore_throttle_cost_per_io_hdd, OPT_U64)
@@ -1028,6 +1037,7 @@ OPTION(bluestore_throttle_cost_per_io, OPT_U64)
 OPTION(bluestore_deferred_batch_ops, OPT_U64)
 OPTION(bluestore_deferred_batch_ops_hdd, OPT_U64)
 OPTION(bluestore_deferred_batch_ops_ssd, OPT_U64)
+OPTION(bluestore_deferred_submit_sorted, OPT_BOOL)
 OPTION(bluestore_nid_prealloc, OPT_INT)
 OPTION(bluestore_blobid_prealloc, OPT_U64)
 OPTION(bluestore_clone_cow, OPT_BOOL)  // do copy-on-write for clones
@@ -1062,6 +1072,7 @@ OPTION(bluestore_debug_enforce_settings, OPT_STR)
 OPTION(bluestore_volume_selection_policy, OPT_STR)
 OPTION(bluestore_volume_selection_reserved_factor, OPT_DOUBLE)
 OPTION(bluestore_volume_selection_reserved, OPT_INT)
+OPTION(bluestore_volume_selection_heat_threshold, OPT_U64)
 
 OPTION(kstore_max_ops, OPT_U64)
 OPTION(kstore_max_bytes, OPT_U64)
@@ -12,6 +12,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "include/mempool.h"
 #include "include/demangle.h"
 
@@ -19,6 +21,9 @@
 // default to debug_mode off
 bool mempool::debug_mode = false;
 
+// default to accounting for every allocation
+unsigned mempool::sample_shift = 0;
+
 // --------------------------------------------------------------
 
 mempool::pool_t& mempool::get_pool(mempool::pool_index_t ix)
@@ -61,6 +66,11 @@ void mempool::set_debug_mode(bool d)
   debug_mode = d;
 }
 
+void mempool::set_sample_shift(unsigned s)
+{
+  sample_shift = std::min(s, 16u);
+}
+
 // --------------------------------------------------------------
 // pool_t
 
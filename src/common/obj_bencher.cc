@@ -19,6 +19,7 @@
 #include <pthread.h>
 #include "common/ceph_mutex.h"
 #include "common/Clock.h"
+#include "include/intarith.h"
 #include "obj_bencher.h"
 
 const std::string BENCH_LASTRUN_METADATA = "benchmark_last_metadata";
@@ -74,6 +75,42 @@ static void sanitize_object_contents (bench_data *data, size_t length) {
   memset(data->object_contents, 'z', length);
 }
 
+void bench_latency_histogram::add(double seconds)
+{
+  uint64_t us = seconds > 0 ? seconds * 1000000 : 0;
+  unsigned i;
+  if (us < SUB_BUCKETS) {
+    i = us;
+  } else {
+    unsigned shift = cbits(us) - SUB_BUCKET_BITS - 1;
+    i = (shift + 1) * SUB_BUCKETS + ((us >> shift) & (SUB_BUCKETS - 1));
+  }
+  ++counts[i];
+  ++total;
+}
+
+double bench_latency_histogram::percentile(double p) const
+{
+  if (!total) {
+    return 0;
+  }
+  uint64_t want = std::max<uint64_t>(1, std::ceil(total * p / 100));
+  uint64_t seen = 0;
+  unsigned i = 0;
+  for (; i < NUM_BUCKETS - 1; ++i) {
+    seen += counts[i];
+    if (seen >= want) {
+      break;
+    }
+  }
+  // the upper bound of the bucket
+  unsigned group = i / SUB_BUCKETS;
+  unsigned sub = i % SUB_BUCKETS;
+  uint64_t us = group == 0 ? sub + 1 :
+    (uint64_t)(SUB_BUCKETS + sub + 1) << (group - 1);
+  return us / 1000000.0;
+}
+
 ostream& ObjBencher::out(ostream& os, utime_t& t)
 {
   if (show_time)
@@ -285,6 +322,7 @@ int ObjBencher::aio_bench(
   data.max_latency = 0;
   data.avg_latency = 0;
   data.latency_diff_sum = 0;
+  data.latency_hist.clear();
   data.object_contents = contentsChars;
   lock.unlock();
 
@@ -501,6 +539,7 @@ int ObjBencher::write_bench(int secondsToRun,
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if( data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -598,7 +637,11 @@ int ObjBencher::write_bench(int secondsToRun,
        << "Average Latency(s):     " << data.avg_latency << std::endl
        << "Stddev Latency(s):      " << latency_stddev << std::endl
        << "Max latency(s):         " << data.max_latency << std::endl
-       << "Min latency(s):         " << data.min_latency << std::endl;
+       << "Min latency(s):         " << data.min_latency << std::endl
+       << "Latency p50(s):         " << data.latency_hist.percentile(50) << std::endl
+       << "Latency p90(s):         " << data.latency_hist.percentile(90) << std::endl
+       << "Latency p99(s):         " << data.latency_hist.percentile(99) << std::endl
+       << "Latency p99.9(s):       " << data.latency_hist.percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_writes_made", "%d", data.finished);
@@ -616,6 +659,10 @@ int ObjBencher::write_bench(int secondsToRun,
     formatter->dump_format("stddev_latency", "%f", latency_stddev);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", data.latency_hist.percentile(50));
+    formatter->dump_format("latency_p90", "%f", data.latency_hist.percentile(90));
+    formatter->dump_format("latency_p99", "%f", data.latency_hist.percentile(99));
+    formatter->dump_format("latency_p999", "%f", data.latency_hist.percentile(99.9));
   }
   //write object size/number data for read benchmarks
   encode(data.object_size, b_write);
@@ -762,6 +809,7 @@ int ObjBencher::seq_read_bench(
       goto ERR;
     }
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -820,7 +868,11 @@ int ObjBencher::seq_read_bench(
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
-       << "Min latency(s):       " << data.min_latency << std::endl;
+       << "Min latency(s):       " << data.min_latency << std::endl
+       << "Latency p50(s):       " << data.latency_hist.percentile(50) << std::endl
+       << "Latency p90(s):       " << data.latency_hist.percentile(90) << std::endl
+       << "Latency p99(s):       " << data.latency_hist.percentile(99) << std::endl
+       << "Latency p99.9(s):     " << data.latency_hist.percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -834,6 +886,10 @@ int ObjBencher::seq_read_bench(
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", data.latency_hist.percentile(50));
+    formatter->dump_format("latency_p90", "%f", data.latency_hist.percentile(90));
+    formatter->dump_format("latency_p99", "%f", data.latency_hist.percentile(99));
+    formatter->dump_format("latency_p999", "%f", data.latency_hist.percentile(99.9));
   }
 
   completions_done();
@@ -957,6 +1013,7 @@ int ObjBencher::rand_read_bench(
     }
 
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency.count());
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -1033,7 +1090,11 @@ int ObjBencher::rand_read_bench(
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
-       << "Min latency(s):       " << data.min_latency << std::endl;
+       << "Min latency(s):       " << data.min_latency << std::endl
+       << "Latency p50(s):       " << data.latency_hist.percentile(50) << std::endl
+       << "Latency p90(s):       " << data.latency_hist.percentile(90) << std::endl
+       << "Latency p99(s):       " << data.latency_hist.percentile(99) << std::endl
+       << "Latency p99.9(s):     " << data.latency_hist.percentile(99.9) << std::endl;
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -1047,6 +1108,10 @@ int ObjBencher::rand_read_bench(
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->dump_format("latency_p50", "%f", data.latency_hist.percentile(50));
+    formatter->dump_format("latency_p90", "%f", data.latency_hist.percentile(90));
+    formatter->dump_format("latency_p99", "%f", data.latency_hist.percentile(99));
+    formatter->dump_format("latency_p999", "%f", data.latency_hist.percentile(99.9));
   }
   completions_done();
 
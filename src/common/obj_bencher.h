@@ -18,6 +18,7 @@
 #include "common/ceph_context.h"
 #include "common/Formatter.h"
 #include "ceph_time.h"
+#include <array>
 #include <cfloat>
 
 using ceph::mono_clock;
@@ -35,6 +36,25 @@ struct bench_interval_data {
   double iops_diff_sum = 0;
 };
 
+// latencies in buckets of a bounded relative error: each power of two of
+// microseconds is split in 16 linear sub-buckets
+struct bench_latency_histogram {
+  static constexpr unsigned SUB_BUCKET_BITS = 4;
+  static constexpr unsigned SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr unsigned NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  std::array<uint64_t, NUM_BUCKETS> counts{};
+  uint64_t total = 0;
+
+  void clear() {
+    counts.fill(0);
+    total = 0;
+  }
+  void add(double seconds);
+  // the latency in seconds under which p percent of the ops completed
+  double percentile(double p) const;
+};
+
 struct bench_data {
   bool done; //is the benchmark is done
   uint64_t object_size; //the size of the objects
@@ -49,6 +69,7 @@ struct bench_data {
   double avg_latency;
   struct bench_interval_data idata; // data that is updated by time intervals and not by events
   double latency_diff_sum;
+  bench_latency_histogram latency_hist;
   std::chrono::duration<double> cur_latency; //latency of last completed transaction - in seconds by default
   mono_time start_time; //start time for benchmark - use the monotonic clock as we'll measure the passage of time
   char *object_contents; //pointer to the contents written to each object
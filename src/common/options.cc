@@ -583,6 +583,12 @@ std::vector<Option> get_global_options() {
     .set_description("max unwritten log entries to allow before waiting to flush to the log")
     .add_see_also("log_max_recent"),
 
+    Option("log_thread_ring_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("log entries each thread queues without locking, 0 to lock for each")
+    .set_long_description("If non-zero, each thread queues the log entries it submits in a ring of this many entries of its own, without taking the lock shared with the other threads, and falls back to taking it when the ring is full.  This makes raising the debug levels cheaper on busy daemons, at the cost of about 1KB per entry and thread that logs.  Only threads that did not log yet pick up a change.")
+    .add_see_also("log_max_new"),
+
     Option("log_max_recent", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(500)
     .set_daemon_default(10000)
@@ -795,6 +801,13 @@ std::vector<Option> get_global_options() {
     .set_default(1)
     .set_description("Zstd compression level to use"),
 
+    Option("compressor_zstd_dictionary", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("Path to a trained zstd dictionary to compress with")
+    .set_long_description("A dictionary trained on samples of the data (e.g. with zstd --train) improves the compression of small blobs a lot. The data compressed with it can only be decompressed by a daemon loading the same dictionary, so it must not be removed or changed while such data exists.")
+    .set_flag(Option::FLAG_STARTUP)
+    .add_see_also("compressor_zstd_level"),
+
     Option("qat_compressor_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Enable Intel QAT acceleration support for compression if available"),
@@ -808,6 +821,13 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_NO_MON_UPDATE)
     .set_description(""),
 
+    Option("mempool_sample_shift", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(0, 16)
+    .set_flag(Option::FLAG_NO_MON_UPDATE)
+    .set_description("account for only 1 in 2^N allocations of the mempool containers")
+    .set_long_description("The allocations picked by their address are accounted for 2^N times each, which makes the mempool stats of the containers estimates, and their allocations cheaper.  0 accounts for every one."),
+
     Option("thp", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_flag(Option::FLAG_STARTUP)
@@ -869,6 +889,12 @@ std::vector<Option> get_global_options() {
     .set_description("Enable internal performance metrics")
     .set_long_description("If enabled, collect and expose internal health metrics"),
 
+    Option("perf_shm_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("file to publish the perf counters into, e.g. /dev/shm/$cluster-$name.perf")
+    .set_long_description("If set, the perf counters are written every heartbeat_interval seconds into this file, in a binary format that other processes on the host can map and read without going through the admin socket.  It should be on tmpfs.")
+    .add_see_also("heartbeat_interval"),
+
     Option("ms_type", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_flag(Option::FLAG_STARTUP)
     .set_default("async+posix")
@@ -956,6 +982,22 @@ std::vector<Option> get_global_options() {
     .set_default(4_K)
     .set_description("Maximum amount of data to prefetch out of the socket receive buffer"),
 
+    Option("ms_tcp_zerocopy_min_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Send data of at least this size with MSG_ZEROCOPY, 0 to always copy")
+    .set_long_description("The kernel pins the pages being sent instead of "
+			  "copying them and the buffers are kept until it reports "
+			  "them done; this only pays off for large sends. Applies "
+			  "to the posix stack on connections made after a change."),
+
+    Option("ms_async_send_batch_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(128_K)
+    .set_description("Gather queued messages up to this size into one send")
+    .set_long_description("When more messages are queued behind the one being "
+			  "written, it is only handed to the socket together with "
+			  "them once this much is pending. 0 sends each message "
+			  "on its own."),
+
     Option("ms_initial_backoff", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.2)
     .set_description("Initial backoff after a network error is detected (seconds)"),
@@ -997,6 +1039,17 @@ std::vector<Option> get_global_options() {
     .set_default(100_M)
     .set_description("Limit messages that are read off the network but still being processed"),
 
+    Option("ms_dispatch_throttle_batch_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(256_K)
+    .set_description("Take the dispatch throttle in batches of this size per thread")
+    .set_long_description("A thread reading messages takes this much of the "
+			  "dispatch throttle at a time and holds up to twice as "
+			  "much, so that most messages are accounted for without "
+			  "taking the throttle lock. The batch is capped to a 32th "
+			  "of ms_dispatch_throttle_bytes. 0 takes the throttle for "
+			  "every message.")
+    .add_see_also("ms_dispatch_throttle_bytes"),
+
     Option("ms_bind_ipv4", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("Bind servers to IPv4 address(es)")
@@ -1130,6 +1183,25 @@ std::vector<Option> get_global_options() {
     .set_min_max(1, 24)
     .set_description("Threadpool size for AsyncMessenger (ms_type=async)"),
 
+    Option("ms_async_sender_crc", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Compute the crc of message data in the thread sending it")
+    .set_long_description("In crc mode the frame crcs of the data are computed "
+			  "when a message is queued, by the thread queueing it, "
+			  "rather than by the messenger worker building the frame, "
+			  "which then finds them cached.")
+    .add_see_also("ms_async_op_threads"),
+
+    Option("ms_async_worker_load_slack", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(100)
+    .set_min_max(0, 1000)
+    .set_description("How much busier than the least busy worker, in permille of its time, a worker may be and still get new connections")
+    .set_long_description("New connections go to the worker with the fewest "
+			  "connections among those whose share of time spent "
+			  "processing events is at most this much above the "
+			  "least busy one. 1000 ignores the load.")
+    .add_see_also("ms_async_op_threads"),
+
     Option("ms_async_max_op_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description("Maximum threadpool size of AsyncMessenger")
@@ -1147,6 +1219,13 @@ std::vector<Option> get_global_options() {
     .set_default(128_K)
     .set_description(""),
 
+    Option("ms_async_rdma_max_inline_data", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_description("Post sends up to this size inline in the work request")
+    .set_long_description("Small sends, such as acks and keepalives, are copied "
+			  "into the send queue rather than read by the HCA from "
+			  "registered memory. 0 disables inline sends."),
+
     Option("ms_async_rdma_send_buffers", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1_K)
     .set_description(""),
@@ -1241,6 +1320,11 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("ms_dpdk_tso", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Use TCP segmentation offload if the NIC supports it")
+    .add_see_also("ms_dpdk_lro"),
+
     Option("ms_dpdk_hw_flow_control", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -2065,6 +2149,12 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_CLUSTER_CREATE)
     .set_description("do not set any monmap features for new mon clusters"),
 
+    Option("mon_store_group_commit_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .add_service("mon")
+    .set_description("Max number of queued transactions committed together")
+    .set_long_description("Transactions queued on the mon store while an earlier write is syncing are committed as a single write with a single sync, up to this many at a time.  1 commits each transaction on its own."),
+
     Option("mon_inject_transaction_delay_max", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(10.0)
     .add_service("mon")
@@ -2187,6 +2277,12 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description(""),
 
+    Option("paxos_begin_overlap_local_write", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .add_service("mon")
+    .set_description("Send a new proposal to the peons before the leader writes it locally")
+    .set_long_description("The leader's write of the proposed value then overlaps with the peons' writes instead of preceding them.  The leader still finishes its own write before it handles any accept."),
+
     Option("paxos_kill_at", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
     .add_service("mon")
@@ -2358,6 +2454,38 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("objecter_balance_reads_by_latency", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Send balanced reads to the replica answering fastest")
+    .set_long_description("Reads flagged to be balanced across replicas go to the OSD of the acting set with the lowest moving average of read latency seen by this client, instead of a random one. A replica that cannot serve the read yet sends the client back to the primary.")
+    .add_see_also("objecter_read_latency_explore_ratio"),
+
+    Option("objecter_ec_direct_read", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Read erasure coded objects straight from their shards")
+    .set_long_description("Plain reads of objects in erasure coded pools fetch the chunks from the OSDs holding the data shards and are decoded by the client, instead of being gathered by the primary and forwarded. If a data shard is unavailable the client reads enough of the other shards to decode. Reads the shards cannot serve, e.g. because they raced with a write, are resent to the primary."),
+
+    Option("objecter_read_latency_explore_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.05)
+    .set_min_max(0.0, 1.0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Fraction of balanced reads sent to a random replica to refresh latency estimates")
+    .add_see_also("objecter_balance_reads_by_latency"),
+
+    Option("objecter_op_trace_sample_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(0.0, 1.0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Fraction of ops that collect per-stage latencies")
+    .set_long_description("Sampled ops ask the OSD to return how long they spent before dispatch, in the op queue and in execution, and the client adds the time before sending and on the network. The averages are the op_trace_* objecter perf counters, which are reported to the manager. OSDs that do not know about the request reply without the OSD side, and the op is not counted."),
+
+    Option("objecter_crush_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(65536)
+    .set_description("Number of raw CRUSH mappings kept across osdmap epochs")
+    .set_long_description("Placement targets are recomputed after every osdmap change, although most CRUSH results stay the same. The client keeps results until the CRUSH map changes or an OSD weight change may affect the rule. 0 disables the cache. Takes effect with the next full map."),
+
     Option("objecter_debug_inject_relock_delay", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_description(""),
@@ -2402,6 +2530,13 @@ std::vector<Option> get_global_options() {
     .set_description("Maximum number of PGs we can attempt to unmap or upmap "
                      "for a specific overfull or underfull osd per iteration "),
 
+    Option("osd_calc_pg_upmaps_max_time", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Maximum seconds to spend on one upmap optimization pass (0 for no limit)")
+    .set_long_description("The changes found until then are returned, and the next pass continues from them."),
+
     Option("osd_numa_prefer_iface", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_flag(Option::FLAG_STARTUP)
@@ -2710,6 +2845,41 @@ std::vector<Option> get_global_options() {
     .set_default(".ceph-internal")
     .set_description(""),
 
+    Option("osd_read_cache_admission", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Only let reads of hot objects populate the object store cache")
+    .set_long_description("Primaries track the objects read recently in bloom filter HitSets. Reads of objects hot enough are hinted to be cached, reads of the others not to be, so that one-off and scanning reads don't evict the hot data.")
+    .add_see_also("osd_read_cache_min_temperature")
+    .add_see_also("bluestore_default_buffered_read"),
+
+    Option("osd_read_cache_hit_set_period", Option::TYPE_SECS, Option::LEVEL_ADVANCED)
+    .set_default(1_min)
+    .set_description("Period covered by each read tracking HitSet")
+    .add_see_also("osd_read_cache_admission"),
+
+    Option("osd_read_cache_hit_set_count", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Number of read tracking HitSets kept per PG")
+    .add_see_also("osd_read_cache_admission"),
+
+    Option("osd_read_cache_hit_set_fpp", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.05)
+    .set_description("False positive rate of the read tracking HitSets over all of them")
+    .add_see_also("osd_read_cache_admission"),
+
+    Option("osd_read_cache_hit_set_decay_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(20)
+    .set_min_max(0, 100)
+    .set_description("Percentage by which a read weighs less with each period it is older")
+    .add_see_also("osd_read_cache_min_temperature"),
+
+    Option("osd_read_cache_min_temperature", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000000)
+    .set_description("Temperature an object needs for its reads to be cached")
+    .set_long_description("A read earlier in the current period adds 1000000 to the temperature, reads in older periods add less as set by osd_read_cache_hit_set_decay_rate. The default caches objects read before in the current period or in the two before it.")
+    .add_see_also("osd_read_cache_admission"),
+
     Option("osd_tier_promote_max_objects_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(25)
     .set_description(""),
@@ -2835,6 +3005,20 @@ std::vector<Option> get_global_options() {
     .set_description("")
     .add_see_also("osd_op_num_threads_per_shard"),
 
+    Option("osd_op_steal_max_per_shard", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Maximum idle op threads of other shards working on one shard's queue, 0 to disable")
+    .set_long_description("PGs are pinned to a shard, so a few busy PGs hashing to the same shard leave other shards' threads idle. Idle threads take items from a backlogged shard, a shard queueing an item behind others wakes one of them; ops of a PG still run in order.")
+    .add_see_also("osd_op_num_shards"),
+
+    Option("osd_op_run_to_completion", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Have the messenger thread that receives an op run it")
+    .set_long_description("The messenger thread queues the op to its shard as usual, then processes an item of that shard itself instead of waking a shard thread, saving the handoff on low latency devices. The items still go through the shard's queue and pg slots, so the ops of a PG stay in order. Meant for OSDs on fast NVMe devices with few enough clients that the messenger threads are not the bottleneck.")
+    .add_see_also("osd_op_num_shards"),
+
     Option("osd_op_num_shards", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_flag(Option::FLAG_STARTUP)
@@ -2933,6 +3117,26 @@ std::vector<Option> get_global_options() {
     .set_description("mclock anticipation timeout in seconds")
     .set_long_description("the amount of time that mclock waits until the unused resource is forfeited"),
 
+    Option("osd_mclock_cost_per_io", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Cost of a single io in bytes for mclock, 0 to follow the object store's measurements")
+    .set_long_description("An op of N bytes costs 1 + N / osd_mclock_cost_per_io ios against the reservations and limits of its class. With 0 the object store's estimate is used; BlueStore fits it from the latencies of its reads and writes by size and starts out with bluestore_throttle_cost_per_io.")
+    .add_see_also({"osd_op_queue", "bluestore_throttle_cost_per_io"}),
+
+    Option("osd_repop_batch_max_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Maximum writes to one object sent to replicas together, 0 or 1 to send each on its own")
+    .set_long_description("While a replicated pg has writes in flight, further writes to the same object are held back and go out in one transaction and one replication message when one of those commits or the limits are reached. Each client op still completes on its own.")
+    .add_see_also("osd_repop_batch_max_bytes"),
+
+    Option("osd_repop_batch_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_M)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Send held back writes once they add up to this many bytes")
+    .add_see_also("osd_repop_batch_max_ops"),
+
     Option("osd_ignore_stale_divergent_priors", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -2941,6 +3145,11 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_ec_partial_reads", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Read only the data shards holding a client read")
+    .set_long_description("A read within part of a stripe is served from the data shards holding it instead of from k shards, falling back to decoding from other shards when they are unavailable."),
+
     // Only use clone_overlap for recovery if there are fewer than
     // osd_recover_clone_overlap_limit entries in the overlap set
     Option("osd_recover_clone_overlap_limit", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
@@ -2961,6 +3170,11 @@ std::vector<Option> get_global_options() {
     .set_default(512)
     .set_description(""),
 
+    Option("osd_backfill_scan_prefetch", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Have backfill targets scan their next interval while the current one is backfilled")
+    .add_see_also("osd_backfill_scan_max"),
+
     Option("osd_op_thread_timeout", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(15)
     .set_description(""),
@@ -3003,6 +3217,12 @@ std::vector<Option> get_global_options() {
     .set_default(2)
     .set_description("Time in seconds to sleep before next snap trim when data is on HDD and journal is on SSD"),
 
+    Option("osd_snap_trim_bytes_per_sec", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Throttle snap trimming of a PG to this many bytes of clone data removed per second (0 to sleep a fixed time between trims instead)")
+    .add_see_also("osd_snap_trim_sleep")
+    .add_see_also("osd_pg_max_concurrent_snap_trims"),
+
     Option("osd_scrub_invalid_stats", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -3024,6 +3244,12 @@ std::vector<Option> get_global_options() {
     .set_default(20)
     .set_description(""),
 
+    Option("osd_heartbeat_phi_threshold", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Report a heartbeat peer as failed when the phi accrual suspicion level exceeds this value (0 to use osd_heartbeat_grace)")
+    .set_long_description("The phi of a peer is -log10 of the probability of going that long without a ping reply, given the intervals between its recent replies. A peer is judged by its phi once 10 replies have been seen, and by osd_heartbeat_grace before that. The monitors still require osd_heartbeat_grace to elapse before marking an OSD down.")
+    .add_see_also("osd_heartbeat_grace"),
+
     Option("osd_heartbeat_stale", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(600)
     .set_description("Interval (in seconds) we mark an unresponsive heartbeat peer as stale.")
@@ -3130,6 +3356,13 @@ std::vector<Option> get_global_options() {
     .set_default(1)
     .set_description(""),
 
+    Option("osd_recovery_share_available_pushes", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Split unused recovery slots among the pgs waiting to recover")
+    .set_long_description("With few pgs recovering, each one is otherwise started on osd_recovery_max_single_start objects at a time, which leaves most of osd_recovery_max_active idle and sends small objects one message each.  With this set, a pg may start its share of the free slots at once, up to osd_max_push_objects of which travel in one message to a peer.  Note that osd_recovery_sleep then applies per batch rather than per object.")
+    .add_see_also("osd_recovery_max_single_start")
+    .add_see_also("osd_max_push_objects"),
+
     Option("osd_recovery_max_chunk", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(8_M)
     .set_description(""),
@@ -3166,6 +3399,12 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description("Allow requested repairing when PGs on the OSD are undergoing recovery"),
 
+    Option("osd_scrub_auto_schedule", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Start periodic scrubs on this OSD's own schedule")
+    .set_long_description("If false, the OSD only starts scrubs that were explicitly requested, leaving the periodic ones to an external scheduler such as the scrub_scheduler mgr module.")
+    .add_see_also("osd_max_scrubs"),
+
     Option("osd_scrub_begin_hour", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description("Restrict scrubbing to this hour of the day or later")
@@ -3321,6 +3560,11 @@ std::vector<Option> get_global_options() {
     .set_default(40)
     .set_description(""),
 
+    Option("osd_pg_advance_skip_maps", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Let a pg skip osdmaps that change nothing for it while catching up")
+    .set_long_description("A pg waiting to peer (in Reset) is only fed the maps that change its mapping, its pool, or this osd's own state, and the map just before each of those.  This speeds up an osd booting after a long time down."),
+
     Option("osd_target_pg_log_entries_per_osd", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(3000 * 100)
     .set_description("target number of PG entries total on an OSD")
@@ -3505,6 +3749,13 @@ std::vector<Option> get_global_options() {
     .set_default(32)
     .set_description(""),
 
+    Option("osd_op_tracker_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("Record the events of one in every N ops")
+    .set_long_description("The ops out of the sample are still tracked in flight, and reported as slow ops, but record no events and stay out of the op history until they have been in flight for osd_op_complaint_time or osd_op_history_slow_op_threshold, whichever is lower.  This makes the op tracker cheap enough to leave enabled under load.")
+    .add_see_also({"osd_enable_op_tracker", "osd_op_complaint_time", "osd_op_history_slow_op_threshold"}),
+
     Option("osd_op_history_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(20)
     .set_description(""),
@@ -3669,13 +3920,27 @@ std::vector<Option> get_global_options() {
 
     Option("rocksdb_delete_range_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1048576)
-    .set_description("The number of keys required to invoke DeleteRange when deleting muliple keys."),
+    .set_description("The number of keys required to invoke DeleteRange when deleting muliple keys.")
+    .add_see_also("bluestore_rocksdb_delete_range_threshold"),
+
+    Option("rocksdb_compact_on_range_delete", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Queue a background compaction of the key range after a DeleteRange is committed")
+    .set_long_description("Iterators have to step over range tombstones until compaction drops them; compacting the deleted range soon after the delete keeps later listings of neighbouring keys fast.")
+    .add_see_also("rocksdb_delete_range_threshold"),
 
     Option("rocksdb_bloom_bits_per_key", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(20)
     .set_description("Number of bits per key to use for RocksDB's bloom filters.")
     .set_long_description("RocksDB bloom filters can be used to quickly answer the question of whether or not a key may exist or definitely does not exist in a given RocksDB SST file without having to read all keys into memory.  Using a higher bit value decreases the likelihood of false positives at the expense of additional disk space and memory consumption when the filter is loaded into RAM.  The current default value of 20 was found to provide significant performance gains when getattr calls are made (such as during new object creation in bluestore) without significant memory overhead or cache pollution when combined with rocksdb partitioned index filters.  See: https://github.com/facebook/rocksdb/wiki/Partitioned-Index-Filters for more information."),
 
+    Option("rocksdb_memtable_autotune", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Let the cache autotuner size the memory of all memtables together")
+    .set_long_description("The memtables of all column families share one write buffer budget that the PriorityCache manager balances against the block cache and the BlueStore caches, within osd_memory_target. The budget stays between write_buffer_size and what write_buffer_size and max_write_buffer_number allow for every column family.")
+    .add_see_also("bluestore_cache_autotune"),
+
     Option("rocksdb_cache_index_and_filter_blocks", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(true)
     .set_description("Whether to cache indices and filters in block cache")
@@ -3941,6 +4206,52 @@ std::vector<Option> get_global_options() {
     .set_default(16)
     .set_description(""),
 
+    Option("bdev_aio_ioprio", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Tag each aio with an io priority by what it is for")
+    .set_long_description("Client io and the kv WAL get the highest best effort priority, followed by deferred writes, then kv compaction, then scrub, recovery reads and other background io, for io schedulers such as bfq and mq-deadline to order them. Needs per request priorities in the kernel aio or io_uring interface (Linux 5.0); older kernels reject the submissions.")
+    .add_see_also("bdev_aio_background_max_inflight"),
+
+    Option("bdev_aio_background_max_inflight", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Maximum background aios (scrub, recovery reads, defrag) in flight per device, 0 for no limit")
+    .add_see_also("bdev_aio_ioprio"),
+
+    Option("bdev_ioring_hipri", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Use polled completions (IORING_SETUP_IOPOLL) with io_uring")
+    .add_see_also("bluestore_ioring"),
+
+    Option("bdev_ioring_sqthread_poll", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Use a kernel submission queue polling thread (IORING_SETUP_SQPOLL) with io_uring")
+    .set_long_description("With a kernel poller thread submissions normally do not need a syscall at all; the thread consumes the submission ring while it is busy and is only woken up after being idle for longer than bdev_ioring_sqthread_idle_ms.")
+    .add_see_also("bluestore_ioring"),
+
+    Option("bdev_ioring_sqthread_idle_ms", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Idle time before the io_uring kernel poller thread goes to sleep")
+    .add_see_also("bdev_ioring_sqthread_poll"),
+
+    Option("bdev_ioring_registered_buffers", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(0, 1024)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of buffers registered with io_uring for reads (0 disables)")
+    .set_long_description("Reads that fit into a registered buffer are issued as fixed-buffer reads so the kernel does not have to pin and map the pages for every IO. The buffers stay pinned for the lifetime of the device. A read is copied out of its buffer once done, so the buffer goes back to the pool right away. Reads fall back to regular buffers when the pool is exhausted, or when the read is larger than bdev_ioring_registered_buffer_size or smaller than a quarter of it.")
+    .add_see_also("bluestore_ioring"),
+
+    Option("bdev_ioring_registered_buffer_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(128_K)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Size of each buffer registered with io_uring")
+    .add_see_also("bdev_ioring_registered_buffers"),
+
     Option("bdev_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description(""),
@@ -4009,6 +4320,12 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("bluefs_hot_file_migration_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(30)
+    .set_min(1)
+    .set_description("How often (in seconds) BlueFS checks file read heat for moving hot files to the DB device")
+    .add_see_also("bluestore_volume_selection_heat_threshold"),
+
     Option("bluefs_buffered_io", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Enabled buffered IO for bluefs reads.")
@@ -4102,6 +4419,13 @@ std::vector<Option> get_global_options() {
     .set_default(5)
     .set_description("Time period to wait if there is no completed I/O from polling"),
 
+    Option("bluestore_spdk_inline_poll", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Let OSD shard threads reap their own SPDK completions")
+    .set_long_description("Each thread submitting to an SPDK device owns a queue pair. With this set, OSD op shard threads no longer spin in submission until their asynchronous writes complete; they return to their queue and reap completions between ops, so I/O runs to completion on the submitting thread without any cross-thread wakeup.")
+    .add_see_also("bluestore_spdk_io_sleep"),
+
     Option("bluestore_block_path", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("")
     .set_flag(Option::FLAG_CREATE)
@@ -4162,6 +4486,12 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_RUNTIME)
     .set_description("Ignore checksum errors on read and do not generate an EIO error"),
 
+    Option("bluestore_csum_seed_crc_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Hand the crc32c checksums verified on read on to the buffers read")
+    .set_long_description("With crc32c checksums, a read already computes the crc of every chunk it returns.  The crc of each buffer read is put together from those and cached with the buffer, so that deep scrub and the messenger find the digest of the data instead of hashing it again."),
+
     Option("bluestore_csum_type", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("crc32c")
     .set_enum_allowed({"none", "crc32c", "crc32c_16", "crc32c_8", "xxhash32", "xxhash64"})
@@ -4204,6 +4534,54 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_RUNTIME)
     .set_description("Writes smaller than this size will be written to the journal and then asynchronously written to the device.  This can be beneficial when using rotational media where seeks are expensive, and is helpful both with and without solid state journal/wal devices."),
 
+    Option("bluestore_defrag_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Seconds between background defragmentation batches")
+    .set_long_description("When positive a background thread walks all objects, a batch at a time, and rewrites those whose data is split into many small physical extents. 0 disables it.")
+    .add_see_also({"bluestore_defrag_min_extents", "bluestore_defrag_max_bytes_per_sec"}),
+
+    Option("bluestore_defrag_min_extents", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_description("Minimum number of physical extents for an object to be defragmented")
+    .set_long_description("The object must also take more than twice the extents its size requires given bluestore_max_blob_size.")
+    .add_see_also("bluestore_defrag_interval"),
+
+    Option("bluestore_defrag_max_bytes_per_sec", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(32_M)
+    .set_description("Upper bound on the data rewritten by background defragmentation per second")
+    .add_see_also("bluestore_defrag_interval"),
+
+    Option("bluestore_zoned_open_zones", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of zones of a zoned device written at the same time")
+    .set_long_description("The collections are spread over this many open zones. The transactions allocating from the same zone submit their writes one after the other, in the order of their allocations."),
+
+    Option("bluestore_zoned_cleaner_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(10)
+    .set_description("Seconds between checks whether zones of a zoned device need cleaning")
+    .set_long_description("Zoned (SMR) devices are only written sequentially, released space comes back once the live data left in a zone has been moved elsewhere and the zone has been reset. 0 disables the cleaner.")
+    .add_see_also({"bluestore_zoned_cleaner_free_ratio", "bluestore_zoned_cleaner_min_dead_ratio", "bluestore_zoned_cleaner_max_bytes_per_sec"}),
+
+    Option("bluestore_zoned_cleaner_free_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.25)
+    .set_min_max(0.0, 1.0)
+    .set_description("Clean zones while less than this fraction of a zoned device is free")
+    .add_see_also("bluestore_zoned_cleaner_interval"),
+
+    Option("bluestore_zoned_cleaner_min_dead_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.5)
+    .set_min_max(0.0, 1.0)
+    .set_description("Minimum fraction of released space for a zone to be cleaned")
+    .add_see_also("bluestore_zoned_cleaner_interval"),
+
+    Option("bluestore_zoned_cleaner_max_bytes_per_sec", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_M)
+    .set_description("Upper bound on the data moved by the zoned cleaner per second")
+    .add_see_also("bluestore_zoned_cleaner_interval"),
+
     Option("bluestore_prefer_deferred_size_hdd", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(64_K)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4216,6 +4594,14 @@ std::vector<Option> get_global_options() {
     .set_description("Default bluestore_prefer_deferred_size for non-rotational (solid state) media")
     .add_see_also("bluestore_prefer_deferred_size"),
 
+    Option("bluestore_prefer_deferred_size_pmem", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Default bluestore_prefer_deferred_size when the BlueFS WAL is on persistent memory")
+    .set_long_description("Deferred writes are committed through the RocksDB WAL and written to the main device later. With the WAL on a persistent memory device a commit is a cache line flush and fence rather than a block I/O, so it pays to defer larger writes than on solid state media.")
+    .add_see_also("bluestore_prefer_deferred_size")
+    .add_see_also("bluestore_block_wal_path"),
+
     Option("bluestore_compression_mode", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("none")
     .set_enum_allowed({"none", "passive", "aggressive", "force"})
@@ -4294,6 +4680,20 @@ std::vector<Option> get_global_options() {
     .set_description("")
     .add_see_also("bluestore_max_blob_size"),
 
+    Option("bluestore_adaptive_write_sizing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Choose blob and checksum sizing from the collection's observed write sizes")
+    .set_long_description("When an object carries no allocation hints, collections whose writes average at least bluestore_max_blob_size are treated as if they were hinted sequential/immutable: they get larger checksum chunks and, when compressing, compression_max_blob_size sized blobs. min_alloc_size is an on-disk property and is not affected.")
+    .add_see_also("bluestore_max_blob_size")
+    .add_see_also("bluestore_compression_max_blob_size"),
+
+    Option("bluestore_compression_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of threads compressing the blobs of a write in parallel")
+    .set_long_description("A write spanning several blobs has them compressed concurrently by these threads, rather than one after the other on the thread doing the write. 0 compresses them all on the writing thread."),
+
     Option("bluestore_compression_required_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.875)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4328,11 +4728,43 @@ std::vector<Option> get_global_options() {
     .set_default(64)
     .set_description("Max pinned cache entries we consider before giving up"),
 
+    Option("bluestore_cache_unload_cold_extents", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Drop the decoded extent map of cold, clean onodes before evicting them from the cache")
+    .set_long_description("When an onode with a sharded extent map reaches the cold end of the onode cache, its decoded extent shards are released and the onode is given a second pass through the cache holding only its metadata and spanning blobs.  Shards are faulted back in from the key/value store on the next access.  This trades extra kv reads for keeping more onodes cached within the same memory budget."),
+
+    Option("bluestore_cache_onode_admission", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Keep onodes accessed only once from displacing frequently used ones in the onode cache")
+    .set_long_description("Access frequencies are tracked in a compact TinyLFU-style sketch.  When the onode cache is full, an onode returning to the cache is put at the hot end only if it has been used more often than the eviction candidate; otherwise it goes to the cold end.  This keeps scrub and backfill from flushing the client working set."),
+
+    Option("bluestore_onode_prefetch", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Load onodes in the background when callers announce which objects they are going to access")
+    .set_long_description("Scrub and other sequential scans pass the next batch of objects to ObjectStore::prefetch, and a background thread reads their onodes and extent map shards from the key/value store so the scan does not wait on each lookup in turn."),
+
     Option("bluestore_cache_type", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("2q")
     .set_enum_allowed({"2q", "lru"})
     .set_description("Cache replacement algorithm"),
 
+    Option("bluestore_cache_arena", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Keep the data of the buffer cache in huge page backed arenas")
+    .set_long_description("Clean buffers are copied into 2 MiB regions of memory, one set per cache shard, placed on osd_numa_node if set, so that cache hits take fewer TLB misses and no cross-socket traffic.  Buffers are rounded up to a power of two of at least 4 KiB.  The regions are backed by transparent huge pages only with thp enabled, unless bluestore_cache_arena_hugetlb is set.")
+    .add_see_also({"bluestore_cache_arena_hugetlb", "osd_numa_node", "thp"}),
+
+    Option("bluestore_cache_arena_hugetlb", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Take the cache arena regions from the reserved huge pages")
+    .set_long_description("Back the regions of bluestore_cache_arena with huge pages reserved in vm.nr_hugepages, and fall back to normal pages once there are none left.")
+    .add_see_also("bluestore_cache_arena"),
+
     Option("bluestore_2q_cache_kin_ratio", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(.5)
     .set_description("2Q paper suggests .5"),
@@ -4392,6 +4824,12 @@ std::vector<Option> get_global_options() {
     .set_description("Allocator policy")
     .set_long_description("Allocator to use for bluestore.  Stupid should only be used for testing."),
 
+    Option("bluestore_allocator_snapshot", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Save the free space map on clean shutdown and load it on the next mount")
+    .set_long_description("On umount the allocator's view of free space is stored in the DB and on the following mount it is used to initialize the allocator instead of walking the whole freelist. The snapshot is discarded as soon as the store is opened for writing, so any unclean shutdown falls back to the freelist scan."),
+
     Option("bluestore_freelist_blocks_per_key", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128)
     .set_description("Block (and bits) per database key"),
@@ -4416,6 +4854,13 @@ std::vector<Option> get_global_options() {
     .set_default("compression=kNoCompression,max_write_buffer_number=4,min_write_buffer_number_to_merge=1,recycle_log_file_num=4,write_buffer_size=268435456,writable_file_max_buffer_size=0,compaction_readahead_size=2097152,max_background_compactions=2")
     .set_description("Rocksdb options"),
 
+    Option("bluestore_rocksdb_delete_range_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1024)
+    .set_description("The number of keys required to invoke DeleteRange when bluestore removes a range of keys")
+    .set_long_description("Overrides rocksdb_delete_range_threshold for the bluestore metadata db. Clearing an omap, or removing an object's omap while deleting a PG, with more keys than this writes a single range tombstone instead of one tombstone per key.")
+    .add_see_also("rocksdb_delete_range_threshold")
+    .add_see_also("rocksdb_compact_on_range_delete"),
+
     Option("bluestore_rocksdb_cf", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Enable use of rocksdb column families for bluestore metadata"),
@@ -4428,7 +4873,20 @@ std::vector<Option> get_global_options() {
 			  "Example: 'I=write_buffer_size=1048576 O(6) m(7,10-)'. "
 			  "Interval [hash_begin..hash_end) defines characters to use for hash calculation. "
 			  "Recommended hash ranges: O(0-13) P(0-8) m(0-16). "
-			  "Sharding of S,T,C,M,B prefixes is inadvised"),
+			  "Sharding of S,T,C,M,B prefixes is inadvised. "
+			  "The options of each column, e.g. write_buffer_size, compaction_style or "
+			  "block_based_table_factory={filter_policy=bloomfilter:10:false}, are applied on every open; "
+			  "they start from bluestore_rocksdb_options and keep sharing the block cache. "
+			  "Changing the columns themselves needs bluestore_rocksdb_reshard_on_mount.")
+    .add_see_also("bluestore_rocksdb_reshard_on_mount"),
+
+    Option("bluestore_rocksdb_reshard_on_mount", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Migrate the key/value store to the column layout of bluestore_rocksdb_cfs at mount")
+    .set_long_description("When the stored column family layout differs from bluestore_rocksdb_cfs, keys are moved to the new layout before the OSD starts. "
+			  "This takes time proportional to the amount of metadata. An interrupted migration resumes on the next mount.")
+    .add_see_also("bluestore_rocksdb_cfs"),
 
     Option("bluestore_fsck_on_mount", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
@@ -4462,6 +4920,13 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description("Try to submit metadata transaction to rocksdb in queuing thread context"),
 
+    Option("bluestore_kv_sync_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min_max(1, 64)
+    .set_description("Number of threads submitting metadata transactions to rocksdb on behalf of kv_sync_thread")
+    .set_long_description("With more than one shard, OpSequencers are hashed onto the submit threads so that transactions from different sequencers are applied to rocksdb in parallel, while kv_sync_thread still issues a single WAL sync per commit cycle.  A value of 1 submits everything from kv_sync_thread itself.")
+    .add_see_also("bluestore_sync_submit_transaction"),
+
     Option("bluestore_fsck_read_bytes_cap", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(64_M)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4471,6 +4936,11 @@ std::vector<Option> get_global_options() {
       .set_default(2)
       .set_description("Number of additional threads to perform quick-fix (shallow fsck) command"),
 
+    Option("bluestore_fsck_deep_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+      .set_default(2)
+      .set_description("Number of additional threads to read back and verify object data during deep fsck")
+      .set_long_description("Extent, shared blob, omap and freelist checks are still performed by the main fsck thread; only data verification is handed off. 0 reads in the main thread."),
+
     Option("bluestore_throttle_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(64_M)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4515,6 +4985,12 @@ std::vector<Option> get_global_options() {
     .set_description("Default bluestore_deferred_batch_ops for non-rotational (solid state) media")
     .add_see_also("bluestore_deferred_batch_ops"),
 
+    Option("bluestore_deferred_submit_sorted", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Submit pending deferred write batches of all sequencers together, in device offset order")
+    .add_see_also("bluestore_deferred_batch_ops"),
+
     Option("bluestore_nid_prealloc", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(1024)
     .set_description("Number of unique object ids to preallocate at a time"),
@@ -4656,6 +5132,20 @@ std::vector<Option> get_global_options() {
     .set_default(64_M)
     .set_description("Maximum RAM hybrid allocator should use before enabling bitmap supplement"),
 
+    Option("bluestore_alloc_arenas", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of arenas avl and hybrid allocators serve small allocations from, 0 disables")
+    .set_long_description("Each arena keeps a piece of free space taken from the allocator and serves allocations of the threads mapped to it under its own lock, which reduces allocator lock contention for parallel small writes.")
+    .add_see_also("bluestore_alloc_arena_size"),
+
+    Option("bluestore_alloc_arena_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(4_M)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Amount of free space an allocation arena takes at once")
+    .set_long_description("Only allocations up to a quarter of this size are served from arenas.")
+    .add_see_also("bluestore_alloc_arenas"),
+
     Option("bluestore_volume_selection_policy", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("rocksdb_original")
     .set_enum_allowed({ "rocksdb_original", "use_some_extra" })
@@ -4672,6 +5162,12 @@ std::vector<Option> get_global_options() {
       .set_default(0)
       .set_description("Space reserved at DB device and not allowed for 'use some extra' policy usage. Overrides 'bluestore_volume_selection_reserved_factor' setting and introduces straightforward limit."),
 
+    Option("bluestore_volume_selection_heat_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+      .set_flag(Option::FLAG_STARTUP)
+      .set_default(0)
+      .set_description("Reads per 'bluefs_hot_file_migration_interval' after which a BlueFS file spilled over to the slow device is moved back to DB device, 0 disables")
+      .add_see_also("bluefs_hot_file_migration_interval"),
+
     Option("bluestore_ioring", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Enables Linux io_uring API instead of libaio"),
@@ -5155,6 +5651,29 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description(""),
 
+    Option("rados_aio_batch_max_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Send ops batched by an IoCtx once this many are queued")
+    .add_see_also("rados_aio_batch_usec"),
+
+    Option("rados_aio_batch_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(256_K)
+    .set_description("Send ops batched by an IoCtx once they carry this much data")
+    .add_see_also("rados_aio_batch_usec"),
+
+    Option("rados_aio_batch_usec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(50)
+    .set_description("How long an IoCtx with batching enabled holds back an op at most")
+    .set_long_description("See IoCtx::set_aio_batching(). Batched ops go to the objecter in one go, and those to the same OSD leave in one write on the connection."),
+
+    Option("rados_aio_finisher_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("threads completing the aio callbacks of a client")
+    .set_long_description("The callbacks of the aio completions of an IoCtx are always called in order from one thread, but those of different IoCtxs are called in parallel from this many threads."),
+
     Option("rados_tracing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -5218,6 +5737,19 @@ std::vector<Option> get_global_options() {
                           "if you simply do not require the most up to date "
                           "performance counter data."),
 
+    Option("mgr_compact_perf_reports", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .add_service("mgr")
+    .set_description("Ask daemons to report only the perf counters that changed")
+    .set_long_description("Daemons then send the varint encoded difference to the previous report for each changed counter instead of every counter value.  Takes effect for new sessions and when the manager reconfigures them."),
+
+    Option("mgr_report_workers", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .add_service("mgr")
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of threads decoding perf counters of daemon reports")
+    .set_long_description("Reports of one daemon are always decoded by the same thread, in order.  0 decodes them on the messenger dispatch thread."),
+
     Option("mgr_client_bytes", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128_M)
     .add_service("mgr"),
@@ -5269,6 +5801,12 @@ std::vector<Option> get_global_options() {
     .set_description("Bypass most throttling and safety checks in pg[p]_num controller")
     .add_service("mgr"),
 
+    Option("mgr_digest_full_interval", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(12)
+    .add_service("mgr")
+    .set_description("Send a full PG digest to the monitor every this many reports")
+    .set_long_description("Reports in between only carry what changed since the previous report.  A monitor that missed a report keeps its digest until the next full one.  1 sends a full digest with every report."),
+
     Option("mon_mgr_digest_period", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(5)
     .add_service("mon")
@@ -5366,7 +5904,20 @@ std::vector<Option> get_global_options() {
 
     Option("crimson_osd_scheduler_concurrency", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(0)
-    .set_description("The maximum number concurrent IO operations, 0 for unlimited")
+    .set_description("The maximum number concurrent IO operations, 0 for unlimited"),
+
+    Option("seastore_device_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(10_G)
+    .set_flag(Option::FLAG_CREATE)
+    .set_description("Size of the file that mkfs creates for seastore")
+    .set_long_description("A block device is used as large as it is."),
+
+    Option("seastore_segment_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_M)
+    .set_min(1_M)
+    .set_flag(Option::FLAG_CREATE)
+    .set_description("Size of the segments of the seastore journal")
+    .set_long_description("A transaction has to fit in a segment."),
 
   });
 }
@@ -5397,6 +5948,16 @@ std::vector<Option> get_rgw_options() {
     .set_default(false)
     .set_description("true if LTTng-UST tracepoints should be enabled"),
 
+    Option("rgw_compression_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_description("Number of threads compressing the uploads of compressed buckets")
+    .set_long_description(
+        "The chunks of an upload to a compressed storage class are compressed by "
+        "these threads, that many chunks of an upload at a time, so that a single "
+        "upload is not limited to the compression speed of one core. 0 compresses "
+        "the chunks on the request thread.")
+    .add_see_also("rgw_max_chunk_size"),
+
     Option("rgw_max_chunk_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_M)
     .set_description("Set RGW max chunk size")
@@ -5587,6 +6148,24 @@ std::vector<Option> get_rgw_options() {
     .set_default(0)
     .set_description("Delay after processing of bucket listing chunks (i.e., per 1000 entries) in milliseconds"),
 
+    Option("rgw_lc_max_wp_worker", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(3)
+    .set_min(1)
+    .set_description("Number of threads processing the objects of a bucket")
+    .set_long_description(
+        "The lifecycle processing of a bucket runs this many threads, each "
+        "listing and processing the index shards of the bucket in turn. A bucket "
+        "with a single index shard is processed by a single thread.")
+    .add_see_also({"rgw_lc_max_ops_per_sec"}),
+
+    Option("rgw_lc_max_ops_per_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Max expirations and transitions per second of a bucket")
+    .set_long_description(
+        "The lifecycle threads of a bucket expire or transition at most this many "
+        "objects per second between them. Zero means no limit.")
+    .add_see_also({"rgw_lc_max_wp_worker"}),
+
     Option("rgw_lc_max_objs", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(32)
     .set_description("Number of lifecycle data shards")
@@ -6222,6 +6801,25 @@ std::vector<Option> get_rgw_options() {
         "thread will use when purging old data.")
     .add_see_also({"rgw_gc_max_objs", "rgw_gc_obj_min_wait", "rgw_gc_processor_max_time", "rgw_gc_max_trim_chunk"}),
 
+    Option("rgw_gc_processor_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Number of gc shards processed at the same time")
+    .set_long_description(
+        "The garbage collector processes this many of its shards in parallel, each "
+        "with up to rgw_gc_max_concurrent_io IO operations in flight.")
+    .add_see_also({"rgw_gc_max_objs", "rgw_gc_max_concurrent_io"}),
+
+    Option("rgw_gc_io_target_latency_ms", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(500)
+    .set_description("Target latency of the garbage collection IO operations")
+    .set_long_description(
+        "The number of concurrent IO operations of the garbage collector is halved "
+        "when one of them takes longer than this, or the OSD returns EBUSY or "
+        "ETIMEDOUT, and grows back by one up to rgw_gc_max_concurrent_io with every "
+        "operation that does not. Zero keeps it at rgw_gc_max_concurrent_io.")
+    .add_see_also({"rgw_gc_max_concurrent_io"}),
+
     Option("rgw_gc_max_trim_chunk", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(16)
     .set_description("Max number of keys to remove from garbage collector log in a single operation")
@@ -6283,7 +6881,34 @@ std::vector<Option> get_rgw_options() {
     Option("rgw_get_obj_window_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(16_M)
     .set_description("RGW object read window size")
-    .set_long_description("The window size in bytes for a single object read request"),
+    .set_long_description("The initial window size in bytes for a single object read request. "
+        "The window then follows the rate at which the client takes the data and the latency "
+        "of the reads from RADOS, up to rgw_get_obj_max_window_size."),
+
+    Option("rgw_get_obj_max_window_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_M)
+    .set_description("RGW object read max window size")
+    .set_long_description("The maximum window size in bytes for a single object read request. "
+        "A value not above rgw_get_obj_window_size keeps the window static.")
+    .add_see_also("rgw_get_obj_window_size"),
+
+    Option("rgw_d3n_l1_local_datacache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Cache the data of the objects read on a local device")
+    .set_long_description("The tail objects read from RADOS are cached in "
+        "rgw_d3n_l1_datacache_persistent_path, and read from there while cached.")
+    .add_see_also({"rgw_d3n_l1_datacache_persistent_path", "rgw_d3n_l1_datacache_size"}),
+
+    Option("rgw_d3n_l1_datacache_persistent_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("/tmp/rgw_datacache/")
+    .set_description("The directory of the local data cache")
+    .set_long_description("The files found in it are removed at startup.")
+    .add_see_also("rgw_d3n_l1_local_datacache_enabled"),
+
+    Option("rgw_d3n_l1_datacache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_G)
+    .set_description("The bytes cached in the local data cache at most")
+    .add_see_also("rgw_d3n_l1_local_datacache_enabled"),
 
     Option("rgw_get_obj_max_req_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_M)
@@ -6398,6 +7023,13 @@ std::vector<Option> get_rgw_options() {
         "configured here is the ratio between the data usage to the max usage "
         "as specified by the quota."),
 
+    Option("rgw_iam_policy_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_description("RGW bucket policy cache size")
+    .set_long_description(
+        "Maximum number of parsed bucket policies kept to authorize the requests "
+        "of their buckets without parsing the policy again. 0 disables the cache."),
+
     Option("rgw_bucket_quota_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10000)
     .set_description("RGW quota stats cache size")
@@ -6564,6 +7196,16 @@ std::vector<Option> get_rgw_options() {
     .set_default(true)
     .set_description("Should run sync thread"),
 
+    Option("rgw_bucket_sync_spawn_window", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(20)
+    .set_min(1)
+    .set_description("Max objects a bucket shard sync fetches at once")
+    .set_long_description(
+        "The maximum number of objects that the sync of a bucket shard fetches from "
+        "the source zone at the same time. The window of every source zone is halved "
+        "when the zone returns EBUSY, EIO or ETIMEDOUT, and grows back by one after a "
+        "window of fetches that succeeded."),
+
     Option("rgw_sync_lease_period", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(120)
     .set_description(""),
@@ -6821,6 +7463,28 @@ std::vector<Option> get_rgw_options() {
     .set_default(200)
     .set_description("data changes notification interval to followers"),
 
+    Option("rgw_notify_persistent_queue_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(128_M)
+    .set_description("Size of the queue of a persistent notification topic")
+    .set_long_description("The events of a persistent topic are queued in RADOS "
+        "objects of the log pool of the zone until they are pushed to the endpoint. "
+        "An event is rejected when the queue is full.")
+    .add_see_also({"rgw_notify_persistent_queue_shards"}),
+
+    Option("rgw_notify_persistent_queue_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_description("Number of queues of a persistent notification topic")
+    .set_long_description("The events of a topic are spread over the queues by "
+        "the object key, so that a busy topic does not serialize its writers on a "
+        "single RADOS object. The events of an object keep their order.")
+    .add_see_also({"rgw_notify_persistent_queue_size"}),
+
+    Option("rgw_notify_persistent_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_description("Number of threads pushing the events of persistent notification topics")
+    .set_long_description("Each thread pushes the queues of its hash, in batches, "
+        "holding a lock on the queue so that it is pushed by one gateway at a time."),
+
     Option("rgw_torrent_origin", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("Torrent origin"),
@@ -6883,6 +7547,23 @@ std::vector<Option> get_rgw_options() {
 			  "of RGW instances under heavy use. If you would like "
 			  "to turn off cache expiry, set this value to zero."),
 
+    Option("rgw_cache_notify_batch_interval_ms", Option::TYPE_UINT,
+	   Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .add_tag("performance")
+    .add_service("rgw")
+    .set_description("Milliseconds the cache notifications to the other RGW "
+		     "instances are gathered before being sent together. "
+		     "Zero sends every one as it is made.")
+    .set_long_description("With many RGW instances, each metadata change "
+			  "notified on its own makes one watch/notify round "
+			  "trip to all of them. When this is set, the changes "
+			  "are queued, the ones to the same object coalesced, "
+			  "and sent in batches once per interval; the other "
+			  "instances may serve the old metadata for that long. "
+			  "All the RGW instances must understand the batches "
+			  "before this is enabled."),
+
     Option("rgw_inject_notify_timeout_probability", Option::TYPE_FLOAT,
 	   Option::LEVEL_DEV)
     .set_default(0)
@@ -7113,6 +7794,18 @@ static std::vector<Option> get_rbd_options() {
     .set_default(true)
     .set_description("process AIO ops from a dispatch thread to prevent blocking"),
 
+    Option("rbd_io_dispatch_lanes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("number of dispatch threads, each with a queue of its own, for non-blocking AIO ops")
+    .set_long_description("With rbd_non_blocking_aio, the AIO ops issued by an "
+                          "application thread are all dispatched from the "
+                          "same lane, in order, and the ops of different "
+                          "threads, e.g. of the queues of a virtual disk, "
+                          "from independent lanes. If 0, they are all "
+                          "dispatched from the librbd thread pool.")
+    .add_see_also("rbd_non_blocking_aio"),
+
     Option("rbd_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("whether to enable caching (writeback unless rbd_cache_max_dirty is 0)"),
@@ -7122,6 +7815,12 @@ static std::vector<Option> get_rbd_options() {
     .set_default("writearound")
     .set_description("cache policy for handling writes."),
 
+    Option("rbd_cache_object_cacher", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("whether the writethrough and writeback cache policies use the ObjectCacher")
+    .set_long_description("If false, a lighter write back cache of per-object extents is used instead, which does not support readahead.")
+    .add_see_also("rbd_cache_policy"),
+
     Option("rbd_cache_writethrough_until_flush", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("whether to make writeback caching writethrough until "
@@ -7152,15 +7851,49 @@ static std::vector<Option> get_rbd_options() {
     .set_default(false)
     .set_description("whether to block writes to the cache before the aio_write call completes"),
 
+    Option("rbd_cache_readahead_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("largest window the cache prefetches ahead of a sequential reader within and across objects")
+    .set_long_description("Each object tracks its own read stream, so a scan of a striped image prefetches from all objects of the stripe at once. Set to 0 to disable.")
+    .add_see_also("rbd_cache_readahead_min_bytes")
+    .add_see_also("rbd_readahead_max_bytes"),
+
+    Option("rbd_cache_readahead_min_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(128_K)
+    .set_description("first window the cache prefetches once a read stream is seen as sequential; doubled on every refill")
+    .add_see_also("rbd_cache_readahead_max_bytes"),
+
     Option("rbd_parent_cache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("whether to enable rbd shared ro cache"),
 
+    Option("rbd_read_cache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("whether to cache the reads of the image in a local file")
+    .set_long_description("The cache is only used while this client holds the exclusive lock of the image, and is dropped when the lock is released.")
+    .add_see_also("rbd_read_cache_path")
+    .add_see_also("rbd_read_cache_size"),
+
+    Option("rbd_read_cache_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("/tmp")
+    .set_description("location of the read cache file, on a local SSD"),
+
+    Option("rbd_read_cache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_G)
+    .set_min(64_M)
+    .set_description("size of the read cache of this image"),
+
     Option("rbd_concurrent_management_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_min(1)
     .set_description("how many operations can be in flight for a management operation like deleting or resizing an image"),
 
+    Option("rbd_concurrent_object_copies", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("how many objects can be copied at once by a deep copy or a migration")
+    .set_long_description("The destination image's setting is used. A wider window than rbd_concurrent_management_ops hides the latency of copies from a remote cluster. 0 means rbd_concurrent_management_ops.")
+    .add_see_also("rbd_concurrent_management_ops"),
+
     Option("rbd_balance_snap_reads", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("distribute snap read requests to random OSD"),
@@ -7247,6 +7980,16 @@ static std::vector<Option> get_rbd_options() {
     .set_description("Compression hint to send to the OSDs during writes")
     .set_flag(Option::FLAG_RUNTIME),
 
+    Option("rbd_deep_copy_read_compression", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_enum_allowed({"none", "snappy", "zlib", "zstd", "lz4"})
+    .set_default("none")
+    .set_description("compress the data read from the source image during deep copy and mirroring")
+    .set_long_description("the changed extents of an object are read as one "
+                          "buffer compressed by the OSDs of the source "
+                          "cluster, for use over WAN links; requires the "
+                          "OSDs to support the compressed_read method of "
+                          "cls_rbd and the compressor plugin"),
+
     Option("rbd_read_from_replica_policy", Option::TYPE_STR, Option::LEVEL_BASIC)
     .set_enum_allowed({"default", "balance", "localize"})
     .set_default("default")
@@ -7373,6 +8116,12 @@ static std::vector<Option> get_rbd_options() {
     .set_default(0)
     .set_description("maximum number of in-flight appends per journal object"),
 
+    Option("rbd_journal_object_adaptive_batching", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("whether to size the appends to journal objects from the observed append rate and latency")
+    .set_long_description("An append is sent right away if none is in flight to the journal object. Otherwise the entries expected while an append is in flight are spread over the appends the object may have in flight: rbd_journal_object_max_in_flight_appends, or 4 if it is 0. The rbd_journal_object_flush* options still force an append once reached.")
+    .add_see_also("rbd_journal_object_max_in_flight_appends"),
+
     Option("rbd_journal_pool", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("pool for journal objects"),
@@ -7438,10 +8187,57 @@ static std::vector<Option> get_rbd_options() {
     .set_min(1)
     .set_description("minimum schedule tick (in milliseconds) for QoS"),
 
+    Option("rbd_qos_scheduler_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("schedule IO with the pool's shared QoS scheduler")
+    .set_long_description("The images of a pool opened by the same client "
+                          "share a dmclock scheduler, which dispatches their "
+                          "IOs by the reservation, weight and limit of each "
+                          "image, within the IOPS limit of the pool.")
+    .add_see_also("rbd_qos_reservation")
+    .add_see_also("rbd_qos_weight")
+    .add_see_also("rbd_qos_limit")
+    .add_see_also("rbd_qos_pool_iops_limit"),
+
+    Option("rbd_qos_reservation", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("the IOPS reserved for the image by the QoS scheduler"),
+
+    Option("rbd_qos_weight", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("the share of the image in the spare IOPS of the QoS "
+                     "scheduler"),
+
+    Option("rbd_qos_limit", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("the IOPS limit of the image in the QoS scheduler"),
+
+    Option("rbd_qos_pool_iops_limit", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("the IOPS shared by the images of a pool in the QoS "
+                     "scheduler")
+    .set_long_description("The images of the pool share the limit applied "
+                          "last. Zero means that only the reservations and "
+                          "limits of the images are enforced."),
+
+    Option("rbd_qos_pool_iops_burst", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("the IOs the QoS scheduler may dispatch at once for a "
+                     "pool which has been idle"),
+
     Option("rbd_discard_on_zeroed_write_same", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("discard data on zeroed write same instead of writing zero"),
 
+    Option("rbd_discard_on_zeroed_write", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("discard data on zeroed writes instead of writing zero")
+    .set_long_description("The writes to an object which are all zero are "
+                          "sent as discards of the range, so that thin images "
+                          "stay thin.")
+    .add_see_also("rbd_discard_on_zeroed_write_same"),
+
     Option("rbd_mtime_update_interval", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(60)
     .set_min(0)
@@ -7479,6 +8275,13 @@ static std::vector<Option> get_rbd_options() {
     .set_default("/tmp")
     .set_description("location of the persistent write back cache in a DAX-enabled filesystem on persistent memory"),
 
+    Option("rbd_rwl_mode", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("rwl")
+    .set_enum_allowed({"rwl", "ssd"})
+    .set_description("the media of the persistent write back cache for this volume")
+    .set_long_description("'rwl' keeps the cache in a pool on persistent memory, 'ssd' in a log file on an SSD in rbd_rwl_path.")
+    .add_see_also("rbd_rwl_path"),
+
     Option("rbd_quiesce_notification_attempts", Option::TYPE_UINT, Option::LEVEL_DEV)
     .set_default(10)
     .set_min(1)
@@ -7504,6 +8307,16 @@ static std::vector<Option> get_rbd_mirror_options() {
     .set_default(5)
     .set_description("maximum number of image syncs in parallel"),
 
+    Option("rbd_mirror_image_sync_max_object_copies", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("maximum number of objects copied in parallel by all image syncs")
+    .set_long_description("0 means unlimited; each image sync is still limited by rbd_concurrent_management_ops"),
+
+    Option("rbd_mirror_image_sync_bps_limit", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("maximum bytes per second read by all image syncs")
+    .set_long_description("0 means unlimited; the object copies held back by either limit are started for the images with the most objects left to copy first"),
+
     Option("rbd_mirror_pool_replayers_refresh_interval", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(30)
     .set_description("interval to refresh peers in rbd-mirror daemon"),
@@ -7619,6 +8432,20 @@ static std::vector<Option> get_immutable_object_cache_options() {
     .set_default("/var/run/ceph/immutable_object_cache_sock")
     .set_description("immutable object cache domain socket"),
 
+    Option("immutable_object_cache_index_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("/var/run/ceph/immutable_object_cache_index")
+    .set_description("immutable object cache index shared with the clients")
+    .set_long_description("the clients look the cached objects up in this "
+                          "index, mapped in memory, instead of asking the "
+                          "daemon over its domain socket; empty to disable"),
+
+    Option("immutable_object_cache_index_slots", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_min(1)
+    .set_description("number of objects the immutable object cache index can hold")
+    .set_long_description("8 bytes per slot; the objects missing from a full "
+                          "index are looked up through the daemon"),
+
     Option("immutable_object_cache_max_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(1_G)
     .set_description("max immutable object cache data size"),
@@ -7634,6 +8461,29 @@ static std::vector<Option> get_immutable_object_cache_options() {
     Option("immutable_object_cache_watermark", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0.1)
     .set_description("immutable object cache water mark"),
+
+    Option("immutable_object_cache_policy", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("simple")
+    .set_enum_allowed({"simple", "extent"})
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("immutable object cache promotion and eviction policy")
+    .set_long_description("'simple' promotes the whole objects on their first "
+                          "miss and evicts the least recently used ones; "
+                          "'extent' promotes the blocks read of the objects "
+                          "missed often enough, and evicts the objects with "
+                          "the fewest accesses per cached byte"),
+
+    Option("immutable_object_cache_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_min(4_K)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("unit of promotion of the extent immutable object cache policy"),
+
+    Option("immutable_object_cache_admission_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("misses of an object before the extent immutable object cache policy promotes it")
+    .set_long_description("1 promotes the objects on their first miss"),
   });
 }
 
@@ -7710,6 +8560,11 @@ std::vector<Option> get_mds_options() {
     .set_default(16384)
     .set_description("number of directory entries to read in one RADOS operation"),
 
+    Option("mds_readdir_prefetch_next_frag", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("fetch the next fragment of a directory while its current one is listed")
+    .set_long_description("When a readdir starts on a fragment of a directory, the MDS starts fetching the following fragment, if it is not cached, so that the client does not wait for it when it gets there."),
+
     Option("mds_decay_halflife", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description("rate of decay for temperature counters on each directory for balancing"),
@@ -7853,6 +8708,11 @@ std::vector<Option> get_mds_options() {
     .set_default(1024)
     .set_description("maximum number of events in an MDS journal segment"),
 
+    Option("mds_log_group_commit_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_description("maximum number of MDS journal flushes grouped into one write")
+    .set_long_description("A journal flush with more events queued behind it is put off, so that those events are written along with it by the flush of a later event, or once the queue is drained. This is the number of flushes that can be put off in a row. 0 writes every flush at once."),
+
     Option("mds_log_segment_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description("size in bytes of each MDS log segment"),
@@ -7919,6 +8779,12 @@ std::vector<Option> get_mds_options() {
     .set_description("enable directory fragmentation")
     .set_long_description("Directory fragmentation is a standard feature of CephFS that allows sharding directories across multiple objects for performance and stability. Additionally, this allows fragments to be distributed across multiple active MDSs to increase throughput. Disabling (new) fragmentation should only be done in exceptional circumstances and may lead to performance issues."),
 
+    Option("mds_bal_import_cooldown", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(60)
+    .set_min(0)
+    .set_description("seconds an imported subtree stays before the balancer can export it again")
+    .set_long_description("The balancer does not re-export a subtree it imported less than this long ago, neither back to where it came from nor to another rank, so that subtrees are not bounced back and forth between ranks whose loads fluctuate. The fragments below the subtree can still be exported. 0 disables the hysteresis."),
+
     Option("mds_bal_idle_threshold", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description("idle metadata popularity threshold before rebalancing"),
@@ -8127,6 +8993,12 @@ std::vector<Option> get_mds_options() {
     .set_default(64)
     .set_description("maximum number of deleted files to purge in parallel"),
 
+    Option("mds_purge_target_latency_ms", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_description("target latency of purging a deleted file")
+    .set_long_description("While the deleted files get purged within this latency, the number of files purged in parallel grows past mds_max_purge_files, up to the purge op limit; it is halved back towards mds_max_purge_files whenever a file takes longer. 0 purges mds_max_purge_files files at a time.")
+    .add_see_also("mds_max_purge_files"),
+
     Option("mds_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(8192)
     .set_description("maximum number of purge operations performed in parallel"),
@@ -8256,6 +9128,12 @@ std::vector<Option> get_mds_client_options() {
     .set_default(4)
     .set_description("maximum stripe periods to readahead in a file"),
 
+    Option("client_direct_read_min", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("minimum size of a read to bypass the object cacher (zero is never)")
+    .set_long_description("Reads at least this large and aligned to the stripe unit of the file are sent to the OSDs directly, as for O_DIRECT, unless the object cacher has dirty data of the file.")
+    .add_see_also("client_oc"),
+
     Option("client_reconnect_stale", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("reconnect when the session becomes stale"),
@@ -8402,6 +9280,22 @@ std::vector<Option> get_mds_client_options() {
     .set_default(true)
     .set_description("allow parallel processing through FUSE library"),
 
+    Option("fuse_clone_fd", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("use a separate /dev/fuse channel for each FUSE worker thread")
+    .set_long_description("Requires libfuse 3 and fuse_multithreaded.")
+    .add_see_also("fuse_multithreaded"),
+
+    Option("fuse_splice_read", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("splice the data of the writes from /dev/fuse instead of copying it"),
+
+    Option("fuse_writeback_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("let the kernel cache and coalesce the writes to this FUSE mount")
+    .set_long_description("The files opened write only are opened read-write, when permitted, since the kernel reads the pages it writes partially.")
+    .add_see_also("fuse_disable_pagecache"),
+
     Option("fuse_require_active_mds", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("require active MDSs in the file system when mounting"),
@@ -152,6 +152,57 @@ void PerfCountersCollectionImpl::with_counters(std::function<void(
 
 // ---------------------------
 
+namespace {
+
+/// the stripe of striped counters the calling thread updates
+unsigned get_stripe()
+{
+  static std::atomic<unsigned> next = { 0 };
+  thread_local unsigned stripe = next++ % PerfCounters::STRIPES;
+  return stripe;
+}
+
+template <typename T>
+void add_to_one(T& t, bool avg, uint64_t amt)
+{
+  if (avg) {
+    t.avgcount++;
+    t.u64 += amt;
+    t.avgcount2++;
+  } else {
+    t.u64 += amt;
+  }
+}
+
+void add_to(PerfCounters::perf_counter_data_any_d& data, bool avg,
+	    uint64_t amt)
+{
+  if (data.stripes) {
+    add_to_one(data.stripes[get_stripe()], avg, amt);
+  } else {
+    add_to_one(data, avg, amt);
+  }
+}
+
+/// set a striped counter by setting its first stripe and clearing the
+/// others; racing updates of the other stripes may be lost
+void set_striped(PerfCounters::perf_counter_data_any_d& data, uint64_t amt)
+{
+  for (unsigned i = 1; i < PerfCounters::STRIPES; ++i) {
+    data.stripes[i].u64 = 0;
+  }
+  auto& s = data.stripes[0];
+  if (data.type & PERFCOUNTER_LONGRUNAVG) {
+    s.avgcount++;
+    s.u64 = amt;
+    s.avgcount2++;
+  } else {
+    s.u64 = amt;
+  }
+}
+
+} // anonymous namespace
+
 PerfCounters::~PerfCounters()
 {
 }
@@ -168,13 +219,7 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt;
-    data.avgcount2++;
-  } else {
-    data.u64 += amt;
-  }
+  add_to(data, data.type & PERFCOUNTER_LONGRUNAVG, amt);
 }
 
 void PerfCounters::dec(int idx, uint64_t amt)
@@ -190,7 +235,11 @@ void PerfCounters::dec(int idx, uint64_t amt)
   ceph_assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64 -= amt;
+  if (data.stripes) {
+    data.stripes[get_stripe()].u64 -= amt;
+  } else {
+    data.u64 -= amt;
+  }
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -208,7 +257,9 @@ void PerfCounters::set(int idx, uint64_t amt)
 
   ANNOTATE_BENIGN_RACE_SIZED(&data.u64, sizeof(data.u64),
                              "perf counter atomic");
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
+  if (data.stripes) {
+    set_striped(data, amt);
+  } else if (data.type & PERFCOUNTER_LONGRUNAVG) {
     data.avgcount++;
     data.u64 = amt;
     data.avgcount2++;
@@ -229,7 +280,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64;
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -244,13 +295,7 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.to_nsec();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.to_nsec();
-  }
+  add_to(data, data.type & PERFCOUNTER_LONGRUNAVG, amt.to_nsec());
 }
 
 void PerfCounters::tinc(int idx, ceph::timespan amt)
@@ -265,13 +310,7 @@ void PerfCounters::tinc(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.count();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.count();
-  }
+  add_to(data, data.type & PERFCOUNTER_LONGRUNAVG, amt.count());
 }
 
 void PerfCounters::tset(int idx, utime_t amt)
@@ -286,7 +325,11 @@ void PerfCounters::tset(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  data.u64 = amt.to_nsec();
+  if (data.stripes) {
+    set_striped(data, amt.to_nsec());
+  } else {
+    data.u64 = amt.to_nsec();
+  }
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     ceph_abort();
 }
@@ -303,7 +346,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64;
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -451,7 +494,7 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
         d->histogram->dump_formatted(f);
         f->close_section();
       } else {
-	uint64_t v = d->u64;
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -571,6 +614,11 @@ void PerfCountersBuilder::add_impl(
   data.type = (enum perfcounter_type_d)ty;
   data.unit = (enum unit_t) unit;
   data.histogram = std::move(histogram);
+  if (striped && !data.histogram &&
+      (ty & (PERFCOUNTER_COUNTER | PERFCOUNTER_LONGRUNAVG))) {
+    data.stripes.reset(new PerfCounters::perf_counter_stripe_t[
+      PerfCounters::STRIPES]);
+  }
 }
 
 PerfCounters *PerfCountersBuilder::create_perf_counters()
@@ -113,6 +113,15 @@ public:
     prio_default = prio_;
   }
 
+  /// spread the counters and averages added from now on over per-thread
+  /// stripes, summed up when read, so that threads on different cores
+  /// updating them do not contend on the same cache line.  Gauges are
+  /// always kept in one place, set() would cost more than inc() saves.
+  void set_striped(bool s)
+  {
+    striped = s;
+  }
+
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
@@ -124,6 +133,7 @@ private:
   PerfCounters *m_perf_counters;
 
   int prio_default = 0;
+  bool striped = false;
 };
 
 /*
@@ -154,6 +164,26 @@ private:
 class PerfCounters
 {
 public:
+  /// number of stripes of a striped counter, threads are assigned one
+  /// round robin when they first update one
+  static constexpr unsigned STRIPES = 16;
+
+  /// one stripe of a striped counter, a cache line of its own
+  struct alignas(64) perf_counter_stripe_t {
+    std::atomic<uint64_t> u64 = { 0 };
+    std::atomic<uint64_t> avgcount = { 0 };
+    std::atomic<uint64_t> avgcount2 = { 0 };
+
+    std::pair<uint64_t,uint64_t> read_avg() const {
+      uint64_t sum, count;
+      do {
+	count = avgcount2;
+	sum = u64;
+      } while (avgcount != count);
+      return { sum, count };
+    }
+  };
+
   /** Represents a PerfCounters data element. */
   struct perf_counter_data_any_d {
     perf_counter_data_any_d()
@@ -169,7 +199,7 @@ public:
         nick(other.nick),
 	 type(other.type),
 	 unit(other.unit),
-	 u64(other.u64.load()) {
+	 u64(other.read_u64()) {
       auto a = other.read_avg();
       u64 = a.first;
       avgcount = a.second;
@@ -189,6 +219,9 @@ public:
     std::atomic<uint64_t> avgcount = { 0 };
     std::atomic<uint64_t> avgcount2 = { 0 };
     std::unique_ptr<PerfHistogram<>> histogram;
+    /// if set, the value is the sum of the STRIPES stripes and u64,
+    /// avgcount and avgcount2 are unused
+    std::unique_ptr<perf_counter_stripe_t[]> stripes;
 
     void reset()
     {
@@ -196,16 +229,45 @@ public:
 	    u64 = 0;
 	    avgcount = 0;
 	    avgcount2 = 0;
+	if (stripes) {
+	  for (unsigned i = 0; i < STRIPES; ++i) {
+	    stripes[i].u64 = 0;
+	    stripes[i].avgcount = 0;
+	    stripes[i].avgcount2 = 0;
+	  }
+	}
       }
       if (histogram) {
         histogram->reset();
       }
     }
 
+    uint64_t read_u64() const {
+      if (!stripes) {
+	return u64;
+      }
+      uint64_t sum = 0;
+      for (unsigned i = 0; i < STRIPES; ++i) {
+	sum += stripes[i].u64;
+      }
+      return sum;
+    }
+
     // read <sum, count> safely by making sure the post- and pre-count
     // are identical; in other words the whole loop needs to be run
-    // without any intervening calls to inc, set, or tinc.
+    // without any intervening calls to inc, set, or tinc.  The stripes
+    // of a striped counter are read one after the other, each of them
+    // consistent on its own.
     std::pair<uint64_t,uint64_t> read_avg() const {
+      if (stripes) {
+	uint64_t sum = 0, count = 0;
+	for (unsigned i = 0; i < STRIPES; ++i) {
+	  auto a = stripes[i].read_avg();
+	  sum += a.first;
+	  count += a.second;
+	}
+	return { sum, count };
+      }
       uint64_t sum, count;
       do {
 	count = avgcount2;
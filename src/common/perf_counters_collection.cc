@@ -52,6 +52,25 @@ void PerfCountersCollection::with_counters(std::function<void(const PerfCounters
   std::lock_guard lck(m_lock);
   perf_impl.with_counters(fn);
 }
+int PerfCountersCollection::publish_shm(const std::string& path)
+{
+  std::lock_guard lck(m_lock);
+  if (shm && shm->get_path() != path) {
+    shm.reset();
+  }
+  if (path.empty()) {
+    return 0;
+  }
+  if (!shm) {
+    shm = std::make_unique<PerfCountersShm>(path);
+  }
+  int r = 0;
+  perf_impl.with_counters([this, &r](
+      const PerfCountersCollectionImpl::CounterMap& by_path) {
+    r = shm->publish(by_path);
+  });
+  return r;
+}
 void PerfCountersDeleter::operator()(PerfCounters* p) noexcept
 {
   if (cct)
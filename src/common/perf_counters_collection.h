@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common/perf_counters.h"
+#include "common/perf_counters_shm.h"
 #include "common/ceph_mutex.h"
 #include "include/common_fwd.h"
 
@@ -12,6 +13,8 @@ class PerfCountersCollection
   /** Protects perf_impl->m_loggers */
   mutable ceph::mutex m_lock;
   PerfCountersCollectionImpl perf_impl;
+  /// where the counters are published for other processes, if anywhere
+  std::unique_ptr<PerfCountersShm> shm;
 public:
   PerfCountersCollection(CephContext *cct);
   ~PerfCountersCollection();
@@ -29,6 +32,10 @@ public:
 
   void with_counters(std::function<void(const PerfCountersCollectionImpl::CounterMap &)>) const;
 
+  /// publish the current values into the file at path, see
+  /// PerfCountersShm; an empty path removes the file published last
+  int publish_shm(const std::string& path);
+
   friend class PerfCountersCollectionTest;
 };
 
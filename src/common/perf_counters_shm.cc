@@ -0,0 +1,263 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/perf_counters_shm.h"
+#include "include/compat.h"
+
+namespace ceph::common {
+
+namespace {
+
+bool published(const PerfCounters::perf_counter_data_any_d& data)
+{
+  return !(data.type & PERFCOUNTER_HISTOGRAM);
+}
+
+perf_shm_entry_t *get_entries(void *map)
+{
+  return reinterpret_cast<perf_shm_entry_t*>(
+    static_cast<char*>(map) + sizeof(perf_shm_header_t));
+}
+
+} // anonymous namespace
+
+PerfCountersShm::~PerfCountersShm()
+{
+  if (map) {
+    release(true);
+    ::unlink(path.c_str());
+  }
+}
+
+void PerfCountersShm::release(bool stale)
+{
+  if (!map) {
+    return;
+  }
+  if (stale) {
+    auto h = static_cast<perf_shm_header_t*>(map);
+    __atomic_store_n(&h->flags, h->flags | PERF_SHM_STALE, __ATOMIC_RELEASE);
+  }
+  ::munmap(map, map_len);
+  map = nullptr;
+  map_len = 0;
+  paths.clear();
+}
+
+int PerfCountersShm::create(
+  const PerfCountersCollectionImpl::CounterMap& by_path)
+{
+  std::vector<std::string> new_paths;
+  size_t paths_len = 0;
+  for (auto& [p, ref] : by_path) {
+    if (published(*ref.data)) {
+      new_paths.push_back(p);
+      paths_len += p.size() + 1;
+    }
+  }
+  const size_t paths_off = sizeof(perf_shm_header_t) +
+    new_paths.size() * sizeof(perf_shm_entry_t);
+  const size_t len = paths_off + paths_len;
+
+  // build the new file aside and move it over the old one, so that readers
+  // always find a complete one at path
+  const std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return -errno;
+  }
+  if (::ftruncate(fd, len) < 0) {
+    int r = -errno;
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    ::unlink(tmp.c_str());
+    return r;
+  }
+  void *m = ::mmap(nullptr, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  int r = m == MAP_FAILED ? -errno : 0;
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  if (r < 0) {
+    ::unlink(tmp.c_str());
+    return r;
+  }
+
+  auto h = static_cast<perf_shm_header_t*>(m);
+  memcpy(h->magic, PERF_SHM_MAGIC, sizeof(h->magic));
+  h->version = PERF_SHM_VERSION;
+  h->flags = 0;
+  h->seq = 0;
+  h->stamp = 0;
+  h->header_len = sizeof(perf_shm_header_t);
+  h->entry_len = sizeof(perf_shm_entry_t);
+  h->num_entries = new_paths.size();
+  h->pid = getpid();
+  h->paths_off = paths_off;
+  h->paths_len = paths_len;
+  auto e = get_entries(m);
+  char *s = static_cast<char*>(m) + paths_off;
+  uint32_t off = 0;
+  for (auto& p : new_paths) {
+    auto& ref = by_path.at(p);
+    e->path_off = off;
+    e->type = ref.data->type;
+    e->unit = ref.data->unit;
+    e->prio = ref.perf_counters->get_adjusted_priority(ref.data->prio);
+    e->pad = 0;
+    e->value = 0;
+    e->count = 0;
+    memcpy(s + off, p.c_str(), p.size() + 1);
+    off += p.size() + 1;
+    ++e;
+  }
+
+  if (::rename(tmp.c_str(), path.c_str()) < 0) {
+    r = -errno;
+    ::munmap(m, len);
+    ::unlink(tmp.c_str());
+    return r;
+  }
+  release(true);
+  map = m;
+  map_len = len;
+  paths.swap(new_paths);
+  return 0;
+}
+
+int PerfCountersShm::publish(
+  const PerfCountersCollectionImpl::CounterMap& by_path)
+{
+  // the layout of the file changes only with the set of counters
+  bool same = map != nullptr;
+  if (same) {
+    auto p = paths.begin();
+    for (auto& [name, ref] : by_path) {
+      if (!published(*ref.data)) {
+	continue;
+      }
+      if (p == paths.end() || *p != name) {
+	same = false;
+	break;
+      }
+      ++p;
+    }
+    same = same && p == paths.end();
+  }
+  if (!same) {
+    int r = create(by_path);
+    if (r < 0) {
+      return r;
+    }
+  }
+
+  auto h = static_cast<perf_shm_header_t*>(map);
+  uint64_t seq = h->seq;
+  __atomic_store_n(&h->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  auto e = get_entries(map);
+  for (auto& p : paths) {
+    auto& ref = by_path.at(p);
+    auto data = ref.data;
+    if (data->type & PERFCOUNTER_LONGRUNAVG) {
+      auto a = data->read_avg();
+      e->value = a.first;
+      e->count = a.second;
+    } else {
+      e->value = data->read_u64();
+    }
+    e->prio = ref.perf_counters->get_adjusted_priority(data->prio);
+    ++e;
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  h->stamp = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  __atomic_store_n(&h->seq, seq + 2, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int PerfCountersShm::read(const std::string& path,
+			  std::vector<value_t> *values,
+			  uint64_t *stamp)
+{
+  int fd = ::open(path.c_str(), O_RDONLY|O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int r = -errno;
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    return r;
+  }
+  size_t len = st.st_size;
+  if (len < sizeof(perf_shm_header_t)) {
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    return -EINVAL;
+  }
+  void *m = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  int r = m == MAP_FAILED ? -errno : 0;
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  if (r < 0) {
+    return r;
+  }
+
+  auto h = static_cast<const perf_shm_header_t*>(m);
+  if (memcmp(h->magic, PERF_SHM_MAGIC, sizeof(h->magic)) ||
+      h->version != PERF_SHM_VERSION ||
+      h->header_len < sizeof(perf_shm_header_t) ||
+      h->entry_len < sizeof(perf_shm_entry_t) ||
+      h->paths_off + h->paths_len > len ||
+      h->header_len + (uint64_t)h->num_entries * h->entry_len > h->paths_off) {
+    ::munmap(m, len);
+    return -EINVAL;
+  }
+  const char *base = static_cast<const char*>(m);
+  const char *paths = base + h->paths_off;
+  values->resize(h->num_entries);
+  for (uint32_t i = 0; i < h->num_entries; ++i) {
+    auto e = reinterpret_cast<const perf_shm_entry_t*>(
+      base + h->header_len + i * h->entry_len);
+    auto& v = (*values)[i];
+    if (e->path_off >= h->paths_len) {
+      ::munmap(m, len);
+      return -EINVAL;
+    }
+    v.path.assign(paths + e->path_off,
+		  strnlen(paths + e->path_off, h->paths_len - e->path_off));
+    v.type = e->type;
+    v.unit = e->unit;
+    v.prio = e->prio;
+  }
+
+  // a writer that dies half way leaves seq odd, do not wait for it forever
+  r = -EAGAIN;
+  for (int tries = 0; tries < 1000; ++tries) {
+    uint64_t seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+      continue;
+    }
+    for (uint32_t i = 0; i < h->num_entries; ++i) {
+      auto e = reinterpret_cast<const perf_shm_entry_t*>(
+	base + h->header_len + i * h->entry_len);
+      (*values)[i].value = e->value;
+      (*values)[i].count = e->count;
+    }
+    if (stamp) {
+      *stamp = h->stamp;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) == seq) {
+      r = 0;
+      break;
+    }
+  }
+  ::munmap(m, len);
+  return r;
+}
+
+}
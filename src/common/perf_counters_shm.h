@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/perf_counters.h"
+
+namespace ceph::common {
+
+/*
+ * The perf counters of a process as published by PerfCountersShm, in host
+ * byte order:
+ *
+ *   perf_shm_header_t
+ *   perf_shm_entry_t[num_entries]
+ *   the paths of the entries, "<logger>.<counter>", each NUL terminated
+ *
+ * The values are rewritten in place on every publish, with seq incremented
+ * before and after, so it is odd while they are being written: a reader
+ * copies them out and retries if seq was odd or has changed meanwhile.
+ * When counters come or go the file is replaced by a new one, and the old
+ * one is flagged PERF_SHM_STALE for readers to open the path again.
+ * Readers should check version, header_len and entry_len, and skip the
+ * fields they do not know of a longer header or entry.
+ */
+static constexpr char PERF_SHM_MAGIC[8] = {'C','E','P','H','P','E','R','F'};
+static constexpr uint32_t PERF_SHM_VERSION = 1;
+static constexpr uint32_t PERF_SHM_STALE = 1;
+
+struct perf_shm_header_t {
+  char magic[8];        ///< PERF_SHM_MAGIC
+  uint32_t version;     ///< PERF_SHM_VERSION
+  uint32_t flags;       ///< PERF_SHM_*
+  uint64_t seq;         ///< odd while the values are being written
+  uint64_t stamp;       ///< CLOCK_REALTIME of the last publish, in ns
+  uint32_t header_len;  ///< sizeof(perf_shm_header_t)
+  uint32_t entry_len;   ///< sizeof(perf_shm_entry_t)
+  uint32_t num_entries;
+  uint32_t pid;
+  uint64_t paths_off;   ///< offset of the paths from the start of the file
+  uint64_t paths_len;
+};
+static_assert(sizeof(perf_shm_header_t) == 64);
+
+struct perf_shm_entry_t {
+  uint32_t path_off;    ///< offset of the path from paths_off
+  uint8_t type;         ///< perfcounter_type_d
+  uint8_t unit;         ///< unit_t
+  uint8_t prio;         ///< priority, as adjusted by the PerfCounters
+  uint8_t pad;
+  uint64_t value;       ///< value, or sum of an average; in ns for times
+  uint64_t count;       ///< number of samples of an average
+};
+static_assert(sizeof(perf_shm_entry_t) == 24);
+
+/// Publishes the counters of a PerfCountersCollection into a file,
+/// normally on tmpfs, that other processes on the host can map and read
+/// without talking to us.  Histograms are not published.
+class PerfCountersShm {
+public:
+  explicit PerfCountersShm(const std::string& path)
+    : path(path) {}
+  ~PerfCountersShm();
+
+  const std::string& get_path() const {
+    return path;
+  }
+
+  int publish(const PerfCountersCollectionImpl::CounterMap& by_path);
+
+  struct value_t {
+    std::string path;
+    uint8_t type;
+    uint8_t unit;
+    uint8_t prio;
+    uint64_t value;
+    uint64_t count;
+  };
+  /// read a consistent snapshot of the counters published at path
+  static int read(const std::string& path, std::vector<value_t> *values,
+		  uint64_t *stamp = nullptr);
+
+private:
+  int create(const PerfCountersCollectionImpl::CounterMap& by_path);
+  void release(bool stale);
+
+  const std::string path;
+  /// paths of the entries of the mapped file
+  std::vector<std::string> paths;
+  void *map = nullptr;
+  size_t map_len = 0;
+};
+
+}
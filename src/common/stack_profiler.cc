@@ -0,0 +1,332 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <cinttypes>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <cxxabi.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "common/stack_profiler.h"
+#include "common/ceph_context.h"
+#include "common/ceph_time.h"
+#include "common/debug.h"
+#include "common/errno.h"
+#include "include/compat.h"
+
+#define dout_subsys ceph_subsys_
+#undef dout_prefix
+#define dout_prefix *_dout << "stack_profiler "
+
+namespace ceph::common {
+
+#ifdef __linux__
+
+namespace {
+
+// 64 KiB with 4 KiB pages, enough for a thread for well over the poll
+// interval at the highest frequency
+constexpr unsigned RING_PAGES = 16;
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(100);
+/// stands for the kernel part of a stack
+constexpr uint64_t KERNEL_FRAME = 0;
+
+struct sampled_thread_t {
+  pid_t tid;
+  std::string name;
+  int fd;
+  void *ring;
+  size_t ring_len;
+};
+
+/// thread name and frames, innermost first, to number of samples
+using stacks_t = std::map<std::pair<std::string, std::vector<uint64_t>>,
+			  uint64_t>;
+
+std::vector<pid_t> list_threads()
+{
+  std::vector<pid_t> tids;
+  DIR *d = ::opendir("/proc/self/task");
+  if (!d) {
+    return tids;
+  }
+  while (auto e = ::readdir(d)) {
+    if (e->d_name[0] != '.') {
+      tids.push_back(atoi(e->d_name));
+    }
+  }
+  ::closedir(d);
+  return tids;
+}
+
+std::string get_thread_name(pid_t tid)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/task/%d/comm", (int)tid);
+  int fd = ::open(path, O_RDONLY|O_CLOEXEC);
+  if (fd < 0) {
+    return std::to_string(tid);
+  }
+  char buf[32];
+  ssize_t n = ::read(fd, buf, sizeof(buf));
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\0')) {
+    --n;
+  }
+  if (n <= 0) {
+    return std::to_string(tid);
+  }
+  return std::string(buf, n);
+}
+
+int open_event(pid_t tid, unsigned frequency, bool kernel)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_SOFTWARE;
+  // the cpu time of the thread, not the wall clock time
+  attr.config = PERF_COUNT_SW_TASK_CLOCK;
+  attr.freq = 1;
+  attr.sample_freq = frequency;
+  attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+  attr.disabled = 1;
+  attr.exclude_kernel = !kernel;
+  attr.exclude_hv = 1;
+  return ::syscall(SYS_perf_event_open, &attr, tid, -1, -1,
+		   PERF_FLAG_FD_CLOEXEC);
+}
+
+void copy_out(const char *data, uint64_t size, uint64_t pos,
+	      void *to, size_t len)
+{
+  uint64_t off = pos % size;
+  size_t first = std::min<uint64_t>(len, size - off);
+  memcpy(to, data + off, first);
+  memcpy(static_cast<char*>(to) + first, data, len - first);
+}
+
+void drain(sampled_thread_t& t, stacks_t *stacks,
+	   uint64_t *samples, uint64_t *lost)
+{
+  auto page = static_cast<perf_event_mmap_page*>(t.ring);
+  uint64_t off = page->data_offset;
+  uint64_t size = page->data_size;
+  if (!size) {
+    // kernels before 4.1 put the data right after the first page
+    off = t.ring_len / (RING_PAGES + 1);
+    size = t.ring_len - off;
+  }
+  const char *data = static_cast<const char*>(t.ring) + off;
+  uint64_t head = __atomic_load_n(&page->data_head, __ATOMIC_ACQUIRE);
+  uint64_t tail = page->data_tail;
+  std::vector<char> rec;
+  while (tail + sizeof(perf_event_header) <= head) {
+    perf_event_header h;
+    copy_out(data, size, tail, &h, sizeof(h));
+    if (h.size < sizeof(h) || tail + h.size > head) {
+      break;
+    }
+    rec.resize(h.size);
+    copy_out(data, size, tail, rec.data(), h.size);
+    tail += h.size;
+    const char *p = rec.data() + sizeof(h);
+    const char *end = rec.data() + h.size;
+    if (h.type == PERF_RECORD_SAMPLE) {
+      // u32 pid, tid; u64 nr; u64 ips[nr]
+      p += 2 * sizeof(uint32_t);
+      uint64_t nr;
+      if (p + sizeof(nr) > end) {
+	continue;
+      }
+      memcpy(&nr, p, sizeof(nr));
+      p += sizeof(nr);
+      if (nr > (uint64_t)(end - p) / sizeof(uint64_t)) {
+	continue;
+      }
+      std::vector<uint64_t> frames;
+      frames.reserve(nr);
+      bool in_kernel = false;
+      for (uint64_t i = 0; i < nr; ++i, p += sizeof(uint64_t)) {
+	uint64_t ip;
+	memcpy(&ip, p, sizeof(ip));
+	if (ip >= (uint64_t)PERF_CONTEXT_MAX) {
+	  in_kernel = ip == (uint64_t)PERF_CONTEXT_KERNEL;
+	  if (in_kernel) {
+	    frames.push_back(KERNEL_FRAME);
+	  }
+	  continue;
+	}
+	if (!in_kernel) {
+	  frames.push_back(ip);
+	}
+      }
+      ++(*stacks)[std::make_pair(t.name, std::move(frames))];
+      ++*samples;
+    } else if (h.type == PERF_RECORD_LOST) {
+      // u64 id, lost
+      if (p + 2 * sizeof(uint64_t) <= end) {
+	uint64_t n;
+	memcpy(&n, p + sizeof(uint64_t), sizeof(n));
+	*lost += n;
+      }
+    }
+  }
+  __atomic_store_n(&page->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+std::string symbolize(uint64_t ip)
+{
+  if (ip == KERNEL_FRAME) {
+    return "[kernel]";
+  }
+  Dl_info info;
+  if (!::dladdr(reinterpret_cast<void*>(ip), &info)) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "0x%" PRIx64, ip);
+    return buf;
+  }
+  if (info.dli_sname) {
+    int status;
+    char *d = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string s = (status == 0 && d) ? d : info.dli_sname;
+    free(d);
+    return s;
+  }
+  const char *obj = info.dli_fname ? info.dli_fname : "?";
+  if (auto slash = strrchr(obj, '/'); slash) {
+    obj = slash + 1;
+  }
+  char buf[32];
+  snprintf(buf, sizeof(buf), "+0x%" PRIx64,
+	   ip - reinterpret_cast<uint64_t>(info.dli_fbase));
+  return std::string("[") + obj + buf + "]";
+}
+
+} // anonymous namespace
+
+int profile_stacks(CephContext *cct,
+		   std::chrono::milliseconds duration,
+		   unsigned frequency,
+		   ceph::Formatter *f)
+{
+  const size_t ring_len = (RING_PAGES + 1) * sysconf(_SC_PAGESIZE);
+  std::vector<sampled_thread_t> threads;
+  bool kernel = true;
+  int r = -ENOENT;
+  for (auto tid : list_threads()) {
+    int fd = open_event(tid, frequency, kernel);
+    if (fd < 0 && kernel && (errno == EACCES || errno == EPERM)) {
+      // perf_event_paranoid allows us only the user space
+      kernel = false;
+      fd = open_event(tid, frequency, kernel);
+    }
+    if (fd < 0) {
+      r = -errno;
+      if (r != -ESRCH) {
+	ldout(cct, 1) << __func__ << " unable to sample thread " << tid
+		      << ": " << cpp_strerror(r) << dendl;
+      }
+      continue;
+    }
+    void *ring = ::mmap(nullptr, ring_len, PROT_READ|PROT_WRITE, MAP_SHARED,
+			fd, 0);
+    if (ring == MAP_FAILED) {
+      r = -errno;
+      ldout(cct, 1) << __func__ << " unable to map the ring of thread " << tid
+		    << ": " << cpp_strerror(r) << dendl;
+      VOID_TEMP_FAILURE_RETRY(::close(fd));
+      continue;
+    }
+    threads.push_back({tid, get_thread_name(tid), fd, ring, ring_len});
+  }
+  if (threads.empty()) {
+    return r;
+  }
+
+  stacks_t stacks;
+  uint64_t samples = 0, lost = 0;
+  for (auto& t : threads) {
+    ::ioctl(t.fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  auto start = ceph::mono_clock::now();
+  auto deadline = start + duration;
+  for (auto now = start; now < deadline; now = ceph::mono_clock::now()) {
+    std::this_thread::sleep_for(
+      std::min<ceph::timespan>(POLL_INTERVAL, deadline - now));
+    for (auto& t : threads) {
+      drain(t, &stacks, &samples, &lost);
+    }
+  }
+  for (auto& t : threads) {
+    ::ioctl(t.fd, PERF_EVENT_IOC_DISABLE, 0);
+    drain(t, &stacks, &samples, &lost);
+    ::munmap(t.ring, t.ring_len);
+    VOID_TEMP_FAILURE_RETRY(::close(t.fd));
+  }
+  auto elapsed = ceph::mono_clock::now() - start;
+
+  // different addresses often fold into the same function
+  std::map<uint64_t, std::string> symbols;
+  std::map<std::string, uint64_t> folded;
+  for (auto& [key, count] : stacks) {
+    auto& [name, frames] = key;
+    std::string s = name;
+    for (size_t i = frames.size(); i-- > 0; ) {
+      // but for the innermost, these are return addresses, which may
+      // already belong to the next function
+      uint64_t ip = frames[i];
+      if (i > 0 && ip != KERNEL_FRAME) {
+	--ip;
+      }
+      auto p = symbols.find(ip);
+      if (p == symbols.end()) {
+	p = symbols.emplace(ip, symbolize(ip)).first;
+      }
+      s += ';';
+      s += p->second;
+    }
+    folded[s] += count;
+  }
+
+  f->open_object_section("stack_profile");
+  f->dump_float("duration", std::chrono::duration<double>(elapsed).count());
+  f->dump_unsigned("frequency", frequency);
+  f->dump_unsigned("threads", threads.size());
+  f->dump_bool("kernel", kernel);
+  f->dump_unsigned("samples", samples);
+  f->dump_unsigned("lost", lost);
+  f->open_array_section("folded");
+  for (auto& [s, count] : folded) {
+    f->dump_string("stack", s + " " + std::to_string(count));
+  }
+  f->close_section();
+  f->close_section();
+  return 0;
+}
+
+#else
+
+int profile_stacks(CephContext *cct,
+		   std::chrono::milliseconds duration,
+		   unsigned frequency,
+		   ceph::Formatter *f)
+{
+  return -EOPNOTSUPP;
+}
+
+#endif
+
+}
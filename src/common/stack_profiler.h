@@ -0,0 +1,32 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <chrono>
+
+#include "common/Formatter.h"
+#include "include/common_fwd.h"
+
+namespace ceph::common {
+
+/**
+ * Sample the stacks of every thread of this process for a while, using
+ * perf_event_open(2) on the task clock of each thread, and dump them as
+ * folded stacks, "<thread name>;<outermost frame>;...;<frame> <count>",
+ * the input of flamegraph.pl.
+ *
+ * The kernel walks the user stacks by their frame pointers, so the frames
+ * of code built without them are partly lost.  Kernel stacks are folded
+ * into a single "[kernel]" frame, and only sampled if perf_event_paranoid
+ * allows it.  Frames are named after the dynamic symbols that dladdr(3)
+ * finds, and after their object and offset otherwise.
+ *
+ * @return -errno if no thread could be sampled
+ */
+int profile_stacks(CephContext *cct,
+		   std::chrono::milliseconds duration,
+		   unsigned frequency,
+		   ceph::Formatter *f);
+
+}
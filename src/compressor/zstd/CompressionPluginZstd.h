@@ -33,6 +33,11 @@ public:
   {
     if (compressor == 0) {
       ZstdCompressor *interface = new ZstdCompressor(cct);
+      int r = interface->load_dictionary(ss);
+      if (r < 0) {
+	delete interface;
+	return r;
+      }
       compressor = CompressorRef(interface);
     }
     *cs = compressor;
@@ -25,10 +25,55 @@
 class ZstdCompressor : public Compressor {
  public:
   ZstdCompressor(CephContext *cct) : Compressor(COMP_ALG_ZSTD, "zstd"), cct(cct) {}
+  ~ZstdCompressor() override {
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeDDict(ddict);
+  }
+
+  /*
+   * Load the dictionary of compressor_zstd_dictionary, if any. It has to be
+   * trained (e.g. with zstd --train on samples of the objects) so that the
+   * frames record its id, and must stay available to read them back.
+   */
+  int load_dictionary(std::ostream *ss) {
+    const auto path = cct->_conf.get_val<std::string>(
+      "compressor_zstd_dictionary");
+    if (path.empty()) {
+      return 0;
+    }
+    ceph::buffer::list bl;
+    std::string err;
+    int r = bl.read_file(path.c_str(), &err);
+    if (r < 0) {
+      *ss << "unable to read zstd dictionary " << path << ": " << err;
+      return r;
+    }
+    const char *buf = bl.c_str();
+    dict_id = ZSTD_getDictID_fromDict(buf, bl.length());
+    if (dict_id == 0) {
+      *ss << "zstd dictionary " << path << " is not a trained dictionary";
+      return -EINVAL;
+    }
+    cdict = ZSTD_createCDict(buf, bl.length(),
+			     cct->_conf->compressor_zstd_level);
+    ddict = ZSTD_createDDict(buf, bl.length());
+    if (!cdict || !ddict) {
+      *ss << "unable to load zstd dictionary " << path;
+      return -EINVAL;
+    }
+    return 0;
+  }
 
   int compress(const ceph::buffer::list &src, ceph::buffer::list &dst) override {
     ZSTD_CStream *s = ZSTD_createCStream();
-    ZSTD_initCStream_srcSize(s, cct->_conf->compressor_zstd_level, src.length());
+    if (cdict) {
+      // the level is the one the dictionary was digested with
+      ZSTD_CCtx_refCDict(s, cdict);
+      ZSTD_CCtx_setPledgedSrcSize(s, src.length());
+    } else {
+      ZSTD_initCStream_srcSize(s, cct->_conf->compressor_zstd_level,
+			       src.length());
+    }
     auto p = src.begin();
     size_t left = src.length();
 
@@ -76,6 +121,16 @@ class ZstdCompressor : public Compressor {
     uint32_t dst_len;
     ceph::decode(dst_len, p);
 
+    // a frame compressed with a dictionary can only be read with it
+    char header[ZSTD_FRAMEHEADERSIZE_MAX];
+    size_t header_len = std::min(compressed_len, sizeof(header));
+    auto q = p;
+    q.copy(header_len, header);
+    unsigned frame_dict_id = ZSTD_getDictID_fromFrame(header, header_len);
+    if (frame_dict_id && frame_dict_id != dict_id) {
+      return -EIO;
+    }
+
     ceph::buffer::ptr dstptr(dst_len);
     ZSTD_outBuffer_s outbuf;
     outbuf.dst = dstptr.c_str();
@@ -83,6 +138,9 @@ class ZstdCompressor : public Compressor {
     outbuf.pos = 0;
     ZSTD_DStream *s = ZSTD_createDStream();
     ZSTD_initDStream(s);
+    if (frame_dict_id) {
+      ZSTD_DCtx_refDDict(s, ddict);
+    }
     while (compressed_len > 0) {
       if (p.end()) {
 	return -1;
@@ -101,6 +159,9 @@ class ZstdCompressor : public Compressor {
   }
  private:
   CephContext *const cct;
+  ZSTD_CDict *cdict = nullptr;
+  ZSTD_DDict *ddict = nullptr;
+  unsigned dict_id = 0;
 };
 
 #endif
@@ -15,6 +15,7 @@
 #include "crimson/common/log.h"
 #include "crimson/osd/exceptions.h"
 #include "crimson/osd/osd.h"
+#include "crimson/osd/osd_bench.h"
 
 using crimson::osd::OSD;
 using namespace crimson::common;
@@ -79,6 +80,66 @@ private:
 template std::unique_ptr<AdminSocketHook>
 make_asok_hook<SendBeaconHook>(crimson::osd::OSD& osd);
 
+/**
+ * An OSD admin hook: write to the pgs of the OSD, as a client would, but
+ * without going through the messenger
+ */
+class OsdBenchHook : public AdminSocketHook {
+public:
+  explicit OsdBenchHook(crimson::osd::OSD& osd) :
+    AdminSocketHook("bench",
+		    "bench name=count,type=CephInt,req=false "
+		    "name=size,type=CephInt,req=false "
+		    "name=object_num,type=CephInt,req=false "
+		    "name=concurrency,type=CephInt,req=false",
+		    "OSD benchmark: write <count> bytes, in ops of <size> "
+		    "bytes to <object_num> objects, keeping <concurrency> ops "
+		    "in flight"),
+    osd(osd)
+  {}
+  seastar::future<tell_result_t> call(const cmdmap_t& cmdmap,
+				      std::string_view format,
+				      ceph::bufferlist&& input) const final
+  {
+    crimson::osd::OSDBench::params_t params;
+    int64_t count = params.count;
+    int64_t size = params.size;
+    int64_t object_num = params.object_num;
+    int64_t concurrency = params.concurrency;
+    cmd_getval(cmdmap, "count", count);
+    cmd_getval(cmdmap, "size", size);
+    cmd_getval(cmdmap, "object_num", object_num);
+    cmd_getval(cmdmap, "concurrency", concurrency);
+    if (count <= 0 || size <= 0 || object_num < 0 || concurrency <= 0) {
+      return seastar::make_ready_future<tell_result_t>(
+        tell_result_t{-EINVAL, "count, size and concurrency must be positive"});
+    }
+    params.count = count;
+    params.size = size;
+    params.object_num = object_num;
+    params.concurrency = concurrency;
+    unique_ptr<Formatter> f{Formatter::create(format, "json-pretty", "json-pretty")};
+    return seastar::do_with(std::move(f), crimson::osd::OSDBench{osd, params},
+      [](auto& f, auto& bench) {
+      return bench.run(f.get()).then([&f](int r) {
+        if (r == -EAGAIN) {
+          return seastar::make_ready_future<tell_result_t>(
+            tell_result_t{r, "not primary of any active replicated pg"});
+        } else if (r < 0) {
+          return seastar::make_ready_future<tell_result_t>(
+            tell_result_t{r, "an op of the benchmark failed"});
+        } else {
+          return seastar::make_ready_future<tell_result_t>(f.get());
+        }
+      });
+    });
+  }
+private:
+  crimson::osd::OSD& osd;
+};
+template std::unique_ptr<AdminSocketHook>
+make_asok_hook<OsdBenchHook>(crimson::osd::OSD& osd);
+
 /**
  * A CephContext admin hook: listing the configuration values
  */
@@ -10,6 +10,7 @@ namespace crimson::admin {
 
 class OsdStatusHook;
 class SendBeaconHook;
+class OsdBenchHook;
 class ConfigShowHook;
 class ConfigGetHook;
 class ConfigSetHook;
@@ -155,6 +155,15 @@ public:
     });
   }
 
+  seastar::future<>
+  update_mon_vals(const std::map<std::string,std::string,std::less<>>& changed,
+		  const std::set<std::string>& removed) {
+    return do_change([changed, removed, this](ConfigValues& values) {
+      get_config().update_mon_vals(nullptr, values, obs_mgr, changed, removed,
+				   nullptr);
+    });
+  }
+
   void show_config(ceph::Formatter* f) const;
 
   seastar::future<> parse_argv(std::vector<const char*>& argv) {
@@ -877,6 +877,9 @@ seastar::future<> Client::handle_log_ack(Ref<MLogAck> m)
 
 seastar::future<> Client::handle_config(Ref<MConfig> m)
 {
+  if (m->incremental) {
+    return crimson::common::local_conf().update_mon_vals(m->config, m->removed);
+  }
   return crimson::common::local_conf().set_mon_vals(m->config);
 }
 
@@ -323,18 +323,18 @@ seastar::future<> ProtocolV2::read_frame_payload()
     [this] {
       // description of current segment to read
       const auto& cur_rx_desc = rx_segments_desc.at(rx_segments_data.size());
-      // TODO: create aligned and contiguous buffer from socket
+      // TODO: create aligned buffer from socket
       if (cur_rx_desc.alignment != segment_t::DEFAULT_ALIGNMENT) {
         logger().trace("{} cannot allocate {} aligned buffer at segment desc index {}",
                        conn, cur_rx_desc.alignment, rx_segments_data.size());
       }
-      // TODO: create aligned and contiguous buffer from socket
-      return read_exactly(cur_rx_desc.length)
-      .then([this] (auto tmp_bl) {
+      // the segment is kept in the buffers of the socket, which are not
+      // copied into a contiguous one, for the message data not to be copied
+      // on its way to where it is consumed
+      return read(cur_rx_desc.length)
+      .then([this] (auto data) {
         logger().trace("{} RECV({}) frame segment[{}]",
-                       conn, tmp_bl.size(), rx_segments_data.size());
-        bufferlist data;
-        data.append(buffer::create(std::move(tmp_bl)));
+                       conn, data.length(), rx_segments_data.size());
         if (session_stream_handlers.rx) {
           // TODO
           ceph_assert(false);
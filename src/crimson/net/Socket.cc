@@ -54,6 +54,52 @@ struct bufferlist_consumer {
   };
 };
 
+// an input_stream consumer that reads the given number of remaining bytes
+// into a contiguous buffer: the front of a buffer segment is shared if it
+// has all of them, otherwise they are copied into a buffer of their own
+struct contiguous_consumer {
+  seastar::temporary_buffer<char>& buf;
+  size_t& remaining;
+
+  contiguous_consumer(seastar::temporary_buffer<char>& buf, size_t& remaining)
+    : buf(buf), remaining(remaining) {}
+
+  using tmp_buf = seastar::temporary_buffer<char>;
+  using consumption_result_type = typename seastar::input_stream<char>::consumption_result_type;
+
+  static inline thread_local uint64_t bytes_copied = 0;
+
+  seastar::future<consumption_result_type> operator()(tmp_buf&& data) {
+    if (data.empty()) {
+      // eof
+      return seastar::make_ready_future<consumption_result_type>(
+          seastar::continue_consuming{});
+    }
+    if (buf.empty() && data.size() >= remaining) {
+      buf = data.share(0, remaining);
+      data.trim_front(remaining);
+      remaining = 0;
+      return seastar::make_ready_future<consumption_result_type>(
+          consumption_result_type::stop_consuming_type{std::move(data)});
+    }
+    if (buf.empty()) {
+      buf = tmp_buf(remaining);
+    }
+    const size_t n = std::min(remaining, data.size());
+    std::copy_n(data.get(), n, buf.get_write() + buf.size() - remaining);
+    bytes_copied += n;
+    remaining -= n;
+    data.trim_front(n);
+    if (remaining > 0) {
+      return seastar::make_ready_future<consumption_result_type>(
+          seastar::continue_consuming{});
+    } else {
+      return seastar::make_ready_future<consumption_result_type>(
+          consumption_result_type::stop_consuming_type{std::move(data)});
+    }
+  };
+};
+
 } // anonymous namespace
 
 seastar::future<bufferlist> Socket::read(size_t bytes)
@@ -90,11 +136,13 @@ Socket::read_exactly(size_t bytes) {
     if (bytes == 0) {
       return seastar::make_ready_future<seastar::temporary_buffer<char>>();
     }
-    return in.read_exactly(bytes).then([](auto buf) {
-      if (buf.empty()) {
+    re.buffer = tmp_buf{};
+    re.remaining = bytes;
+    return in.consume(contiguous_consumer{re.buffer, re.remaining}).then([this] {
+      if (re.remaining) { // throw on short reads
         throw std::system_error(make_error_code(error::read_eof));
       }
-      return seastar::make_ready_future<tmp_buf>(std::move(buf));
+      return seastar::make_ready_future<tmp_buf>(std::move(re.buffer));
     });
 #ifdef UNIT_TESTS_BUILT
   }).then([this] (auto buf) {
@@ -106,6 +154,11 @@ Socket::read_exactly(size_t bytes) {
 #endif
 }
 
+uint64_t Socket::get_read_bytes_copied()
+{
+  return contiguous_consumer::bytes_copied;
+}
+
 void Socket::shutdown() {
   socket.shutdown_input();
   socket.shutdown_output();
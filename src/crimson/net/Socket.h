@@ -66,7 +66,11 @@ class Socket
   seastar::future<bufferlist> read(size_t bytes);
   using tmp_buf = seastar::temporary_buffer<char>;
   using packet = seastar::net::packet;
+  /// read the requested number of bytes into a contiguous buffer, which
+  /// means a copy if they span the buffer segments of the stream
   seastar::future<tmp_buf> read_exactly(size_t bytes);
+  /// bytes copied by read_exactly() on this reactor
+  static uint64_t get_read_bytes_copied();
 
   seastar::future<> write(packet&& buf) {
 #ifdef UNIT_TESTS_BUILT
@@ -144,6 +148,11 @@ class Socket
     bufferlist buffer;
     size_t remaining;
   } r;
+  /// buffer state for read_exactly()
+  struct {
+    tmp_buf buffer;
+    size_t remaining;
+  } re;
 
 #ifdef UNIT_TESTS_BUILT
  public:
@@ -1,5 +1,6 @@
 #include "futurized_store.h"
 #include "cyanstore/cyan_store.h"
+#include "seastore/seastore.h"
 #include "alienstore/alien_store.h"
 
 namespace crimson::os {
@@ -11,6 +12,8 @@ FuturizedStore::create(const std::string& type,
 {
   if (type == "memstore") {
     return std::make_unique<crimson::os::CyanStore>(data);
+  } else if (type == "seastore") {
+    return std::make_unique<crimson::os::SeaStore>(data);
   } else if (type == "bluestore") {
     return std::make_unique<crimson::os::AlienStore>(data, values);
   } else {
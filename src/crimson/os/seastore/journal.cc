@@ -0,0 +1,405 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "journal.h"
+
+#include <cstring>
+#include <system_error>
+
+#include <fmt/ostream.h>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/temporary_buffer.hh>
+
+#include "include/encoding.h"
+#include "include/intarith.h"
+
+#include "crimson/common/log.h"
+
+namespace {
+  seastar::logger& logger() {
+    return crimson::get_logger(ceph_subsys_filestore);
+  }
+
+  constexpr uint64_t SUPERBLOCK_MAGIC = 0x73656173746f7265;  // "seastore"
+  constexpr uint64_t RECORD_MAGIC = 0x7365617265636f72;	     // "searecor"
+  /// magic, fsid, seq, length and crc of the payload, and crc of all that
+  constexpr size_t RECORD_HEADER_LEN = 8 + 16 + 8 + 4 + 4 + 4;
+
+  struct superblock_t {
+    uint64_t version = 0;
+    uuid_d fsid;
+    uint64_t segment_size = 0;
+    uint32_t num_segments = 0;
+    crimson::os::seastore::journal_pos_t head;
+
+    void encode(ceph::bufferlist& bl) const {
+      ENCODE_START(1, 1, bl);
+      encode(version, bl);
+      encode(fsid, bl);
+      encode(segment_size, bl);
+      encode(num_segments, bl);
+      encode(head, bl);
+      ENCODE_FINISH(bl);
+    }
+    void decode(ceph::bufferlist::const_iterator& p) {
+      DECODE_START(1, p);
+      decode(version, p);
+      decode(fsid, p);
+      decode(segment_size, p);
+      decode(num_segments, p);
+      decode(head, p);
+      DECODE_FINISH(p);
+    }
+  };
+  WRITE_CLASS_ENCODER(superblock_t)
+
+  uint64_t get_record_length(uint64_t payload_len) {
+    using crimson::os::seastore::Journal;
+    return p2roundup<uint64_t>(RECORD_HEADER_LEN + payload_len,
+			       Journal::BLOCK_SIZE);
+  }
+
+  seastar::temporary_buffer<char> to_aligned_buffer(const ceph::bufferlist& bl,
+						    size_t len)
+  {
+    using crimson::os::seastore::Journal;
+    auto buf = seastar::temporary_buffer<char>::aligned(Journal::BLOCK_SIZE,
+							len);
+    bl.begin().copy(bl.length(), buf.get_write());
+    memset(buf.get_write() + bl.length(), 0, len - bl.length());
+    return buf;
+  }
+
+  seastar::future<> write_buffer(seastar::file device,
+				 uint64_t offset,
+				 seastar::temporary_buffer<char>&& buf)
+  {
+    auto p = buf.get();
+    auto len = buf.size();
+    return device.dma_write(offset, p, len).then(
+      [device, buf = std::move(buf)](size_t written) mutable {
+      if (written != buf.size()) {
+	logger().error("short write of {} bytes out of {}",
+		       written, buf.size());
+	throw std::system_error(std::make_error_code(std::errc::io_error));
+      }
+      return device.flush();
+    });
+  }
+}
+
+namespace crimson::os::seastore {
+
+using ceph::encode;
+using ceph::decode;
+
+Journal::Journal(const std::string& path)
+  : path{path},
+    last_committed{seastar::make_ready_future<>()}
+{}
+
+Journal::~Journal() = default;
+
+seastar::future<> Journal::mkfs(const uuid_d& new_fsid,
+				uint64_t device_size,
+				uint64_t new_segment_size)
+{
+  const auto flags = (seastar::open_flags::rw |
+		      seastar::open_flags::create);
+  return seastar::open_file_dma(path, flags).then([this](seastar::file f) {
+    device = std::move(f);
+    return device.size();
+  }).then([this, device_size](uint64_t size) {
+    // a new file is grown to the configured size, a block device is taken
+    // as it is
+    if (size > 0) {
+      return seastar::make_ready_future<uint64_t>(size);
+    }
+    return device.truncate(device_size).then([device_size] {
+      return device_size;
+    });
+  }).then([this, new_fsid, new_segment_size](uint64_t size) {
+    segment_size = p2align<uint64_t>(new_segment_size, BLOCK_SIZE);
+    num_segments = size > SUPERBLOCK_SPACE ?
+      (size - SUPERBLOCK_SPACE) / segment_size : 0;
+    if (segment_size < BLOCK_SIZE || num_segments < MIN_SEGMENTS) {
+      logger().error("{}: {} bytes are too few for {} segments of {} bytes",
+		     path, size, MIN_SEGMENTS, new_segment_size);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+    }
+    fsid = new_fsid;
+    superblock_version = 0;
+    tail = head = journal_pos_t{1, 0, 0};
+    live_segments = 1;
+    logger().info("{}: {} segments of {} bytes", path, num_segments,
+		  segment_size);
+    // neither what the other slot has nor what the first record of an
+    // earlier fs with the same fsid is ours
+    ceph::bufferlist zeros;
+    return seastar::when_all_succeed(
+      write_buffer(device, BLOCK_SIZE, to_aligned_buffer(zeros, BLOCK_SIZE)),
+      write_buffer(device, get_offset(0, 0),
+		   to_aligned_buffer(zeros, BLOCK_SIZE))).discard_result();
+  }).then([this] {
+    return write_superblock(head);
+  });
+}
+
+seastar::future<> Journal::open()
+{
+  return seastar::open_file_dma(path, seastar::open_flags::rw).then(
+    [this](seastar::file f) {
+    device = std::move(f);
+    return read_superblock();
+  });
+}
+
+seastar::future<> Journal::close()
+{
+  return last_committed.get_future().finally([this] {
+    return device.close();
+  });
+}
+
+seastar::future<> Journal::write_superblock(journal_pos_t new_head)
+{
+  superblock_t sb;
+  sb.version = superblock_version;
+  sb.fsid = fsid;
+  sb.segment_size = segment_size;
+  sb.num_segments = num_segments;
+  sb.head = new_head;
+  ceph::bufferlist payload;
+  encode(sb, payload);
+  ceph::bufferlist bl;
+  encode(SUPERBLOCK_MAGIC, bl);
+  encode(payload, bl);
+  encode(payload.crc32c(-1), bl);
+  ceph_assert(bl.length() <= BLOCK_SIZE);
+  return write_buffer(device, (superblock_version % 2) * BLOCK_SIZE,
+		      to_aligned_buffer(bl, BLOCK_SIZE));
+}
+
+seastar::future<> Journal::read_superblock()
+{
+  return device.dma_read_exactly<char>(0, SUPERBLOCK_SPACE).then(
+    [this](seastar::temporary_buffer<char> buf) {
+    std::optional<superblock_t> found;
+    for (size_t off = 0; off < SUPERBLOCK_SPACE; off += BLOCK_SIZE) {
+      ceph::bufferlist bl;
+      bl.append(buf.get() + off, BLOCK_SIZE);
+      try {
+	auto p = bl.cbegin();
+	uint64_t magic;
+	decode(magic, p);
+	if (magic != SUPERBLOCK_MAGIC) {
+	  continue;
+	}
+	ceph::bufferlist payload;
+	uint32_t crc;
+	decode(payload, p);
+	decode(crc, p);
+	if (crc != payload.crc32c(-1)) {
+	  logger().warn("{}: bad crc of superblock at {}", path, off);
+	  continue;
+	}
+	superblock_t sb;
+	auto q = payload.cbegin();
+	decode(sb, q);
+	if (!found || sb.version > found->version) {
+	  found = sb;
+	}
+      } catch (ceph::buffer::error& e) {
+	logger().warn("{}: unable to decode superblock at {}: {}",
+		      path, off, e.what());
+      }
+    }
+    if (!found) {
+      logger().error("{}: no superblock", path);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+    }
+    superblock_version = found->version;
+    fsid = found->fsid;
+    segment_size = found->segment_size;
+    num_segments = found->num_segments;
+    tail = head = found->head;
+    live_segments = 1;
+    logger().info("{}: fsid {}, {} segments of {} bytes, head at seq {}",
+		  path, fsid, num_segments, segment_size, head.seq);
+  });
+}
+
+seastar::future<std::optional<ceph::bufferlist>>
+Journal::read_record(journal_pos_t pos)
+{
+  using read_record_ret = seastar::future<std::optional<ceph::bufferlist>>;
+  if (pos.offset + BLOCK_SIZE > segment_size) {
+    return seastar::make_ready_future<std::optional<ceph::bufferlist>>();
+  }
+  const uint64_t offset = get_offset(pos.segment, pos.offset);
+  return device.dma_read_exactly<char>(offset, BLOCK_SIZE).then(
+    [this, pos, offset](seastar::temporary_buffer<char> first) -> read_record_ret {
+    ceph::bufferlist bl;
+    bl.append(first.get(), first.size());
+    auto p = bl.cbegin();
+    uint64_t magic, seq;
+    uuid_d record_fsid;
+    uint32_t length, data_crc, header_crc;
+    decode(magic, p);
+    decode(record_fsid, p);
+    decode(seq, p);
+    decode(length, p);
+    decode(data_crc, p);
+    ceph::bufferlist header;
+    header.substr_of(bl, 0, p.get_off());
+    decode(header_crc, p);
+    // anything else is what an earlier lap, or an earlier fs, left behind
+    if (magic != RECORD_MAGIC ||
+	record_fsid != fsid ||
+	seq != pos.seq ||
+	header_crc != header.crc32c(-1) ||
+	pos.offset + get_record_length(length) > segment_size) {
+      return seastar::make_ready_future<std::optional<ceph::bufferlist>>();
+    }
+    const uint64_t len = get_record_length(length);
+    auto rest = len > BLOCK_SIZE ?
+      device.dma_read_exactly<char>(offset + BLOCK_SIZE, len - BLOCK_SIZE) :
+      seastar::make_ready_future<seastar::temporary_buffer<char>>();
+    return rest.then([this, pos, bl = std::move(bl), length, data_crc]
+		     (seastar::temporary_buffer<char> rest) mutable {
+      bl.append(rest.get(), rest.size());
+      ceph::bufferlist payload;
+      payload.substr_of(bl, RECORD_HEADER_LEN, length);
+      if (payload.crc32c(-1) != data_crc) {
+	// a torn write, which was never committed
+	logger().warn("{}: bad crc of record {}", path, pos.seq);
+	return std::optional<ceph::bufferlist>();
+      }
+      return std::make_optional(std::move(payload));
+    });
+  });
+}
+
+seastar::future<> Journal::replay(replay_func_t&& f)
+{
+  return seastar::do_with(head, std::move(f), uint64_t(0),
+    [this](journal_pos_t& pos, replay_func_t& f, uint64_t& count) {
+    return seastar::repeat([this, &pos, &f, &count] {
+      return read_record(pos).then(
+	[this, &pos, &f, &count](std::optional<ceph::bufferlist>&& bl) {
+	if (bl) {
+	  pos.offset += get_record_length(bl->length());
+	  ++pos.seq;
+	  ++count;
+	  return f(std::move(*bl)).then([] {
+	    return seastar::stop_iteration::no;
+	  });
+	}
+	if (pos.offset == 0) {
+	  return seastar::make_ready_future<seastar::stop_iteration>(
+	    seastar::stop_iteration::yes);
+	}
+	// the next record may not have fit in what was left of the segment
+	pos.segment = (pos.segment + 1) % num_segments;
+	pos.offset = 0;
+	return seastar::make_ready_future<seastar::stop_iteration>(
+	  seastar::stop_iteration::no);
+      });
+    }).then([this, &pos, &count] {
+      tail = pos;
+      live_segments = get_used_segments();
+      logger().info("{}: replayed {} records, tail at seq {}",
+		    path, count, tail.seq);
+    });
+  });
+}
+
+uint32_t Journal::get_used_segments() const
+{
+  return (tail.segment + num_segments - head.segment) % num_segments + 1;
+}
+
+journal_pos_t Journal::reserve(uint64_t len)
+{
+  ceph_assert(len <= segment_size);
+  if (tail.offset + len > segment_size) {
+    uint32_t next = (tail.segment + 1) % num_segments;
+    if (next == head.segment) {
+      logger().error("{}: out of segments", path);
+      throw std::system_error(
+	std::make_error_code(std::errc::no_space_on_device));
+    }
+    tail.segment = next;
+    tail.offset = 0;
+  }
+  auto pos = tail;
+  ++tail.seq;
+  tail.offset += len;
+  return pos;
+}
+
+seastar::future<journal_pos_t> Journal::submit(ceph::bufferlist&& bl)
+{
+  if (bl.length() > get_max_record_length()) {
+    logger().error("{}: record of {} bytes does not fit in a segment",
+		   path, bl.length());
+    return seastar::make_exception_future<journal_pos_t>(
+      std::system_error(std::make_error_code(std::errc::file_too_large)));
+  }
+  const uint64_t len = get_record_length(bl.length());
+  journal_pos_t pos;
+  try {
+    pos = reserve(len);
+  } catch (...) {
+    return seastar::make_exception_future<journal_pos_t>(
+      std::current_exception());
+  }
+  ceph::bufferlist header;
+  encode(RECORD_MAGIC, header);
+  encode(fsid, header);
+  encode(pos.seq, header);
+  encode(static_cast<uint32_t>(bl.length()), header);
+  encode(bl.crc32c(-1), header);
+  encode(header.crc32c(-1), header);
+  ceph_assert(header.length() == RECORD_HEADER_LEN);
+  header.claim_append(bl);
+
+  // records are written side by side, but none of them is committed
+  // before those in front of it are
+  auto written = write_buffer(device, get_offset(pos.segment, pos.offset),
+			      to_aligned_buffer(header, len));
+  last_committed = seastar::shared_future<>(
+    seastar::when_all_succeed(last_committed.get_future(),
+			      std::move(written)).discard_result());
+  return last_committed.get_future().then([pos] {
+    return pos;
+  });
+}
+
+seastar::future<> Journal::set_head(journal_pos_t new_head)
+{
+  ++superblock_version;
+  // the segments before the new head are only reused once the superblock
+  // no longer points to them
+  return write_superblock(new_head).then([this, new_head] {
+    head = new_head;
+    live_segments = get_used_segments();
+    logger().debug("{}: head at seq {}, {} segments in use",
+		   path, head.seq, live_segments);
+  });
+}
+
+bool Journal::needs_cleaning() const
+{
+  // cleaning is worth it only if it frees most of what is in use
+  auto used = get_used_segments();
+  return used * 2 > num_segments && used > live_segments * 2;
+}
+
+uint64_t Journal::get_max_record_length() const
+{
+  return segment_size - RECORD_HEADER_LEN;
+}
+
+}
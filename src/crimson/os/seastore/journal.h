@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+
+#include <seastar/core/file.hh>
+#include <seastar/core/future.hh>
+#include <seastar/core/shared_future.hh>
+
+#include "include/buffer.h"
+#include "include/denc.h"
+#include "include/uuid.h"
+
+namespace crimson::os::seastore {
+
+/// where a record is, and the sequence number it has to carry
+struct journal_pos_t {
+  uint64_t seq = 0;
+  uint32_t segment = 0;
+  uint64_t offset = 0;
+
+  DENC(journal_pos_t, v, p) {
+    denc(v.seq, p);
+    denc(v.segment, p);
+    denc(v.offset, p);
+  }
+};
+
+/**
+ * A log of records on a device, written with direct I/O from the reactor.
+ *
+ * The device is cut into a pair of superblock slots followed by equally
+ * sized segments, which are filled one after the other and reused in a
+ * ring.  Every record is checksummed and stamped with the fsid of the
+ * device and its sequence number, so that replay stops at the first hole
+ * or stale record it runs into.  A record never spans segments; one that
+ * does not fit in what is left of a segment goes to the beginning of the
+ * next one.
+ *
+ * Nothing is ever overwritten in place: whoever writes records moves the
+ * live data forward to the tail from time to time, and then moves the head
+ * of the journal, as recorded in the superblock, past what is now garbage.
+ */
+class Journal {
+public:
+  static constexpr size_t BLOCK_SIZE = 4096;
+  /// superblocks are written in turns, for one of them to survive a
+  /// torn write
+  static constexpr uint64_t SUPERBLOCK_SPACE = 2 * BLOCK_SIZE;
+  static constexpr uint32_t MIN_SEGMENTS = 4;
+
+  explicit Journal(const std::string& path);
+  ~Journal();
+
+  /// create the device if it is a file, and write an empty journal to it
+  seastar::future<> mkfs(const uuid_d& fsid,
+			 uint64_t device_size,
+			 uint64_t segment_size);
+  seastar::future<> open();
+  seastar::future<> close();
+
+  using replay_func_t =
+    std::function<seastar::future<>(ceph::bufferlist&&)>;
+  /// feed f with every record from the head on, in order, and leave the
+  /// journal ready to take new ones after the last of them
+  seastar::future<> replay(replay_func_t&& f);
+
+  /// append a record; it is committed once it is durable, and once all
+  /// records before it are
+  /// @return the position of the record
+  seastar::future<journal_pos_t> submit(ceph::bufferlist&& bl);
+
+  /// drop everything before head, which has to be the position of a
+  /// committed record
+  seastar::future<> set_head(journal_pos_t head);
+
+  /// true if the segments in use are worth cleaning
+  bool needs_cleaning() const;
+
+  /// largest record that fits in a segment
+  uint64_t get_max_record_length() const;
+  uint64_t get_capacity() const {
+    return segment_size * num_segments;
+  }
+  uuid_d get_fsid() const {
+    return fsid;
+  }
+
+private:
+  uint64_t get_offset(uint32_t segment, uint64_t offset) const {
+    return SUPERBLOCK_SPACE + segment * segment_size + offset;
+  }
+  uint32_t get_used_segments() const;
+  /// find room for a record of len bytes at the tail
+  journal_pos_t reserve(uint64_t len);
+  seastar::future<> write_superblock(journal_pos_t new_head);
+  seastar::future<> read_superblock();
+  /// @return the payload of the record at pos, or nothing if there is no
+  /// record with pos.seq there
+  seastar::future<std::optional<ceph::bufferlist>> read_record(
+    journal_pos_t pos);
+
+  const std::string path;
+  seastar::file device;
+
+  uuid_d fsid;
+  uint64_t segment_size = 0;
+  uint32_t num_segments = 0;
+  uint64_t superblock_version = 0;
+  journal_pos_t head;
+  /// where the next record goes
+  journal_pos_t tail;
+  /// segments spanned by the live data the last time it was moved
+  uint32_t live_segments = 1;
+  seastar::shared_future<> last_committed;
+};
+
+}
+WRITE_CLASS_DENC(crimson::os::seastore::journal_pos_t)
@@ -0,0 +1,419 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "seastore.h"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <seastar/core/future-util.hh>
+
+#include "os/Transaction.h"
+
+#include "crimson/common/config_proxy.h"
+#include "crimson/os/cyanstore/cyan_collection.h"
+#include "crimson/os/cyanstore/cyan_object.h"
+#include "crimson/os/cyanstore/cyan_store.h"
+
+namespace {
+  seastar::logger& logger() {
+    return crimson::get_logger(ceph_subsys_filestore);
+  }
+
+/// turns the objects of collections into transactions that recreate them,
+/// none of which is much larger than max_bytes
+class Dumper {
+public:
+  explicit Dumper(uint64_t max_bytes)
+    : max_bytes{max_bytes}
+  {}
+
+  void dump(const crimson::os::Collection& c) {
+    const coll_t& cid = c.get_cid();
+    t.create_collection(cid, c.bits);
+    for (auto& [oid, o] : c.object_map) {
+      t.touch(cid, oid);
+      const uint64_t chunk = max_bytes / 2;
+      for (uint64_t off = 0; off < o->data.length(); off += chunk) {
+	uint64_t len = std::min<uint64_t>(chunk, o->data.length() - off);
+	ceph::bufferlist bl;
+	bl.substr_of(o->data, off, len);
+	t.write(cid, oid, off, len, bl);
+	maybe_flush();
+      }
+      for (auto& [name, value] : o->xattr) {
+	ceph::bufferlist bl;
+	bl.append(value);
+	t.setattr(cid, oid, name, bl);
+      }
+      if (o->omap_header.length()) {
+	t.omap_setheader(cid, oid, o->omap_header);
+      }
+      std::map<std::string, ceph::bufferlist> keys;
+      uint64_t bytes = 0;
+      for (auto& [key, value] : o->omap) {
+	keys.emplace(key, value);
+	bytes += key.size() + value.length();
+	if (bytes >= max_bytes / 2) {
+	  t.omap_setkeys(cid, oid, keys);
+	  keys.clear();
+	  bytes = 0;
+	  maybe_flush();
+	}
+      }
+      if (!keys.empty()) {
+	t.omap_setkeys(cid, oid, keys);
+      }
+      maybe_flush();
+    }
+  }
+
+  std::vector<ceph::bufferlist> finish() {
+    // an empty store still needs a record for the head to point to
+    if (!t.empty() || records.empty()) {
+      flush();
+    }
+    return std::move(records);
+  }
+
+private:
+  void maybe_flush() {
+    if (t.get_encoded_bytes() >= max_bytes) {
+      flush();
+    }
+  }
+  void flush() {
+    ceph::bufferlist bl;
+    t.encode(bl);
+    records.push_back(std::move(bl));
+    t = ceph::os::Transaction{};
+  }
+
+  const uint64_t max_bytes;
+  ceph::os::Transaction t;
+  std::vector<ceph::bufferlist> records;
+};
+}
+
+using crimson::common::local_conf;
+
+namespace crimson::os {
+
+SeaStore::SeaStore(const std::string& path)
+  : path{path},
+    cache{std::make_unique<CyanStore>(path)},
+    journal{path + "/block"},
+    last_applied{seastar::make_ready_future<>()},
+    cleaner{seastar::now()}
+{}
+
+SeaStore::~SeaStore() = default;
+
+seastar::future<> SeaStore::stop()
+{
+  return seastar::now();
+}
+
+seastar::future<> SeaStore::mount()
+{
+  cache = std::make_unique<CyanStore>(path);
+  return journal.open().then([this] {
+    osd_fsid = journal.get_fsid();
+    return journal.replay([this](ceph::bufferlist&& bl) {
+      return replay_record(std::move(bl));
+    });
+  });
+}
+
+seastar::future<> SeaStore::replay_record(ceph::bufferlist&& bl)
+{
+  using ceph::os::Transaction;
+  Transaction t;
+  auto p = bl.cbegin();
+  t.decode(p);
+  // the collections come to the cache as they come from the osd, before
+  // the transactions that make them
+  std::vector<coll_t> cids;
+  for (auto i = t.begin(); i.have_op(); ) {
+    if (auto op = i.decode_op(); op->op == Transaction::OP_MKCOLL) {
+      cids.push_back(i.get_cid(op->cid));
+    }
+  }
+  return seastar::do_with(std::move(cids), std::move(t),
+			  [this](auto& cids, auto& t) {
+    return seastar::do_for_each(cids, [this](const coll_t& cid) {
+      return cache->create_new_collection(cid).discard_result();
+    }).then([this, &t] {
+      return cache->do_transaction({}, std::move(t));
+    });
+  });
+}
+
+seastar::future<> SeaStore::umount()
+{
+  return std::exchange(cleaner, seastar::now()).then([this] {
+    return last_applied.get_future();
+  }).then([this] {
+    return journal.close();
+  });
+}
+
+seastar::future<> SeaStore::mkfs(uuid_d new_osd_fsid)
+{
+  return read_meta("fsid").then([=](auto&& ret) {
+    auto& [r, fsid_str] = ret;
+    if (r == -ENOENT) {
+      if (new_osd_fsid.is_zero()) {
+        osd_fsid.generate_random();
+      } else {
+        osd_fsid = new_osd_fsid;
+      }
+      return journal.mkfs(
+	osd_fsid,
+	local_conf().get_val<Option::size_t>("seastore_device_size"),
+	local_conf().get_val<Option::size_t>("seastore_segment_size")).then(
+	[this] {
+	return journal.close();
+      }).then([this] {
+	return write_meta("fsid", fmt::format("{}", osd_fsid));
+      });
+    } else if (r < 0) {
+      throw std::runtime_error("read_meta");
+    } else {
+      logger().info("{} already has fsid {}", __func__, fsid_str);
+      if (!osd_fsid.parse(fsid_str.c_str())) {
+        throw std::runtime_error("failed to parse fsid");
+      } else if (osd_fsid != new_osd_fsid) {
+        logger().error("on-disk fsid {} != provided {}", osd_fsid, new_osd_fsid);
+        throw std::runtime_error("unmatched osd_fsid");
+      } else {
+	return seastar::now();
+      }
+    }
+  }).then([this] {
+    return write_meta("type", "seastore");
+  });
+}
+
+seastar::future<store_statfs_t> SeaStore::stat() const
+{
+  return cache->stat().then([this](store_statfs_t cached) {
+    store_statfs_t st;
+    // the other half is where the live data is moved to
+    st.total = journal.get_capacity() / 2;
+    const uint64_t used = cached.total - cached.available;
+    st.available = st.total > used ? st.total - used : 0;
+    return st;
+  });
+}
+
+seastar::future<struct stat> SeaStore::stat(
+  CollectionRef c,
+  const ghobject_t& oid)
+{
+  return cache->stat(c, oid);
+}
+
+SeaStore::read_errorator::future<ceph::bufferlist> SeaStore::read(
+  CollectionRef c,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t len,
+  uint32_t op_flags)
+{
+  return cache->read(c, oid, offset, len, op_flags);
+}
+
+SeaStore::read_errorator::future<ceph::bufferlist> SeaStore::readv(
+  CollectionRef c,
+  const ghobject_t& oid,
+  interval_set<uint64_t>& m,
+  uint32_t op_flags)
+{
+  return cache->readv(c, oid, m, op_flags);
+}
+
+SeaStore::get_attr_errorator::future<ceph::bufferptr> SeaStore::get_attr(
+  CollectionRef c,
+  const ghobject_t& oid,
+  std::string_view name) const
+{
+  return cache->get_attr(c, oid, name);
+}
+
+SeaStore::get_attrs_ertr::future<SeaStore::attrs_t> SeaStore::get_attrs(
+  CollectionRef c,
+  const ghobject_t& oid)
+{
+  return cache->get_attrs(c, oid);
+}
+
+seastar::future<SeaStore::omap_values_t>
+SeaStore::omap_get_values(CollectionRef c,
+			  const ghobject_t& oid,
+			  const omap_keys_t& keys)
+{
+  return cache->omap_get_values(c, oid, keys);
+}
+
+seastar::future<std::tuple<std::vector<ghobject_t>, ghobject_t>>
+SeaStore::list_objects(CollectionRef c,
+		       const ghobject_t& start,
+		       const ghobject_t& end,
+		       uint64_t limit) const
+{
+  return cache->list_objects(c, start, end, limit);
+}
+
+seastar::future<std::tuple<bool, SeaStore::omap_values_t>>
+SeaStore::omap_get_values(CollectionRef c,
+			  const ghobject_t &oid,
+			  const std::optional<std::string> &start)
+{
+  return cache->omap_get_values(c, oid, start);
+}
+
+seastar::future<ceph::bufferlist> SeaStore::omap_get_header(
+  CollectionRef c,
+  const ghobject_t& oid)
+{
+  return cache->omap_get_header(c, oid);
+}
+
+seastar::future<CollectionRef> SeaStore::create_new_collection(const coll_t& cid)
+{
+  return cache->create_new_collection(cid);
+}
+
+seastar::future<CollectionRef> SeaStore::open_collection(const coll_t& cid)
+{
+  return cache->open_collection(cid);
+}
+
+seastar::future<std::vector<coll_t>> SeaStore::list_collections()
+{
+  return cache->list_collections();
+}
+
+seastar::future<> SeaStore::do_transaction(CollectionRef ch,
+					   ceph::os::Transaction&& t)
+{
+  return seastar::with_shared(cleaner_lock,
+			      [this, ch, t = std::move(t)]() mutable {
+    ceph::bufferlist bl;
+    t.encode(bl);
+    auto committed = journal.submit(std::move(bl));
+    // the cache completes the callbacks of the transaction, which have to
+    // wait until it is durable
+    last_applied = seastar::shared_future<>(
+      seastar::when_all_succeed(last_applied.get_future(),
+				std::move(committed)).discard_result().then(
+	[this, ch, t = std::move(t)]() mutable {
+	return cache->do_transaction(ch, std::move(t));
+      }).handle_exception([](auto ep) {
+	// there is no way back from a hole in the journal
+	logger().error("unable to journal transaction: {}", ep);
+	ceph_abort();
+      }));
+    return last_applied.get_future();
+  }).then([this] {
+    maybe_clean();
+  });
+}
+
+void SeaStore::maybe_clean()
+{
+  if (cleaning || !journal.needs_cleaning()) {
+    return;
+  }
+  cleaning = true;
+  // in the background, the transactions that come meanwhile wait for it
+  cleaner = std::exchange(cleaner, seastar::now()).then([this] {
+    return clean();
+  }).handle_exception([](auto ep) {
+    logger().error("unable to clean the journal: {}", ep);
+  }).finally([this] {
+    cleaning = false;
+  });
+}
+
+seastar::future<> SeaStore::clean()
+{
+  return seastar::with_lock(cleaner_lock, [this] {
+    // with nothing in flight, the cache has all that the journal has
+    return dump().then([this](std::vector<ceph::bufferlist>&& records) {
+      logger().debug("{}: moving {} records", __func__, records.size());
+      return seastar::do_with(std::move(records),
+			      std::optional<seastore::journal_pos_t>{},
+			      [this](auto& records, auto& head) {
+	return seastar::do_for_each(records,
+				    [this, &head](ceph::bufferlist& bl) {
+	  return journal.submit(std::move(bl)).then(
+	    [&head](seastore::journal_pos_t pos) {
+	    if (!head) {
+	      head = pos;
+	    }
+	  });
+	}).then([this, &head] {
+	  return journal.set_head(*head);
+	});
+      });
+    });
+  });
+}
+
+seastar::future<std::vector<ceph::bufferlist>> SeaStore::dump()
+{
+  return cache->list_collections().then([this](std::vector<coll_t> cids) {
+    return seastar::do_with(std::move(cids),
+			    Dumper{journal.get_max_record_length() / 2},
+			    [this](auto& cids, auto& dumper) {
+      return seastar::do_for_each(cids, [this, &dumper](const coll_t& cid) {
+	return cache->open_collection(cid).then([&dumper](CollectionRef c) {
+	  dumper.dump(static_cast<const Collection&>(*c));
+	});
+      }).then([&dumper] {
+	return dumper.finish();
+      });
+    });
+  });
+}
+
+seastar::future<> SeaStore::write_meta(const std::string& key,
+				       const std::string& value)
+{
+  return cache->write_meta(key, value);
+}
+
+seastar::future<std::tuple<int, std::string>>
+SeaStore::read_meta(const std::string& key)
+{
+  return cache->read_meta(key);
+}
+
+uuid_d SeaStore::get_fsid() const
+{
+  return osd_fsid;
+}
+
+unsigned SeaStore::get_max_attr_name_length() const
+{
+  return cache->get_max_attr_name_length();
+}
+
+seastar::future<FuturizedStore::OmapIteratorRef> SeaStore::get_omap_iterator(
+  CollectionRef c,
+  const ghobject_t& oid)
+{
+  return cache->get_omap_iterator(c, oid);
+}
+
+seastar::future<std::map<uint64_t, uint64_t>> SeaStore::fiemap(
+  CollectionRef c,
+  const ghobject_t& oid,
+  uint64_t off,
+  uint64_t len)
+{
+  return cache->fiemap(c, oid, off, len);
+}
+
+}
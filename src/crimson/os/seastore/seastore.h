@@ -0,0 +1,140 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <seastar/core/future.hh>
+#include <seastar/core/shared_future.hh>
+#include <seastar/core/shared_mutex.hh>
+
+#include "include/uuid.h"
+#include "osd/osd_types.h"
+
+#include "crimson/os/futurized_store.h"
+#include "crimson/os/seastore/journal.h"
+
+namespace ceph::os {
+class Transaction;
+}
+
+namespace crimson::os {
+class CyanStore;
+
+/**
+ * An object store that runs in the reactor, with no thread, lock or
+ * syscall in its way to the device.
+ *
+ * Every transaction is appended to the journal on the device, a log of
+ * segments, and applied to an in-memory copy of the store once it is
+ * committed; reads are served from that copy, which a CyanStore keeps.
+ * So the store is bounded by memory, and by half of the device: from time
+ * to time, the live data is written out at the tail of the journal, as
+ * transactions that recreate it, for the segments before it to be reused.
+ * Mounting the store replays the journal from there.
+ */
+class SeaStore final : public FuturizedStore {
+public:
+  SeaStore(const std::string& path);
+  ~SeaStore() final;
+
+  seastar::future<> stop() final;
+  seastar::future<> mount() final;
+  seastar::future<> umount() final;
+
+  seastar::future<> mkfs(uuid_d new_osd_fsid) final;
+  seastar::future<store_statfs_t> stat() const final;
+  seastar::future<struct stat> stat(
+    CollectionRef c,
+    const ghobject_t& oid) final;
+
+  read_errorator::future<ceph::bufferlist> read(
+    CollectionRef c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t op_flags = 0) final;
+  read_errorator::future<ceph::bufferlist> readv(
+    CollectionRef c,
+    const ghobject_t& oid,
+    interval_set<uint64_t>& m,
+    uint32_t op_flags = 0) final;
+
+  get_attr_errorator::future<ceph::bufferptr> get_attr(
+    CollectionRef c,
+    const ghobject_t& oid,
+    std::string_view name) const final;
+  get_attrs_ertr::future<attrs_t> get_attrs(
+    CollectionRef c,
+    const ghobject_t& oid) final;
+
+  seastar::future<omap_values_t> omap_get_values(
+    CollectionRef c,
+    const ghobject_t& oid,
+    const omap_keys_t& keys) final;
+
+  seastar::future<std::tuple<std::vector<ghobject_t>, ghobject_t>> list_objects(
+    CollectionRef c,
+    const ghobject_t& start,
+    const ghobject_t& end,
+    uint64_t limit) const final;
+
+  seastar::future<std::tuple<bool, omap_values_t>> omap_get_values(
+    CollectionRef c,
+    const ghobject_t &oid,
+    const std::optional<std::string> &start) final;
+
+  seastar::future<ceph::bufferlist> omap_get_header(
+    CollectionRef c,
+    const ghobject_t& oid) final;
+
+  seastar::future<CollectionRef> create_new_collection(const coll_t& cid) final;
+  seastar::future<CollectionRef> open_collection(const coll_t& cid) final;
+  seastar::future<std::vector<coll_t>> list_collections() final;
+
+  seastar::future<> do_transaction(CollectionRef ch,
+				   ceph::os::Transaction&& txn) final;
+
+  seastar::future<> write_meta(const std::string& key,
+			       const std::string& value) final;
+  seastar::future<std::tuple<int, std::string>>
+  read_meta(const std::string& key) final;
+  uuid_d get_fsid() const final;
+  unsigned get_max_attr_name_length() const final;
+
+  seastar::future<OmapIteratorRef> get_omap_iterator(
+    CollectionRef c,
+    const ghobject_t& oid) final;
+
+  seastar::future<std::map<uint64_t, uint64_t>> fiemap(
+    CollectionRef c,
+    const ghobject_t& oid,
+    uint64_t off,
+    uint64_t len) final;
+
+private:
+  seastar::future<> replay_record(ceph::bufferlist&& bl);
+  void maybe_clean();
+  /// move the live data to the tail of the journal
+  seastar::future<> clean();
+  /// @return the records of the transactions that recreate the store
+  seastar::future<std::vector<ceph::bufferlist>> dump();
+
+  const std::string path;
+  std::unique_ptr<CyanStore> cache;
+  seastore::Journal journal;
+  uuid_d osd_fsid;
+
+  /// held shared by transactions until they are applied, and exclusively
+  /// by the cleaner, for it to see all that the journal has
+  seastar::shared_mutex cleaner_lock;
+  /// transactions are applied in the order of their records
+  seastar::shared_future<> last_applied;
+  bool cleaning = false;
+  seastar::future<> cleaner;
+};
+
+}
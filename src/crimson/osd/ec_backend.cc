@@ -1,16 +1,64 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
 #include "ec_backend.h"
 
+#include <sstream>
+
+#include "erasure-code/ErasureCodePlugin.h"
+#include "messages/MOSDECSubOpRead.h"
+#include "messages/MOSDECSubOpWrite.h"
+
+#include "crimson/common/config_proxy.h"
+#include "crimson/common/log.h"
+#include "crimson/os/futurized_store.h"
+#include "crimson/osd/exceptions.h"
+#include "crimson/osd/pg.h"
 #include "crimson/osd/shard_services.h"
 
-ECBackend::ECBackend(shard_id_t shard,
+namespace {
+  seastar::logger& logger() {
+    return crimson::get_logger(ceph_subsys_osd);
+  }
+
+  ceph::ErasureCodeInterfaceRef create_ec_impl(
+    const std::map<std::string, std::string>& ec_profile)
+  {
+    ceph::ErasureCodeProfile profile{ec_profile};
+    ceph::ErasureCodeInterfaceRef ec_impl;
+    std::ostringstream ss;
+    auto plugin = profile.find("plugin");
+    if (plugin == profile.end()) {
+      throw std::runtime_error("erasure code profile without plugin");
+    }
+    const auto& dir =
+      crimson::common::local_conf().get_val<std::string>("erasure_code_dir");
+    int r = ceph::ErasureCodePluginRegistry::instance().factory(
+      plugin->second, dir, profile, &ec_impl, &ss);
+    if (r < 0 || !ec_impl) {
+      logger().error("unable to load erasure code plugin {}: {}",
+		     plugin->second, ss.str());
+      throw std::runtime_error(ss.str());
+    }
+    return ec_impl;
+  }
+}
+
+ECBackend::ECBackend(pg_t pgid,
+                     pg_shard_t whoami,
                      ECBackend::CollectionRef coll,
                      crimson::osd::ShardServices& shard_services,
-                     const ec_profile_t&,
-                     uint64_t)
-  : PGBackend{shard, coll, &shard_services.get_store()}
-{
-  // todo
-}
+                     const crimson::osd::PG& pg,
+                     const ec_profile_t& ec_profile,
+                     uint64_t stripe_width)
+  : PGBackend{whoami.shard, coll, &shard_services.get_store()},
+    pgid{pgid},
+    whoami{whoami},
+    shard_services{shard_services},
+    pg{pg},
+    ec_impl{create_ec_impl(ec_profile)},
+    sinfo{ec_impl->get_data_chunk_count(), stripe_width}
+{}
 
 ECBackend::ll_read_errorator::future<ceph::bufferlist>
 ECBackend::_read(const hobject_t& hoid,
@@ -18,8 +66,285 @@ ECBackend::_read(const hobject_t& hoid,
                  const uint64_t len,
                  const uint32_t flags)
 {
-  // todo
-  return seastar::make_ready_future<bufferlist>();
+  // the chunks are decoded a stripe at a time
+  const auto stripe_bounds =
+    sinfo.offset_len_to_stripe_bounds(std::make_pair(off, len));
+  const uint64_t stripe_off = stripe_bounds.first;
+  const auto chunk_bounds = sinfo.aligned_offset_len_to_chunk(stripe_bounds);
+  const uint64_t chunk_off = chunk_bounds.first;
+  const uint64_t chunk_len = chunk_bounds.second;
+
+  std::set<int> want;
+  const auto& chunk_mapping = ec_impl->get_chunk_mapping();
+  for (int i = 0; i < static_cast<int>(ec_impl->get_data_chunk_count()); i++) {
+    want.insert(static_cast<int>(chunk_mapping.size()) > i ?
+		chunk_mapping[i] : i);
+  }
+  std::map<int, pg_shard_t> shards;
+  std::set<int> available;
+  for (auto& pg_shard : pg.get_actingset()) {
+    shards.emplace(pg_shard.shard, pg_shard);
+    available.insert(pg_shard.shard);
+  }
+  std::map<int, std::vector<std::pair<int, int>>> need;
+  if (int r = ec_impl->minimum_to_decode(want, available, &need); r < 0) {
+    logger().error("_read: {} is not decodable from shards {}",
+		   hoid, available);
+    return crimson::ct_error::input_output_error::make();
+  }
+  // send all the sub reads before waiting for any of them
+  std::vector<std::pair<int, ll_read_errorator::future<ceph::bufferlist>>> reads;
+  for (auto& [shard, subchunks] : need) {
+    reads.emplace_back(shard, read_chunks(shards[shard], hoid,
+					  chunk_off, chunk_len, flags));
+  }
+  return seastar::do_with(std::move(reads), std::map<int, ceph::bufferlist>{},
+    [=](auto& reads, auto& chunks) {
+    return crimson::do_for_each(reads, [&chunks](auto& read) {
+      return std::move(read.second).safe_then(
+	[&chunks, shard=read.first](auto&& bl) {
+	chunks.emplace(shard, std::move(bl));
+	return ll_read_errorator::now();
+      });
+    }).safe_then([=, &chunks]() -> ll_read_errorator::future<ceph::bufferlist> {
+      for (auto& [shard, bl] : chunks) {
+	if (bl.length() != chunk_len) {
+	  logger().error("_read: {} shard {} has {} bytes of chunks, not {}",
+			 hoid, shard, bl.length(), chunk_len);
+	  return crimson::ct_error::input_output_error::make();
+	}
+      }
+      ceph::bufferlist decoded;
+      if (int r = ECUtil::decode(sinfo, ec_impl, chunks, &decoded); r < 0) {
+	logger().error("_read: unable to decode {}: {}", hoid, r);
+	return crimson::ct_error::input_output_error::make();
+      }
+      ceph::bufferlist bl;
+      const uint64_t skip = off - stripe_off;
+      bl.substr_of(decoded, skip,
+		   std::min<uint64_t>(len, decoded.length() - skip));
+      return ll_read_errorator::make_ready_future<ceph::bufferlist>(std::move(bl));
+    });
+  });
+}
+
+ECBackend::ll_read_errorator::future<ceph::bufferlist>
+ECBackend::read_chunks(pg_shard_t pg_shard,
+                       const hobject_t& hoid,
+                       uint64_t off,
+                       uint64_t len,
+                       uint32_t flags)
+{
+  if (pg_shard == whoami) {
+    return store->read(coll, ghobject_t{hoid, ghobject_t::NO_GEN, whoami.shard},
+		       off, len, flags);
+  }
+  const ceph_tid_t tid = next_tid++;
+  auto reply = pending_reads[tid].get_future();
+  auto m = make_message<MOSDECSubOpRead>();
+  m->pgid = spg_t{pgid, pg_shard.shard};
+  m->map_epoch = pg.get_osdmap_epoch();
+  m->min_epoch = pg.get_last_peering_reset();
+  m->op.from = whoami;
+  m->op.tid = tid;
+  m->op.to_read[hoid].push_back(boost::make_tuple(off, len, flags));
+  m->op.subchunks[hoid].emplace_back(0, ec_impl->get_sub_chunk_count());
+  return ll_read_errorator::future<ECSubReadReply>{
+    shard_services.send_to_osd(pg_shard.osd, std::move(m), pg.get_osdmap_epoch())
+    .then([reply=std::move(reply)]() mutable {
+      return std::move(reply);
+    })
+  }.safe_then([hoid](ECSubReadReply&& reply)
+	      -> ll_read_errorator::future<ceph::bufferlist> {
+    if (auto error = reply.errors.find(hoid); error != reply.errors.end()) {
+      if (error->second == -ENOENT) {
+	return crimson::ct_error::enoent::make();
+      } else {
+	return crimson::ct_error::input_output_error::make();
+      }
+    }
+    ceph::bufferlist bl;
+    for (auto& [off, chunks] : reply.buffers_read[hoid]) {
+      bl.claim_append(chunks);
+    }
+    return ll_read_errorator::make_ready_future<ceph::bufferlist>(std::move(bl));
+  });
+}
+
+void ECBackend::got_ec_sub_read_reply(ECSubReadReply&& reply)
+{
+  auto found = pending_reads.find(reply.tid);
+  if (found == pending_reads.end()) {
+    logger().warn("{}: no pending read for tid {}", __func__, reply.tid);
+    return;
+  }
+  found->second.set_value(std::move(reply));
+  pending_reads.erase(found);
+}
+
+int ECBackend::get_shard_transactions(
+  ceph::os::Transaction& txn,
+  const std::set<pg_shard_t>& pg_shards,
+  std::map<shard_id_t, ceph::os::Transaction>* shard_txns)
+{
+  using ceph::os::Transaction;
+  std::set<int> want;
+  for (auto& pg_shard : pg_shards) {
+    want.insert(pg_shard.shard);
+  }
+  // apply f to the transaction of every shard, with the chunks of oid
+  auto for_each_shard = [&](const ghobject_t& oid, auto&& f) {
+    for (auto& pg_shard : pg_shards) {
+      f(pg_shard.shard,
+	coll_t{spg_t{pgid, pg_shard.shard}},
+	ghobject_t{oid.hobj, ghobject_t::NO_GEN, pg_shard.shard},
+	(*shard_txns)[pg_shard.shard]);
+    }
+  };
+  for (auto i = txn.begin(); i.have_op();) {
+    auto op = i.decode_op();
+    switch (op->op) {
+    case Transaction::OP_NOP:
+      break;
+    case Transaction::OP_COLL_HINT:
+    {
+      ceph::bufferlist hint;
+      i.decode_bl(hint);
+    }
+    break;
+    case Transaction::OP_OMAP_SETKEYS:
+    case Transaction::OP_OMAP_RMKEYS:
+    case Transaction::OP_OMAP_RMKEYRANGE:
+    case Transaction::OP_OMAP_SETHEADER:
+    {
+      // the pg log of this shard, the others keep their own
+      coll_t cid = i.get_cid(op->cid);
+      ghobject_t oid = i.get_oid(op->oid);
+      if (!oid.hobj.is_pgmeta()) {
+	logger().error("{}: omap of erasure coded object {}", __func__, oid);
+	return -EOPNOTSUPP;
+      }
+      auto& t = (*shard_txns)[whoami.shard];
+      if (op->op == Transaction::OP_OMAP_SETKEYS) {
+	std::map<std::string, ceph::bufferlist> keys;
+	i.decode_attrset(keys);
+	t.omap_setkeys(cid, oid, keys);
+      } else if (op->op == Transaction::OP_OMAP_RMKEYS) {
+	std::set<std::string> keys;
+	i.decode_keyset(keys);
+	t.omap_rmkeys(cid, oid, keys);
+      } else if (op->op == Transaction::OP_OMAP_RMKEYRANGE) {
+	std::string first = i.decode_string();
+	std::string last = i.decode_string();
+	t.omap_rmkeyrange(cid, oid, first, last);
+      } else {
+	ceph::bufferlist header;
+	i.decode_bl(header);
+	t.omap_setheader(cid, oid, header);
+      }
+    }
+    break;
+    case Transaction::OP_CREATE:
+    case Transaction::OP_TOUCH:
+      for_each_shard(i.get_oid(op->oid), [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.touch(cid, oid);
+      });
+      break;
+    case Transaction::OP_REMOVE:
+      for_each_shard(i.get_oid(op->oid), [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.remove(cid, oid);
+      });
+      break;
+    case Transaction::OP_WRITE:
+    {
+      ghobject_t oid = i.get_oid(op->oid);
+      uint64_t off = op->off;
+      uint64_t len = op->len;
+      uint32_t fadvise_flags = i.get_fadvise_flags();
+      ceph::bufferlist bl;
+      i.decode_bl(bl);
+      if (!sinfo.logical_offset_is_stripe_aligned(off)) {
+	logger().error("{}: write to {} at {} is not stripe aligned",
+		       __func__, oid, off);
+	return -EOPNOTSUPP;
+      }
+      // pad the last stripe
+      bl.append_zero(sinfo.logical_to_next_stripe_offset(len) - len);
+      std::map<int, ceph::bufferlist> chunks;
+      if (int r = ECUtil::encode(sinfo, ec_impl, bl, want, &chunks); r < 0) {
+	logger().error("{}: unable to encode {}: {}", __func__, oid, r);
+	return r;
+      }
+      const uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(off);
+      for_each_shard(oid, [&](auto shard, const auto& cid, const auto& oid, auto& t) {
+	auto& chunk = chunks[shard];
+	t.write(cid, oid, chunk_off, chunk.length(), chunk, fadvise_flags);
+      });
+    }
+    break;
+    case Transaction::OP_TRUNCATE:
+    {
+      // the tail of the last stripe is kept, it is zeros anyway
+      const uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(
+	sinfo.logical_to_next_stripe_offset(op->off));
+      for_each_shard(i.get_oid(op->oid), [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.truncate(cid, oid, chunk_off);
+      });
+    }
+    break;
+    case Transaction::OP_SETATTR:
+    {
+      ghobject_t oid = i.get_oid(op->oid);
+      std::string name = i.decode_string();
+      ceph::bufferlist bl;
+      i.decode_bl(bl);
+      for_each_shard(oid, [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.setattr(cid, oid, name, bl);
+      });
+    }
+    break;
+    case Transaction::OP_SETATTRS:
+    {
+      ghobject_t oid = i.get_oid(op->oid);
+      std::map<std::string, ceph::bufferptr> attrs;
+      i.decode_attrset(attrs);
+      for_each_shard(oid, [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.setattrs(cid, oid, attrs);
+      });
+    }
+    break;
+    case Transaction::OP_RMATTR:
+    {
+      ghobject_t oid = i.get_oid(op->oid);
+      std::string name = i.decode_string();
+      for_each_shard(oid, [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.rmattr(cid, oid, name);
+      });
+    }
+    break;
+    case Transaction::OP_RMATTRS:
+      for_each_shard(i.get_oid(op->oid), [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.rmattrs(cid, oid);
+      });
+      break;
+    case Transaction::OP_SETALLOCHINT:
+    {
+      const uint64_t k = sinfo.get_stripe_width() / sinfo.get_chunk_size();
+      const uint64_t object_size = op->expected_object_size / k;
+      const uint64_t write_size = op->expected_write_size / k;
+      const uint32_t flags = op->alloc_hint_flags;
+      for_each_shard(i.get_oid(op->oid), [&](auto, const auto& cid, const auto& oid, auto& t) {
+	t.set_alloc_hint(cid, oid, object_size, write_size, flags);
+      });
+    }
+    break;
+    default:
+      logger().error("{}: op {} is not supported by erasure coded pools",
+		     __func__, static_cast<unsigned>(op->op));
+      return -EOPNOTSUPP;
+    }
+  }
+  return 0;
 }
 
 seastar::future<crimson::osd::acked_peers_t>
@@ -27,9 +352,67 @@ ECBackend::_submit_transaction(std::set<pg_shard_t>&& pg_shards,
                                const hobject_t& hoid,
                                ceph::os::Transaction&& txn,
                                const osd_op_params_t& osd_op_p,
-                               epoch_t min_epoch, epoch_t max_epoch,
+                               epoch_t min_epoch, epoch_t map_epoch,
 			       std::vector<pg_log_entry_t>&& log_entries)
 {
-  // todo
-  return seastar::make_ready_future<crimson::osd::acked_peers_t>();
+  std::map<shard_id_t, ceph::os::Transaction> shard_txns;
+  if (int r = get_shard_transactions(txn, pg_shards, &shard_txns); r < 0) {
+    return seastar::make_exception_future<crimson::osd::acked_peers_t>(
+      crimson::osd::make_error(r));
+  }
+  const ceph_tid_t tid = next_tid++;
+  auto req_id = osd_op_p.req->get_reqid();
+  auto pending_txn =
+    pending_writes.emplace(tid, pending_on_t{pg_shards.size()}).first;
+
+  return seastar::parallel_for_each(std::move(pg_shards),
+    [=, shard_txns=std::move(shard_txns), log_entries=std::move(log_entries)]
+    (auto pg_shard) mutable {
+      auto& shard_txn = shard_txns[pg_shard.shard];
+      if (pg_shard == whoami) {
+        return shard_services.get_store().do_transaction(coll,
+							 std::move(shard_txn));
+      } else {
+	ECSubWrite sop{whoami, tid, req_id, hoid, pg_stat_t{},
+		       shard_txn, osd_op_p.at_version, osd_op_p.pg_trim_to,
+		       osd_op_p.min_last_complete_ondisk, log_entries,
+		       std::nullopt, {}, {}, false};
+        auto m = make_message<MOSDECSubOpWrite>(sop);
+	m->pgid = spg_t{pgid, pg_shard.shard};
+	m->map_epoch = map_epoch;
+	m->min_epoch = min_epoch;
+        pending_txn->second.acked_peers.push_back({pg_shard, eversion_t{}});
+        return shard_services.send_to_osd(pg_shard.osd, std::move(m), map_epoch);
+      }
+    }).then([&peers=pending_txn->second] {
+      if (--peers.pending == 0) {
+        peers.all_committed.set_value();
+      }
+      return peers.all_committed.get_future();
+    }).then([tid, pending_txn, this] {
+      pending_txn->second.all_committed = {};
+      auto acked_peers = std::move(pending_txn->second.acked_peers);
+      pending_writes.erase(pending_txn);
+      return seastar::make_ready_future<crimson::osd::acked_peers_t>(
+	std::move(acked_peers));
+    });
+}
+
+void ECBackend::got_ec_sub_write_reply(const ECSubWriteReply& reply)
+{
+  auto found = pending_writes.find(reply.tid);
+  if (found == pending_writes.end() || !reply.committed) {
+    logger().warn("{}: no pending write for tid {}", __func__, reply.tid);
+    return;
+  }
+  auto& peers = found->second;
+  for (auto& peer : peers.acked_peers) {
+    if (peer.shard == reply.from) {
+      peer.last_complete_ondisk = reply.last_complete;
+      if (--peers.pending == 0) {
+        peers.all_committed.set_value();
+      }
+      return;
+    }
+  }
 }
@@ -6,17 +6,39 @@
 #include <boost/intrusive_ptr.hpp>
 #include <seastar/core/future.hh>
 #include "include/buffer_fwd.h"
+#include "erasure-code/ErasureCodeInterface.h"
+#include "osd/ECMsgTypes.h"
+#include "osd/ECUtil.h"
 #include "osd/osd_types.h"
+#include "acked_peers.h"
 #include "pg_backend.h"
 
+namespace crimson::osd {
+  class PG;
+  class ShardServices;
+}
+
+/**
+ * Erasure coded objects, stored as one chunk per shard of the PG.
+ *
+ * Like the classic ECBackend of a pool without overwrites, writes have to
+ * start at a stripe boundary; the last stripe is padded with zeros.  Each
+ * shard gets a transaction of its own, which the others apply when they
+ * are sent a MOSDECSubOpWrite.  Reads gather the chunks of just enough
+ * shards from the acting set with MOSDECSubOpRead, and decode them.
+ */
 class ECBackend : public PGBackend
 {
 public:
-  ECBackend(shard_id_t shard,
+  ECBackend(pg_t pgid,
+	    pg_shard_t whoami,
 	    CollectionRef coll,
 	    crimson::osd::ShardServices& shard_services,
+	    const crimson::osd::PG& pg,
 	    const ec_profile_t& ec_profile,
 	    uint64_t stripe_width);
+  void got_ec_sub_write_reply(const ECSubWriteReply& reply) final;
+  void got_ec_sub_read_reply(ECSubReadReply&& reply) final;
 private:
   ll_read_errorator::future<ceph::bufferlist> _read(const hobject_t& hoid,
                                                     uint64_t off,
@@ -29,6 +51,38 @@ private:
 		      const osd_op_params_t& req,
 		      epoch_t min_epoch, epoch_t max_epoch,
 		      std::vector<pg_log_entry_t>&& log_entries) final;
-  CollectionRef coll;
-  crimson::os::FuturizedStore* store;
+
+  /// split a transaction on the logical objects into one per shard
+  /// @return -EOPNOTSUPP if it has an op that erasure coded objects cannot
+  /// take
+  int get_shard_transactions(
+    ceph::os::Transaction& txn,
+    const std::set<pg_shard_t>& pg_shards,
+    std::map<shard_id_t, ceph::os::Transaction>* shard_txns);
+  /// read the chunks of a shard, from the store if it is ours
+  ll_read_errorator::future<ceph::bufferlist> read_chunks(
+    pg_shard_t pg_shard,
+    const hobject_t& hoid,
+    uint64_t off,
+    uint64_t len,
+    uint32_t flags);
+
+  const pg_t pgid;
+  const pg_shard_t whoami;
+  crimson::osd::ShardServices& shard_services;
+  const crimson::osd::PG& pg;
+  ceph::ErasureCodeInterfaceRef ec_impl;
+  ECUtil::stripe_info_t sinfo;
+
+  ceph_tid_t next_tid = 0;
+  struct pending_on_t {
+    pending_on_t(size_t pending)
+      : pending{static_cast<unsigned>(pending)}
+    {}
+    unsigned pending;
+    crimson::osd::acked_peers_t acked_peers;
+    seastar::promise<> all_committed;
+  };
+  std::map<ceph_tid_t, pending_on_t> pending_writes;
+  std::map<ceph_tid_t, seastar::promise<ECSubReadReply>> pending_reads;
 };
@@ -291,6 +291,29 @@ int cls_cxx_map_get_vals(cls_method_context_t hctx,
   return vals->size();
 }
 
+int cls_cxx_map_iterate(cls_method_context_t hctx,
+                        const std::string& start_after,
+                        const std::string& filter_prefix,
+                        const uint64_t max_to_get,
+                        const cls_map_iterate_cb_t& f,
+                        bool* const more)
+{
+  std::map<std::string, ceph::bufferlist> vals;
+  int ret = cls_cxx_map_get_vals(hctx, start_after, filter_prefix, max_to_get,
+                                 &vals, more);
+  if (ret < 0) {
+    return ret;
+  }
+  int num = 0;
+  for (const auto& [key, val] : vals) {
+    ++num;
+    if (!f(key, val)) {
+      break;
+    }
+  }
+  return num;
+}
+
 int cls_cxx_map_read_header(cls_method_context_t hctx, bufferlist *outbl)
 {
   return 0;
@@ -10,6 +10,7 @@
 #include <boost/smart_ptr/make_local_shared.hpp>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
+#include <seastar/core/reactor.hh>
 
 #include "common/pick_address.h"
 #include "include/util.h"
@@ -18,6 +19,8 @@
 #include "messages/MOSDAlive.h"
 #include "messages/MOSDBeacon.h"
 #include "messages/MOSDBoot.h"
+#include "messages/MOSDECSubOpReadReply.h"
+#include "messages/MOSDECSubOpWriteReply.h"
 #include "messages/MOSDMap.h"
 #include "messages/MOSDOp.h"
 #include "messages/MOSDPGLog.h"
@@ -46,6 +49,7 @@
 #include "crimson/osd/pg_meta.h"
 #include "crimson/osd/osd_operations/client_request.h"
 #include "crimson/osd/osd_operations/compound_peering_request.h"
+#include "crimson/osd/osd_operations/ec_subrequest.h"
 #include "crimson/osd/osd_operations/peering_event.h"
 #include "crimson/osd/osd_operations/pg_advance_map.h"
 #include "crimson/osd/osd_operations/recovery_subrequest.h"
@@ -214,6 +218,11 @@ namespace {
 seastar::future<> OSD::start()
 {
   logger().info("start");
+  if (seastar::smp::count > 1) {
+    // the pgs, the store and the messengers all live on this reactor
+    logger().warn("{} reactors are running, but only reactor {} serves pgs",
+                  seastar::smp::count, seastar::this_shard_id());
+  }
 
   startup_time = ceph::mono_clock::now();
 
@@ -441,6 +450,7 @@ seastar::future<> OSD::start_asok_admin()
       asok->register_admin_commands(),
       asok->register_command(make_asok_hook<OsdStatusHook>(*this)),
       asok->register_command(make_asok_hook<SendBeaconHook>(*this)),
+      asok->register_command(make_asok_hook<OsdBenchHook>(*this)),
       asok->register_command(make_asok_hook<ConfigShowHook>()),
       asok->register_command(make_asok_hook<ConfigGetHook>()),
       asok->register_command(make_asok_hook<ConfigSetHook>()));
@@ -622,6 +632,14 @@ seastar::future<> OSD::ms_dispatch(crimson::net::Connection* conn, MessageRef m)
     return handle_rep_op(conn, boost::static_pointer_cast<MOSDRepOp>(m));
   case MSG_OSD_REPOPREPLY:
     return handle_rep_op_reply(conn, boost::static_pointer_cast<MOSDRepOpReply>(m));
+  case MSG_OSD_EC_WRITE:
+    [[fallthrough]];
+  case MSG_OSD_EC_READ:
+    return handle_ec_subreq(conn, boost::static_pointer_cast<MOSDFastDispatchOp>(m));
+  case MSG_OSD_EC_WRITE_REPLY:
+    [[fallthrough]];
+  case MSG_OSD_EC_READ_REPLY:
+    return handle_ec_subreq_reply(conn, boost::static_pointer_cast<MOSDFastDispatchOp>(m));
   default:
     logger().info("{} unhandled message {}", __func__, *m);
     return seastar::now();
@@ -1024,6 +1042,33 @@ seastar::future<> OSD::handle_recovery_subreq(crimson::net::Connection* conn,
   return seastar::now();
 }
 
+seastar::future<> OSD::handle_ec_subreq(crimson::net::Connection* conn,
+				       Ref<MOSDFastDispatchOp> m)
+{
+  shard_services.start_operation<ECSubRequest>(
+    *this,
+    conn->get_shared(),
+    std::move(m));
+  return seastar::now();
+}
+
+seastar::future<> OSD::handle_ec_subreq_reply(crimson::net::Connection* conn,
+					     Ref<MOSDFastDispatchOp> m)
+{
+  const auto& pgs = pg_map.get_pgs();
+  auto pg = pgs.find(m->get_spg());
+  if (pg == pgs.end()) {
+    logger().warn("stale reply: {}", *m);
+  } else if (m->get_type() == MSG_OSD_EC_WRITE_REPLY) {
+    pg->second->handle_ec_sub_write_reply(
+      *boost::static_pointer_cast<MOSDECSubOpWriteReply>(m));
+  } else {
+    pg->second->handle_ec_sub_read_reply(
+      *boost::static_pointer_cast<MOSDECSubOpReadReply>(m));
+  }
+  return seastar::now();
+}
+
 bool OSD::should_restart() const
 {
   if (!osdmap->is_up(whoami)) {
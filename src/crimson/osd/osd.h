@@ -182,6 +182,10 @@ private:
 				      Ref<MOSDPeeringOp> m);
   seastar::future<> handle_recovery_subreq(crimson::net::Connection* conn,
 					   Ref<MOSDFastDispatchOp> m);
+  seastar::future<> handle_ec_subreq(crimson::net::Connection* conn,
+				     Ref<MOSDFastDispatchOp> m);
+  seastar::future<> handle_ec_subreq_reply(crimson::net::Connection* conn,
+					   Ref<MOSDFastDispatchOp> m);
 
 
   seastar::future<> committed_osd_maps(version_t first,
@@ -222,6 +226,7 @@ public:
   void update_heartbeat_peers();
 
   friend class PGAdvanceMap;
+  friend class OSDBench;
 };
 
 }
@@ -0,0 +1,208 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "osd_bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <vector>
+
+#include <boost/iterator/counting_iterator.hpp>
+#include <fmt/format.h>
+#include <seastar/core/do_with.hh>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/reactor.hh>
+
+#include "common/Formatter.h"
+#include "include/ceph_features.h"
+#include "messages/MOSDOp.h"
+#include "messages/MOSDOpReply.h"
+
+#include "crimson/common/log.h"
+#include "crimson/net/Connection.h"
+#include "crimson/osd/osd.h"
+#include "crimson/osd/osd_operations/client_request.h"
+#include "crimson/osd/pg.h"
+
+namespace {
+  seastar::logger& logger() {
+    return crimson::get_logger(ceph_subsys_osd);
+  }
+
+  /// a connection that keeps the results of the replies sent to it
+  class BenchConnection final : public crimson::net::Connection {
+    std::map<ceph_tid_t, int> results;
+  public:
+    BenchConnection() {
+      set_peer_name(entity_name_t::CLIENT(0));
+      set_features(CEPH_FEATURES_ALL);
+    }
+    /// @return the result of the reply to tid, or -EIO if none was sent
+    int take_result(ceph_tid_t tid) {
+      auto found = results.find(tid);
+      if (found == results.end()) {
+        return -EIO;
+      }
+      int r = found->second;
+      results.erase(found);
+      return r;
+    }
+    crimson::net::Messenger* get_messenger() const final {
+      return nullptr;
+    }
+    bool is_connected() const final {
+      return true;
+    }
+#ifdef UNIT_TESTS_BUILT
+    bool is_closed() const final {
+      return false;
+    }
+    bool is_closed_clean() const final {
+      return false;
+    }
+    bool peer_wins() const final {
+      return false;
+    }
+#endif
+    seastar::future<> send(MessageRef msg) final {
+      if (msg->get_type() == CEPH_MSG_OSD_OPREPLY) {
+        auto reply = boost::static_pointer_cast<MOSDOpReply>(msg);
+        results[reply->get_tid()] = reply->get_result();
+      }
+      return seastar::now();
+    }
+    seastar::future<> keepalive() final {
+      return seastar::now();
+    }
+    void mark_down() final {}
+    void print(ostream& out) const final {
+      out << "bench";
+    }
+  };
+
+  struct bench_target_t {
+    hobject_t hoid;
+    spg_t pgid;
+  };
+}
+
+namespace crimson::osd {
+
+seastar::future<int> OSDBench::run(ceph::Formatter* f)
+{
+  // the objects, in our active primary pgs
+  std::set<spg_t> pgs;
+  for (auto& [pgid, pg] : osd.pg_map.get_pgs()) {
+    if (pg->is_primary() && pg->get_peering_state().is_active() &&
+        pg->get_pool().info.is_replicated()) {
+      pgs.insert(pgid);
+    }
+  }
+  if (pgs.empty()) {
+    return seastar::make_ready_future<int>(-EAGAIN);
+  }
+  const uint64_t ops = std::max<uint64_t>(params.count / params.size, 1);
+  const uint64_t num_objects = params.object_num ? params.object_num : ops;
+  std::vector<bench_target_t> targets;
+  for (uint64_t i = 0; targets.size() < num_objects; i++) {
+    object_t oid{fmt::format("osd_bench_{}_{}", osd.whoami, i)};
+    for (auto& pgid : pgs) {
+      object_locator_t oloc{pgid.pool()};
+      pg_t raw_pg;
+      osd.osdmap->object_locator_to_pg(oid, oloc, raw_pg);
+      if (osd.osdmap->raw_pg_to_pg(raw_pg) == pgid.pgid) {
+        targets.push_back({hobject_t{oid, oloc.key, CEPH_NOSNAP, raw_pg.ps(),
+                                     raw_pg.pool(), oloc.nspace},
+                           pgid});
+        break;
+      }
+    }
+  }
+  logger().info("bench: writing {} ops of {} bytes to {} objects in {} pgs",
+                ops, params.size, num_objects, pgs.size());
+
+  struct state_t {
+    std::vector<bench_target_t> targets;
+    seastar::shared_ptr<BenchConnection> conn =
+      seastar::make_shared<BenchConnection>();
+    ceph::bufferptr data;
+    uint64_t next = 0;
+    int error = 0;
+    std::vector<std::chrono::nanoseconds> latencies;
+  };
+  auto state = seastar::make_lw_shared<state_t>();
+  state->targets = std::move(targets);
+  state->data = ceph::buffer::create(params.size);
+  state->data.zero();
+  state->latencies.reserve(ops);
+  const auto start = ceph::mono_clock::now();
+  const auto busy_start = seastar::engine().total_busy_time();
+
+  return seastar::parallel_for_each(
+    boost::make_counting_iterator(0u),
+    boost::make_counting_iterator(params.concurrency),
+    [this, state, ops](unsigned) {
+    return seastar::do_until(
+      [state, ops] { return state->next == ops || state->error < 0; },
+      [this, state] {
+      const uint64_t i = state->next++;
+      const auto& target = state->targets[i % state->targets.size()];
+      const ceph_tid_t tid = i + 1;
+      auto pgid = target.pgid;
+      auto m = make_message<MOSDOp>(0, tid, target.hoid, pgid,
+                                    osd.osdmap->get_epoch(),
+                                    CEPH_OSD_FLAG_WRITE | CEPH_OSD_FLAG_ONDISK,
+                                    CEPH_FEATURES_ALL);
+      m->set_reqid(osd_reqid_t{entity_name_t::OSD(osd.whoami), 0, tid});
+      m->set_mtime(ceph_clock_now());
+      ceph::bufferlist bl;
+      bl.append(state->data);
+      m->write(0, bl.length(), bl);
+      // as OSDOps are given their data when they are decoded
+      OSDOp::split_osd_op_vector_in_data(m->ops, m->get_data());
+      const auto issued = ceph::mono_clock::now();
+      return osd.shard_services.start_operation<ClientRequest>(
+        osd, state->conn, std::move(m)).second.then([state, tid, issued] {
+        state->latencies.push_back(ceph::mono_clock::now() - issued);
+        if (int r = state->conn->take_result(tid); r < 0 && !state->error) {
+          state->error = r;
+        }
+      });
+    });
+  }).then([this, state, start, busy_start, f] {
+    const std::chrono::duration<double> elapsed =
+      ceph::mono_clock::now() - start;
+    const std::chrono::duration<double, std::micro> busy =
+      seastar::engine().total_busy_time() - busy_start;
+    auto& latencies = state->latencies;
+    const auto done = latencies.size();
+    std::sort(latencies.begin(), latencies.end());
+    const std::chrono::duration<double, std::micro> total_latency =
+      std::accumulate(latencies.begin(), latencies.end(),
+                      std::chrono::nanoseconds{0});
+    auto lat_us = [](std::chrono::nanoseconds lat) {
+      return std::chrono::duration<double, std::micro>{lat}.count();
+    };
+    f->open_object_section("osd_bench_results");
+    f->dump_unsigned("shard", seastar::this_shard_id());
+    f->dump_unsigned("ops", done);
+    f->dump_unsigned("bytes_written", done * params.size);
+    f->dump_unsigned("blocksize", params.size);
+    f->dump_unsigned("concurrency", params.concurrency);
+    f->dump_float("elapsed_sec", elapsed.count());
+    f->dump_float("iops", done / elapsed.count());
+    f->dump_float("bytes_per_sec", done * params.size / elapsed.count());
+    if (done) {
+      f->dump_float("avg_latency_us", total_latency.count() / done);
+      f->dump_float("p99_latency_us", lat_us(latencies[done * 99 / 100]));
+      f->dump_float("max_latency_us", lat_us(latencies.back()));
+      f->dump_float("cpu_per_op_us", busy.count() / done);
+    }
+    f->close_section();
+    return state->error;
+  });
+}
+
+}
@@ -0,0 +1,50 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <cstdint>
+#include <seastar/core/future.hh>
+
+namespace ceph {
+  class Formatter;
+}
+
+namespace crimson::osd {
+
+class OSD;
+
+/**
+ * Measure the throughput of the client op path of an OSD.
+ *
+ * Synthetic MOSDOps are fed straight into ClientRequest, as if they were
+ * sent over a connection, so the numbers cover the pg pipeline, the
+ * backend and the store, but neither the messenger nor the network.  The
+ * objects written are spread over the active pgs whose primary we are.
+ */
+class OSDBench {
+public:
+  struct params_t {
+    /// bytes to write in total
+    uint64_t count = 1 << 30;
+    /// bytes per op
+    uint64_t size = 4 << 20;
+    /// objects to write to, or 0 for a new object per op
+    uint64_t object_num = 0;
+    /// ops in flight
+    unsigned concurrency = 16;
+  };
+
+  OSDBench(OSD& osd, const params_t& params)
+    : osd{osd}, params{params} {}
+
+  /// @return -EAGAIN if we are primary of no active pg, or the first
+  ///         error returned to an op
+  seastar::future<int> run(ceph::Formatter* f);
+
+private:
+  OSD& osd;
+  const params_t params;
+};
+
+}
@@ -31,6 +31,7 @@ enum class OperationTypeCode {
   replicated_request,
   background_recovery,
   background_recovery_sub,
+  ec_sub_request,
   last_op
 };
 
@@ -43,6 +44,7 @@ static constexpr const char* const OP_NAMES[] = {
   "replicated_request",
   "background_recovery",
   "background_recovery_sub",
+  "ec_sub_request",
 };
 
 // prevent the addition of OperationTypeCode-s with no matching OP_NAMES entry:
@@ -0,0 +1,43 @@
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "messages/MOSDECSubOpRead.h"
+#include "messages/MOSDECSubOpWrite.h"
+
+#include "crimson/osd/pg.h"
+#include "crimson/osd/osd_operations/ec_subrequest.h"
+
+namespace {
+  seastar::logger& logger() {
+    return crimson::get_logger(ceph_subsys_osd);
+  }
+}
+
+namespace crimson::osd {
+
+seastar::future<> ECSubRequest::start() {
+  logger().debug("{}: start", *this);
+
+  IRef opref = this;
+  return with_blocking_future(osd.osdmap_gate.wait_for_map(m->get_min_epoch()))
+  .then([this] (epoch_t epoch) {
+    return with_blocking_future(osd.wait_for_pg(m->get_spg()));
+  }).then([this, opref=std::move(opref)] (Ref<PG> pgref) {
+    return seastar::do_with(std::move(pgref), std::move(opref),
+      [this](auto& pgref, auto& opref) {
+      switch (m->get_type()) {
+      case MSG_OSD_EC_WRITE:
+	return pgref->handle_ec_sub_write(
+	  boost::static_pointer_cast<MOSDECSubOpWrite>(m));
+      case MSG_OSD_EC_READ:
+	return pgref->handle_ec_sub_read(
+	  boost::static_pointer_cast<MOSDECSubOpRead>(m));
+      default:
+	logger().error("{}: unexpected message {}", *this, *m);
+	return seastar::now();
+      }
+    });
+  });
+}
+
+}
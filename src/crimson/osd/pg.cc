@@ -14,6 +14,10 @@
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include "messages/MOSDECSubOpRead.h"
+#include "messages/MOSDECSubOpReadReply.h"
+#include "messages/MOSDECSubOpWrite.h"
+#include "messages/MOSDECSubOpWriteReply.h"
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "messages/MOSDPGInfo.h"
@@ -99,6 +103,7 @@ PG::PG(
 	pool,
 	coll_ref,
 	shard_services,
+	*this,
 	profile)),
     recovery_backend(
       std::make_unique<ReplicatedRecoveryBackend>(
@@ -860,4 +865,68 @@ void PG::handle_rep_op_reply(crimson::net::Connection* conn,
   backend->got_rep_op_reply(m);
 }
 
+seastar::future<> PG::handle_ec_sub_write(Ref<MOSDECSubOpWrite> m)
+{
+  auto& op = m->op;
+  peering_state.append_log(std::move(op.log_entries), op.trim_to,
+      op.at_version, op.roll_forward_to, op.t, !op.t.empty(), false);
+  return shard_services.get_store().do_transaction(coll_ref, std::move(op.t))
+    .then([m, lcod=peering_state.get_info().last_complete, this] {
+      peering_state.update_last_complete_ondisk(lcod);
+      const auto map_epoch = get_osdmap_epoch();
+      auto reply = make_message<MOSDECSubOpWriteReply>();
+      reply->pgid = spg_t{pgid.pgid, m->op.from.shard};
+      reply->map_epoch = map_epoch;
+      reply->min_epoch = m->min_epoch;
+      reply->op.from = pg_whoami;
+      reply->op.tid = m->op.tid;
+      reply->op.last_complete = lcod;
+      reply->op.committed = true;
+      reply->op.applied = true;
+      return shard_services.send_to_osd(m->op.from.osd, reply, map_epoch);
+    });
+}
+
+seastar::future<> PG::handle_ec_sub_read(Ref<MOSDECSubOpRead> m)
+{
+  auto reply = make_message<MOSDECSubOpReadReply>();
+  reply->pgid = spg_t{pgid.pgid, m->op.from.shard};
+  reply->map_epoch = get_osdmap_epoch();
+  reply->min_epoch = m->min_epoch;
+  reply->op.from = pg_whoami;
+  reply->op.tid = m->op.tid;
+  return seastar::do_for_each(m->op.to_read, [reply, this](auto& to_read) {
+    const hobject_t& hoid = to_read.first;
+    return seastar::do_for_each(to_read.second,
+      [&hoid, reply, this](auto& extent) {
+      const uint64_t off = extent.template get<0>();
+      return shard_services.get_store().read(
+	coll_ref,
+	ghobject_t{hoid, ghobject_t::NO_GEN, pg_whoami.shard},
+	off,
+	extent.template get<1>(),
+	extent.template get<2>()).safe_then(
+	  [&hoid, off, reply](ceph::bufferlist&& bl) {
+	  reply->op.buffers_read[hoid].emplace_back(off, std::move(bl));
+	}, crimson::os::FuturizedStore::read_errorator::all_same_way(
+	  [&hoid, reply](const std::error_code& e) {
+	  reply->op.errors[hoid] = -e.value();
+	}));
+    });
+  }).then([m, reply, this] {
+    return shard_services.send_to_osd(m->op.from.osd, reply,
+				      get_osdmap_epoch());
+  });
+}
+
+void PG::handle_ec_sub_write_reply(const MOSDECSubOpWriteReply& m)
+{
+  backend->got_ec_sub_write_reply(m.op);
+}
+
+void PG::handle_ec_sub_read_reply(MOSDECSubOpReadReply& m)
+{
+  backend->got_ec_sub_read_reply(std::move(m.op));
+}
+
 }
@@ -33,6 +33,10 @@
 
 class OSDMap;
 class MQuery;
+class MOSDECSubOpRead;
+class MOSDECSubOpReadReply;
+class MOSDECSubOpWrite;
+class MOSDECSubOpWriteReply;
 class PGBackend;
 class PGPeeringEvent;
 class osd_op_params_t;
@@ -517,6 +521,10 @@ public:
   seastar::future<> handle_rep_op(Ref<MOSDRepOp> m);
   void handle_rep_op_reply(crimson::net::Connection* conn,
 			   const MOSDRepOpReply& m);
+  seastar::future<> handle_ec_sub_write(Ref<MOSDECSubOpWrite> m);
+  seastar::future<> handle_ec_sub_read(Ref<MOSDECSubOpRead> m);
+  void handle_ec_sub_write_reply(const MOSDECSubOpWriteReply& m);
+  void handle_ec_sub_read_reply(MOSDECSubOpReadReply& m);
 
   void print(std::ostream& os) const;
 
@@ -587,6 +595,9 @@ public:
   const set<pg_shard_t> &get_acting_recovery_backfill() const {
     return peering_state.get_acting_recovery_backfill();
   }
+  const set<pg_shard_t> &get_actingset() const {
+    return peering_state.get_actingset();
+  }
   void begin_peer_recover(pg_shard_t peer, const hobject_t oid) {
     peering_state.begin_peer_recover(peer, oid);
   }
@@ -653,9 +664,6 @@ private:
       !peering_state.get_missing_loc().readable_with_acting(
 	oid, get_actingset());
   }
-  const set<pg_shard_t> &get_actingset() const {
-    return peering_state.get_actingset();
-  }
 };
 
 std::ostream& operator<<(std::ostream&, const PG& pg);
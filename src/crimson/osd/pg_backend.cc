@@ -37,6 +37,7 @@ PGBackend::create(pg_t pgid,
 		  const pg_pool_t& pool,
 		  crimson::os::CollectionRef coll,
 		  crimson::osd::ShardServices& shard_services,
+		  const crimson::osd::PG& pg,
 		  const ec_profile_t& ec_profile)
 {
   switch (pool.type) {
@@ -44,9 +45,8 @@ PGBackend::create(pg_t pgid,
     return std::make_unique<ReplicatedBackend>(pgid, pg_shard,
 					       coll, shard_services);
   case pg_pool_t::TYPE_ERASURE:
-    return std::make_unique<ECBackend>(pg_shard.shard, coll, shard_services,
-                                       std::move(ec_profile),
-                                       pool.stripe_width);
+    return std::make_unique<ECBackend>(pgid, pg_shard, coll, shard_services,
+                                       pg, ec_profile, pool.stripe_width);
   default:
     throw runtime_error(seastar::format("unsupported pool type '{}'",
                                         pool.type));
@@ -196,6 +196,8 @@ PGBackend::read(const object_info_t& oi,
     // read size was trimmed to zero and it is expected to do nothing,
     return read_errorator::make_ready_future<bufferlist>();
   }
+  // the chunks of erasure coded objects are padded past the end
+  length = std::min<size_t>(length, size - offset);
   return _read(oi.soid, offset, length, flags).safe_then(
     [&oi](auto&& bl) -> read_errorator::future<ceph::bufferlist> {
       if (const bool is_fine = _read_verify_data(oi, bl); is_fine) {
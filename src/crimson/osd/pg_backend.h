@@ -21,6 +21,8 @@
 
 struct hobject_t;
 class MOSDRepOpReply;
+struct ECSubWriteReply;
+struct ECSubReadReply;
 
 namespace ceph::os {
   class Transaction;
@@ -48,6 +50,7 @@ public:
 					   const pg_pool_t& pool,
 					   crimson::os::CollectionRef coll,
 					   crimson::osd::ShardServices& shard_services,
+					   const crimson::osd::PG& pg,
 					   const ec_profile_t& ec_profile);
   using attrs_t =
     std::map<std::string, ceph::bufferptr, std::less<>>;
@@ -134,6 +137,8 @@ public:
     const ghobject_t& oid);
 
   virtual void got_rep_op_reply(const MOSDRepOpReply&) {}
+  virtual void got_ec_sub_write_reply(const ECSubWriteReply&) {}
+  virtual void got_ec_sub_read_reply(ECSubReadReply&&) {}
 protected:
   const shard_id_t shard;
   CollectionRef coll;
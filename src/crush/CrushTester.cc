@@ -10,6 +10,7 @@
 #include <boost/algorithm/string/join.hpp>
 
 #include "common/SubProcess.h"
+#include "common/ceph_time.h"
 #include "common/fork_function.h"
 
 #include "include/stringify.h"
@@ -729,6 +730,67 @@ int CrushTester::test()
   return 0;
 }
 
+int CrushTester::bench(int rounds)
+{
+  if (min_rule < 0 || max_rule < 0) {
+    min_rule = 0;
+    max_rule = crush.get_max_rules() - 1;
+  }
+  if (min_x < 0 || max_x < 0) {
+    min_x = 0;
+    max_x = 1023;
+  }
+
+  vector<__u32> weight;
+  for (int o = 0; o < crush.get_max_devices(); o++) {
+    if (device_weight.count(o)) {
+      weight.push_back(device_weight[o]);
+    } else if (crush.check_item_present(o)) {
+      weight.push_back(0x10000);
+    } else {
+      weight.push_back(0);
+    }
+  }
+  adjust_weights(weight);
+
+  for (int r = min_rule; r < crush.get_max_rules() && r <= max_rule; r++) {
+    if (!crush.rule_exists(r)) {
+      continue;
+    }
+    if (ruleset >= 0 &&
+	crush.get_rule_mask_ruleset(r) != ruleset) {
+      continue;
+    }
+    int minr = min_rep, maxr = max_rep;
+    if (min_rep < 0 || max_rep < 0) {
+      minr = crush.get_rule_mask_min_size(r);
+      maxr = crush.get_rule_mask_max_size(r);
+    }
+    for (int nr = minr; nr <= maxr; nr++) {
+      vector<int> out;
+      uint64_t mappings = 0;
+      auto start = ceph::mono_clock::now();
+      for (int round = 0; round < rounds; round++) {
+	for (int x = min_x; x <= max_x; x++) {
+	  uint32_t real_x = x;
+	  if (pool_id != -1) {
+	    real_x = crush_hash32_2(CRUSH_HASH_RJENKINS1, x, (uint32_t)pool_id);
+	  }
+	  crush.do_rule(r, real_x, out, nr, weight, 0);
+	  ++mappings;
+	}
+      }
+      double secs = std::chrono::duration<double>(
+	ceph::mono_clock::now() - start).count();
+      err << "rule " << r << " (" << crush.get_rule_name(r)
+	  << ") num_rep " << nr << ": " << mappings << " mappings in "
+	  << secs << "s, " << (uint64_t)(secs > 0 ? mappings / secs : 0)
+	  << " mappings/s" << std::endl;
+    }
+  }
+  return 0;
+}
+
 int CrushTester::compare(CrushWrapper& crush2)
 {
   if (min_rule < 0 || max_rule < 0) {
@@ -359,6 +359,11 @@ public:
   void check_overlapped_rules() const;
   int test();
   int test_with_fork(int timeout);
+  /**
+   * time the mappings of the --test range, rounds times over, and report
+   * the mapping rate for each rule and number of replicas
+   */
+  int bench(int rounds);
 
   int compare(CrushWrapper& other);
 };
@@ -21,6 +21,11 @@
 # include "crush_compat.h"
 # include "crush.h"
 # include "hash.h"
+# if defined(__x86_64__)
+#  include <immintrin.h>
+# elif defined(__aarch64__)
+#  include <arm_neon.h>
+# endif
 #endif
 #include "crush_ln_table.h"
 #include "mapper.h"
@@ -358,15 +363,207 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+/*
+ * Vector straw2 draws.
+ *
+ * The rjenkins1 hash of several items is computed at once, and on x86_64
+ * with AVX2 the crush_ln() table lookups as well.  The integer operations
+ * are the same as in the scalar code, so the results are bit-identical.
+ * The 64-bit division by the item weight is left scalar.
+ */
+#ifndef __KERNEL__
+
+int crush_straw2_simd = 1;
+
+#define crush_hash_seed 1315423911
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#define CRUSH_LN_BATCH 8
+
+#define crush_hashmix_step_x8(a, b, c, shift, n)			\
+	a = _mm256_xor_si256(_mm256_sub_epi32(_mm256_sub_epi32(a, b), c), \
+			     shift(c, n))
+
+#define crush_hashmix_x8(a, b, c) do {					\
+		crush_hashmix_step_x8(a, b, c, _mm256_srli_epi32, 13);	\
+		crush_hashmix_step_x8(b, c, a, _mm256_slli_epi32, 8);	\
+		crush_hashmix_step_x8(c, a, b, _mm256_srli_epi32, 13);	\
+		crush_hashmix_step_x8(a, b, c, _mm256_srli_epi32, 12);	\
+		crush_hashmix_step_x8(b, c, a, _mm256_slli_epi32, 16);	\
+		crush_hashmix_step_x8(c, a, b, _mm256_srli_epi32, 5);	\
+		crush_hashmix_step_x8(a, b, c, _mm256_srli_epi32, 3);	\
+		crush_hashmix_step_x8(b, c, a, _mm256_slli_epi32, 10);	\
+		crush_hashmix_step_x8(c, a, b, _mm256_srli_epi32, 15);	\
+	} while (0)
+
+/* crush_ln() of four 17-bit inputs, each in a 64-bit lane */
+__attribute__((target("avx2")))
+static inline __m256i crush_ln_x4(__m256i x, __m256i iexpon)
+{
+	const long long *rh_lh = (const long long *)__RH_LH_tbl;
+	const long long *ll = (const long long *)__LL_tbl;
+
+	/* index1 = (x >> 8) << 1, and the table starts at 256 */
+	__m256i index1 = _mm256_sub_epi64(
+		_mm256_slli_epi64(_mm256_srli_epi64(x, 8), 1),
+		_mm256_set1_epi64x(256));
+	__m256i RH = _mm256_i64gather_epi64(rh_lh, index1, 8);
+	__m256i LH = _mm256_i64gather_epi64(
+		rh_lh, _mm256_add_epi64(index1, _mm256_set1_epi64x(1)), 8);
+
+	/* xl64 = x * RH, with x < 2^32 */
+	__m256i xl64 = _mm256_add_epi64(
+		_mm256_mul_epu32(x, RH),
+		_mm256_slli_epi64(_mm256_mul_epu32(x, _mm256_srli_epi64(RH, 32)),
+				  32));
+	__m256i index2 = _mm256_and_si256(_mm256_srli_epi64(xl64, 48),
+					  _mm256_set1_epi64x(0xff));
+	__m256i LL = _mm256_i64gather_epi64(ll, index2, 8);
+
+	LH = _mm256_srli_epi64(_mm256_add_epi64(LH, LL), 48 - 12 - 32);
+	return _mm256_add_epi64(_mm256_slli_epi64(iexpon, 12 + 32), LH);
+}
+
+__attribute__((target("avx2")))
+static void crush_straw2_ln_avx2(__u32 x, const __s32 *ids, __u32 r,
+				 __s64 *ln)
+{
+	__m256i a = _mm256_set1_epi32(x);
+	__m256i b = _mm256_loadu_si256((const __m256i *)ids);
+	__m256i c = _mm256_set1_epi32(r);
+	__m256i hash = _mm256_xor_si256(
+		_mm256_xor_si256(_mm256_set1_epi32(crush_hash_seed), a),
+		_mm256_xor_si256(b, c));
+	__m256i xx = _mm256_set1_epi32(231232);
+	__m256i y = _mm256_set1_epi32(1232);
+	crush_hashmix_x8(a, b, hash);
+	crush_hashmix_x8(c, xx, hash);
+	crush_hashmix_x8(y, a, hash);
+	crush_hashmix_x8(b, xx, hash);
+	crush_hashmix_x8(y, c, hash);
+
+	/* u = (hash & 0xffff) + 1, i.e. 1..0x10000 */
+	__m256i u = _mm256_add_epi32(
+		_mm256_and_si256(hash, _mm256_set1_epi32(0xffff)),
+		_mm256_set1_epi32(1));
+
+	/*
+	 * normalize: floor(log2(u)) is exact from the float exponent for
+	 * u < 2^24; inputs below 0x8000 are shifted up to bit 15
+	 */
+	__m256i e = _mm256_sub_epi32(
+		_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(u)), 23),
+		_mm256_set1_epi32(127));
+	__m256i iexpon = _mm256_min_epi32(e, _mm256_set1_epi32(15));
+	u = _mm256_sllv_epi32(u, _mm256_sub_epi32(_mm256_set1_epi32(15), iexpon));
+
+	__m256i bias = _mm256_set1_epi64x(0x1000000000000ll);
+	__m256i lo = crush_ln_x4(
+		_mm256_cvtepu32_epi64(_mm256_castsi256_si128(u)),
+		_mm256_cvtepu32_epi64(_mm256_castsi256_si128(iexpon)));
+	__m256i hi = crush_ln_x4(
+		_mm256_cvtepu32_epi64(_mm256_extracti128_si256(u, 1)),
+		_mm256_cvtepu32_epi64(_mm256_extracti128_si256(iexpon, 1)));
+	_mm256_storeu_si256((__m256i *)ln, _mm256_sub_epi64(lo, bias));
+	_mm256_storeu_si256((__m256i *)(ln + 4), _mm256_sub_epi64(hi, bias));
+}
+
+static int crush_straw2_have_simd(void)
+{
+	static int have = -1;
+	if (have < 0)
+		have = __builtin_cpu_supports("avx2") ? 1 : 0;
+	return have;
+}
+
+static void crush_straw2_ln(__u32 x, const __s32 *ids, __u32 r, __s64 *ln)
+{
+	crush_straw2_ln_avx2(x, ids, r, ln);
+}
+
+#elif defined(__aarch64__)
+
+#define CRUSH_LN_BATCH 4
+
+#define crush_hashmix_step_x4(a, b, c, shift, n)			\
+	a = veorq_u32(vsubq_u32(vsubq_u32(a, b), c), shift(c, n))
+
+#define crush_hashmix_x4(a, b, c) do {				\
+		crush_hashmix_step_x4(a, b, c, vshrq_n_u32, 13);	\
+		crush_hashmix_step_x4(b, c, a, vshlq_n_u32, 8);	\
+		crush_hashmix_step_x4(c, a, b, vshrq_n_u32, 13);	\
+		crush_hashmix_step_x4(a, b, c, vshrq_n_u32, 12);	\
+		crush_hashmix_step_x4(b, c, a, vshlq_n_u32, 16);	\
+		crush_hashmix_step_x4(c, a, b, vshrq_n_u32, 5);	\
+		crush_hashmix_step_x4(a, b, c, vshrq_n_u32, 3);	\
+		crush_hashmix_step_x4(b, c, a, vshlq_n_u32, 10);	\
+		crush_hashmix_step_x4(c, a, b, vshrq_n_u32, 15);	\
+	} while (0)
+
+static int crush_straw2_have_simd(void)
+{
+	return 1;
+}
+
+/* NEON has no table lookups this wide; only the hash is vectorized */
+static void crush_straw2_ln(__u32 x, const __s32 *ids, __u32 r, __s64 *ln)
+{
+	uint32x4_t a = vdupq_n_u32(x);
+	uint32x4_t b = vld1q_u32((const uint32_t *)ids);
+	uint32x4_t c = vdupq_n_u32(r);
+	uint32x4_t hash = veorq_u32(veorq_u32(vdupq_n_u32(crush_hash_seed), a),
+				    veorq_u32(b, c));
+	uint32x4_t xx = vdupq_n_u32(231232);
+	uint32x4_t y = vdupq_n_u32(1232);
+	__u32 u[CRUSH_LN_BATCH];
+	int j;
+
+	crush_hashmix_x4(a, b, hash);
+	crush_hashmix_x4(c, xx, hash);
+	crush_hashmix_x4(y, a, hash);
+	crush_hashmix_x4(b, xx, hash);
+	crush_hashmix_x4(y, c, hash);
+	vst1q_u32(u, vandq_u32(hash, vdupq_n_u32(0xffff)));
+	for (j = 0; j < CRUSH_LN_BATCH; j++)
+		ln[j] = crush_ln(u[j]) - 0x1000000000000ll;
+}
+
+#endif
+#endif /* !__KERNEL__ */
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
 {
-	unsigned int i, high = 0;
+	unsigned int i = 0, high = 0;
 	__s64 draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
-	for (i = 0; i < bucket->h.size; i++) {
+#ifdef CRUSH_LN_BATCH
+	if (crush_straw2_simd &&
+	    bucket->h.hash == CRUSH_HASH_RJENKINS1 &&
+	    bucket->h.size >= CRUSH_LN_BATCH &&
+	    crush_straw2_have_simd()) {
+		__s64 ln[CRUSH_LN_BATCH];
+		unsigned int j;
+		for (; i + CRUSH_LN_BATCH <= bucket->h.size;
+		     i += CRUSH_LN_BATCH) {
+			crush_straw2_ln(x, ids + i, r, ln);
+			for (j = 0; j < CRUSH_LN_BATCH; j++) {
+				if (weights[i + j])
+					draw = div64_s64(ln[j], weights[i + j]);
+				else
+					draw = S64_MIN;
+				if (i + j == 0 || draw > high_draw) {
+					high = i + j;
+					high_draw = draw;
+				}
+			}
+		}
+	}
+#endif
+	for (; i < bucket->h.size; i++) {
                 dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
 		if (weights[i]) {
 			draw = generate_exponential_distribution(bucket->h.hash, x, ids[i], r, weights[i]);
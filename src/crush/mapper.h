@@ -90,4 +90,10 @@ static inline size_t crush_work_size(const struct crush_map *map,
 
 extern void crush_init_workspace(const struct crush_map *m, void *v);
 
+#ifndef __KERNEL__
+/* compute straw2 draws with vector instructions when the cpu has them;
+   the result is the same either way */
+extern int crush_straw2_simd;
+#endif
+
 #endif
@@ -208,6 +208,82 @@ int ErasureCode::encode_chunks(const set<int> &want_to_encode,
 {
   ceph_abort_msg("ErasureCode::encode_chunks not implemented");
 }
+
+static void region_xor_into(char *dst, const char *src, unsigned length)
+{
+  for (unsigned i = 0; i < length; i++)
+    dst[i] ^= src[i];
+}
+
+int ErasureCode::encode_delta(const bufferlist &old_data,
+                              const bufferlist &new_data,
+                              bufferlist *delta)
+{
+  if (old_data.length() != new_data.length())
+    return -EINVAL;
+  unsigned length = old_data.length();
+  bufferptr d(buffer::create_aligned(length, SIMD_ALIGN));
+  old_data.begin().copy(length, d.c_str());
+  unsigned off = 0;
+  for (auto& p : new_data.buffers()) {
+    region_xor_into(d.c_str() + off, p.c_str(), p.length());
+    off += p.length();
+  }
+  delta->clear();
+  delta->push_back(std::move(d));
+  return 0;
+}
+
+int ErasureCode::apply_delta(const map<int, bufferlist> &deltas,
+                             map<int, bufferlist> *coding)
+{
+  if (get_sub_chunk_count() != 1)
+    return -EOPNOTSUPP;
+  if (deltas.empty() || coding->empty())
+    return 0;
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  unsigned length = deltas.begin()->second.length();
+  if (get_chunk_size(k * length) != length)
+    return -EINVAL;
+
+  // the codes are linear: encoding the deltas, with the data chunks
+  // that did not change as zeros, gives the deltas of the coding chunks
+  map<int, bufferlist> encoded;
+  set<int> want_to_encode;
+  unsigned found = 0;
+  for (unsigned int i = 0; i < k + m; i++) {
+    int chunk = chunk_index(i);
+    bufferlist &bl = encoded[chunk];
+    auto delta = deltas.find(chunk);
+    if (i < k && delta != deltas.end()) {
+      if (delta->second.length() != length)
+        return -EINVAL;
+      bl = delta->second;
+      bl.rebuild_aligned_size_and_memory(length, SIMD_ALIGN);
+      found++;
+    } else {
+      bufferptr buf(buffer::create_aligned(length, SIMD_ALIGN));
+      if (i < k)
+        buf.zero();
+      else
+        want_to_encode.insert(chunk);
+      bl.push_back(std::move(buf));
+    }
+  }
+  if (found != deltas.size())
+    return -EINVAL; // not all of them are data chunks
+  for (auto& [chunk, bl] : *coding) {
+    if (!want_to_encode.count(chunk) || bl.length() != length)
+      return -EINVAL;
+  }
+  int r = encode_chunks(want_to_encode, &encoded);
+  if (r)
+    return r;
+  for (auto& [chunk, bl] : *coding)
+    region_xor_into(bl.c_str(), encoded[chunk].c_str(), length);
+  return 0;
+}
  
 int ErasureCode::_decode(const set<int> &want_to_read,
 			 const map<int, bufferlist> &chunks,
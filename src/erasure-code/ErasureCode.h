@@ -82,6 +82,13 @@ namespace ceph {
     int encode_chunks(const std::set<int> &want_to_encode,
                               std::map<int, bufferlist> *encoded) override;
 
+    int encode_delta(const bufferlist &old_data,
+                     const bufferlist &new_data,
+                     bufferlist *delta) override;
+
+    int apply_delta(const std::map<int, bufferlist> &deltas,
+                    std::map<int, bufferlist> *coding) override;
+
     int decode(const std::set<int> &want_to_read,
                 const std::map<int, bufferlist> &chunks,
                 std::map<int, bufferlist> *decoded, int chunk_size) override;
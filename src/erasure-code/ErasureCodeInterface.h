@@ -370,6 +370,43 @@ namespace ceph {
     virtual int encode_chunks(const std::set<int> &want_to_encode,
                               std::map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Compute the **delta** a change of a range of a data chunk from
+     * **old_data** to **new_data** makes to the coding chunks, to be
+     * given to **apply_delta**.
+     *
+     * **old_data** and **new_data** must have the same length.
+     *
+     * @param [in] old_data range of the data chunk before the change
+     * @param [in] new_data the same range after the change
+     * @param [out] delta of the range
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_delta(const bufferlist &old_data,
+                             const bufferlist &new_data,
+                             bufferlist *delta) = 0;
+
+    /**
+     * Update the **coding** chunks for the **deltas** of data chunks
+     * as computed by **encode_delta**, so that a small overwrite only
+     * needs to read and write the data chunks it changes and the
+     * coding chunks instead of re-encoding the whole stripe.
+     *
+     * All buffers must cover the same range of their chunks, and the
+     * range must start and end on a multiple of the chunk alignment,
+     * i.e. a length **l** for which get_chunk_size(k * l) == l.
+     * Only the coding chunks listed in **coding** are updated.
+     *
+     * Codes with more than one sub-chunk do not support it.
+     *
+     * @param [in] deltas map data chunk indexes to deltas
+     * @param [in,out] coding map coding chunk indexes to chunk data
+     * @return **0** on success, **-EOPNOTSUPP** if the code cannot
+     *         be updated this way or a negative errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferlist> &deltas,
+                            std::map<int, bufferlist> *coding) = 0;
+
     /**
      * Decode the **chunks** and store at least **want_to_read**
      * chunks in **decoded**.
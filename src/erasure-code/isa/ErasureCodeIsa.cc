@@ -132,6 +132,39 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+int
+ErasureCodeIsaDefault::apply_delta(const map<int, bufferlist> &deltas,
+                                   map<int, bufferlist> *coding)
+{
+  if (m == 1 || coding->size() != (unsigned)m || deltas.empty())
+    return ErasureCode::apply_delta(deltas, coding);
+
+  unsigned length = deltas.begin()->second.length();
+  if (get_chunk_size(k * length) != length)
+    return -EINVAL;
+  char *parity[m];
+  for (int i = 0; i < m; i++) {
+    auto c = coding->find(k + i);
+    if (c == coding->end() || c->second.length() != length)
+      return -EINVAL;
+    parity[i] = c->second.c_str();
+  }
+  for (auto& [chunk, delta] : deltas) {
+    if (chunk >= k || delta.length() != length)
+      return -EINVAL;
+  }
+  // add what each delta contributes to every coding chunk
+  for (auto& [chunk, delta] : deltas) {
+    bufferlist d = delta;
+    ec_encode_data_update(length, k, m, chunk, encode_tbls,
+                          (unsigned char*) d.c_str(),
+                          (unsigned char**) parity);
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
@@ -134,6 +134,9 @@ public:
                           char **coding,
                           int blocksize) override;
 
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+                  std::map<int, ceph::buffer::list> *coding) override;
+
   virtual bool erasure_contains(int *erasures, int i);
 
   int isa_decode(int *erasures,
@@ -53,9 +53,6 @@ ErasureCodeIsaTableCache::~ErasureCodeIsaTableCache()
   codec_tables_t::const_iterator tables_it;
   codec_table_t::const_iterator table_it;
 
-  std::map<int, lru_map_t*>::const_iterator lru_map_it;
-  std::map<int, lru_list_t*>::const_iterator lru_list_it;
-
   // clean-up all allocated tables
   for (ttables_it = encoding_coefficient.begin(); ttables_it != encoding_coefficient.end(); ++ttables_it) {
     for (tables_it = ttables_it->second.begin(); tables_it != ttables_it->second.end(); ++tables_it) {
@@ -82,18 +79,6 @@ ErasureCodeIsaTableCache::~ErasureCodeIsaTableCache()
       }
     }
   }
-
-  for (lru_map_it = decoding_tables.begin(); lru_map_it != decoding_tables.end(); ++lru_map_it) {
-    if (lru_map_it->second) {
-      delete lru_map_it->second;
-    }
-  }
-
-  for (lru_list_it = decoding_tables_lru.begin(); lru_list_it != decoding_tables_lru.end(); ++lru_list_it) {
-    if (lru_list_it->second) {
-      delete lru_list_it->second;
-    }
-  }
 }
 
 // -----------------------------------------------------------------------------
@@ -101,41 +86,22 @@ ErasureCodeIsaTableCache::~ErasureCodeIsaTableCache()
 int
 ErasureCodeIsaTableCache::getDecodingTableCacheSize(int matrixtype)
 {
-  std::lock_guard lock{codec_tables_guard};
-  if (decoding_tables[matrixtype])
-    return decoding_tables[matrixtype]->size();
+  std::shared_lock lock{codec_tables_guard};
+  auto cache = decoding_tables.find(matrixtype);
+  if (cache != decoding_tables.end())
+    return cache->second.tables.size();
   else
     return -1;
 }
 
 // -----------------------------------------------------------------------------
 
-ErasureCodeIsaTableCache::lru_map_t*
-ErasureCodeIsaTableCache::getDecodingTables(int matrix_type)
+std::string
+ErasureCodeIsaTableCache::getDecodingTableKey(const std::string &signature,
+                                              int k, int m)
 {
-  // the caller must hold the guard mutex:
-  // => std::lock_guard lock{codec_tables_guard};
-
-  // create an lru_map if not yet allocated
-  if (!decoding_tables[matrix_type]) {
-    decoding_tables[matrix_type] = new lru_map_t;
-  }
-  return decoding_tables[matrix_type];
-}
-
-// -----------------------------------------------------------------------------
-
-ErasureCodeIsaTableCache::lru_list_t*
-ErasureCodeIsaTableCache::getDecodingTablesLru(int matrix_type)
-{
-  // the caller must hold the guard mutex:
-  // => std::lock_guard lock{codec_tables_guard};
-
-  // create an lru_list if not yet allocated
-  if (!decoding_tables_lru[matrix_type]) {
-    decoding_tables_lru[matrix_type] = new lru_list_t;
-  }
-  return decoding_tables_lru[matrix_type];
+  // the signature only lists chunk indices, which different (k,m) share
+  return std::to_string(k) + "/" + std::to_string(m) + signature;
 }
 
 // -----------------------------------------------------------------------------
@@ -222,14 +188,6 @@ ErasureCodeIsaTableCache::setEncodingCoefficient(int matrix, int k, int m, unsig
 
 // -----------------------------------------------------------------------------
 
-ceph::mutex*
-ErasureCodeIsaTableCache::getLock()
-{
-  return &codec_tables_guard;
-}
-
-// -----------------------------------------------------------------------------
-
 bool
 ErasureCodeIsaTableCache::getDecodingTableFromCache(std::string &signature,
                                                     unsigned char* &table,
@@ -238,33 +196,29 @@ ErasureCodeIsaTableCache::getDecodingTableFromCache(std::string &signature,
                                                     int m)
 {
   // --------------------------------------------------------------------------
-  // LRU decoding matrix cache
+  // clock decoding matrix cache
   // --------------------------------------------------------------------------
 
   dout(12) << "[ get table    ] = " << signature << dendl;
 
-  // we try to fetch a decoding table from an LRU cache
-  bool found = false;
+  std::string key = getDecodingTableKey(signature, k, m);
 
-  std::lock_guard lock{codec_tables_guard};
+  // we try to fetch a decoding table from the cache
+  std::shared_lock lock{codec_tables_guard};
 
-  lru_map_t* decode_tbls_map =
-    getDecodingTables(matrixtype);
+  auto cache = decoding_tables.find(matrixtype);
+  if (cache == decoding_tables.end())
+    return false;
 
-  lru_list_t* decode_tbls_lru =
-    getDecodingTablesLru(matrixtype);
+  auto entry = cache->second.tables.find(key);
+  if (entry == cache->second.tables.end())
+    return false;
 
-  if (decode_tbls_map->count(signature)) {
-    dout(12) << "[ cached table ] = " << signature << dendl;
-    // copy the table out of the cache
-    memcpy(table, (*decode_tbls_map)[signature].second.c_str(), k * (m + k)*32);
-    // find item in LRU queue and push back
-    dout(12) << "[ cache size   ] = " << decode_tbls_lru->size() << dendl;
-    decode_tbls_lru->splice( (decode_tbls_lru->begin()), *decode_tbls_lru, (*decode_tbls_map)[signature].first);
-    found = true;
-  }
-
-  return found;
+  dout(12) << "[ cached table ] = " << signature << dendl;
+  // copy the table out of the cache
+  memcpy(table, entry->second.table.c_str(), k * (m + k)*32);
+  entry->second.referenced.store(true, std::memory_order_relaxed);
+  return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -277,51 +231,56 @@ ErasureCodeIsaTableCache::putDecodingTableToCache(std::string &signature,
                                                   int m)
 {
   // --------------------------------------------------------------------------
-  // LRU decoding matrix cache
+  // clock decoding matrix cache
   // --------------------------------------------------------------------------
 
   dout(12) << "[ put table    ] = " << signature << dendl;
 
+  std::string key = getDecodingTableKey(signature, k, m);
+  unsigned length = k * (m + k)*32;
+
   // we store a new table to the cache
 
   ceph::buffer::ptr cachetable;
 
   std::lock_guard lock{codec_tables_guard};
 
-  lru_map_t* decode_tbls_map =
-    getDecodingTables(matrixtype);
+  decoding_cache_t &cache = decoding_tables[matrixtype];
 
-  lru_list_t* decode_tbls_lru =
-    getDecodingTablesLru(matrixtype);
+  if (cache.tables.count(key)) {
+    // somebody might have deposited this table in the meanwhile
+    return;
+  }
 
-  // evt. shrink the LRU queue/map
-  if ((int) decode_tbls_lru->size() >= ErasureCodeIsaTableCache::decoding_tables_lru_length) {
-    dout(12) << "[ shrink lru   ] = " << signature << dendl;
+  size_t slot = cache.clock.size();
+  if ((int) cache.clock.size() >= ErasureCodeIsaTableCache::decoding_tables_lru_length) {
+    // evict the first table not used since the hand last passed it
+    while (cache.clock[cache.hand]->second.referenced.load(std::memory_order_relaxed)) {
+      cache.clock[cache.hand]->second.referenced.store(false, std::memory_order_relaxed);
+      cache.hand = (cache.hand + 1) % cache.clock.size();
+    }
+    slot = cache.hand;
+    cache.hand = (cache.hand + 1) % cache.clock.size();
+    dout(12) << "[ evict table  ] = " << cache.clock[slot]->first << dendl;
     // reuse old buffer
-    cachetable = (*decode_tbls_map)[decode_tbls_lru->back()].second;
-
-    if ((int) cachetable.length() != (k * (m + k)*32)) {
+    cachetable = cache.clock[slot]->second.table;
+    if (cachetable.length() != length) {
       // we need to replace this with a different size buffer
-      cachetable = ceph::buffer::create(k * (m + k)*32);
+      cachetable = ceph::buffer::create(length);
     }
-
-    // remove from map
-    decode_tbls_map->erase(decode_tbls_lru->back());
-    // remove from lru
-    decode_tbls_lru->pop_back();
-    // add to the head of lru
-    decode_tbls_lru->push_front(signature);
-    // add the new to the map
-    (*decode_tbls_map)[signature] = std::make_pair(decode_tbls_lru->begin(), cachetable);
+    cache.tables.erase(cache.clock[slot]->first);
   } else {
     dout(12) << "[ store table  ] = " << signature << dendl;
     // allocate a new buffer
-    cachetable = ceph::buffer::create(k * (m + k)*32);
-    decode_tbls_lru->push_front(signature);
-    (*decode_tbls_map)[signature] = std::make_pair(decode_tbls_lru->begin(), cachetable);
-    dout(12) << "[ cache size   ] = " << decode_tbls_lru->size() << dendl;
+    cachetable = ceph::buffer::create(length);
+    cache.clock.push_back(nullptr);
   }
 
   // copy-in the new table
-  memcpy(cachetable.c_str(), table, k * (m + k)*32);
+  memcpy(cachetable.c_str(), table, length);
+
+  auto entry = cache.tables.try_emplace(key).first;
+  entry->second.table = cachetable;
+  cache.clock[slot] = &*entry;
+  dout(12) << "[ cache size   ] = " << cache.tables.size() << dendl;
 }
@@ -27,18 +27,26 @@
 
 // -----------------------------------------------------------------------------
 #include "common/ceph_mutex.h"
+#include "include/buffer.h"
 #include "erasure-code/ErasureCodeInterface.h"
 // -----------------------------------------------------------------------------
-#include <list>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
 // -----------------------------------------------------------------------------
 
 class ErasureCodeIsaTableCache {
   // ---------------------------------------------------------------------------
   // This class implements a table cache for encoding and decoding matrices.
   // Encoding matrices are shared for the same (k,m) combination. It supplies
-  // a decoding matrix lru cache which is shared for identical
-  // matrix types e.g. there is one cache (lru-list + lru-map) for Cauchy and
-  // one for Vandermonde matrices!
+  // a decoding matrix cache which is shared for identical
+  // matrix types e.g. there is one cache for Cauchy and one for Vandermonde
+  // matrices, holding the tables of every (k,m) combination!
+  //
+  // Lookups only take the guard shared. The decoding tables are evicted in
+  // clock order: a table that was used since the clock hand last passed it
+  // gets another round, so that a burst of one-off erasure patterns does not
+  // push out the tables in use.
   // ---------------------------------------------------------------------------
 
 public:
@@ -47,20 +55,29 @@ public:
 
   static const int decoding_tables_lru_length = 2516;
 
-  typedef std::pair<std::list<std::string>::iterator, ceph::buffer::ptr> lru_entry_t;
   typedef std::map< int, unsigned char** > codec_table_t;
   typedef std::map< int, codec_table_t > codec_tables_t;
   typedef std::map< int, codec_tables_t > codec_technique_tables_t;
 
-  typedef std::map< std::string, lru_entry_t > lru_map_t;
-  typedef std::list< std::string > lru_list_t;
+  struct decoding_table_t {
+    ceph::buffer::ptr table;
+    std::atomic<bool> referenced = {false}; // used since the hand passed
+  };
+  // keyed by (k,m) and erasure signature
+  typedef std::unordered_map< std::string, decoding_table_t > decoding_map_t;
+  struct decoding_cache_t {
+    decoding_map_t tables;
+    std::vector< decoding_map_t::value_type* > clock;
+    size_t hand = 0;
+  };
 
   ErasureCodeIsaTableCache() = default;
 
   virtual ~ErasureCodeIsaTableCache();
 
   // mutex used to protect modifications in encoding/decoding table maps
-  ceph::mutex codec_tables_guard = ceph::make_mutex("isa-lru-cache");
+  ceph::shared_mutex codec_tables_guard =
+    ceph::make_shared_mutex("isa-lru-cache");
 
   bool getDecodingTableFromCache(std::string &signature,
                                  unsigned char* &table,
@@ -89,14 +106,10 @@ private:
   codec_technique_tables_t encoding_coefficient; // encoding coefficients accessed via table[matrix][k][m]
   codec_technique_tables_t encoding_table; // encoding coefficients accessed via table[matrix][k][m]
 
-  std::map<int, lru_map_t*> decoding_tables; // decoding table cache accessed via map[matrixtype]
-  std::map<int, lru_list_t*> decoding_tables_lru; // decoding table lru list accessed via list[matrixtype]
+  std::map<int, decoding_cache_t> decoding_tables; // decoding table cache accessed via map[matrixtype]
 
-  lru_map_t* getDecodingTables(int matrix_type);
-
-  lru_list_t* getDecodingTablesLru(int matrix_type);
-
-  ceph::mutex* getLock();
+  static std::string getDecodingTableKey(const std::string &signature,
+                                         int k, int m);
 
 };
 
@@ -329,6 +329,9 @@ inline namespace v15_2_0 {
 
     int cmp(const ptr& o) const;
     bool is_zero() const;
+    /// note crc32c(@p seed) of the contents, found some other way, for
+    /// list::crc32c() to pick up
+    void set_crc32c(uint32_t seed, uint32_t crc) const;
 
     // modifiers
     void set_offset(unsigned o) {
@@ -411,6 +414,11 @@ inline namespace v15_2_0 {
 
     static ptr_node* copy_hypercombined(const ptr_node& copy_this);
 
+    // the storage of freed nodes is kept in a small per-thread stash and
+    // handed out again, short-lived lists go through nodes at a high rate
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
   private:
     template <class... Args>
     ptr_node(Args&&... args) : ptr(std::forward<Args>(args)...) {
@@ -1224,6 +1232,9 @@ inline namespace v15_2_0 {
     void update(const buffer::list& bl) {
       crc = bl.crc32c(crc);
     }
+    void update(const char *p, size_t len) {
+      crc = ceph_crc32c(crc, (const unsigned char*)p, len);
+    }
 
     uint32_t digest() {
       return crc;
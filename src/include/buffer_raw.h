@@ -102,6 +102,20 @@ public:
       }
       return false;
     }
+    /// the cached crc, if it is for a part of fromto
+    bool get_crc_within(const std::pair<size_t, size_t> &fromto,
+			std::pair<size_t, size_t> *range,
+			std::pair<uint32_t, uint32_t> *crc) const {
+      std::lock_guard lg(crc_spinlock);
+      if (last_crc_offset.first >= fromto.first &&
+	  last_crc_offset.second <= fromto.second &&
+	  last_crc_offset.first < last_crc_offset.second) {
+	*range = last_crc_offset;
+	*crc = last_crc_val;
+	return true;
+      }
+      return false;
+    }
     void set_crc(const std::pair<size_t, size_t> &fromto,
 		 const std::pair<uint32_t, uint32_t> &crc) {
       std::lock_guard lg(crc_spinlock);
@@ -211,6 +211,9 @@
 /* Define to 1 if you have the <linux/version.h> header file. */
 #cmakedefine HAVE_LINUX_VERSION_H 1
 
+/* Define to 1 if you have the <linux/blkzoned.h> header file. */
+#cmakedefine HAVE_LINUX_BLKZONED_H 1
+
 /* Define to 1 if you have sched.h. */
 #cmakedefine HAVE_SCHED 1
 
@@ -348,6 +351,9 @@
 /* Define if RWL is enabled */
 #cmakedefine WITH_RBD_RWL
 
+/* Define if the SSD write back cache is enabled */
+#cmakedefine WITH_RBD_SSD_CACHE
+
 /* Shared library extension, such as .so, .dll or .dylib */
 #cmakedefine CMAKE_SHARED_LIBRARY_SUFFIX "@CMAKE_SHARED_LIBRARY_SUFFIX@"
 
@@ -50,6 +50,26 @@ static inline uint32_t ceph_crc32c(uint32_t crc, unsigned char const *data, unsi
   return ceph_crc32c_func(crc, data, length);
 }
 
+/**
+ * combine the crc32c of two buffers
+ *
+ * Since our crc32c has no final xor, the crc of a buffer is linear in the
+ * initial value: crc32c(B, v) = crc32c(B, 0) ^ crc32c(0*len(B), v).
+ *
+ * @param crc_a crc32c of the first buffer (with any initial value)
+ * @param crc_b crc32c of the second buffer with initial value 0
+ * @param length_b length of the second buffer
+ * @return crc32c of the first buffer followed by the second
+ *
+ * A crc of B with initial value v is rebased to initial value w with
+ * ceph_crc32c_combine(v ^ w, crc32c(B, v), len(B)).
+ */
+static inline uint32_t ceph_crc32c_combine(uint32_t crc_a, uint32_t crc_b,
+					   unsigned length_b)
+{
+  return crc_b ^ ceph_crc32c(crc_a, NULL, length_b);
+}
+
 #ifdef __cplusplus
 }
 #endif
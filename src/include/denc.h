@@ -1608,7 +1608,16 @@ inline std::enable_if_t<traits::supported && traits::need_contiguous> decode(
   // bumping the raw ref and initializing the ptr tmp fields.
   ceph::buffer::ptr tmp;
   auto t = p;
-  t.copy_shallow(p.get_bl().length() - p.get_off(), tmp);
+  if constexpr (traits::bounded) {
+    // a bounded type never needs more than its bound, don't rebuild the
+    // rest of the list for it
+    size_t len = 0;
+    traits::bound_encode(o, len);
+    t.copy_shallow(std::min<size_t>(len, p.get_bl().length() - p.get_off()),
+		   tmp);
+  } else {
+    t.copy_shallow(p.get_bl().length() - p.get_off(), tmp);
+  }
   auto cp = std::cbegin(tmp);
   traits::decode(o, cp);
   p += cp.get_offset();
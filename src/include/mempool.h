@@ -15,6 +15,7 @@
 #ifndef _CEPH_INCLUDE_MEMPOOL_H
 #define _CEPH_INCLUDE_MEMPOOL_H
 
+#include <atomic>
 #include <cstddef>
 #include <map>
 #include <unordered_map>
@@ -158,6 +159,7 @@ namespace mempool {
   f(bluefs)			      \
   f(buffer_anon)		      \
   f(buffer_meta)		      \
+  f(buffer_pool)		      \
   f(osd)			      \
   f(osd_mapbl)			      \
   f(osd_pglog)			      \
@@ -180,6 +182,20 @@ enum pool_index_t {
 extern bool debug_mode;
 extern void set_debug_mode(bool d);
 
+// Only 1 in 2^sample_shift allocations by the pool_allocators are
+// accounted for, each as 2^sample_shift of them.  Whether an allocation
+// is sampled depends on its address only, so that its deallocation is too.
+extern unsigned sample_shift;
+extern void set_sample_shift(unsigned s);
+
+inline bool is_sampled(const void *p, unsigned shift) {
+  if (!shift) {
+    return true;
+  }
+  uint64_t h = (reinterpret_cast<uintptr_t>(p) >> 4) * 0x9e3779b97f4a7c15ull;
+  return (h >> (64 - shift)) == 0;
+}
+
 // --------------------------------------------------------------
 class pool_t;
 
@@ -246,12 +262,26 @@ public:
 
   void adjust_count(ssize_t items, ssize_t bytes);
 
+  // The shard of the calling thread.  Threads are handed the shards round
+  // robin, so that up to num_shards of them never share one.
+  static size_t pick_a_shard_int() {
+    static std::atomic<size_t> next_shard = {0};
+    thread_local size_t i = next_shard++ & (num_shards - 1);
+    return i;
+  }
+
   shard_t* pick_a_shard() {
-    // Dirt cheap, see:
-    //   http://fossies.org/dox/glibc-2.24/pthread__self_8c_source.html
-    size_t me = (size_t)pthread_self();
-    size_t i = (me >> 3) & ((1 << num_shard_bits) - 1);
-    return &shard[i];
+    return &shard[pick_a_shard_int()];
+  }
+
+  // account for an allocation at p by a pool_allocator
+  void account(const void *p, ssize_t items, ssize_t bytes) {
+    unsigned shift = sample_shift;
+    if (is_sampled(p, shift)) {
+      shard_t *s = pick_a_shard();
+      s->bytes += bytes * ((ssize_t)1 << shift);
+      s->items += items * ((ssize_t)1 << shift);
+    }
   }
 
   type_t *get_type(const std::type_info& ti, size_t size) {
@@ -316,21 +346,17 @@ public:
 
   T* allocate(size_t n, void *p = nullptr) {
     size_t total = sizeof(T) * n;
-    shard_t *shard = pool->pick_a_shard();
-    shard->bytes += total;
-    shard->items += n;
+    T* r = reinterpret_cast<T*>(new char[total]);
+    pool->account(r, n, total);
     if (type) {
       type->items += n;
     }
-    T* r = reinterpret_cast<T*>(new char[total]);
     return r;
   }
 
   void deallocate(T* p, size_t n) {
     size_t total = sizeof(T) * n;
-    shard_t *shard = pool->pick_a_shard();
-    shard->bytes -= total;
-    shard->items -= n;
+    pool->account(p, -(ssize_t)n, -(ssize_t)total);
     if (type) {
       type->items -= n;
     }
@@ -339,25 +365,21 @@ public:
 
   T* allocate_aligned(size_t n, size_t align, void *p = nullptr) {
     size_t total = sizeof(T) * n;
-    shard_t *shard = pool->pick_a_shard();
-    shard->bytes += total;
-    shard->items += n;
-    if (type) {
-      type->items += n;
-    }
     char *ptr;
     int rc = ::posix_memalign((void**)(void*)&ptr, align, total);
     if (rc)
       throw std::bad_alloc();
     T* r = reinterpret_cast<T*>(ptr);
+    pool->account(r, n, total);
+    if (type) {
+      type->items += n;
+    }
     return r;
   }
 
   void deallocate_aligned(T* p, size_t n) {
     size_t total = sizeof(T) * n;
-    shard_t *shard = pool->pick_a_shard();
-    shard->bytes -= total;
-    shard->items -= n;
+    pool->account(p, -(ssize_t)n, -(ssize_t)total);
     if (type) {
       type->items -= n;
     }
@@ -321,6 +321,9 @@ extern const char *ceph_osd_state_name(int s);
 	f(WRITESAME,	__CEPH_OSD_OP(WR, DATA, 38),	"write-same")	    \
 	f(CMPEXT,	__CEPH_OSD_OP(RD, DATA, 32),	"cmpext")	    \
 									    \
+	/* EC: read the chunks held by the shard the op is sent to */	    \
+	f(SHARD_READ,	__CEPH_OSD_OP(RD, DATA, 33),	"shard-read")	    \
+									    \
 	/* Extensible */						    \
 	f(SET_REDIRECT,	__CEPH_OSD_OP(WR, DATA, 39),	"set-redirect")	    \
 	f(SET_CHUNK,	__CEPH_OSD_OP(WR, DATA, 40),	"set-chunk")	    \
@@ -419,6 +422,7 @@ static inline bool ceph_osd_op_uses_extent(int op)
 	case CEPH_OSD_OP_APPEND:
 	case CEPH_OSD_OP_TRIMTRUNC:
 	case CEPH_OSD_OP_CMPEXT:
+	case CEPH_OSD_OP_SHARD_READ:
 		return true;
 	default:
 		return false;
@@ -472,6 +476,7 @@ enum {
 	CEPH_OSD_FLAG_FULL_FORCE = 0x1000000,  /* force op despite full flag */
 	CEPH_OSD_FLAG_IGNORE_REDIRECT = 0x2000000,  /* ignore redirection */
 	CEPH_OSD_FLAG_RETURNVEC = 0x4000000, /* allow overall result >= 0, and return >= 0 and buffer for each op in opvec */
+	CEPH_OSD_FLAG_TRACE_STAGES = 0x8000000, /* reply with osd stage timings */
 };
 
 enum {
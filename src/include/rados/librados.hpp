@@ -1,6 +1,7 @@
 #ifndef __LIBRADOS_HPP
 #define __LIBRADOS_HPP
 
+#include <functional>
 #include <string>
 #include <list>
 #include <map>
@@ -210,6 +211,20 @@ inline namespace v14_2_0 {
     AioCompletionImpl *pc;
   };
 
+  /**
+   * Completion owned by the caller, for aio_operate() without the
+   * allocation and locking behind an AioCompletion
+   *
+   * complete() is called exactly once, with the result of the op, from a
+   * librados thread that must not be blocked.  The object has to stay
+   * valid until then.  Ops completing this way are not waited for by
+   * aio_flush().
+   */
+  struct CEPH_RADOS_API AioCallback {
+    virtual ~AioCallback() {}
+    virtual void complete(int r) = 0;
+  };
+
   struct CEPH_RADOS_API PoolAsyncCompletion {
     PoolAsyncCompletion(PoolAsyncCompletionImpl *pc_) : pc(pc_) {}
     ~PoolAsyncCompletion();
@@ -978,6 +993,31 @@ inline namespace v14_2_0 {
         ObjectCursor *split_start,
         ObjectCursor *split_finish);
 
+    /**
+     * List all objects of the pool, with up to @p window PG listings in
+     * flight at once
+     *
+     * @p cb is handed each batch of up to @p result_count objects as it
+     * arrives, in no particular order, and never concurrently with
+     * itself.  A negative return from it stops the listing.
+     *
+     * @param filter as for object_list(), see object_list_match_filter()
+     * @returns 0 on success, negative error code on failure
+     */
+    int object_list_parallel(const bufferlist &filter, unsigned window,
+                             size_t result_count,
+                             std::function<int(std::vector<ObjectItem>&)> cb);
+
+    /**
+     * Build a filter that OSDs evaluate while listing: only objects whose
+     * name starts with @p prefix and, if @p xattr is not empty, that have
+     * that xattr, set to @p *value unless it is null, are returned.
+     */
+    static void object_list_match_filter(const std::string &prefix,
+                                         const std::string &xattr,
+                                         const std::string *value,
+                                         bufferlist *filter);
+
     /**
      * List available hit set objects
      *
@@ -1105,6 +1145,20 @@ inline namespace v14_2_0 {
      * @returns 0 on success, negative error code on failure
      */
     int aio_flush_async(AioCompletion *c);
+
+    /**
+     * Hold back aio_operate() calls briefly to send them together
+     *
+     * While enabled, ops submitted with aio_operate() are queued and
+     * sent once rados_aio_batch_max_ops or rados_aio_batch_max_bytes is
+     * reached, or rados_aio_batch_usec after the first one, whichever
+     * comes first.  Ops to one object keep their order, and any other
+     * op submitted through this IoCtx sends the queued ones first.
+     * Disabling sends whatever is queued.
+     *
+     * @param enable whether to batch
+     */
+    void set_aio_batching(bool enable);
     int aio_getxattr(const std::string& oid, AioCompletion *c, const char *name, bufferlist& bl);
     int aio_getxattrs(const std::string& oid, AioCompletion *c, std::map<std::string, bufferlist>& attrset);
     int aio_setxattr(const std::string& oid, AioCompletion *c, const char *name, bufferlist& bl);
@@ -1175,6 +1229,10 @@ inline namespace v14_2_0 {
     int aio_operate(const std::string& oid, AioCompletion *c,
         ObjectReadOperation *op, int flags,
         bufferlist *pbl, const blkin_trace_info *trace_info);
+    int aio_operate(const std::string& oid, AioCallback *cb,
+		    ObjectWriteOperation *op, int flags);
+    int aio_operate(const std::string& oid, AioCallback *cb,
+		    ObjectReadOperation *op, int flags, bufferlist *pbl);
 
     // watch/notify
     int watch2(const std::string& o, uint64_t *handle,
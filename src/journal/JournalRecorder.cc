@@ -319,6 +319,8 @@ ceph::ref_t<ObjectRecorder> JournalRecorder::create_object_recorder(
     m_max_in_flight_appends);
   object_recorder->set_append_batch_options(m_flush_interval, m_flush_bytes,
                                             m_flush_age);
+  object_recorder->set_adaptive_batching(
+    m_journal_metadata->get_settings().adaptive_append_batching);
   return object_recorder;
 }
 
@@ -338,6 +340,7 @@ bool JournalRecorder::create_next_object_recorder(
 
   ldout(m_cct, 10) << "old oid=" << object_recorder->get_oid() << ", "
                    << "new oid=" << new_object_recorder->get_oid() << dendl;
+  new_object_recorder->set_append_stats(object_recorder->get_append_stats());
   AppendBuffers append_buffers;
   object_recorder->claim_append_buffers(&append_buffers);
 
@@ -19,6 +19,19 @@ using std::shared_ptr;
 
 namespace journal {
 
+namespace {
+
+void update_average(double *average, double sample) {
+  // weigh the latest sample as TCP does its round trip time
+  if (*average == 0) {
+    *average = sample;
+  } else {
+    *average += (sample - *average) / 8;
+  }
+}
+
+} // anonymous namespace
+
 ObjectRecorder::ObjectRecorder(librados::IoCtx &ioctx, std::string_view oid,
                                uint64_t object_number, ceph::mutex* lock,
                                ContextWQ *work_queue, Handler *handler,
@@ -65,6 +78,13 @@ void ObjectRecorder::set_append_batch_options(int flush_interval,
   m_flush_age = flush_age;
 }
 
+void ObjectRecorder::set_adaptive_batching(bool adaptive_batching) {
+  ldout(m_cct, 5) << "adaptive_batching=" << adaptive_batching << dendl;
+
+  ceph_assert(ceph_mutex_is_locked(*m_lock));
+  m_adaptive_batching = adaptive_batching;
+}
+
 bool ObjectRecorder::append(AppendBuffers &&append_buffers) {
   ldout(m_cct, 20) << "count=" << append_buffers.size() << dendl;
 
@@ -84,6 +104,17 @@ bool ObjectRecorder::append(AppendBuffers &&append_buffers) {
     m_pending_bytes += append_buffer.second.length();
   }
 
+  if (!append_buffers.empty()) {
+    auto now = ceph_clock_now();
+    auto& last_append_time = m_append_stats.last_append_time;
+    if (!last_append_time.is_zero()) {
+      update_average(&m_append_stats.append_interval,
+                     static_cast<double>(now - last_append_time) /
+                       append_buffers.size());
+    }
+    last_append_time = now;
+  }
+
   return send_appends(!!last_flushed_future, last_flushed_future);
 }
 
@@ -187,6 +218,12 @@ void ObjectRecorder::handle_append_flushed(uint64_t tid, int r) {
   ceph_assert(tid_iter != m_in_flight_tids.end());
   m_in_flight_tids.erase(tid_iter);
 
+  auto time_iter = m_in_flight_times.find(tid);
+  ceph_assert(time_iter != m_in_flight_times.end());
+  update_average(&m_append_stats.append_latency,
+                 ceph_clock_now() - time_iter->second);
+  m_in_flight_times.erase(time_iter);
+
   InFlightAppends::iterator iter = m_in_flight_appends.find(tid);
   ceph_assert(iter != m_in_flight_appends.end());
 
@@ -290,20 +327,28 @@ bool ObjectRecorder::send_appends(bool force, ceph::ref_t<FutureImpl> flush_futu
     m_last_flush_time = ceph_clock_now();
   }
 
-  auto max_in_flight_appends = m_max_in_flight_appends;
-  if (m_flush_interval > 0 || m_flush_bytes > 0 || m_flush_age > 0) {
-    if (!force && max_in_flight_appends == 0) {
+  if (m_adaptive_batching) {
+    if (!force && !is_adaptive_batch_ready()) {
       ldout(m_cct, 20) << "attempting to batch AIO appends" << dendl;
-      max_in_flight_appends = 1;
+      return false;
+    }
+  } else {
+    auto max_in_flight_appends = m_max_in_flight_appends;
+    if (m_flush_interval > 0 || m_flush_bytes > 0 || m_flush_age > 0) {
+      if (!force && max_in_flight_appends == 0) {
+        ldout(m_cct, 20) << "attempting to batch AIO appends" << dendl;
+        max_in_flight_appends = 1;
+      }
+    } else if (max_in_flight_appends < 0) {
+      max_in_flight_appends = 0;
     }
-  } else if (max_in_flight_appends < 0) {
-    max_in_flight_appends = 0;
-  }
 
-  if (!force && max_in_flight_appends != 0 &&
-      static_cast<int32_t>(m_in_flight_tids.size()) >= max_in_flight_appends) {
-    ldout(m_cct, 10) << "max in flight appends reached" << dendl;
-    return false;
+    if (!force && max_in_flight_appends != 0 &&
+        static_cast<int32_t>(m_in_flight_tids.size()) >=
+          max_in_flight_appends) {
+      ldout(m_cct, 10) << "max in flight appends reached" << dendl;
+      return false;
+    }
   }
 
   librados::ObjectWriteOperation op;
@@ -353,6 +398,7 @@ bool ObjectRecorder::send_appends(bool force, ceph::ref_t<FutureImpl> flush_futu
 
     uint64_t append_tid = m_append_tid++;
     m_in_flight_tids.insert(append_tid);
+    m_in_flight_times[append_tid] = m_last_flush_time;
     m_in_flight_appends[append_tid].swap(append_buffers);
     m_in_flight_bytes += append_bytes;
 
@@ -377,6 +423,36 @@ bool ObjectRecorder::send_appends(bool force, ceph::ref_t<FutureImpl> flush_futu
   return m_overflowed;
 }
 
+bool ObjectRecorder::is_adaptive_batch_ready() const {
+  ceph_assert(ceph_mutex_is_locked(*m_lock));
+  if (m_in_flight_tids.empty()) {
+    // nothing to batch behind
+    return true;
+  }
+
+  int32_t max_in_flight_appends = m_max_in_flight_appends > 0 ?
+    m_max_in_flight_appends : ADAPTIVE_MAX_IN_FLIGHT_APPENDS;
+  if (static_cast<int32_t>(m_in_flight_tids.size()) >= max_in_flight_appends) {
+    ldout(m_cct, 20) << "max in flight appends reached" << dendl;
+    return false;
+  }
+
+  // the entries expected while an append is in flight are spread over all
+  // of the appends which may be in flight: a light load is sent right away,
+  // a heavy one in fewer, larger appends
+  double expected_appends = 0;
+  if (m_append_stats.append_interval > 0) {
+    expected_appends = (m_append_stats.append_latency /
+                        m_append_stats.append_interval);
+  }
+  uint64_t batch_size = std::max<uint64_t>(
+    1, expected_appends / max_in_flight_appends);
+  ldout(m_cct, 20) << "append_interval=" << m_append_stats.append_interval
+                   << ", append_latency=" << m_append_stats.append_latency
+                   << ", batch_size=" << batch_size << dendl;
+  return m_pending_buffers.size() >= batch_size;
+}
+
 void ObjectRecorder::wake_up_flushes() {
   ceph_assert(ceph_mutex_is_locked(*m_lock));
   m_in_flight_callbacks = false;
@@ -35,8 +35,26 @@ public:
     virtual void overflow(ObjectRecorder *object_recorder) = 0;
   };
 
+  /// moving averages of the appends, carried over to the next object of the
+  /// same splay offset so that it starts from them
+  struct AppendStats {
+    utime_t last_append_time;
+    double append_interval = 0;  ///< seconds between appended entries
+    double append_latency = 0;   ///< seconds an append is in flight
+  };
+
   void set_append_batch_options(int flush_interval, uint64_t flush_bytes,
                                 double flush_age);
+  void set_adaptive_batching(bool adaptive_batching);
+
+  const AppendStats &get_append_stats() const {
+    ceph_assert(ceph_mutex_is_locked(*m_lock));
+    return m_append_stats;
+  }
+  void set_append_stats(const AppendStats &append_stats) {
+    ceph_assert(ceph_mutex_is_locked(*m_lock));
+    m_append_stats = append_stats;
+  }
 
   inline uint64_t get_object_number() const {
     return m_object_number;
@@ -74,7 +92,10 @@ private:
                  int32_t max_in_flight_appends);
   ~ObjectRecorder() override;
 
+  static const int32_t ADAPTIVE_MAX_IN_FLIGHT_APPENDS = 4;
+
   typedef std::set<uint64_t> InFlightTids;
+  typedef std::map<uint64_t, utime_t> InFlightTimes;
   typedef std::map<uint64_t, AppendBuffers> InFlightAppends;
 
   struct FlushHandler : public FutureImpl::FlushHandler {
@@ -111,6 +132,7 @@ private:
   uint64_t m_flush_bytes = 0;
   double m_flush_age = 0;
   int32_t m_max_in_flight_appends;
+  bool m_adaptive_batching = false;
 
   bool m_compat_mode;
 
@@ -134,6 +156,8 @@ private:
 
   InFlightTids m_in_flight_tids;
   InFlightAppends m_in_flight_appends;
+  InFlightTimes m_in_flight_times;
+  AppendStats m_append_stats;
   uint64_t m_object_bytes = 0;
 
   bool m_overflowed = false;
@@ -148,6 +172,7 @@ private:
   uint64_t m_in_flight_bytes = 0;
 
   bool send_appends(bool force, ceph::ref_t<FutureImpl> flush_sentinal);
+  bool is_adaptive_batch_ready() const;
   void handle_append_flushed(uint64_t tid, int r);
   void append_overflowed();
 
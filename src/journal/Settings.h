@@ -12,6 +12,9 @@ struct Settings {
   double commit_interval = 5;         ///< commit position throttle (in secs)
   uint64_t max_payload_bytes = 0;     ///< 0 implies object size limit
   int max_concurrent_object_sets = 0; ///< 0 implies no limit
+  bool adaptive_append_batching = false;
+                                      ///< size append batches from the
+                                      ///< observed append rate and latency
   std::set<std::string> whitelisted_laggy_clients;
                                       ///< clients that mustn't be disconnected
 };
@@ -330,6 +330,10 @@ public:
     return -EOPNOTSUPP;
   }
 
+  virtual int set_delete_range_threshold(uint64_t) {
+    return -EOPNOTSUPP;
+  }
+
   virtual int set_cache_high_pri_pool_ratio(double ratio) {
     return -EOPNOTSUPP;
   }
@@ -342,6 +346,11 @@ public:
     return nullptr;
   }
 
+  /// memory for write buffers, if the backend lets it be tuned
+  virtual std::shared_ptr<PriorityCache::PriCache> get_memtable_priority_cache() const {
+    return nullptr;
+  }
+
   virtual ~KeyValueDB() {}
 
   /// estimate space utilization for a prefix (in bytes)
@@ -17,6 +17,7 @@
 #include "rocksdb/cache.h"
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/utilities/convenience.h"
+#include "rocksdb/write_buffer_manager.h"
 #include "rocksdb/merge_operator.h"
 
 #include "common/perf_counters.h"
@@ -52,6 +53,7 @@ using ceph::Formatter;
 static const char* sharding_def_dir = "sharding";
 static const char* sharding_def_file = "sharding/def";
 static const char* sharding_recreate = "sharding/recreate_columns";
+static const char* sharding_resharding = "sharding/resharding";
 
 static bufferlist to_bufferlist(rocksdb::Slice in) {
   bufferlist bl;
@@ -334,6 +336,110 @@ int RocksDBStore::create_db_dir()
   return 0;
 }
 
+//
+// Lets the PriorityCache manager size the memory all memtables may take
+// together. The current usage is mandatory; while writes keep filling that
+// up more is asked for, up to what the static column family options allow.
+//
+class RocksDBStore::MemtableCache : public PriorityCache::PriCache {
+  CephContext *cct;
+  std::shared_ptr<rocksdb::WriteBufferManager> wbm;
+  int64_t cache_bytes[PriorityCache::Priority::LAST+1] = {0};
+  int64_t committed_bytes = 0;
+  double cache_ratio = 0;
+  uint64_t min_bytes;
+  uint64_t max_bytes;
+
+public:
+  MemtableCache(CephContext *cct, uint64_t min_bytes, uint64_t max_bytes)
+    : cct(cct),
+      wbm(std::make_shared<rocksdb::WriteBufferManager>(max_bytes)),
+      committed_bytes(max_bytes),
+      min_bytes(min_bytes),
+      max_bytes(max_bytes) {}
+
+  std::shared_ptr<rocksdb::WriteBufferManager> get_write_buffer_manager() {
+    return wbm;
+  }
+  /// cap the budget and start from there until the next balance
+  void set_max_bytes(uint64_t max) {
+    max_bytes = std::max(max, min_bytes);
+    committed_bytes = max_bytes;
+    wbm->SetBufferSize(max_bytes);
+  }
+
+  int64_t request_cache_bytes(
+      PriorityCache::Priority pri, uint64_t total_cache) const override {
+    int64_t assigned = get_cache_bytes(pri);
+    int64_t usage = std::max<int64_t>(wbm->memory_usage(), min_bytes);
+    int64_t request = 0;
+    switch (pri) {
+    // memory the memtables already hold
+    case PriorityCache::Priority::PRI0:
+      request = usage;
+      break;
+    // room to absorb a write burst
+    case PriorityCache::Priority::PRI1:
+      if (usage * 4 >= committed_bytes * 3) {
+	request = std::min<int64_t>(usage * 2, max_bytes);
+	request -= get_cache_bytes(PriorityCache::Priority::PRI0);
+      }
+      break;
+    default:
+      break;
+    }
+    request = (request > assigned) ? request - assigned : 0;
+    ldout(cct, 10) << __func__ << " Priority: " << static_cast<uint32_t>(pri)
+		   << " Request: " << request << dendl;
+    return request;
+  }
+  int64_t get_cache_bytes(PriorityCache::Priority pri) const override {
+    return cache_bytes[pri];
+  }
+  int64_t get_cache_bytes() const override {
+    int64_t total = 0;
+    for (int i = 0; i < PriorityCache::Priority::LAST + 1; i++) {
+      total += cache_bytes[i];
+    }
+    return total;
+  }
+  void set_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] = bytes;
+  }
+  void add_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] += bytes;
+  }
+  int64_t commit_cache_size(uint64_t total_cache) override {
+    int64_t new_bytes = PriorityCache::get_chunk(get_cache_bytes(),
+						 total_cache);
+    new_bytes = std::clamp<int64_t>(new_bytes, min_bytes, max_bytes);
+    ldout(cct, 10) << __func__ << " old: " << committed_bytes
+		   << " new: " << new_bytes
+		   << " usage: " << wbm->memory_usage() << dendl;
+    wbm->SetBufferSize(new_bytes);
+    committed_bytes = new_bytes;
+    return committed_bytes;
+  }
+  int64_t get_committed_size() const override {
+    return committed_bytes;
+  }
+  double get_cache_ratio() const override {
+    return cache_ratio;
+  }
+  void set_cache_ratio(double ratio) override {
+    cache_ratio = ratio;
+  }
+  std::string get_cache_name() const override {
+    return "RocksDB Memtables";
+  }
+};
+
+std::shared_ptr<PriorityCache::PriCache>
+RocksDBStore::get_memtable_priority_cache() const
+{
+  return memtable_cache;
+}
+
 int RocksDBStore::install_cf_mergeop(
   const string &key_prefix,
   rocksdb::ColumnFamilyOptions *cf_opt)
@@ -494,6 +600,15 @@ int RocksDBStore::load_rocksdb_options(bool create_if_missing, rocksdb::Options&
 	   << ", type " << cct->_conf->rocksdb_cache_type
 	   << dendl;
 
+  if (cct->_conf.get_val<bool>("rocksdb_memtable_autotune")) {
+    // start at what the static options allow for one column family,
+    // do_open raises the cap once the column families are known
+    uint64_t max = opt.write_buffer_size * opt.max_write_buffer_number;
+    memtable_cache = std::make_shared<MemtableCache>(
+      cct, opt.write_buffer_size, max);
+    opt.write_buffer_manager = memtable_cache->get_write_buffer_manager();
+  }
+
   opt.merge_operator.reset(new MergeOperatorRouter(*this));
   comparator = opt.comparator;
   return 0;
@@ -736,6 +851,254 @@ int RocksDBStore::apply_sharding(const rocksdb::Options& opt,
   return 0;
 }
 
+bool RocksDBStore::same_layout(const std::vector<ColumnFamily>& a_in,
+			       const std::vector<ColumnFamily>& b_in)
+{
+  auto a = a_in;
+  auto b = b_in;
+  std::sort(a.begin(), a.end(),
+	    [](ColumnFamily& x, ColumnFamily& y) { return x.name < y.name; } );
+  std::sort(b.begin(), b.end(),
+	    [](ColumnFamily& x, ColumnFamily& y) { return x.name < y.name; } );
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if ( (a[i].name != b[i].name) ||
+	 (a[i].shard_cnt != b[i].shard_cnt) ||
+	 (a[i].hash_l != b[i].hash_l) ||
+	 (a[i].hash_h != b[i].hash_h) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int RocksDBStore::reshard_if_needed(const rocksdb::Options& opt,
+				    const std::string& sharding_text)
+{
+  rocksdb::Status status;
+  std::string target;
+  status = rocksdb::ReadFileToString(opt.env, sharding_resharding, &target);
+  if (status.ok()) {
+    // an interrupted reshard has to be finished first
+    dout(1) << __func__ << " resuming interrupted resharding to '"
+	    << target << "'" << dendl;
+  } else {
+    if (sharding_text.empty() ||
+	!kv_options.count("reshard")) {
+      return 0;
+    }
+    std::string stored_text;
+    status = rocksdb::ReadFileToString(opt.env, sharding_def_file,
+				       &stored_text);
+    std::vector<ColumnFamily> requested, stored;
+    if (!parse_sharding_def(sharding_text, requested)) {
+      derr << __func__ << " bad sharding " << sharding_text << dendl;
+      return -EINVAL;
+    }
+    parse_sharding_def(stored_text, stored);
+    if (same_layout(requested, stored)) {
+      return 0;
+    }
+    target = sharding_text;
+    dout(1) << __func__ << " resharding from '" << stored_text << "' to '"
+	    << target << "'" << dendl;
+    opt.env->CreateDir(sharding_def_dir);
+    status = rocksdb::WriteStringToFile(opt.env, target,
+					sharding_resharding, true);
+    if (!status.ok()) {
+      derr << __func__ << " cannot write to " << sharding_resharding << dendl;
+      return -EIO;
+    }
+  }
+  int r = reshard(opt, target);
+  if (r < 0) {
+    derr << __func__ << " resharding failed: " << cpp_strerror(r) << dendl;
+  }
+  return r;
+}
+
+int RocksDBStore::reshard_move(rocksdb::ColumnFamilyHandle *src,
+			       const std::string& src_prefix)
+{
+  // keys of the default column family carry their prefix, those of the
+  // others don't
+  static constexpr uint64_t batch_bytes = 16 << 20;
+  rocksdb::Status status;
+  std::unique_ptr<rocksdb::Iterator> it(
+    db->NewIterator(rocksdb::ReadOptions(), src));
+  rocksdb::WriteBatch bat;
+  uint64_t moved = 0;
+  auto flush = [&]() {
+    status = db->Write(rocksdb::WriteOptions(), &bat);
+    bat.Clear();
+    return status.ok();
+  };
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    std::string prefix = src_prefix;
+    std::string key;
+    if (src == default_cf) {
+      if (split_key(it->key(), &prefix, &key) < 0 ||
+	  !is_column_family(prefix)) {
+	continue;
+      }
+      bat.Put(get_cf_handle(prefix, key), rocksdb::Slice(key), it->value());
+    } else {
+      key = it->key().ToString();
+      if (is_column_family(prefix)) {
+	auto dst = get_cf_handle(prefix, key);
+	if (dst == src) {
+	  continue;
+	}
+	bat.Put(dst, rocksdb::Slice(key), it->value());
+      } else {
+	bat.Put(default_cf, combine_strings(prefix, key), it->value());
+      }
+    }
+    bat.Delete(src, it->key());
+    ++moved;
+    if (bat.GetDataSize() >= batch_bytes && !flush()) {
+      break;
+    }
+  }
+  if (status.ok() && !it->status().ok()) {
+    status = it->status();
+  }
+  if (status.ok() && bat.Count()) {
+    flush();
+  }
+  if (!status.ok()) {
+    derr << __func__ << " " << status.ToString() << dendl;
+    return -EIO;
+  }
+  dout(1) << __func__ << " moved " << moved << " keys out of "
+	  << (src == default_cf ? std::string("default") : src->GetName())
+	  << dendl;
+  return 0;
+}
+
+/*
+ * Move the data to the column layout given by sharding_text.  Every key
+ * in a column family that does not belong to the target layout is first
+ * moved back to the default column family, the emptied column is dropped
+ * and then the target columns are created and filled from the default
+ * one.  Keys move in atomic put+delete batches and the target is recorded
+ * in sharding_resharding beforehand, so an interrupted run is simply
+ * repeated on the next open.
+ */
+int RocksDBStore::reshard(const rocksdb::Options& opt,
+			  const std::string& sharding_text)
+{
+  rocksdb::Status status;
+  std::vector<ColumnFamily> target_def, stored_def;
+  if (!parse_sharding_def(sharding_text, target_def)) {
+    return -EINVAL;
+  }
+  std::string stored_text;
+  rocksdb::ReadFileToString(opt.env, sharding_def_file, &stored_text);
+  parse_sharding_def(stored_text, stored_def);
+
+  // column family name -> (prefix, shard) in either layout
+  std::map<std::string, std::pair<ColumnFamily, size_t>> known;
+  for (auto* def : {&stored_def, &target_def}) {
+    for (auto& column : *def) {
+      for (size_t i = 0; i < column.shard_cnt; i++) {
+	known.emplace(column.shard_cnt == 1 ? column.name :
+		      column.name + "-" + to_string(i),
+		      std::make_pair(column, i));
+      }
+    }
+  }
+  std::vector<std::string> names;
+  status = rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(opt),
+					   path, &names);
+  if (!status.ok()) {
+    return -EIO;
+  }
+  std::vector<rocksdb::ColumnFamilyDescriptor> cfs;
+  for (auto& name : names) {
+    rocksdb::ColumnFamilyOptions cf_opt(opt);
+    if (name != rocksdb::kDefaultColumnFamilyName) {
+      auto p = known.find(name);
+      if (p == known.end()) {
+	derr << __func__ << " unknown column family " << name << dendl;
+	return -EINVAL;
+      }
+      install_cf_mergeop(p->second.first.name, &cf_opt);
+    }
+    cfs.emplace_back(name, cf_opt);
+  }
+  std::vector<rocksdb::ColumnFamilyHandle*> handles;
+  status = rocksdb::DB::Open(rocksdb::DBOptions(opt), path, cfs, &handles,
+			     &db);
+  if (!status.ok()) {
+    derr << __func__ << " " << status.ToString() << dendl;
+    return -EINVAL;
+  }
+  int r = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    if (names[i] == rocksdb::kDefaultColumnFamilyName) {
+      default_cf = handles[i];
+    }
+  }
+  ceph_assert(default_cf);
+  for (size_t i = 0; i < names.size() && r == 0; i++) {
+    if (handles[i] == default_cf) {
+      continue;
+    }
+    r = reshard_move(handles[i], known.at(names[i]).first.name);
+    if (r == 0) {
+      status = db->DropColumnFamily(handles[i]);
+      if (!status.ok()) {
+	derr << __func__ << " cannot drop " << names[i] << ": "
+	     << status.ToString() << dendl;
+	r = -EIO;
+      }
+    }
+  }
+  for (size_t i = 0; i < names.size(); i++) {
+    if (handles[i] != default_cf) {
+      db->DestroyColumnFamilyHandle(handles[i]);
+    }
+  }
+  if (r == 0) {
+    r = create_shards(opt, target_def);
+  }
+  if (r == 0) {
+    r = reshard_move(default_cf, std::string());
+  }
+  if (r == 0) {
+    db->CompactRange(rocksdb::CompactRangeOptions(), default_cf,
+		     nullptr, nullptr);
+    status = rocksdb::WriteStringToFile(opt.env, sharding_text,
+					sharding_def_file, true);
+    if (status.ok()) {
+      status = opt.env->DeleteFile(sharding_resharding);
+    }
+    if (!status.ok()) {
+      derr << __func__ << " cannot record new sharding: "
+	   << status.ToString() << dendl;
+      r = -EIO;
+    }
+  }
+  for (auto& p : cf_handles) {
+    for (auto h : p.second.handles) {
+      db->DestroyColumnFamilyHandle(h);
+    }
+  }
+  cf_handles.clear();
+  db->DestroyColumnFamilyHandle(default_cf);
+  default_cf = nullptr;
+  delete db;
+  db = nullptr;
+  if (r == 0) {
+    dout(1) << __func__ << " done, sharding is now '" << sharding_text << "'"
+	    << dendl;
+  }
+  return r;
+}
+
 int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
 				  const std::string& sharding_text,
 				  std::vector<rocksdb::ColumnFamilyDescriptor>& existing_cfs,
@@ -769,28 +1132,7 @@ int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
   }
   parse_sharding_def(stored_sharding_text, stored_sharding_def);
 
-  std::sort(sharding_def.begin(), sharding_def.end(),
-	    [](ColumnFamily& a, ColumnFamily& b) { return a.name < b.name; } );
-  std::sort(stored_sharding_def.begin(), stored_sharding_def.end(),
-	    [](ColumnFamily& a, ColumnFamily& b) { return a.name < b.name; } );
-
-  bool match = true;
-  if (sharding_def.size() != stored_sharding_def.size()) {
-    match = false;
-  } else {
-    for (size_t i = 0; i < sharding_def.size(); i++) {
-      auto& a = sharding_def[i];
-      auto& b = stored_sharding_def[i];
-      if ( (a.name != b.name) ||
-	   (a.shard_cnt != b.shard_cnt) ||
-	   (a.hash_l != b.hash_l) ||
-	   (a.hash_h != b.hash_h) ) {
-	match = false;
-	break;
-      }
-    }
-  }
-  if (!match) {
+  if (!same_layout(sharding_def, stored_sharding_def)) {
     derr << __func__ << " mismatch on sharding. requested = " << sharding_def
 	 << " stored = " << stored_sharding_def << dendl;
     return -EIO;
@@ -816,7 +1158,9 @@ int RocksDBStore::verify_sharding(const rocksdb::Options& opt,
     }
   };
 
-  for (auto& column : stored_sharding_def) {
+  // the layout matches; take the column options from the request so per
+  // column tuning can be changed without resharding
+  for (auto& column : sharding_def) {
     rocksdb::ColumnFamilyOptions cf_opt(opt);
     status = rocksdb::GetColumnFamilyOptionsFromString(
 						       cf_opt, column.options, &cf_opt);
@@ -896,6 +1240,12 @@ int RocksDBStore::do_open(ostream &out,
     std::vector<rocksdb::ColumnFamilyDescriptor> missing_cfs;
     std::vector<std::pair<size_t, RocksDBStore::ColumnFamily> > missing_cfs_shard;
 
+    if (!open_readonly) {
+      r = reshard_if_needed(opt, sharding_text);
+      if (r < 0) {
+	return r;
+      }
+    }
     r = verify_sharding(opt, sharding_text,
 			existing_cfs, existing_cfs_shard,
 			missing_cfs, missing_cfs_shard);
@@ -975,6 +1325,14 @@ int RocksDBStore::do_open(ostream &out,
     }
   }
   ceph_assert(default_cf != nullptr);
+  if (memtable_cache) {
+    size_t columns = 1;
+    for (auto& p : cf_handles) {
+      columns += p.second.handles.size();
+    }
+    memtable_cache->set_max_bytes(
+      opt.write_buffer_size * opt.max_write_buffer_number * columns);
+  }
   
   PerfCountersBuilder plb(cct, "rocksdb", l_rocksdb_first, l_rocksdb_last);
   plb.add_u64_counter(l_rocksdb_gets, "get", "Gets");
@@ -1234,6 +1592,15 @@ int RocksDBStore::submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Tra
          << " Rocksdb transaction: " << rocks_txc.seen << dendl;
   }
 
+  // range tombstones keep costing every iterator that crosses them until
+  // compaction drops them; get the deleted ranges compacted in the
+  // background so later listings don't crawl over them.
+  if (s.ok() && compact_on_range_delete) {
+    for (auto& [start, end] : _t->deleted_ranges) {
+      compact_range_async(start, end);
+    }
+  }
+
   if (cct->_conf->rocksdb_perf) {
     utime_t write_memtable_time;
     utime_t write_delay_time;
@@ -1396,6 +1763,8 @@ void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix
 	bat.DeleteRange(db->default_cf,
                         combine_strings(prefix, string()),
                         combine_strings(endprefix, string()));
+	deleted_ranges.emplace_back(combine_strings(prefix, string()),
+				    combine_strings(endprefix, string()));
     } else {
       bat.PopSavePoint();
     }
@@ -1412,6 +1781,8 @@ void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix
 	bat.RollbackToSavePoint();
 	string endprefix = "\xff\xff\xff\xff";  // FIXME: this is cheating...
 	bat.DeleteRange(cf, string(), endprefix);
+	deleted_ranges.emplace_back(combine_strings(prefix, string()),
+				    combine_strings(prefix, endprefix));
       } else {
 	bat.PopSavePoint();
       }
@@ -1438,6 +1809,8 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
       bat.DeleteRange(db->default_cf,
 		      rocksdb::Slice(combine_strings(prefix, start)),
 		      rocksdb::Slice(combine_strings(prefix, end)));
+      deleted_ranges.emplace_back(combine_strings(prefix, start),
+				  combine_strings(prefix, end));
     } else {
       bat.PopSavePoint();
     }
@@ -1456,6 +1829,8 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
       if (cnt == 0) {
 	bat.RollbackToSavePoint();
 	bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+	deleted_ranges.emplace_back(combine_strings(prefix, start),
+				    combine_strings(prefix, end));
       } else {
 	bat.PopSavePoint();
       }
@@ -1509,35 +1884,34 @@ int RocksDBStore::get(
     const std::set<string> &keys,
     std::map<string, bufferlist> *out)
 {
-  rocksdb::PinnableSlice value;
   utime_t start = ceph_clock_now();
+  // one MultiGet lets rocksdb batch the block lookups of all keys
+  std::vector<rocksdb::ColumnFamilyHandle*> cfs;
+  std::vector<string> combined;
+  std::vector<rocksdb::Slice> slices;
+  cfs.reserve(keys.size());
+  slices.reserve(keys.size());
   if (cf_handles.count(prefix) > 0) {
     for (auto& key : keys) {
-      auto cf_handle = get_cf_handle(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    cf_handle,
-			    rocksdb::Slice(key),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
+      cfs.push_back(get_cf_handle(prefix, key));
+      slices.emplace_back(key);
     }
   } else {
+    combined.reserve(keys.size());
     for (auto& key : keys) {
-      string k = combine_strings(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    default_cf,
-			    rocksdb::Slice(k),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
+      combined.push_back(combine_strings(prefix, key));
+      cfs.push_back(default_cf);
+      slices.emplace_back(combined.back());
+    }
+  }
+  std::vector<std::string> values;
+  auto statuses = db->MultiGet(rocksdb::ReadOptions(), cfs, slices, &values);
+  auto k = keys.begin();
+  for (size_t i = 0; i < statuses.size(); ++i, ++k) {
+    if (statuses[i].ok()) {
+      (*out)[*k].append(values[i]);
+    } else if (statuses[i].IsIOError()) {
+      ceph_abort_msg(statuses[i].getState());
     }
   }
   utime_t lat = ceph_clock_now() - start;
@@ -85,6 +85,9 @@ class RocksDBStore : public KeyValueDB {
 
   uint64_t cache_size = 0;
   bool set_cache_flag = false;
+  class MemtableCache;
+  /// write buffer budget handed out by the PriorityCache manager
+  std::shared_ptr<MemtableCache> memtable_cache;
   friend class ShardMergeIteratorImpl;
   friend class WholeMergeIteratorImpl;
   /*
@@ -145,6 +148,13 @@ private:
 		    const vector<ColumnFamily>& sharding_def);
   int apply_sharding(const rocksdb::Options& opt,
 		     const std::string& sharding_text);
+  static bool same_layout(const std::vector<ColumnFamily>& a,
+			  const std::vector<ColumnFamily>& b);
+  int reshard_if_needed(const rocksdb::Options& opt,
+			const std::string& sharding_text);
+  int reshard(const rocksdb::Options& opt, const std::string& sharding_text);
+  int reshard_move(rocksdb::ColumnFamilyHandle *src,
+		   const std::string& src_prefix);
   int verify_sharding(const rocksdb::Options& opt,
 		      const std::string& sharding_text,
 		      std::vector<rocksdb::ColumnFamilyDescriptor>& existing_cfs,
@@ -180,7 +190,8 @@ public:
   /// compact the underlying rocksdb store
   bool compact_on_mount;
   bool disableWAL;
-  const uint64_t delete_range_threshold;
+  uint64_t delete_range_threshold;
+  const bool compact_on_range_delete;
   void compact() override;
 
   void compact_async() override {
@@ -226,7 +237,8 @@ public:
     compact_thread(this),
     compact_on_mount(false),
     disableWAL(false),
-    delete_range_threshold(cct->_conf.get_val<uint64_t>("rocksdb_delete_range_threshold"))
+    delete_range_threshold(cct->_conf.get_val<uint64_t>("rocksdb_delete_range_threshold")),
+    compact_on_range_delete(cct->_conf.get_val<bool>("rocksdb_compact_on_range_delete"))
   {}
 
   ~RocksDBStore() override;
@@ -309,6 +321,8 @@ public:
   public:
     rocksdb::WriteBatch bat;
     RocksDBStore *db;
+    /// combined-key ranges covered by DeleteRange, compacted after commit
+    std::vector<std::pair<std::string,std::string>> deleted_ranges;
 
     explicit RocksDBTransactionImpl(RocksDBStore *_db);
   private:
@@ -505,6 +519,11 @@ err:
     return static_cast<int64_t>(bbt_opts.block_cache->GetUsage());
   }
 
+  int set_delete_range_threshold(uint64_t n) override {
+    delete_range_threshold = n;
+    return 0;
+  }
+
   int set_cache_size(uint64_t s) override {
     cache_size = s;
     set_cache_flag = true;
@@ -517,6 +536,9 @@ err:
         bbt_opts.block_cache);
   }
 
+  std::shared_ptr<PriorityCache::PriCache> get_memtable_priority_cache()
+      const override;
+
   WholeSpaceIterator get_wholespace_iterator(IteratorOpts opts = 0) override;
 private:
   WholeSpaceIterator get_default_cf_iterator();
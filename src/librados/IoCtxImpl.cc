@@ -114,6 +114,7 @@ struct C_aio_linger_Complete : public Context {
 
     if (c->callback_complete ||
 	c->callback_safe) {
+      // after the cancel above
       c->io->client->finisher.queue(new C_AioComplete(c));
     }
     c->put_unlock();
@@ -305,7 +306,7 @@ void librados::IoCtxImpl::complete_aio_write(AioCompletionImpl *c)
     ldout(client->cct, 20) << " waking waiters on seq " << waiters->first << dendl;
     for (std::list<AioCompletionImpl*>::iterator it = waiters->second.begin();
 	 it != waiters->second.end(); ++it) {
-      client->finisher.queue(new C_AioCompleteAndSafe(*it));
+      client->queue_aio_callback(this, new C_AioCompleteAndSafe(*it));
       (*it)->put();
     }
     aio_write_waiters.erase(waiters++);
@@ -320,12 +321,13 @@ void librados::IoCtxImpl::flush_aio_writes_async(AioCompletionImpl *c)
 {
   ldout(client->cct, 20) << "flush_aio_writes_async " << this
 			 << " completion " << c << dendl;
+  flush_aio_batch();
   std::lock_guard l(aio_write_list_lock);
   ceph_tid_t seq = aio_write_seq;
   if (aio_write_list.empty()) {
     ldout(client->cct, 20) << "flush_aio_writes_async no writes. (tid "
 			   << seq << ")" << dendl;
-    client->finisher.queue(new C_AioCompleteAndSafe(c));
+    client->queue_aio_callback(this, new C_AioCompleteAndSafe(c));
   } else {
     ldout(client->cct, 20) << "flush_aio_writes_async " << aio_write_list.size()
 			   << " writes in flight; waiting on tid " << seq << dendl;
@@ -337,6 +339,7 @@ void librados::IoCtxImpl::flush_aio_writes_async(AioCompletionImpl *c)
 void librados::IoCtxImpl::flush_aio_writes()
 {
   ldout(client->cct, 20) << "flush_aio_writes" << dendl;
+  flush_aio_batch();
   std::unique_lock l{aio_write_list_lock};
   aio_write_cond.wait(l, [seq=aio_write_seq, this] {
     return (aio_write_list.empty() ||
@@ -344,6 +347,96 @@ void librados::IoCtxImpl::flush_aio_writes()
   });
 }
 
+void librados::IoCtxImpl::set_aio_batching(bool enable)
+{
+  ldout(client->cct, 10) << __func__ << " " << enable << dendl;
+  std::lock_guard sl(aio_batch_submit_lock);
+  aio_batching = enable;
+  if (!enable) {
+    _flush_aio_batch();
+  }
+}
+
+void librados::IoCtxImpl::op_submit(Objecter::Op *op, ceph_tid_t *ptid)
+{
+  if (!aio_batching) {
+    objecter->op_submit(op, ptid);
+    return;
+  }
+  std::lock_guard sl(aio_batch_submit_lock);
+  _flush_aio_batch();
+  objecter->op_submit(op, ptid);
+}
+
+struct C_FlushAioBatch : public Context {
+  librados::IoCtxImpl *io;
+  uint64_t seq;
+
+  C_FlushAioBatch(librados::IoCtxImpl *io, uint64_t seq) : io(io), seq(seq) {
+    io->get();
+  }
+  ~C_FlushAioBatch() override {
+    io->put();
+  }
+  void finish(int r) override {
+    {
+      std::lock_guard l(io->aio_batch_lock);
+      if (io->aio_batch_seq != seq) {
+	// sent already
+	return;
+      }
+    }
+    io->flush_aio_batch();
+  }
+};
+
+void librados::IoCtxImpl::aio_batch_submit(Objecter::Op *op, ceph_tid_t *ptid,
+					   uint64_t bytes)
+{
+  if (!aio_batching) {
+    objecter->op_submit(op, ptid);
+    return;
+  }
+  auto& conf = client->cct->_conf;
+  std::unique_lock l(aio_batch_lock);
+  aio_batch.emplace_back(op, ptid);
+  aio_batch_bytes += bytes;
+  if (aio_batch.size() >= conf.get_val<uint64_t>("rados_aio_batch_max_ops") ||
+      aio_batch_bytes >= conf.get_val<Option::size_t>("rados_aio_batch_max_bytes")) {
+    l.unlock();
+    flush_aio_batch();
+  } else if (aio_batch.size() == 1) {
+    uint64_t seq = aio_batch_seq;
+    l.unlock();
+    client->queue_after(
+      conf.get_val<uint64_t>("rados_aio_batch_usec") / 1000000.0,
+      new C_FlushAioBatch(this, seq));
+  }
+}
+
+void librados::IoCtxImpl::flush_aio_batch()
+{
+  std::lock_guard sl(aio_batch_submit_lock);
+  _flush_aio_batch();
+}
+
+void librados::IoCtxImpl::_flush_aio_batch()
+{
+  // aio_batch_submit_lock must be held
+  decltype(aio_batch) batch;
+  {
+    std::lock_guard l(aio_batch_lock);
+    if (aio_batch.empty()) {
+      return;
+    }
+    batch.swap(aio_batch);
+    aio_batch_bytes = 0;
+    ++aio_batch_seq;
+  }
+  ldout(client->cct, 20) << __func__ << " " << batch.size() << " ops" << dendl;
+  objecter->op_submit(batch);
+}
+
 string librados::IoCtxImpl::get_cached_pool_name()
 {
   std::string pn;
@@ -669,7 +762,7 @@ int librados::IoCtxImpl::operate(const object_t& oid, ::ObjectOperation *o,
   Objecter::Op *objecter_op = objecter->prepare_mutate_op(oid, oloc,
 							  *o, snapc, ut, flags,
 							  oncommit, &ver);
-  objecter->op_submit(objecter_op);
+  op_submit(objecter_op);
 
   {
     std::unique_lock l{mylock};
@@ -704,7 +797,7 @@ int librados::IoCtxImpl::operate_read(const object_t& oid,
   Objecter::Op *objecter_op = objecter->prepare_read_op(oid, oloc,
 	                                      *o, snap_seq, pbl, flags,
 	                                      onack, &ver);
-  objecter->op_submit(objecter_op);
+  op_submit(objecter_op);
 
   {
     std::unique_lock l{mylock};
@@ -744,7 +837,7 @@ int librados::IoCtxImpl::aio_operate_read(const object_t &oid,
   Objecter::Op *objecter_op = objecter->prepare_read_op(oid, oloc,
 		 *o, snap_seq, pbl, flags,
 		 oncomplete, &c->objver, nullptr, 0, &trace);
-  objecter->op_submit(objecter_op, &c->tid);
+  aio_batch_submit(objecter_op, &c->tid, 0);
   trace.event("rados operate read submitted");
 
   return 0;
@@ -780,12 +873,48 @@ int librados::IoCtxImpl::aio_operate(const object_t& oid,
   Objecter::Op *op = objecter->prepare_mutate_op(
     oid, oloc, *o, snap_context, ut, flags,
     oncomplete, &c->objver, osd_reqid_t(), &trace);
-  objecter->op_submit(op, &c->tid);
+  uint64_t bytes = 0;
+  for (auto& osd_op : o->ops) {
+    bytes += osd_op.indata.length();
+  }
+  aio_batch_submit(op, &c->tid, bytes);
   trace.event("rados operate op submitted");
 
   return 0;
 }
 
+int librados::IoCtxImpl::aio_operate(const object_t& oid,
+				     ::ObjectOperation *o, Context *oncomplete,
+				     const SnapContext& snap_context, int flags)
+{
+  auto ut = ceph::real_clock::now();
+  /* can't write to a snapshot */
+  if (snap_seq != CEPH_NOSNAP) {
+    delete oncomplete;
+    return -EROFS;
+  }
+
+  Objecter::Op *op = objecter->prepare_mutate_op(
+    oid, oloc, *o, snap_context, ut, flags, oncomplete);
+  uint64_t bytes = 0;
+  for (auto& osd_op : o->ops) {
+    bytes += osd_op.indata.length();
+  }
+  aio_batch_submit(op, nullptr, bytes);
+  return 0;
+}
+
+int librados::IoCtxImpl::aio_operate_read(const object_t& oid,
+					  ::ObjectOperation *o,
+					  Context *oncomplete, int flags,
+					  bufferlist *pbl)
+{
+  Objecter::Op *op = objecter->prepare_read_op(
+    oid, oloc, *o, snap_seq, pbl, flags, oncomplete);
+  aio_batch_submit(op, nullptr, 0);
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
 				  bufferlist *pbl, size_t len, uint64_t off,
 				  uint64_t snapid, const blkin_trace_info *info)
@@ -812,7 +941,7 @@ int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
     oid, oloc,
     off, len, snapid, pbl, 0,
     oncomplete, &c->objver, nullptr, 0, &trace);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -845,7 +974,7 @@ int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
     oid, oloc,
     off, len, snapid, &c->bl, 0,
     oncomplete, &c->objver, nullptr, 0, &trace);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -885,7 +1014,7 @@ int librados::IoCtxImpl::aio_sparse_read(const object_t oid,
     oid, oloc,
     onack->m_ops, snapid, NULL, 0,
     onack, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -905,7 +1034,7 @@ int librados::IoCtxImpl::aio_cmpext(const object_t& oid,
   Objecter::Op *o = objecter->prepare_cmpext_op(
     oid, oloc, off, cmp_bl, snap_seq, 0,
     onack, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
 
   return 0;
 }
@@ -933,7 +1062,7 @@ int librados::IoCtxImpl::aio_cmpext(const object_t& oid,
 
   Objecter::Op *o = objecter->prepare_read_op(
     oid, oloc, onack->m_ops, snap_seq, NULL, 0, onack, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -968,7 +1097,7 @@ int librados::IoCtxImpl::aio_write(const object_t &oid, AioCompletionImpl *c,
     oid, oloc,
     off, len, snapc, bl, ut, 0,
     oncomplete, &c->objver, nullptr, 0, &trace);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
 
   return 0;
 }
@@ -997,7 +1126,7 @@ int librados::IoCtxImpl::aio_append(const object_t &oid, AioCompletionImpl *c,
     oid, oloc,
     len, snapc, bl, ut, 0,
     oncomplete, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
 
   return 0;
 }
@@ -1027,7 +1156,7 @@ int librados::IoCtxImpl::aio_write_full(const object_t &oid,
     oid, oloc,
     snapc, bl, ut, 0,
     oncomplete, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
 
   return 0;
 }
@@ -1062,7 +1191,7 @@ int librados::IoCtxImpl::aio_writesame(const object_t &oid,
     write_len, off,
     snapc, bl, ut, 0,
     oncomplete, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
 
   return 0;
 }
@@ -1088,7 +1217,7 @@ int librados::IoCtxImpl::aio_remove(const object_t &oid, AioCompletionImpl *c, i
     oid, oloc,
     snapc, ut, flags,
     oncomplete, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
 
   return 0;
 }
@@ -1104,7 +1233,7 @@ int librados::IoCtxImpl::aio_stat(const object_t& oid, AioCompletionImpl *c,
     oid, oloc,
     snap_seq, psize, &onack->mtime, 0,
     onack, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1118,7 +1247,7 @@ int librados::IoCtxImpl::aio_stat2(const object_t& oid, AioCompletionImpl *c,
     oid, oloc,
     snap_seq, psize, &onack->mtime, 0,
     onack, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1193,6 +1322,7 @@ int librados::IoCtxImpl::aio_getxattrs(const object_t& oid, AioCompletionImpl *c
 
 int librados::IoCtxImpl::aio_cancel(AioCompletionImpl *c)
 {
+  flush_aio_batch();
   return objecter->op_cancel(c->tid, -ECANCELED);
 }
 
@@ -1209,7 +1339,7 @@ int librados::IoCtxImpl::hit_set_list(uint32_t hash, AioCompletionImpl *c,
   object_locator_t oloc(poolid);
   Objecter::Op *o = objecter->prepare_pg_read_op(
     hash, oloc, rd, NULL, 0, oncomplete, NULL, NULL);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1226,7 +1356,7 @@ int librados::IoCtxImpl::hit_set_get(uint32_t hash, AioCompletionImpl *c,
   object_locator_t oloc(poolid);
   Objecter::Op *o = objecter->prepare_pg_read_op(
     hash, oloc, rd, NULL, 0, oncomplete, NULL, NULL);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1271,7 +1401,7 @@ int librados::IoCtxImpl::get_inconsistent_objects(const pg_t& pg,
   Objecter::Op *o = objecter->prepare_pg_read_op(
     oloc.hash, oloc, op, nullptr, CEPH_OSD_FLAG_PGOP, oncomplete,
     nullptr, nullptr);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1292,7 +1422,7 @@ int librados::IoCtxImpl::get_inconsistent_snapsets(const pg_t& pg,
   Objecter::Op *o = objecter->prepare_pg_read_op(
     oloc.hash, oloc, op, nullptr, CEPH_OSD_FLAG_PGOP, oncomplete,
     nullptr, nullptr);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1332,7 +1462,7 @@ int librados::IoCtxImpl::aio_exec(const object_t& oid, AioCompletionImpl *c,
   rd.call(cls, method, inbl);
   Objecter::Op *o = objecter->prepare_read_op(
     oid, oloc, rd, snap_seq, outbl, 0, oncomplete, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1358,7 +1488,7 @@ int librados::IoCtxImpl::aio_exec(const object_t& oid, AioCompletionImpl *c,
   rd.call(cls, method, inbl);
   Objecter::Op *o = objecter->prepare_read_op(
     oid, oloc, rd, snap_seq, &c->bl, 0, oncomplete, &c->objver);
-  objecter->op_submit(o, &c->tid);
+  op_submit(o, &c->tid);
   return 0;
 }
 
@@ -1900,7 +2030,7 @@ void librados::IoCtxImpl::C_aio_stat_Ack::finish(int r)
   }
 
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    c->io->client->queue_aio_callback(c->io, new C_AioComplete(c));
   }
 
   c->put_unlock();
@@ -1928,7 +2058,7 @@ void librados::IoCtxImpl::C_aio_stat2_Ack::finish(int r)
   }
 
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    c->io->client->queue_aio_callback(c->io, new C_AioComplete(c));
   }
 
   c->put_unlock();
@@ -1964,7 +2094,7 @@ void librados::IoCtxImpl::C_aio_Complete::finish(int r)
 
   if (c->callback_complete ||
       c->callback_safe) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    c->io->client->queue_aio_callback(c->io, new C_AioComplete(c));
   }
 
   if (c->aio_write_seq) {
@@ -2017,6 +2147,98 @@ void librados::IoCtxImpl::object_list_slice(
       hobject_t::_reverse_bits(rev_finish), poolid, string());
 }
 
+int librados::IoCtxImpl::object_list_parallel(
+  const bufferlist& filter, unsigned window, size_t result_count,
+  std::function<int(std::vector<ObjectItem>&)>& cb)
+{
+  // more slices than listings in flight, so that one dense part of the
+  // pool doesn't leave the window empty at the end
+  window = std::max(window, 1u);
+  const unsigned num_slices = window * 4;
+  struct slice_t {
+    hobject_t pos, end, next;
+    std::list<librados::ListObjectImpl> result;
+    int r = 0;
+  };
+  std::vector<slice_t> slices(num_slices);
+  hobject_t begin = objecter->enumerate_objects_begin();
+  hobject_t end = objecter->enumerate_objects_end();
+  std::deque<unsigned> ready;
+  for (unsigned i = 0; i < num_slices; ++i) {
+    object_list_slice(begin, end, i, num_slices,
+		      &slices[i].pos, &slices[i].end);
+    if (slices[i].pos < slices[i].end) {
+      ready.push_back(i);
+    }
+  }
+
+  ceph::mutex lock = ceph::make_mutex("IoCtxImpl::object_list_parallel");
+  ceph::condition_variable cond;
+  std::deque<unsigned> done;
+  unsigned in_flight = 0;
+  int ret = 0;
+  std::unique_lock l(lock);
+  while (true) {
+    while (ret == 0 && in_flight < window && !ready.empty()) {
+      unsigned i = ready.front();
+      ready.pop_front();
+      ++in_flight;
+      auto& s = slices[i];
+      l.unlock();
+      objecter->enumerate_objects(
+	poolid, oloc.nspace, s.pos, s.end, result_count, filter,
+	&s.result, &s.next,
+	new LambdaContext([&, i](int r) {
+	    std::lock_guard l(lock);
+	    slices[i].r = r;
+	    done.push_back(i);
+	    cond.notify_all();
+	  }));
+      l.lock();
+    }
+    if (in_flight == 0 && (ret < 0 || ready.empty())) {
+      break;
+    }
+    cond.wait(l, [&] { return !done.empty(); });
+    unsigned i = done.front();
+    done.pop_front();
+    --in_flight;
+    auto& s = slices[i];
+    if (ret < 0) {
+      // draining what is still in flight
+      continue;
+    }
+    if (s.r < 0) {
+      ret = s.r;
+      continue;
+    }
+    if (!s.result.empty()) {
+      std::vector<ObjectItem> items;
+      items.reserve(s.result.size());
+      for (auto& o : s.result) {
+	ObjectItem oi;
+	oi.oid = std::move(o.oid);
+	oi.nspace = std::move(o.nspace);
+	oi.locator = std::move(o.locator);
+	items.push_back(std::move(oi));
+      }
+      s.result.clear();
+      l.unlock();
+      int r = cb(items);
+      l.lock();
+      if (r < 0) {
+	ret = r;
+	continue;
+      }
+    }
+    if (s.next < s.end) {
+      s.pos = s.next;
+      ready.push_back(i);
+    }
+  }
+  return ret;
+}
+
 int librados::IoCtxImpl::application_enable(const std::string& app_name,
                                             bool force)
 {
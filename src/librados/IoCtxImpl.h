@@ -48,6 +48,18 @@ struct librados::IoCtxImpl {
   xlist<AioCompletionImpl*> aio_write_list;
   map<ceph_tid_t, std::list<AioCompletionImpl*> > aio_write_waiters;
 
+  // aio ops held back to be sent together, see set_aio_batching()
+  ceph::mutex aio_batch_lock =
+    ceph::make_mutex("librados::IoCtxImpl::aio_batch_lock");
+  // held while handing ops to the objecter, so that nothing submitted
+  // after a batch can overtake it
+  ceph::mutex aio_batch_submit_lock =
+    ceph::make_mutex("librados::IoCtxImpl::aio_batch_submit_lock");
+  std::atomic<bool> aio_batching = { false };
+  std::vector<std::pair<Objecter::Op*, ceph_tid_t*>> aio_batch;
+  uint64_t aio_batch_bytes = 0;
+  uint64_t aio_batch_seq = 0;  ///< bumped whenever a batch is sent
+
   Objecter *objecter = nullptr;
 
   IoCtxImpl();
@@ -84,6 +96,14 @@ struct librados::IoCtxImpl {
   void flush_aio_writes_async(AioCompletionImpl *c);
   void flush_aio_writes();
 
+  void set_aio_batching(bool enable);
+  /// send an op, after whatever is batched
+  void op_submit(Objecter::Op *op, ceph_tid_t *ptid = nullptr);
+  /// queue an op to go out with others when batching is on
+  void aio_batch_submit(Objecter::Op *op, ceph_tid_t *ptid, uint64_t bytes);
+  void flush_aio_batch();
+  void _flush_aio_batch();
+
   int64_t get_id() {
     return poolid;
   }
@@ -122,6 +142,9 @@ struct librados::IoCtxImpl {
     const size_t m,
     hobject_t *split_start,
     hobject_t *split_finish);
+  int object_list_parallel(const bufferlist& filter, unsigned window,
+			   size_t result_count,
+			   std::function<int(std::vector<ObjectItem>&)>& cb);
 
   int create(const object_t& oid, bool exclusive);
   int write(const object_t& oid, bufferlist& bl, size_t len, uint64_t off);
@@ -159,6 +182,12 @@ struct librados::IoCtxImpl {
 		  int flags, const blkin_trace_info *trace_info = nullptr);
   int aio_operate_read(const object_t& oid, ::ObjectOperation *o,
 		       AioCompletionImpl *c, int flags, bufferlist *pbl, const blkin_trace_info *trace_info = nullptr);
+  // complete oncomplete directly, without an AioCompletionImpl
+  int aio_operate(const object_t& oid, ::ObjectOperation *o,
+		  Context *oncomplete, const SnapContext& snap_context,
+		  int flags);
+  int aio_operate_read(const object_t& oid, ::ObjectOperation *o,
+		       Context *oncomplete, int flags, bufferlist *pbl);
 
   struct C_aio_stat_Ack : public Context {
     librados::AioCompletionImpl *c;
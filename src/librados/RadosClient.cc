@@ -321,6 +321,12 @@ int librados::RadosClient::connect()
   timer.init();
 
   finisher.start();
+  if (auto n = cct->_conf.get_val<uint64_t>("rados_aio_finisher_threads");
+      n > 1) {
+    aio_finisher = std::make_unique<ShardedFinisher>(
+      cct, "radosclient-aio", "fn-rados-aio", n);
+    aio_finisher->start();
+  }
 
   state = CONNECTED;
   instance_id = monclient.get_global_id();
@@ -366,6 +372,11 @@ void librados::RadosClient::shutdown()
     }
     finisher.wait_for_empty();
     finisher.stop();
+    if (aio_finisher) {
+      aio_finisher->wait_for_empty();
+      aio_finisher->stop();
+      aio_finisher.reset();
+    }
   }
   state = DISCONNECTED;
   instance_id = 0;
@@ -430,6 +441,14 @@ int librados::RadosClient::async_watch_flush(AioCompletionImpl *c)
   return 0;
 }
 
+void librados::RadosClient::queue_after(double seconds, Context *c)
+{
+  std::lock_guard l(lock);
+  timer.add_event_after(seconds, new LambdaContext([this, c](int r) {
+	finisher.queue(c);
+      }));
+}
+
 uint64_t librados::RadosClient::get_instance_id()
 {
   return instance_id;
@@ -84,9 +84,22 @@ private:
 
   int wait_for_osdmap();
 
+  /// completes aio callbacks if rados_aio_finisher_threads > 1, keyed by
+  /// IoCtx so that those of an IoCtx still complete in order
+  std::unique_ptr<ShardedFinisher> aio_finisher;
+
 public:
   Finisher finisher;
 
+  /// queue the callback of an aio completion of @p io
+  void queue_aio_callback(const IoCtxImpl *io, Context *c, int r = 0) {
+    if (aio_finisher) {
+      aio_finisher->queue(reinterpret_cast<uintptr_t>(io), c, r);
+    } else {
+      finisher.queue(c, r);
+    }
+  }
+
   explicit RadosClient(CephContext *cct_);
   ~RadosClient() override;
   int ping_monitor(string mon_id, string *result);
@@ -96,6 +109,9 @@ public:
   int watch_flush();
   int async_watch_flush(AioCompletionImpl *c);
 
+  /// queue @p c on the finisher once @p seconds have passed
+  void queue_after(double seconds, Context *c);
+
   uint64_t get_instance_id();
 
   int get_min_compatible_osd(int8_t* require_osd_release);
@@ -90,6 +90,35 @@ struct AsyncOp : Invoker<Result> {
   }
 };
 
+/// Like AsyncOp, but completed through an AioCallback that lives in the
+/// Completion itself. Nothing is allocated besides the Completion, and
+/// that comes from the handler's associated allocator.
+template <typename Result>
+struct CallbackOp : Invoker<Result>, AioCallback {
+  using Signature = typename Invoker<Result>::Signature;
+  using Completion = ceph::async::Completion<Signature, CallbackOp<Result>>;
+  Completion *completion = nullptr;
+
+  void complete(int r) override {
+    // reclaim ownership of the completion
+    auto p = std::unique_ptr<Completion>{completion};
+    // move result out of Completion memory being freed
+    auto op = std::move(p->user_data);
+    boost::system::error_code ec;
+    if (r < 0) {
+      ec.assign(-r, boost::system::system_category());
+    }
+    op.dispatch(std::move(p), ec);
+  }
+
+  template <typename Executor1, typename CompletionHandler>
+  static auto create(const Executor1& ex1, CompletionHandler&& handler) {
+    auto p = Completion::create(ex1, std::move(handler));
+    p->user_data.completion = p.get();
+    return p;
+  }
+};
+
 } // namespace detail
 
 
@@ -138,21 +167,21 @@ auto async_write(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
   return init.result.get();
 }
 
-/// Calls IoCtx::aio_operate() and arranges for the AioCompletion to call a
+/// Calls IoCtx::aio_operate() and arranges for its AioCallback to call a
 /// given handler with signature (boost::system::error_code, bufferlist).
+/// Any completion token works, e.g. yield_context or use_awaitable.
 template <typename ExecutionContext, typename CompletionToken>
 auto async_operate(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
                    ObjectReadOperation *read_op, int flags,
                    CompletionToken&& token)
 {
-  using Op = detail::AsyncOp<bufferlist>;
+  using Op = detail::CallbackOp<bufferlist>;
   using Signature = typename Op::Signature;
   boost::asio::async_completion<CompletionToken, Signature> init(token);
   auto p = Op::create(ctx.get_executor(), init.completion_handler);
   auto& op = p->user_data;
 
-  int ret = io.aio_operate(oid, op.aio_completion.get(), read_op,
-                           flags, &op.result);
+  int ret = io.aio_operate(oid, &op, read_op, flags, &op.result);
   if (ret < 0) {
     auto ec = boost::system::error_code{-ret, boost::system::system_category()};
     ceph::async::post(std::move(p), ec, bufferlist{});
@@ -162,20 +191,20 @@ auto async_operate(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
   return init.result.get();
 }
 
-/// Calls IoCtx::aio_operate() and arranges for the AioCompletion to call a
+/// Calls IoCtx::aio_operate() and arranges for its AioCallback to call a
 /// given handler with signature (boost::system::error_code).
 template <typename ExecutionContext, typename CompletionToken>
 auto async_operate(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
                    ObjectWriteOperation *write_op, int flags,
                    CompletionToken &&token)
 {
-  using Op = detail::AsyncOp<void>;
+  using Op = detail::CallbackOp<void>;
   using Signature = typename Op::Signature;
   boost::asio::async_completion<CompletionToken, Signature> init(token);
   auto p = Op::create(ctx.get_executor(), init.completion_handler);
   auto& op = p->user_data;
 
-  int ret = io.aio_operate(oid, op.aio_completion.get(), write_op, flags);
+  int ret = io.aio_operate(oid, &op, write_op, flags);
   if (ret < 0) {
     auto ec = boost::system::error_code{-ret, boost::system::system_category()};
     ceph::async::post(std::move(p), ec);
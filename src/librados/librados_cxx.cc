@@ -1537,6 +1537,37 @@ int librados::IoCtx::operate(const std::string& oid, librados::ObjectReadOperati
   return io_ctx_impl->operate_read(obj, &o->impl->o, pbl, translate_flags(flags));
 }
 
+namespace {
+struct C_AioCallback : public Context {
+  librados::AioCallback *cb;
+  explicit C_AioCallback(librados::AioCallback *cb) : cb(cb) {}
+  void finish(int r) override {
+    cb->complete(r);
+  }
+};
+} // anonymous namespace
+
+int librados::IoCtx::aio_operate(const std::string& oid, AioCallback *cb,
+				 librados::ObjectWriteOperation *o, int flags)
+{
+  if (unlikely(!o->impl))
+    return -EINVAL;
+  object_t obj(oid);
+  return io_ctx_impl->aio_operate(obj, &o->impl->o, new C_AioCallback(cb),
+				  io_ctx_impl->snapc, translate_flags(flags));
+}
+
+int librados::IoCtx::aio_operate(const std::string& oid, AioCallback *cb,
+				 librados::ObjectReadOperation *o, int flags,
+				 bufferlist *pbl)
+{
+  if (unlikely(!o->impl))
+    return -EINVAL;
+  object_t obj(oid);
+  return io_ctx_impl->aio_operate_read(obj, &o->impl->o, new C_AioCallback(cb),
+				       translate_flags(flags), pbl);
+}
+
 int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				 librados::ObjectWriteOperation *o)
 {
@@ -2276,6 +2307,11 @@ librados::IoCtx::IoCtx(IoCtxImpl *io_ctx_impl_)
 {
 }
 
+void librados::IoCtx::set_aio_batching(bool enable)
+{
+  io_ctx_impl->set_aio_batching(enable);
+}
+
 void librados::IoCtx::set_osdmap_full_try()
 {
   io_ctx_impl->objecter->set_pool_full_try();
@@ -3074,6 +3110,30 @@ int librados::IoCtx::object_list(const ObjectCursor &start,
   return obj_result.size();
 }
 
+int librados::IoCtx::object_list_parallel(
+  const bufferlist &filter, unsigned window, size_t result_count,
+  std::function<int(std::vector<ObjectItem>&)> cb)
+{
+  return io_ctx_impl->object_list_parallel(filter, window, result_count, cb);
+}
+
+void librados::IoCtx::object_list_match_filter(const std::string &prefix,
+					       const std::string &xattr,
+					       const std::string *value,
+					       bufferlist *filter)
+{
+  using ceph::encode;
+  filter->clear();
+  encode(std::string("match"), *filter);
+  ENCODE_START(1, 1, *filter);
+  encode(prefix, *filter);
+  // user xattrs are stored with a leading '_'
+  encode(xattr.empty() ? xattr : "_" + xattr, *filter);
+  encode(value != nullptr, *filter);
+  encode(value ? *value : std::string(), *filter);
+  ENCODE_FINISH(*filter);
+}
+
 void librados::IoCtx::object_list_slice(
     const ObjectCursor start,
     const ObjectCursor finish,
@@ -74,6 +74,38 @@ public:
   }
 };
 
+class IODispatchLanesSingleton {
+public:
+  std::vector<ContextWQ*> lanes;
+
+  explicit IODispatchLanesSingleton(CephContext *cct) {
+    auto count = cct->_conf.get_val<uint64_t>("rbd_io_dispatch_lanes");
+    auto timeout = cct->_conf.get_val<uint64_t>("rbd_op_thread_timeout");
+    for (uint64_t i = 0; i < count; ++i) {
+      // a thread pool of one thread per lane, for the AIO ops of a lane
+      // to be dispatched in the order they were issued
+      auto thread_pool = new ThreadPool(cct, "librbd::io_dispatch_lane",
+                                        "io_rbd_lane", 1);
+      m_thread_pools.push_back(thread_pool);
+      lanes.push_back(new ContextWQ("librbd::io_dispatch_lane", timeout,
+                                    thread_pool));
+      thread_pool->start();
+    }
+  }
+  ~IODispatchLanesSingleton() {
+    for (size_t i = 0; i < lanes.size(); ++i) {
+      lanes[i]->drain();
+      delete lanes[i];
+
+      m_thread_pools[i]->stop();
+      delete m_thread_pools[i];
+    }
+  }
+
+private:
+  std::vector<ThreadPool*> m_thread_pools;
+};
+
 class SafeTimerSingleton : public SafeTimer {
 public:
   ceph::mutex lock = ceph::make_mutex("librbd::Journal::SafeTimerSingleton::lock");
@@ -141,6 +173,7 @@ public:
       this, "librbd::io_work_queue",
       cct->_conf.get_val<uint64_t>("rbd_op_thread_timeout"),
       thread_pool);
+    get_io_dispatch_lanes(cct, &io_dispatch_lanes);
     io_object_dispatcher = new io::ObjectDispatcher<>(this);
 
     if (cct->_conf.get_val<bool>("rbd_auto_exclusive_lock_until_manual_request")) {
@@ -781,6 +814,7 @@ public:
     ASSIGN_OPTION(atime_update_interval, uint64_t);
     ASSIGN_OPTION(skip_partial_discard, bool);
     ASSIGN_OPTION(discard_granularity_bytes, uint64_t);
+    ASSIGN_OPTION(discard_on_zeroed_write, bool);
     ASSIGN_OPTION(blkin_trace_all, bool);
 
 #undef ASSIGN_OPTION
@@ -840,6 +874,13 @@ public:
       RBD_QOS_WRITE_BPS_THROTTLE,
       config.get_val<uint64_t>("rbd_qos_write_bps_limit"),
       config.get_val<uint64_t>("rbd_qos_write_bps_burst"));
+    io_work_queue->apply_qos_scheduler(
+      config.get_val<bool>("rbd_qos_scheduler_enabled"),
+      config.get_val<uint64_t>("rbd_qos_reservation"),
+      config.get_val<uint64_t>("rbd_qos_weight"),
+      config.get_val<uint64_t>("rbd_qos_limit"),
+      config.get_val<uint64_t>("rbd_qos_pool_iops_limit"),
+      config.get_val<uint64_t>("rbd_qos_pool_iops_burst"));
 
     if (!disable_zero_copy &&
         config.get_val<bool>("rbd_disable_zero_copy_writes")) {
@@ -916,6 +957,14 @@ public:
     *op_work_queue = thread_pool_singleton->op_work_queue;
   }
 
+  void ImageCtx::get_io_dispatch_lanes(CephContext *cct,
+                                       std::vector<ContextWQ*> *lanes) {
+    auto lanes_singleton =
+      &cct->lookup_or_create_singleton_object<IODispatchLanesSingleton>(
+	"librbd::io_dispatch_lanes", false, cct);
+    *lanes = lanes_singleton->lanes;
+  }
+
   void ImageCtx::get_timer_instance(CephContext *cct, SafeTimer **timer,
                                     ceph::mutex **timer_lock) {
     auto safe_timer_singleton =
@@ -184,6 +184,9 @@ namespace librbd {
     io::ObjectDispatcher<ImageCtx> *io_object_dispatcher = nullptr;
 
     ContextWQ *op_work_queue;
+    // AIO ops are dispatched from the lane of the thread that issued them,
+    // if any, instead of from io_work_queue
+    std::vector<ContextWQ*> io_dispatch_lanes;
 
     typedef boost::lockfree::queue<
       io::AioCompletion*,
@@ -210,6 +213,7 @@ namespace librbd {
     uint32_t alloc_hint_flags = 0U;
     uint32_t read_flags = 0U;
     uint32_t discard_granularity_bytes = 0;
+    bool discard_on_zeroed_write;
     bool blkin_trace_all;
     uint64_t mirroring_replay_delay;
     uint64_t mtime_update_interval;
@@ -342,6 +346,8 @@ namespace librbd {
     static void get_thread_pool_instance(CephContext *cct,
                                          ThreadPool **thread_pool,
                                          ContextWQ **op_work_queue);
+    static void get_io_dispatch_lanes(CephContext *cct,
+                                      std::vector<ContextWQ*> *lanes);
     static void get_timer_instance(CephContext *cct, SafeTimer **timer,
                                    ceph::mutex **timer_lock);
   };
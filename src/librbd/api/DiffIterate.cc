@@ -314,7 +314,9 @@ int DiffIterate<I>::execute() {
   int r;
   bool fast_diff_enabled = false;
   BitVector<2> object_diff_state;
-  if (m_whole_object) {
+  {
+    // even if the extents of the changed objects are to be listed, the
+    // objects which did not change need not be
     C_SaferCond ctx;
     auto req = object_map::DiffRequest<I>::create(&m_image_ctx, from_snap_id,
                                                   end_snap_id,
@@ -379,8 +381,10 @@ int DiffIterate<I>::execute() {
          p != object_extents.end(); ++p) {
       ldout(cct, 20) << "object " << p->first << dendl;
 
-      if (fast_diff_enabled) {
-        const uint64_t object_no = p->second.front().objectno;
+      const uint64_t object_no = p->second.front().objectno;
+      if (fast_diff_enabled &&
+          (m_whole_object ||
+           object_diff_state[object_no] == OBJECT_DIFF_STATE_NONE)) {
         if (object_diff_state[object_no] == OBJECT_DIFF_STATE_NONE &&
             from_snap_id == 0 && !diff_context.parent_diff.empty()) {
           // no data in child object -- report parent diff instead
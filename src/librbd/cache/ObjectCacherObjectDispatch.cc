@@ -144,6 +144,18 @@ void ObjectCacherObjectDispatch<I>::init() {
 
   m_object_set = new ObjectCacher::ObjectSet(nullptr,
                                              m_image_ctx->data_ctx.get_id(), 0);
+  auto readahead_max =
+    m_image_ctx->config.template get_val<Option::size_t>("rbd_cache_readahead_max_bytes");
+  if (readahead_max > 0) {
+    auto readahead_min =
+      m_image_ctx->config.template get_val<Option::size_t>("rbd_cache_readahead_min_bytes");
+    m_object_cacher->set_readahead(readahead_min, readahead_max);
+    m_object_set->object_size = 1ULL << m_image_ctx->order;
+    m_object_set->stripe_count = m_image_ctx->get_stripe_count();
+    m_object_set->object_name = [image_ctx=m_image_ctx](uint64_t object_no) {
+      return object_t(data_object_name(image_ctx, object_no));
+    };
+  }
   m_object_cacher->start();
   m_cache_lock.unlock();
 
@@ -2,6 +2,9 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "common/WorkQueue.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+#include "include/compat.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/Journal.h"
 #include "librbd/Utils.h"
@@ -11,7 +14,11 @@
 #include "librbd/cache/ParentCacheObjectDispatch.h"
 #include "osd/osd_types.h"
 #include "osdc/WritebackHandler.h"
+#include "tools/immutable_object_cache/Utils.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
 #define dout_subsys ceph_subsys_rbd
@@ -33,6 +40,13 @@ ParentCacheObjectDispatch<I>::ParentCacheObjectDispatch(
   std::string controller_path =
     ((CephContext*)(m_image_ctx->cct))->_conf.get_val<std::string>("immutable_object_cache_sock");
   m_cache_client = new CacheClient(controller_path.c_str(), m_image_ctx->cct);
+
+  std::string index_path =
+    ((CephContext*)(m_image_ctx->cct))->_conf.get_val<std::string>("immutable_object_cache_index_path");
+  if (!index_path.empty()) {
+    m_shared_index = std::make_unique<SharedIndex>(m_image_ctx->cct,
+                                                   index_path);
+  }
 }
 
 template <typename I>
@@ -40,6 +54,11 @@ ParentCacheObjectDispatch<I>::~ParentCacheObjectDispatch() {
     delete m_cache_client;
 }
 
+template <typename I>
+ParentCacheObjectDispatch<I>::CacheFile::~CacheFile() {
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+}
+
 template <typename I>
 void ParentCacheObjectDispatch<I>::init(Context* on_finish) {
   auto cct = m_image_ctx->cct;
@@ -78,6 +97,27 @@ bool ParentCacheObjectDispatch<I>::read(
   ceph_assert(m_initialized);
   string oid = data_object_name(m_image_ctx, object_no);
 
+  /* the objects published in the index shared by the RO daemon are read
+   * without a round-trip to the daemon */
+  std::string file_path;
+  if (m_shared_index &&
+      m_shared_index->lookup(
+        get_cache_file_name(m_image_ctx->data_ctx.get_namespace(),
+                            m_image_ctx->data_ctx.get_id(),
+                            (uint64_t)snap_id, oid),
+        &file_path)) {
+    int r = read_object(file_path, read_data, object_off, object_len,
+                        on_dispatched);
+    if (r >= 0) {
+      *dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+      on_dispatched = util::create_async_context_callback(*m_image_ctx,
+                                                          on_dispatched);
+      on_dispatched->complete(r);
+      return true;
+    }
+    // the object was evicted in the meantime
+  }
+
   /* if RO daemon still don't startup, or RO daemon crash,
    * or session occur any error, try to re-connect daemon.*/
   if (!m_cache_client->is_session_work()) {
@@ -115,7 +155,8 @@ bool ParentCacheObjectDispatch<I>::read(
 
   m_cache_client->lookup_object(m_image_ctx->data_ctx.get_namespace(),
                                 m_image_ctx->data_ctx.get_id(),
-                                (uint64_t)snap_id, oid, std::move(ctx));
+                                (uint64_t)snap_id, object_off, object_len,
+                                oid, std::move(ctx));
   return true;
 }
 
@@ -190,6 +231,15 @@ int ParentCacheObjectDispatch<I>::create_cache_session(Context* on_finish, bool
     m_cache_client->register_client(register_ctx);
   });
 
+  if (m_shared_index && !m_shared_index->is_open()) {
+    // the RO daemon recreates the index when it restarts
+    int r = m_shared_index->open();
+    if (r < 0) {
+      ldout(cct, 5) << "Parent cache fail to open shared index: "
+                    << cpp_strerror(r) << dendl;
+    }
+  }
+
   if (m_cache_client != nullptr && is_reconnect) {
     // CacheClient's destruction will cleanup all details on old session.
     delete m_cache_client;
@@ -214,17 +264,69 @@ int ParentCacheObjectDispatch<I>::read_object(
   auto *cct = m_image_ctx->cct;
   ldout(cct, 20) << "file path: " << file_path << dendl;
 
-  std::string error;
-  int ret = read_data->pread_file(file_path.c_str(), offset, length, &error);
+  CacheFileRef cache_file;
+  int ret = open_cache_file(file_path, &cache_file);
   if (ret < 0) {
-    ldout(cct, 5) << "read from file return error: " << error
-                  << "file path= " << file_path
+    ldout(cct, 5) << "open file return error: " << cpp_strerror(ret)
+                  << " file path= " << file_path
                   << dendl;
     return ret;
   }
+
+  // an evicted cache file which is still open holds the same data
+  bufferptr bp = buffer::create(length);
+  ret = safe_pread(cache_file->fd, bp.c_str(), length, offset);
+  if (ret < 0) {
+    ldout(cct, 5) << "read from file return error: " << cpp_strerror(ret)
+                  << " file path= " << file_path
+                  << dendl;
+    return ret;
+  }
+  bp.set_length(ret);
+  read_data->append(std::move(bp));
   return read_data->length();
 }
 
+template <typename I>
+int ParentCacheObjectDispatch<I>::open_cache_file(
+    const std::string& file_path, CacheFileRef* cache_file) {
+  {
+    std::lock_guard locker{m_cache_files_lock};
+    auto it = m_cache_files.find(file_path);
+    if (it != m_cache_files.end()) {
+      // the daemon caches the objects extent by extent: the blocks promoted
+      // since an eviction are only in the file now at the path
+      struct stat st;
+      if (::fstat(it->second->second->fd, &st) == 0 && st.st_nlink > 0) {
+        m_cache_files_lru.splice(m_cache_files_lru.begin(),
+                                 m_cache_files_lru, it->second);
+        *cache_file = it->second->second;
+        return 0;
+      }
+      m_cache_files_lru.erase(it->second);
+      m_cache_files.erase(it);
+    }
+  }
+
+  int fd = ::open(file_path.c_str(), O_RDONLY|O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+  *cache_file = std::make_shared<CacheFile>(fd);
+
+  std::lock_guard locker{m_cache_files_lock};
+  if (m_cache_files.count(file_path) == 0) {
+    m_cache_files_lru.emplace_front(file_path, *cache_file);
+    m_cache_files[file_path] = m_cache_files_lru.begin();
+    if (m_cache_files_lru.size() > MAX_OPEN_CACHE_FILES) {
+      // closed once the reads in flight are done with it
+      m_cache_files.erase(m_cache_files_lru.back().first);
+      m_cache_files_lru.pop_back();
+    }
+  }
+  return 0;
+}
+
 } // namespace cache
 } // namespace librbd
 
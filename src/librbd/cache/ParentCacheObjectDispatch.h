@@ -5,10 +5,16 @@
 #define CEPH_LIBRBD_CACHE_PARENT_CACHER_OBJECT_DISPATCH_H
 
 #include "librbd/io/ObjectDispatchInterface.h"
+#include "common/ceph_mutex.h"
 #include "tools/immutable_object_cache/CacheClient.h"
 #include "librbd/cache/TypeTraits.h"
+#include "tools/immutable_object_cache/SharedIndex.h"
 #include "tools/immutable_object_cache/Types.h"
 
+#include <list>
+#include <memory>
+#include <unordered_map>
+
 namespace librbd {
 
 class ImageCtx;
@@ -117,7 +123,20 @@ public:
   }
 
 private:
+  // the cache files opened the most recently are kept open
+  static const size_t MAX_OPEN_CACHE_FILES = 128;
+
+  struct CacheFile {
+    int fd;
+
+    explicit CacheFile(int fd) : fd(fd) {
+    }
+    ~CacheFile();
+  };
+  typedef std::shared_ptr<CacheFile> CacheFileRef;
+  typedef std::list<std::pair<std::string, CacheFileRef>> CacheFiles;
 
+  int open_cache_file(const std::string& file_path, CacheFileRef* cache_file);
   int read_object(std::string file_path, ceph::bufferlist* read_data,
                   uint64_t offset, uint64_t length, Context *on_finish);
   void handle_read_cache(
@@ -133,6 +152,13 @@ private:
   CacheClient *m_cache_client;
   bool m_initialized;
   std::atomic<bool> m_connecting;
+
+  std::unique_ptr<ceph::immutable_obj_cache::SharedIndex> m_shared_index;
+
+  ceph::mutex m_cache_files_lock = ceph::make_mutex(
+    "librbd::cache::ParentCacheObjectDispatch::m_cache_files_lock");
+  CacheFiles m_cache_files_lru;
+  std::unordered_map<std::string, typename CacheFiles::iterator> m_cache_files;
 };
 
 } // namespace cache
@@ -0,0 +1,511 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/cache/ReadCacheObjectDispatch.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+#include "common/WorkQueue.h"
+#include "include/intarith.h"
+#include "include/stringify.h"
+#include "librbd/ExclusiveLock.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/ObjectMap.h"
+#include "librbd/Utils.h"
+#include "librbd/io/ObjectDispatcher.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::cache::ReadCacheObjectDispatch: " \
+                           << this << " " << __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+using librbd::util::data_object_name;
+
+template <typename I>
+ReadCacheObjectDispatch<I>::ReadCacheObjectDispatch(I* image_ctx)
+  : m_image_ctx(image_ctx),
+    m_lock(ceph::make_shared_mutex(util::unique_lock_name(
+      "librbd::cache::ReadCacheObjectDispatch::lock", this))),
+    m_object_gens(OBJECT_GEN_BUCKETS, 0) {
+}
+
+template <typename I>
+ReadCacheObjectDispatch<I>::~ReadCacheObjectDispatch() {
+  ceph_assert(m_pending_fills == 0);
+  if (m_fd >= 0) {
+    VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+    ::unlink(m_cache_path.c_str());
+  }
+}
+
+template <typename I>
+void ReadCacheObjectDispatch<I>::init() {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  auto cache_size = m_image_ctx->config.template get_val<Option::size_t>(
+    "rbd_read_cache_size");
+  m_cache_path = m_image_ctx->config.template get_val<std::string>(
+    "rbd_read_cache_path") + "/rbd-read-cache." +
+    stringify(m_image_ctx->md_ctx.get_id()) + "." + m_image_ctx->id;
+  m_blocks_per_object = p2roundup<uint64_t>(m_image_ctx->layout.object_size,
+                                            BLOCK_SIZE) / BLOCK_SIZE;
+
+  // what was cached before the image was opened cannot be trusted
+  int flags = O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC;
+  m_fd = ::open(m_cache_path.c_str(), flags | O_DIRECT, 0600);
+  if (m_fd < 0 && errno == EINVAL) {
+    ldout(cct, 1) << m_cache_path << " does not support O_DIRECT" << dendl;
+    m_fd = ::open(m_cache_path.c_str(), flags, 0600);
+  }
+  if (m_fd < 0) {
+    lderr(cct) << "failed to open " << m_cache_path << ": "
+               << cpp_strerror(-errno) << ", read cache disabled" << dendl;
+  } else if (::ftruncate(m_fd, cache_size) < 0) {
+    lderr(cct) << "failed to resize " << m_cache_path << ": "
+               << cpp_strerror(-errno) << ", read cache disabled" << dendl;
+    VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+    ::unlink(m_cache_path.c_str());
+    m_fd = -1;
+  } else {
+    uint32_t slots = cache_size / BLOCK_SIZE;
+    m_slot_keys.assign(slots, INVALID_KEY);
+    m_slot_referenced = std::vector<std::atomic<bool>>(slots);
+    m_free_slots.reserve(slots);
+    for (uint32_t slot = slots; slot > 0; --slot) {
+      m_free_slots.push_back(slot - 1);
+    }
+  }
+
+  // add ourself to the IO object dispatcher chain
+  m_image_ctx->io_object_dispatcher->register_object_dispatch(this);
+}
+
+template <typename I>
+void ReadCacheObjectDispatch<I>::shut_down(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  on_finish = util::create_async_context_callback(*m_image_ctx, on_finish);
+  {
+    std::unique_lock locker{m_lock};
+    if (m_pending_fills > 0) {
+      ldout(cct, 5) << "waiting for " << m_pending_fills << " fills" << dendl;
+      m_on_shut_down = on_finish;
+      return;
+    }
+  }
+  on_finish->complete(0);
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::read(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    librados::snap_t snap_id, int op_flags, const ZTracer::Trace &parent_trace,
+    ceph::bufferlist* read_data, io::ExtentMap* extent_map,
+    int* object_dispatch_flags, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  if (m_fd < 0 || snap_id != CEPH_NOSNAP || object_len == 0) {
+    return false;
+  }
+
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << object_len << dendl;
+
+  bool object_may_exist = true;
+  {
+    std::shared_lock image_locker{m_image_ctx->image_lock};
+    if (m_image_ctx->object_map != nullptr &&
+        !m_image_ctx->object_map->object_may_exist(object_no)) {
+      object_may_exist = false;
+    }
+  }
+  if (!object_may_exist) {
+    ldout(cct, 20) << "object does not exist" << dendl;
+    invalidate_blocks(object_no, 0, m_blocks_per_object * BLOCK_SIZE);
+    return false;
+  }
+
+  if (read_cached(object_no, object_off, object_len, read_data)) {
+    ldout(cct, 20) << "cache hit" << dendl;
+    *dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+    on_dispatched = util::create_async_context_callback(*m_image_ctx,
+                                                        on_dispatched);
+    on_dispatched->complete(0);
+    return true;
+  }
+
+  auto gens = get_generations(object_no);
+  *on_finish = new LambdaContext(
+    [this, object_no, object_off, object_len, gens, read_data, extent_map,
+     on_finish=*on_finish](int r) {
+      handle_read(object_no, object_off, object_len, gens, r, read_data,
+                  extent_map);
+      on_finish->complete(r);
+    });
+  return false;
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::discard(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    const ::SnapContext &snapc, int discard_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  return dispatch_write(object_no, object_off, object_len, on_finish);
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::write(
+    uint64_t object_no, uint64_t object_off, ceph::bufferlist&& data,
+    const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+    Context**on_finish, Context* on_dispatched) {
+  return dispatch_write(object_no, object_off, data.length(), on_finish);
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::write_same(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    io::LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
+    const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+    Context**on_finish, Context* on_dispatched) {
+  return dispatch_write(object_no, object_off, object_len, on_finish);
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::compare_and_write(
+    uint64_t object_no, uint64_t object_off, ceph::bufferlist&& cmp_data,
+    ceph::bufferlist&& write_data, const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, uint64_t* mismatch_offset,
+    int* object_dispatch_flags, uint64_t* journal_tid,
+    io::DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  return dispatch_write(object_no, object_off, write_data.length(), on_finish);
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::invalidate_cache(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  std::unique_lock locker{m_lock};
+  m_valid = false;
+  ++m_gen;
+  for (auto& [key, slot] : m_slots_by_key) {
+    m_slot_keys[slot] = INVALID_KEY;
+    m_free_slots.push_back(slot);
+  }
+  m_slots_by_key.clear();
+  return false;
+}
+
+template <typename I>
+typename ReadCacheObjectDispatch<I>::Generations
+ReadCacheObjectDispatch<I>::get_generations(uint64_t object_no) const {
+  std::shared_lock locker{m_lock};
+  return {m_gen, m_object_gens[object_no % OBJECT_GEN_BUCKETS]};
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::read_cached(uint64_t object_no,
+                                             uint64_t object_off,
+                                             uint64_t object_len,
+                                             ceph::bufferlist* read_data) {
+  uint64_t first_block = object_off / BLOCK_SIZE;
+  uint64_t last_block = (object_off + object_len - 1) / BLOCK_SIZE;
+
+  std::shared_lock locker{m_lock};
+  if (!m_valid) {
+    return false;
+  }
+
+  std::vector<uint32_t> slots;
+  slots.reserve(last_block - first_block + 1);
+  for (uint64_t block = first_block; block <= last_block; ++block) {
+    auto it = m_slots_by_key.find(get_key(object_no, block));
+    if (it == m_slots_by_key.end()) {
+      return false;
+    }
+    slots.push_back(it->second);
+  }
+
+  ceph::bufferlist bl;
+  for (auto slot : slots) {
+    ceph::bufferptr bp{ceph::buffer::create_page_aligned(BLOCK_SIZE)};
+    int r = safe_pread_exact(m_fd, bp.c_str(), BLOCK_SIZE, slot * BLOCK_SIZE);
+    if (r < 0) {
+      lderr(m_image_ctx->cct) << "failed to read " << m_cache_path << ": "
+                              << cpp_strerror(r) << dendl;
+      return false;
+    }
+    m_slot_referenced[slot] = true;
+    bl.push_back(std::move(bp));
+  }
+  locker.unlock();
+
+  read_data->substr_of(bl, object_off % BLOCK_SIZE, object_len);
+  return true;
+}
+
+template <typename I>
+void ReadCacheObjectDispatch<I>::handle_read(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    const Generations& gens, int r, ceph::bufferlist* read_data,
+    io::ExtentMap* extent_map) {
+  if (r < 0 && r != -ENOENT) {
+    return;
+  }
+
+  // only whole blocks are cached
+  uint64_t fill_off = p2roundup(object_off, BLOCK_SIZE);
+  uint64_t fill_end = p2align(object_off + object_len, BLOCK_SIZE);
+  if (fill_off >= fill_end) {
+    return;
+  }
+
+  ceph::bufferlist data;
+  if (r == -ENOENT) {
+    data.append_zero(object_len);
+  } else if (!extent_map->empty()) {
+    uint64_t pos = object_off;
+    uint64_t extents_len = 0;
+    for (auto& [off, len] : *extent_map) {
+      if (off < pos || off + len > object_off + object_len) {
+        return;
+      }
+      pos = off + len;
+      extents_len += len;
+    }
+    if (read_data->length() != extents_len) {
+      return;
+    }
+
+    pos = object_off;
+    auto it = read_data->cbegin();
+    for (auto& [off, len] : *extent_map) {
+      data.append_zero(off - pos);
+      it.copy(len, data);
+      pos = off + len;
+    }
+    data.append_zero(object_off + object_len - pos);
+  } else {
+    if (read_data->length() > object_len) {
+      return;
+    }
+    data = *read_data;
+    data.append_zero(object_len - data.length());
+  }
+
+  ceph::bufferlist blocks;
+  blocks.substr_of(data, fill_off - object_off, fill_end - fill_off);
+  {
+    std::unique_lock locker{m_lock};
+    ++m_pending_fills;
+  }
+  m_image_ctx->op_work_queue->queue(new LambdaContext(
+    [this, object_no, fill_off, gens, blocks=std::move(blocks)](int) mutable {
+      fill(object_no, fill_off, gens, std::move(blocks));
+    }), 0);
+}
+
+template <typename I>
+void ReadCacheObjectDispatch<I>::fill(uint64_t object_no, uint64_t object_off,
+                                      const Generations& gens,
+                                      ceph::bufferlist&& data) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << data.length() << dendl;
+
+  bool lock_owner;
+  {
+    std::shared_lock owner_locker{m_image_ctx->owner_lock};
+    lock_owner = (m_image_ctx->exclusive_lock != nullptr &&
+                  m_image_ctx->exclusive_lock->accept_ops());
+  }
+
+  auto is_current = [this, object_no, &gens]() {
+    return (gens.gen == m_gen &&
+            gens.object_gen == m_object_gens[object_no % OBJECT_GEN_BUCKETS]);
+  };
+
+  struct BlockFill {
+    uint64_t key;
+    uint32_t slot;
+    uint64_t data_off;
+    bool written;
+  };
+  std::vector<BlockFill> block_fills;
+  {
+    std::unique_lock locker{m_lock};
+    if (!lock_owner || !is_current()) {
+      locker.unlock();
+      finish_fill();
+      return;
+    }
+    if (!m_valid) {
+      // the read may have been sent before the lock was acquired, but the
+      // reads sent from now on were not
+      ldout(cct, 5) << "cache is valid while the lock is held" << dendl;
+      m_valid = true;
+      ++m_gen;
+      locker.unlock();
+      finish_fill();
+      return;
+    }
+
+    uint64_t first_block = object_off / BLOCK_SIZE;
+    for (uint64_t data_off = 0; data_off < data.length();
+         data_off += BLOCK_SIZE) {
+      auto key = get_key(object_no, first_block + data_off / BLOCK_SIZE);
+      if (m_slots_by_key.count(key) > 0) {
+        continue;
+      }
+      uint32_t slot;
+      if (!alloc_slot(&slot)) {
+        break;
+      }
+      block_fills.push_back({key, slot, data_off, false});
+    }
+  }
+
+  // the slots are in neither the free list nor the map while written
+  for (auto& block_fill : block_fills) {
+    ceph::bufferlist bl;
+    bl.substr_of(data, block_fill.data_off, BLOCK_SIZE);
+    // for O_DIRECT
+    bl.rebuild_aligned_size_and_memory(BLOCK_SIZE, CEPH_PAGE_SIZE);
+    int r = bl.write_fd(m_fd, block_fill.slot * BLOCK_SIZE);
+    if (r < 0) {
+      lderr(cct) << "failed to write " << m_cache_path << ": "
+                 << cpp_strerror(r) << dendl;
+      break;
+    }
+    block_fill.written = true;
+  }
+
+  {
+    std::unique_lock locker{m_lock};
+    bool current = is_current();
+    for (auto& block_fill : block_fills) {
+      if (!current || !block_fill.written ||
+          m_slots_by_key.count(block_fill.key) > 0) {
+        m_free_slots.push_back(block_fill.slot);
+        continue;
+      }
+      m_slots_by_key[block_fill.key] = block_fill.slot;
+      m_slot_keys[block_fill.slot] = block_fill.key;
+      m_slot_referenced[block_fill.slot] = false;
+    }
+  }
+  finish_fill();
+}
+
+template <typename I>
+void ReadCacheObjectDispatch<I>::finish_fill() {
+  Context* on_shut_down = nullptr;
+  {
+    std::unique_lock locker{m_lock};
+    ceph_assert(m_pending_fills > 0);
+    if (--m_pending_fills == 0) {
+      std::swap(on_shut_down, m_on_shut_down);
+    }
+  }
+  if (on_shut_down != nullptr) {
+    on_shut_down->complete(0);
+  }
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::alloc_slot(uint32_t* slot) {
+  ceph_assert(ceph_mutex_is_wlocked(m_lock));
+  if (!m_free_slots.empty()) {
+    *slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    return true;
+  }
+
+  // evict the first block not read since the clock hand last passed it
+  uint32_t slots = m_slot_keys.size();
+  for (uint64_t i = 0; i < 2 * slots; ++i) {
+    uint32_t candidate = m_clock_hand;
+    m_clock_hand = (m_clock_hand + 1) % slots;
+    if (m_slot_keys[candidate] == INVALID_KEY ||
+        m_slot_referenced[candidate].exchange(false)) {
+      continue;
+    }
+    m_slots_by_key.erase(m_slot_keys[candidate]);
+    m_slot_keys[candidate] = INVALID_KEY;
+    *slot = candidate;
+    return true;
+  }
+  return false;
+}
+
+template <typename I>
+void ReadCacheObjectDispatch<I>::free_slot(uint32_t slot) {
+  ceph_assert(ceph_mutex_is_wlocked(m_lock));
+  m_slots_by_key.erase(m_slot_keys[slot]);
+  m_slot_keys[slot] = INVALID_KEY;
+  m_free_slots.push_back(slot);
+}
+
+template <typename I>
+void ReadCacheObjectDispatch<I>::invalidate_blocks(uint64_t object_no,
+                                                   uint64_t object_off,
+                                                   uint64_t object_len) {
+  std::unique_lock locker{m_lock};
+  // fills of reads which raced with this are dropped
+  ++m_object_gens[object_no % OBJECT_GEN_BUCKETS];
+  if (m_slots_by_key.empty() || object_len == 0) {
+    return;
+  }
+
+  uint64_t first_block = object_off / BLOCK_SIZE;
+  uint64_t last_block = (object_off + object_len - 1) / BLOCK_SIZE;
+  for (uint64_t block = first_block; block <= last_block; ++block) {
+    auto it = m_slots_by_key.find(get_key(object_no, block));
+    if (it != m_slots_by_key.end()) {
+      free_slot(it->second);
+    }
+  }
+}
+
+template <typename I>
+bool ReadCacheObjectDispatch<I>::dispatch_write(uint64_t object_no,
+                                                uint64_t object_off,
+                                                uint64_t object_len,
+                                                Context** on_finish) {
+  if (m_fd < 0) {
+    return false;
+  }
+
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << object_len << dendl;
+
+  // drop the blocks again once written, since reads sent while the write
+  // is in flight may cache the data from before it
+  invalidate_blocks(object_no, object_off, object_len);
+  *on_finish = new LambdaContext(
+    [this, object_no, object_off, object_len, on_finish=*on_finish](int r) {
+      invalidate_blocks(object_no, object_off, object_len);
+      on_finish->complete(r);
+    });
+  return false;
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::ReadCacheObjectDispatch<librbd::ImageCtx>;
@@ -0,0 +1,171 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_READ_CACHE_OBJECT_DISPATCH_H
+#define CEPH_LIBRBD_CACHE_READ_CACHE_OBJECT_DISPATCH_H
+
+#include "librbd/io/ObjectDispatchInterface.h"
+#include "common/ceph_mutex.h"
+#include "include/buffer.h"
+#include "librbd/io/Types.h"
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Context;
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace cache {
+
+/**
+ * A read cache of the image's blocks in a file on a local SSD.
+ *
+ * The cached blocks are only trusted while this client holds the exclusive
+ * lock, since no other client can write the image meanwhile: the cache is
+ * invalidated when the lock is released, and is valid again after the first
+ * read completed while the lock is held once more. Writes drop the blocks
+ * they overlap, and objects the object map says do not exist are read
+ * around the cache.
+ *
+ * The cache file is created anew when the image is opened.
+ */
+template <typename ImageCtxT = ImageCtx>
+class ReadCacheObjectDispatch : public io::ObjectDispatchInterface {
+public:
+  static ReadCacheObjectDispatch* create(ImageCtxT* image_ctx) {
+    return new ReadCacheObjectDispatch(image_ctx);
+  }
+
+  ReadCacheObjectDispatch(ImageCtxT* image_ctx);
+  ~ReadCacheObjectDispatch() override;
+
+  io::ObjectDispatchLayer get_object_dispatch_layer() const override {
+    return io::OBJECT_DISPATCH_LAYER_READ_CACHE;
+  }
+
+  void init();
+  void shut_down(Context* on_finish) override;
+
+  bool read(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      librados::snap_t snap_id, int op_flags,
+      const ZTracer::Trace &parent_trace, ceph::bufferlist* read_data,
+      io::ExtentMap* extent_map, int* object_dispatch_flags,
+      io::DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+
+  bool discard(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      const ::SnapContext &snapc, int discard_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context**on_finish, Context* on_dispatched) override;
+
+  bool write(
+      uint64_t object_no, uint64_t object_off, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context**on_finish, Context* on_dispatched) override;
+
+  bool write_same(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      io::LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context**on_finish, Context* on_dispatched) override;
+
+  bool compare_and_write(
+      uint64_t object_no, uint64_t object_off, ceph::bufferlist&& cmp_data,
+      ceph::bufferlist&& write_data, const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, uint64_t* mismatch_offset,
+      int* object_dispatch_flags, uint64_t* journal_tid,
+      io::DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+
+  bool flush(
+      io::FlushSource flush_source, const ZTracer::Trace &parent_trace,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override {
+    return false;
+  }
+
+  bool invalidate_cache(Context* on_finish) override;
+
+  bool reset_existence_cache(Context* on_finish) override {
+    return false;
+  }
+
+  void extent_overwritten(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      uint64_t journal_tid, uint64_t new_journal_tid) override {
+  }
+
+private:
+  /* The cache is read and written in blocks of this size */
+  static constexpr uint64_t BLOCK_SIZE = 4096;
+  static constexpr uint64_t INVALID_KEY = UINT64_MAX;
+  /* Writes to an object are tracked by the bucket of its object number */
+  static constexpr uint64_t OBJECT_GEN_BUCKETS = 1024;
+
+  /* The invalidations a read raced with, if the generations moved on */
+  struct Generations {
+    uint64_t gen;
+    uint64_t object_gen;
+  };
+
+  ImageCtxT* m_image_ctx;
+  std::string m_cache_path;
+  int m_fd = -1;
+  uint64_t m_blocks_per_object = 0;
+
+  /* Hold a read lock to look up blocks and read them from the cache file.
+   * Hold a write lock to add blocks, or to drop them before their slots are
+   * reused. */
+  mutable ceph::shared_mutex m_lock;
+  bool m_valid = false;
+  uint64_t m_gen = 0;
+  std::vector<uint64_t> m_object_gens;
+
+  std::unordered_map<uint64_t, uint32_t> m_slots_by_key;
+  std::vector<uint64_t> m_slot_keys;            /* INVALID_KEY if not cached */
+  std::vector<std::atomic<bool>> m_slot_referenced;
+  std::vector<uint32_t> m_free_slots;
+  uint32_t m_clock_hand = 0;
+
+  uint64_t m_pending_fills = 0;
+  Context* m_on_shut_down = nullptr;
+
+  uint64_t get_key(uint64_t object_no, uint64_t block) const {
+    return object_no * m_blocks_per_object + block;
+  }
+  Generations get_generations(uint64_t object_no) const;
+
+  bool read_cached(uint64_t object_no, uint64_t object_off,
+                   uint64_t object_len, ceph::bufferlist* read_data);
+  void handle_read(uint64_t object_no, uint64_t object_off,
+                   uint64_t object_len, const Generations& gens, int r,
+                   ceph::bufferlist* read_data, io::ExtentMap* extent_map);
+  void fill(uint64_t object_no, uint64_t object_off,
+            const Generations& gens, ceph::bufferlist&& data);
+  void finish_fill();
+
+  bool alloc_slot(uint32_t* slot);
+  void free_slot(uint32_t slot);
+  void invalidate_blocks(uint64_t object_no, uint64_t object_off,
+                         uint64_t object_len);
+  bool dispatch_write(uint64_t object_no, uint64_t object_off,
+                      uint64_t object_len, Context** on_finish);
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::ReadCacheObjectDispatch<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_READ_CACHE_OBJECT_DISPATCH_H
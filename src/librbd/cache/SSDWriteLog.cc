@@ -0,0 +1,1139 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "SSDWriteLog.h"
+#include "include/buffer.h"
+#include "include/Context.h"
+#include "include/ceph_assert.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/Utils.h"
+#include "librbd/cache/rwl/ImageCacheState.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#undef dout_subsys
+#define dout_subsys ceph_subsys_rbd_rwl
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::cache::SSDWriteLog: " << this << " " \
+                           <<  __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+using namespace librbd::cache::ssd;
+
+namespace {
+
+BlockExtent block_extent(const io::Extent &extent) {
+  return BlockExtent(extent.first, extent.first + extent.second);
+}
+
+/*
+ * Assembles the data of a read from the hits read from the log, and the
+ * misses read from the image below.
+ */
+struct C_ReadRequest : public Context {
+  struct ReadExtent {
+    io::Extent extent;
+    bool hit;
+    bufferlist bl;
+  };
+
+  CephContext *cct;
+  bufferlist *out_bl;
+  Context *on_finish;
+  std::vector<ReadExtent> read_extents;
+  io::Extents miss_extents;
+  bufferlist miss_bl;
+
+  C_ReadRequest(CephContext *cct, bufferlist *out_bl, Context *on_finish)
+    : cct(cct), out_bl(out_bl), on_finish(on_finish) {
+  }
+
+  void finish(int r) override {
+    ldout(cct, 20) << "r=" << r << dendl;
+    if (r >= 0) {
+      uint64_t miss_bl_offset = 0;
+      for (auto &read_extent : read_extents) {
+        if (read_extent.hit) {
+          ceph_assert(read_extent.bl.length() == read_extent.extent.second);
+          out_bl->claim_append(read_extent.bl);
+        } else {
+          bufferlist miss_extent_bl;
+          miss_extent_bl.substr_of(miss_bl, miss_bl_offset,
+                                   read_extent.extent.second);
+          out_bl->claim_append(miss_extent_bl);
+          miss_bl_offset += read_extent.extent.second;
+        }
+      }
+    }
+    on_finish->complete(r);
+  }
+};
+
+} // anonymous namespace
+
+template <typename I>
+SSDWriteLog<I>::SSDWriteLog(I &image_ctx,
+                            librbd::cache::rwl::ImageCacheState<I>* cache_state)
+  : m_image_ctx(image_ctx), m_cache_state(cache_state),
+    m_image_writeback(image_ctx),
+    m_entry_reader_lock(ceph::make_shared_mutex(util::unique_lock_name(
+      "librbd::cache::SSDWriteLog::m_entry_reader_lock", this))),
+    m_lock(ceph::make_mutex(util::unique_lock_name(
+      "librbd::cache::SSDWriteLog::m_lock", this))),
+    m_blocks_to_log_entries(image_ctx.cct),
+    m_thread_pool(image_ctx.cct, "librbd::cache::SSDWriteLog::thread_pool",
+                  "tp_ssd_wl", 4, ""),
+    m_work_queue("librbd::cache::SSDWriteLog::work_queue",
+                 image_ctx.config.template get_val<uint64_t>("rbd_op_thread_timeout"),
+                 &m_thread_pool)
+{
+}
+
+template <typename I>
+SSDWriteLog<I>::~SSDWriteLog() {
+  ldout(m_image_ctx.cct, 15) << "enter" << dendl;
+  m_thread_pool.stop();
+  {
+    std::lock_guard locker(m_lock);
+    ceph_assert(m_ops_to_append.empty());
+    ceph_assert(!m_appending);
+    ceph_assert(m_writeback_ops == 0);
+    ceph_assert(!m_retiring);
+    if (m_fd >= 0) {
+      VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+      m_fd = -1;
+    }
+    delete m_cache_state;
+    m_cache_state = nullptr;
+  }
+  ldout(m_image_ctx.cct, 15) << "exit" << dendl;
+}
+
+template <typename I>
+int SSDWriteLog<I>::read_log(uint64_t offset, uint64_t length,
+                             bufferlist *bl) {
+  ceph_assert(offset % BLOCK_SIZE == 0 && length % BLOCK_SIZE == 0);
+  bufferptr bp{buffer::create_page_aligned(length)};
+  int r = safe_pread_exact(m_fd, bp.c_str(), length, offset);
+  if (r < 0) {
+    lderr(m_image_ctx.cct) << "failed to read " << length << "~" << offset
+                           << " from " << m_log_path << ": "
+                           << cpp_strerror(r) << dendl;
+    return r;
+  }
+  bl->push_back(std::move(bp));
+  return 0;
+}
+
+template <typename I>
+int SSDWriteLog<I>::write_log(uint64_t offset, bufferlist &bl) {
+  ceph_assert(offset % BLOCK_SIZE == 0 && bl.length() % BLOCK_SIZE == 0);
+  /* for O_DIRECT */
+  bl.rebuild_aligned_size_and_memory(BLOCK_SIZE, CEPH_PAGE_SIZE);
+  int r = bl.write_fd(m_fd, offset);
+  if (r < 0) {
+    lderr(m_image_ctx.cct) << "failed to write " << bl.length() << "~"
+                           << offset << " to " << m_log_path << ": "
+                           << cpp_strerror(r) << dendl;
+  }
+  return r;
+}
+
+template <typename I>
+int SSDWriteLog<I>::write_super_block(uint64_t first_valid_offset,
+                                      uint64_t first_valid_seq) {
+  ldout(m_image_ctx.cct, 20) << "first_valid_offset=" << first_valid_offset
+                             << ", first_valid_seq=" << first_valid_seq
+                             << dendl;
+  SuperBlock super_block;
+  super_block.log_size = m_log_size;
+  super_block.first_valid_offset = first_valid_offset;
+  super_block.first_valid_seq = first_valid_seq;
+  bufferlist bl;
+  encode_block(super_block, bl);
+  return write_log(0, bl);
+}
+
+template <typename I>
+int SSDWriteLog<I>::read_batch(uint64_t offset, uint64_t seq,
+                               LogBatchHeader *header) {
+  if (offset < LOG_START || offset + BLOCK_SIZE > m_log_size) {
+    return -EINVAL;
+  }
+  bufferlist bl;
+  int r = read_log(offset, BLOCK_SIZE, &bl);
+  if (r < 0) {
+    return r;
+  }
+  r = decode_block(bl, header);
+  if (r < 0) {
+    return r;
+  }
+  /* a batch left by an earlier lap of the ring has an earlier seq */
+  if (header->seq != seq || header->length <= BLOCK_SIZE ||
+      header->length % BLOCK_SIZE != 0 ||
+      offset + header->length > m_log_size) {
+    return -EINVAL;
+  }
+  uint64_t data_length = 0;
+  for (auto &desc : header->entries) {
+    data_length += round_up_to_block(desc.write_bytes);
+  }
+  if (data_length != header->length - BLOCK_SIZE) {
+    return -EINVAL;
+  }
+  bufferlist data_bl;
+  r = read_log(offset + BLOCK_SIZE, data_length, &data_bl);
+  if (r < 0) {
+    return r;
+  }
+  /* a batch which was torn by a crash while it was appended */
+  if (data_bl.crc32c(0) != header->data_crc) {
+    return -EINVAL;
+  }
+  return 0;
+}
+
+template <typename I>
+void SSDWriteLog<I>::add_batch(uint64_t seq, uint64_t offset,
+                               const LogBatchHeader &header) {
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+  LogBatch &batch = m_batches[seq];
+  batch.offset = offset;
+  batch.length = header.length;
+  batch.dirty_entries = header.entries.size();
+  uint64_t log_offset = offset + BLOCK_SIZE;
+  for (auto &desc : header.entries) {
+    auto log_entry = std::make_shared<WriteLogEntry>(desc, log_offset, seq);
+    batch.entries.push_back(log_entry);
+    m_current_sync_gen = std::max(m_current_sync_gen, desc.sync_gen_number);
+    log_offset += round_up_to_block(desc.write_bytes);
+  }
+  m_blocks_to_log_entries.add_log_entries(batch.entries);
+  m_dirty_entries.insert(m_dirty_entries.end(), batch.entries.begin(),
+                         batch.entries.end());
+}
+
+template <typename I>
+int SSDWriteLog<I>::load_log() {
+  CephContext *cct = m_image_ctx.cct;
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+
+  bufferlist bl;
+  int r = read_log(0, BLOCK_SIZE, &bl);
+  if (r < 0) {
+    return r;
+  }
+  SuperBlock super_block;
+  r = decode_block(bl, &super_block);
+  if (r < 0) {
+    lderr(cct) << "invalid super block in " << m_log_path << dendl;
+    return r;
+  }
+  if (super_block.layout_version != SSD_LOG_VERSION) {
+    lderr(cct) << "unsupported layout version "
+               << super_block.layout_version << " of " << m_log_path
+               << dendl;
+    return -EOPNOTSUPP;
+  }
+  m_log_size = super_block.log_size;
+
+  /* Replay the batches from the first valid one in order, until the next
+   * one is neither where the last one ended nor at the start of the ring */
+  uint64_t offset = super_block.first_valid_offset;
+  uint64_t seq = super_block.first_valid_seq;
+  m_first_free_offset = offset;
+  m_next_seq = seq;
+  while (true) {
+    LogBatchHeader header;
+    r = read_batch(offset, seq, &header);
+    if (r < 0 && offset != LOG_START) {
+      offset = LOG_START;
+      r = read_batch(offset, seq, &header);
+    }
+    if (r < 0) {
+      break;
+    }
+    ldout(cct, 20) << "replayed batch seq=" << seq << " at " << offset
+                   << " with " << header.entries.size() << " entries"
+                   << dendl;
+    add_batch(seq, offset, header);
+    offset += header.length;
+    m_first_free_offset = offset;
+    m_next_seq = ++seq;
+  }
+  m_first_valid_offset = m_batches.empty() ?
+    m_first_free_offset : m_batches.begin()->second.offset;
+  /* new writes follow the replayed ones in a sync gen of their own */
+  ++m_current_sync_gen;
+
+  ldout(cct, 1) << "replayed " << m_batches.size() << " batches with "
+                << m_dirty_entries.size() << " dirty entries, "
+                << "first_valid=" << m_first_valid_offset << ", "
+                << "first_free=" << m_first_free_offset << dendl;
+  return 0;
+}
+
+template <typename I>
+int SSDWriteLog<I>::open_log() {
+  CephContext *cct = m_image_ctx.cct;
+  std::lock_guard locker(m_lock);
+  ldout(cct, 5) << "image name: " << m_image_ctx.name << " id: "
+                << m_image_ctx.id << dendl;
+
+  std::string pool_name = m_image_ctx.md_ctx.get_pool_name();
+  m_log_path = m_cache_state->path + "/rbd-ssd." + pool_name + "." +
+               m_image_ctx.id + ".log";
+  m_log_size = p2align(m_cache_state->size, BLOCK_SIZE);
+  ldout(cct, 5) << "log: " << m_log_path << ", size: " << m_log_size << dendl;
+
+  if (!m_cache_state->present &&
+      access(m_log_path.c_str(), F_OK) == 0) {
+    ldout(cct, 5) << "removing the existing log file " << m_log_path
+                  << ", as there is no cache in the image metadata" << dendl;
+    if (remove(m_log_path.c_str()) != 0) {
+      int r = -errno;
+      lderr(cct) << "failed to remove the log file " << m_log_path << ": "
+                 << cpp_strerror(r) << dendl;
+      return r;
+    }
+  }
+
+  bool exists = (access(m_log_path.c_str(), F_OK) == 0);
+  int flags = O_RDWR | O_CREAT | O_DSYNC | O_CLOEXEC;
+  m_fd = ::open(m_log_path.c_str(), flags | O_DIRECT, 0600);
+  if (m_fd < 0 && errno == EINVAL) {
+    ldout(cct, 1) << m_log_path << " does not support O_DIRECT" << dendl;
+    m_fd = ::open(m_log_path.c_str(), flags, 0600);
+  }
+  if (m_fd < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to open " << m_log_path << ": " << cpp_strerror(r)
+               << dendl;
+    return r;
+  }
+
+  int r;
+  if (!exists) {
+    r = ::ftruncate(m_fd, m_log_size);
+    if (r < 0) {
+      r = -errno;
+      lderr(cct) << "failed to size " << m_log_path << ": "
+                 << cpp_strerror(r) << dendl;
+    } else {
+      r = write_super_block(LOG_START, 1);
+    }
+  } else {
+    r = load_log();
+  }
+  if (r < 0) {
+    VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+    m_fd = -1;
+    m_cache_state->present = false;
+    m_cache_state->clean = true;
+    m_cache_state->empty = true;
+    return r;
+  }
+  m_cache_state->present = true;
+  m_cache_state->clean = m_dirty_entries.empty();
+  m_cache_state->empty = m_batches.empty();
+  return 0;
+}
+
+template <typename I>
+void SSDWriteLog<I>::update_image_cache_state(Context *on_finish) {
+  m_cache_state->write_image_cache_state(on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::init(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+  ceph_assert(m_cache_state);
+  ceph_assert(!m_initialized);
+
+  int r = open_log();
+  if (r < 0) {
+    on_finish->complete(r);
+    return;
+  }
+
+  m_initialized = true;
+  m_thread_pool.start();
+  /* write back what was replayed */
+  writeback_dirty_entries();
+  update_image_cache_state(on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::shut_down(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "image name: " << m_image_ctx.name << " id: "
+                << m_image_ctx.id << dendl;
+
+  Context *ctx = new LambdaContext(
+    [this, on_finish](int r) {
+      ldout(m_image_ctx.cct, 6) << "shutdown complete" << dendl;
+      m_image_ctx.op_work_queue->queue(on_finish, r);
+    });
+  ctx = new LambdaContext(
+    [this, ctx](int r) {
+      {
+        std::lock_guard locker(m_lock);
+        ceph_assert(!m_retiring);
+        if (m_fd >= 0) {
+          VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+          m_fd = -1;
+        }
+        if (r < 0) {
+          ldout(m_image_ctx.cct, 5) << "not removing dirty log file: "
+                                    << m_log_path << dendl;
+          m_cache_state->clean = false;
+        } else {
+          ceph_assert(m_dirty_entries.empty());
+          ldout(m_image_ctx.cct, 5) << "removing clean log file: "
+                                    << m_log_path << dendl;
+          if (remove(m_log_path.c_str()) != 0) {
+            lderr(m_image_ctx.cct) << "failed to remove " << m_log_path
+                                   << ": " << cpp_strerror(-errno) << dendl;
+            m_cache_state->clean = true;
+          } else {
+            m_cache_state->present = false;
+            m_cache_state->clean = true;
+            m_cache_state->empty = true;
+          }
+        }
+      }
+      update_image_cache_state(new LambdaContext(
+        [ctx, r](int update_r) {
+          ctx->complete(r < 0 ? r : update_r);
+        }));
+    });
+  ctx = new LambdaContext(
+    [this, ctx](int r) {
+      ldout(m_image_ctx.cct, 6) << "waiting for retire" << dendl;
+      {
+        std::lock_guard locker(m_lock);
+        if (m_retiring) {
+          m_retire_waiters.push_back(new LambdaContext(
+            [ctx, r](int) {
+              ctx->complete(r);
+            }));
+          return;
+        }
+      }
+      ctx->complete(r);
+    });
+  ldout(cct, 6) << "internal_flush in shutdown" << dendl;
+  internal_flush(ctx);
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_read(Extents&& image_extents, ceph::bufferlist* bl,
+                              int fadvise_flags, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+  ceph_assert(m_initialized);
+  bl->clear();
+
+  /*
+   * As ReplicatedWriteLog does, split the read into the hits, which are
+   * read from the log here, and the misses, which are passed to the image
+   * in one read. Entries are not retired while the reader lock is held.
+   */
+  auto read_ctx = new C_ReadRequest(cct, bl, on_finish);
+  int r = 0;
+  for (auto &extent : image_extents) {
+    uint64_t extent_offset = 0;
+    std::shared_lock entry_reader_locker(m_entry_reader_lock);
+    auto map_entries = m_blocks_to_log_entries.find_map_entries(
+      block_extent(extent));
+    for (auto &map_entry : map_entries) {
+      uint64_t hit_start = std::max(map_entry.block_extent.block_start,
+                                    extent.first + extent_offset);
+      if (hit_start > extent.first + extent_offset) {
+        Extent miss_extent(extent.first + extent_offset,
+                           hit_start - (extent.first + extent_offset));
+        read_ctx->miss_extents.push_back(miss_extent);
+        read_ctx->read_extents.push_back({miss_extent, false, {}});
+        extent_offset += miss_extent.second;
+      }
+      uint64_t hit_length = std::min(map_entry.block_extent.block_end,
+                                     extent.first + extent.second) - hit_start;
+      auto &log_entry = map_entry.log_entry;
+      uint64_t data_offset = log_entry->log_offset + hit_start -
+                             log_entry->desc.image_offset_bytes;
+      uint64_t read_offset = p2align(data_offset, BLOCK_SIZE);
+      bufferlist read_bl;
+      r = read_log(read_offset,
+                   round_up_to_block(data_offset + hit_length) - read_offset,
+                   &read_bl);
+      if (r < 0) {
+        break;
+      }
+      bufferlist hit_bl;
+      hit_bl.substr_of(read_bl, data_offset - read_offset, hit_length);
+      read_ctx->read_extents.push_back({{hit_start, hit_length}, true,
+                                        std::move(hit_bl)});
+      extent_offset += hit_length;
+    }
+    if (r < 0) {
+      break;
+    }
+    if (extent.second > extent_offset) {
+      Extent miss_extent(extent.first + extent_offset,
+                         extent.second - extent_offset);
+      read_ctx->miss_extents.push_back(miss_extent);
+      read_ctx->read_extents.push_back({miss_extent, false, {}});
+    }
+  }
+
+  ldout(cct, 20) << "miss_extents=" << read_ctx->miss_extents << dendl;
+  if (r < 0 || read_ctx->miss_extents.empty()) {
+    read_ctx->complete(r);
+  } else {
+    m_image_writeback.aio_read(std::move(read_ctx->miss_extents),
+                               &read_ctx->miss_bl, fadvise_flags, read_ctx);
+  }
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_write(Extents &&image_extents,
+                               bufferlist&& bl,
+                               int fadvise_flags,
+                               Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+  ceph_assert(m_initialized);
+
+  if (bl.length() > m_log_size / 4) {
+    /* would take too much of the log */
+    uint64_t start = UINT64_MAX;
+    uint64_t end = 0;
+    for (auto &extent : image_extents) {
+      start = std::min(start, extent.first);
+      end = std::max(end, extent.first + extent.second);
+    }
+    write_through(
+      BlockExtent(start, end), on_finish,
+      [this, image_extents=std::move(image_extents), bl=std::move(bl),
+       fadvise_flags](Context *ctx) mutable {
+        m_image_writeback.aio_write(std::move(image_extents), std::move(bl),
+                                    fadvise_flags, ctx);
+      });
+    return;
+  }
+
+  uint64_t sync_gen_number;
+  {
+    std::lock_guard locker(m_lock);
+    sync_gen_number = m_current_sync_gen;
+  }
+  C_Gather *gather_ctx = new C_Gather(cct, on_finish);
+  uint64_t bl_offset = 0;
+  for (auto &extent : image_extents) {
+    if (extent.second == 0) {
+      continue;
+    }
+    PendingOp op{extent, {}, sync_gen_number, gather_ctx->new_sub()};
+    op.bl.substr_of(bl, bl_offset, extent.second);
+    bl_offset += extent.second;
+    queue_op(std::move(op));
+  }
+  gather_ctx->activate();
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_discard(uint64_t offset, uint64_t length,
+                                 uint32_t discard_granularity_bytes,
+                                 Context *on_finish) {
+  ldout(m_image_ctx.cct, 20) << offset << "~" << length << dendl;
+  ceph_assert(m_initialized);
+  write_through(
+    BlockExtent(offset, offset + length), on_finish,
+    [this, offset, length, discard_granularity_bytes](Context *ctx) {
+      m_image_writeback.aio_discard(offset, length, discard_granularity_bytes,
+                                    ctx);
+    });
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_flush(io::FlushSource flush_source,
+                               Context *on_finish) {
+  ldout(m_image_ctx.cct, 20) << "flush_source=" << flush_source << dendl;
+  ceph_assert(m_initialized);
+
+  if (flush_source != io::FLUSH_SOURCE_USER) {
+    internal_flush(on_finish);
+    return;
+  }
+
+  /* The writes before the flush are persisted once they are appended. The
+   * writes after it are in the next sync gen, which is written back to the
+   * image after this one is. */
+  uint64_t sync_gen_number;
+  {
+    std::lock_guard locker(m_lock);
+    sync_gen_number = m_current_sync_gen++;
+  }
+  queue_op({{0, 0}, {}, sync_gen_number, on_finish});
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_writesame(uint64_t offset, uint64_t length,
+                                   bufferlist&& bl, int fadvise_flags,
+                                   Context *on_finish) {
+  ldout(m_image_ctx.cct, 20) << offset << "~" << length << dendl;
+  ceph_assert(m_initialized);
+  write_through(
+    BlockExtent(offset, offset + length), on_finish,
+    [this, offset, length, bl=std::move(bl), fadvise_flags](Context *ctx) mutable {
+      m_image_writeback.aio_writesame(offset, length, std::move(bl),
+                                      fadvise_flags, ctx);
+    });
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_compare_and_write(Extents &&image_extents,
+                                           bufferlist&& cmp_bl,
+                                           bufferlist&& bl,
+                                           uint64_t *mismatch_offset,
+                                           int fadvise_flags,
+                                           Context *on_finish) {
+  ldout(m_image_ctx.cct, 20) << "image_extents=" << image_extents << dendl;
+  ceph_assert(m_initialized);
+  uint64_t start = UINT64_MAX;
+  uint64_t end = 0;
+  for (auto &extent : image_extents) {
+    start = std::min(start, extent.first);
+    end = std::max(end, extent.first + extent.second);
+  }
+  write_through(
+    BlockExtent(start, end), on_finish,
+    [this, image_extents=std::move(image_extents), cmp_bl=std::move(cmp_bl),
+     bl=std::move(bl), mismatch_offset, fadvise_flags](Context *ctx) mutable {
+      m_image_writeback.aio_compare_and_write(
+        std::move(image_extents), std::move(cmp_bl), std::move(bl),
+        mismatch_offset, fadvise_flags, ctx);
+    });
+}
+
+template <typename I>
+void SSDWriteLog<I>::invalidate(Context *on_finish) {
+  ldout(m_image_ctx.cct, 20) << dendl;
+  internal_flush(new LambdaContext(
+    [this, on_finish](int r) {
+      if (r >= 0) {
+        remove_flushed_entries(BlockExtent(0, UINT64_MAX));
+      }
+      on_finish->complete(r);
+    }));
+}
+
+template <typename I>
+void SSDWriteLog<I>::flush(Context *on_finish) {
+  internal_flush(on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::queue_op(PendingOp &&op) {
+  {
+    std::lock_guard locker(m_lock);
+    m_ops_to_append.push_back(std::move(op));
+    if (m_appending) {
+      return;
+    }
+    m_appending = true;
+  }
+  schedule_append();
+}
+
+template <typename I>
+void SSDWriteLog<I>::schedule_append() {
+  m_work_queue.queue(new LambdaContext(
+    [this](int r) {
+      append_ops();
+    }), 0);
+}
+
+template <typename I>
+bool SSDWriteLog<I>::alloc_log_space(uint64_t length, uint64_t *offset) {
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+  if (m_batches.empty()) {
+    *offset = (m_first_free_offset + length <= m_log_size) ?
+      m_first_free_offset : LOG_START;
+    m_first_valid_offset = *offset;
+  } else if (m_first_free_offset >= m_first_valid_offset) {
+    if (m_first_free_offset + length <= m_log_size) {
+      *offset = m_first_free_offset;
+    } else if (LOG_START + length < m_first_valid_offset) {
+      /* wrap around */
+      *offset = LOG_START;
+    } else {
+      return false;
+    }
+  } else if (m_first_free_offset + length < m_first_valid_offset) {
+    *offset = m_first_free_offset;
+  } else {
+    return false;
+  }
+  m_first_free_offset = *offset + length;
+  return true;
+}
+
+template <typename I>
+void SSDWriteLog<I>::append_ops() {
+  CephContext *cct = m_image_ctx.cct;
+  std::list<PendingOp> ops;
+  WriteLogEntries log_entries;
+  LogBatchHeader header;
+  uint64_t offset = 0;
+  uint64_t prev_first_free_offset;
+  int r = 0;
+  {
+    std::lock_guard locker(m_lock);
+    ceph_assert(m_appending);
+    if (m_ops_to_append.empty()) {
+      m_appending = false;
+      return;
+    }
+
+    /* Take the ops for one batch. Flushes take no space in it. */
+    uint64_t length = BLOCK_SIZE;
+    unsigned writes = 0;
+    auto it = m_ops_to_append.begin();
+    for (; it != m_ops_to_append.end(); ++it) {
+      if (it->bl.length() == 0) {
+        continue;
+      }
+      uint64_t op_length = round_up_to_block(it->bl.length());
+      if (writes > 0 && (writes == MAX_ENTRIES_PER_BATCH ||
+                         length + op_length > MAX_BYTES_PER_BATCH)) {
+        break;
+      }
+      length += op_length;
+      ++writes;
+    }
+
+    prev_first_free_offset = m_first_free_offset;
+    if (writes > 0 && !alloc_log_space(length, &offset)) {
+      if (m_writeback_error == 0) {
+        /* retire_batches() appends them once there is space */
+        ldout(cct, 20) << "waiting for " << length << " bytes of log space"
+                       << dendl;
+        m_append_waiting_for_space = true;
+        writes = 0;
+        it = m_ops_to_append.begin();
+      } else {
+        /* nothing is retired until the writeback is retried */
+        r = m_writeback_error;
+        writes = 0;
+      }
+    }
+    ops.splice(ops.end(), m_ops_to_append, m_ops_to_append.begin(), it);
+
+    if (writes > 0) {
+      header.seq = m_next_seq++;
+      header.length = length;
+      uint64_t log_offset = offset + BLOCK_SIZE;
+      for (auto &op : ops) {
+        if (op.bl.length() == 0) {
+          continue;
+        }
+        header.entries.emplace_back(op.extent.first, op.extent.second,
+                                    op.sync_gen_number);
+        log_entries.push_back(std::make_shared<WriteLogEntry>(
+          header.entries.back(), log_offset, header.seq));
+        log_offset += round_up_to_block(op.bl.length());
+      }
+      /* retire stops at the batch until its entries are flushed */
+      m_batches[header.seq] = {offset, length, log_entries, writes};
+    }
+  }
+
+  if (!log_entries.empty()) {
+    bufferlist data_bl;
+    for (auto &op : ops) {
+      if (op.bl.length() == 0) {
+        continue;
+      }
+      data_bl.append(op.bl);
+      data_bl.append_zero(round_up_to_block(op.bl.length()) - op.bl.length());
+    }
+    header.data_crc = data_bl.crc32c(0);
+    bufferlist bl;
+    encode_block(header, bl);
+    bl.claim_append(data_bl);
+    ldout(cct, 20) << "appending batch seq=" << header.seq << " of "
+                   << ops.size() << " ops at " << offset << "~"
+                   << bl.length() << dendl;
+    r = write_log(offset, bl);
+    if (r >= 0) {
+      /* before writeback can retire them */
+      m_blocks_to_log_entries.add_log_entries(log_entries);
+    }
+
+    std::lock_guard locker(m_lock);
+    if (r < 0) {
+      m_batches.erase(header.seq);
+      m_first_free_offset = prev_first_free_offset;
+      m_next_seq = header.seq;
+      m_first_valid_offset = m_batches.empty() ?
+        m_first_free_offset : m_batches.begin()->second.offset;
+    } else {
+      m_dirty_entries.insert(m_dirty_entries.end(), log_entries.begin(),
+                             log_entries.end());
+    }
+  }
+
+  for (auto &op : ops) {
+    op.on_finish->complete(r);
+  }
+
+  bool more_ops;
+  {
+    std::lock_guard locker(m_lock);
+    more_ops = !m_append_waiting_for_space && !m_ops_to_append.empty();
+    if (!more_ops && !m_append_waiting_for_space) {
+      m_appending = false;
+    }
+  }
+  if (more_ops) {
+    schedule_append();
+  }
+  writeback_dirty_entries();
+}
+
+template <typename I>
+void SSDWriteLog<I>::writeback_dirty_entries() {
+  WriteLogEntries to_writeback;
+  WriteLogEntries to_flush;
+  {
+    std::lock_guard locker(m_lock);
+    /* A write through is not overtaken by the writeback of later writes */
+    while (!m_dirty_entries.empty() && m_writeback_ops < MAX_WRITEBACK_OPS &&
+           m_writeback_error == 0 && m_write_through_ops == 0) {
+      auto log_entry = m_dirty_entries.front();
+      uint64_t sync_gen_number = log_entry->desc.sync_gen_number;
+      if (sync_gen_number != m_writeback_sync_gen) {
+        /* the image is flushed before the next sync gen is written back */
+        if (m_writeback_ops > 0 || m_writeback_flushing ||
+            !m_written_back_entries.empty()) {
+          break;
+        }
+        m_writeback_sync_gen = sync_gen_number;
+      }
+      if (m_writeback_extents.intersects(log_entry->desc.image_offset_bytes,
+                                         log_entry->desc.write_bytes)) {
+        /* overlapping writes are written back in order */
+        break;
+      }
+      m_writeback_extents.insert(log_entry->desc.image_offset_bytes,
+                                 log_entry->desc.write_bytes);
+      ++m_writeback_ops;
+      m_dirty_entries.pop_front();
+      to_writeback.push_back(log_entry);
+    }
+    if (!m_writeback_flushing && !m_written_back_entries.empty() &&
+        (m_writeback_ops == 0 ||
+         m_written_back_entries.size() >= MAX_WRITEBACK_OPS)) {
+      m_writeback_flushing = true;
+      to_flush.swap(m_written_back_entries);
+    }
+  }
+
+  if (!to_writeback.empty()) {
+    /* off the caller's thread, as the data is read from the log */
+    m_work_queue.queue(new LambdaContext(
+      [this, to_writeback=std::move(to_writeback)](int r) {
+        for (auto &log_entry : to_writeback) {
+          writeback_entry(log_entry);
+        }
+      }), 0);
+  }
+  if (!to_flush.empty()) {
+    ldout(m_image_ctx.cct, 20) << "flushing " << to_flush.size()
+                               << " written back entries" << dendl;
+    m_image_writeback.aio_flush(io::FLUSH_SOURCE_WRITEBACK, new LambdaContext(
+      [this, to_flush=std::move(to_flush)](int r) mutable {
+        handle_writeback_flush(std::move(to_flush), r);
+      }));
+  }
+}
+
+template <typename I>
+void SSDWriteLog<I>::writeback_entry(std::shared_ptr<WriteLogEntry> log_entry) {
+  ldout(m_image_ctx.cct, 20) << "log_entry=[" << *log_entry << "]" << dendl;
+  bufferlist read_bl;
+  int r = read_log(log_entry->log_offset,
+                   round_up_to_block(log_entry->desc.write_bytes), &read_bl);
+  if (r < 0) {
+    handle_writeback(log_entry, r);
+    return;
+  }
+  bufferlist bl;
+  bl.substr_of(read_bl, 0, log_entry->desc.write_bytes);
+  m_image_writeback.aio_write(
+    {{log_entry->desc.image_offset_bytes, log_entry->desc.write_bytes}},
+    std::move(bl), 0, new LambdaContext(
+      [this, log_entry](int r) {
+        handle_writeback(log_entry, r);
+      }));
+}
+
+template <typename I>
+void SSDWriteLog<I>::handle_writeback(std::shared_ptr<WriteLogEntry> log_entry,
+                                      int r) {
+  bool append = false;
+  {
+    std::lock_guard locker(m_lock);
+    ceph_assert(m_writeback_ops > 0);
+    --m_writeback_ops;
+    m_writeback_extents.erase(log_entry->desc.image_offset_bytes,
+                              log_entry->desc.write_bytes);
+    if (r < 0) {
+      lderr(m_image_ctx.cct) << "failed to write back log_entry=["
+                             << *log_entry << "]: " << cpp_strerror(r)
+                             << dendl;
+      /* retried by the next flush */
+      m_dirty_entries.push_front(log_entry);
+      if (m_writeback_error == 0) {
+        m_writeback_error = r;
+      }
+      /* fail the appends waiting for space */
+      append = m_append_waiting_for_space;
+      m_append_waiting_for_space = false;
+    } else {
+      m_written_back_entries.push_back(log_entry);
+    }
+  }
+  if (append) {
+    schedule_append();
+  }
+  writeback_dirty_entries();
+  complete_flush_waiters();
+}
+
+template <typename I>
+void SSDWriteLog<I>::handle_writeback_flush(WriteLogEntries &&log_entries,
+                                            int r) {
+  ldout(m_image_ctx.cct, 20) << "r=" << r << dendl;
+  bool retire = false;
+  {
+    std::lock_guard locker(m_lock);
+    m_writeback_flushing = false;
+    if (r < 0) {
+      lderr(m_image_ctx.cct) << "failed to flush the written back entries: "
+                             << cpp_strerror(r) << dendl;
+      m_dirty_entries.splice(m_dirty_entries.begin(), log_entries);
+      if (m_writeback_error == 0) {
+        m_writeback_error = r;
+      }
+    } else {
+      for (auto &log_entry : log_entries) {
+        log_entry->flushed = true;
+        auto &batch = m_batches.at(log_entry->batch_seq);
+        ceph_assert(batch.dirty_entries > 0);
+        if (--batch.dirty_entries == 0) {
+          retire = true;
+        }
+      }
+    }
+  }
+  if (retire) {
+    schedule_retire();
+  }
+  writeback_dirty_entries();
+  complete_flush_waiters();
+}
+
+template <typename I>
+void SSDWriteLog<I>::schedule_retire() {
+  {
+    std::lock_guard locker(m_lock);
+    if (m_retiring || m_fd < 0 || m_batches.empty() ||
+        m_batches.begin()->second.dirty_entries > 0) {
+      return;
+    }
+    m_retiring = true;
+  }
+  m_work_queue.queue(new LambdaContext(
+    [this](int r) {
+      retire_batches();
+    }), 0);
+}
+
+template <typename I>
+void SSDWriteLog<I>::retire_batches() {
+  CephContext *cct = m_image_ctx.cct;
+  WriteLogEntries log_entries;
+  unsigned retired_batches = 0;
+  uint64_t first_valid_offset;
+  uint64_t first_valid_seq;
+  {
+    std::lock_guard locker(m_lock);
+    ceph_assert(m_retiring);
+    auto it = m_batches.begin();
+    for (; it != m_batches.end() && it->second.dirty_entries == 0; ++it) {
+      log_entries.insert(log_entries.end(), it->second.entries.begin(),
+                         it->second.entries.end());
+      ++retired_batches;
+    }
+    if (it == m_batches.end()) {
+      /* where the next batch goes, or the start of the ring */
+      first_valid_offset = m_first_free_offset;
+      first_valid_seq = m_next_seq;
+    } else {
+      first_valid_offset = it->second.offset;
+      first_valid_seq = it->first;
+    }
+  }
+  ldout(cct, 20) << "retiring " << retired_batches << " batches" << dendl;
+
+  {
+    std::unique_lock entry_reader_locker(m_entry_reader_lock);
+    m_blocks_to_log_entries.remove_log_entries(log_entries);
+  }
+
+  /* The space of the batches is reused once the super block no longer
+   * refers to them */
+  int r = write_super_block(first_valid_offset, first_valid_seq);
+
+  Contexts retire_waiters;
+  bool append = false;
+  {
+    std::lock_guard locker(m_lock);
+    if (r >= 0) {
+      for (unsigned i = 0; i < retired_batches; ++i) {
+        m_batches.erase(m_batches.begin());
+      }
+      m_first_valid_offset = m_batches.empty() ?
+        m_first_free_offset : m_batches.begin()->second.offset;
+      append = m_append_waiting_for_space;
+      m_append_waiting_for_space = false;
+    }
+    m_retiring = false;
+    retire_waiters.swap(m_retire_waiters);
+  }
+  if (append) {
+    schedule_append();
+  }
+  for (auto ctx : retire_waiters) {
+    ctx->complete(r);
+  }
+  if (r >= 0) {
+    schedule_retire();
+  }
+}
+
+template <typename I>
+void SSDWriteLog<I>::complete_flush_waiters() {
+  Contexts flush_waiters;
+  int r;
+  {
+    std::lock_guard locker(m_lock);
+    if (m_flush_waiters.empty() || m_writeback_ops > 0 ||
+        m_writeback_flushing || !m_written_back_entries.empty() ||
+        (!m_dirty_entries.empty() && m_writeback_error == 0)) {
+      return;
+    }
+    r = m_writeback_error;
+    flush_waiters.swap(m_flush_waiters);
+  }
+  for (auto ctx : flush_waiters) {
+    ctx->complete(r);
+  }
+}
+
+template <typename I>
+void SSDWriteLog<I>::internal_flush(Context *on_finish) {
+  ldout(m_image_ctx.cct, 20) << dendl;
+  Context *ctx = new LambdaContext(
+    [this, on_finish](int r) {
+      if (r < 0) {
+        on_finish->complete(r);
+        return;
+      }
+      m_image_writeback.aio_flush(io::FLUSH_SOURCE_WRITEBACK, on_finish);
+    });
+
+  /* once the writes before it are appended, wait for their writeback */
+  uint64_t sync_gen_number;
+  {
+    std::lock_guard locker(m_lock);
+    sync_gen_number = m_current_sync_gen;
+  }
+  queue_op({{0, 0}, {}, sync_gen_number, new LambdaContext(
+    [this, ctx](int r) {
+      if (r < 0) {
+        ctx->complete(r);
+        return;
+      }
+      {
+        std::lock_guard locker(m_lock);
+        /* retry a failed writeback */
+        m_writeback_error = 0;
+        m_flush_waiters.push_back(ctx);
+      }
+      writeback_dirty_entries();
+      complete_flush_waiters();
+    })});
+}
+
+template <typename I>
+void SSDWriteLog<I>::remove_flushed_entries(const BlockExtent &block_extent) {
+  auto log_entries = m_blocks_to_log_entries.find_log_entries(block_extent);
+  WriteLogEntries flushed_entries;
+  {
+    std::lock_guard locker(m_lock);
+    for (auto &log_entry : log_entries) {
+      if (log_entry->flushed) {
+        flushed_entries.push_back(log_entry);
+      }
+    }
+  }
+  m_blocks_to_log_entries.remove_log_entries(flushed_entries);
+}
+
+template <typename I>
+void SSDWriteLog<I>::write_through(const BlockExtent &block_extent,
+                                   Context *on_finish,
+                                   std::function<void(Context*)> &&write) {
+  ldout(m_image_ctx.cct, 20) << "block_extent=" << block_extent << dendl;
+  internal_flush(new LambdaContext(
+    [this, block_extent, on_finish, write=std::move(write)](int r) {
+      if (r < 0) {
+        on_finish->complete(r);
+        return;
+      }
+      /* the image has the data of the entries now, and will have newer */
+      remove_flushed_entries(block_extent);
+      {
+        std::lock_guard locker(m_lock);
+        ++m_write_through_ops;
+      }
+      write(new LambdaContext(
+        [this, on_finish](int r) {
+          {
+            std::lock_guard locker(m_lock);
+            --m_write_through_ops;
+          }
+          writeback_dirty_entries();
+          on_finish->complete(r);
+        }));
+    }));
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::SSDWriteLog<librbd::ImageCtx>;
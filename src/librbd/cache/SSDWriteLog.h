@@ -0,0 +1,185 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_SSD_WRITE_LOG
+#define CEPH_LIBRBD_CACHE_SSD_WRITE_LOG
+
+#include "common/ceph_mutex.h"
+#include "common/WorkQueue.h"
+#include "include/buffer.h"
+#include "include/interval_set.h"
+#include "librbd/cache/ImageCache.h"
+#include "librbd/cache/ImageWriteback.h"
+#include "librbd/cache/Types.h"
+#include "librbd/cache/rwl/LogMap.h"
+#include "librbd/cache/ssd/LogEntry.h"
+#include <atomic>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+
+class Context;
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace cache {
+
+namespace rwl {
+template <typename> class ImageCacheState;
+} // namespace rwl
+
+/**
+ * A persistent write back cache in a log file on a local SSD.
+ *
+ * Writes are appended to the log in batches, with a single block aligned
+ * write of the batch header and data each, and complete once the batch is
+ * persisted. They are written back to the image in log order, sync point
+ * by sync point -- a user flush starts a new sync generation -- and the
+ * batches written back are retired from the tail of the log ring, which
+ * the super block records. Init replays the batches from there, so writes
+ * which completed are written back after a crash.
+ *
+ * Discards, write sames, compare and writes, and writes too large for the
+ * log are written through, once the log is written back.
+ */
+template <typename ImageCtxT>
+class SSDWriteLog : public ImageCache<ImageCtxT> {
+public:
+  using typename ImageCache<ImageCtxT>::Extent;
+  using typename ImageCache<ImageCtxT>::Extents;
+
+  SSDWriteLog(ImageCtxT &image_ctx,
+              librbd::cache::rwl::ImageCacheState<ImageCtxT>* cache_state);
+  ~SSDWriteLog();
+  SSDWriteLog(const SSDWriteLog&) = delete;
+  SSDWriteLog &operator=(const SSDWriteLog&) = delete;
+
+  /// client AIO methods
+  void aio_read(Extents&& image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) override;
+  void aio_write(Extents&& image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) override;
+  void aio_discard(uint64_t offset, uint64_t length,
+                   uint32_t discard_granularity_bytes,
+                   Context *on_finish) override;
+  void aio_flush(io::FlushSource flush_source, Context *on_finish) override;
+  void aio_writesame(uint64_t offset, uint64_t length,
+                     ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) override;
+  void aio_compare_and_write(Extents&& image_extents,
+                             ceph::bufferlist&& cmp_bl, ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset,int fadvise_flags,
+                             Context *on_finish) override;
+
+  /// internal state methods
+  void init(Context *on_finish) override;
+  void shut_down(Context *on_finish) override;
+  void invalidate(Context *on_finish) override;
+  void flush(Context *on_finish) override;
+
+private:
+  typedef rwl::LogMap<ssd::WriteLogEntry> WriteLogMap;
+
+  /* A write waiting to be appended, or a flush if it has no data */
+  struct PendingOp {
+    Extent extent;
+    ceph::bufferlist bl;
+    uint64_t sync_gen_number;
+    Context *on_finish;
+  };
+
+  /* The write ops appended together, which are retired together */
+  struct LogBatch {
+    uint64_t offset;
+    uint64_t length;
+    ssd::WriteLogEntries entries;
+    unsigned dirty_entries;
+  };
+
+  ImageCtxT &m_image_ctx;
+  librbd::cache::rwl::ImageCacheState<ImageCtxT>* m_cache_state = nullptr;
+  ImageWriteback<ImageCtxT> m_image_writeback;
+
+  std::atomic<bool> m_initialized = {false};
+  std::string m_log_path;
+  int m_fd = -1;
+  uint64_t m_log_size = 0;
+
+  /* Hold a read lock on m_entry_reader_lock to find log entries in the map
+   * and read their data. Hold a write lock to remove the entries of retired
+   * batches from the map, before their space is reused. */
+  mutable ceph::shared_mutex m_entry_reader_lock;
+  /* Used for all of the following */
+  mutable ceph::mutex m_lock;
+
+  std::list<PendingOp> m_ops_to_append;
+  bool m_appending = false;
+  bool m_append_waiting_for_space = false;
+  uint64_t m_current_sync_gen = 0;
+
+  /* The log ring is empty when it has no batch; otherwise batches are in
+   * [m_first_valid_offset, m_first_free_offset), which may wrap around */
+  uint64_t m_first_valid_offset = ssd::LOG_START;
+  uint64_t m_first_free_offset = ssd::LOG_START;
+  uint64_t m_next_seq = 1;
+  std::map<uint64_t, LogBatch> m_batches;   /* by sequence number */
+  bool m_retiring = false;
+  Contexts m_retire_waiters;
+
+  /* Entries are dirty until they are written back, and then flushed once
+   * the image is flushed after that */
+  ssd::WriteLogEntries m_dirty_entries;     /* oldest first */
+  ssd::WriteLogEntries m_written_back_entries;
+  unsigned m_writeback_ops = 0;
+  bool m_writeback_flushing = false;
+  uint64_t m_writeback_sync_gen = 0;
+  interval_set<uint64_t> m_writeback_extents;
+  int m_writeback_error = 0;
+  unsigned m_write_through_ops = 0;
+  Contexts m_flush_waiters;
+
+  WriteLogMap m_blocks_to_log_entries;
+
+  ThreadPool m_thread_pool;
+  ContextWQ m_work_queue;
+
+  int open_log();
+  int load_log();
+  int read_batch(uint64_t offset, uint64_t seq, ssd::LogBatchHeader *header);
+  void add_batch(uint64_t seq, uint64_t offset,
+                 const ssd::LogBatchHeader &header);
+  int write_super_block(uint64_t first_valid_offset,
+                        uint64_t first_valid_seq);
+  int read_log(uint64_t offset, uint64_t length, ceph::bufferlist *bl);
+  int write_log(uint64_t offset, ceph::bufferlist &bl);
+  void update_image_cache_state(Context *on_finish);
+
+  void queue_op(PendingOp &&op);
+  void schedule_append();
+  bool alloc_log_space(uint64_t length, uint64_t *offset);
+  void append_ops();
+
+  void writeback_dirty_entries();
+  void writeback_entry(std::shared_ptr<ssd::WriteLogEntry> log_entry);
+  void handle_writeback(std::shared_ptr<ssd::WriteLogEntry> log_entry,
+                        int r);
+  void handle_writeback_flush(ssd::WriteLogEntries &&log_entries, int r);
+  void schedule_retire();
+  void retire_batches();
+
+  void complete_flush_waiters();
+  void internal_flush(Context *on_finish);
+  void remove_flushed_entries(const BlockExtent &block_extent);
+  void write_through(const BlockExtent &block_extent, Context *on_finish,
+                     std::function<void(Context*)> &&write);
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::SSDWriteLog<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_SSD_WRITE_LOG
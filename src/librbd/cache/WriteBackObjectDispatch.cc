@@ -0,0 +1,740 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/cache/WriteBackObjectDispatch.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/WorkQueue.h"
+#include "include/stringify.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/Utils.h"
+#include "librbd/io/ObjectDispatchSpec.h"
+#include "librbd/io/ObjectDispatcher.h"
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::cache::WriteBackObjectDispatch: " \
+                           << this << " " << __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+using librbd::util::data_object_name;
+
+template <typename I>
+WriteBackObjectDispatch<I>::WriteBackObjectDispatch(
+    I* image_ctx, size_t max_dirty, bool writethrough_until_flush)
+  : m_image_ctx(image_ctx), m_max_dirty(max_dirty),
+    m_writethrough_until_flush(writethrough_until_flush) {
+  for (size_t i = 0; i < SHARDS; ++i) {
+    m_shards.emplace_back(new Shard(util::unique_lock_name(
+      "librbd::cache::WriteBackObjectDispatch::shard_lock " + stringify(i),
+      this)));
+  }
+}
+
+template <typename I>
+WriteBackObjectDispatch<I>::~WriteBackObjectDispatch() {
+  ceph_assert(m_dirty_bytes == 0);
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::init() {
+  auto cct = m_image_ctx->cct;
+
+  m_cache_size = m_image_ctx->config.template get_val<Option::size_t>(
+    "rbd_cache_size");
+  m_target_dirty = m_image_ctx->config.template get_val<Option::size_t>(
+    "rbd_cache_target_dirty");
+  m_max_dirty_age = m_image_ctx->config.template get_val<double>(
+    "rbd_cache_max_dirty_age");
+  m_last_age_scan = ceph::coarse_mono_clock::now();
+
+  ldout(cct, 5) << "size=" << m_cache_size << ", "
+                << "max_dirty=" << m_max_dirty << ", "
+                << "target_dirty=" << m_target_dirty << ", "
+                << "max_dirty_age=" << m_max_dirty_age << dendl;
+
+  // add ourself to the IO object dispatcher chain
+  if (m_max_dirty > 0) {
+    m_image_ctx->disable_zero_copy = true;
+  }
+  m_image_ctx->io_object_dispatcher->register_object_dispatch(this);
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::shut_down(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  // flush all pending writeback state
+  flush_all(util::create_async_context_callback(*m_image_ctx, on_finish));
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::read(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    librados::snap_t snap_id, int op_flags, const ZTracer::Trace &parent_trace,
+    ceph::bufferlist* read_data, io::ExtentMap* extent_map,
+    int* object_dispatch_flags, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  // writes are only cached in the head revision
+  if (snap_id != CEPH_NOSNAP || object_len == 0) {
+    return false;
+  }
+
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "object_no=" << object_no << " " << object_off << "~"
+                 << object_len << dendl;
+
+  auto& shard = get_shard(object_no);
+  bool dirty_overlap = false;
+  uint64_t gen;
+  {
+    std::shared_lock locker{shard.lock};
+    auto it = shard.objects.find(object_no);
+    if (it != shard.objects.end()) {
+      auto& object = it->second;
+      if (read_extents(object, object_off, object_len, read_data)) {
+        object.referenced = true;
+        locker.unlock();
+        ldout(cct, 20) << "cache hit" << dendl;
+
+        *dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+        on_dispatched = util::create_async_context_callback(*m_image_ctx,
+                                                            on_dispatched);
+        on_dispatched->complete(0);
+        return true;
+      }
+      dirty_overlap = (overlaps(object.dirty, object_off, object_len) ||
+                       overlaps(object.flushing, object_off, object_len));
+    }
+    gen = shard.gen;
+  }
+
+  if (dirty_overlap) {
+    // the object is read once the dirty data is written back
+    Writebacks writebacks;
+    bool waiting = false;
+    {
+      std::unique_lock locker{shard.lock};
+      auto it = shard.objects.find(object_no);
+      if (it != shard.objects.end()) {
+        waiting = wait_for_writeback(object_no, &it->second, object_off,
+                                     object_len, on_dispatched, &writebacks);
+      }
+      gen = shard.gen;
+    }
+    send_writebacks(std::move(writebacks));
+
+    if (waiting) {
+      ldout(cct, 20) << "waiting for writeback" << dendl;
+      *dispatch_result = io::DISPATCH_RESULT_CONTINUE;
+      return true;
+    }
+  }
+
+  *on_finish = new LambdaContext(
+    [this, object_no, object_off, object_len, gen, read_data, extent_map,
+     on_finish=*on_finish](int r) {
+      handle_read(object_no, object_off, object_len, gen, r, read_data,
+                  extent_map);
+      on_finish->complete(r);
+    });
+  return false;
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::discard(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    const ::SnapContext &snapc, int discard_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "object_no=" << object_no << " " << object_off << "~"
+                 << object_len << dendl;
+
+  return write_through(object_no, object_off, object_len, dispatch_result,
+                       on_dispatched);
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::write(
+    uint64_t object_no, uint64_t object_off, ceph::bufferlist&& data,
+    const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  uint64_t object_len = data.length();
+  ldout(cct, 20) << "object_no=" << object_no << " " << object_off << "~"
+                 << object_len << dendl;
+
+  // journaled writes are committed to the journal once written
+  if (*journal_tid != 0 || !writeback_enabled() ||
+      m_dirty_bytes + object_len > m_max_dirty) {
+    return write_through(object_no, object_off, object_len, dispatch_result,
+                         on_dispatched);
+  }
+
+  auto& shard = get_shard(object_no);
+  Writebacks writebacks;
+  {
+    std::unique_lock locker{shard.lock};
+    auto& object = shard.objects[object_no];
+    if (!object.dirty.empty() && object.snapc.seq != snapc.seq) {
+      // the dirty extents are written back with the snapshot context they
+      // were written with
+      locker.unlock();
+      return write_through(object_no, object_off, object_len, dispatch_result,
+                           on_dispatched);
+    }
+
+    if (object.dirty.empty()) {
+      object.dirty_stamp = ceph::coarse_mono_clock::now();
+    }
+    object.snapc = snapc;
+    ++object.dirty_seq;
+    m_dirty_bytes += insert_extent(&object.dirty, object_off, std::move(data));
+    shard.clean_bytes -= erase_extents(&object.clean, object_off, object_len);
+
+    if (m_dirty_bytes > m_target_dirty || m_max_dirty_age <= 0) {
+      start_writeback(object_no, &object, &writebacks);
+    }
+  }
+  send_writebacks(std::move(writebacks));
+  writeback_aged();
+
+  *dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+  on_dispatched = util::create_async_context_callback(*m_image_ctx,
+                                                      on_dispatched);
+  on_dispatched->complete(0);
+  return true;
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::write_same(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    io::LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
+    const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "object_no=" << object_no << " " << object_off << "~"
+                 << object_len << dendl;
+
+  return write_through(object_no, object_off, object_len, dispatch_result,
+                       on_dispatched);
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::compare_and_write(
+    uint64_t object_no, uint64_t object_off, ceph::bufferlist&& cmp_data,
+    ceph::bufferlist&& write_data, const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, uint64_t* mismatch_offset,
+    int* object_dispatch_flags, uint64_t* journal_tid,
+    io::DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "object_no=" << object_no << " " << object_off << "~"
+                 << cmp_data.length() << dendl;
+
+  return write_through(object_no, object_off, cmp_data.length(),
+                       dispatch_result, on_dispatched);
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::flush(
+    io::FlushSource flush_source, const ZTracer::Trace &parent_trace,
+    uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << dendl;
+
+  if (flush_source == io::FLUSH_SOURCE_USER && !m_user_flushed) {
+    m_user_flushed = true;
+    if (m_writethrough_until_flush && m_max_dirty > 0) {
+      ldout(cct, 5) << "saw first user flush, enabling writeback" << dendl;
+    }
+  }
+
+  // the flush is sent once all of the writes before it were written back
+  *dispatch_result = io::DISPATCH_RESULT_CONTINUE;
+  flush_all(util::create_async_context_callback(*m_image_ctx, on_dispatched));
+  return true;
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::invalidate_cache(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  // write back the dirty data before dropping everything cached
+  on_finish = util::create_async_context_callback(*m_image_ctx, on_finish);
+  flush_all(new LambdaContext([this, on_finish](int r) {
+      for (auto& shard : m_shards) {
+        std::unique_lock locker{shard->lock};
+        ++shard->gen;
+        for (auto it = shard->objects.begin(); it != shard->objects.end();) {
+          auto& object = it->second;
+          shard->clean_bytes -= get_length(object.clean);
+          object.clean.clear();
+          if (object.idle()) {
+            it = shard->objects.erase(it);
+          } else {
+            ++it;
+          }
+        }
+      }
+      on_finish->complete(r);
+    }));
+  return true;
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::write_through(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    io::DispatchResult* dispatch_result, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  auto& shard = get_shard(object_no);
+
+  Writebacks writebacks;
+  bool waiting = false;
+  {
+    std::unique_lock locker{shard.lock};
+    ++shard.gen;
+    auto it = shard.objects.find(object_no);
+    if (it == shard.objects.end()) {
+      return false;
+    }
+
+    auto& object = it->second;
+    shard.clean_bytes -= erase_extents(&object.clean, object_off, object_len);
+
+    // the dirty data it overlaps must be written first
+    waiting = wait_for_writeback(object_no, &object, object_off, object_len,
+                                 on_dispatched, &writebacks);
+    if (!waiting && object.idle()) {
+      shard.objects.erase(it);
+    }
+  }
+  send_writebacks(std::move(writebacks));
+
+  if (!waiting) {
+    return false;
+  }
+
+  ldout(cct, 20) << "waiting for writeback" << dendl;
+  *dispatch_result = io::DISPATCH_RESULT_CONTINUE;
+  return true;
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::wait_for_writeback(
+    uint64_t object_no, Object* object, uint64_t object_off,
+    uint64_t object_len, Context* on_ready, Writebacks* writebacks) {
+  ceph_assert(ceph_mutex_is_wlocked(get_shard(object_no).lock));
+  if (!overlaps(object->dirty, object_off, object_len) &&
+      !overlaps(object->flushing, object_off, object_len)) {
+    return false;
+  }
+
+  object->writeback_waiters.emplace_back(object->dirty_seq, on_ready);
+  start_writeback(object_no, object, writebacks);
+  return true;
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::handle_read(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    uint64_t gen, int r, ceph::bufferlist* read_data,
+    io::ExtentMap* extent_map) {
+  if (r < 0 && r != -ENOENT) {
+    return;
+  }
+
+  ceph::bufferlist data;
+  if (r == -ENOENT) {
+    data.append_zero(object_len);
+  } else if (!extent_map->empty()) {
+    uint64_t pos = object_off;
+    uint64_t extents_len = 0;
+    for (auto& [off, len] : *extent_map) {
+      if (off < pos || off + len > object_off + object_len) {
+        return;
+      }
+      pos = off + len;
+      extents_len += len;
+    }
+    if (read_data->length() != extents_len) {
+      return;
+    }
+
+    pos = object_off;
+    auto it = read_data->cbegin();
+    for (auto& [off, len] : *extent_map) {
+      data.append_zero(off - pos);
+      it.copy(len, data);
+      pos = off + len;
+    }
+    data.append_zero(object_off + object_len - pos);
+  } else {
+    if (read_data->length() > object_len) {
+      return;
+    }
+    data = *read_data;
+    data.append_zero(object_len - data.length());
+  }
+
+  auto& shard = get_shard(object_no);
+  std::unique_lock locker{shard.lock};
+  if (shard.gen != gen) {
+    // written through or written back since the read was sent
+    return;
+  }
+
+  auto& object = shard.objects[object_no];
+  shard.clean_bytes += insert_extent(&object.clean, object_off,
+                                     std::move(data));
+  object.referenced = true;
+  evict(&shard);
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::start_writeback(uint64_t object_no,
+                                                 Object* object,
+                                                 Writebacks* writebacks) {
+  ceph_assert(ceph_mutex_is_wlocked(get_shard(object_no).lock));
+  if (object->writeback_in_flight || object->dirty.empty()) {
+    // restarted once the writeback in flight completes
+    return;
+  }
+
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "object_no=" << object_no << ", "
+                 << "extents=" << object->dirty.size() << dendl;
+
+  object->flushing.swap(object->dirty);
+  object->writeback_seq = object->dirty_seq;
+  object->writeback_in_flight = true;
+
+  auto ctx = util::create_async_context_callback(
+    *m_image_ctx, new LambdaContext([this, object_no](int r) {
+      handle_writeback(object_no, r);
+    }));
+  C_GatherBuilder gather(cct, ctx);
+  for (auto& [off, bl] : object->flushing) {
+    auto bl_copy = bl;
+    auto req = io::ObjectDispatchSpec::create_write(
+      m_image_ctx, io::OBJECT_DISPATCH_LAYER_CACHE, object_no, off,
+      std::move(bl_copy), object->snapc, 0, 0, {}, gather.new_sub());
+    req->object_dispatch_flags = io::OBJECT_DISPATCH_FLAG_FLUSH;
+    writebacks->push_back(req);
+  }
+  gather.activate();
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::handle_writeback(uint64_t object_no, int r) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "object_no=" << object_no << ", r=" << r << dendl;
+
+  auto& shard = get_shard(object_no);
+  Writebacks writebacks;
+  std::list<Context*> ready;
+  {
+    std::unique_lock locker{shard.lock};
+    auto it = shard.objects.find(object_no);
+    ceph_assert(it != shard.objects.end());
+    auto& object = it->second;
+    ceph_assert(object.writeback_in_flight);
+
+    // the data written back is newer than the clean data
+    m_dirty_bytes -= get_length(object.flushing);
+    if (r < 0) {
+      lderr(cct) << "failed to write back " << data_object_name(m_image_ctx,
+                                                               object_no)
+                 << ": " << cpp_strerror(r) << dendl;
+      m_writeback_error = r;
+      for (auto& [off, bl] : object.flushing) {
+        shard.clean_bytes -= erase_extents(&object.clean, off, bl.length());
+      }
+    } else {
+      for (auto& [off, bl] : object.flushing) {
+        shard.clean_bytes += insert_extent(&object.clean, off, std::move(bl));
+      }
+    }
+    object.flushing.clear();
+    object.writeback_in_flight = false;
+    object.written_seq = object.writeback_seq;
+    ++shard.gen;
+
+    for (auto waiter_it = object.writeback_waiters.begin();
+         waiter_it != object.writeback_waiters.end();) {
+      if (waiter_it->first <= object.written_seq) {
+        ready.push_back(waiter_it->second);
+        waiter_it = object.writeback_waiters.erase(waiter_it);
+      } else {
+        ++waiter_it;
+      }
+    }
+
+    if (!object.writeback_waiters.empty() ||
+        m_dirty_bytes > m_target_dirty) {
+      start_writeback(object_no, &object, &writebacks);
+    }
+    if (object.idle()) {
+      shard.objects.erase(it);
+    }
+    evict(&shard);
+  }
+  send_writebacks(std::move(writebacks));
+
+  // the waiters are completed from the op work queue and learn of errors
+  // from the flushes
+  for (auto ctx : ready) {
+    ctx->complete(0);
+  }
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::send_writebacks(Writebacks&& writebacks) {
+  for (auto req : writebacks) {
+    req->send();
+  }
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::writeback_aged() {
+  if (m_max_dirty_age <= 0 || m_age_scanning.exchange(true)) {
+    return;
+  }
+
+  auto now = ceph::coarse_mono_clock::now();
+  auto max_dirty_age = ceph::make_timespan(m_max_dirty_age);
+  if (now - m_last_age_scan < max_dirty_age) {
+    m_age_scanning = false;
+    return;
+  }
+  m_last_age_scan = now;
+
+  for (size_t i = 0; i < SHARDS; ++i) {
+    Writebacks writebacks;
+    {
+      auto& shard = *m_shards[i];
+      std::unique_lock locker{shard.lock};
+      for (auto& [object_no, object] : shard.objects) {
+        if (!object.dirty.empty() &&
+            now - object.dirty_stamp >= max_dirty_age) {
+          start_writeback(object_no, &object, &writebacks);
+        }
+      }
+    }
+    send_writebacks(std::move(writebacks));
+  }
+  m_age_scanning = false;
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::flush_all(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+
+  C_GatherBuilder gather(cct);
+  for (size_t i = 0; i < SHARDS; ++i) {
+    Writebacks writebacks;
+    {
+      auto& shard = *m_shards[i];
+      std::unique_lock locker{shard.lock};
+      for (auto& [object_no, object] : shard.objects) {
+        if (!object.dirty.empty() || object.writeback_in_flight) {
+          object.writeback_waiters.emplace_back(object.dirty_seq,
+                                                gather.new_sub());
+          start_writeback(object_no, &object, &writebacks);
+        }
+      }
+    }
+    send_writebacks(std::move(writebacks));
+  }
+
+  auto ctx = new LambdaContext([this, on_finish](int r) {
+      int error = m_writeback_error.exchange(0);
+      on_finish->complete(r < 0 ? r : error);
+    });
+  if (gather.has_subs()) {
+    gather.set_finisher(ctx);
+    gather.activate();
+  } else {
+    ctx->complete(0);
+  }
+}
+
+template <typename I>
+void WriteBackObjectDispatch<I>::evict(Shard* shard) {
+  ceph_assert(ceph_mutex_is_wlocked(shard->lock));
+  uint64_t max_clean_bytes = m_cache_size / SHARDS;
+
+  // objects read or written to since the last pass are kept once more
+  for (int pass = 0; pass < 2 && shard->clean_bytes > max_clean_bytes;
+       ++pass) {
+    for (auto it = shard->objects.begin();
+         it != shard->objects.end() && shard->clean_bytes > max_clean_bytes;) {
+      auto& object = it->second;
+      if (object.referenced.exchange(false)) {
+        ++it;
+        continue;
+      }
+
+      shard->clean_bytes -= get_length(object.clean);
+      object.clean.clear();
+      if (object.idle()) {
+        it = shard->objects.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+template <typename I>
+uint64_t WriteBackObjectDispatch<I>::erase_extents(Extents* extents,
+                                                   uint64_t off,
+                                                   uint64_t len) {
+  uint64_t end = off + len;
+  uint64_t erased = 0;
+
+  auto it = extents->lower_bound(off);
+  if (it != extents->begin()) {
+    auto prev = std::prev(it);
+    uint64_t prev_end = prev->first + prev->second.length();
+    if (prev_end > off) {
+      if (prev_end > end) {
+        ceph::bufferlist tail;
+        tail.substr_of(prev->second, end - prev->first, prev_end - end);
+        extents->emplace(end, std::move(tail));
+      }
+      erased += std::min(prev_end, end) - off;
+
+      ceph::bufferlist head;
+      head.substr_of(prev->second, 0, off - prev->first);
+      prev->second = std::move(head);
+    }
+  }
+
+  while (it != extents->end() && it->first < end) {
+    uint64_t extent_end = it->first + it->second.length();
+    if (extent_end > end) {
+      ceph::bufferlist tail;
+      tail.substr_of(it->second, end - it->first, extent_end - end);
+      erased += end - it->first;
+      extents->erase(it);
+      extents->emplace(end, std::move(tail));
+      break;
+    }
+    erased += it->second.length();
+    it = extents->erase(it);
+  }
+  return erased;
+}
+
+template <typename I>
+uint64_t WriteBackObjectDispatch<I>::insert_extent(Extents* extents,
+                                                   uint64_t off,
+                                                   ceph::bufferlist&& bl) {
+  uint64_t len = bl.length();
+  uint64_t erased = erase_extents(extents, off, len);
+
+  // coalesce with the adjacent extents
+  auto it = extents->emplace(off, std::move(bl)).first;
+  if (it != extents->begin()) {
+    auto prev = std::prev(it);
+    if (prev->first + prev->second.length() == off) {
+      prev->second.claim_append(it->second);
+      extents->erase(it);
+      it = prev;
+    }
+  }
+  auto next = std::next(it);
+  if (next != extents->end() &&
+      it->first + it->second.length() == next->first) {
+    it->second.claim_append(next->second);
+    extents->erase(next);
+  }
+  return len - erased;
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::overlaps(const Extents& extents,
+                                          uint64_t off, uint64_t len) {
+  auto it = extents.lower_bound(off);
+  if (it != extents.end() && it->first < off + len) {
+    return true;
+  }
+  if (it != extents.begin()) {
+    auto prev = std::prev(it);
+    if (prev->first + prev->second.length() > off) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename I>
+uint64_t WriteBackObjectDispatch<I>::get_length(const Extents& extents) {
+  uint64_t length = 0;
+  for (auto& [off, bl] : extents) {
+    length += bl.length();
+  }
+  return length;
+}
+
+template <typename I>
+bool WriteBackObjectDispatch<I>::read_extents(const Object& object,
+                                              uint64_t off, uint64_t len,
+                                              ceph::bufferlist* bl) {
+  const Extents* levels[] = {&object.dirty, &object.flushing, &object.clean};
+
+  ceph::bufferlist data;
+  uint64_t end = off + len;
+  uint64_t pos = off;
+  while (pos < end) {
+    // an extent of a level is cut short where one of the levels above it
+    // starts
+    uint64_t segment_end = end;
+    const ceph::bufferlist* found = nullptr;
+    uint64_t found_off = 0;
+    for (auto extents : levels) {
+      auto it = extents->upper_bound(pos);
+      if (it != extents->begin()) {
+        auto prev = std::prev(it);
+        uint64_t prev_end = prev->first + prev->second.length();
+        if (prev_end > pos) {
+          found = &prev->second;
+          found_off = prev->first;
+          segment_end = std::min(segment_end, prev_end);
+          break;
+        }
+      }
+      if (it != extents->end()) {
+        segment_end = std::min(segment_end, it->first);
+      }
+    }
+    if (found == nullptr) {
+      return false;
+    }
+
+    ceph::bufferlist segment;
+    segment.substr_of(*found, pos - found_off, segment_end - pos);
+    data.claim_append(segment);
+    pos = segment_end;
+  }
+
+  *bl = std::move(data);
+  return true;
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::WriteBackObjectDispatch<librbd::ImageCtx>;
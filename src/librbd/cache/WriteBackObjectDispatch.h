@@ -0,0 +1,228 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_WRITE_BACK_OBJECT_DISPATCH_H
+#define CEPH_LIBRBD_CACHE_WRITE_BACK_OBJECT_DISPATCH_H
+
+#include "librbd/io/ObjectDispatchInterface.h"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "common/snap_types.h"
+#include "include/buffer.h"
+#include "librbd/io/Types.h"
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Context;
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace io { struct ObjectDispatchSpec; }
+
+namespace cache {
+
+/**
+ * A write back cache of the image's objects in memory, without the
+ * ObjectCacher.
+ *
+ * Each object keeps the extents written to it which are dirty, those being
+ * written back, and the clean extents read from it or written back. Writes
+ * to an object are coalesced into its dirty extents and written back
+ * together, once the dirty data is over the target or older than the max
+ * dirty age, or when a flush requires it: a flush completes once all of the
+ * writes before it were written back. The objects are sharded, so reads
+ * which hit the cache only take the read lock of their shard.
+ *
+ * Journaled writes, discards, write sames and compare and writes are written
+ * through, after the dirty data they overlap is written back.
+ */
+template <typename ImageCtxT = ImageCtx>
+class WriteBackObjectDispatch : public io::ObjectDispatchInterface {
+public:
+  static WriteBackObjectDispatch* create(ImageCtxT* image_ctx,
+                                         size_t max_dirty,
+                                         bool writethrough_until_flush) {
+    return new WriteBackObjectDispatch(image_ctx, max_dirty,
+                                       writethrough_until_flush);
+  }
+
+  WriteBackObjectDispatch(ImageCtxT* image_ctx, size_t max_dirty,
+                          bool writethrough_until_flush);
+  ~WriteBackObjectDispatch() override;
+
+  io::ObjectDispatchLayer get_object_dispatch_layer() const override {
+    return io::OBJECT_DISPATCH_LAYER_CACHE;
+  }
+
+  void init();
+  void shut_down(Context* on_finish) override;
+
+  bool read(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      librados::snap_t snap_id, int op_flags,
+      const ZTracer::Trace &parent_trace, ceph::bufferlist* read_data,
+      io::ExtentMap* extent_map, int* object_dispatch_flags,
+      io::DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+
+  bool discard(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      const ::SnapContext &snapc, int discard_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context**on_finish, Context* on_dispatched) override;
+
+  bool write(
+      uint64_t object_no, uint64_t object_off, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context**on_finish, Context* on_dispatched) override;
+
+  bool write_same(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      io::LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context**on_finish, Context* on_dispatched) override;
+
+  bool compare_and_write(
+      uint64_t object_no, uint64_t object_off, ceph::bufferlist&& cmp_data,
+      ceph::bufferlist&& write_data, const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, uint64_t* mismatch_offset,
+      int* object_dispatch_flags, uint64_t* journal_tid,
+      io::DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+
+  bool flush(
+      io::FlushSource flush_source, const ZTracer::Trace &parent_trace,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override;
+
+  bool invalidate_cache(Context* on_finish) override;
+
+  bool reset_existence_cache(Context* on_finish) override {
+    return false;
+  }
+
+  void extent_overwritten(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      uint64_t journal_tid, uint64_t new_journal_tid) override {
+  }
+
+private:
+  static constexpr size_t SHARDS = 16;
+
+  /* Disjoint extents of an object by offset */
+  typedef std::map<uint64_t, ceph::bufferlist> Extents;
+  typedef std::list<std::pair<uint64_t, Context*>> WritebackWaiters;
+  typedef std::vector<io::ObjectDispatchSpec*> Writebacks;
+
+  struct Object {
+    /* Reads look up dirty extents first, then those being written back,
+     * then the clean ones */
+    Extents dirty;
+    Extents flushing;
+    Extents clean;
+    ::SnapContext snapc;                 /* of the dirty extents */
+    ceph::coarse_mono_time dirty_stamp;
+
+    /* Each cached write is numbered, and writebacks write back all of the
+     * writes up to a number */
+    uint64_t dirty_seq = 0;
+    uint64_t writeback_seq = 0;
+    uint64_t written_seq = 0;
+    bool writeback_in_flight = false;
+    WritebackWaiters writeback_waiters;
+
+    std::atomic<bool> referenced = {false};
+
+    bool idle() const {
+      return (dirty.empty() && flushing.empty() && clean.empty() &&
+              !writeback_in_flight && writeback_waiters.empty());
+    }
+  };
+
+  struct Shard {
+    /* Hold a read lock to look up the cached extents of objects. Hold a
+     * write lock for all of the other changes. */
+    mutable ceph::shared_mutex lock;
+    std::unordered_map<uint64_t, Object> objects;
+    uint64_t clean_bytes = 0;
+    /* Bumped whenever a read in flight may be older than the cache */
+    uint64_t gen = 0;
+
+    explicit Shard(const std::string& lock_name)
+      : lock(ceph::make_shared_mutex(lock_name)) {
+    }
+  };
+
+  ImageCtxT* m_image_ctx;
+  size_t m_max_dirty;
+  bool m_writethrough_until_flush;
+
+  uint64_t m_cache_size = 0;
+  uint64_t m_target_dirty = 0;
+  double m_max_dirty_age = 0;
+
+  std::vector<std::unique_ptr<Shard>> m_shards;
+
+  std::atomic<bool> m_user_flushed = {false};
+  std::atomic<uint64_t> m_dirty_bytes = {0};
+  std::atomic<int> m_writeback_error = {0};
+
+  std::atomic<bool> m_age_scanning = {false};
+  ceph::coarse_mono_time m_last_age_scan;
+
+  Shard& get_shard(uint64_t object_no) {
+    return *m_shards[object_no % SHARDS];
+  }
+
+  bool writeback_enabled() const {
+    return (m_max_dirty > 0 &&
+            (!m_writethrough_until_flush || m_user_flushed));
+  }
+
+  bool write_through(uint64_t object_no, uint64_t object_off,
+                     uint64_t object_len, io::DispatchResult* dispatch_result,
+                     Context* on_dispatched);
+  bool wait_for_writeback(uint64_t object_no, Object* object,
+                          uint64_t object_off, uint64_t object_len,
+                          Context* on_ready, Writebacks* writebacks);
+
+  void handle_read(uint64_t object_no, uint64_t object_off,
+                   uint64_t object_len, uint64_t gen, int r,
+                   ceph::bufferlist* read_data, io::ExtentMap* extent_map);
+
+  void start_writeback(uint64_t object_no, Object* object,
+                       Writebacks* writebacks);
+  void handle_writeback(uint64_t object_no, int r);
+  void send_writebacks(Writebacks&& writebacks);
+  void writeback_aged();
+  void flush_all(Context* on_finish);
+
+  void evict(Shard* shard);
+
+  static uint64_t erase_extents(Extents* extents, uint64_t off, uint64_t len);
+  static uint64_t insert_extent(Extents* extents, uint64_t off,
+                                ceph::bufferlist&& bl);
+  static bool overlaps(const Extents& extents, uint64_t off, uint64_t len);
+  static uint64_t get_length(const Extents& extents);
+  static bool read_extents(const Object& object, uint64_t off, uint64_t len,
+                           ceph::bufferlist* bl);
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::WriteBackObjectDispatch<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_WRITE_BACK_OBJECT_DISPATCH_H
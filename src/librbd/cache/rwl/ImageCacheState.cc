@@ -31,6 +31,9 @@ ImageCacheState<I>::ImageCacheState(I *image_ctx) : m_image_ctx(image_ctx) {
   path = config.get_val<std::string>("rbd_rwl_path");
   size = config.get_val<uint64_t>("rbd_rwl_size");
   log_periodic_stats = config.get_val<bool>("rbd_rwl_log_periodic_stats");
+  if (config.get_val<std::string>("rbd_rwl_mode") == "ssd") {
+    cache_type = IMAGE_CACHE_TYPE_SSD;
+  }
 }
 
 template <typename I>
@@ -46,6 +49,9 @@ ImageCacheState<I>::ImageCacheState(I *image_ctx, JSONFormattable &f) : m_image_
   std::istringstream iss(f["rwl_size"]);
   iss >> rwl_size;
   size = rwl_size;
+  if ((int)f["cache_type"] == IMAGE_CACHE_TYPE_SSD) {
+    cache_type = IMAGE_CACHE_TYPE_SSD;
+  }
 
   // Others from config
   ConfigProxy &config = image_ctx->config;
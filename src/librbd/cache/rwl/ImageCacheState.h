@@ -30,6 +30,7 @@ public:
   std::string path;
   uint64_t size;
   bool log_periodic_stats;
+  ImageCacheType cache_type = IMAGE_CACHE_TYPE_RWL;
 
   ImageCacheState(ImageCtxT* image_ctx);
 
@@ -38,7 +39,7 @@ public:
   ~ImageCacheState() {}
 
   ImageCacheType get_image_cache_type() const {
-    return IMAGE_CACHE_TYPE_RWL;
+    return cache_type;
   }
 
 
@@ -0,0 +1,63 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_SSD_LOG_ENTRY_H
+#define CEPH_LIBRBD_CACHE_SSD_LOG_ENTRY_H
+
+#include "librbd/BlockGuard.h"
+#include "librbd/cache/ssd/Types.h"
+#include <list>
+#include <memory>
+#include <ostream>
+
+namespace librbd {
+namespace cache {
+namespace ssd {
+
+/* A write op in the log, and where its data is */
+class WriteLogEntry {
+public:
+  WriteLogEntryDesc desc;
+  uint64_t log_offset;            /* of its data in the log file */
+  uint64_t batch_seq;             /* of the batch it was appended with */
+  uint32_t referring_map_entries = 0;
+  bool flushed = false;           /* written back to the image */
+
+  WriteLogEntry(const WriteLogEntryDesc &desc, uint64_t log_offset,
+                uint64_t batch_seq)
+    : desc(desc), log_offset(log_offset), batch_seq(batch_seq) {
+  }
+  WriteLogEntry(const WriteLogEntry&) = delete;
+  WriteLogEntry &operator=(const WriteLogEntry&) = delete;
+
+  BlockExtent block_extent() const {
+    return BlockExtent(desc.image_offset_bytes,
+                       desc.image_offset_bytes + desc.write_bytes);
+  }
+  uint32_t get_map_ref() const {
+    return referring_map_entries;
+  }
+  void inc_map_ref() {
+    referring_map_entries++;
+  }
+  void dec_map_ref() {
+    referring_map_entries--;
+  }
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const WriteLogEntry &entry) {
+    os << entry.desc << ", "
+       << "log_offset=" << entry.log_offset << ", "
+       << "batch_seq=" << entry.batch_seq << ", "
+       << "referring_map_entries=" << entry.referring_map_entries << ", "
+       << "flushed=" << entry.flushed;
+    return os;
+  }
+};
+
+typedef std::list<std::shared_ptr<WriteLogEntry>> WriteLogEntries;
+
+} // namespace ssd
+} // namespace cache
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_CACHE_SSD_LOG_ENTRY_H
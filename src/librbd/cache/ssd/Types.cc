@@ -0,0 +1,73 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/cache/ssd/Types.h"
+#include <ostream>
+
+namespace librbd {
+namespace cache {
+namespace ssd {
+
+void SuperBlock::encode(ceph::buffer::list &bl) const {
+  ENCODE_START(1, 1, bl);
+  encode(layout_version, bl);
+  encode(log_size, bl);
+  encode(first_valid_offset, bl);
+  encode(first_valid_seq, bl);
+  ENCODE_FINISH(bl);
+}
+
+void SuperBlock::decode(ceph::buffer::list::const_iterator &it) {
+  DECODE_START(1, it);
+  decode(layout_version, it);
+  decode(log_size, it);
+  decode(first_valid_offset, it);
+  decode(first_valid_seq, it);
+  DECODE_FINISH(it);
+}
+
+void WriteLogEntryDesc::encode(ceph::buffer::list &bl) const {
+  ENCODE_START(1, 1, bl);
+  encode(image_offset_bytes, bl);
+  encode(write_bytes, bl);
+  encode(sync_gen_number, bl);
+  ENCODE_FINISH(bl);
+}
+
+void WriteLogEntryDesc::decode(ceph::buffer::list::const_iterator &it) {
+  DECODE_START(1, it);
+  decode(image_offset_bytes, it);
+  decode(write_bytes, it);
+  decode(sync_gen_number, it);
+  DECODE_FINISH(it);
+}
+
+std::ostream &operator<<(std::ostream &os,
+                         const WriteLogEntryDesc &desc) {
+  os << "image_offset_bytes=" << desc.image_offset_bytes << ", "
+     << "write_bytes=" << desc.write_bytes << ", "
+     << "sync_gen_number=" << desc.sync_gen_number;
+  return os;
+}
+
+void LogBatchHeader::encode(ceph::buffer::list &bl) const {
+  ENCODE_START(1, 1, bl);
+  encode(seq, bl);
+  encode(length, bl);
+  encode(data_crc, bl);
+  encode(entries, bl);
+  ENCODE_FINISH(bl);
+}
+
+void LogBatchHeader::decode(ceph::buffer::list::const_iterator &it) {
+  DECODE_START(1, it);
+  decode(seq, it);
+  decode(length, it);
+  decode(data_crc, it);
+  decode(entries, it);
+  DECODE_FINISH(it);
+}
+
+} // namespace ssd
+} // namespace cache
+} // namespace librbd
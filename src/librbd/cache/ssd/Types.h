@@ -0,0 +1,139 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_SSD_TYPES_H
+#define CEPH_LIBRBD_CACHE_SSD_TYPES_H
+
+#include "include/buffer.h"
+#include "include/ceph_assert.h"
+#include "include/encoding.h"
+#include "include/int_types.h"
+#include "include/intarith.h"
+#include <iosfwd>
+#include <vector>
+
+namespace librbd {
+namespace cache {
+namespace ssd {
+
+/* Version of the log file layout */
+const uint32_t SSD_LOG_VERSION = 1;
+
+/* The log is written and read in blocks of this size, at offsets aligned
+ * to it */
+const uint64_t BLOCK_SIZE = 4096;
+
+/* The super block is the first block of the log file, the ring of log
+ * batches the rest of it */
+const uint64_t LOG_START = BLOCK_SIZE;
+
+/* Write ops appended to the log with one write to the SSD */
+const uint32_t MAX_ENTRIES_PER_BATCH = 64;
+const uint64_t MAX_BYTES_PER_BATCH = 4 << 20;
+
+/* Write ops written back to the image concurrently */
+const uint32_t MAX_WRITEBACK_OPS = 32;
+
+inline uint64_t round_up_to_block(uint64_t length) {
+  return p2roundup(length, BLOCK_SIZE);
+}
+
+struct SuperBlock {
+  uint32_t layout_version = SSD_LOG_VERSION;
+  uint64_t log_size = 0;                    /* of the log file */
+  uint64_t first_valid_offset = LOG_START;  /* of the oldest batch that is
+                                               not retired */
+  uint64_t first_valid_seq = 1;             /* its sequence number */
+
+  void encode(ceph::buffer::list &bl) const;
+  void decode(ceph::buffer::list::const_iterator &it);
+};
+
+/* A write op, as it is recorded in the log */
+struct WriteLogEntryDesc {
+  uint64_t image_offset_bytes = 0;
+  uint64_t write_bytes = 0;
+  uint64_t sync_gen_number = 0;
+
+  WriteLogEntryDesc() {}
+  WriteLogEntryDesc(uint64_t image_offset_bytes, uint64_t write_bytes,
+                    uint64_t sync_gen_number)
+    : image_offset_bytes(image_offset_bytes), write_bytes(write_bytes),
+      sync_gen_number(sync_gen_number) {
+  }
+
+  void encode(ceph::buffer::list &bl) const;
+  void decode(ceph::buffer::list::const_iterator &it);
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const WriteLogEntryDesc &desc);
+};
+
+/*
+ * The first block of a batch of write ops appended together. The data of
+ * the ops follows it, each padded to whole blocks.
+ *
+ * Batches are appended with consecutive sequence numbers, so that a replay
+ * can tell the next batch from a stale one left by an earlier lap of the
+ * log ring, and carry the crc of their data, to tell a whole batch from a
+ * torn one.
+ */
+struct LogBatchHeader {
+  uint64_t seq = 0;
+  uint64_t length = 0;    /* of the batch, this block included */
+  uint32_t data_crc = 0;
+  std::vector<WriteLogEntryDesc> entries;
+
+  void encode(ceph::buffer::list &bl) const;
+  void decode(ceph::buffer::list::const_iterator &it);
+};
+
+WRITE_CLASS_ENCODER(SuperBlock)
+WRITE_CLASS_ENCODER(WriteLogEntryDesc)
+WRITE_CLASS_ENCODER(LogBatchHeader)
+
+/* Encode t in a block of its own, behind its length and crc */
+template <typename T>
+void encode_block(const T &t, ceph::buffer::list &bl) {
+  using ceph::encode;
+  ceph::buffer::list payload;
+  encode(t, payload);
+  uint32_t length = payload.length();
+  uint32_t crc = payload.crc32c(0);
+  ceph_assert(sizeof(length) + sizeof(crc) + length <= BLOCK_SIZE);
+  encode(length, bl);
+  encode(crc, bl);
+  bl.claim_append(payload);
+  bl.append_zero(BLOCK_SIZE - sizeof(length) - sizeof(crc) - length);
+}
+
+/* @return -EINVAL unless the block holds a whole encode_block()ed T */
+template <typename T>
+int decode_block(const ceph::buffer::list &bl, T *t) {
+  using ceph::decode;
+  try {
+    auto it = bl.cbegin();
+    uint32_t length;
+    uint32_t crc;
+    decode(length, it);
+    decode(crc, it);
+    if (length > it.get_remaining()) {
+      return -EINVAL;
+    }
+    ceph::buffer::list payload;
+    it.copy(length, payload);
+    if (payload.crc32c(0) != crc) {
+      return -EINVAL;
+    }
+    auto payload_it = payload.cbegin();
+    decode(*t, payload_it);
+  } catch (const ceph::buffer::error &err) {
+    return -EINVAL;
+  }
+  return 0;
+}
+
+} // namespace ssd
+} // namespace cache
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_CACHE_SSD_TYPES_H
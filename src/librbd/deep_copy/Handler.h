@@ -5,6 +5,7 @@
 #define CEPH_LIBRBD_DEEP_COPY_HANDLER_H
 
 #include "include/int_types.h"
+#include "include/Context.h"
 #include "include/rbd/librbd.hpp"
 
 namespace librbd {
@@ -13,6 +14,11 @@ namespace deep_copy {
 struct Handler {
   virtual ~Handler() {}
 
+  /// an object is copied once on_start is completed, which may be before
+  /// it returns, and finish_object_copy is invoked once it was copied
+  virtual void start_object_copy(Context* on_start) = 0;
+  virtual void finish_object_copy() = 0;
+
   virtual void handle_read(uint64_t bytes_read) = 0;
 
   virtual int update_progress(uint64_t object_number,
@@ -20,6 +26,12 @@ struct Handler {
 };
 
 struct NoOpHandler : public Handler {
+  void start_object_copy(Context* on_start) override {
+    on_start->complete(0);
+  }
+  void finish_object_copy() override {
+  }
+
   void handle_read(uint64_t bytes_read) override {
   }
 
@@ -113,8 +113,12 @@ void ImageCopyRequest<I>::send_object_copies() {
   bool complete;
   {
     std::lock_guard locker{m_lock};
-    auto max_ops = m_src_image_ctx->config.template get_val<uint64_t>(
-      "rbd_concurrent_management_ops");
+    auto max_ops = m_dst_image_ctx->config.template get_val<uint64_t>(
+      "rbd_concurrent_object_copies");
+    if (max_ops == 0) {
+      max_ops = m_src_image_ctx->config.template get_val<uint64_t>(
+        "rbd_concurrent_management_ops");
+    }
 
     // attempt to schedule at least 'max_ops' initial requests where
     // some objects might be skipped if fast-diff notes no change
@@ -162,10 +166,16 @@ int ImageCopyRequest<I>::send_next_object_copy() {
     [this, ono](int r) {
       handle_object_copy(ono, r);
     });
-  auto req = ObjectCopyRequest<I>::create(
-    m_src_image_ctx, m_dst_image_ctx, m_src_snap_id_start, m_dst_snap_id_start,
-    m_snap_map, ono, m_flatten, m_handler, ctx);
-  req->send();
+
+  // the handler may hold the copy back, e.g. to share a bandwidth limit
+  // with other copies
+  m_handler->start_object_copy(new LambdaContext(
+    [this, ono, ctx](int r) {
+      auto req = ObjectCopyRequest<I>::create(
+        m_src_image_ctx, m_dst_image_ctx, m_src_snap_id_start,
+        m_dst_snap_id_start, m_snap_map, ono, m_flatten, m_handler, ctx);
+      req->send();
+    }));
   return 0;
 }
 
@@ -173,6 +183,9 @@ template <typename I>
 void ImageCopyRequest<I>::handle_object_copy(uint64_t object_no, int r) {
   ldout(m_cct, 20) << "object_no=" << object_no << ", r=" << r << dendl;
 
+  // may start the copy of another object
+  m_handler->finish_object_copy();
+
   bool complete;
   {
     std::lock_guard locker{m_lock};
@@ -3,6 +3,8 @@
 
 #include "ObjectCopyRequest.h"
 #include "common/errno.h"
+#include "cls/rbd/cls_rbd_client.h"
+#include "compressor/Compressor.h"
 #include "librados/snap_set_diff.h"
 #include "librbd/ExclusiveLock.h"
 #include "librbd/ObjectMap.h"
@@ -38,6 +40,13 @@ inline bool operator==(const snap_set_t& rhs, const snap_set_t& lhs) {
 namespace librbd {
 namespace deep_copy {
 
+namespace {
+
+// zeroed blocks skipped by compressed reads
+const uint64_t COMPRESSED_READ_SPARSE_SIZE = 4096;
+
+} // anonymous namespace
+
 using librbd::util::create_context_callback;
 using librbd::util::create_rados_callback;
 
@@ -68,6 +77,12 @@ ObjectCopyRequest<I>::ObjectCopyRequest(I *src_image_ctx,
 
   m_dst_oid = m_dst_image_ctx->get_object_name(dst_object_number);
 
+  m_read_compressor = m_dst_image_ctx->config.template get_val<std::string>(
+    "rbd_deep_copy_read_compression");
+  if (m_read_compressor == "none") {
+    m_read_compressor.clear();
+  }
+
   ldout(m_cct, 20) << "dst_oid=" << m_dst_oid << dendl;
 
   compute_src_object_extents();
@@ -169,6 +184,7 @@ void ObjectCopyRequest<I>::send_read_object() {
 
   bool read_required = false;
   librados::ObjectReadOperation op;
+  std::vector<std::pair<uint64_t, uint64_t>> compressed_read_extents;
 
   for (auto &copy_op : m_read_ops[index]) {
     if (!read_required) {
@@ -180,6 +196,10 @@ void ObjectCopyRequest<I>::send_read_object() {
     }
     ldout(m_cct, 20) << "read op: " << copy_op.src_offset << "~"
                      << copy_op.length << dendl;
+    if (!m_read_compressor.empty()) {
+      compressed_read_extents.emplace_back(copy_op.src_offset, copy_op.length);
+      continue;
+    }
     op.sparse_read(copy_op.src_offset, copy_op.length, &copy_op.src_extent_map,
                    &copy_op.out_bl, nullptr);
     op.set_op_flags2(LIBRADOS_OP_FLAG_FADVISE_SEQUENTIAL |
@@ -192,17 +212,56 @@ void ObjectCopyRequest<I>::send_read_object() {
     return;
   }
 
-  auto ctx = create_context_callback<
-    ObjectCopyRequest<I>, &ObjectCopyRequest<I>::handle_read_object>(this);
+  Context *ctx;
+  bufferlist *out_bl = nullptr;
+  if (!compressed_read_extents.empty()) {
+    // all of the extents of the snapshot are read as one compressed buffer
+    cls_client::compressed_read_start(&op, compressed_read_extents,
+                                      COMPRESSED_READ_SPARSE_SIZE,
+                                      m_read_compressor);
+    m_compressed_read_bl.clear();
+    out_bl = &m_compressed_read_bl;
+    ctx = create_context_callback<
+      ObjectCopyRequest<I>,
+      &ObjectCopyRequest<I>::handle_compressed_read_object>(this);
+  } else {
+    ctx = create_context_callback<
+      ObjectCopyRequest<I>, &ObjectCopyRequest<I>::handle_read_object>(this);
+  }
   auto comp = create_rados_callback(ctx);
 
   ldout(m_cct, 20) << "read " << m_src_oid << dendl;
 
-  int r = m_src_io_ctx.aio_operate(m_src_oid, comp, &op, nullptr);
+  int r = m_src_io_ctx.aio_operate(m_src_oid, comp, &op, out_bl);
   ceph_assert(r == 0);
   comp->release();
 }
 
+template <typename I>
+void ObjectCopyRequest<I>::handle_compressed_read_object(int r) {
+  ldout(m_cct, 20) << "r=" << r << dendl;
+
+  if (r == -EOPNOTSUPP) {
+    ldout(m_cct, 10) << "compressed read not supported by the source cluster"
+                     << dendl;
+    m_read_compressor.clear();
+    send_read_object();
+    return;
+  }
+
+  if (r == 0) {
+    ceph_assert(!m_read_snaps.empty());
+    auto index = *m_read_snaps.begin();
+    r = decode_compressed_read(&m_read_ops[index]);
+    if (r < 0) {
+      lderr(m_cct) << "failed to decode compressed read: " << cpp_strerror(r)
+                   << dendl;
+    }
+  }
+
+  handle_read_object(r);
+}
+
 template <typename I>
 void ObjectCopyRequest<I>::handle_read_object(int r) {
   ldout(m_cct, 20) << "r=" << r << dendl;
@@ -972,6 +1031,65 @@ void ObjectCopyRequest<I>::compute_zero_ops() {
   }
 }
 
+template <typename I>
+int ObjectCopyRequest<I>::decode_compressed_read(CopyOps *copy_ops) {
+  std::vector<std::map<uint64_t, uint64_t>> extent_maps;
+  std::string compressor;
+  uint32_t raw_length;
+  bufferlist data;
+  auto it = m_compressed_read_bl.cbegin();
+  int r = cls_client::compressed_read_finish(&it, &extent_maps, &compressor,
+                                             &raw_length, &data);
+  m_compressed_read_bl.clear();
+  if (r < 0) {
+    return r;
+  }
+
+  if (!compressor.empty()) {
+    if (!m_decompressor || m_decompressor->get_type_name() != compressor) {
+      m_decompressor = Compressor::create(m_cct, compressor);
+      if (!m_decompressor) {
+        lderr(m_cct) << "compressor " << compressor << " is not available"
+                     << dendl;
+        return -ENOTSUP;
+      }
+    }
+
+    bufferlist raw_data;
+    r = m_decompressor->decompress(data, raw_data);
+    if (r < 0) {
+      return r;
+    }
+    data = std::move(raw_data);
+  }
+
+  if (data.length() != raw_length || extent_maps.size() != copy_ops->size()) {
+    return -EBADMSG;
+  }
+
+  uint64_t data_offset = 0;
+  auto extent_map_it = extent_maps.begin();
+  for (auto &copy_op : *copy_ops) {
+    uint64_t length = 0;
+    for (auto [extent_offset, extent_length] : *extent_map_it) {
+      if (extent_offset < copy_op.src_offset ||
+          extent_offset + extent_length >
+            copy_op.src_offset + copy_op.length) {
+        return -EBADMSG;
+      }
+      length += extent_length;
+    }
+    if (data_offset + length > data.length()) {
+      return -EBADMSG;
+    }
+
+    copy_op.src_extent_map = std::move(*extent_map_it++);
+    copy_op.out_bl.substr_of(data, data_offset, length);
+    data_offset += length;
+  }
+  return 0;
+}
+
 template <typename I>
 void ObjectCopyRequest<I>::finish(int r) {
   ldout(m_cct, 20) << "r=" << r << dendl;
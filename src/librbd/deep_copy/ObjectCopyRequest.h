@@ -13,8 +13,10 @@
 #include "librbd/io/Types.h"
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 
+class Compressor;
 class Context;
 class RWLock;
 
@@ -174,12 +176,17 @@ private:
   std::map<librados::snap_t, bool> m_dst_object_may_exist;
   bufferlist m_read_from_parent_data;
 
+  std::string m_read_compressor;
+  std::shared_ptr<Compressor> m_decompressor;
+  bufferlist m_compressed_read_bl;
+
   io::AsyncOperation* m_src_async_op = nullptr;
 
   void send_list_snaps();
   void handle_list_snaps(int r);
 
   void send_read_object();
+  void handle_compressed_read_object(int r);
   void handle_read_object(int r);
 
   void send_read_from_parent();
@@ -203,6 +210,8 @@ private:
 
   void compute_dst_object_may_exist();
 
+  int decode_compressed_read(CopyOps *copy_ops);
+
   void finish(int r);
 };
 
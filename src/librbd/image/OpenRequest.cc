@@ -8,7 +8,9 @@
 #include "librbd/ImageCtx.h"
 #include "librbd/Utils.h"
 #include "librbd/cache/ObjectCacherObjectDispatch.h"
+#include "librbd/cache/ReadCacheObjectDispatch.h"
 #include "librbd/cache/WriteAroundObjectDispatch.h"
+#include "librbd/cache/WriteBackObjectDispatch.h"
 #include "librbd/cache/ParentCacheObjectDispatch.cc"
 #include "librbd/image/CloseRequest.h"
 #include "librbd/image/RefreshRequest.h"
@@ -561,7 +563,7 @@ template <typename I>
 Context *OpenRequest<I>::send_init_cache(int *result) {
   // cache is disabled or parent image context
   if (!m_image_ctx->cache || m_image_ctx->child != nullptr) {
-    return send_register_watch(result);
+    return send_init_read_cache(result);
   }
 
   CephContext *cct = m_image_ctx->cct;
@@ -582,6 +584,14 @@ Context *OpenRequest<I>::send_init_cache(int *result) {
       max_dirty = 0;
     }
 
+    if (!m_image_ctx->config.template get_val<bool>(
+          "rbd_cache_object_cacher")) {
+      auto cache = cache::WriteBackObjectDispatch<I>::create(
+        m_image_ctx, max_dirty, writethrough_until_flush);
+      cache->init();
+      return send_init_read_cache(result);
+    }
+
     auto cache = cache::ObjectCacherObjectDispatch<I>::create(
       m_image_ctx, max_dirty, writethrough_until_flush);
     cache->init();
@@ -592,6 +602,24 @@ Context *OpenRequest<I>::send_init_cache(int *result) {
     m_image_ctx->readahead.set_max_readahead_size(
       m_image_ctx->config.template get_val<Option::size_t>("rbd_readahead_max_bytes"));
   }
+  return send_init_read_cache(result);
+}
+
+template <typename I>
+Context *OpenRequest<I>::send_init_read_cache(int *result) {
+  // read cache is disabled, parent image context or read-only image
+  bool read_cache_enabled = m_image_ctx->config.template get_val<bool>(
+    "rbd_read_cache_enabled");
+  if (!read_cache_enabled || m_image_ctx->child != nullptr ||
+      m_image_ctx->read_only) {
+    return send_register_watch(result);
+  }
+
+  CephContext *cct = m_image_ctx->cct;
+  ldout(cct, 10) << this << " " << __func__ << dendl;
+
+  auto read_cache = cache::ReadCacheObjectDispatch<I>::create(m_image_ctx);
+  read_cache->init();
   return send_register_watch(result);
 }
 
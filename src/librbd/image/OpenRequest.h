@@ -67,6 +67,9 @@ private:
    *                                             INIT_CACHE
    *                                                |
    *                                                v
+   *                                             INIT_READ_CACHE (skip if
+   *                                                |             disable)
+   *                                                v
    *                                             REGISTER_WATCH (skip if
    *                                                |            read-only)
    *                                                v
@@ -128,6 +131,8 @@ private:
 
   Context *send_init_cache(int *result);
 
+  Context *send_init_read_cache(int *result);
+
   Context *send_register_watch(int *result);
   Context *handle_register_watch(int *result);
 
@@ -577,6 +577,18 @@ ObjectDispatchSpec *ImageWriteRequest<I>::create_object_request(
     assemble_extent(object_extent, &bl);
   }
 
+  if (image_ctx.discard_on_zeroed_write && bl.is_zero()) {
+    ldout(image_ctx.cct, 20) << "discarding zeroed write to "
+                             << data_object_name(&image_ctx,
+                                                 object_extent.object_no)
+                             << dendl;
+    return ObjectDispatchSpec::create_discard(
+      &image_ctx, OBJECT_DISPATCH_LAYER_NONE, object_extent.object_no,
+      object_extent.offset, bl.length(), snapc,
+      OBJECT_DISCARD_FLAG_DISABLE_CLONE_REMOVE, journal_tid, this->m_trace,
+      on_finish);
+  }
+
   auto req = ObjectDispatchSpec::create_write(
     &image_ctx, OBJECT_DISPATCH_LAYER_NONE, object_extent.object_no,
     object_extent.offset, std::move(bl), snapc, m_op_flags, journal_tid,
@@ -15,8 +15,12 @@
 #include "librbd/io/AioCompletion.h"
 #include "librbd/io/ImageRequest.h"
 #include "librbd/io/ImageDispatchSpec.h"
+#include "librbd/io/QosScheduler.h"
 #include "common/EventTrace.h"
 
+#include <functional>
+#include <thread>
+
 #define dout_subsys ceph_subsys_rbd
 #undef dout_prefix
 #define dout_prefix *_dout << "librbd::io::ImageRequestWQ: " << this \
@@ -30,6 +34,9 @@ namespace io {
 
 namespace {
 
+// set while an IO is dispatched from a dispatch lane
+thread_local bool on_dispatch_lane = false;
+
 template <typename I>
 void flush_image(I& image_ctx, Context* on_finish) {
   auto aio_comp = librbd::io::AioCompletion::create_and_start(
@@ -119,6 +126,11 @@ ImageRequestWQ<I>::~ImageRequestWQ() {
   for (auto t : m_throttles) {
     delete t.second;
   }
+
+  auto qos_scheduler = m_qos_scheduler.load();
+  if (qos_scheduler != nullptr) {
+    qos_scheduler->unregister_client(m_qos_client_id);
+  }
 }
 
 template <typename I>
@@ -281,6 +293,13 @@ void ImageRequestWQ<I>::aio_read(AioCompletion *c, uint64_t off, uint64_t len,
     c->set_event_notify(true);
   }
 
+  if (queue_in_dispatch_lane(c, [this, c, off, len, read_result=std::move(read_result), op_flags,
+       native_async]() mutable {
+        aio_read(c, off, len, std::move(read_result), op_flags, native_async);
+      })) {
+    return;
+  }
+
   if (!start_in_flight_io(c)) {
     return;
   }
@@ -288,7 +307,7 @@ void ImageRequestWQ<I>::aio_read(AioCompletion *c, uint64_t off, uint64_t len,
   // if journaling is enabled -- we need to replay the journal because
   // it might contain an uncommitted write
   std::shared_lock owner_locker{m_image_ctx.owner_lock};
-  if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty() ||
+  if (non_blocking_aio() || writes_blocked() || !writes_empty() ||
       require_lock_on_read()) {
     queue(ImageDispatchSpec<I>::create_read_request(
             m_image_ctx, c, {{off, len}}, std::move(read_result), op_flags,
@@ -323,6 +342,12 @@ void ImageRequestWQ<I>::aio_write(AioCompletion *c, uint64_t off, uint64_t len,
     c->set_event_notify(true);
   }
 
+  if (queue_in_dispatch_lane(c, [this, c, off, len, bl=std::move(bl), op_flags, native_async]() mutable {
+        aio_write(c, off, len, std::move(bl), op_flags, native_async);
+      })) {
+    return;
+  }
+
   if (!start_in_flight_io(c)) {
     return;
   }
@@ -338,7 +363,7 @@ void ImageRequestWQ<I>::aio_write(AioCompletion *c, uint64_t off, uint64_t len,
           m_image_ctx, c, {{off, len}}, std::move(bl), op_flags, trace, tid);
 
   std::shared_lock owner_locker{m_image_ctx.owner_lock};
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if (non_blocking_aio() || writes_blocked()) {
     queue(req);
   } else {
     process_io(req, false);
@@ -369,6 +394,12 @@ void ImageRequestWQ<I>::aio_discard(AioCompletion *c, uint64_t off,
     c->set_event_notify(true);
   }
 
+  if (queue_in_dispatch_lane(c, [this, c, off, len, discard_granularity_bytes, native_async] {
+        aio_discard(c, off, len, discard_granularity_bytes, native_async);
+      })) {
+    return;
+  }
+
   if (!start_in_flight_io(c)) {
     return;
   }
@@ -384,7 +415,7 @@ void ImageRequestWQ<I>::aio_discard(AioCompletion *c, uint64_t off,
             m_image_ctx, c, off, len, discard_granularity_bytes, trace, tid);
 
   std::shared_lock owner_locker{m_image_ctx.owner_lock};
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if (non_blocking_aio() || writes_blocked()) {
     queue(req);
   } else {
     process_io(req, false);
@@ -411,6 +442,12 @@ void ImageRequestWQ<I>::aio_flush(AioCompletion *c, bool native_async) {
     c->set_event_notify(true);
   }
 
+  if (queue_in_dispatch_lane(c, [this, c, native_async] {
+        aio_flush(c, native_async);
+      })) {
+    return;
+  }
+
   if (!start_in_flight_io(c)) {
     return;
   }
@@ -425,13 +462,14 @@ void ImageRequestWQ<I>::aio_flush(AioCompletion *c, bool native_async) {
     if(!m_queued_or_blocked_io_tids.empty()) {
       ldout(cct, 20) << "queueing flush, tid: " << tid << dendl;
       m_queued_flushes.emplace(tid, req);
+      ++m_queued_flush_count;
       --m_in_flight_ios;
       return;
     }
   }
 
   std::shared_lock owner_locker{m_image_ctx.owner_lock};
-  if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty()) {
+  if (non_blocking_aio() || writes_blocked() || !writes_empty()) {
     queue(req);
   } else {
     process_io(req, false);
@@ -462,6 +500,12 @@ void ImageRequestWQ<I>::aio_writesame(AioCompletion *c, uint64_t off,
     c->set_event_notify(true);
   }
 
+  if (queue_in_dispatch_lane(c, [this, c, off, len, bl=std::move(bl), op_flags, native_async]() mutable {
+        aio_writesame(c, off, len, std::move(bl), op_flags, native_async);
+      })) {
+    return;
+  }
+
   if (!start_in_flight_io(c)) {
     return;
   }
@@ -477,7 +521,7 @@ void ImageRequestWQ<I>::aio_writesame(AioCompletion *c, uint64_t off,
             m_image_ctx, c, off, len, std::move(bl), op_flags, trace, tid);
 
   std::shared_lock owner_locker{m_image_ctx.owner_lock};
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if (non_blocking_aio() || writes_blocked()) {
     queue(req);
   } else {
     process_io(req, false);
@@ -510,6 +554,14 @@ void ImageRequestWQ<I>::aio_compare_and_write(AioCompletion *c,
     c->set_event_notify(true);
   }
 
+  if (queue_in_dispatch_lane(c, [this, c, off, len, cmp_bl=std::move(cmp_bl), bl=std::move(bl),
+       mismatch_off, op_flags, native_async]() mutable {
+        aio_compare_and_write(c, off, len, std::move(cmp_bl), std::move(bl),
+                              mismatch_off, op_flags, native_async);
+      })) {
+    return;
+  }
+
   if (!start_in_flight_io(c)) {
     return;
   }
@@ -526,7 +578,7 @@ void ImageRequestWQ<I>::aio_compare_and_write(AioCompletion *c,
             mismatch_off, op_flags, trace, tid);
 
   std::shared_lock owner_locker{m_image_ctx.owner_lock};
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if (non_blocking_aio() || writes_blocked()) {
     queue(req);
   } else {
     process_io(req, false);
@@ -592,6 +644,12 @@ template <typename I>
 void ImageRequestWQ<I>::unblock_flushes() {
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 20) << "ictx=" << &m_image_ctx << dendl;
+  if (m_queued_flush_count == 0) {
+    // a flush queued after this check waits on an IO that is still
+    // queued or blocked, which will unblock it in turn
+    return;
+  }
+
   std::unique_lock locker{m_lock};
   auto io_tid_it = m_queued_or_blocked_io_tids.begin();
   while (true) {
@@ -608,6 +666,7 @@ void ImageRequestWQ<I>::unblock_flushes() {
     AioCompletion *aio_comp = blocked_flush.second->get_aio_completion();
 
     m_queued_flushes.erase(it);
+    --m_queued_flush_count;
     locker.unlock();
     queue_unblocked_io(aio_comp, blocked_flush.second);
     locker.lock();
@@ -788,6 +847,31 @@ void ImageRequestWQ<I>::apply_qos_limit(const uint64_t flag,
     m_qos_enabled_flag &= ~flag;
 }
 
+template <typename I>
+void ImageRequestWQ<I>::apply_qos_scheduler(bool enabled, uint64_t reservation,
+                                            uint64_t weight, uint64_t limit,
+                                            uint64_t pool_limit,
+                                            uint64_t pool_burst) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "enabled=" << enabled << dendl;
+
+  auto qos_scheduler = m_qos_scheduler.load();
+  if (!enabled) {
+    m_qos_scheduler_enabled = false;
+    return;
+  } else if (qos_scheduler == nullptr) {
+    // IO only looks up the scheduler once it is enabled
+    qos_scheduler = QosScheduler::get_instance(cct, m_image_ctx.md_ctx.get_id());
+    m_qos_client_id = qos_scheduler->register_client();
+    m_qos_scheduler = qos_scheduler;
+  }
+
+  // the images of a pool share the limit applied last
+  qos_scheduler->set_limit(pool_limit, pool_burst);
+  qos_scheduler->set_client_info(m_qos_client_id, reservation, weight, limit);
+  m_qos_scheduler_enabled = true;
+}
+
 template <typename I>
 void ImageRequestWQ<I>::handle_throttle_ready(int r, ImageDispatchSpec<I> *item, uint64_t flag) {
   CephContext *cct = m_image_ctx.cct;
@@ -832,6 +916,27 @@ bool ImageRequestWQ<I>::needs_throttle(ImageDispatchSpec<I> *item) {
   return blocked;
 }
 
+template <typename I>
+bool ImageRequestWQ<I>::needs_qos_schedule(ImageDispatchSpec<I> *item) {
+  if (!m_qos_scheduler_enabled ||
+      item->was_throttled(RBD_QOS_SCHEDULER_THROTTLE)) {
+    return false;
+  }
+  return true;
+}
+
+template <typename I>
+void ImageRequestWQ<I>::handle_qos_scheduled(ImageDispatchSpec<I> *item) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 15) << "req=" << item << dendl;
+
+  ceph_assert(m_io_throttled.load() > 0);
+  item->set_throttled(RBD_QOS_SCHEDULER_THROTTLE);
+  this->requeue_back(item);
+  --m_io_throttled;
+  this->signal();
+}
+
 template <typename I>
 void *ImageRequestWQ<I>::_void_dequeue() {
   CephContext *cct = m_image_ctx.cct;
@@ -851,6 +956,23 @@ void *ImageRequestWQ<I>::_void_dequeue() {
     return nullptr;
   }
 
+  if (needs_qos_schedule(peek_item)) {
+    ldout(cct, 15) << "scheduling IO " << peek_item << dendl;
+
+    ++m_io_throttled;
+    ThreadPool::PointerWQ<ImageDispatchSpec<I> >::_void_dequeue();
+
+    // the scheduler may dispatch IO of any image right away, which requeues
+    // it with the pool lock
+    this->get_pool_lock().unlock();
+    m_qos_scheduler.load()->schedule(
+      m_qos_client_id, new LambdaContext([this, peek_item](int r) {
+          handle_qos_scheduled(peek_item);
+        }));
+    this->get_pool_lock().lock();
+    return nullptr;
+  }
+
   bool lock_required;
   bool refresh_required = m_image_ctx.state->is_refresh_required();
   {
@@ -1032,16 +1154,6 @@ void ImageRequestWQ<I>::finish_in_flight_write() {
 
 template <typename I>
 int ImageRequestWQ<I>::start_in_flight_io(AioCompletion *c) {
-  std::shared_lock locker{m_lock};
-
-  if (m_shutdown) {
-    CephContext *cct = m_image_ctx.cct;
-    lderr(cct) << "IO received on closed image" << dendl;
-
-    c->fail(-ESHUTDOWN);
-    return false;
-  }
-
   if (!m_image_ctx.data_ctx.is_valid()) {
     CephContext *cct = m_image_ctx.cct;
     lderr(cct) << "missing data pool" << dendl;
@@ -1050,25 +1162,41 @@ int ImageRequestWQ<I>::start_in_flight_io(AioCompletion *c) {
     return false;
   }
 
+  // count the IO before checking for shut down: either shut_down() sees
+  // it in flight, or it sees m_shutdown
   m_in_flight_ios++;
+  if (m_shutdown) {
+    CephContext *cct = m_image_ctx.cct;
+    lderr(cct) << "IO received on closed image" << dendl;
+
+    c->fail(-ESHUTDOWN);
+    finish_in_flight_io();
+    return false;
+  }
   return true;
 }
 
 template <typename I>
 void ImageRequestWQ<I>::finish_in_flight_io() {
+  if (--m_in_flight_ios > 0 || !m_shutdown) {
+    return;
+  }
+
   Context *on_shutdown;
   {
-    std::shared_lock locker{m_lock};
-    if (--m_in_flight_ios > 0 || !m_shutdown) {
-      return;
-    }
+    std::lock_guard locker{m_lock};
     on_shutdown = m_on_shutdown;
+    m_on_shutdown = nullptr;
+  }
+  if (on_shutdown == nullptr) {
+    // shut_down() found no IO in flight, or the last one already
+    // completed it
+    return;
   }
 
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 5) << "completing shut down" << dendl;
 
-  ceph_assert(on_shutdown != nullptr);
   flush_image(m_image_ctx, on_shutdown);
 }
 
@@ -1097,6 +1225,37 @@ bool ImageRequestWQ<I>::is_lock_required(bool write_op) const {
           (!write_op && m_require_lock_on_read));
 }
 
+template <typename I>
+bool ImageRequestWQ<I>::non_blocking_aio() const {
+  // the dispatch lanes are the threads which keep the caller from blocking
+  return m_image_ctx.non_blocking_aio && !on_dispatch_lane;
+}
+
+template <typename I>
+template <typename F>
+bool ImageRequestWQ<I>::queue_in_dispatch_lane(AioCompletion *c, F&& f) {
+  auto& lanes = m_image_ctx.io_dispatch_lanes;
+  if (lanes.empty() || !non_blocking_aio()) {
+    return false;
+  }
+
+  // the queued IO is in flight, so that the image cannot be shut down
+  // under it
+  if (!start_in_flight_io(c)) {
+    return true;
+  }
+
+  auto lane = lanes[std::hash<std::thread::id>{}(std::this_thread::get_id()) %
+                    lanes.size()];
+  lane->queue(new LambdaContext([this, f=std::move(f)](int r) mutable {
+      on_dispatch_lane = true;
+      f();
+      on_dispatch_lane = false;
+      finish_in_flight_io();
+    }), 0);
+  return true;
+}
+
 template <typename I>
 void ImageRequestWQ<I>::queue(ImageDispatchSpec<I> *req) {
   ceph_assert(ceph_mutex_is_locked(m_image_ctx.owner_lock));
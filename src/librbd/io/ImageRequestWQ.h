@@ -22,6 +22,7 @@ namespace io {
 
 class AioCompletion;
 template <typename> class ImageDispatchSpec;
+class QosScheduler;
 class ReadResult;
 
 template <typename ImageCtxT = librbd::ImageCtx>
@@ -63,7 +64,6 @@ public:
   void shut_down(Context *on_shutdown);
 
   inline bool writes_blocked() const {
-    std::shared_lock locker{m_lock};
     return (m_write_blockers > 0);
   }
 
@@ -79,6 +79,10 @@ public:
 
   void apply_qos_limit(const uint64_t flag, uint64_t limit, uint64_t burst);
 
+  void apply_qos_scheduler(bool enabled, uint64_t reservation, uint64_t weight,
+                           uint64_t limit, uint64_t pool_limit,
+                           uint64_t pool_burst);
+
 protected:
   void *_void_dequeue() override;
   void process(ImageDispatchSpec<ImageCtxT> *req) override;
@@ -98,10 +102,13 @@ private:
   ImageCtxT &m_image_ctx;
   mutable ceph::shared_mutex m_lock;
   Contexts m_write_blocker_contexts;
-  uint32_t m_write_blockers = 0;
+  // the state checked by the direct IO path is atomic, so that IO which
+  // is neither blocked nor throttled never has to take m_lock -- it is
+  // still only changed with m_lock held
+  std::atomic<uint32_t> m_write_blockers { 0 };
   Contexts m_unblocked_write_waiter_contexts;
-  bool m_require_lock_on_read = false;
-  bool m_require_lock_on_write = false;
+  std::atomic<bool> m_require_lock_on_read { false };
+  std::atomic<bool> m_require_lock_on_write { false };
   std::atomic<unsigned> m_queued_reads { 0 };
   std::atomic<unsigned> m_queued_writes { 0 };
   std::atomic<unsigned> m_in_flight_ios { 0 };
@@ -116,25 +123,30 @@ private:
   std::atomic<unsigned> m_last_tid { 0 };
   std::set<uint64_t> m_queued_or_blocked_io_tids;
   std::map<uint64_t, ImageDispatchSpec<ImageCtxT>*> m_queued_flushes;
+  std::atomic<unsigned> m_queued_flush_count { 0 };
 
   std::list<std::pair<uint64_t, TokenBucketThrottle*> > m_throttles;
   uint64_t m_qos_enabled_flag = 0;
 
-  bool m_shutdown = false;
+  // registered with the pool's scheduler once it is first enabled
+  std::atomic<QosScheduler*> m_qos_scheduler { nullptr };
+  uint64_t m_qos_client_id = 0;
+  std::atomic<bool> m_qos_scheduler_enabled { false };
+
+  std::atomic<bool> m_shutdown { false };
   Context *m_on_shutdown = nullptr;
 
   bool is_lock_required(bool write_op) const;
 
   inline bool require_lock_on_read() const {
-    std::shared_lock locker{m_lock};
     return m_require_lock_on_read;
   }
   inline bool writes_empty() const {
-    std::shared_lock locker{m_lock};
     return (m_queued_writes == 0);
   }
 
   bool needs_throttle(ImageDispatchSpec<ImageCtxT> *item);
+  bool needs_qos_schedule(ImageDispatchSpec<ImageCtxT> *item);
 
   void finish_queued_io(bool write_op);
   void remove_in_flight_write_ios(uint64_t offset, uint64_t length,
@@ -150,6 +162,12 @@ private:
   void fail_in_flight_io(int r, ImageDispatchSpec<ImageCtxT> *req);
   void process_io(ImageDispatchSpec<ImageCtxT> *req, bool non_blocking_io);
 
+  bool non_blocking_aio() const;
+  /// @return true if the IO will be dispatched from the lane of this
+  /// thread, or was failed
+  template <typename F>
+  bool queue_in_dispatch_lane(AioCompletion *c, F&& f);
+
   void queue(ImageDispatchSpec<ImageCtxT> *req);
   void queue_unblocked_io(AioCompletion *comp,
                           ImageDispatchSpec<ImageCtxT> *req);
@@ -159,6 +177,7 @@ private:
   void handle_blocked_writes(int r);
 
   void handle_throttle_ready(int r, ImageDispatchSpec<ImageCtxT> *item, uint64_t flag);
+  void handle_qos_scheduled(ImageDispatchSpec<ImageCtxT> *item);
 };
 
 } // namespace io
@@ -0,0 +1,221 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/io/QosScheduler.h"
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "common/Timer.h"
+#include "include/Context.h"
+#include "librbd/ImageCtx.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::io::QosScheduler: " << this << " " \
+                           << __func__ << ": "
+
+namespace librbd {
+namespace io {
+
+namespace dmc = crimson::dmclock;
+using namespace std::placeholders;
+
+namespace {
+
+struct QosSchedulerRegistry {
+  ceph::mutex lock = ceph::make_mutex("librbd::io::QosSchedulerRegistry::lock");
+  std::map<int64_t, std::unique_ptr<QosScheduler>> schedulers;
+};
+
+} // anonymous namespace
+
+QosScheduler* QosScheduler::get_instance(CephContext* cct, int64_t pool_id) {
+  auto& registry = cct->lookup_or_create_singleton_object<
+    QosSchedulerRegistry>("librbd::io::qos_schedulers", false);
+
+  std::lock_guard locker{registry.lock};
+  auto& scheduler = registry.schedulers[pool_id];
+  if (!scheduler) {
+    scheduler.reset(new QosScheduler(cct, pool_id));
+  }
+  return scheduler.get();
+}
+
+QosScheduler::QosScheduler(CephContext* cct, int64_t pool_id)
+  : m_cct(cct), m_pool_id(pool_id), m_default_client_info(0, 1, 0),
+    m_queue(std::bind(&QosScheduler::get_client_info, this, _1),
+            dmc::AtLimit::Wait) {
+  ImageCtx::get_timer_instance(cct, &m_timer, &m_timer_lock);
+}
+
+QosScheduler::ClientId QosScheduler::register_client() {
+  std::lock_guard timer_locker{*m_timer_lock};
+  auto client_id = m_next_client_id++;
+  m_client_infos.emplace(client_id, m_default_client_info);
+
+  ldout(m_cct, 5) << "pool_id=" << m_pool_id << ", "
+                  << "client_id=" << client_id << dendl;
+  return client_id;
+}
+
+void QosScheduler::unregister_client(ClientId client_id) {
+  ldout(m_cct, 5) << "pool_id=" << m_pool_id << ", "
+                  << "client_id=" << client_id << dendl;
+
+  Contexts ready;
+  {
+    std::lock_guard timer_locker{*m_timer_lock};
+    m_queue.remove_by_client(
+      client_id, false, [&ready](Queue::RequestRef&& request) {
+        ready.push_back(request->on_ready);
+      });
+
+    // the queue may still refer to the client until it is idle long enough
+    // to be erased, and then looks up the default client info
+    m_client_infos.erase(client_id);
+    m_queue.update_client_infos();
+  }
+
+  for (auto ctx : ready) {
+    ctx->complete(0);
+  }
+}
+
+void QosScheduler::set_client_info(ClientId client_id, uint64_t reservation,
+                                   uint64_t weight, uint64_t limit) {
+  ldout(m_cct, 10) << "client_id=" << client_id << ", "
+                   << "reservation=" << reservation << ", "
+                   << "weight=" << weight << ", "
+                   << "limit=" << limit << dendl;
+
+  Contexts ready;
+  {
+    std::lock_guard timer_locker{*m_timer_lock};
+    auto it = m_client_infos.find(client_id);
+    ceph_assert(it != m_client_infos.end());
+    it->second.update(reservation, weight, limit);
+    m_queue.update_client_infos();
+    process(&ready);
+  }
+
+  for (auto ctx : ready) {
+    ctx->complete(0);
+  }
+}
+
+void QosScheduler::set_limit(uint64_t limit, uint64_t burst) {
+  Contexts ready;
+  {
+    std::lock_guard timer_locker{*m_timer_lock};
+    if (limit == m_limit && burst == m_burst) {
+      return;
+    }
+
+    ldout(m_cct, 5) << "pool_id=" << m_pool_id << ", "
+                    << "limit=" << limit << ", burst=" << burst << dendl;
+    m_limit = limit;
+    m_burst = burst;
+    m_next_dispatch = dmc::TimeZero;
+    process(&ready);
+  }
+
+  for (auto ctx : ready) {
+    ctx->complete(0);
+  }
+}
+
+void QosScheduler::schedule(ClientId client_id, Context* on_ready) {
+  ldout(m_cct, 20) << "client_id=" << client_id << ", "
+                   << "on_ready=" << on_ready << dendl;
+
+  Contexts ready;
+  {
+    std::lock_guard timer_locker{*m_timer_lock};
+    m_queue.add_request(Request{on_ready}, client_id, 1u);
+    process(&ready);
+  }
+
+  for (auto ctx : ready) {
+    ctx->complete(0);
+  }
+}
+
+const dmc::ClientInfo* QosScheduler::get_client_info(
+    const ClientId& client_id) const {
+  // only invoked by the queue, with the timer lock held
+  auto it = m_client_infos.find(client_id);
+  if (it == m_client_infos.end()) {
+    return &m_default_client_info;
+  }
+  return &it->second;
+}
+
+void QosScheduler::process(Contexts* ready) {
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+
+  auto now = dmc::get_time();
+  while (true) {
+    if (m_limit > 0) {
+      // the IOs the pool did not use accrue as credit, up to the burst
+      auto interval = 1.0 / m_limit;
+      auto credit = std::max<uint64_t>(m_burst, 1) - 1;
+      m_next_dispatch = std::max(m_next_dispatch, now - credit * interval);
+      if (m_next_dispatch > now) {
+        if (!m_queue.empty()) {
+          schedule_timer(m_next_dispatch);
+        }
+        break;
+      }
+    }
+
+    auto pull = m_queue.pull_request(now);
+    if (pull.is_none()) {
+      break;
+    } else if (pull.is_future()) {
+      // all of the queued IOs are over their client's limit
+      schedule_timer(pull.getTime());
+      break;
+    }
+
+    auto& retn = pull.get_retn();
+    ldout(m_cct, 20) << "client_id=" << retn.client << dendl;
+    ready->push_back(retn.request->on_ready);
+    if (m_limit > 0) {
+      m_next_dispatch += 1.0 / m_limit;
+    }
+  }
+}
+
+void QosScheduler::schedule_timer(dmc::Time time) {
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+  if (m_timer_task != nullptr) {
+    if (m_timer_time <= time) {
+      return;
+    }
+    m_timer->cancel_event(m_timer_task);
+  }
+
+  m_timer_time = time;
+  m_timer_task = new LambdaContext([this](int r) {
+      handle_timer();
+    });
+  m_timer->add_event_after(std::max(0.0, time - dmc::get_time()),
+                           m_timer_task);
+}
+
+void QosScheduler::handle_timer() {
+  // the timer callback is invoked with the timer lock held
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+  m_timer_task = nullptr;
+
+  Contexts ready;
+  process(&ready);
+  for (auto ctx : ready) {
+    ctx->complete(0);
+  }
+}
+
+} // namespace io
+} // namespace librbd
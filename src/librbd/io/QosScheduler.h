@@ -0,0 +1,90 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_IO_QOS_SCHEDULER_H
+#define CEPH_LIBRBD_IO_QOS_SCHEDULER_H
+
+#include "include/common_fwd.h"
+#include "include/int_types.h"
+#include "common/ceph_mutex.h"
+#include "dmclock/src/dmclock_server.h"
+#include <list>
+#include <map>
+
+class Context;
+class SafeTimer;
+
+namespace librbd {
+namespace io {
+
+/**
+ * A dmclock scheduler shared by the images of a pool opened with the same
+ * CephContext.
+ *
+ * Each image is a client with its own reservation, weight and limit, in
+ * IOPS. The scheduler dispatches the IOs of all of its clients at no more
+ * than the pool's IOPS limit, if there is one, accruing at most the pool's
+ * burst of unused IOs as credit: reservations are served first, and the rest
+ * of the budget is shared by weight.
+ */
+class QosScheduler {
+public:
+  typedef uint64_t ClientId;
+
+  static QosScheduler* get_instance(CephContext* cct, int64_t pool_id);
+
+  QosScheduler(CephContext* cct, int64_t pool_id);
+  QosScheduler(const QosScheduler&) = delete;
+  QosScheduler& operator=(const QosScheduler&) = delete;
+
+  ClientId register_client();
+  void unregister_client(ClientId client_id);
+
+  void set_client_info(ClientId client_id, uint64_t reservation,
+                       uint64_t weight, uint64_t limit);
+  void set_limit(uint64_t limit, uint64_t burst);
+
+  /// completes on_ready once the client's IO may be dispatched, which may
+  /// be before it returns
+  void schedule(ClientId client_id, Context* on_ready);
+
+private:
+  struct Request {
+    Context* on_ready;
+  };
+
+  static constexpr bool IS_DELAYED = false;
+  typedef crimson::dmclock::PullPriorityQueue<ClientId, Request,
+                                              IS_DELAYED> Queue;
+  typedef std::list<Context*> Contexts;
+
+  CephContext* m_cct;
+  int64_t m_pool_id;
+  SafeTimer* m_timer;
+  /* All of the following are protected by the timer lock, which the timer
+   * callback is invoked with */
+  ceph::mutex* m_timer_lock;
+
+  ClientId m_next_client_id = 0;
+  crimson::dmclock::ClientInfo m_default_client_info;
+  std::map<ClientId, crimson::dmclock::ClientInfo> m_client_infos;
+  Queue m_queue;
+
+  uint64_t m_limit = 0;
+  uint64_t m_burst = 0;
+  crimson::dmclock::Time m_next_dispatch = crimson::dmclock::TimeZero;
+  Context* m_timer_task = nullptr;
+  crimson::dmclock::Time m_timer_time = crimson::dmclock::TimeZero;
+
+  const crimson::dmclock::ClientInfo* get_client_info(
+      const ClientId& client_id) const;
+
+  void process(Contexts* ready);
+  void schedule_timer(crimson::dmclock::Time time);
+  void handle_timer();
+};
+
+} // namespace io
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_IO_QOS_SCHEDULER_H
@@ -26,6 +26,10 @@ namespace io {
 
 #define RBD_QOS_MASK		(RBD_QOS_BPS_MASK | RBD_QOS_IOPS_MASK)
 
+// set once the pool's QoS scheduler dispatched the IO -- it is not one of
+// the token bucket throttles
+#define RBD_QOS_SCHEDULER_THROTTLE			1 << 6
+
 typedef enum {
   AIO_TYPE_NONE = 0,
   AIO_TYPE_GENERIC,
@@ -63,6 +67,7 @@ enum ObjectDispatchLayer {
   OBJECT_DISPATCH_LAYER_CACHE,
   OBJECT_DISPATCH_LAYER_JOURNAL,
   OBJECT_DISPATCH_LAYER_PARENT_CACHE,
+  OBJECT_DISPATCH_LAYER_READ_CACHE,
   OBJECT_DISPATCH_LAYER_SCHEDULER,
   OBJECT_DISPATCH_LAYER_CORE,
   OBJECT_DISPATCH_LAYER_LAST
@@ -195,8 +195,13 @@ void MigrateRequest<I>::migrate_objects() {
       boost::lambda::_1, &image_ctx, image_ctx.snapc, boost::lambda::_2));
   AsyncObjectThrottle<I> *throttle = new AsyncObjectThrottle<I>(
     this, image_ctx, context_factory, ctx, &m_prog_ctx, 0, overlap_objects);
-  throttle->start_ops(
-    image_ctx.config.template get_val<uint64_t>("rbd_concurrent_management_ops"));
+  auto max_ops = image_ctx.config.template get_val<uint64_t>(
+    "rbd_concurrent_object_copies");
+  if (max_ops == 0) {
+    max_ops = image_ctx.config.template get_val<uint64_t>(
+      "rbd_concurrent_management_ops");
+  }
+  throttle->start_ops(max_ops);
 }
 
 template <typename I>
@@ -20,8 +20,10 @@
 #include <fcntl.h>
 #include <syslog.h>
 
+#include <algorithm>
 #include <iostream>
 #include <set>
+#include <type_traits>
 
 #define MAX_LOG_BUF 65536
 
@@ -30,6 +32,85 @@ namespace logging {
 
 static OnExitManager exit_callbacks;
 
+/// Entries submitted by one thread, queued without a lock for whoever
+/// holds m_flush_mutex to take.
+class ThreadEntryRing {
+  using slot_t = std::aligned_storage_t<sizeof(ConcreteEntry),
+					alignof(ConcreteEntry)>;
+
+  alignas(64) std::atomic<uint64_t> head = { 0 };  ///< next to take
+  alignas(64) std::atomic<uint64_t> tail = { 0 };  ///< next to fill
+  const uint64_t mask;
+  std::unique_ptr<slot_t[]> slots;
+
+  ConcreteEntry *slot(uint64_t i) {
+    return reinterpret_cast<ConcreteEntry*>(&slots[i & mask]);
+  }
+
+public:
+  /// set once the thread is done with the ring, so that it can be dropped
+  /// when empty
+  std::atomic<bool> orphaned = { false };
+
+  explicit ThreadEntryRing(std::size_t n)
+    : mask(n - 1), slots(new slot_t[n]) {}
+  ~ThreadEntryRing() {
+    for (auto h = head.load(); h != tail.load(); ++h) {
+      slot(h)->~ConcreteEntry();
+    }
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+      tail.load(std::memory_order_acquire);
+  }
+
+  /// by the owning thread only
+  bool push(const Entry& e) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) > mask) {
+      return false;
+    }
+    new (slot(t)) ConcreteEntry(e);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// by the holder of m_flush_mutex only
+  void drain(std::vector<ConcreteEntry>& q) {
+    auto h = head.load(std::memory_order_relaxed);
+    auto t = tail.load(std::memory_order_acquire);
+    for (; h != t; ++h) {
+      q.emplace_back(std::move(*slot(h)));
+      slot(h)->~ConcreteEntry();
+    }
+    head.store(h, std::memory_order_release);
+  }
+};
+
+namespace {
+
+std::atomic<uint64_t> next_log_id = { 1 };
+
+/// the ring of the calling thread, for the Log it last submitted to
+struct thread_ring_t {
+  uint64_t log_id = 0;
+  std::shared_ptr<ThreadEntryRing> ring;
+
+  void reset(uint64_t id, std::shared_ptr<ThreadEntryRing> r) {
+    if (ring) {
+      ring->orphaned = true;
+    }
+    log_id = id;
+    ring = std::move(r);
+  }
+  ~thread_ring_t() {
+    reset(0, nullptr);
+  }
+};
+
+} // anonymous namespace
+
 static void log_on_exit(void *p)
 {
   Log *l = *(Log **)p;
@@ -41,7 +122,8 @@ static void log_on_exit(void *p)
 Log::Log(const SubsystemMap *s)
   : m_indirect_this(nullptr),
     m_subs(s),
-    m_recent(DEFAULT_MAX_RECENT)
+    m_recent(DEFAULT_MAX_RECENT),
+    m_id(next_log_id++)
 {
   m_log_buf.reserve(MAX_LOG_BUF);
 }
@@ -92,6 +174,16 @@ void Log::set_max_recent(std::size_t n)
   m_max_recent = n;
 }
 
+void Log::set_thread_ring_size(std::size_t n)
+{
+  std::size_t size = 0;
+  if (n) {
+    for (size = 1; size < n; size <<= 1)
+      ;
+  }
+  m_thread_ring_size = size;
+}
+
 void Log::set_log_file(std::string_view fn)
 {
   std::scoped_lock lock(m_flush_mutex);
@@ -176,14 +268,75 @@ void Log::stop_graylog()
   m_graylog.reset();
 }
 
-void Log::submit_entry(Entry&& e)
+bool Log::_submit_to_ring(const Entry& e)
 {
-  std::unique_lock lock(m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
+  static thread_local thread_ring_t mine;
+  if (mine.log_id != m_id) {
+    auto ring = std::make_shared<ThreadEntryRing>(m_thread_ring_size);
+    {
+      std::scoped_lock lock(m_rings_mutex);
+      m_rings.push_back(ring);
+    }
+    mine.reset(m_id, std::move(ring));
+  }
+  if (!mine.ring->push(e)) {
+    return false;
+  }
+  // pairs with the fence in entry() between setting m_flusher_waiting and
+  // looking at the rings: without both, the push and the store of the flag
+  // could each go unseen by the other side, and the flusher sleep without
+  // a timeout while entries are in our ring
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_flusher_waiting.load(std::memory_order_relaxed)) {
+    std::scoped_lock lock(m_queue_mutex);
+    m_cond_flusher.notify_all();
+  }
+  return true;
+}
+
+bool Log::_rings_pending()
+{
+  std::scoped_lock lock(m_rings_mutex);
+  return std::any_of(m_rings.begin(), m_rings.end(),
+		     [](auto& r) { return !r->empty(); });
+}
+
+void Log::_drain_rings(EntryVector& q)
+{
+  std::scoped_lock lock(m_rings_mutex);
+  const auto had = q.size();
+  for (auto i = m_rings.begin(); i != m_rings.end(); ) {
+    // read orphaned first, its thread pushes nothing after setting it
+    bool orphaned = (*i)->orphaned;
+    (*i)->drain(q);
+    if (orphaned) {
+      i = m_rings.erase(i);
+    } else {
+      ++i;
+    }
+  }
+  if (q.size() != had) {
+    // interleave the threads again
+    std::stable_sort(q.begin(), q.end(),
+		     [](const auto& a, const auto& b) {
+		       return a.m_stamp < b.m_stamp;
+		     });
+  }
+}
 
+void Log::submit_entry(Entry&& e)
+{
   if (unlikely(m_inject_segv))
     *(volatile int *)(0) = 0xdead;
 
+  // a full ring falls back to m_new, and waits along with it if need be
+  if (m_thread_ring_size && _submit_to_ring(e)) {
+    return;
+  }
+
+  std::unique_lock lock(m_queue_mutex);
+  m_queue_mutex_holder = pthread_self();
+
   // wait for flush to catch up
   while (is_started() &&
 	 m_new.size() > m_max_new) {
@@ -210,6 +363,7 @@ void Log::flush()
     m_queue_mutex_holder = 0;
   }
 
+  _drain_rings(m_flush);
   _flush(m_flush, false);
   m_flush_mutex_holder = 0;
 }
@@ -345,6 +499,7 @@ void Log::dump_recent()
     m_queue_mutex_holder = 0;
   }
 
+  _drain_rings(m_flush);
   _flush(m_flush, false);
 
   _log_message("--- begin dump of recent events ---", true);
@@ -432,7 +587,22 @@ void *Log::entry()
         continue;
       }
 
+      // a thread pushing to its ring after we looked at it sees
+      // m_flusher_waiting and wakes us up, through m_queue_mutex
+      m_flusher_waiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (_rings_pending()) {
+        m_flusher_waiting = false;
+        m_queue_mutex_holder = 0;
+        lock.unlock();
+        flush();
+        lock.lock();
+        m_queue_mutex_holder = pthread_self();
+        continue;
+      }
+
       m_cond_flusher.wait(lock);
+      m_flusher_waiting = false;
     }
     m_queue_mutex_holder = 0;
   }
@@ -6,6 +6,7 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -23,6 +24,7 @@ namespace logging {
 
 class Graylog;
 class SubsystemMap;
+class ThreadEntryRing;
 
 class Log : private Thread
 {
@@ -49,6 +51,17 @@ class Log : private Thread
   EntryRing m_recent; ///< recent (less new) entries we've already written at low detail
   EntryVector m_flush; ///< entries to be flushed (here to optimize heap allocations)
 
+  /// tells Logs apart in the per-thread ring cache of submit_entry()
+  const uint64_t m_id;
+  /// entries per ring of the threads that have none yet, 0 to queue
+  /// everything in m_new
+  std::atomic<std::size_t> m_thread_ring_size = { 0 };
+  /// protects m_rings, never taken by a thread logging except to add its ring
+  std::mutex m_rings_mutex;
+  std::vector<std::shared_ptr<ThreadEntryRing>> m_rings;
+  /// if set, the flusher waits for m_cond_flusher and has to be woken up
+  std::atomic<bool> m_flusher_waiting = { false };
+
   std::string m_log_file;
   int m_fd = -1;
   uid_t m_uid = 0;
@@ -75,6 +88,10 @@ class Log : private Thread
 
   void *entry() override;
 
+  bool _submit_to_ring(const Entry& e);
+  bool _rings_pending();
+  void _drain_rings(EntryVector& q);
+
   void _log_safe_write(std::string_view sv);
   void _flush_logbuf();
   void _flush(EntryVector& q, bool crash);
@@ -92,6 +109,7 @@ public:
   void set_coarse_timestamps(bool coarse);
   void set_max_new(std::size_t n);
   void set_max_recent(std::size_t n);
+  void set_thread_ring_size(std::size_t n);
   void set_log_file(std::string_view fn);
   void reopen_log_file();
   void chown_log_file(uid_t uid, gid_t gid);
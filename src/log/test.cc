@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+
 #include "log/Log.h"
 #include "common/Clock.h"
 #include "include/coredumpctl.h"
@@ -366,6 +371,51 @@ TEST(Log, GarbleRecovery)
   ASSERT_GT(file_status.st_size, 2000);
 }
 
+TEST(Log, ThreadRings)
+{
+  static const char* test_file="log_thread_rings";
+  SubsystemMap subs;
+  subs.set_log_level(1, 20);
+  subs.set_gather_level(1, 10);
+  Log log(&subs);
+  // small enough for the threads to fill them and fall back to m_new
+  log.set_thread_ring_size(6);
+  log.start();
+  unlink(test_file);
+  log.set_log_file(test_file);
+  log.reopen_log_file();
+
+  const int threads = 8, entries = 1000;
+  std::vector<std::thread> ts;
+  for (int t = 0; t < threads; ++t) {
+    ts.emplace_back([&log, t] {
+      for (int i = 0; i < entries; ++i) {
+	MutableEntry e(10, 1);
+	e.get_ostream() << "ring " << t << " " << i;
+	log.submit_entry(std::move(e));
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  log.flush();
+  log.stop();
+
+  std::ifstream in(test_file);
+  std::set<std::pair<int, int>> seen;
+  std::string line;
+  while (std::getline(in, line)) {
+    auto p = line.find("ring ");
+    ASSERT_NE(std::string::npos, p);
+    std::istringstream ss(line.substr(p + 5));
+    int t, i;
+    ss >> t >> i;
+    ASSERT_TRUE(seen.emplace(t, i).second);
+  }
+  ASSERT_EQ((size_t)threads * entries, seen.size());
+}
+
 int main(int argc, char **argv)
 {
   vector<const char*> args;
@@ -347,7 +347,7 @@ public:
   LocalLock versionlock; // FIXME referenced containers not in mempool
 
   mempool::mds_co::map<client_t,ClientLease*> client_lease_map;
-  std::map<int, std::unique_ptr<BatchOp>> batch_ops;
+  mempool::mds_co::compact_map<int, std::unique_ptr<BatchOp>> batch_ops;
 
 
 protected:
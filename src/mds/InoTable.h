@@ -41,6 +41,9 @@ class InoTable : public MDSTable {
   void replay_reset();
   bool repair(inodeno_t id);
   bool is_marked_free(inodeno_t id) const;
+  bool is_projected_free(inodeno_t id) const {
+    return projected_free.contains(id);
+  }
   bool intersects_free(
       const interval_set<inodeno_t> &other,
       interval_set<inodeno_t> *intersection);
@@ -2291,6 +2291,16 @@ int Locker::issue_caps(CInode *in, Capability *only_cap)
   // count conflicts with
   int nissued = 0;        
 
+  // the same for all the caps of the inode, and the realm is found by
+  // walking up the ancestors: with many clients only do that once
+  const int likes = in->get_caps_liked();
+  inodeno_t realm_ino = 0;
+  auto get_realm_ino = [&realm_ino, in] {
+    if (!realm_ino)
+      realm_ino = in->find_snaprealm()->inode->ino();
+    return realm_ino;
+  };
+
   // client caps
   map<client_t, Capability>::iterator it;
   if (only_cap)
@@ -2355,7 +2365,7 @@ int Locker::issue_caps(CInode *in, Capability *only_cap)
 		<< " seq " << seq << " re-issue " << ccap_string(pending) << dendl;
 
 	auto m = make_message<MClientCaps>(CEPH_CAP_OP_GRANT, in->ino(),
-					   in->find_snaprealm()->inode->ino(),
+					   get_realm_ino(),
 					   cap->get_cap_id(), cap->get_last_seq(),
 					   pending, wanted, 0, cap->get_mseq(),
 					   mds->get_osd_epoch_barrier());
@@ -2378,7 +2388,6 @@ int Locker::issue_caps(CInode *in, Capability *only_cap)
       nissued++;
 
       // include caps that clients generally like, while we're at it.
-      int likes = in->get_caps_liked();      
       int before = pending;
       long seq;
       if (pending & ~allowed)
@@ -2400,7 +2409,7 @@ int Locker::issue_caps(CInode *in, Capability *only_cap)
       }
 
       auto m = make_message<MClientCaps>(op, in->ino(),
-					 in->find_snaprealm()->inode->ino(),
+					 get_realm_ino(),
 					 cap->get_cap_id(), cap->get_last_seq(),
 					 after, wanted, 0, cap->get_mseq(),
 					 mds->get_osd_epoch_barrier());
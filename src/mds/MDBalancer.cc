@@ -845,6 +845,17 @@ void MDBalancer::try_rebalance(balance_state_t& state)
     return;
   }
 
+  // the subtrees imported long enough ago can move again
+  auto cooldown = std::chrono::duration_cast<clock::duration>(
+    std::chrono::duration<double>(g_conf().get_val<double>("mds_bal_import_cooldown")));
+  auto now = clock::now();
+  for (auto p = recent_imports.begin(); p != recent_imports.end(); ) {
+    if (p->second + cooldown <= now)
+      p = recent_imports.erase(p);
+    else
+      ++p;
+  }
+
   // make a sorted list of my imports
   multimap<double, CDir*> import_pop_map;
   multimap<mds_rank_t, pair<CDir*, double> > import_from_map;
@@ -857,6 +868,12 @@ void MDBalancer::try_rebalance(balance_state_t& state)
       continue;
     if (dir->is_freezing() || dir->is_frozen())
       continue;  // export pbly already in progress
+    if (is_recent_import(dir)) {
+      // its children may still go, find_exports() looks into it below
+      dout(15) << "  map: i recently imported " << *dir << dendl;
+      import_pop_map.insert(make_pair(dir->pop_auth_subtree.meta_load(), dir));
+      continue;
+    }
 
     mds_rank_t from = diri->authority().first;
     double pop = dir->pop_auth_subtree.meta_load();
@@ -947,7 +964,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
     for (auto p = import_pop_map.begin();
 	 p != import_pop_map.end(); ) {
       CDir *dir = p->second;
-      if (dir->inode->is_base()) {
+      if (dir->inode->is_base() || is_recent_import(dir)) {
 	++p;
 	continue;
       }
@@ -1301,6 +1318,7 @@ void MDBalancer::subtract_export(CDir *dir)
 void MDBalancer::add_import(CDir *dir)
 {
   dirfrag_load_vec_t subload = dir->pop_auth_subtree;
+  recent_imports[dir->dirfrag()] = clock::now();
 
   while (true) {
     dir = dir->inode->get_parent_dir();
@@ -135,6 +135,13 @@ private:
   time rebalance_time = clock::zero(); //ensure a consistent view of load for rebalance
 
   time last_get_load = clock::zero();
+
+  // when the subtrees were imported, they are not exported again before
+  // mds_bal_import_cooldown is over
+  map<dirfrag_t, time> recent_imports;
+  bool is_recent_import(CDir *dir) const {
+    return recent_imports.count(dir->dirfrag());
+  }
   uint64_t last_num_requests = 0;
   uint64_t last_cpu_time = 0;
 
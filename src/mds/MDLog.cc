@@ -364,6 +364,15 @@ void MDLog::_submit_thread()
 
     map<uint64_t,list<PendingEvent> >::iterator it = pending_events.begin();
     if (it == pending_events.end()) {
+      if (deferred_flushes) {
+	// the queue is drained, write the events of the put off flushes
+	deferred_flushes = 0;
+	locker.unlock();
+	journaler->flush();
+	locker.lock();
+	unflushed = 0;
+	continue;
+      }
       submit_cond.wait(locker);
       continue;
     }
@@ -377,6 +386,18 @@ void MDLog::_submit_thread()
     PendingEvent data = it->second.front();
     it->second.pop_front();
 
+    /* group commit: while events are queued behind a flush, they join the
+     * journal write of a later flush rather than each one making its own */
+    bool flush = data.flush;
+    if (flush &&
+	(!it->second.empty() || std::next(it) != pending_events.end()) &&
+	deferred_flushes < g_conf().get_val<uint64_t>("mds_log_group_commit_max")) {
+      deferred_flushes++;
+      flush = false;
+    } else if (flush) {
+      deferred_flushes = 0;
+    }
+
     locker.unlock();
 
     if (data.le) {
@@ -410,7 +431,7 @@ void MDLog::_submit_thread()
 
       journaler->wait_for_flush(fin);
 
-      if (data.flush)
+      if (flush)
 	journaler->flush();
 
       if (logger)
@@ -426,12 +447,12 @@ void MDLog::_submit_thread()
 	fin2->set_write_pos(journaler->get_write_pos());
 	journaler->wait_for_flush(fin2);
       }
-      if (data.flush)
+      if (flush)
 	journaler->flush();
     }
 
     locker.lock();
-    if (data.flush)
+    if (flush)
       unflushed = 0;
     else if (data.le)
       unflushed++;
@@ -258,6 +258,8 @@ protected:
 
   int num_events = 0; // in events
   int unflushed = 0;
+  // flushes the submit thread put off while more events were queued
+  uint64_t deferred_flushes = 0;
   bool capped = false;
 
   // Log position which is persistent *and* for which
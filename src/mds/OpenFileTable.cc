@@ -761,6 +761,16 @@ void OpenFileTable::_load_finish(int op_r, int header_r, int values_r,
       ++omap_num_items[idx];
   };
 
+  ceph_assert(num_load_reads > 0);
+  --num_load_reads;
+  if (load_err < 0) {
+    // an object failed to load, wait for the other reads to drain
+    err = load_err;
+    if (num_load_reads > 0)
+      return;
+    goto out;
+  }
+
   if (op_r < 0) {
     derr << __func__ << " got " << cpp_strerror(op_r) << dendl;
     err = op_r;
@@ -841,26 +851,20 @@ void OpenFileTable::_load_finish(int op_r, int header_r, int values_r,
     goto out;
   }
 
-  if (more || idx + 1 < omap_num_objs) {
+  if (more) {
     // Issue another read if we're not at the end of the omap
-    std::string last_key;
-    if (more)
-      last_key = values.rbegin()->first;
-    else
-      idx++;
-    dout(10) << __func__ << ": continue to load from '" << last_key << "'" << dendl;
-    object_t oid = get_object_name(idx);
-    object_locator_t oloc(mds->mdsmap->get_metadata_pool());
-    C_IO_OFT_Load *c = new C_IO_OFT_Load(this, idx, !more);
-    ObjectOperation op;
-    if (!more)
-      op.omap_get_header(&c->header_bl, &c->header_r);
-    op.omap_get_vals(last_key, "", uint64_t(-1),
-		     &c->values, &c->more, &c->values_r);
-    mds->objecter->read(oid, oloc, op, CEPH_NOSNAP, nullptr, 0,
-			new C_OnFinisher(c, mds->finisher));
-    return;
+    dout(10) << __func__ << ": continue to load object " << idx
+	     << " from '" << values.rbegin()->first << "'" << dendl;
+    _issue_load(idx, false, values.rbegin()->first);
   }
+  // the header of the first object tells how many there are: read all the
+  // others at once
+  for (; load_next_idx < omap_num_objs; ++load_next_idx) {
+    dout(10) << __func__ << ": load object " << load_next_idx << dendl;
+    _issue_load(load_next_idx, true, "");
+  }
+  if (num_load_reads > 0)
+    return;
 
   // replay journal
   if (loaded_journals.size() > 0) {
@@ -957,8 +961,13 @@ void OpenFileTable::_load_finish(int op_r, int header_r, int values_r,
   dout(10) << __func__ << ": load complete" << dendl;
 out:
 
-  if (err < 0)
+  if (err < 0) {
+    if (num_load_reads > 0) {
+      load_err = err;
+      return;
+    }
     _reset_states();
+  }
 
   load_done = true;
   finish_contexts(g_ceph_context, waiting_for_load);
@@ -972,15 +981,24 @@ void OpenFileTable::load(MDSContext *onload)
   if (onload)
     waiting_for_load.push_back(onload);
 
-  C_IO_OFT_Load *c = new C_IO_OFT_Load(this, 0, true);
-  object_t oid = get_object_name(0);
+  load_next_idx = 1;
+  _issue_load(0, true, "");
+}
+
+void OpenFileTable::_issue_load(unsigned idx, bool first,
+				const std::string& last_key)
+{
+  C_IO_OFT_Load *c = new C_IO_OFT_Load(this, idx, first);
+  object_t oid = get_object_name(idx);
   object_locator_t oloc(mds->mdsmap->get_metadata_pool());
 
   ObjectOperation op;
-  op.omap_get_header(&c->header_bl, &c->header_r);
-  op.omap_get_vals("", "", uint64_t(-1),
+  if (first)
+    op.omap_get_header(&c->header_bl, &c->header_r);
+  op.omap_get_vals(last_key, "", uint64_t(-1),
 		   &c->values, &c->more, &c->values_r);
 
+  ++num_load_reads;
   mds->objecter->read(oid, oloc, op, CEPH_NOSNAP, nullptr, 0,
 		      new C_OnFinisher(c, mds->finisher));
 }
@@ -97,6 +97,7 @@ protected:
     loaded_anchor_map.clear();
     loaded_dirfrags.clear();
   }
+  void _issue_load(unsigned idx, bool first, const std::string& last_key);
   void _load_finish(int op_r, int header_r, int values_r,
 		    unsigned idx, bool first, bool more,
                     bufferlist &header_bl,
@@ -134,6 +135,10 @@ protected:
   set<dirfrag_t> loaded_dirfrags;
   MDSContext::vec waiting_for_load;
   bool load_done = false;
+  // the omap objects are read in parallel once the first one is loaded
+  unsigned num_load_reads = 0;
+  unsigned load_next_idx = 0;
+  int load_err = 0;
 
   enum {
     DIR_INODES = 1,
@@ -142,6 +142,8 @@ void PurgeQueue::create_logger()
   pcb.add_u64(l_pq_executing, "pq_executing", "Purge queue tasks in flight");
   pcb.add_u64(l_pq_executing_high_water, "pq_executing_high_water", "Maximum number of executing file purges");
   pcb.add_u64(l_pq_item_in_journal, "pq_item_in_journal", "Purge item left in journal");
+  pcb.add_u64(l_pq_files_window, "pq_files_window", "Number of files purged in parallel");
+  pcb.add_u64(l_pq_eta, "pq_eta", "Estimated seconds to purge the items left in journal");
 
   logger.reset(pcb.create_perf_counters());
   g_ceph_context->get_perfcounters_collection()->add(logger.get());
@@ -391,8 +393,9 @@ bool PurgeQueue::_can_consume()
     return false;
   }
 
+  const uint64_t max_files = _get_max_files();
   dout(20) << ops_in_flight << "/" << max_purge_ops << " ops, "
-           << in_flight.size() << "/" << g_conf()->mds_max_purge_files
+           << in_flight.size() << "/" << max_files
            << " files" << dendl;
 
   if (in_flight.size() == 0 && cct->_conf->mds_max_purge_files > 0) {
@@ -409,15 +412,45 @@ bool PurgeQueue::_can_consume()
     return false;
   }
 
-  if (in_flight.size() >= cct->_conf->mds_max_purge_files) {
+  if (in_flight.size() >= max_files) {
     dout(20) << "Throttling on item limit " << in_flight.size()
-             << "/" << cct->_conf->mds_max_purge_files << dendl;
+             << "/" << max_files << dendl;
     return false;
   } else {
     return true;
   }
 }
 
+uint64_t PurgeQueue::_get_max_files() const
+{
+  const uint64_t max_files = cct->_conf->mds_max_purge_files;
+  if (max_files == 0 ||
+      cct->_conf.get_val<uint64_t>("mds_purge_target_latency_ms") == 0) {
+    return max_files;
+  }
+  return std::max<uint64_t>(max_files, files_window);
+}
+
+void PurgeQueue::_update_files_window(ceph::timespan latency)
+{
+  const auto target = std::chrono::milliseconds(
+    cct->_conf.get_val<uint64_t>("mds_purge_target_latency_ms"));
+  // small files are one op each, so the op limit bounds the window too
+  const double min_files = cct->_conf->mds_max_purge_files;
+  const double max_files = std::max<double>(min_files, max_purge_ops);
+
+  if (files_window < min_files) {
+    files_window = min_files;
+  }
+  if (latency < target) {
+    // one more item per item completed in time
+    files_window = std::min(max_files, files_window + 1.0);
+  } else {
+    files_window = std::max(min_files, files_window / 2);
+  }
+  logger->set(l_pq_files_window, _get_max_files());
+}
+
 void PurgeQueue::_go_readonly(int r)
 {
   if (readonly) return;
@@ -588,8 +621,10 @@ void PurgeQueue::_execute_item(
   ceph_assert(gather.has_subs());
 
   gather.set_finisher(new C_OnFinisher(
-                      new LambdaContext([this, expire_to](int r){
+                      new LambdaContext([this, expire_to,
+                                         start=ceph::mono_clock::now()](int r){
     std::lock_guard l(lock);
+    _update_files_window(ceph::mono_clock::now() - start);
     _execute_item_complete(expire_to);
 
     _consume();
@@ -670,6 +705,16 @@ void PurgeQueue::_execute_item_complete(
 
   logger->set(l_pq_item_in_journal, item_num);
   logger->inc(l_pq_executed);
+
+  auto now = ceph::mono_clock::now();
+  if (last_complete != ceph::mono_time()) {
+    double interval =
+      std::chrono::duration<double>(now - last_complete).count();
+    complete_interval = complete_interval > 0 ?
+      0.99 * complete_interval + 0.01 * interval : interval;
+  }
+  last_complete = now;
+  logger->set(l_pq_eta, item_num * complete_interval);
 }
 
 void PurgeQueue::update_op_limit(const MDSMap &mds_map)
@@ -90,6 +90,8 @@ enum {
   l_pq_executing_high_water,
   l_pq_executed,
   l_pq_item_in_journal,
+  l_pq_files_window,
+  l_pq_eta,
   l_pq_last
 };
 
@@ -158,6 +160,10 @@ private:
   uint32_t _calculate_ops(const PurgeItem &item) const;
 
   bool _can_consume();
+  // the number of files purged at once
+  uint64_t _get_max_files() const;
+  // adapt the files window to the latency of a purged item
+  void _update_files_window(ceph::timespan latency);
 
   // recover the journal write_pos (drop any partial written entry)
   void _recover();
@@ -220,5 +226,12 @@ private:
 
   uint64_t ops_high_water = 0;
   uint64_t files_high_water = 0;
+
+  // the files purged in parallel, grown while the items complete within
+  // mds_purge_target_latency_ms and halved when they do not
+  double files_window = 0;
+  // the mean time between two completed items, for the ETA of the queue
+  ceph::mono_time last_complete;
+  double complete_interval = 0;
 };
 #endif
@@ -3249,6 +3249,10 @@ CInode* Server::prepare_new_inode(MDRequestRef& mdr, CDir *dir, inodeno_t useino
 	     << ", " << mdr->session->info.prealloc_inos.size() << " left)"
 	     << dendl;
   } else {
+    // a client may ask for an ino it was delegated by an earlier
+    // session, only take it from the table if it is still free
+    if (useino && !mds->inotable->is_projected_free(useino))
+      useino = 0;
     mdr->alloc_ino = 
       in->inode.ino = mds->inotable->project_alloc_id(useino);
     dout(10) << "prepare_new_inode alloc " << mdr->alloc_ino << dendl;
@@ -3767,6 +3771,32 @@ CDir* Server::try_open_auth_dirfrag(CInode *diri, frag_t fg, MDRequestRef& mdr)
   return dir;
 }
 
+/*
+ * start fetching the dirfrag after fg, so that a client listing the
+ * directory finds it complete by the time it gets there.  the fetch runs
+ * while the entries of fg are sent out.
+ */
+void Server::prefetch_next_dirfrag(CInode *diri, frag_t fg)
+{
+  if (fg.is_rightmost() ||
+      !g_conf().get_val<bool>("mds_readdir_prefetch_next_frag"))
+    return;
+
+  frag_t next = diri->dirfragtree[fg.next().value()];
+  CDir *dir = diri->get_dirfrag(next);
+  if (!dir) {
+    if (!diri->is_auth() || diri->is_frozen())
+      return;
+    dir = diri->get_or_open_dirfrag(mdcache, next);
+  }
+  if (!dir->is_auth() || dir->is_complete() || dir->is_frozen() ||
+      !dir->can_auth_pin())
+    return;
+
+  dout(10) << __func__ << " " << *dir << dendl;
+  dir->fetch(nullptr);
+}
+
 
 // ===============================================================================
 // STAT
@@ -4717,6 +4747,9 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
 
   // bump popularity.  NOTE: this doesn't quite capture it.
   mds->balancer->hit_dir(dir, META_POP_IRD, -1, numfiles);
+
+  if (start)
+    prefetch_next_dirfrag(diri, dir->get_frag());
   
   // reply
   mdr->tracei = diri;
@@ -189,6 +189,7 @@ public:
 	    rdlock_two_paths_xlock_destdn(MDRequestRef& mdr, bool xlock_srcdn);
 
   CDir* try_open_auth_dirfrag(CInode *diri, frag_t fg, MDRequestRef& mdr);
+  void prefetch_next_dirfrag(CInode *diri, frag_t fg);
 
   // requests on existing inodes.
   void handle_client_getattr(MDRequestRef& mdr, bool is_lookup);
@@ -7,12 +7,19 @@
 
 class MConfig : public Message {
 public:
-  static constexpr int HEAD_VERSION = 1;
+  static constexpr int HEAD_VERSION = 2;
   static constexpr int COMPAT_VERSION = 1;
 
   // use transparent comparator so we can lookup in it by std::string_view keys
   std::map<std::string,std::string,std::less<>> config;
 
+  // the version of the config of the mon
+  version_t version = 0;
+  // if set, config is the changed options since the last MConfig of the
+  // session, and removed the options dropped since
+  bool incremental = false;
+  std::set<std::string> removed;
+
   MConfig() : Message{MSG_CONFIG, HEAD_VERSION, COMPAT_VERSION} { }
   MConfig(const std::map<std::string,std::string,std::less<>>& c)
     : Message{MSG_CONFIG, HEAD_VERSION, COMPAT_VERSION},
@@ -25,18 +32,39 @@ public:
     return "config";
   }
   void print(std::ostream& o) const override {
-    o << "config(" << config.size() << " keys" << ")";
+    o << "config(";
+    if (incremental) {
+      o << "inc " << config.size() << " changed " << removed.size()
+	<< " removed";
+    } else {
+      o << config.size() << " keys";
+    }
+    o << " v" << version << ")";
   }
 
   void decode_payload() override {
     using ceph::decode;
     auto p = payload.cbegin();
     decode(config, p);
+    if (header.version >= 2) {
+      decode(version, p);
+      decode(incremental, p);
+      decode(removed, p);
+    }
   }
 
-  void encode_payload(uint64_t) override {
+  void encode_payload(uint64_t features) override {
     using ceph::encode;
+    header.version = HEAD_VERSION;
     encode(config, payload);
+    if (!HAVE_FEATURE(features, SERVER_PACIFIC)) {
+      ceph_assert(!incremental);
+      header.version = 1;
+      return;
+    }
+    encode(version, payload);
+    encode(incremental, payload);
+    encode(removed, payload);
   }
 
 };
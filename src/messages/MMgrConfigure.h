@@ -25,7 +25,7 @@
  */
 class MMgrConfigure : public Message {
 private:
-  static constexpr int HEAD_VERSION = 4;
+  static constexpr int HEAD_VERSION = 5;
   static constexpr int COMPAT_VERSION = 1;
 
 public:
@@ -38,6 +38,9 @@ public:
 
   boost::optional<MetricConfigMessage> metric_config_message;
 
+  // the mgr can decode MMgrReport::packed struct_v 2
+  bool compact_reports = false;
+
   void decode_payload() override
   {
     using ceph::decode;
@@ -52,6 +55,9 @@ public:
     if (header.version >= 4) {
       decode(metric_config_message, p);
     }
+    if (header.version >= 5) {
+      decode(compact_reports, p);
+    }
   }
 
   void encode_payload(uint64_t features) override {
@@ -60,6 +66,7 @@ public:
     encode(stats_threshold, payload);
     encode(osd_perf_metric_queries, payload);
     encode(metric_config_message, payload);
+    encode(compact_reports, payload);
   }
 
   std::string_view get_type_name() const override { return "mgrconfigure"; }
@@ -93,8 +93,27 @@ public:
   // Decode: iterate over the types we know about, sorted by idx,
   // and use the current type's type to decide how to decode
   // the next bytes from the ceph::buffer::list.
+  //
+  // With struct_v 2 (if the mgr asked for compact reports) only the
+  // counters that changed since the previous report are included: the
+  // number of changed counters, then a blob with, for each of them, the
+  // varint number of unchanged counters skipped before it and the
+  // zigzag varint differences of its values to the ones sent last.
   ceph::buffer::list packed;
 
+  static void encode_counter_delta(
+    uint64_t cur, uint64_t last,
+    ceph::buffer::list::contiguous_appender& p) {
+    int64_t d = cur - last;
+    denc_varint((uint64_t(d) << 1) ^ uint64_t(d >> 63), p);
+  }
+  static uint64_t decode_counter_delta(
+    uint64_t last, ceph::buffer::ptr::const_iterator& p) {
+    uint64_t z;
+    denc_varint(z, p);
+    return last + ((z >> 1) ^ -(z & 1));
+  }
+
   std::string daemon_name;
   std::string service_name;  // optional; otherwise infer from entity type
 
@@ -23,7 +23,7 @@
 
 class MMonMgrReport : public PaxosServiceMessage {
 private:
-  static constexpr int HEAD_VERSION = 2;
+  static constexpr int HEAD_VERSION = 3;
   static constexpr int COMPAT_VERSION = 1;
 
 public:
@@ -31,6 +31,10 @@ public:
   health_check_map_t health_checks;
   ceph::buffer::list service_map_bl;  // encoded ServiceMap
   std::map<std::string,ProgressEvent> progress_events;
+  /// sequence number of the digest in our data payload
+  version_t digest_seq = 0;
+  /// if set, the payload is a PGMapDigest delta against this digest_seq
+  version_t digest_base = 0;
 
   MMonMgrReport()
     : PaxosServiceMessage{MSG_MON_MGR_REPORT, 0, HEAD_VERSION, COMPAT_VERSION}
@@ -43,7 +47,11 @@ public:
 
   void print(std::ostream& out) const override {
     out << get_type_name() << "(" << health_checks.checks.size() << " checks, "
-	<< progress_events.size() << " progress events)";
+	<< progress_events.size() << " progress events";
+    if (digest_base) {
+      out << ", digest delta " << digest_base << ".." << digest_seq;
+    }
+    out << ")";
   }
 
   void encode_payload(uint64_t features) override {
@@ -52,9 +60,12 @@ public:
     encode(health_checks, payload);
     encode(service_map_bl, payload);
     encode(progress_events, payload);
+    encode(digest_seq, payload);
+    encode(digest_base, payload);
 
-    if (!HAVE_FEATURE(features, SERVER_NAUTILUS) ||
-	!HAVE_FEATURE(features, SERVER_MIMIC)) {
+    if (!digest_base &&
+	(!HAVE_FEATURE(features, SERVER_NAUTILUS) ||
+	 !HAVE_FEATURE(features, SERVER_MIMIC))) {
       // PGMapDigest had a backwards-incompatible change between
       // luminous and mimic, and conditionally encodes based on
       // provided features, so reencode the one in our data payload.
@@ -79,6 +90,10 @@ public:
     if (header.version >= 2) {
       decode(progress_events, p);
     }
+    if (header.version >= 3) {
+      decode(digest_seq, p);
+      decode(digest_base, p);
+    }
   }
 private:
   template<class T, typename... Args>
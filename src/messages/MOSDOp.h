@@ -299,8 +299,7 @@ struct ceph_osd_request_head {
       //::encode(ops, payload);
       __u16 num_ops = ops.size();
       encode(num_ops, payload);
-      for (unsigned i = 0; i < ops.size(); i++)
-	encode(ops[i].op, payload);
+      OSDOp::encode_op_vector(ops, payload);
 
       ceph::encode_nohead(hobj.oid.name, payload);
       ceph::encode_nohead(snaps, payload);
@@ -318,8 +317,7 @@ struct ceph_osd_request_head {
 
       __u16 num_ops = ops.size();
       encode(num_ops, payload);
-      for (unsigned i = 0; i < ops.size(); i++)
-        encode(ops[i].op, payload);
+      OSDOp::encode_op_vector(ops, payload);
 
       encode(hobj.snap, payload);
       encode(snap_seq, payload);
@@ -349,8 +347,7 @@ struct ceph_osd_request_head {
 
       __u16 num_ops = ops.size();
       encode(num_ops, payload);
-      for (unsigned i = 0; i < ops.size(); i++)
-	encode(ops[i].op, payload);
+      OSDOp::encode_op_vector(ops, payload);
 
       encode(hobj.snap, payload);
       encode(snap_seq, payload);
@@ -379,8 +376,7 @@ struct ceph_osd_request_head {
 
       __u16 num_ops = ops.size();
       encode(num_ops, payload);
-      for (unsigned i = 0; i < ops.size(); i++)
-	encode(ops[i].op, payload);
+      OSDOp::encode_op_vector(ops, payload);
 
       encode(hobj.snap, payload);
       encode(snap_seq, payload);
@@ -31,7 +31,7 @@
 
 class MOSDOpReply : public Message {
 private:
-  static constexpr int HEAD_VERSION = 8;
+  static constexpr int HEAD_VERSION = 9;
   static constexpr int COMPAT_VERSION = 2;
 
   object_t oid;
@@ -47,6 +47,9 @@ private:
   int32_t retry_attempt = -1;
   bool do_redirect;
   request_redirect_t redirect;
+  // for CEPH_OSD_FLAG_TRACE_STAGES: usec from receipt to dispatch, from
+  // dispatch to dequeue, and from dequeue to the reply
+  std::vector<uint32_t> stage_usec;
 
 public:
   const object_t& get_oid() const { return oid; }
@@ -96,6 +99,9 @@ public:
 
   void add_flags(int f) { flags |= f; }
 
+  void set_stage_usec(std::vector<uint32_t>&& v) { stage_usec = std::move(v); }
+  const std::vector<uint32_t>& get_stage_usec() const { return stage_usec; }
+
   void claim_op_out_data(std::vector<OSDOp>& o) {
     ceph_assert(ops.size() == o.size());
     for (unsigned i = 0; i < o.size(); i++) {
@@ -187,9 +193,7 @@ public:
       head.num_ops = ops.size();
       head.object_len = oid.name.length();
       encode(head, payload);
-      for (unsigned i = 0; i < head.num_ops; i++) {
-	encode(ops[i].op, payload);
-      }
+      OSDOp::encode_op_vector(ops, payload);
       ceph::encode_nohead(oid.name, payload);
     } else {
       header.version = HEAD_VERSION;
@@ -202,13 +206,11 @@ public:
 
       __u32 num_ops = ops.size();
       encode(num_ops, payload);
-      for (unsigned i = 0; i < num_ops; i++)
-	encode(ops[i].op, payload);
+      OSDOp::encode_op_vector(ops, payload);
 
       encode(retry_attempt, payload);
 
-      for (unsigned i = 0; i < num_ops; i++)
-	encode(ops[i].rval, payload);
+      OSDOp::encode_rval_vector(ops, payload);
 
       encode(replay_version, payload);
       encode(user_version, payload);
@@ -223,6 +225,7 @@ public:
         }
       }
       encode_trace(payload, features);
+      encode(stage_usec, payload);
     }
   }
   void decode_payload() override {
@@ -256,6 +259,7 @@ public:
       if (do_redirect)
 	decode(redirect, p);
       decode_trace(p);
+      decode(stage_usec, p);
     } else if (header.version < 2) {
       ceph_osd_reply_head head;
       decode(head, p);
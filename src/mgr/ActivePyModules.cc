@@ -18,6 +18,7 @@
 #include "include/stringify.h"
 
 #include "PyFormatter.h"
+#include "PyPGStatColumns.h"
 
 #include "osd/OSDMap.h"
 #include "mon/MonMap.h"
@@ -376,6 +377,10 @@ PyObject *ActivePyModules::get_python(const std::string &what)
       pg_map.dump_pg_stats(&f, false);
     });
     return f.get();
+  } else if (what == "pg_stats_columns") {
+    auto cols = cluster_state.get_pg_stat_columns();
+    PyEval_RestoreThread(tstate);
+    return pg_stat_columns_to_python(std::move(cols));
   } else if (what == "pool_stats") {
     cluster_state.with_pgmap(
         [&f, &tstate](const PGMap &pg_map) {
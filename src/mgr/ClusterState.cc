@@ -117,6 +117,15 @@ void ClusterState::ingest_pgstats(ref_t<MPGStats> stats)
   }
 }
 
+std::shared_ptr<const PGStatColumns> ClusterState::get_pg_stat_columns() const
+{
+  std::lock_guard l(lock);
+  if (!pg_stat_columns || pg_stat_columns->version != pg_map.version) {
+    pg_stat_columns = std::make_shared<const PGStatColumns>(pg_map);
+  }
+  return pg_stat_columns;
+}
+
 void ClusterState::update_delta_stats()
 {
   pending_inc.stamp = ceph_clock_now();
@@ -21,6 +21,7 @@
 #include "osdc/Objecter.h"
 #include "mon/MonClient.h"
 #include "mon/PGMap.h"
+#include "mgr/PGStatColumns.h"
 #include "mgr/ServiceMap.h"
 
 class MMgrDigest;
@@ -46,6 +47,8 @@ protected:
   map<int64_t,unsigned> existing_pools; ///< pools that exist, and pg_num, as of PGMap epoch
   PGMap pg_map;
   PGMap::Incremental pending_inc;
+  /// built on demand from pg_map, see get_pg_stat_columns()
+  mutable std::shared_ptr<const PGStatColumns> pg_stat_columns;
 
   bufferlist health_json;
   bufferlist mon_status_json;
@@ -110,6 +113,9 @@ public:
     return std::forward<Callback>(cb)(pg_map, std::forward<Args>(args)...);
   }
 
+  /// columnar snapshot of the current pg stats
+  std::shared_ptr<const PGStatColumns> get_pg_stat_columns() const;
+
   template<typename... Args>
   void with_monmap(Args &&... args) const
   {
@@ -102,6 +102,15 @@ DaemonServer::~DaemonServer() {
 
 int DaemonServer::init(uint64_t gid, entity_addrvec_t client_addrs)
 {
+  auto num_report_workers =
+    g_conf().get_val<uint64_t>("mgr_report_workers");
+  for (unsigned i = 0; i < num_report_workers; ++i) {
+    report_workers.push_back(std::make_unique<Finisher>(
+      g_ceph_context, "DaemonServer::report_workers",
+      "mgr-report-" + stringify(i)));
+    report_workers.back()->start();
+  }
+
   // Initialize Messenger
   std::string public_msgr_type = g_conf()->ms_public_type.empty() ?
     g_conf().get_val<std::string>("ms_type") : g_conf()->ms_public_type;
@@ -369,6 +378,10 @@ void DaemonServer::shutdown()
   dout(10) << "begin" << dendl;
   msgr->shutdown();
   msgr->wait();
+  for (auto& w : report_workers) {
+    w->wait_for_empty();
+    w->stop();
+  }
   cluster_state.shutdown();
   dout(10) << "done" << dendl;
 
@@ -564,10 +577,10 @@ bool DaemonServer::handle_report(const ref_t<MMgrReport>& m)
   }
 
 
+  DaemonStatePtr daemon;
   {
     std::unique_lock locker(lock);
 
-    DaemonStatePtr daemon;
     // Look up the DaemonState
     if (daemon_state.exists(key)) {
       dout(20) << "updating existing DaemonState for " << key << dendl;
@@ -610,8 +623,7 @@ bool DaemonServer::handle_report(const ref_t<MMgrReport>& m)
     ceph_assert(daemon != nullptr);
     {
       std::lock_guard l(daemon->lock);
-      auto &daemon_counters = daemon->perf_counters;
-      daemon_counters.update(*m.get());
+      daemon->perf_counters.declare(*m.get());
 
       auto p = m->config_bl.cbegin();
       if (p != m->config_bl.end()) {
@@ -645,9 +657,27 @@ bool DaemonServer::handle_report(const ref_t<MMgrReport>& m)
     }
   }
 
-  // if there are any schema updates, notify the python modules
-  if (!m->declare_types.empty() || !m->undeclare_types.empty()) {
-    py_modules.notify_all("perf_schema_update", ceph::to_string(key));
+  // the perf counters are the bulk of a report: decode them off the
+  // dispatch thread, in order for each daemon
+  auto update_counters = [this, m, daemon, key] {
+    {
+      std::lock_guard l(daemon->lock);
+      daemon->perf_counters.update(*m.get());
+    }
+    // if there are any schema updates, notify the python modules
+    if (!m->declare_types.empty() || !m->undeclare_types.empty()) {
+      py_modules.notify_all("perf_schema_update", ceph::to_string(key));
+    }
+  };
+  if (report_workers.empty()) {
+    update_counters();
+  } else {
+    auto shard = std::hash<std::string>{}(ceph::to_string(key)) %
+      report_workers.size();
+    report_workers[shard]->queue(new LambdaContext(
+      [update_counters](int r) {
+	update_counters();
+      }));
   }
 
   if (m->get_connection()->peer_is_osd()) {
@@ -2373,6 +2403,31 @@ void DaemonServer::_prune_pending_service_map()
   }
 }
 
+void DaemonServer::_encode_digest(const PGMapDigest& digest,
+				  MMonMgrReport *m)
+{
+  auto full_interval = g_conf().get_val<uint64_t>("mgr_digest_full_interval");
+  bool delta = last_digest_seq &&
+    digests_since_full + 1 < full_interval &&
+    monc->with_monmap([](const MonMap& monmap) {
+      return monmap.min_mon_release >= ceph_release_t::pacific;
+    });
+  bufferlist bl;
+  m->digest_seq = ++last_digest_seq;
+  if (delta) {
+    digest.encode_delta(last_digest, bl, CEPH_FEATURES_ALL);
+    m->digest_base = m->digest_seq - 1;
+    ++digests_since_full;
+  } else {
+    digest.encode(bl, CEPH_FEATURES_ALL);
+    digests_since_full = 0;
+  }
+  dout(20) << __func__ << " " << (delta ? "delta" : "full") << " digest "
+	   << m->digest_seq << ", " << bl.length() << " bytes" << dendl;
+  m->set_data(bl);
+  last_digest = digest;
+}
+
 void DaemonServer::send_report()
 {
   if (!pgmap_ready) {
@@ -2409,7 +2464,8 @@ void DaemonServer::send_report()
       cluster_state.with_osdmap([&](const OSDMap& osdmap) {
 	  // FIXME: no easy way to get mon features here.  this will do for
 	  // now, though, as long as we don't make a backward-incompat change.
-	  pg_map.encode_digest(osdmap, m->get_data(), CEPH_FEATURES_ALL);
+	  pg_map.calc_digest(osdmap);
+	  _encode_digest(pg_map, m.get());
 	  dout(10) << pg_map << dendl;
 
 	  pg_map.get_health_checks(g_ceph_context, osdmap,
@@ -2877,6 +2933,8 @@ void DaemonServer::_send_configure(ConnectionRef c)
   auto configure = make_message<MMgrConfigure>();
   configure->stats_period = g_conf().get_val<int64_t>("mgr_stats_period");
   configure->stats_threshold = g_conf().get_val<int64_t>("mgr_stats_threshold");
+  configure->compact_reports =
+    g_conf().get_val<bool>("mgr_compact_perf_reports");
 
   if (c->peer_is_osd()) {
     configure->osd_perf_metric_queries =
@@ -27,6 +27,7 @@
 #include <msg/Messenger.h>
 #include <mon/MonClient.h>
 
+#include "mon/PGMap.h"
 #include "ServiceMap.h"
 #include "MgrSession.h"
 #include "DaemonState.h"
@@ -63,6 +64,8 @@ protected:
   Messenger *msgr;
   MonClient *monc;
   Finisher  &finisher;
+  /// decode perf counters of MMgrReports, sharded by daemon
+  std::vector<std::unique_ptr<Finisher>> report_workers;
   DaemonStateIndex &daemon_state;
   ClusterState &cluster_state;
   PyModuleRegistry &py_modules;
@@ -79,6 +82,12 @@ protected:
 
   epoch_t pending_service_map_dirty = 0;
 
+  /// last PGMapDigest sent to the mon, the base of the next delta
+  PGMapDigest last_digest;
+  version_t last_digest_seq = 0;
+  unsigned digests_since_full = 0;
+  void _encode_digest(const PGMapDigest& digest, MMonMgrReport *m);
+
   ceph::mutex lock = ceph::make_mutex("DaemonServer");
 
   static void _generate_command_map(cmdmap_t& cmdmap,
@@ -14,6 +14,7 @@
 #include "DaemonState.h"
 
 #include <experimental/iterator>
+#include <optional>
 
 #include "MgrSession.h"
 #include "include/stringify.h"
@@ -309,10 +310,10 @@ void DaemonPerfCounters::update(const MMgrReport& report)
   auto priv = report.get_connection()->get_priv();
   auto session = static_cast<MgrSession*>(priv.get());
 
-  // Load any newly declared types
+  // Load any newly declared types; they went to the shared types
+  // already, see declare()
   for (const auto &t : report.declare_types) {
-    types.insert(std::make_pair(t.path, t));
-    session->declared_types.insert(t.path);
+    session->declared_types[t.path] = {t.type};
   }
   // Remove any old types
   for (const auto &t : report.undeclare_types) {
@@ -323,9 +324,24 @@ void DaemonPerfCounters::update(const MMgrReport& report)
 
   // Parse packed data according to declared set of types
   auto p = report.packed.cbegin();
-  DECODE_START(1, p);
-  for (const auto &t_path : session->declared_types) {
-    const auto &t = types.at(t_path);
+  DECODE_START(2, p);
+  uint32_t num_changed = 0;
+  bufferlist changed;
+  ceph::buffer::ptr changed_bp;
+  std::optional<ceph::buffer::ptr::const_iterator> q;
+  uint64_t next_changed = 0;
+  if (struct_v >= 2) {
+    decode(num_changed, p);
+    decode(changed, p);
+    if (num_changed) {
+      changed.rebuild();
+      changed_bp = changed.front();
+      q.emplace(changed_bp.cbegin());
+      denc_varint(next_changed, *q);
+    }
+  }
+  uint64_t pos = 0;
+  for (auto &[t_path, t] : session->declared_types) {
     auto instances_it = instances.find(t_path);
     // Always check the instance exists, as we don't prevent yet
     // multiple sessions from daemons with the same name, and one
@@ -333,22 +349,46 @@ void DaemonPerfCounters::update(const MMgrReport& report)
     if (instances_it == instances.end()) {
       instances_it = instances.insert({t_path, t.type}).first;
     }
-    uint64_t val = 0;
-    uint64_t avgcount = 0;
-    uint64_t avgcount2 = 0;
-
-    decode(val, p);
+    auto &v = t.last;
+    if (struct_v < 2) {
+      decode(v[0], p);
+      if (t.type & PERFCOUNTER_LONGRUNAVG) {
+	decode(v[1], p);
+	decode(v[2], p);
+      }
+    } else if (num_changed && pos == next_changed) {
+      // unchanged counters repeat what they had
+      v[0] = MMgrReport::decode_counter_delta(v[0], *q);
+      if (t.type & PERFCOUNTER_LONGRUNAVG) {
+	v[1] = MMgrReport::decode_counter_delta(v[1], *q);
+	v[2] = MMgrReport::decode_counter_delta(v[2], *q);
+      }
+      if (--num_changed) {
+	uint32_t skip;
+	denc_varint(skip, *q);
+	next_changed = pos + 1 + skip;
+      }
+    }
     if (t.type & PERFCOUNTER_LONGRUNAVG) {
-      decode(avgcount, p);
-      decode(avgcount2, p);
-      instances_it->second.push_avg(now, val, avgcount);
+      instances_it->second.push_avg(now, v[0], v[1]);
     } else {
-      instances_it->second.push(now, val);
+      instances_it->second.push(now, v[0]);
     }
+    ++pos;
+  }
+  if (num_changed) {
+    throw ceph::buffer::malformed_input("changed counters past the last");
   }
   DECODE_FINISH(p);
 }
 
+void DaemonPerfCounters::declare(const MMgrReport& report)
+{
+  for (const auto &t : report.declare_types) {
+    types.insert(std::make_pair(t.path, t));
+  }
+}
+
 void PerfCounterInstance::push(utime_t t, uint64_t const &v)
 {
   buffer.push_back({t, v});
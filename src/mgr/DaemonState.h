@@ -109,6 +109,8 @@ class DaemonPerfCounters
   std::map<std::string, PerfCounterInstance> instances;
 
   void update(const MMgrReport& report);
+  /// add the types @p report declares to the ones shared by all daemons
+  void declare(const MMgrReport& report);
 
   void clear()
   {
@@ -322,16 +322,24 @@ void MgrClient::_send_report()
       session->declared.erase(path);
     };
 
-    ENCODE_START(1, 1, report->packed);
+    const bool compact = session->compact_reports;
+    ENCODE_START(compact ? 2 : 1, compact ? 2 : 1, report->packed);
 
     // Find counters that no longer exist, and undeclare them
     for (auto p = session->declared.begin(); p != session->declared.end(); ) {
-      const auto &path = *(p++);
+      const auto &path = (p++)->first;
       if (by_path.count(path) == 0) {
         undeclare(path);
       }
     }
 
+    // compact: skip counts and value differences of changed counters
+    uint32_t num_changed = 0;
+    uint32_t num_skipped = 0;
+    bufferlist changed;
+    {
+    auto app = changed.get_contiguous_appender(
+      compact ? by_path.size() * 4 * (sizeof(uint64_t) + 2) : 0);
     for (const auto &i : by_path) {
       auto& path = i.first;
       auto& data = *(i.second.data);
@@ -346,7 +354,8 @@ void MgrClient::_send_report()
         continue;
       }
 
-      if (session->declared.count(path) == 0) {
+      auto declared = session->declared.find(path);
+      if (declared == session->declared.end()) {
 	ldout(cct,20) << " declare " << path << dendl;
 	PerfCounterType type;
 	type.path = path;
@@ -360,14 +369,42 @@ void MgrClient::_send_report()
        type.priority = perf_counters.get_adjusted_priority(data.prio);
 	type.unit = data.unit;
 	report->declare_types.push_back(std::move(type));
-	session->declared.insert(path);
+	declared = session->declared.emplace(
+	  path, std::array<uint64_t, 3>{}).first;
       }
 
-      encode(static_cast<uint64_t>(data.u64), report->packed);
+      auto& last = declared->second;
+      std::array<uint64_t, 3> cur = {0, 0, 0};
       if (data.type & PERFCOUNTER_LONGRUNAVG) {
-        encode(static_cast<uint64_t>(data.avgcount), report->packed);
-        encode(static_cast<uint64_t>(data.avgcount2), report->packed);
+	auto a = data.read_avg();
+	cur = {a.first, a.second, a.second};
+      } else {
+	cur[0] = data.read_u64();
+      }
+      if (!compact) {
+        encode(cur[0], report->packed);
+        if (data.type & PERFCOUNTER_LONGRUNAVG) {
+          encode(cur[1], report->packed);
+          encode(cur[2], report->packed);
+        }
+      } else if (cur != last) {
+	denc_varint(num_skipped, app);
+	MMgrReport::encode_counter_delta(cur[0], last[0], app);
+	if (data.type & PERFCOUNTER_LONGRUNAVG) {
+	  MMgrReport::encode_counter_delta(cur[1], last[1], app);
+	  MMgrReport::encode_counter_delta(cur[2], last[2], app);
+	}
+	num_skipped = 0;
+	++num_changed;
+      } else {
+	++num_skipped;
       }
+      last = cur;
+    }
+    }
+    if (compact) {
+      encode(num_changed, report->packed);
+      encode(changed, report->packed);
     }
     ENCODE_FINISH(report->packed);
 
@@ -437,6 +474,8 @@ bool MgrClient::handle_mgr_configure(ref_t<MMgrConfigure> m)
 
   ldout(cct, 4) << "stats_period=" << m->stats_period << dendl;
 
+  session->compact_reports = m->compact_reports;
+
   if (stats_threshold != m->stats_threshold) {
     ldout(cct, 4) << "updated stats threshold: " << m->stats_threshold << dendl;
     stats_threshold = m->stats_threshold;
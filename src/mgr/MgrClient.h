@@ -40,7 +40,11 @@ class MgrSessionState
 {
   public:
   // Which performance counters have we already transmitted schema for?
-  std::set<std::string> declared;
+  // Along with the u64, avgcount and avgcount2 values sent last.
+  std::map<std::string, std::array<uint64_t, 3>> declared;
+
+  // Does the mgr take reports with only the counters that changed?
+  bool compact_reports = false;
 
   // Our connection to the mgr
   ConnectionRef con;
@@ -4,7 +4,10 @@
 #ifndef CEPH_MGR_MGRSESSION_H
 #define CEPH_MGR_MGRSESSION_H
 
+#include <array>
+
 #include "common/RefCountedObj.h"
+#include "common/perf_counters.h"
 #include "common/entity_name.h"
 #include "msg/msg_types.h"
 #include "MgrCap.h"
@@ -22,7 +25,12 @@ struct MgrSession : public RefCountedObject {
 
   MgrCap caps;
 
-  std::set<std::string> declared_types;
+  struct declared_counter_t {
+    enum perfcounter_type_d type;
+    /// u64, avgcount and avgcount2 as of the last report
+    std::array<uint64_t, 3> last = {};
+  };
+  std::map<std::string, declared_counter_t> declared_types;
 
   const entity_addr_t& get_peer_addr() const {
     return inst.addr;
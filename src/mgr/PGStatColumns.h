@@ -0,0 +1,41 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "mon/PGMap.h"
+
+/**
+ * The per-PG stats most modules care about, one array per field, so that
+ * they can be handed to python modules as buffers instead of as a dict
+ * per PG.  Entry i of each array belongs to the same PG.  Immutable once
+ * built; ClusterState rebuilds it when the PGMap version changes.
+ */
+struct PGStatColumns {
+  version_t version;  ///< PGMap version this was taken from
+  std::vector<int64_t> pool;
+  std::vector<uint32_t> ps;
+  std::vector<uint64_t> state;
+  std::vector<int64_t> num_bytes;
+  std::vector<int64_t> num_objects;
+
+  explicit PGStatColumns(const PGMap& pg_map)
+    : version(pg_map.version) {
+    auto n = pg_map.pg_stat.size();
+    pool.reserve(n);
+    ps.reserve(n);
+    state.reserve(n);
+    num_bytes.reserve(n);
+    num_objects.reserve(n);
+    for (auto& [pgid, s] : pg_map.pg_stat) {
+      pool.push_back(pgid.pool());
+      ps.push_back(pgid.ps());
+      state.push_back(s.state);
+      num_bytes.push_back(s.stats.sum.num_bytes);
+      num_objects.push_back(s.stats.sum.num_objects);
+    }
+  }
+};
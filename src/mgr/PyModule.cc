@@ -14,6 +14,7 @@
 #include "BaseMgrModule.h"
 #include "BaseMgrStandbyModule.h"
 #include "PyOSDMap.h"
+#include "PyPGStatColumns.h"
 #include "MgrContext.h"
 #include "PyUtil.h"
 
@@ -281,7 +282,8 @@ PyObject* PyModule::init_ceph_module()
      {"BaseMgrStandbyModule", &BaseMgrStandbyModuleType},
      {"BasePyOSDMap", &BasePyOSDMapType},
      {"BasePyOSDMapIncremental", &BasePyOSDMapIncrementalType},
-     {"BasePyCRUSH", &BasePyCRUSHType}}
+     {"BasePyCRUSH", &BasePyCRUSHType},
+     {"BasePyPGStatColumn", &BasePyPGStatColumnType}}
   };
   for (auto [name, type] : classes) {
     type->tp_new = PyType_GenericNew;
@@ -0,0 +1,137 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "PGStatColumns.h"
+#include "PyPGStatColumns.h"
+
+/// exports one array of a PGStatColumns through the buffer protocol
+typedef struct {
+  PyObject_HEAD
+  std::shared_ptr<const PGStatColumns> cols;
+  const void *buf;
+  Py_ssize_t shape;
+  Py_ssize_t itemsize;
+  const char *format;
+} BasePyPGStatColumn;
+
+static void
+BasePyPGStatColumn_dealloc(BasePyPGStatColumn *self)
+{
+  self->cols.reset();
+  Py_TYPE(self)->tp_free(self);
+}
+
+static int
+BasePyPGStatColumn_getbuffer(BasePyPGStatColumn *self, Py_buffer *view,
+			     int flags)
+{
+  if (!self->cols) {
+    PyErr_SetString(PyExc_BufferError, "empty column");
+    view->obj = nullptr;
+    return -1;
+  }
+  if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "column is read-only");
+    view->obj = nullptr;
+    return -1;
+  }
+  view->obj = (PyObject *)self;
+  Py_INCREF(self);
+  view->buf = const_cast<void *>(self->buf);
+  view->len = self->shape * self->itemsize;
+  view->readonly = 1;
+  view->itemsize = self->itemsize;
+  view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>(self->format) :
+    nullptr;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) ? &self->shape : nullptr;
+  view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ?
+    &self->itemsize : nullptr;
+  view->suboffsets = nullptr;
+  view->internal = nullptr;
+  return 0;
+}
+
+static PyBufferProcs BasePyPGStatColumn_as_buffer = {
+  (getbufferproc)BasePyPGStatColumn_getbuffer, /* bf_getbuffer */
+  0,                                           /* bf_releasebuffer */
+};
+
+PyTypeObject BasePyPGStatColumnType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "ceph_module.BasePyPGStatColumn", /* tp_name */
+  sizeof(BasePyPGStatColumn),     /* tp_basicsize */
+  0,                         /* tp_itemsize */
+  (destructor)BasePyPGStatColumn_dealloc,      /* tp_dealloc */
+  0,                         /* tp_print */
+  0,                         /* tp_getattr */
+  0,                         /* tp_setattr */
+  0,                         /* tp_compare */
+  0,                         /* tp_repr */
+  0,                         /* tp_as_number */
+  0,                         /* tp_as_sequence */
+  0,                         /* tp_as_mapping */
+  0,                         /* tp_hash */
+  0,                         /* tp_call */
+  0,                         /* tp_str */
+  0,                         /* tp_getattro */
+  0,                         /* tp_setattro */
+  &BasePyPGStatColumn_as_buffer, /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT,        /* tp_flags */
+  "Ceph PG stat column",     /* tp_doc */
+  0,                         /* tp_traverse */
+  0,                         /* tp_clear */
+  0,                         /* tp_richcompare */
+  0,                         /* tp_weaklistoffset */
+  0,                         /* tp_iter */
+  0,                         /* tp_iternext */
+  0,                         /* tp_methods */
+  0,                         /* tp_members */
+  0,                         /* tp_getset */
+  0,                         /* tp_base */
+  0,                         /* tp_dict */
+  0,                         /* tp_descr_get */
+  0,                         /* tp_descr_set */
+  0,                         /* tp_dictoffset */
+  0,                         /* tp_init */
+  0,                         /* tp_alloc */
+  0,     /* tp_new */
+};
+
+template<typename T>
+static PyObject *make_column(const std::shared_ptr<const PGStatColumns>& cols,
+			     const std::vector<T>& v, const char *format)
+{
+  auto c = (BasePyPGStatColumn *)BasePyPGStatColumnType.tp_alloc(
+    &BasePyPGStatColumnType, 0);
+  if (!c) {
+    return nullptr;
+  }
+  c->cols = cols;
+  c->buf = v.data();
+  c->shape = v.size();
+  c->itemsize = sizeof(T);
+  c->format = format;
+  // the memoryview holds the only reference to the exporter
+  auto view = PyMemoryView_FromObject((PyObject *)c);
+  Py_DECREF(c);
+  return view;
+}
+
+PyObject *pg_stat_columns_to_python(std::shared_ptr<const PGStatColumns> cols)
+{
+  PyObject *d = PyDict_New();
+  auto add = [d](const char *name, PyObject *o) {
+    if (o) {
+      PyDict_SetItemString(d, name, o);
+      Py_DECREF(o);
+    }
+  };
+  add("version", PyLong_FromUnsignedLongLong(cols->version));
+  add("pool", make_column(cols, cols->pool, "q"));
+  add("ps", make_column(cols, cols->ps, "I"));
+  add("state", make_column(cols, cols->state, "Q"));
+  add("num_bytes", make_column(cols, cols->num_bytes, "q"));
+  add("num_objects", make_column(cols, cols->num_objects, "q"));
+  return d;
+}
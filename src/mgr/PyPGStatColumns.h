@@ -0,0 +1,15 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <Python.h>
+
+#include <memory>
+
+struct PGStatColumns;
+
+extern PyTypeObject BasePyPGStatColumnType;
+
+/// dict of read-only memoryviews over @p cols, which they keep alive
+PyObject *pg_stat_columns_to_python(std::shared_ptr<const PGStatColumns> cols);
@@ -882,7 +882,8 @@ void ConfigMonitor::load_changeset(version_t v, ConfigChangeSet *ch)
   }
 }
 
-bool ConfigMonitor::refresh_config(MonSession *s)
+bool ConfigMonitor::refresh_config(MonSession *s,
+				   map<string,string,std::less<>> *prev)
 {
   const OSDMap& osdmap = mon->osdmon()->osdmap;
   map<string,string> crush_location;
@@ -915,6 +916,9 @@ bool ConfigMonitor::refresh_config(MonSession *s)
   }
 
   dout(20) << __func__ << " " << out << dendl;
+  if (prev && s->any_config) {
+    *prev = std::move(s->last_config);
+  }
   s->last_config = std::move(out);
   s->any_config = true;
   return true;
@@ -922,20 +926,56 @@ bool ConfigMonitor::refresh_config(MonSession *s)
 
 bool ConfigMonitor::maybe_send_config(MonSession *s)
 {
-  bool changed = refresh_config(s);
+  bool had_config = s->any_config;
+  map<string,string,std::less<>> prev;
+  bool changed = refresh_config(s, &prev);
   dout(10) << __func__ << " to " << s->name << " "
 	   << (changed ? "(changed)" : "(unchanged)")
 	   << dendl;
   if (changed) {
-    send_config(s);
+    send_config(s, had_config ? &prev : nullptr);
   }
   return changed;
 }
 
-void ConfigMonitor::send_config(MonSession *s)
+void ConfigMonitor::send_config(MonSession *s,
+				const map<string,string,std::less<>> *prev)
 {
+  // the peers decoding deltas get the options changed since the config
+  // they were sent last, instead of all of them
+  if (prev && HAVE_FEATURE(s->con_features, SERVER_PACIFIC)) {
+    auto m = new MConfig;
+    auto p = prev->begin();
+    for (auto& [name, value] : s->last_config) {
+      while (p != prev->end() && p->first < name) {
+	m->removed.insert(p->first);
+	++p;
+      }
+      if (p != prev->end() && p->first == name) {
+	if (p->second != value) {
+	  m->config.emplace(name, value);
+	}
+	++p;
+      } else {
+	m->config.emplace(name, value);
+      }
+    }
+    for (; p != prev->end(); ++p) {
+      m->removed.insert(p->first);
+    }
+    if (m->config.size() + m->removed.size() < s->last_config.size()) {
+      dout(10) << __func__ << " to " << s->name << " " << m->config.size()
+	       << " changed " << m->removed.size() << " removed" << dendl;
+      m->incremental = true;
+      m->version = version;
+      s->con->send_message(m);
+      return;
+    }
+    m->put();
+  }
   dout(10) << __func__ << " to " << s->name << dendl;
   auto m = new MConfig(s->last_config);
+  m->version = version;
   s->con->send_message(m);
 }
 
@@ -47,9 +47,11 @@ public:
   void on_active() override;
   void tick() override;
 
-  bool refresh_config(MonSession *s);
+  bool refresh_config(MonSession *s,
+		      std::map<std::string,std::string,std::less<>> *prev = nullptr);
   bool maybe_send_config(MonSession *s);
-  void send_config(MonSession *s);
+  void send_config(MonSession *s,
+		   const std::map<std::string,std::string,std::less<>> *prev = nullptr);
   void check_sub(MonSession *s);
   void check_sub(Subscription *sub);
   void check_all_subs();
@@ -136,6 +136,12 @@ void MgrStatMonitor::update_logger()
 
 }
 
+void MgrStatMonitor::on_restart()
+{
+  // pending_digest may have lost reports that were never committed
+  digest_seq = 0;
+}
+
 void MgrStatMonitor::create_pending()
 {
   dout(10) << " " << version << dendl;
@@ -219,7 +225,18 @@ bool MgrStatMonitor::prepare_report(MonOpRequestRef op)
   auto m = op->get_req<MMonMgrReport>();
   bufferlist bl = m->get_data();
   auto p = bl.cbegin();
-  decode(pending_digest, p);
+  if (!m->digest_base) {
+    decode(pending_digest, p);
+    digest_seq = m->digest_seq;
+  } else if (digest_seq && m->digest_base == digest_seq) {
+    pending_digest.decode_delta(p);
+    digest_seq = m->digest_seq;
+  } else {
+    // we missed a report, keep what we have until the next full digest
+    dout(10) << __func__ << " digest delta against " << m->digest_base
+	     << ", we have " << digest_seq << ", ignoring it" << dendl;
+    digest_seq = 0;
+  }
   pending_health_checks.swap(m->health_checks);
   if (m->service_map_bl.length()) {
     pending_service_map_bl.swap(m->service_map_bl);
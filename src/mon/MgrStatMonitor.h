@@ -20,6 +20,9 @@ class MgrStatMonitor : public PaxosService {
   health_check_map_t pending_health_checks;
   std::map<std::string,ProgressEvent> pending_progress_events;
   ceph::buffer::list pending_service_map_bl;
+  /// digest_seq of the last mgr digest applied to pending_digest, 0 if we
+  /// need a full one before mgr digest deltas can be applied
+  version_t digest_seq = 0;
 
 public:
   MgrStatMonitor(Monitor *mn, Paxos *p, const std::string& service_name);
@@ -28,6 +31,7 @@ public:
   void init() override {}
   void on_shutdown() override {}
 
+  void on_restart() override;
   void create_initial() override;
   void update_from_paxos(bool *need_bootstrap) override;
   void create_pending() override;
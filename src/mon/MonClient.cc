@@ -433,7 +433,11 @@ void MonClient::handle_config(MConfig *m)
 {
   ldout(cct,10) << __func__ << " " << *m << dendl;
   finisher.queue(new LambdaContext([this, m](int r) {
-	cct->_conf.set_mon_vals(cct, m->config, config_cb);
+	if (m->incremental) {
+	  cct->_conf.update_mon_vals(cct, m->config, m->removed, config_cb);
+	} else {
+	  cct->_conf.set_mon_vals(cct, m->config, config_cb);
+	}
 	if (config_notify_cb) {
 	  config_notify_cb();
 	}
@@ -15,6 +15,7 @@
 
 #include "include/types.h"
 #include "include/buffer.h"
+#include <deque>
 #include <set>
 #include <map>
 #include <string>
@@ -301,40 +302,49 @@ class MonitorDBStore
   };
 
   int apply_transaction(MonitorDBStore::TransactionRef t) {
+    return apply_transactions({t});
+  }
+
+  /**
+   * apply several transactions, in order, with a single sync
+   */
+  int apply_transactions(const std::vector<MonitorDBStore::TransactionRef>& ts) {
     KeyValueDB::Transaction dbt = db->get_transaction();
 
-    if (do_dump) {
-      if (!g_conf()->mon_debug_dump_json) {
-        ceph::buffer::list bl;
-        t->encode(bl);
-        bl.write_fd(dump_fd_binary);
-      } else {
-        t->dump(&dump_fmt, true);
-        dump_fmt.flush(dump_fd_json);
-        dump_fd_json.flush();
+    std::list<std::pair<std::string, std::pair<std::string,std::string>>> compact;
+    for (auto& t : ts) {
+      if (do_dump) {
+	if (!g_conf()->mon_debug_dump_json) {
+	  ceph::buffer::list bl;
+	  t->encode(bl);
+	  bl.write_fd(dump_fd_binary);
+	} else {
+	  t->dump(&dump_fmt, true);
+	  dump_fmt.flush(dump_fd_json);
+	  dump_fd_json.flush();
+	}
       }
-    }
 
-    std::list<std::pair<std::string, std::pair<std::string,std::string>>> compact;
-    for (auto it = t->ops.begin(); it != t->ops.end(); ++it) {
-      const Op& op = *it;
-      switch (op.type) {
-      case Transaction::OP_PUT:
-	dbt->set(op.prefix, op.key, op.bl);
-	break;
-      case Transaction::OP_ERASE:
-	dbt->rmkey(op.prefix, op.key);
-	break;
-      case Transaction::OP_ERASE_RANGE:
-	dbt->rm_range_keys(op.prefix, op.key, op.endkey);
-	break;
-      case Transaction::OP_COMPACT:
-	compact.push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
-	break;
-      default:
-	derr << __func__ << " unknown op type " << op.type << dendl;
-	ceph_abort();
-	break;
+      for (auto it = t->ops.begin(); it != t->ops.end(); ++it) {
+	const Op& op = *it;
+	switch (op.type) {
+	case Transaction::OP_PUT:
+	  dbt->set(op.prefix, op.key, op.bl);
+	  break;
+	case Transaction::OP_ERASE:
+	  dbt->rmkey(op.prefix, op.key);
+	  break;
+	case Transaction::OP_ERASE_RANGE:
+	  dbt->rm_range_keys(op.prefix, op.key, op.endkey);
+	  break;
+	case Transaction::OP_COMPACT:
+	  compact.push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
+	  break;
+	default:
+	  derr << __func__ << " unknown op type " << op.type << dendl;
+	  ceph_abort();
+	  break;
+	}
       }
     }
     int r = db->submit_transaction_sync(dbt);
@@ -353,35 +363,61 @@ class MonitorDBStore
     return r;
   }
 
-  struct C_DoTransaction : public Context {
+private:
+  ceph::mutex batch_lock = ceph::make_mutex("MonitorDBStore::batch_lock");
+  /// queued transactions not yet picked up by a C_DoTransactions
+  std::deque<std::pair<TransactionRef, Context*>> batch_queue;
+
+public:
+  static void maybe_inject_delay() {
+    /* The store serializes writes.  Each batch is handled sequentially by
+     * the io_work Finisher.  If a batch takes longer to apply its state to
+     * permanent storage, then no other transaction will be handled
+     * meanwhile.
+     *
+     * We will now randomly inject random delays.  We can safely sleep prior
+     * to applying the transactions as it won't break the model.
+     */
+    double delay_prob = g_conf()->mon_inject_transaction_delay_probability;
+    if (delay_prob && (rand() % 10000 < delay_prob * 10000.0)) {
+      utime_t delay;
+      double delay_max = g_conf()->mon_inject_transaction_delay_max;
+      delay.set_from_double(delay_max * (double)(rand() % 10000) / 10000.0);
+      lsubdout(g_ceph_context, mon, 1)
+	<< "apply_transaction will be delayed for " << delay
+	<< " seconds" << dendl;
+      delay.sleep();
+    }
+  }
+
+  /**
+   * Commit everything queued since the last batch as one write, so that
+   * transactions queued while a sync is in flight share the next one.
+   */
+  struct C_DoTransactions : public Context {
     MonitorDBStore *store;
-    MonitorDBStore::TransactionRef t;
-    Context *oncommit;
-    C_DoTransaction(MonitorDBStore *s, MonitorDBStore::TransactionRef t,
-		    Context *f)
-      : store(s), t(t), oncommit(f)
-    {}
+    explicit C_DoTransactions(MonitorDBStore *s) : store(s) {}
     void finish(int r) override {
-      /* The store serializes writes.  Each transaction is handled
-       * sequentially by the io_work Finisher.  If a transaction takes longer
-       * to apply its state to permanent storage, then no other transaction
-       * will be handled meanwhile.
-       *
-       * We will now randomly inject random delays.  We can safely sleep prior
-       * to applying the transaction as it won't break the model.
-       */
-      double delay_prob = g_conf()->mon_inject_transaction_delay_probability;
-      if (delay_prob && (rand() % 10000 < delay_prob * 10000.0)) {
-        utime_t delay;
-        double delay_max = g_conf()->mon_inject_transaction_delay_max;
-        delay.set_from_double(delay_max * (double)(rand() % 10000) / 10000.0);
-        lsubdout(g_ceph_context, mon, 1)
-          << "apply_transaction will be delayed for " << delay
-          << " seconds" << dendl;
-        delay.sleep();
+      maybe_inject_delay();
+      std::vector<MonitorDBStore::TransactionRef> ts;
+      std::vector<Context*> oncommits;
+      {
+	std::lock_guard l(store->batch_lock);
+	uint64_t max = std::max<uint64_t>(
+	  1, g_conf().get_val<uint64_t>("mon_store_group_commit_max"));
+	while (!store->batch_queue.empty() && ts.size() < max) {
+	  ts.push_back(std::move(store->batch_queue.front().first));
+	  oncommits.push_back(store->batch_queue.front().second);
+	  store->batch_queue.pop_front();
+	}
+	if (!store->batch_queue.empty()) {
+	  store->io_work.queue(new C_DoTransactions(store));
+	}
+      }
+      int ret = store->apply_transactions(ts);
+      for (auto c : oncommits) {
+	c->complete(ret);
       }
-      int ret = store->apply_transaction(t);
-      oncommit->complete(ret);
     }
   };
 
@@ -389,11 +425,17 @@ class MonitorDBStore
    * queue transaction
    *
    * Queue a transaction to commit asynchronously.  Trigger a context
-   * on completion (without any locks held).
+   * on completion (without any locks held).  Transactions queued while
+   * an earlier one is being written are committed together, in order.
    */
   void queue_transaction(MonitorDBStore::TransactionRef t,
 			 Context *oncommit) {
-    io_work.queue(new C_DoTransaction(this, t, oncommit));
+    std::lock_guard l(batch_lock);
+    bool was_empty = batch_queue.empty();
+    batch_queue.emplace_back(std::move(t), oncommit);
+    if (was_empty) {
+      io_work.queue(new C_DoTransactions(this));
+    }
   }
 
   /**
@@ -451,7 +451,8 @@ OSDMonitor::OSDMonitor(
    inc_osd_cache(g_conf()->mon_osd_cache_size),
    full_osd_cache(g_conf()->mon_osd_cache_size),
    has_osdmap_manifest(false),
-   mapper(mn->cct, &mn->cpu_tp)
+   mapper(mn->cct, &mn->cpu_tp),
+   encode_wq("OSDMonitor::encode_wq", 0, &mn->cpu_tp)
 {
   inc_cache = std::make_shared<IncCache>(this);
   full_cache = std::make_shared<FullCache>(this);
@@ -775,6 +776,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     dout(7) << __func__ << " loading latest full map e" << latest_full << dendl;
     osdmap = OSDMap();
     osdmap.decode(latest_bl);
+    mapping_changes.all = true;
   }
 
   bufferlist bl;
@@ -815,6 +817,11 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     OSDMap::Incremental inc(inc_bl);
     err = osdmap.apply_incremental(inc);
     ceph_assert(err == 0);
+    if (mapping_job && !mapping_job->is_done()) {
+      // the mapping is still being written to
+      mapping_changes.all = true;
+    }
+    mapping.note_incremental(osdmap, inc, &mapping_changes);
 
     if (!t)
       t.reset(new MonitorDBStore::Transaction);
@@ -1020,8 +1027,12 @@ void OSDMonitor::start_mapping()
   }
   if (!osdmap.get_pools().empty()) {
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
+    // a job that is aborted leaves the mapping at its old epoch, and the
+    // next one starts over from scratch
     mapping_job = mapping.start_update(osdmap, mapper,
-				       g_conf()->mon_osd_mapping_pgs_per_chunk);
+				       g_conf()->mon_osd_mapping_pgs_per_chunk,
+				       mapping_changes);
+    mapping_changes.reset(osdmap.get_epoch());
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
 	     << " at " << fin->start << dendl;
     mapping_job->set_finish_event(fin);
@@ -4711,6 +4722,7 @@ void OSDMonitor::check_osdmap_subs()
   if (osdmap_subs == mon->session_map.subs.end()) {
     return;
   }
+  prime_incremental_encodes(osdmap.get_epoch());
   auto p = osdmap_subs->second->begin();
   while (!p.end()) {
     auto sub = *p;
@@ -4719,6 +4731,61 @@ void OSDMonitor::check_osdmap_subs()
   }
 }
 
+void OSDMonitor::prime_incremental_encodes(epoch_t e)
+{
+  auto osdmap_subs = mon->session_map.subs.find("osdmap");
+  if (osdmap_subs == mon->session_map.subs.end()) {
+    return;
+  }
+  // significant features -> the features of one peer with them
+  uint64_t quorum_features =
+    OSDMap::get_significant_features(mon->get_quorum_con_features());
+  map<uint64_t,uint64_t> todo;
+  for (auto p = osdmap_subs->second->begin(); !p.end(); ++p) {
+    auto sub = *p;
+    if (sub->next < 1 || sub->next > e || !sub->session->con_features) {
+      continue;
+    }
+    uint64_t features = sub->session->con_features;
+    uint64_t significant = OSDMap::get_significant_features(features);
+    if (significant != quorum_features) {
+      todo.emplace(significant, features);
+    }
+  }
+  for (auto p = todo.begin(); p != todo.end(); ) {
+    bufferlist bl;
+    if (inc_osd_cache.lookup({e, p->first}, &bl)) {
+      p = todo.erase(p);
+    } else {
+      ++p;
+    }
+  }
+  // a single variant is just as quickly encoded by the first send
+  if (todo.size() < 2) {
+    return;
+  }
+  bufferlist canonical;
+  if (PaxosService::get_version(e, canonical) < 0) {
+    return;
+  }
+  dout(10) << __func__ << " e" << e << " reencoding for " << todo.size()
+	   << " feature sets" << dendl;
+  C_SaferCond done;
+  C_GatherBuilder gather(cct, &done);
+  for (auto& [significant, features] : todo) {
+    encode_wq.queue(new LambdaContext(
+      [this, e, significant=significant, features=features, canonical,
+       fin=gather.new_sub()](int) {
+	bufferlist bl = canonical;
+	reencode_incremental_map(bl, features);
+	inc_osd_cache.add_bytes({e, significant}, bl);
+	fin->complete(0);
+      }));
+  }
+  gather.activate();
+  done.wait();
+}
+
 void OSDMonitor::check_osdmap_sub(Subscription *sub)
 {
   dout(10) << __func__ << " " << sub << " next " << sub->next
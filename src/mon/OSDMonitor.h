@@ -390,8 +390,14 @@ private:
   ParallelPGMapper mapper;                        ///< for background pg work
   OSDMapMapping mapping;                          ///< pg <-> osd mappings
   std::unique_ptr<ParallelPGMapper::Job> mapping_job;  ///< background mapping job
+  OSDMapMapping::Changes mapping_changes;  ///< since the last mapping job
   void start_mapping();
 
+  ContextWQ encode_wq;  ///< reencodes maps for older peers
+  /// reencode the incremental of epoch @p e for the feature sets of the
+  /// osdmap subscribers at once, rather than on the first send to each
+  void prime_incremental_encodes(epoch_t e);
+
   void update_logger();
 
   void handle_query(PaxosServiceMessage *m);
@@ -124,6 +124,113 @@ void PGMapDigest::decode(bufferlist::const_iterator& p)
   DECODE_FINISH(p);
 }
 
+namespace {
+
+template<class T>
+bool encodes_equal(const T& a, const T& b, uint64_t features)
+{
+  bufferlist abl, bbl;
+  encode(a, abl, features);
+  encode(b, bbl, features);
+  return abl.contents_equal(bbl);
+}
+
+// removed keys, then the entries that were added or changed
+template<class M>
+void encode_map_delta(const M& base, const M& cur, bufferlist& bl,
+		      uint64_t features)
+{
+  std::vector<typename M::key_type> removed;
+  for (auto& i : base) {
+    if (!cur.count(i.first)) {
+      removed.push_back(i.first);
+    }
+  }
+  encode(removed, bl);
+  uint32_t n = 0;
+  bufferlist changed;
+  for (auto& i : cur) {
+    auto j = base.find(i.first);
+    if (j != base.end() && encodes_equal(j->second, i.second, features)) {
+      continue;
+    }
+    encode(i.first, changed);
+    encode(i.second, changed, features);
+    ++n;
+  }
+  encode(n, bl);
+  bl.claim_append(changed);
+}
+
+template<class M>
+void decode_map_delta(M& m, bufferlist::const_iterator& p)
+{
+  std::vector<typename M::key_type> removed;
+  decode(removed, p);
+  for (auto& k : removed) {
+    m.erase(k);
+  }
+  uint32_t n;
+  decode(n, p);
+  while (n--) {
+    typename M::key_type k;
+    decode(k, p);
+    decode(m[k], p);
+  }
+}
+
+} // anonymous namespace
+
+void PGMapDigest::encode_delta(const PGMapDigest& base, bufferlist& bl,
+			       uint64_t features) const
+{
+  ENCODE_START(1, 1, bl);
+  encode(num_pg, bl);
+  encode(num_pg_active, bl);
+  encode(num_pg_unknown, bl);
+  encode(num_osd, bl);
+  encode(pg_sum, bl, features);
+  encode(osd_sum, bl, features);
+  encode(osd_last_seq, bl);
+  encode(pg_sum_delta, bl, features);
+  encode(stamp_delta, bl);
+  encode_map_delta(base.pg_pool_sum, pg_pool_sum, bl, features);
+  encode_map_delta(base.num_pg_by_state, num_pg_by_state, bl, features);
+  encode_map_delta(base.num_pg_by_osd, num_pg_by_osd, bl, features);
+  encode_map_delta(base.num_pg_by_pool, num_pg_by_pool, bl, features);
+  encode_map_delta(base.per_pool_sum_delta, per_pool_sum_delta, bl, features);
+  encode_map_delta(base.per_pool_sum_deltas_stamps, per_pool_sum_deltas_stamps,
+		   bl, features);
+  encode_map_delta(base.avail_space_by_rule, avail_space_by_rule, bl, features);
+  encode_map_delta(base.purged_snaps, purged_snaps, bl, features);
+  encode_map_delta(base.osd_sum_by_class, osd_sum_by_class, bl, features);
+  ENCODE_FINISH(bl);
+}
+
+void PGMapDigest::decode_delta(bufferlist::const_iterator& p)
+{
+  DECODE_START(1, p);
+  decode(num_pg, p);
+  decode(num_pg_active, p);
+  decode(num_pg_unknown, p);
+  decode(num_osd, p);
+  decode(pg_sum, p);
+  decode(osd_sum, p);
+  decode(osd_last_seq, p);
+  decode(pg_sum_delta, p);
+  decode(stamp_delta, p);
+  decode_map_delta(pg_pool_sum, p);
+  decode_map_delta(num_pg_by_state, p);
+  decode_map_delta(num_pg_by_osd, p);
+  decode_map_delta(num_pg_by_pool, p);
+  decode_map_delta(per_pool_sum_delta, p);
+  decode_map_delta(per_pool_sum_deltas_stamps, p);
+  decode_map_delta(avail_space_by_rule, p);
+  decode_map_delta(purged_snaps, p);
+  decode_map_delta(osd_sum_by_class, p);
+  DECODE_FINISH(p);
+}
+
 void PGMapDigest::dump(ceph::Formatter *f) const
 {
   f->dump_unsigned("num_pg", num_pg);
@@ -1160,7 +1267,12 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
     if (pg_stat_iter == pg_stat.end()) {
       pg_stat.insert(make_pair(update_pg, update_stat));
+      purged_snaps_dirty.insert(update_pool);
     } else {
+      if ((pg_stat_iter->second.state == 0) != (update_stat.state == 0) ||
+	  !(pg_stat_iter->second.purged_snaps == update_stat.purged_snaps)) {
+	purged_snaps_dirty.insert(update_pool);
+      }
       stat_pg_sub(update_pg, pg_stat_iter->second);
       pool_sum_ref.sub(pg_stat_iter->second);
       pg_stat_iter->second = update_stat;
@@ -1215,6 +1327,7 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     if (s != pg_stat.end()) {
       pool_erased = stat_pg_sub(removed_pg, s->second);
       pg_stat.erase(s);
+      purged_snaps_dirty.insert(removed_pg.pool());
       if (pool_erased) {
         deleted_pools.insert(removed_pg.pool());
       }
@@ -1287,6 +1400,7 @@ void PGMap::calc_stats()
   num_pg_by_state.clear();
   num_pg_by_pool_state.clear();
   num_pg_by_osd.clear();
+  purged_snaps_all_dirty = true;
 
   for (auto p = pg_stat.begin();
        p != pg_stat.end();
@@ -1444,9 +1558,23 @@ bool PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
 
 void PGMap::calc_purged_snaps()
 {
-  purged_snaps.clear();
+  // only pools with a pg whose purged_snaps (or unknown state) changed
+  // since the last call need another pass
+  if (purged_snaps_all_dirty) {
+    purged_snaps.clear();
+  } else if (purged_snaps_dirty.empty()) {
+    return;
+  } else {
+    for (auto pool : purged_snaps_dirty) {
+      purged_snaps.erase(pool);
+    }
+  }
   set<int64_t> unknown;
   for (auto& i : pg_stat) {
+    if (!purged_snaps_all_dirty &&
+	!purged_snaps_dirty.count(i.first.pool())) {
+      continue;
+    }
     if (i.second.state == 0) {
       unknown.insert(i.first.pool());
       purged_snaps.erase(i.first.pool());
@@ -1462,6 +1590,8 @@ void PGMap::calc_purged_snaps()
       j->second.intersection_of(i.second.purged_snaps);
     }
   }
+  purged_snaps_all_dirty = false;
+  purged_snaps_dirty.clear();
 }
 
 void PGMap::calc_osd_sum_by_class(const OSDMap& osdmap)
@@ -1493,12 +1623,17 @@ void PGMap::stat_osd_sub(int osd, const osd_stat_t &s)
   osd_last_seq[osd] = 0;
 }
 
-void PGMap::encode_digest(const OSDMap& osdmap,
-			  bufferlist& bl, uint64_t features)
+void PGMap::calc_digest(const OSDMap& osdmap)
 {
   get_rules_avail(osdmap, &avail_space_by_rule);
   calc_osd_sum_by_class(osdmap);
   calc_purged_snaps();
+}
+
+void PGMap::encode_digest(const OSDMap& osdmap,
+			  bufferlist& bl, uint64_t features)
+{
+  calc_digest(osdmap);
   PGMapDigest::encode(bl, features);
 }
 
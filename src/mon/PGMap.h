@@ -224,6 +224,11 @@ public:
 
   void encode(ceph::buffer::list& bl, uint64_t features) const;
   void decode(ceph::buffer::list::const_iterator& p);
+  /// encode the entries that differ from @p base
+  void encode_delta(const PGMapDigest& base, ceph::buffer::list& bl,
+		    uint64_t features) const;
+  /// apply what encode_delta() encoded against our current state
+  void decode_delta(ceph::buffer::list::const_iterator& p);
   void dump(ceph::Formatter *f) const;
   static void generate_test_instances(std::list<PGMapDigest*>& ls);
 };
@@ -348,6 +353,10 @@ public:
                              const int64_t pool,
                              const pool_stat_t& old_pool_sum);
 
+  /// pools whose purged_snaps calc_purged_snaps() has to redo
+  mempool::pgmap::set<int64_t> purged_snaps_dirty;
+  bool purged_snaps_all_dirty = true;
+
  public:
 
   mempool::pgmap::set<pg_t> creating_pgs;
@@ -432,6 +441,9 @@ public:
   void encode(ceph::buffer::list &bl, uint64_t features=-1) const;
   void decode(ceph::buffer::list::const_iterator &bl);
 
+  /// bring the PGMapDigest fields not maintained by apply_incremental
+  /// up to date
+  void calc_digest(const OSDMap& osdmap);
   /// encode subset of our data to a PGMapDigest
   void encode_digest(const OSDMap& osdmap,
 		     ceph::buffer::list& bl, uint64_t features);
@@ -668,6 +668,13 @@ void Paxos::begin(bufferlist& v)
   logger->inc(l_paxos_begin_keys, t->get_keys());
   logger->inc(l_paxos_begin_bytes, t->get_bytes());
 
+  // with a single mon there is nobody to overlap with
+  bool overlap = mon->get_quorum().size() > 1 &&
+    g_conf().get_val<bool>("paxos_begin_overlap_local_write");
+  if (overlap) {
+    send_begin();
+  }
+
   auto start = ceph::coarse_mono_clock::now();
   get_store()->apply_transaction(t);
   auto end = ceph::coarse_mono_clock::now();
@@ -682,30 +689,38 @@ void Paxos::begin(bufferlist& v)
     return;
   }
 
-  // ask others to accept it too!
+  // ask others to accept it too!  accepts are handled under mon->lock, so
+  // none is seen before our own write above is durable.
+  if (!overlap) {
+    send_begin();
+  }
+
+  // set timeout event
+  accept_timeout_event = mon->timer.add_event_after(
+    g_conf()->mon_accept_timeout_factor * g_conf()->mon_lease,
+    new C_MonContext{mon, [this](int r) {
+	if (r == -ECANCELED)
+	  return;
+	accept_timeout();
+      }});
+}
+
+void Paxos::send_begin()
+{
   for (auto p = mon->get_quorum().begin();
        p != mon->get_quorum().end();
        ++p) {
     if (*p == mon->rank) continue;
-    
+
     dout(10) << " sending begin to mon." << *p << dendl;
     MMonPaxos *begin = new MMonPaxos(mon->get_epoch(), MMonPaxos::OP_BEGIN,
 				     ceph_clock_now());
     begin->values[last_committed+1] = new_value;
     begin->last_committed = last_committed;
     begin->pn = accepted_pn;
-    
+
     mon->send_mon_message(begin, *p);
   }
-
-  // set timeout event
-  accept_timeout_event = mon->timer.add_event_after(
-    g_conf()->mon_accept_timeout_factor * g_conf()->mon_lease,
-    new C_MonContext{mon, [this](int r) {
-	if (r == -ECANCELED)
-	  return;
-	accept_timeout();
-      }});
 }
 
 // peon
@@ -806,6 +806,12 @@ private:
    * @param value The value being proposed to the quorum
    */
   void begin(ceph::buffer::list& value);
+  /**
+   * Send the value being proposed to the other quorum members.
+   *
+   * @pre We are the Leader and new_value is the value being proposed
+   */
+  void send_begin();
   /**
    * Accept or decline (by ignoring) a proposal from the Leader.
    *
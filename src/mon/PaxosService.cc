@@ -249,6 +249,21 @@ void PaxosService::propose_pending()
     }
   };
   paxos->queue_pending_finisher(new C_Committed(this));
+
+  // services still waiting out their propose interval ride along: one
+  // round for all of them rather than one round after the other
+  if (!paxos->is_plugged()) {
+    paxos->plug();
+    for (auto& svc : mon->paxos_service) {
+      if (svc.get() != this && svc->proposal_timer &&
+	  svc->have_pending && svc->is_active()) {
+	dout(10) << __func__ << " joining " << svc->get_service_name()
+		 << dendl;
+	svc->propose_pending();
+      }
+    }
+    paxos->unplug();
+  }
   paxos->trigger_propose();
 }
 
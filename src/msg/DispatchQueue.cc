@@ -134,13 +134,74 @@ void DispatchQueue::run_local_delivery()
   }
 }
 
+std::atomic<uint64_t> DispatchQueue::next_throttle_credit_id = {0};
+
+int64_t DispatchQueue::get_throttle_credit_batch() const
+{
+  // what the threads hold stays a small part of the throttle, however
+  // many of them there are
+  return std::min<int64_t>(throttle_credit_batch,
+			   dispatch_throttler.get_max() / 32);
+}
+
+int64_t *DispatchQueue::get_throttle_credit(bool take)
+{
+  // keyed by id rather than by queue, as a queue may be destroyed while
+  // a thread still holds credit for it
+  thread_local std::vector<std::pair<uint64_t, int64_t>> credits;
+  for (auto &c : credits) {
+    if (c.first == throttle_credit_id) {
+      return &c.second;
+    }
+  }
+  if (!take) {
+    return nullptr;
+  }
+  return &credits.emplace_back(throttle_credit_id, 0).second;
+}
+
+bool DispatchQueue::dispatch_throttle_get(uint64_t msize)
+{
+  int64_t batch = get_throttle_credit_batch();
+  if (batch <= 0) {
+    return dispatch_throttler.get_or_fail(msize);
+  }
+  int64_t &credit = *get_throttle_credit(true);
+  if (credit >= (int64_t)msize) {
+    credit -= msize;
+    return true;
+  }
+  if (dispatch_throttler.get_or_fail(msize + batch)) {
+    credit += batch;
+    return true;
+  }
+  // nearly full: give back what we hold and try for just this message
+  if (credit) {
+    dispatch_throttler.put(credit);
+    credit = 0;
+  }
+  return dispatch_throttler.get_or_fail(msize);
+}
+
 void DispatchQueue::dispatch_throttle_release(uint64_t msize)
 {
   if (msize) {
     ldout(cct,10) << __func__ << " " << msize << " to dispatch throttler "
 	    << dispatch_throttler.get_current() << "/"
 	    << dispatch_throttler.get_max() << dendl;
-    dispatch_throttler.put(msize);
+    int64_t batch = get_throttle_credit_batch();
+    // the dispatch thread and whoever discards messages never take the
+    // throttle, what they kept would be lost to the readers
+    int64_t *credit = batch > 0 ? get_throttle_credit(false) : nullptr;
+    if (!credit) {
+      dispatch_throttler.put(msize);
+      return;
+    }
+    *credit += msize;
+    if (*credit > 2 * batch) {
+      dispatch_throttler.put(*credit - batch);
+      *credit = batch;
+    }
   }
 }
 
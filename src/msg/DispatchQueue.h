@@ -120,6 +120,19 @@ class DispatchQueue {
   uint64_t pre_dispatch(const ceph::ref_t<Message>& m);
   void post_dispatch(const ceph::ref_t<Message>& m, uint64_t msize);
 
+  static std::atomic<uint64_t> next_throttle_credit_id;
+  /// tells the dispatch throttle credit of the threads apart by queue
+  const uint64_t throttle_credit_id;
+  /// how much of the dispatch throttle a thread takes at a time
+  const int64_t throttle_credit_batch;
+  /// the batch, capped to a small part of the throttle; 0 if none
+  int64_t get_throttle_credit_batch() const;
+  /**
+   * the credit of the calling thread for this queue, created if @p take;
+   * nullptr if the thread never took the throttle
+   */
+  int64_t *get_throttle_credit(bool take);
+
  public:
 
   /// Throttle preventing us from building up a big backlog waiting for dispatch
@@ -139,6 +152,21 @@ class DispatchQueue {
     return mqueue.length();
   }
 
+  /**
+   * Take memory accounting from the dispatch throttler.
+   *
+   * Each thread takes the throttler in batches and serves the messages
+   * it reads from them, so that reading and fast dispatching a message
+   * on a messenger worker does not take the throttler's lock.  Whatever
+   * a thread holds is at most twice the batch size, which is capped to a
+   * 32th of the throttler.  Only the threads taking the throttler keep
+   * what they release, the others give it straight back.
+   *
+   * @param msize The amount of memory to take.
+   * @return false if the throttler is full.
+   */
+  bool dispatch_throttle_get(uint64_t msize);
+
   /**
    * Release memory accounting back to the dispatch throttler.
    *
@@ -228,6 +256,9 @@ class DispatchQueue {
       local_delivery_lock(ceph::make_mutex("Messenger::DispatchQueue::local_delivery_lock" + name)),
       stop_local_delivery(false),
       local_delivery_thread(this),
+      throttle_credit_id(++next_throttle_credit_id),
+      throttle_credit_batch(
+        cct->_conf.get_val<Option::size_t>("ms_dispatch_throttle_batch_bytes")),
       dispatch_throttler(cct, std::string("msgr_dispatch_throttler-") + name,
                          cct->_conf->ms_dispatch_throttle_bytes),
       stop(false)
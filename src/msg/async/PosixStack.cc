@@ -19,8 +19,12 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
 
 #include <algorithm>
+#include <deque>
 
 #include "PosixStack.h"
 
@@ -37,16 +41,37 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "PosixStack "
 
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define HAVE_MSG_ZEROCOPY
+#endif
+
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   ceph::NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
 
+  /// sends of at least this size go out with MSG_ZEROCOPY, 0 if never
+  uint64_t zerocopy_min = 0;
+  /// next zerocopy send the kernel will number
+  uint32_t zerocopy_seq = 0;
+  /// buffers of the zerocopy sends the kernel has not reported done yet
+  std::deque<std::pair<uint32_t, ceph::buffer::list>> zerocopy_pending;
+
  public:
-  explicit PosixConnectedSocketImpl(ceph::NetHandler &h, const entity_addr_t &sa,
+  explicit PosixConnectedSocketImpl(ceph::NetHandler &h, CephContext *cct,
+				    const entity_addr_t &sa,
 				    int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+      : handler(h), _fd(f), sa(sa), connected(connected) {
+#ifdef HAVE_MSG_ZEROCOPY
+    uint64_t min = cct->_conf.get_val<Option::size_t>("ms_tcp_zerocopy_min_size");
+    int on = 1;
+    if (min &&
+	::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0) {
+      zerocopy_min = min;
+    }
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -64,29 +89,65 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+    // completions come in on the error queue, which marks the socket
+    // readable until they are taken off
+    reap_zerocopy();
     ssize_t r = ::read(_fd, buf, len);
     if (r < 0)
       r = -errno;
     return r;
   }
 
+  /// release the buffers of the zerocopy sends the kernel is done with
+  void reap_zerocopy() {
+#ifdef HAVE_MSG_ZEROCOPY
+    while (!zerocopy_pending.empty()) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+	return;
+      for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
+	   cm = CMSG_NXTHDR(&msg, cm)) {
+	auto serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+	  continue;
+	// sends [ee_info, ee_data] are done, and they complete in order
+	while (!zerocopy_pending.empty() &&
+	       (int32_t)(zerocopy_pending.front().first - serr->ee_data) <= 0) {
+	  zerocopy_pending.pop_front();
+	}
+      }
+    }
+#endif
+  }
+
   // return the sent length
   // < 0 means error occurred
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    int flags = 0, uint32_t *calls = nullptr)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0) | flags);
       if (r < 0) {
         if (errno == EINTR) {
           continue;
         } else if (errno == EAGAIN) {
           break;
+        } else if (errno == ENOBUFS && flags) {
+          // too much pinned already, copy this one
+          flags = 0;
+          continue;
         }
         return -errno;
       }
+      if (calls && flags)
+	++*calls;
 
       sent += r;
       if (len == sent) break;
@@ -108,6 +169,13 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(ceph::buffer::list &bl, bool more) override {
+    reap_zerocopy();
+    int flags = 0;
+    uint32_t calls = 0;
+#ifdef HAVE_MSG_ZEROCOPY
+    if (zerocopy_min && bl.length() >= zerocopy_min)
+      flags = MSG_ZEROCOPY;
+#endif
     size_t sent_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = bl.get_num_buffers();
@@ -127,7 +195,7 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more, flags, &calls);
       if (r < 0)
         return r;
 
@@ -144,7 +212,13 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
         bl.swap(swapped);
       } else {
-        bl.clear();
+        swapped.swap(bl);
+      }
+      if (calls) {
+	// the pages stay with the kernel until sends
+	// [zerocopy_seq, zerocopy_seq + calls) are reported done
+	zerocopy_seq += calls;
+	zerocopy_pending.emplace_back(zerocopy_seq - 1, std::move(swapped));
       }
     }
 
@@ -155,6 +229,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
   void close() override {
     ::close(_fd);
+    // the kernel may still be sending from these pages after the close;
+    // a frame garbled by their reuse fails its crc on the peer
+    zerocopy_pending.clear();
   }
   int fd() const override {
     return _fd;
@@ -209,7 +286,7 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, w->cct, *out, sd, true));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -278,7 +355,7 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, cct, addr, sd, !opts.nonblock)));
   return 0;
 }
 
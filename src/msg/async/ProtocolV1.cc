@@ -718,7 +718,7 @@ CtPtr ProtocolV1::throttle_dispatch_queue() {
   ldout(cct, 20) << __func__ << dendl;
 
   if (cur_msg_size) {
-    if (!connection->dispatch_queue->dispatch_throttler.get_or_fail(
+    if (!connection->dispatch_queue->dispatch_throttle_get(
             cur_msg_size)) {
       ldout(cct, 10)
           << __func__ << " wants " << cur_msg_size
@@ -424,6 +424,12 @@ void ProtocolV2::send_message(Message *m) {
   if (can_fast_prepare) {
     prepare_send_message(f, m);
   }
+  if (crc_on_wire &&
+      cct->_conf.get_val<bool>("ms_async_sender_crc")) {
+    // the crcs of the buffers are cached, so the frame is built on the
+    // event loop without going over the data again
+    m->get_data().crc32c(-1);
+  }
 
   std::lock_guard<std::mutex> l(connection->write_lock);
   bool is_prepared = can_fast_prepare;
@@ -544,15 +550,23 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
                  << " off=" << header2.data_off
                  << dendl;
   ssize_t total_send_size = connection->outgoing_bl.length();
-  ssize_t rc = connection->_try_send(more);
-  if (rc < 0) {
-    ldout(cct, 1) << __func__ << " error sending " << m << ", "
-                  << cpp_strerror(rc) << dendl;
+  ssize_t rc = 0;
+  if (more &&
+      connection->outgoing_bl.length() <
+        cct->_conf.get_val<Option::size_t>("ms_async_send_batch_bytes")) {
+    // the next message goes out with this one
+    ldout(cct, 10) << __func__ << " batching " << m << dendl;
   } else {
-    connection->logger->inc(
-        l_msgr_send_bytes, total_send_size - connection->outgoing_bl.length());
-    ldout(cct, 10) << __func__ << " sending " << m
-                   << (rc ? " continuely." : " done.") << dendl;
+    rc = connection->_try_send(more);
+    if (rc < 0) {
+      ldout(cct, 1) << __func__ << " error sending " << m << ", "
+                    << cpp_strerror(rc) << dendl;
+    } else {
+      connection->logger->inc(
+          l_msgr_send_bytes, total_send_size - connection->outgoing_bl.length());
+      ldout(cct, 10) << __func__ << " sending " << m
+                     << (rc ? " continuely." : " done.") << dendl;
+    }
   }
 
 #if defined(WITH_EVENTTRACE)
@@ -1635,7 +1649,7 @@ CtPtr ProtocolV2::throttle_dispatch_queue() {
 
   const size_t cur_msg_size = get_current_msg_size();
   if (cur_msg_size) {
-    if (!connection->dispatch_queue->dispatch_throttler.get_or_fail(
+    if (!connection->dispatch_queue->dispatch_throttle_get(
             cur_msg_size)) {
       ldout(cct, 10)
           << __func__ << " wants " << cur_msg_size
@@ -1874,6 +1888,7 @@ CtPtr ProtocolV2::handle_auth_done(ceph::bufferlist &payload)
   auth_meta->con_mode = auth_done.con_mode();
   session_stream_handlers = \
     ceph::crypto::onwire::rxtx_t::create_handler_pair(cct, *auth_meta, false);
+  crc_on_wire = !session_stream_handlers.tx;
 
   state = AUTH_CONNECTING_SIGN;
 
@@ -2254,6 +2269,7 @@ CtPtr ProtocolV2::finish_auth()
   // allow reusing finish_auth().
   session_stream_handlers = \
     ceph::crypto::onwire::rxtx_t::create_handler_pair(cct, *auth_meta, true);
+  crc_on_wire = !session_stream_handlers.tx;
 
   const auto sig = auth_meta->session_key.empty() ? sha256_digest_t() :
     auth_meta->session_key.hmac_sha256(cct, pre_auth.rxbuf);
@@ -2761,6 +2777,7 @@ CtPtr ProtocolV2::reuse_connection(const AsyncConnectionRef& existing,
           existing->outgoing_bl.clear();
           existing->open_write = false;
           exproto->session_stream_handlers = std::move(temp_stream_handlers);
+          exproto->crc_on_wire = !exproto->session_stream_handlers.tx;
           existing->write_lock.unlock();
           if (exproto->state == NONE) {
             existing->shutdown_socket();
@@ -70,6 +70,8 @@ private:
 public:
   // TODO: move into auth_meta?
   ceph::crypto::onwire::rxtx_t session_stream_handlers;
+  /// frames carry crcs rather than being encrypted; read by senders
+  std::atomic<bool> crc_on_wire = false;
 private:
   entity_name_t peer_name;
   State state;
@@ -57,6 +57,7 @@ std::function<void ()> NetworkStack::add_thread(unsigned worker_id)
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+        w->update_load(dur);
       }
       w->reset();
       w->destroy();
@@ -153,10 +154,22 @@ Worker* NetworkStack::get_worker()
   Worker* current_best = nullptr;
 
   pool_spin.lock();
+  // a few busy connections can keep a worker busier than many idle ones
+  // do others: leave out the workers that are clearly busier than the
+  // least busy one
+  unsigned min_busy = 1000;
+  for (unsigned i = 0; i < num_workers; ++i) {
+    min_busy = std::min(min_busy, workers[i]->load.load());
+  }
+  const unsigned max_busy = min_busy +
+    cct->_conf.get_val<uint64_t>("ms_async_worker_load_slack");
   // find worker with least references
   // tempting case is returning on references == 0, but in reality
   // this will happen so rarely that there's no need for special case.
   for (unsigned i = 0; i < num_workers; ++i) {
+    if (workers[i]->load.load() > max_busy) {
+      continue;
+    }
     unsigned worker_load = workers[i]->references.load();
     if (worker_load < min_load) {
       current_best = workers[i];
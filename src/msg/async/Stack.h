@@ -211,6 +211,9 @@ class Worker {
   std::condition_variable init_cond;
   bool init = false;
 
+  ceph::mono_time load_start;
+  ceph::timespan load_busy = ceph::timespan::zero();
+
  public:
   bool done = false;
 
@@ -219,6 +222,9 @@ class Worker {
   unsigned id;
 
   std::atomic_uint references;
+  /// share of the time spent processing events, in permille, averaged
+  /// over the last few seconds
+  std::atomic_uint load = {0};
   EventCenter center;
 
   Worker(const Worker&) = delete;
@@ -264,6 +270,22 @@ class Worker {
 
   virtual void initialize() {}
   PerfCounters *get_perf_counter() { return perf_logger; }
+  /// account for a round of event processing; called by the worker thread
+  void update_load(ceph::timespan busy) {
+    auto now = ceph::mono_clock::now();
+    if (load_start == ceph::mono_time()) {
+      load_start = now;
+    }
+    load_busy += busy;
+    auto wall = now - load_start;
+    if (wall < std::chrono::seconds(1)) {
+      return;
+    }
+    unsigned cur = std::min<uint64_t>(1000, load_busy.count() * 1000 / wall.count());
+    load = (load * 3 + cur) / 4;
+    load_start = now;
+    load_busy = ceph::timespan::zero();
+  }
   void release_worker() {
     int oldref = references.fetch_sub(1);
     ceph_assert(oldref > 0);
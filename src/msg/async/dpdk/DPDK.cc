@@ -31,6 +31,7 @@
 #include <rte_ethdev.h>
 #include <rte_cycles.h>
 #include <rte_memzone.h>
+#include <rte_version.h>
 
 #include "include/page.h"
 #include "align.h"
@@ -210,6 +211,9 @@ int DPDKDevice::init_port_start()
 
   _dev_info.default_txconf.offloads =
     _dev_info.tx_offload_capa & tx_offloads_wanted;
+  if (!_use_tso) {
+    _dev_info.default_txconf.offloads &= ~DEV_TX_OFFLOAD_TCP_TSO;
+  }
 
   /* for port configuration all features are off by default */
   rte_eth_conf port_conf = { 0 };
@@ -278,11 +282,18 @@ int DPDKDevice::init_port_start()
     port_conf.rxmode.offloads |= DEV_RX_OFFLOAD_VLAN_STRIP;
   }
 
-#ifdef RTE_ETHDEV_HAS_LRO_SUPPORT
+  // RTE_ETHDEV_HAS_LRO_SUPPORT is gone from the DPDK versions with
+  // rxmode.offloads, test for the offload flag instead
+#ifdef DEV_RX_OFFLOAD_TCP_LRO
   // Enable LRO
   if (_use_lro && (_dev_info.rx_offload_capa & DEV_RX_OFFLOAD_TCP_LRO)) {
     ldout(cct, 1) << __func__ << " LRO is on" << dendl;
     port_conf.rxmode.offloads |= DEV_RX_OFFLOAD_TCP_LRO;
+#if RTE_VERSION >= RTE_VERSION_NUM(20, 11, 0, 0)
+    // coalesce up to what from_mbuf_lro() and the rx buffers can hold
+    port_conf.rxmode.max_lro_pkt_size =
+      std::min<uint32_t>(_dev_info.max_lro_pkt_size, ip_packet_len_max);
+#endif
     _hw_features.rx_lro = true;
   } else
 #endif
@@ -311,9 +322,11 @@ int DPDKDevice::init_port_start()
   }
 
   // TSO is supported starting from DPDK v1.8
-  if (_dev_info.tx_offload_capa & DEV_TX_OFFLOAD_TCP_TSO) {
-    ldout(cct, 1) << __func__ << " TSO is supported" << dendl;
+  if (_use_tso && (_dev_info.tx_offload_capa & DEV_TX_OFFLOAD_TCP_TSO)) {
+    ldout(cct, 1) << __func__ << " TSO is on" << dendl;
     _hw_features.tx_tso = 1;
+  } else {
+    ldout(cct, 1) << __func__ << " TSO is off" << dendl;
   }
 
   // Check that Tx TCP CSUM features are either all set all together
@@ -1249,6 +1262,7 @@ std::unique_ptr<DPDKDevice> create_dpdk_net_device(
     unsigned cores,
     uint8_t port_idx,
     bool use_lro,
+    bool use_tso,
     bool enable_fc)
 {
   // Check that we have at least one DPDK-able port
@@ -1259,5 +1273,5 @@ std::unique_ptr<DPDKDevice> create_dpdk_net_device(
   }
 
   return std::unique_ptr<DPDKDevice>(
-      new DPDKDevice(cct, port_idx, cores, use_lro, enable_fc));
+      new DPDKDevice(cct, port_idx, cores, use_lro, use_tso, enable_fc));
 }
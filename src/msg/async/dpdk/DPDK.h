@@ -747,6 +747,7 @@ class DPDKDevice {
   uint8_t _queues_ready = 0;
   unsigned _home_cpu;
   bool _use_lro;
+  bool _use_tso;
   bool _enable_fc;
   std::vector<uint16_t> _redir_table;
   rss_key_type _rss_key;
@@ -798,9 +799,10 @@ class DPDKDevice {
   void set_hw_flow_control();
 
  public:
-  DPDKDevice(CephContext *c, uint8_t port_idx, uint16_t num_queues, bool use_lro, bool enable_fc):
+  DPDKDevice(CephContext *c, uint8_t port_idx, uint16_t num_queues, bool use_lro,
+             bool use_tso, bool enable_fc):
       cct(c), _port_idx(port_idx), _num_queues(num_queues),
-      _home_cpu(0), _use_lro(use_lro),
+      _home_cpu(0), _use_lro(use_lro), _use_tso(use_tso),
       _enable_fc(enable_fc) {
     _queues = std::vector<std::unique_ptr<DPDKQueuePair>>(_num_queues);
     /* now initialise the port we will use */
@@ -910,7 +912,7 @@ class DPDKDevice {
 
 std::unique_ptr<DPDKDevice> create_dpdk_net_device(
     CephContext *c, unsigned cores, uint8_t port_idx = 0,
-    bool use_lro = true, bool enable_fc = true);
+    bool use_lro = true, bool use_tso = true, bool enable_fc = true);
 
 
 /**
@@ -82,6 +82,7 @@ void DPDKWorker::initialize()
     std::unique_ptr<DPDKDevice> dev = create_dpdk_net_device(
         cct, cores, cct->_conf->ms_dpdk_port_id,
         cct->_conf->ms_dpdk_lro,
+        cct->_conf.get_val<bool>("ms_dpdk_tso"),
         cct->_conf->ms_dpdk_hw_flow_control);
     sdev = std::shared_ptr<DPDKDevice>(dev.release());
     sdev->workers.resize(cores);
@@ -100,7 +101,7 @@ void DPDKWorker::initialize()
     std::map<unsigned, float> cpu_weights;
     for (unsigned j = sdev->hw_queues_count() + i % sdev->hw_queues_count();
          j < cores; j+= sdev->hw_queues_count())
-      cpu_weights[i] = 1;
+      cpu_weights[j] = 1;
     cpu_weights[i] = cct->_conf->ms_dpdk_hw_queue_weight;
     qp->configure_proxies(cpu_weights);
     sdev->set_local_queue(i, std::move(qp));
@@ -242,6 +243,26 @@ int DPDKWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, Co
   return r;
 }
 
+void DPDKStack::init_lcores()
+{
+  int socket = rte_eth_dev_socket_id(cct->_conf->ms_dpdk_port_id);
+  unsigned core_id;
+  RTE_LCORE_FOREACH_SLAVE(core_id) {
+    if (socket < 0 || int(rte_lcore_to_socket_id(core_id)) == socket) {
+      lcores.push_back(core_id);
+    }
+  }
+  unsigned local = lcores.size();
+  RTE_LCORE_FOREACH_SLAVE(core_id) {
+    if (socket >= 0 && int(rte_lcore_to_socket_id(core_id)) != socket) {
+      lcores.push_back(core_id);
+    }
+  }
+  ldout(cct, 1) << __func__ << " port " << cct->_conf->ms_dpdk_port_id
+		<< " on socket " << socket << ", " << local << "/"
+		<< lcores.size() << " lcores local" << dendl;
+}
+
 void DPDKStack::spawn_worker(unsigned i, std::function<void ()> &&func)
 {
   // create a extra master thread
@@ -255,16 +276,13 @@ void DPDKStack::spawn_worker(unsigned i, std::function<void ()> &&func)
   }
   // if dpdk::eal::init already called by NVMEDevice, we will select 1..n
   // cores
-  ceph_assert(rte_lcore_count() >= i + 1);
-  unsigned core_id;
-  int j = i;
-  RTE_LCORE_FOREACH_SLAVE(core_id) {
-    if (i-- == 0) {
-      break;
-    }
+  if (lcores.empty()) {
+    init_lcores();
   }
+  ceph_assert(i < lcores.size());
+  unsigned core_id = lcores[i];
   dpdk::eal::execute_on_master([&]() {
-    r = rte_eal_remote_launch(dpdk_thread_adaptor, static_cast<void*>(&funcs[j]), core_id);
+    r = rte_eal_remote_launch(dpdk_thread_adaptor, static_cast<void*>(&funcs[i]), core_id);
     if (r < 0) {
       lderr(cct) << __func__ << " remote launch failed, r=" << r << dendl;
       ceph_abort();
@@ -275,6 +293,6 @@ void DPDKStack::spawn_worker(unsigned i, std::function<void ()> &&func)
 void DPDKStack::join_worker(unsigned i)
 {
   dpdk::eal::execute_on_master([&]() {
-    rte_eal_wait_lcore(i+1);
+    rte_eal_wait_lcore(lcores[i]);
   });
 }
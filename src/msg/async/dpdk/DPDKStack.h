@@ -248,6 +248,11 @@ class DPDKWorker : public Worker {
 
 class DPDKStack : public NetworkStack {
   vector<std::function<void()> > funcs;
+  /// lcore of each worker; those on the NUMA node of the port come first,
+  /// so the workers owning the hardware queues run next to the NIC
+  vector<unsigned> lcores;
+
+  void init_lcores();
  public:
   explicit DPDKStack(CephContext *cct, const string &t): NetworkStack(cct, t) {
     funcs.resize(cct->_conf->ms_async_max_op_threads);
@@ -26,7 +26,6 @@
 #define dout_prefix *_dout << "Infiniband "
 
 static const uint32_t MAX_SHARED_RX_SGE_COUNT = 1;
-static const uint32_t MAX_INLINE_DATA = 0;
 static const uint32_t TCP_MSG_LEN = sizeof("0000:00000000:00000000:00000000:00000000000000000000000000000000");
 static const uint32_t CQ_DEPTH = 30000;
 
@@ -323,12 +322,20 @@ int Infiniband::QueuePair::init()
   }
   qpia.cap.max_send_wr  = max_send_wr; // max outstanding send requests
   qpia.cap.max_send_sge = 1;           // max send scatter-gather elements
-  qpia.cap.max_inline_data = MAX_INLINE_DATA;          // max bytes of immediate data on send q
+  qpia.cap.max_inline_data =           // max bytes of immediate data on send q
+    cct->_conf.get_val<Option::size_t>("ms_async_rdma_max_inline_data");
   qpia.qp_type = type;                 // RC, UC, UD, or XRC
   qpia.sq_sig_all = 0;                 // only generate CQEs on requested WQEs
 
   if (!cct->_conf->ms_async_rdma_cm) {
     qp = ibv_create_qp(pd, &qpia);
+    if (qp == NULL && qpia.cap.max_inline_data) {
+      ldout(cct, 1) << __func__ << " failed to create queue pair with "
+		    << qpia.cap.max_inline_data << " bytes of inline data, "
+		    << "retrying without: " << cpp_strerror(errno) << dendl;
+      qpia.cap.max_inline_data = 0;
+      qp = ibv_create_qp(pd, &qpia);
+    }
     if (qp == NULL) {
       lderr(cct) << __func__ << " failed to create queue pair" << cpp_strerror(errno) << dendl;
       if (errno == ENOMEM) {
@@ -351,8 +358,11 @@ int Infiniband::QueuePair::init()
     }
     qp = cm_id->qp;
   }
+  // the device may have granted more than asked for
+  max_inline_data = qpia.cap.max_inline_data;
   ldout(cct, 20) << __func__ << " successfully create queue pair: "
-                 << "qp=" << qp << dendl;
+                 << "qp=" << qp << " max_inline_data=" << max_inline_data
+                 << dendl;
   local_cm_meta.local_qpn = get_local_qp_number();
   local_cm_meta.psn = get_initial_psn();
   local_cm_meta.lid = infiniband.get_lid();
@@ -506,6 +506,8 @@ class Infiniband {
     void wire_gid_to_gid(const char *wgid, ib_cm_meta_t* cm_meta_data);
     void gid_to_wire_gid(const ib_cm_meta_t& cm_meta_data, char wgid[]);
     ibv_qp* get_qp() const { return qp; }
+    /// sends up to this size can be posted inline
+    uint32_t get_max_inline_data() const { return max_inline_data; }
     Infiniband::CompletionQueue* get_tx_cq() const { return txcq; }
     Infiniband::CompletionQueue* get_rx_cq() const { return rxcq; }
     int to_dead();
@@ -547,6 +549,7 @@ class Infiniband {
     uint32_t     initial_psn;    // initial packet sequence number
     uint32_t     max_send_wr;
     uint32_t     max_recv_wr;
+    uint32_t     max_inline_data = 0;
     uint32_t     q_key;
     bool dead;
     std::vector<Chunk*> recv_queue;
@@ -491,6 +491,12 @@ int RDMAConnectedSocketImpl::post_work_request(std::vector<Chunk*> &tx_buffers)
     iswr[current_swr].num_sge = 1;
     iswr[current_swr].opcode = IBV_WR_SEND;
     iswr[current_swr].send_flags = IBV_SEND_SIGNALED;
+    if (isge[current_sge].length <= qp->get_max_inline_data()) {
+      // the data is copied into the work request, sparing the hca a dma
+      // read of the chunk; the chunk goes back to the pool on completion
+      // as any other
+      iswr[current_swr].send_flags |= IBV_SEND_INLINE;
+    }
 
     num++;
     worker->perf_logger->inc(l_msgr_rdma_tx_bytes, isge[current_sge].length);
@@ -6,6 +6,8 @@
 
 #ifdef __cplusplus
 
+#include <functional>
+
 #include "../include/types.h"
 #include "msg/msg_types.h"
 #include "common/hobject.h"
@@ -112,6 +114,21 @@ extern int cls_cxx_map_get_vals(cls_method_context_t hctx,
                                 uint64_t max_to_get,
                                 std::map<std::string, ceph::buffer::list> *vals,
                                 bool *more);
+/*
+ * Call f on the omap entries after start_after that begin with
+ * filter_prefix, up to max_to_get of them, as the store iterates them
+ * rather than copying them into a map first. f returns false to stop.
+ * *more is set if the scan stopped at max_to_get (or at the OSD's limits
+ * per request) with entries left. Returns the number of entries visited.
+ */
+using cls_map_iterate_cb_t =
+  std::function<bool(const std::string& key, const ceph::buffer::list& val)>;
+extern int cls_cxx_map_iterate(cls_method_context_t hctx,
+                               const std::string& start_after,
+                               const std::string& filter_prefix,
+                               uint64_t max_to_get,
+                               const cls_map_iterate_cb_t& f,
+                               bool *more);
 extern int cls_cxx_map_get_val(cls_method_context_t hctx, const std::string &key,
                                bufferlist *outbl);
 extern int cls_cxx_map_get_vals_by_keys(cls_method_context_t hctx,
@@ -310,6 +310,18 @@ public:
     return true;
   }
 
+  /**
+   * get_cost_per_io
+   *
+   * Fixed cost of a single I/O in bytes of transfer time, for weighing
+   * ops of different sizes against each other.
+   *
+   * @return 0 if the store has no estimate
+   */
+  virtual uint64_t get_cost_per_io() {
+    return 0;
+  }
+
   /**
    * is_journal_rotational
    *
@@ -422,6 +434,33 @@ public:
    * @returns true if object exists, false otherwise
    */
   virtual bool exists(CollectionHandle& c, const ghobject_t& oid) = 0;
+
+  /**
+   * prefetch -- hint that objects are about to be accessed
+   *
+   * The store may start loading their metadata in the background so
+   * that the following reads don't wait for it.  Purely advisory.
+   *
+   * @param c collection for the objects
+   * @param oids objects, in the order they will be accessed
+   */
+  virtual void prefetch(CollectionHandle& c,
+			const std::vector<ghobject_t>& oids) {}
+  /**
+   * enable_inline_poll -- have the calling thread reap its own I/O
+   *
+   * Once enabled, asynchronous I/O submitted by this thread may only
+   * complete when the thread calls poll_completions().
+   *
+   * @returns false if the store does not support it
+   */
+  virtual bool enable_inline_poll() { return false; }
+  /**
+   * poll_completions -- reap I/O completions of the calling thread
+   *
+   * @returns the number of requests the thread still has in flight
+   */
+  virtual unsigned poll_completions() { return 0; }
   /**
    * set_collection_opts -- std::set pool options for a collectioninformation for an object
    *
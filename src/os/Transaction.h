@@ -1295,6 +1295,36 @@ public:
 WRITE_CLASS_ENCODER(Transaction)
 WRITE_CLASS_ENCODER(Transaction::TransactionData)
 
+/*
+ * A batch of transactions as queued to a store, the records of a
+ * transaction capture. The transactions are encoded as they are queued,
+ * without their callbacks.
+ */
+struct TransactionCapture {
+  utime_t stamp;           ///< when the batch was queued
+  coll_t cid;              ///< the collection of the sequencer
+  std::vector<Transaction> tls;
+
+  static void encode_batch(const utime_t& stamp, const coll_t& cid,
+			   const std::vector<Transaction>& tls,
+			   ceph::buffer::list& bl) {
+    using ceph::encode;
+    ENCODE_START(1, 1, bl);
+    encode(stamp, bl);
+    encode(cid, bl);
+    encode(tls, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(ceph::buffer::list::const_iterator& bl) {
+    using ceph::decode;
+    DECODE_START(1, bl);
+    decode(stamp, bl);
+    decode(cid, bl);
+    decode(tls, bl);
+    DECODE_FINISH(bl);
+  }
+};
+
 std::ostream& operator<<(std::ostream& out, const Transaction& tx);
 
 }
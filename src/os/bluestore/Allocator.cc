@@ -6,13 +6,19 @@
 #include "BitmapAllocator.h"
 #include "AvlAllocator.h"
 #include "HybridAllocator.h"
+#include "ZonedAllocator.h"
 #include "common/debug.h"
 #include "common/admin_socket.h"
+#include "common/cmdparse.h"
+#include "common/errno.h"
+#include <fstream>
 #define dout_subsys ceph_subsys_bluestore
 
 using std::string;
 using std::to_string;
 
+using TOPNSPC::common::cmd_getval;
+
 using ceph::bufferlist;
 using ceph::Formatter;
 
@@ -48,6 +54,13 @@ public:
           this,
           "give allocator fragmentation (0-no fragmentation, 1-absolute fragmentation)");
         ceph_assert(r == 0);
+        r = admin_socket->register_command(
+          ("bluestore allocator trace " + name +
+	   " name=action,type=CephChoices,strings=start|stop"
+	   " name=path,type=CephString,req=false").c_str(),
+          this,
+          "start/stop recording allocator calls to a file for offline replay");
+        ceph_assert(r == 0);
       }
     }
   }
@@ -88,6 +101,28 @@ public:
       f->open_object_section("fragmentation");
       f->dump_float("fragmentation_rating", alloc->get_fragmentation());
       f->close_section();
+    } else if (command == "bluestore allocator trace " + name) {
+      string action, path;
+      cmd_getval(cmdmap, "action", action);
+      if (action == "start") {
+	if (!cmd_getval(cmdmap, "path", path)) {
+	  ss << "path is required";
+	  return -EINVAL;
+	}
+	r = alloc->start_trace(path);
+	if (r < 0) {
+	  ss << "failed to start trace to " << path << ": " << cpp_strerror(r);
+	  return r;
+	}
+      } else {
+	alloc->stop_trace();
+      }
+      f->open_object_section("trace");
+      f->dump_string("action", action);
+      if (!path.empty()) {
+	f->dump_string("path", path);
+      }
+      f->close_section();
     } else {
       ss << "Invalid command" << std::endl;
       r = -ENOSYS;
@@ -96,7 +131,18 @@ public:
   }
 
 };
+class Allocator::Tracer {
+public:
+  std::mutex lock;
+  std::ofstream out;
+
+  void put_extent(uint64_t offset, uint64_t length) {
+    out << ' ' << offset << '~' << length;
+  }
+};
+
 Allocator::Allocator(const std::string& name)
+  : tracer(std::make_unique<Tracer>())
 {
   asok_hook = new SocketHook(this, name);
 }
@@ -111,8 +157,88 @@ const string& Allocator::get_name() const {
   return asok_hook->name;
 }
 
+/*
+ * Trace format, one call per line, numbers are hex:
+ *   free <offset>~<length>          free space at trace start
+ *   add <offset>~<length>           init_add_free
+ *   rm <offset>~<length>            init_rm_free
+ *   alloc <want>/<unit>/<max> [<offset>~<length> ...]
+ *   release <offset>~<length> [...]
+ * The free space dump isn't atomic with calls made concurrently, so
+ * replaying should tolerate releases of space it doesn't own.
+ */
+int Allocator::start_trace(const std::string& path)
+{
+  std::lock_guard l(tracer->lock);
+  if (tracer->out.is_open()) {
+    return -EBUSY;
+  }
+  tracer->out.open(path, std::ios::out | std::ios::trunc);
+  if (!tracer->out.is_open()) {
+    int r = errno;
+    return r ? -r : -EIO;
+  }
+  tracer->out << std::hex;
+  tracing = true;
+  dump([&](uint64_t offset, uint64_t length) {
+    tracer->out << "free";
+    tracer->put_extent(offset, length);
+    tracer->out << '\n';
+  });
+  return 0;
+}
+
+void Allocator::stop_trace()
+{
+  std::lock_guard l(tracer->lock);
+  tracing = false;
+  if (tracer->out.is_open()) {
+    tracer->out.close();
+  }
+}
+
+void Allocator::_trace_allocate(uint64_t want, uint64_t unit,
+				uint64_t max_alloc_size,
+				const PExtentVector& extents, size_t first)
+{
+  std::lock_guard l(tracer->lock);
+  if (!tracer->out.is_open()) {
+    return;
+  }
+  tracer->out << "alloc " << want << '/' << unit << '/' << max_alloc_size;
+  for (auto i = first; i < extents.size(); ++i) {
+    tracer->put_extent(extents[i].offset, extents[i].length);
+  }
+  tracer->out << '\n';
+}
+
+void Allocator::_trace_release(const interval_set<uint64_t>& release_set)
+{
+  std::lock_guard l(tracer->lock);
+  if (!tracer->out.is_open() || release_set.empty()) {
+    return;
+  }
+  tracer->out << "release";
+  for (auto p = release_set.begin(); p != release_set.end(); ++p) {
+    tracer->put_extent(p.get_start(), p.get_len());
+  }
+  tracer->out << '\n';
+}
+
+void Allocator::_trace_init(bool add, uint64_t offset, uint64_t length)
+{
+  std::lock_guard l(tracer->lock);
+  if (!tracer->out.is_open()) {
+    return;
+  }
+  tracer->out << (add ? "add" : "rm");
+  tracer->put_extent(offset, length);
+  tracer->out << '\n';
+}
+
 Allocator *Allocator::create(CephContext* cct, string type,
-                             int64_t size, int64_t block_size, const std::string& name)
+                             int64_t size, int64_t block_size, const std::string& name,
+                             uint64_t zone_size, uint64_t first_seq_zone)
 {
   Allocator* alloc = nullptr;
   if (type == "stupid") {
@@ -125,6 +251,14 @@ Allocator *Allocator::create(CephContext* cct, string type,
     return new HybridAllocator(cct, size, block_size,
       cct->_conf.get_val<uint64_t>("bluestore_hybrid_alloc_mem_cap"),
       name);
+  } else if (type == "zoned") {
+    if (zone_size == 0 || zone_size % block_size) {
+      lderr(cct) << "Allocator::" << __func__ << " bad zone size "
+		 << zone_size << dendl;
+      return nullptr;
+    }
+    return new ZonedAllocator(cct, size, block_size, zone_size,
+			      first_seq_zone, name);
   }
   if (alloc == nullptr) {
     lderr(cct) << "Allocator::" << __func__ << " unknown alloc type "
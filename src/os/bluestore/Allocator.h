@@ -12,6 +12,8 @@
 #ifndef CEPH_OS_BLUESTORE_ALLOCATOR_H
 #define CEPH_OS_BLUESTORE_ALLOCATOR_H
 
+#include <atomic>
+#include <memory>
 #include <ostream>
 #include "include/ceph_assert.h"
 #include "os/bluestore/bluestore_types.h"
@@ -59,14 +61,37 @@ public:
   virtual double get_fragmentation_score();
   virtual void shutdown() = 0;
 
+  /// zone_size and first_seq_zone describe the device for "zoned"
   static Allocator *create(CephContext* cct, std::string type, int64_t size,
-			   int64_t block_size, const std::string& name = "");
+			   int64_t block_size, const std::string& name = "",
+			   uint64_t zone_size = 0, uint64_t first_seq_zone = 0);
 
   const string& get_name() const;
 
+  /*
+   * Record allocate/release calls along with the free space at start
+   * to @path, for replaying them offline against other allocators.
+   */
+  int start_trace(const std::string& path);
+  void stop_trace();
+
+protected:
+  bool trace_enabled() const {
+    return tracing.load(std::memory_order_relaxed);
+  }
+  // never called with the allocator lock held
+  void _trace_allocate(uint64_t want, uint64_t unit, uint64_t max_alloc_size,
+		       const PExtentVector& extents, size_t first);
+  void _trace_release(const interval_set<uint64_t>& release_set);
+  void _trace_init(bool add, uint64_t offset, uint64_t length);
+
 private:
   class SocketHook;
   SocketHook* asok_hook = nullptr;
+
+  class Tracer;
+  std::unique_ptr<Tracer> tracer;
+  std::atomic<bool> tracing = {false};
 };
 
 #endif
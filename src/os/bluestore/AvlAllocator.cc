@@ -298,7 +298,9 @@ AvlAllocator::AvlAllocator(CephContext* cct,
     cct->_conf.get_val<uint64_t>("bluestore_avl_alloc_bf_free_pct")),
   range_count_cap(max_mem / sizeof(range_seg_t)),
   cct(cct)
-{}
+{
+  _init_arenas();
+}
 
 AvlAllocator::AvlAllocator(CephContext* cct,
 			   int64_t device_size,
@@ -312,7 +314,9 @@ AvlAllocator::AvlAllocator(CephContext* cct,
   range_size_alloc_free_pct(
     cct->_conf.get_val<uint64_t>("bluestore_avl_alloc_bf_free_pct")),
   cct(cct)
-{}
+{
+  _init_arenas();
+}
 
 AvlAllocator::~AvlAllocator()
 {
@@ -342,11 +346,52 @@ int64_t AvlAllocator::allocate(
       max_alloc_size >= cap) {
     max_alloc_size = p2align(uint64_t(cap), (uint64_t)block_size);
   }
+  auto orig_size = extents->size();
+  int64_t r = 0;
+  if (!arenas.empty() && want * 4 <= arena_size) {
+    r = _arena_allocate(want, unit, max_alloc_size, extents);
+  }
+  if (r <= 0) {
+    r = _allocate_shared(want, unit, max_alloc_size, hint, extents);
+  }
+  // the space might be sitting in arenas, get it back and retry,
+  // a few times as other threads may refill them meanwhile
+  for (size_t i = 0; r < (int64_t)want && i <= arenas.size() &&
+	 _get_arena_free(); ++i) {
+    uint64_t got = 0;
+    for (auto j = orig_size; j < extents->size(); ++j) {
+      got += (*extents)[j].length;
+    }
+    if (got >= want) {
+      break;
+    }
+    _drain_arenas();
+    auto r2 = _allocate_shared(want - got, unit, max_alloc_size, hint, extents);
+    if (r2 > 0) {
+      r = got + r2;
+    }
+  }
+  if (trace_enabled()) {
+    _trace_allocate(want, unit, max_alloc_size, *extents, orig_size);
+  }
+  return r;
+}
+
+int64_t AvlAllocator::_allocate_shared(
+  uint64_t want,
+  uint64_t unit,
+  uint64_t max_alloc_size,
+  int64_t  hint,
+  PExtentVector* extents)
+{
   std::lock_guard l(lock);
   return _allocate(want, unit, max_alloc_size, hint, extents);
 }
 
 void AvlAllocator::release(const interval_set<uint64_t>& release_set) {
+  if (trace_enabled()) {
+    _trace_release(release_set);
+  }
   std::lock_guard l(lock);
   _release(release_set);
 }
@@ -354,7 +399,7 @@ void AvlAllocator::release(const interval_set<uint64_t>& release_set) {
 uint64_t AvlAllocator::get_free()
 {
   std::lock_guard l(lock);
-  return num_free;
+  return num_free + _get_arena_free();
 }
 
 double AvlAllocator::get_fragmentation()
@@ -393,10 +438,14 @@ void AvlAllocator::dump(std::function<void(uint64_t offset, uint64_t length)> no
   for (auto& rs : range_tree) {
     notify(rs.start, rs.end - rs.start);
   }
+  _dump_arenas(notify);
 }
 
 void AvlAllocator::init_add_free(uint64_t offset, uint64_t length)
 {
+  if (trace_enabled()) {
+    _trace_init(true, offset, length);
+  }
   std::lock_guard l(lock);
   ldout(cct, 10) << __func__ << std::hex
                  << " offset 0x" << offset
@@ -407,6 +456,11 @@ void AvlAllocator::init_add_free(uint64_t offset, uint64_t length)
 
 void AvlAllocator::init_rm_free(uint64_t offset, uint64_t length)
 {
+  if (trace_enabled()) {
+    _trace_init(false, offset, length);
+  }
+  // the range might be partially held by an arena
+  _drain_arenas();
   std::lock_guard l(lock);
   ldout(cct, 10) << __func__ << std::hex
                  << " offset 0x" << offset
@@ -417,6 +471,107 @@ void AvlAllocator::init_rm_free(uint64_t offset, uint64_t length)
 
 void AvlAllocator::shutdown()
 {
+  _clear_arenas();
   std::lock_guard l(lock);
   _shutdown();
 }
+
+void AvlAllocator::_init_arenas()
+{
+  auto n = cct->_conf.get_val<uint64_t>("bluestore_alloc_arenas");
+  arena_size = cct->_conf.get_val<Option::size_t>("bluestore_alloc_arena_size");
+  if (arena_size < block_size) {
+    n = 0;
+  }
+  for (uint64_t i = 0; i < n; ++i) {
+    arenas.emplace_back(std::make_unique<arena_t>());
+  }
+}
+
+int64_t AvlAllocator::_arena_allocate(
+  uint64_t want,
+  uint64_t unit,
+  uint64_t max_alloc_size,
+  PExtentVector* extents)
+{
+  auto idx = std::hash<std::thread::id>{}(std::this_thread::get_id()) %
+    arenas.size();
+  auto& a = *arenas[idx];
+  const uint64_t max_len = std::max(p2align(max_alloc_size, unit), unit);
+
+  // all or nothing, the caller falls back to the trees otherwise
+  auto take = [&]() {
+    PExtentVector taken;
+    uint64_t left = want;
+    for (auto p = a.free.begin(); p != a.free.end() && left; ++p) {
+      uint64_t start = p2roundup(p.get_start(), unit);
+      uint64_t end = p.get_end();
+      while (left && start + unit <= end) {
+	uint64_t len = std::min({p2align(end - start, unit), left, max_len});
+	taken.emplace_back(start, len);
+	start += len;
+	left -= len;
+      }
+    }
+    if (left) {
+      return false;
+    }
+    for (auto& e : taken) {
+      a.free.erase(e.offset, e.length);
+      extents->emplace_back(e);
+    }
+    arena_free -= want;
+    return true;
+  };
+
+  std::lock_guard al(a.lock);
+  if (take()) {
+    return want;
+  }
+  PExtentVector refill;
+  uint64_t size = p2roundup(arena_size, unit);
+  _allocate_shared(size, unit, size, 0, &refill);
+  for (auto& e : refill) {
+    a.free.insert(e.offset, e.length);
+    arena_free += e.length;
+  }
+  ldout(cct, 20) << __func__ << " arena " << idx << " refilled with "
+		 << refill << dendl;
+  return take() ? want : 0;
+}
+
+void AvlAllocator::_drain_arenas()
+{
+  for (auto& a : arenas) {
+    interval_set<uint64_t> free;
+    {
+      std::lock_guard al(a->lock);
+      free.swap(a->free);
+    }
+    if (!free.empty()) {
+      arena_free -= free.size();
+      std::lock_guard l(lock);
+      _release(free);
+    }
+  }
+}
+
+void AvlAllocator::_clear_arenas()
+{
+  for (auto& a : arenas) {
+    std::lock_guard al(a->lock);
+    a->free.clear();
+  }
+  arena_free = 0;
+}
+
+void AvlAllocator::_dump_arenas(
+  std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  for (auto& a : arenas) {
+    std::lock_guard al(a->lock);
+    for (auto p = a->free.begin(); p != a->free.end(); ++p) {
+      notify(p.get_start(), p.get_len());
+    }
+  }
+}
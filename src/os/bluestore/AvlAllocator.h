@@ -3,7 +3,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <boost/intrusive/avl_set.hpp>
 
 #include "Allocator.h"
@@ -254,4 +257,41 @@ protected:
   uint64_t _get_free() const {
     return num_free;
   }
+
+  /*
+   * Allocation arenas.
+   * Each arena keeps a chunk of free space taken from the trees and
+   * serves small allocations of the threads mapped to it under its own
+   * lock. Released space always goes back to the trees; arenas are
+   * drained back whenever the trees alone can't satisfy a request.
+   * Lock order: arena lock, then the allocator lock.
+   */
+  struct arena_t {
+    std::mutex lock;
+    interval_set<uint64_t> free;
+  };
+  std::vector<std::unique_ptr<arena_t>> arenas;
+  uint64_t arena_size = 0;                ///< bytes taken per refill
+  std::atomic<uint64_t> arena_free = {0}; ///< total bytes held by arenas
+
+  // allocation from the trees, lock is taken inside
+  virtual int64_t _allocate_shared(
+    uint64_t want,
+    uint64_t unit,
+    uint64_t max_alloc_size,
+    int64_t  hint,
+    PExtentVector *extents);
+  int64_t _arena_allocate(
+    uint64_t want,
+    uint64_t unit,
+    uint64_t max_alloc_size,
+    PExtentVector *extents);
+  void _init_arenas();
+  // called with no allocator lock held
+  void _drain_arenas();
+  void _clear_arenas();
+  void _dump_arenas(std::function<void(uint64_t offset, uint64_t length)> notify);
+  uint64_t _get_arena_free() const {
+    return arena_free.load();
+  }
 };
@@ -33,6 +33,9 @@ int64_t BitmapAllocator::allocate(
     
   _allocate_l2(want_size, alloc_unit, max_alloc_size, hint,
     &allocated, extents);
+  if (trace_enabled()) {
+    _trace_allocate(want_size, alloc_unit, max_alloc_size, *extents, old_size);
+  }
   if (!allocated) {
     return -ENOSPC;
   }
@@ -49,6 +52,9 @@ int64_t BitmapAllocator::allocate(
 void BitmapAllocator::release(
   const interval_set<uint64_t>& release_set)
 {
+  if (trace_enabled()) {
+    _trace_release(release_set);
+  }
   for (auto r : release_set) {
     ldout(cct, 10) << __func__ << " 0x" << std::hex << r.first << "~" << r.second
 		  << std::dec << dendl;
@@ -62,6 +68,9 @@ void BitmapAllocator::init_add_free(uint64_t offset, uint64_t length)
 {
   ldout(cct, 10) << __func__ << " 0x" << std::hex << offset << "~" << length
 		  << std::dec << dendl;
+  if (trace_enabled()) {
+    _trace_init(true, offset, length);
+  }
 
   auto mas = get_min_alloc_size();
   uint64_t offs = round_up_to(offset, mas);
@@ -74,6 +83,9 @@ void BitmapAllocator::init_rm_free(uint64_t offset, uint64_t length)
 {
   ldout(cct, 10) << __func__ << " 0x" << std::hex << offset << "~" << length
 		 << std::dec << dendl;
+  if (trace_enabled()) {
+    _trace_init(false, offset, length);
+  }
   auto mas = get_min_alloc_size();
   uint64_t offs = round_up_to(offset, mas);
   uint64_t l = p2align(offset + length - offs, mas);
@@ -76,6 +76,17 @@ uint64_t IOContext::get_num_ios() const
   return ios;
 }
 
+uint64_t IOContext::get_num_bytes() const
+{
+  uint64_t bytes = 0;
+#if defined(HAVE_LIBAIO) || defined(HAVE_POSIXAIO)
+  for (auto& p : pending_aios) {
+    bytes += p.length;
+  }
+#endif
+  return bytes;
+}
+
 void IOContext::release_running_aios()
 {
   ceph_assert(!num_running);
@@ -65,6 +65,15 @@
 #endif
 
 
+/// who an IOContext's io is for, most urgent first
+enum blk_io_class_t : uint8_t {
+  BLK_IO_CLIENT = 0,   ///< client data and the kv WAL
+  BLK_IO_DEFERRED,     ///< deferred write replay
+  BLK_IO_BLUEFS,       ///< kv compaction and flush
+  BLK_IO_BACKGROUND,   ///< scrub, recovery reads, defrag, cleaning
+  BLK_IO_NUM_CLASSES
+};
+
 /// track in-flight io
 struct IOContext {
 private:
@@ -88,6 +97,7 @@ public:
   std::atomic_int num_pending = {0};
   std::atomic_int num_running = {0};
   bool allow_eio;
+  blk_io_class_t io_class = BLK_IO_CLIENT;
 
   explicit IOContext(CephContext* cct, void *p, bool allow_eio = false)
     : cct(cct), priv(p), allow_eio(allow_eio)
@@ -103,6 +113,7 @@ public:
   void release_running_aios();
   void aio_wait();
   uint64_t get_num_ios() const;
+  uint64_t get_num_bytes() const;
 
   void try_aio_wake() {
     assert(num_running >= 1);
@@ -158,8 +169,29 @@ public:
     CephContext* cct, const std::string& path, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv);
   virtual bool supported_bdev_label() { return true; }
   virtual bool is_rotational() { return rotational; }
+  /// writes are persistent once they return, no flush needed
+  virtual bool is_persistent_memory() const { return false; }
+
+  /// host managed zoned (SMR/ZNS) device: past the leading conventional
+  /// region each zone only takes writes at its write pointer and has to
+  /// be reset before its space can be written again
+  virtual bool is_smr() const { return false; }
+  virtual uint64_t get_zone_size() const { return 0; }
+  virtual uint64_t get_conventional_region_size() const { return 0; }
+  /// bytes written into each zone, conventional ones report 0
+  virtual int get_zone_write_pointers(std::vector<uint64_t> *written) {
+    return -EOPNOTSUPP;
+  }
+  virtual int reset_zone(uint64_t zone) { return -EOPNOTSUPP; }
 
   virtual void aio_submit(IOContext *ioc) = 0;
+  /// switch the calling thread to polled completions: aio_submit() of
+  /// callback driven I/O returns as soon as it is queued, and the thread
+  /// reaps it with poll_completions().  false if the device can't do that.
+  virtual bool enable_inline_poll() { return false; }
+  /// reap completed I/O of the calling thread; returns the number of its
+  /// requests still in flight
+  virtual unsigned poll_completions() { return 0; }
 
   void set_no_exclusive_lock() {
     lock_exclusive = false;
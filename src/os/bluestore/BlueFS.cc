@@ -253,6 +253,12 @@ void BlueFS::_init_logger()
 		    "Bytes requested in prefetch read mode", NULL,
 		    PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
 
+  b.add_u64_counter(l_bluefs_hot_migrate_count, "hot_migrate_count",
+		    "Files moved to the DB device for being read often");
+  b.add_u64_counter(l_bluefs_hot_migrate_bytes, "hot_migrate_bytes",
+		    "Bytes moved to the DB device for being read often", NULL,
+		    0, unit_t(UNIT_BYTES));
+
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -718,6 +724,7 @@ void BlueFS::umount(bool avoid_compact)
 {
   dout(1) << __func__ << dendl;
 
+  stop_hot_file_migration();
   sync_metadata(avoid_compact);
 
   _close_writer(log_writer);
@@ -1903,7 +1910,7 @@ int64_t BlueFS::_read_random(
            << " 0x" << std::hex << off << "~" << len << std::dec
 	   << " from " << h->file->fnode << dendl;
 
-  ++h->file->num_reading;
+  h->file->start_reading();
 
   if (!h->ignore_eof &&
       off + len > h->file->fnode.size) {
@@ -1989,7 +1996,7 @@ int64_t BlueFS::_read(
 	   << (prefetch ? " prefetch" : "")
 	   << dendl;
 
-  ++h->file->num_reading;
+  h->file->start_reading();
 
   if (!h->ignore_eof &&
       off + len > h->file->fnode.size) {
@@ -2117,6 +2124,10 @@ uint64_t BlueFS::_estimate_log_size()
 void BlueFS::compact_log()
 {
   std::unique_lock l(lock);
+  // async compaction drops the lock while dumping metadata
+  while (new_log) {
+    log_cond.wait(l);
+  }
   if (cct->_conf->bluefs_compact_log_sync) {
      _compact_log_sync();
   } else {
@@ -2223,6 +2234,51 @@ void BlueFS::_compact_log_dump_metadata(bluefs_transaction_t *t,
   }
 }
 
+void BlueFS::_compact_log_snapshot(log_snapshot_t *s)
+{
+  s->block_all = block_all;
+  s->fnodes.reserve(file_map.size());
+  for (auto& [ino, file_ref] : file_map) {
+    if (ino == 1)
+      continue;
+    ceph_assert(ino > 1);
+    s->fnodes.push_back(file_ref->fnode);
+  }
+  s->dirs.reserve(dir_map.size());
+  for (auto& [path, dir_ref] : dir_map) {
+    s->dirs.emplace_back(path,
+      std::vector<std::pair<std::string, uint64_t>>());
+    auto& links = s->dirs.back().second;
+    links.reserve(dir_ref->file_map.size());
+    for (auto& [fname, file_ref] : dir_ref->file_map) {
+      links.emplace_back(fname, file_ref->fnode.ino);
+    }
+  }
+}
+
+// same output as _compact_log_dump_metadata(t, 0), called without the lock
+void BlueFS::compact_log_dump_snapshot(const log_snapshot_t& s,
+				       bluefs_transaction_t *t)
+{
+  t->op_init();
+  for (unsigned bdev = 0; bdev < MAX_BDEV; ++bdev) {
+    for (auto q = s.block_all[bdev].begin();
+	 q != s.block_all[bdev].end();
+	 ++q) {
+      t->op_alloc_add(bdev, q.get_start(), q.get_len());
+    }
+  }
+  for (auto& fnode : s.fnodes) {
+    t->op_file_update(fnode);
+  }
+  for (auto& [path, links] : s.dirs) {
+    t->op_dir_create(path);
+    for (auto& [fname, ino] : links) {
+      t->op_dir_link(path, fname, ino);
+    }
+  }
+}
+
 void BlueFS::_compact_log_sync()
 {
   dout(10) << __func__ << dendl;
@@ -2393,9 +2449,25 @@ void BlueFS::_compact_log_async(std::unique_lock<ceph::mutex>& l)
 
   // 2. prepare compacted log
   bluefs_transaction_t t;
+  t.seq = 1;
+  t.uuid = super.uuid;
   //avoid record two times in log_t and _compact_log_dump_metadata.
   log_t.clear();
-  _compact_log_dump_metadata(&t, 0);
+  uint64_t jump_seq = log_seq;
+
+  // Encoding the whole file table takes long on big DBs.  Copy what we
+  // need and encode it unlocked; everything from here on lands in the
+  // old log past old_log_jump_to, which we keep.
+  {
+    log_snapshot_t snap;
+    _compact_log_snapshot(&snap);
+    log_compact_dumping = true;
+    lock.unlock();
+    compact_log_dump_snapshot(snap, &t);
+    lock.lock();
+    log_compact_dumping = false;
+    log_cond.notify_all();
+  }
 
   uint64_t max_alloc_size = std::max(alloc_size[BDEV_WAL],
 				     std::max(alloc_size[BDEV_DB],
@@ -2404,7 +2476,12 @@ void BlueFS::_compact_log_async(std::unique_lock<ceph::mutex>& l)
   // conservative estimate for final encoded size
   new_log_jump_to = round_up_to(t.op_bl.length() + super.block_size * 2,
                                 max_alloc_size);
-  t.op_jump(log_seq, new_log_jump_to);
+  t.op_jump(jump_seq, new_log_jump_to);
+
+  // ops queued while we were unlocked belong to the kept part of the log,
+  // only those generated by the _allocate call below go into the new one
+  bufferlist pending_ops;
+  pending_ops.swap(log_t.op_bl);
 
   // allocate
   //FIXME: check if we want DB here?
@@ -2414,6 +2491,7 @@ void BlueFS::_compact_log_async(std::unique_lock<ceph::mutex>& l)
 
   // we might have some more ops in log_t due to _allocate call
   t.claim_ops(log_t);
+  log_t.op_bl.swap(pending_ops);
 
   bufferlist bl;
   encode(t, bl);
@@ -2568,7 +2646,7 @@ int BlueFS::_flush_and_sync_log(std::unique_lock<ceph::mutex>& l,
   if (runway < (int64_t)cct->_conf->bluefs_min_log_runway) {
     dout(10) << __func__ << " allocating more log runway (0x"
 	     << std::hex << runway << std::dec  << " remaining)" << dendl;
-    while (new_log_writer) {
+    while (new_log_writer || log_compact_dumping) {
       dout(10) << __func__ << " waiting for async compaction" << dendl;
       log_cond.wait(l);
     }
@@ -2668,7 +2746,28 @@ int BlueFS::_flush_and_sync_log(std::unique_lock<ceph::mutex>& l,
   return 0;
 }
 
-int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
+int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length,
+			 std::unique_lock<ceph::mutex>* l)
+{
+  flush_io_t io;
+  int r = _flush_range_prepare(h, offset, length, &io);
+  if (r < 0)
+    return r;
+  // Only the log (and its compacting replacement) depends on the data
+  // being queued in lock order; everybody else is serialized by the
+  // FileWriter lock and may do the IO without holding the global one.
+  if (l && h->file->fnode.ino > 1) {
+    l->unlock();
+    _flush_range_submit(h, io);
+    l->lock();
+  } else {
+    _flush_range_submit(h, io);
+  }
+  return 0;
+}
+
+int BlueFS::_flush_range_prepare(FileWriter *h, uint64_t offset,
+				 uint64_t length, flush_io_t *io)
 {
   dout(10) << __func__ << " " << h << " pos 0x" << std::hex << h->pos
 	   << " 0x" << offset << "~" << length << std::dec
@@ -2781,12 +2880,7 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
     x_off -= partial;
     offset -= partial;
     length += partial;
-    dout(20) << __func__ << " waiting for previous aio to complete" << dendl;
-    for (auto p : h->iocv) {
-      if (p) {
-	p->aio_wait();
-      }
-    }
+    io->wait_previous = true;
   }
   if (length == partial + h->buffer.length() || clear_upto != 0) {
     /* in case of inital allocation and need to zero, limited flush is unacceptable */
@@ -2840,26 +2934,44 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   bl.hexdump(*_dout);
   *_dout << dendl;
 
+  io->buffered = buffered;
   uint64_t bloff = 0;
-  uint64_t bytes_written_slow = 0;
   while (length > 0) {
     uint64_t x_len = std::min(p->length - x_off, length);
-    bufferlist t;
-    t.substr_of(bl, bloff, x_len);
+    io->pieces.emplace_back(p->bdev, p->offset + x_off, bufferlist());
+    std::get<2>(io->pieces.back()).substr_of(bl, bloff, x_len);
+    bloff += x_len;
+    length -= x_len;
+    ++p;
+    x_off = 0;
+  }
+  vselector->add_usage(h->file->vselector_hint, h->file->fnode);
+  dout(20) << __func__ << " h " << h << " pos now 0x"
+           << std::hex << h->pos << std::dec << dendl;
+  return 0;
+}
+
+void BlueFS::_flush_range_submit(FileWriter *h, flush_io_t& io)
+{
+  if (io.wait_previous) {
+    dout(20) << __func__ << " waiting for previous aio to complete" << dendl;
+    for (auto p : h->iocv) {
+      if (p) {
+	p->aio_wait();
+      }
+    }
+  }
+  uint64_t bytes_written_slow = 0;
+  for (auto& [dev, off, t] : io.pieces) {
     if (cct->_conf->bluefs_sync_write) {
-      bdev[p->bdev]->write(p->offset + x_off, t, buffered, h->write_hint);
+      bdev[dev]->write(off, t, io.buffered, h->write_hint);
     } else {
-      bdev[p->bdev]->aio_write(p->offset + x_off, t, h->iocv[p->bdev], buffered, h->write_hint);
+      bdev[dev]->aio_write(off, t, h->iocv[dev], io.buffered, h->write_hint);
     }
-    h->dirty_devs[p->bdev] = true;
-    if (p->bdev == BDEV_SLOW) {
+    h->dirty_devs[dev] = true;
+    if (dev == BDEV_SLOW) {
       bytes_written_slow += t.length();
     }
-
-    bloff += x_len;
-    length -= x_len;
-    ++p;
-    x_off = 0;
   }
   logger->inc(l_bluefs_bytes_written_slow, bytes_written_slow);
   for (unsigned i = 0; i < MAX_BDEV; ++i) {
@@ -2869,10 +2981,6 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
       }
     }
   }
-  vselector->add_usage(h->file->vselector_hint, h->file->fnode);
-  dout(20) << __func__ << " h " << h << " pos now 0x"
-           << std::hex << h->pos << std::dec << dendl;
-  return 0;
 }
 
 #ifdef HAVE_LIBAIO
@@ -2903,7 +3011,8 @@ void BlueFS::wait_for_aio(FileWriter *h)
 }
 #endif
 
-int BlueFS::_flush(FileWriter *h, bool force)
+int BlueFS::_flush(FileWriter *h, bool force,
+		   std::unique_lock<ceph::mutex>* l)
 {
   h->buffer_appender.flush();
   uint64_t length = h->buffer.length();
@@ -2924,7 +3033,7 @@ int BlueFS::_flush(FileWriter *h, bool force)
            << std::hex << offset << "~" << length << std::dec
 	   << " to " << h->file->fnode << dendl;
   ceph_assert(h->pos <= h->file->fnode.size);
-  return _flush_range(h, offset, length);
+  return _flush_range(h, offset, length, l);
 }
 
 int BlueFS::_truncate(FileWriter *h, uint64_t offset)
@@ -2973,7 +3082,7 @@ int BlueFS::_truncate(FileWriter *h, uint64_t offset)
 int BlueFS::_fsync(FileWriter *h, std::unique_lock<ceph::mutex>& l)
 {
   dout(10) << __func__ << " " << h << " " << h->file->fnode << dendl;
-  int r = _flush(h, true);
+  int r = _flush(h, true, &l);
   if (r < 0)
      return r;
   uint64_t old_dirty_seq = h->file->dirty_seq;
@@ -3221,6 +3330,162 @@ void BlueFS::sync_metadata(bool avoid_compact)
   }
 }
 
+void BlueFS::start_hot_file_migration()
+{
+  std::lock_guard l(lock);
+  if (migrate_thread.is_started()) {
+    return;
+  }
+  dout(1) << __func__ << dendl;
+  migrate_stop = false;
+  migrate_thread.create("bfs_migrate");
+}
+
+void BlueFS::stop_hot_file_migration()
+{
+  {
+    std::lock_guard l(lock);
+    if (!migrate_thread.is_started()) {
+      return;
+    }
+    dout(10) << __func__ << dendl;
+    migrate_stop = true;
+    migrate_cond.notify_all();
+  }
+  migrate_thread.join();
+  migrate_stop = false;
+}
+
+void BlueFS::_migrate_thread()
+{
+  std::unique_lock l(lock);
+  while (!migrate_stop) {
+    auto interval = cct->_conf.get_val<double>(
+      "bluefs_hot_file_migration_interval");
+    migrate_cond.wait_for(l, ceph::make_timespan(interval));
+    if (migrate_stop) {
+      break;
+    }
+    _migrate_hot_files(l);
+  }
+}
+
+void BlueFS::_migrate_hot_files(std::unique_lock<ceph::mutex>& l)
+{
+  if (!bdev[BDEV_SLOW] || !alloc[BDEV_DB]) {
+    return;
+  }
+  // heat is the number of reads since the previous pass, so files
+  // that cooled down stop qualifying on their own
+  std::vector<std::pair<uint64_t, FileRef>> hot;
+  for (auto& p : file_map) {
+    auto& f = p.second;
+    uint64_t ops = f->num_read_ops.load();
+    uint64_t heat = ops - f->last_read_ops;
+    f->last_read_ops = ops;
+    if (f->fnode.ino <= 1 || heat == 0 || f->fnode.size == 0 ||
+	f->deleted || f->num_writers.load()) {
+      continue;
+    }
+    bool on_slow = std::any_of(
+      f->fnode.extents.begin(), f->fnode.extents.end(),
+      [](const bluefs_extent_t& e) { return e.bdev == BDEV_SLOW; });
+    if (on_slow) {
+      hot.emplace_back(heat, f);
+    }
+  }
+  std::sort(hot.begin(), hot.end(),
+	    [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (auto& [heat, f] : hot) {
+    if (migrate_stop) {
+      break;
+    }
+    // ask again each time, usage changes as files are moved
+    if (f->deleted ||
+	!vselector->should_promote(f->vselector_hint, f->fnode, heat)) {
+      continue;
+    }
+    dout(10) << __func__ << " heat " << heat << " " << f->fnode << dendl;
+    int r = _migrate_file(f, BDEV_DB, l);
+    if (r == -ENOSPC) {
+      break;
+    }
+  }
+}
+
+int BlueFS::_migrate_file(FileRef f, unsigned id,
+			  std::unique_lock<ceph::mutex>& l)
+{
+  bluefs_fnode_t src = f->fnode;
+  uint64_t len = round_up_to(src.size, super.block_size);
+  PExtentVector extents;
+  int r = _allocate_without_fallback(id, len, &extents);
+  if (r < 0) {
+    return r;
+  }
+  bluefs_fnode_t dst;
+  for (auto& e : extents) {
+    dst.append_extent(bluefs_extent_t(id, e.offset, e.length));
+  }
+
+  // The file is immutable while nobody has it open for write, so the
+  // copy is done without the lock, readers keep using the old extents.
+  l.unlock();
+  constexpr uint64_t max_chunk = 1ull << 22;
+  uint64_t pos = 0;
+  while (pos < len && r == 0) {
+    uint64_t s_off = 0, d_off = 0;
+    auto sp = src.seek(pos, &s_off);
+    auto dp = dst.seek(pos, &d_off);
+    uint64_t n = std::min({len - pos,
+			   uint64_t(sp->length) - s_off,
+			   uint64_t(dp->length) - d_off,
+			   max_chunk});
+    bufferlist bl;
+    r = bdev[sp->bdev]->read(sp->offset + s_off, n, &bl, ioc[sp->bdev], false);
+    if (r == 0) {
+      r = bdev[id]->write(dp->offset + d_off, bl, false);
+    }
+    pos += n;
+  }
+  if (r == 0) {
+    bdev[id]->flush();
+  }
+  l.lock();
+
+  // anything that could have changed the content also bumps mtime
+  if (r < 0 || f->deleted || f->num_writers.load() ||
+      f->fnode.size != src.size || f->fnode.mtime != src.mtime) {
+    dout(10) << __func__ << " gave up on " << f->fnode
+	     << ": " << cpp_strerror(r) << dendl;
+    alloc[id]->release(extents);
+    return r < 0 ? r : -EAGAIN;
+  }
+
+  f->migrating = true;
+  while (f->num_reading.load()) {
+    std::this_thread::yield();
+  }
+  vselector->sub_usage(f->vselector_hint, f->fnode);
+  for (auto& p : f->fnode.extents) {
+    pending_release[p.bdev].insert(p.offset, p.length);
+  }
+  f->fnode.clear_extents();
+  for (auto& p : dst.extents) {
+    f->fnode.append_extent(p);
+  }
+  vselector->add_usage(f->vselector_hint, f->fnode);
+  f->migrating = false;
+
+  dout(10) << __func__ << " moved to " << f->fnode << dendl;
+  logger->inc(l_bluefs_hot_migrate_count);
+  logger->inc(l_bluefs_hot_migrate_bytes, len);
+  log_t.op_file_update(f->fnode);
+  // old extents are released once the update is stable
+  _flush_and_sync_log(l);
+  return 0;
+}
+
 int BlueFS::open_for_write(
   const string& dirname,
   const string& filename,
@@ -3303,6 +3568,12 @@ int BlueFS::open_for_write(
     }
   } else if (boost::algorithm::ends_with(filename, ".sst")) {
     (*h)->writer_type = BlueFS::WRITER_SST;
+    // table writes come from flush and compaction, not the commit path
+    for (unsigned i = 0; i < MAX_BDEV; ++i) {
+      if ((*h)->iocv[i]) {
+	(*h)->iocv[i]->io_class = BLK_IO_BLUEFS;
+      }
+    }
     if (logger) {
       logger->inc(l_bluefs_files_written_sst);
     }
@@ -3602,6 +3873,16 @@ bool BlueFS::wal_is_rotational()
   return bdev[BDEV_SLOW]->is_rotational();
 }
 
+bool BlueFS::wal_is_persistent_memory()
+{
+  if (bdev[BDEV_WAL]) {
+    return bdev[BDEV_WAL]->is_persistent_memory();
+  } else if (bdev[BDEV_DB]) {
+    return bdev[BDEV_DB]->is_persistent_memory();
+  }
+  return bdev[BDEV_SLOW]->is_persistent_memory();
+}
+
 void BlueFS::debug_inject_duplicate_gift(unsigned id,
   uint64_t offset,
   uint64_t len)
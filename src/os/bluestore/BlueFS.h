@@ -5,11 +5,13 @@
 
 #include <atomic>
 #include <mutex>
+#include <thread>
 
 #include "bluefs_types.h"
 #include "BlockDevice.h"
 
 #include "common/RefCountedObj.h"
+#include "common/Thread.h"
 #include "common/ceph_context.h"
 #include "global/global_context.h"
 #include "include/common_fwd.h"
@@ -51,6 +53,8 @@ enum {
   l_bluefs_read_bytes,
   l_bluefs_read_prefetch_count,
   l_bluefs_read_prefetch_bytes,
+  l_bluefs_hot_migrate_count,
+  l_bluefs_hot_migrate_bytes,
 
   l_bluefs_last,
 };
@@ -88,6 +92,12 @@ public:
   virtual void add_usage(void* file_hint, uint64_t fsize) = 0;
   virtual void sub_usage(void* file_hint, uint64_t fsize) = 0;
   virtual uint8_t select_prefer_bdev(void* hint) = 0;
+  /// should a file with data outside of BDEV_DB be moved there?
+  /// @heat is the number of reads seen since the previous check
+  virtual bool should_promote(void* hint, const bluefs_fnode_t& fnode,
+			      uint64_t heat) {
+    return false;
+  }
   virtual void get_paths(const std::string& base, paths& res) const = 0;
   virtual void dump(std::ostream& sout) = 0;
 };
@@ -121,9 +131,28 @@ public:
 
     std::atomic_int num_readers, num_writers;
     std::atomic_int num_reading;
+    std::atomic_bool migrating;      ///< extents are being swapped
+    std::atomic<uint64_t> num_read_ops; ///< read calls, for placement heat
+    uint64_t last_read_ops = 0;      ///< num_read_ops at last heat check
 
     void* vselector_hint = nullptr;
 
+    /// readers run without BlueFS::lock, keep them off while
+    /// the extents are replaced by a migration
+    void start_reading() {
+      ++num_read_ops;
+      while (true) {
+	++num_reading;
+	if (!migrating.load()) {
+	  break;
+	}
+	--num_reading;
+	while (migrating.load()) {
+	  std::this_thread::yield();
+	}
+      }
+    }
+
   private:
     FRIEND_MAKE_REF(File);
     File()
@@ -135,6 +164,8 @@ public:
 	num_readers(0),
 	num_writers(0),
 	num_reading(0),
+	migrating(false),
+	num_read_ops(0),
         vselector_hint(nullptr)
       {}
     ~File() override {
@@ -311,6 +342,18 @@ private:
   uint64_t old_log_jump_to = 0;
   FileRef new_log = nullptr;
   FileWriter *new_log_writer = nullptr;
+  bool log_compact_dumping = false; ///< compaction encoding metadata unlocked
+
+  struct MigrateThread : public Thread {
+    BlueFS *bluefs;
+    explicit MigrateThread(BlueFS *b) : bluefs(b) {}
+    void *entry() override {
+      bluefs->_migrate_thread();
+      return nullptr;
+    }
+  } migrate_thread{this};
+  bool migrate_stop = false;
+  ceph::condition_variable migrate_cond;
 
   /*
    * There are up to 3 block devices:
@@ -357,8 +400,20 @@ private:
   int _allocate_without_fallback(uint8_t id, uint64_t len,
 				 PExtentVector* extents);
 
-  int _flush_range(FileWriter *h, uint64_t offset, uint64_t length);
-  int _flush(FileWriter *h, bool force);
+  /// data IO prepared by _flush_range_prepare
+  struct flush_io_t {
+    bool buffered = false;
+    bool wait_previous = false; ///< rewriting the partial tail block
+    std::vector<std::tuple<unsigned, uint64_t, ceph::buffer::list>> pieces;
+  };
+  /// if @l is given, it is dropped while the IO is queued (not for the log)
+  int _flush_range(FileWriter *h, uint64_t offset, uint64_t length,
+		   std::unique_lock<ceph::mutex>* l = nullptr);
+  int _flush_range_prepare(FileWriter *h, uint64_t offset, uint64_t length,
+			   flush_io_t *io);
+  void _flush_range_submit(FileWriter *h, flush_io_t& io);
+  int _flush(FileWriter *h, bool force,
+	     std::unique_lock<ceph::mutex>* l = nullptr);
   int _fsync(FileWriter *h, std::unique_lock<ceph::mutex>& l);
 
 #ifdef HAVE_LIBAIO
@@ -380,9 +435,24 @@ private:
   };
   void _compact_log_dump_metadata(bluefs_transaction_t *t,
 				  int flags);
+
+  /// point-in-time copy of the metadata, encoded without holding the lock
+  struct log_snapshot_t {
+    std::vector<interval_set<uint64_t>> block_all;
+    std::vector<bluefs_fnode_t> fnodes;
+    std::vector<std::pair<std::string,
+			  std::vector<std::pair<std::string, uint64_t>>>> dirs;
+  };
+  void _compact_log_snapshot(log_snapshot_t *s);
+  void compact_log_dump_snapshot(const log_snapshot_t& s,
+				 bluefs_transaction_t *t);
   void _compact_log_sync();
   void _compact_log_async(std::unique_lock<ceph::mutex>& l);
 
+  void _migrate_thread();
+  void _migrate_hot_files(std::unique_lock<ceph::mutex>& l);
+  int _migrate_file(FileRef f, unsigned id, std::unique_lock<ceph::mutex>& l);
+
   void _rewrite_log_and_layout_sync(bool allocate_with_fallback,
 				    int super_dev,
 				    int log_dev,
@@ -509,6 +579,7 @@ public:
   int mkdir(const std::string& dirname);
   int rmdir(const std::string& dirname);
   bool wal_is_rotational();
+  bool wal_is_persistent_memory();
 
   bool dir_exists(const std::string& dirname);
   int stat(const std::string& dirname, const std::string& filename,
@@ -522,6 +593,10 @@ public:
   /// sync any uncommitted state to disk
   void sync_metadata(bool avoid_compact);
 
+  /// periodically move files the volume selector finds hot to BDEV_DB
+  void start_hot_file_migration();
+  void stop_hot_file_migration();
+
   void set_slow_device_expander(BlueFSDeviceExpander* a) {
     slow_dev_expander = a;
   }
@@ -557,15 +632,21 @@ public:
   // handler for discard event
   void handle_discard(unsigned dev, interval_set<uint64_t>& to_release);
 
+  // FileWriter::lock serializes the ops on a writer while the global
+  // lock is only held for the metadata part of them.  Always taken
+  // before the global lock.
   void flush(FileWriter *h) {
-    std::lock_guard l(lock);
-    _flush(h, false);
+    std::lock_guard hl(h->lock);
+    std::unique_lock l(lock);
+    _flush(h, false, &l);
   }
   void flush_range(FileWriter *h, uint64_t offset, uint64_t length) {
-    std::lock_guard l(lock);
-    _flush_range(h, offset, length);
+    std::lock_guard hl(h->lock);
+    std::unique_lock l(lock);
+    _flush_range(h, offset, length, &l);
   }
   int fsync(FileWriter *h) {
+    std::lock_guard hl(h->lock);
     std::unique_lock l(lock);
     return _fsync(h, l);
   }
@@ -592,6 +673,7 @@ public:
     return _preallocate(f, offset, len);
   }
   int truncate(FileWriter *h, uint64_t offset) {
+    std::lock_guard hl(h->lock);
     std::lock_guard l(lock);
     return _truncate(h, offset);
   }
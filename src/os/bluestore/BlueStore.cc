@@ -18,6 +18,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/container/flat_set.hpp>
 #include "boost/algorithm/string.hpp"
 
@@ -25,12 +27,15 @@
 
 #include "bluestore_common.h"
 #include "BlueStore.h"
+#include "FrequencySketch.h"
+#include "ZonedAllocator.h"
 #include "os/kv.h"
 #include "include/compat.h"
 #include "include/intarith.h"
 #include "include/stringify.h"
 #include "include/str_map.h"
 #include "include/util.h"
+#include "common/Cond.h"
 #include "common/errno.h"
 #include "common/safe_io.h"
 #include "common/PriorityCache.h"
@@ -45,6 +50,7 @@
 #include "common/blkdev.h"
 #include "common/numa.h"
 #include "common/pretty_binary.h"
+#include "common/admin_socket.h"
 
 #if defined(WITH_LTTNG)
 #define TRACEPOINT_DEFINE
@@ -104,6 +110,7 @@ using ceph::make_timespan;
 using ceph::mono_clock;
 using ceph::mono_time;
 using ceph::timespan_str;
+using TOPNSPC::common::cmd_getval;
 
 // kv store prefixes
 const string PREFIX_SUPER = "S";       // field -> value
@@ -117,8 +124,13 @@ const string PREFIX_DEFERRED = "L";    // id -> deferred_transaction_t
 const string PREFIX_ALLOC = "B";       // u64 offset -> u64 length (freelist)
 const string PREFIX_ALLOC_BITMAP = "b";// (see BitmapFreelistManager)
 const string PREFIX_SHARED_BLOB = "X"; // u64 offset -> shared_blob_t
+const string PREFIX_ALLOC_SNAPSHOT = "a"; // u64 chunk -> interval_set<u64>
 
 const string BLUESTORE_GLOBAL_STATFS_KEY = "bluestore_statfs";
+const string BLUESTORE_ALLOC_SNAPSHOT_KEY = "alloc_snapshot";
+
+// free extents per PREFIX_ALLOC_SNAPSHOT record
+#define ALLOC_SNAPSHOT_CHUNK_EXTENTS 65536
 
 // write a label in the first block.  always use this size.  note that
 // bluefs makes a matching assumption about the location of its
@@ -130,6 +142,26 @@ const string BLUESTORE_GLOBAL_STATFS_KEY = "bluestore_statfs";
 
 #define OBJECT_MAX_SIZE 0xffffffff // 32 bits
 
+// Latency axis of the txc state histograms, values are in nanoseconds
+const PerfHistogramCommon::axis_config_d
+BlueStore::state_lat_hist_x_axis_config{
+  "Latency (usec)",
+  PerfHistogramCommon::SCALE_LOG2, ///< Latency in logarithmic scale
+  0,                               ///< Start at 0
+  1000,                            ///< Quantization unit is 1usec
+  32,                              ///< Enough to cover stalls of many minutes
+};
+
+// State axis of the txc state histograms, one bucket per state counter
+const PerfHistogramCommon::axis_config_d
+BlueStore::state_lat_hist_y_axis_config{
+  "State",
+  PerfHistogramCommon::SCALE_LINEAR,
+  0,
+  1,
+  l_bluestore_state_done_lat - l_bluestore_state_prepare_lat + 1,
+};
+
 
 /*
  * extent map blob encoding
@@ -826,9 +858,29 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
 
   list_t lru;
   pin_list_t pin_list;
+  FrequencySketch sketch;
 
   explicit LruOnodeCacheShard(CephContext *cct) : BlueStore::OnodeCacheShard(cct) {}
 
+  // Record an access to an onode entering the lru and tell whether it
+  // goes to the hot end.  Once the cache is full a newcomer is only
+  // placed there if it has been seen more often than the next victim,
+  // so one-off scans (scrub, backfill) age out first.
+  bool _admit(BlueStore::Onode& o)
+  {
+    if (!cct->_conf->bluestore_cache_onode_admission) {
+      return true;
+    }
+    sketch.resize(max * 2);
+    auto h = std::hash<ghobject_t>()(o.oid);
+    sketch.increment(h);
+    if (lru.empty() || lru.size() < max) {
+      return true;
+    }
+    return sketch.estimate(h) >
+      sketch.estimate(std::hash<ghobject_t>()(lru.back().oid));
+  }
+
   void _add(BlueStore::OnodeRef& o, int level) override
   {
     ceph_assert(o->s == nullptr);
@@ -838,7 +890,7 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
       o->pinned = true;
       num_pinned = pin_list.size();
     } else {
-      (level > 0) ? lru.push_front(*o) : lru.push_back(*o);
+      (level > 0 && _admit(*o)) ? lru.push_front(*o) : lru.push_back(*o);
     }
     num = lru.size();
   }
@@ -882,7 +934,7 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
       return;
     }
     pin_list.erase(pin_list.iterator_to(o));
-    lru.push_front(o);
+    _admit(o) ? lru.push_front(o) : lru.push_back(o);
     o.pinned = false;
     num = lru.size();
     num_pinned = pin_list.size();
@@ -894,11 +946,26 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
       return; // don't even try
     } 
     uint64_t n = lru.size() - new_size;
+    // give cold onodes with decoded extent shards a second pass through
+    // the lru with just their metadata; evict the ones already unloaded.
+    // each onode can be unloaded at most once, so this terminates.
+    bool unload = new_size > 0 && cct->_conf->bluestore_cache_unload_cold_extents;
+    uint64_t max_unload = lru.size();
     auto p = lru.end();
     ceph_assert(p != lru.begin());
     --p;
     while (n > 0) {
       BlueStore::Onode *o = &*p;
+      if (unload && max_unload > 0 && p != lru.begin()) {
+	--max_unload;
+	if (o->c->onode_map.unload_unreferenced(o)) {
+	  dout(30) << __func__ << "  unloaded shards of " << o->oid << dendl;
+	  logger->inc(l_bluestore_onode_shard_unloads);
+	  lru.erase(p--);
+	  lru.push_front(*o);
+	  continue;
+	}
+      }
       dout(30) << __func__ << "  rm " << o->oid << dendl;
       if (p != lru.begin()) {
         lru.erase(p--);
@@ -908,7 +975,16 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
       }
       o->s = nullptr;
       o->get();  // paranoia
-      o->c->onode_map.remove(o->oid);
+      if (!o->c->onode_map.remove_unreferenced(o->oid)) {
+	// a lookup took a ref without the shard lock since we picked it;
+	// pin it here rather than drop an onode that is in use.
+	dout(30) << __func__ << "  raced with lookup, pinning " << o->oid
+		 << dendl;
+	o->s = this;
+	pin_list.push_front(*o);
+	o->pinned = true;
+	num_pinned = pin_list.size();
+      }
       o->put();
       --n;
     }
@@ -1360,6 +1436,12 @@ BlueStore::BufferCacheShard *BlueStore::BufferCacheShard::create(
   else
     ceph_abort_msg("unrecognized cache type");
   c->logger = logger;
+  if (cct->_conf.get_val<bool>("bluestore_cache_arena")) {
+    c->arena = std::make_shared<CacheArena>(
+      cct,
+      cct->_conf.get_val<int64_t>("osd_numa_node"),
+      cct->_conf.get_val<bool>("bluestore_cache_arena_hugetlb"));
+  }
   return c;
 }
 
@@ -1545,7 +1627,9 @@ void BlueStore::BufferSpace::_finish_write(BufferCacheShard* cache, uint64_t seq
     } else {
       b->state = Buffer::STATE_CLEAN;
       writing.erase(i++);
-      b->maybe_rebuild();
+      if (!cache->_copy_to_arena(b)) {
+	b->maybe_rebuild();
+      }
       b->data.reassign_to_mempool(mempool::mempool_bluestore_cache_data);
       cache->_add(b, 1, nullptr);
       ldout(cache->cct, 20) << __func__ << " added " << *b << dendl;
@@ -1614,6 +1698,7 @@ void BlueStore::BufferSpace::split(BufferCacheShard* cache, size_t pos, BlueStor
 BlueStore::OnodeRef BlueStore::OnodeSpace::add(const ghobject_t& oid, OnodeRef o)
 {
   std::lock_guard l(cache->lock);
+  std::unique_lock ml(lock);
   auto p = onode_map.find(oid);
   if (p != onode_map.end()) {
     ldout(cache->cct, 30) << __func__ << " " << oid << " " << o
@@ -1624,31 +1709,64 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::add(const ghobject_t& oid, OnodeRef o
   ldout(cache->cct, 30) << __func__ << " " << oid << " " << o << dendl;
   onode_map[oid] = o;
   cache->_add(o, 1);
+  ml.unlock();  // trim may remove entries from this map
   cache->_trim();
   return o;
 }
 
+bool BlueStore::OnodeSpace::unload_unreferenced(Onode *o)
+{
+  std::unique_lock l(lock);
+  // the map's ref is the only one; lookups can't take another meanwhile
+  if (o->nref > 1) {
+    return false;
+  }
+  return o->extent_map.unload_shards();
+}
+
+bool BlueStore::OnodeSpace::remove_unreferenced(const ghobject_t& oid)
+{
+  std::unique_lock l(lock);
+  auto p = onode_map.find(oid);
+  ceph_assert(p != onode_map.end());
+  // one ref is held by the map, one by our caller
+  if (p->second->nref > 2) {
+    return false;
+  }
+  onode_map.erase(p);
+  return true;
+}
+
 BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
 {
   ldout(cache->cct, 30) << __func__ << dendl;
   OnodeRef o;
   bool hit = false;
+  int nref = 0;
 
   {
-    std::lock_guard l(cache->lock);
+    // take the ref by hand: Onode::get() may pin, which needs the shard
+    // lock, and that must not be taken while holding our lock.
+    std::shared_lock l(lock);
     ceph::unordered_map<ghobject_t,OnodeRef>::iterator p = onode_map.find(oid);
     if (p == onode_map.end()) {
       ldout(cache->cct, 30) << __func__ << " " << oid << " miss" << dendl;
     } else {
       ldout(cache->cct, 30) << __func__ << " " << oid << " hit " << p->second
 			    << dendl;
-      cache->_touch(p->second);
       hit = true;
-      o = p->second;
+      nref = ++p->second->nref;
+      o.reset(p->second.get(), false);
     }
   }
 
   if (hit) {
+    // there is no explicit lru touch; pinning takes the onode off the lru
+    // and unpinning puts it back at the front.  if trim got to it first,
+    // it is already pinned and this is a no-op.
+    if (nref == 2 && o->s != nullptr) {
+      o->s->pin(*o);
+    }
     cache->logger->inc(l_bluestore_onode_hits);
   } else {
     cache->logger->inc(l_bluestore_onode_misses);
@@ -1659,6 +1777,7 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
 void BlueStore::OnodeSpace::clear()
 {
   std::lock_guard l(cache->lock);
+  std::unique_lock ml(lock);
   ldout(cache->cct, 10) << __func__ << dendl;
   for (auto &p : onode_map) {
     cache->_rm(p.second);
@@ -1666,9 +1785,15 @@ void BlueStore::OnodeSpace::clear()
   onode_map.clear();
 }
 
+bool BlueStore::OnodeSpace::contains(const ghobject_t& oid)
+{
+  std::shared_lock l(lock);
+  return onode_map.count(oid);
+}
+
 bool BlueStore::OnodeSpace::empty()
 {
-  std::lock_guard l(cache->lock);
+  std::shared_lock l(lock);
   return onode_map.empty();
 }
 
@@ -1679,6 +1804,7 @@ void BlueStore::OnodeSpace::rename(
   const mempool::bluestore_cache_other::string& new_okey)
 {
   std::lock_guard l(cache->lock);
+  std::unique_lock ml(lock);
   ldout(cache->cct, 30) << __func__ << " " << old_oid << " -> " << new_oid
 			<< dendl;
   ceph::unordered_map<ghobject_t,OnodeRef>::iterator po, pn;
@@ -1704,12 +1830,14 @@ void BlueStore::OnodeSpace::rename(
   cache->_touch(o);
   o->oid = new_oid;
   o->key = new_okey;
+  ml.unlock();  // trim may remove entries from this map
   cache->_trim();
 }
 
 bool BlueStore::OnodeSpace::map_any(std::function<bool(OnodeRef)> f)
 {
   std::lock_guard l(cache->lock);
+  std::shared_lock ml(lock);
   ldout(cache->cct, 20) << __func__ << dendl;
   for (auto& i : onode_map) {
     if (f(i.second)) {
@@ -2942,6 +3070,31 @@ void BlueStore::ExtentMap::init_shards(bool loaded, bool dirty)
   }
 }
 
+bool BlueStore::ExtentMap::unload_shards()
+{
+  if (shards.empty() || needs_reshard()) {
+    return false;
+  }
+  bool any_loaded = false;
+  for (auto& s : shards) {
+    if (s.dirty) {
+      return false;
+    }
+    any_loaded |= s.loaded;
+  }
+  if (!any_loaded) {
+    return false;
+  }
+  dout(20) << __func__ << " " << onode->oid << " " << shards.size()
+	   << " shards, " << extent_map.size() << " extents" << dendl;
+  extent_map.clear_and_dispose(DeleteDisposer());
+  for (auto& s : shards) {
+    s.loaded = false;
+    s.extents = 0;
+  }
+  return true;
+}
+
 void BlueStore::ExtentMap::fault_range(
   KeyValueDB *db,
   uint32_t offset,
@@ -3673,6 +3826,46 @@ BlueStore::OnodeRef BlueStore::Collection::get_onode(
   return onode_map.add(oid, o);
 }
 
+void BlueStore::Collection::prefetch_onodes(const std::vector<ghobject_t>& oids)
+{
+  ceph_assert(ceph_mutex_is_locked(lock));
+  spg_t pgid;
+  bool is_pg = cid.is_pg(&pgid);
+  std::set<std::string> keys;
+  std::map<std::string, const ghobject_t*> key_oid;
+  for (auto& oid : oids) {
+    if (is_pg && !oid.match(cnode.bits, pgid.ps())) {
+      continue;
+    }
+    if (onode_map.contains(oid)) {
+      continue;
+    }
+    string key;
+    get_object_key(store->cct, oid, &key);
+    key_oid[key] = &oid;
+    keys.insert(std::move(key));
+  }
+  if (keys.empty()) {
+    return;
+  }
+  // same guarantee as get_onode: a cache miss under our lock means the kv
+  // store has the latest version of the onode
+  std::map<std::string, bufferlist> values;
+  store->db->get(PREFIX_OBJ, keys, &values);
+  ldout(store->cct, 20) << __func__ << " loaded " << values.size() << "/"
+			<< keys.size() << " onodes" << dendl;
+  for (auto& [key, v] : values) {
+    if (v.length() == 0) {
+      continue;
+    }
+    const ghobject_t& oid = *key_oid[key];
+    OnodeRef o(Onode::decode(this, oid, key, v));
+    o = onode_map.add(oid, o);
+    o->extent_map.fault_range(store->db, 0, OBJECT_MAX_SIZE);
+    store->logger->inc(l_bluestore_onode_prefetched);
+  }
+}
+
 void BlueStore::Collection::split_cache(
   Collection *dest)
 {
@@ -3682,6 +3875,10 @@ void BlueStore::Collection::split_cache(
   std::lock(cache->lock, dest->cache->lock);
   std::lock_guard l(cache->lock, std::adopt_lock);
   std::lock_guard l2(dest->cache->lock, std::adopt_lock);
+  // with both shard locks held nobody else can be after these exclusively,
+  // so the order does not matter here.
+  std::unique_lock ml(onode_map.lock);
+  std::unique_lock ml2(dest->onode_map.lock);
 
   int destbits = dest->cnode.bits;
   spg_t destpg;
@@ -3792,6 +3989,10 @@ void *BlueStore::MempoolThread::entry()
     pcm->insert("kv", binned_kv_cache, true);
     pcm->insert("meta", meta_cache, true);
     pcm->insert("data", data_cache, true);
+    memtable_cache = store->db->get_memtable_priority_cache();
+    if (memtable_cache != nullptr) {
+      pcm->insert("kv_memtable", memtable_cache, true);
+    }
   }
 
   utime_t next_balance = ceph_clock_now();
@@ -3872,6 +4073,10 @@ void BlueStore::MempoolThread::_adjust_cache_settings()
   if (binned_kv_cache != nullptr) {
     binned_kv_cache->set_cache_ratio(store->cache_kv_ratio);
   }
+  if (memtable_cache != nullptr) {
+    // competes for memory with the same weight as the block cache
+    memtable_cache->set_cache_ratio(store->cache_kv_ratio);
+  }
   meta_cache->set_cache_ratio(store->cache_meta_ratio);
   data_cache->set_cache_ratio(store->cache_data_ratio);
 }
@@ -4137,6 +4342,74 @@ void BlueStore::handle_discard(interval_set<uint64_t>& to_release)
   alloc->release(to_release);
 }
 
+class BlueStore::SocketHook : public AdminSocketHook {
+  BlueStore *store;
+public:
+  static BlueStore::SocketHook* create(BlueStore *store)
+  {
+    BlueStore::SocketHook* hook = nullptr;
+    AdminSocket* admin_socket = store->cct->get_admin_socket();
+    if (admin_socket) {
+      hook = new BlueStore::SocketHook(store);
+      int r = admin_socket->register_command(
+	"bluestore txc state histogram "
+	"name=reset,type=CephBool,req=false",
+	hook,
+	"Dump transaction state latency histograms for each op sequencer, "
+	"optionally resetting them.");
+      if (r == 0) {
+	r = admin_socket->register_command(
+	  "bluestore txc capture start "
+	  "name=path,type=CephString",
+	  hook,
+	  "Append the encoded transactions queued from now on to a file, "
+	  "to replay them with ceph_objectstore_replay.");
+      }
+      if (r == 0) {
+	r = admin_socket->register_command(
+	  "bluestore txc capture stop",
+	  hook,
+	  "Stop the transaction capture.");
+      }
+      if (r != 0) {
+	lgeneric_dout(store->cct, 1) << __func__
+				     << " cannot register SocketHook" << dendl;
+	delete hook;
+	hook = nullptr;
+      }
+    }
+    return hook;
+  }
+
+  ~SocketHook() {
+    AdminSocket* admin_socket = store->cct->get_admin_socket();
+    admin_socket->unregister_commands(this);
+  }
+private:
+  SocketHook(BlueStore *store) :
+    store(store) {}
+  int call(std::string_view command, const cmdmap_t& cmdmap,
+	   Formatter *f,
+	   std::ostream& errss,
+	   bufferlist& out) override {
+    if (command == "bluestore txc state histogram") {
+      bool reset = false;
+      cmd_getval(cmdmap, "reset", reset);
+      store->dump_state_lat_histograms(f, reset);
+    } else if (command == "bluestore txc capture start") {
+      std::string path;
+      cmd_getval(cmdmap, "path", path);
+      return store->start_txc_capture(path, errss);
+    } else if (command == "bluestore txc capture stop") {
+      return store->stop_txc_capture(errss);
+    } else {
+      errss << "Invalid command" << std::endl;
+      return -ENOSYS;
+    }
+    return 0;
+  }
+};
+
 BlueStore::BlueStore(CephContext *cct, const string& path)
   : BlueStore(cct, path, 0) {}
 
@@ -4150,15 +4423,24 @@ BlueStore::BlueStore(CephContext *cct,
     kv_finalize_thread(this),
     min_alloc_size(_min_alloc_size),
     min_alloc_size_order(ctz(_min_alloc_size)),
-    mempool_thread(this)
+    mempool_thread(this),
+    defrag_thread(this),
+    zoned_cleaner_thread(this),
+    prefetch_thread(this)
 {
   _init_logger();
   cct->_conf.add_observer(this);
   set_cache_shards(1);
+  asok_hook = SocketHook::create(this);
 }
 
 BlueStore::~BlueStore()
 {
+  delete asok_hook;
+  asok_hook = nullptr;
+  if (capture_fd >= 0) {
+    VOID_TEMP_FAILURE_RETRY(::close(capture_fd));
+  }
   cct->_conf.remove_observer(this);
   _shutdown_logger();
   ceph_assert(!mounted);
@@ -4193,6 +4475,7 @@ const char **BlueStore::get_tracked_conf_keys() const
     "bluestore_prefer_deferred_size",
     "bluestore_prefer_deferred_size_hdd",
     "bluestore_prefer_deferred_size_ssd",
+    "bluestore_prefer_deferred_size_pmem",
     "bluestore_deferred_batch_ops",
     "bluestore_deferred_batch_ops_hdd",
     "bluestore_deferred_batch_ops_ssd",
@@ -4251,6 +4534,7 @@ void BlueStore::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("bluestore_prefer_deferred_size") ||
       changed.count("bluestore_prefer_deferred_size_hdd") ||
       changed.count("bluestore_prefer_deferred_size_ssd") ||
+      changed.count("bluestore_prefer_deferred_size_pmem") ||
       changed.count("bluestore_max_alloc_size") ||
       changed.count("bluestore_deferred_batch_ops") ||
       changed.count("bluestore_deferred_batch_ops_hdd") ||
@@ -4498,6 +4782,8 @@ void BlueStore::_init_logger()
 {
   PerfCountersBuilder b(cct, "bluestore",
                         l_bluestore_first, l_bluestore_last);
+  // updated by every kv and shard thread for every transaction
+  b.set_striped(true);
   b.add_time_avg(l_bluestore_kv_flush_lat, "kv_flush_lat",
 		 "Average kv_thread flush latency",
 		 "fl_l", PerfCountersBuilder::PRIO_INTERESTING);
@@ -4532,6 +4818,10 @@ void BlueStore::_init_logger()
     "Average finishing state latency");
   b.add_time_avg(l_bluestore_state_done_lat, "state_done_lat",
     "Average done state latency");
+  b.add_u64_counter_histogram(
+    l_bluestore_state_lat_histogram, "state_latency_histogram",
+    state_lat_hist_x_axis_config, state_lat_hist_y_axis_config,
+    "Histogram of transaction state latency, by state");
   b.add_time_avg(l_bluestore_throttle_lat, "throttle_lat",
 		 "Average submit throttle latency",
 		 "th_l", PerfCountersBuilder::PRIO_CRITICAL);
@@ -4592,6 +4882,12 @@ void BlueStore::_init_logger()
   b.add_u64_counter(l_bluestore_onode_shard_misses,
 		    "bluestore_onode_shard_misses",
 		    "Sum for onode-shard lookups missed in the cache");
+  b.add_u64_counter(l_bluestore_onode_shard_unloads,
+		    "bluestore_onode_shard_unloads",
+		    "Sum for cold onodes whose decoded extent shards were dropped");
+  b.add_u64_counter(l_bluestore_onode_prefetched,
+		    "bluestore_onode_prefetched",
+		    "Sum for onodes loaded ahead of use on a prefetch hint");
   b.add_u64(l_bluestore_extents, "bluestore_extents",
 	    "Number of extents in cache");
   b.add_u64(l_bluestore_blobs, "bluestore_blobs",
@@ -4657,6 +4953,19 @@ void BlueStore::_init_logger()
     "Average omap iterator next call latency");
   b.add_time_avg(l_bluestore_clist_lat, "clist_lat",
     "Average collection listing latency");
+  b.add_u64_counter(l_bluestore_defrag_scanned, "defrag_scanned",
+    "Onodes checked for fragmentation by background defrag");
+  b.add_u64_counter(l_bluestore_defrag_onodes, "defrag_onodes",
+    "Onodes rewritten by background defrag");
+  b.add_u64_counter(l_bluestore_defrag_bytes, "defrag_bytes",
+    "Bytes rewritten by background defrag", NULL, 0, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_defrag_extents_removed, "defrag_extents_removed",
+    "Physical extents eliminated by background defrag");
+  b.add_u64_counter(l_bluestore_zoned_cleaned_bytes, "zoned_cleaned_bytes",
+    "Bytes moved out of zones by the zoned cleaner", NULL, 0,
+    unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_zoned_zones_reset, "zoned_zones_reset",
+    "Zones reset by the zoned cleaner");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -4681,6 +4990,94 @@ void BlueStore::_shutdown_logger()
   delete logger;
 }
 
+int BlueStore::start_txc_capture(const string& path, ostream& ss)
+{
+  std::lock_guard l(capture_lock);
+  if (capture_fd >= 0) {
+    ss << "a capture is already running";
+    return -EBUSY;
+  }
+  capture_fd = ::open(path.c_str(), O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0644);
+  if (capture_fd < 0) {
+    int r = -errno;
+    ss << "cannot open " << path << ": " << cpp_strerror(r);
+    return r;
+  }
+  capture_records = 0;
+  capturing = true;
+  dout(1) << __func__ << " capturing transactions to " << path << dendl;
+  return 0;
+}
+
+int BlueStore::stop_txc_capture(ostream& ss)
+{
+  std::lock_guard l(capture_lock);
+  if (capture_fd < 0) {
+    ss << "no capture is running";
+    return -ENOENT;
+  }
+  capturing = false;
+  VOID_TEMP_FAILURE_RETRY(::close(capture_fd));
+  capture_fd = -1;
+  ss << "captured " << capture_records << " transaction batches";
+  dout(1) << __func__ << " captured " << capture_records
+	  << " transaction batches" << dendl;
+  return 0;
+}
+
+void BlueStore::_capture_transactions(
+  const coll_t& cid,
+  const vector<Transaction>& tls)
+{
+  bufferlist bl;
+  ceph::os::TransactionCapture::encode_batch(ceph_clock_now(), cid, tls, bl);
+  std::lock_guard l(capture_lock);
+  if (capture_fd < 0) {
+    return;
+  }
+  int r = bl.write_fd(capture_fd);
+  if (r < 0) {
+    derr << __func__ << " write failed: " << cpp_strerror(r)
+	 << ", stopping the capture" << dendl;
+    capturing = false;
+    VOID_TEMP_FAILURE_RETRY(::close(capture_fd));
+    capture_fd = -1;
+    return;
+  }
+  ++capture_records;
+}
+
+void BlueStore::dump_state_lat_histograms(Formatter *f, bool reset)
+{
+  f->open_object_section("state_latency_histograms");
+  f->open_array_section("states");
+  for (int s = l_bluestore_state_prepare_lat;
+       s <= l_bluestore_state_done_lat;
+       ++s) {
+    f->dump_string("state", TransContext::get_state_latency_name(s));
+  }
+  f->close_section();
+  f->open_array_section("sequencers");
+  {
+    std::shared_lock l(coll_lock);
+    for (auto& [cid, c] : coll_map) {
+      OpSequencer *osr = c->osr.get();
+      f->open_object_section("sequencer");
+      f->dump_stream("cid") << cid;
+      f->dump_unsigned("sequencer_id", osr->get_sequencer_id());
+      f->open_object_section("histogram");
+      osr->state_lat_hist.dump_formatted(f);
+      f->close_section();
+      f->close_section();
+      if (reset) {
+	osr->state_lat_hist.reset();
+      }
+    }
+  }
+  f->close_section();
+  f->close_section();
+}
+
 int BlueStore::get_block_device_fsid(CephContext* cct, const string& path,
 				     uuid_d *fsid)
 {
@@ -4824,11 +5221,17 @@ void BlueStore::_set_alloc_sizes(void)
 {
   max_alloc_size = cct->_conf->bluestore_max_alloc_size;
 
-  if (cct->_conf->bluestore_prefer_deferred_size) {
+  if (bdev->is_smr()) {
+    // deferred writes land in place, which zones don't allow
+    prefer_deferred_size = 0;
+  } else if (cct->_conf->bluestore_prefer_deferred_size) {
     prefer_deferred_size = cct->_conf->bluestore_prefer_deferred_size;
   } else {
     ceph_assert(bdev);
-    if (_use_rotational_settings()) {
+    if (bluefs && bluefs->wal_is_persistent_memory()) {
+      // deferred writes commit at the speed of the kv WAL
+      prefer_deferred_size = cct->_conf->bluestore_prefer_deferred_size_pmem;
+    } else if (_use_rotational_settings()) {
       prefer_deferred_size = cct->_conf->bluestore_prefer_deferred_size_hdd;
     } else {
       prefer_deferred_size = cct->_conf->bluestore_prefer_deferred_size_ssd;
@@ -5069,9 +5472,33 @@ int BlueStore::_open_alloc()
 	     << dendl;
   }
 
-  alloc = Allocator::create(cct, cct->_conf->bluestore_allocator,
-                            bdev->get_size(),
-                            min_alloc_size, "block");
+  if (bdev->is_smr()) {
+    int r = _zoned_check_layout();
+    if (r < 0) {
+      return r;
+    }
+    uint64_t zone_size = bdev->get_zone_size();
+    alloc = Allocator::create(cct, "zoned",
+			      bdev->get_size(),
+			      min_alloc_size, "block", zone_size,
+			      p2roundup(bdev->get_conventional_region_size(),
+					zone_size) / zone_size);
+    if (!alloc) {
+      return -EINVAL;
+    }
+    std::vector<uint64_t> written;
+    r = bdev->get_zone_write_pointers(&written);
+    if (r < 0) {
+      delete alloc;
+      alloc = nullptr;
+      return r;
+    }
+    static_cast<ZonedAllocator*>(alloc)->init_zones(written);
+  } else {
+    alloc = Allocator::create(cct, cct->_conf->bluestore_allocator,
+			      bdev->get_size(),
+			      min_alloc_size, "block");
+  }
   if (!alloc) {
     lderr(cct) << __func__ << " Allocator::unknown alloc type "
                << cct->_conf->bluestore_allocator
@@ -5082,15 +5509,18 @@ int BlueStore::_open_alloc()
   uint64_t num = 0, bytes = 0;
 
   dout(1) << __func__ << " opening allocation metadata" << dendl;
-  // initialize from freelist
-  fm->enumerate_reset();
-  uint64_t offset, length;
-  while (fm->enumerate_next(db, &offset, &length)) {
-    alloc->init_add_free(offset, length);
-    ++num;
-    bytes += length;
+  if (!cct->_conf->bluestore_allocator_snapshot ||
+      _load_alloc_snapshot(&num, &bytes) < 0) {
+    // initialize from freelist
+    fm->enumerate_reset();
+    uint64_t offset, length;
+    while (fm->enumerate_next(db, &offset, &length)) {
+      alloc->init_add_free(offset, length);
+      ++num;
+      bytes += length;
+    }
+    fm->enumerate_reset();
   }
-  fm->enumerate_reset();
 
   // also mark bluefs space as allocated
   for (auto e = bluefs_extents.begin(); e != bluefs_extents.end(); ++e) {
@@ -5105,6 +5535,125 @@ int BlueStore::_open_alloc()
   return 0;
 }
 
+/*
+ * The snapshot holds free space as the freelist sees it, i.e. including
+ * the space currently owned by bluefs, so it can replace the freelist
+ * walk one to one.  It is only valid until the freelist changes again,
+ * which is why every read/write open removes it (_remove_alloc_snapshot)
+ * and only a clean umount writes it.
+ */
+int BlueStore::_load_alloc_snapshot(uint64_t *num, uint64_t *bytes)
+{
+  bufferlist bl;
+  int r = db->get(PREFIX_SUPER, BLUESTORE_ALLOC_SNAPSHOT_KEY, &bl);
+  if (r < 0) {
+    dout(10) << __func__ << " no snapshot" << dendl;
+    return -ENOENT;
+  }
+
+  interval_set<uint64_t> free_extents;
+  try {
+    uint64_t size, alloc_size, expected_chunks, expected_bytes;
+    auto p = bl.cbegin();
+    decode(size, p);
+    decode(alloc_size, p);
+    decode(expected_chunks, p);
+    decode(expected_bytes, p);
+    if (size != bdev->get_size() || alloc_size != fm->get_alloc_size()) {
+      dout(1) << __func__ << " snapshot is for size 0x" << std::hex << size
+	      << " alloc size 0x" << alloc_size << std::dec
+	      << ", ignoring" << dendl;
+      return -EINVAL;
+    }
+
+    uint64_t chunks = 0;
+    auto it = db->get_iterator(PREFIX_ALLOC_SNAPSHOT,
+			       KeyValueDB::ITERATOR_NOCACHE);
+    for (it->lower_bound(string()); it->valid(); it->next()) {
+      interval_set<uint64_t> chunk;
+      bufferlist v = it->value();
+      auto q = v.cbegin();
+      decode(chunk, q);
+      free_extents.union_of(chunk);
+      ++chunks;
+    }
+    if (chunks != expected_chunks || free_extents.size() != expected_bytes) {
+      derr << __func__ << " snapshot is incomplete: " << chunks << "/"
+	   << expected_chunks << " chunks, 0x" << std::hex << free_extents.size()
+	   << "/0x" << expected_bytes << std::dec << " bytes, ignoring"
+	   << dendl;
+      return -EIO;
+    }
+  } catch (ceph::buffer::error& e) {
+    derr << __func__ << " failed to decode snapshot: " << e.what() << dendl;
+    return -EIO;
+  }
+
+  for (auto p = free_extents.begin(); p != free_extents.end(); ++p) {
+    alloc->init_add_free(p.get_start(), p.get_len());
+  }
+  *num = free_extents.num_intervals();
+  *bytes = free_extents.size();
+  dout(1) << __func__ << " loaded " << byte_u_t(*bytes)
+	  << " in " << *num << " extents from snapshot" << dendl;
+  return 0;
+}
+
+void BlueStore::_write_alloc_snapshot()
+{
+  ceph_assert(alloc);
+  // pending discards are free in the freelist already
+  bdev->discard_drain();
+
+  interval_set<uint64_t> free_extents;
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+    free_extents.insert(offset, length);
+  });
+  free_extents.union_of(bluefs_extents);
+  free_extents.union_of(bluefs_extents_reclaiming);
+
+  KeyValueDB::Transaction t = db->get_transaction();
+  t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+  uint64_t chunks = 0;
+  auto p = free_extents.begin();
+  while (p != free_extents.end()) {
+    interval_set<uint64_t> chunk;
+    for (unsigned i = 0;
+	 i < ALLOC_SNAPSHOT_CHUNK_EXTENTS && p != free_extents.end();
+	 ++i, ++p) {
+      chunk.insert(p.get_start(), p.get_len());
+    }
+    string key;
+    _key_encode_u64(chunks++, &key);
+    bufferlist bl;
+    encode(chunk, bl);
+    t->set(PREFIX_ALLOC_SNAPSHOT, key, bl);
+  }
+
+  bufferlist bl;
+  encode((uint64_t)bdev->get_size(), bl);
+  encode((uint64_t)fm->get_alloc_size(), bl);
+  encode(chunks, bl);
+  encode((uint64_t)free_extents.size(), bl);
+  t->set(PREFIX_SUPER, BLUESTORE_ALLOC_SNAPSHOT_KEY, bl);
+  db->submit_transaction_sync(t);
+  dout(1) << __func__ << " saved " << byte_u_t(free_extents.size())
+	  << " in " << free_extents.num_intervals() << " extents" << dendl;
+}
+
+void BlueStore::_remove_alloc_snapshot()
+{
+  bufferlist bl;
+  if (db->get(PREFIX_SUPER, BLUESTORE_ALLOC_SNAPSHOT_KEY, &bl) < 0) {
+    return;
+  }
+  dout(10) << __func__ << dendl;
+  KeyValueDB::Transaction t = db->get_transaction();
+  t->rmkey(PREFIX_SUPER, BLUESTORE_ALLOC_SNAPSHOT_KEY);
+  t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+  db->submit_transaction_sync(t);
+}
+
 void BlueStore::_close_alloc()
 {
   ceph_assert(bdev);
@@ -5230,6 +5779,30 @@ bool BlueStore::is_rotational()
   return rotational;
 }
 
+uint64_t BlueStore::get_cost_per_io()
+{
+  double per_io, per_byte;
+  {
+    std::lock_guard l(io_cost_lock);
+    if (!io_cost_model.get(&per_io, &per_byte)) {
+      // the throttle's guess until there is enough to go by
+      return throttle_cost_per_io;
+    }
+  }
+  return per_io / per_byte;
+}
+
+void BlueStore::_sample_io_cost(uint64_t ios, uint64_t bytes,
+				mono_clock::duration lat)
+{
+  // a sample now and then is plenty to follow the device
+  if (++io_cost_sample_seq % 16) {
+    return;
+  }
+  std::lock_guard l(io_cost_lock);
+  io_cost_model.add(ios, bytes, ceph::to_seconds<double>(lat) * 1000000.0);
+}
+
 bool BlueStore::is_journal_rotational()
 {
   if (!bluefs) {
@@ -5334,7 +5907,14 @@ int BlueStore::_minimal_open_bluefs(bool create)
 	  << cpp_strerror(r) << dendl;
     goto free_bluefs;
   }
-  if (create) {
+  if (bdev->is_smr() && !bluefs_layout.dedicated_db) {
+    derr << __func__ << " zoned main device requires a dedicated db device"
+	 << dendl;
+    r = -EINVAL;
+    goto free_bluefs;
+  }
+  // bluefs can't use sequential-write zones, it gets no space on them
+  if (create && !bdev->is_smr()) {
     // note: we always leave the first SUPER_RESERVED (8k) of the device unused
     uint64_t initial =
       bdev->get_size() * (cct->_conf->bluestore_bluefs_min_ratio +
@@ -5440,7 +6020,8 @@ int BlueStore::_open_bluefs(bool create)
         rocks_opts.max_bytes_for_level_multiplier,
         reserved_factor,
         cct->_conf->bluestore_volume_selection_reserved,
-        cct->_conf->bluestore_volume_selection_policy != "rocksdb_original");
+        cct->_conf->bluestore_volume_selection_policy != "rocksdb_original",
+        cct->_conf->bluestore_volume_selection_heat_threshold);
   }
   if (create) {
     bluefs->mkfs(fsid, bluefs_layout);
@@ -5530,6 +6111,7 @@ int BlueStore::_open_db_and_around(bool read_only)
 	return r;
       }
       fm->sync(db);
+      _remove_alloc_snapshot();
     }
   } else {
     r = _open_db(false, false);
@@ -5548,6 +6130,9 @@ int BlueStore::_open_db_and_around(bool read_only)
     r = _open_alloc();
     if (r < 0)
       goto out_fm;
+    if (!read_only) {
+      _remove_alloc_snapshot();
+    }
   }
   return 0;
 
@@ -5647,6 +6232,12 @@ int BlueStore::_open_db(bool create, bool to_repair_db, bool read_only)
   map<string,string> kv_options;
   // force separate wal dir for all new deployments.
   kv_options["separate_wal_dir"] = 1;
+  if (!create && !read_only && !to_repair_db &&
+      cct->_conf.get_val<bool>("bluestore_rocksdb_cf") &&
+      cct->_conf.get_val<bool>("bluestore_rocksdb_reshard_on_mount")) {
+    // move existing data to the column layout of bluestore_rocksdb_cfs
+    kv_options["reshard"] = "1";
+  }
   rocksdb::Env *env = NULL;
   if (do_bluefs) {
     dout(10) << __func__ << " initializing bluefs" << dendl;
@@ -5765,6 +6356,8 @@ int BlueStore::_open_db(bool create, bool to_repair_db, bool read_only)
   FreelistManager::setup_merge_operators(db);
   db->set_merge_operator(PREFIX_STAT, merge_op);
   db->set_cache_size(cache_kv_ratio * cache_size);
+  db->set_delete_range_threshold(
+    cct->_conf.get_val<uint64_t>("bluestore_rocksdb_delete_range_threshold"));
 
   if (kv_backend == "rocksdb") {
     options = cct->_conf->bluestore_rocksdb_options;
@@ -6005,6 +6598,10 @@ int BlueStore::_balance_bluefs_freespace()
     _clear_spillover_alert();
   }
 
+  if (bdev->is_smr()) {
+    return 0;
+  }
+
   // fixme: look at primary bdev only for now
   int64_t delta = _get_bluefs_size_delta(
     bluefs_usage[bluefs_layout.shared_bdev].first,
@@ -6378,6 +6975,22 @@ int BlueStore::mkfs()
     goto out_close_bdev;
   }
 
+  if (bdev->is_smr()) {
+    r = _zoned_check_layout();
+    if (r < 0)
+      goto out_close_bdev;
+    // start with empty zones, the new freelist says all is free
+    uint64_t zone_size = bdev->get_zone_size();
+    uint64_t first = p2roundup(bdev->get_conventional_region_size(),
+			       zone_size) / zone_size;
+    uint64_t num = p2roundup(bdev->get_size(), zone_size) / zone_size;
+    for (uint64_t z = first; z < num && r >= 0; ++z) {
+      r = bdev->reset_zone(z);
+    }
+    if (r < 0)
+      goto out_close_bdev;
+  }
+
   r = _open_db(true);
   if (r < 0)
     goto out_close_bdev;
@@ -6984,6 +7597,22 @@ int BlueStore::_mount(bool kv_only, bool open_db)
 
   mempool_thread.init();
 
+  if (bluefs && cct->_conf->bluestore_volume_selection_heat_threshold) {
+    bluefs->start_hot_file_migration();
+  }
+
+  if (cct->_conf->bluestore_defrag_interval > 0) {
+    defrag_thread.init();
+  }
+
+  if (bdev->is_smr()) {
+    zoned_cleaner_thread.init();
+  }
+
+  if (cct->_conf->bluestore_onode_prefetch) {
+    prefetch_thread.init();
+  }
+
   if ((!per_pool_stat_collection || !per_pool_omap) &&
     cct->_conf->bluestore_fsck_quick_fix_on_mount == true) {
 
@@ -7026,6 +7655,11 @@ int BlueStore::umount()
   ceph_assert(_kv_only || mounted);
   dout(1) << __func__ << dendl;
 
+  if (!_kv_only) {
+    defrag_thread.shutdown();
+    zoned_cleaner_thread.shutdown();
+    prefetch_thread.shutdown();
+  }
   _osr_drain_all();
 
   mounted = false;
@@ -7034,6 +7668,9 @@ int BlueStore::umount()
     dout(20) << __func__ << " stopping kv thread" << dendl;
     _kv_stop();
     _flush_cache();
+    if (cct->_conf->bluestore_allocator_snapshot) {
+      _write_alloc_snapshot();
+    }
     dout(20) << __func__ << " closing" << dendl;
 
   }
@@ -7719,6 +8356,87 @@ public:
   };
 };
 
+class DeepFSCKWorkQueue
+  : public ThreadPool::WorkQueueVal<std::pair<BlueStore::CollectionRef,
+					      BlueStore::OnodeRef>> {
+  typedef std::pair<BlueStore::CollectionRef, BlueStore::OnodeRef> Item;
+
+  BlueStore* store;
+  size_t max_queued;
+  std::deque<Item> items;  ///< protected by the thread pool lock
+  std::atomic<int64_t> errors = {0};
+
+  ceph::mutex throttle_lock = ceph::make_mutex("DeepFSCKWorkQueue::throttle");
+  ceph::condition_variable throttle_cond;
+  size_t in_flight = 0;    ///< protected by throttle_lock
+
+  void _enqueue(Item i) override {
+    items.push_back(std::move(i));
+  }
+  void _enqueue_front(Item i) override {
+    items.push_front(std::move(i));
+  }
+  bool _empty() override {
+    return items.empty();
+  }
+  Item _dequeue() override {
+    Item i = std::move(items.front());
+    items.pop_front();
+    return i;
+  }
+  void _process(Item i, ThreadPool::TPHandle&) override {
+    errors += store->fsck_read_object_data(i.first, i.second);
+  }
+  void _process_finish(Item) override {
+    std::lock_guard l(throttle_lock);
+    --in_flight;
+    throttle_cond.notify_all();
+  }
+
+public:
+  DeepFSCKWorkQueue(std::string n, size_t _max_queued,
+                    BlueStore* _store, ThreadPool* tp)
+    : WorkQueueVal(std::move(n), time_t(), time_t(), tp),
+      store(_store),
+      max_queued(_max_queued) {
+  }
+
+  /// queue an object for verification, blocking while too many are pending
+  void queue(BlueStore::CollectionRef c, BlueStore::OnodeRef o) {
+    {
+      std::unique_lock l(throttle_lock);
+      throttle_cond.wait(l, [this] { return in_flight < max_queued; });
+      ++in_flight;
+    }
+    WorkQueueVal::queue(Item(std::move(c), std::move(o)));
+  }
+  int64_t get_errors() const {
+    return errors;
+  }
+};
+
+int64_t BlueStore::fsck_read_object_data(CollectionRef c, OnodeRef o)
+{
+  bufferlist bl;
+  uint64_t max_read_block = cct->_conf->bluestore_fsck_read_bytes_cap;
+  uint64_t offset = 0;
+  do {
+    uint64_t l = std::min(uint64_t(o->onode.size - offset), max_read_block);
+    int r = _do_read(c.get(), o, offset, l, bl,
+      CEPH_OSD_OP_FLAG_FADVISE_NOCACHE);
+    if (r < 0) {
+      derr << "fsck error: " << o->oid << std::hex
+        << " error during read: "
+        << " " << offset << "~" << l
+        << " " << cpp_strerror(r) << std::dec
+        << dendl;
+      return 1;
+    }
+    offset += l;
+  } while (offset < o->onode.size);
+  return 0;
+}
+
 void BlueStore::_fsck_check_object_omap(FSCKDepth depth,
   OnodeRef& o,
   const BlueStore::FSCK_ObjectCtx& ctx)
@@ -7836,6 +8554,21 @@ void BlueStore::_fsck_check_objects(FSCKDepth depth,
       thread_pool.start();
     }
 
+    // data verification is the bulk of a deep fsck and only reads, so it
+    // goes to a separate pool while metadata checks stay in this thread
+    const size_t deep_thread_count = cct->_conf->bluestore_fsck_deep_threads;
+    std::unique_ptr<ThreadPool> deep_thread_pool;
+    std::unique_ptr<DeepFSCKWorkQueue> deep_wq;
+    if (depth == FSCK_DEEP && deep_thread_count > 0) {
+      deep_thread_pool.reset(new ThreadPool(cct, "DeepFSCKThreadPool",
+                                            "DeepFSCK", deep_thread_count));
+      deep_wq.reset(new DeepFSCKWorkQueue("DeepFSCKWorkQueue",
+                                          deep_thread_count * 4,
+                                          this,
+                                          deep_thread_pool.get()));
+      deep_thread_pool->start();
+    }
+
     //fill global if not overriden below
     CollectionRef c;
     int64_t pool_id = -1;
@@ -8022,27 +8755,19 @@ void BlueStore::_fsck_check_objects(FSCKDepth depth,
           }
         } // if (o->onode.has_omap())
         if (depth == FSCK_DEEP) {
-          bufferlist bl;
-          uint64_t max_read_block = cct->_conf->bluestore_fsck_read_bytes_cap;
-          uint64_t offset = 0;
-          do {
-            uint64_t l = std::min(uint64_t(o->onode.size - offset), max_read_block);
-            int r = _do_read(c.get(), o, offset, l, bl,
-              CEPH_OSD_OP_FLAG_FADVISE_NOCACHE);
-            if (r < 0) {
-              ++errors;
-              derr << "fsck error: " << oid << std::hex
-                << " error during read: "
-                << " " << offset << "~" << l
-                << " " << cpp_strerror(r) << std::dec
-                << dendl;
-              break;
-            }
-            offset += l;
-          } while (offset < o->onode.size);
+          if (deep_wq) {
+            deep_wq->queue(c, o);
+          } else {
+            errors += fsck_read_object_data(c, o);
+          }
         } // deep
       } //if (depth != FSCK_SHALLOW)
     } // for (it->lower_bound(string()); it->valid(); it->next())
+    if (deep_wq) {
+      deep_wq->drain();
+      deep_thread_pool->stop();
+      errors += deep_wq->get_errors();
+    }
     if (depth == FSCK_SHALLOW && thread_count > 0) {
       wq->finalize(thread_pool, ctx);
       if (processed_myself) {
@@ -9366,6 +10091,51 @@ void BlueStore::set_collection_commit_queue(
 }
 
 
+void BlueStore::prefetch(CollectionHandle &c_,
+			 const std::vector<ghobject_t>& oids)
+{
+  CollectionRef c = static_cast<Collection*>(c_.get());
+  dout(20) << __func__ << " " << c->cid << " " << oids.size() << " objects"
+	   << dendl;
+  if (!c->exists || oids.empty() || !prefetch_thread.is_started()) {
+    return;
+  }
+  std::lock_guard l(prefetch_thread.lock);
+  if (prefetch_thread.queued + oids.size() > prefetch_thread.max_queued) {
+    dout(20) << __func__ << " queue full, dropped" << dendl;
+    return;
+  }
+  prefetch_thread.queued += oids.size();
+  prefetch_thread.queue.emplace_back(c, oids);
+  prefetch_thread.cond.notify_one();
+}
+
+void BlueStore::_prefetch_thread()
+{
+  // objects loaded per hold of the collection lock
+  static constexpr size_t batch = 16;
+  std::unique_lock l(prefetch_thread.lock);
+  dout(10) << __func__ << " start" << dendl;
+  while (!prefetch_thread.stop) {
+    if (prefetch_thread.queue.empty()) {
+      prefetch_thread.cond.wait(l);
+      continue;
+    }
+    auto [c, oids] = std::move(prefetch_thread.queue.front());
+    prefetch_thread.queue.pop_front();
+    prefetch_thread.queued -= oids.size();
+    l.unlock();
+    for (size_t i = 0; i < oids.size() && c->exists; i += batch) {
+      std::vector<ghobject_t> part(
+	oids.begin() + i, oids.begin() + std::min(i + batch, oids.size()));
+      std::shared_lock cl(c->lock);
+      c->prefetch_onodes(part);
+    }
+    l.lock();
+  }
+  dout(10) << __func__ << " finish" << dendl;
+}
+
 bool BlueStore::exists(CollectionHandle &c_, const ghobject_t& oid)
 {
   Collection *c = static_cast<Collection *>(c_.get());
@@ -9703,11 +10473,29 @@ int BlueStore::_generate_read_result_bl(
           *csum_error = true;
           return -EIO;
         }
+        _seed_read_crc(&bptr->get_blob(), req.r_off, req.bl);
         if (buffered) {
           bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(),
                                          req.r_off, req.bl);
         }
 
+        // the common aligned read: one device read covering exactly what
+        // was asked for.  hand the aio buffers over as they are.
+        if (ready_regions.empty() &&
+            blobs2read.size() == 1 &&
+            r2r.size() == 1 &&
+            req.regs.size() == 1 &&
+            req.regs.front().logical_offset == offset &&
+            req.regs.front().length == length &&
+            req.regs.front().front == 0 &&
+            req.bl.length() == length) {
+          dout(30) << __func__ << " single region 0x" << std::hex << offset
+                   << "~" << length << std::dec << ", using read buffers"
+                   << dendl;
+          bl.claim_append(req.bl);
+          return 0;
+        }
+
         // prune and keep result
         for (const auto& r : req.regs) {
           ready_regions[r.logical_offset].substr_of(req.bl, r.front, r.length);
@@ -9814,6 +10602,7 @@ int BlueStore::_do_read(
                              // The error isn't that much...
   vector<bufferlist> compressed_blob_bls;
   IOContext ioc(cct, NULL, true); // allow EIO
+  ioc.io_class = _read_io_class(op_flags);
   r = _prepare_read_ioc(blobs2read, &compressed_blob_bls, &ioc);
   // we always issue aio for reading, so errors other than EIO are not allowed
   if (r < 0)
@@ -9822,6 +10611,8 @@ int BlueStore::_do_read(
   int64_t num_ios = length;
   if (ioc.has_pending_aios()) {
     num_ios = -ioc.get_num_ios();
+    uint64_t io_bytes = ioc.get_num_bytes();
+    auto submitted = mono_clock::now();
     bdev->aio_submit(&ioc);
     dout(20) << __func__ << " waiting for aio" << dendl;
     ioc.aio_wait();
@@ -9830,6 +10621,7 @@ int BlueStore::_do_read(
       ceph_assert(r == -EIO); // no other errors allowed
       return -EIO;
     }
+    _sample_io_cost(-num_ios, io_bytes, mono_clock::now() - submitted);
   }
   log_latency_fn(__func__,
     l_bluestore_read_wait_aio_lat,
@@ -9917,6 +10709,38 @@ int BlueStore::_verify_csum(OnodeRef& o,
   return r;
 }
 
+void BlueStore::_seed_read_crc(
+  const bluestore_blob_t* blob,
+  uint64_t blob_xoffset,
+  const bufferlist& bl) const
+{
+  // what was ignored or only spot-checked must still be hashed
+  if (blob->csum_type != Checksummer::CSUM_CRC32C ||
+      cct->_conf->bluestore_ignore_data_csum ||
+      cct->_conf->bluestore_debug_inject_csum_err_probability > 0 ||
+      !cct->_conf.get_val<bool>("bluestore_csum_seed_crc_cache")) {
+    return;
+  }
+  const uint32_t chunk = blob->get_csum_chunk_size();
+  const ceph_le32 *csum =
+    reinterpret_cast<const ceph_le32*>(blob->csum_data.c_str());
+  uint64_t pos = blob_xoffset;
+  for (auto& p : bl.buffers()) {
+    if (pos % chunk == 0 && p.length() && p.length() % chunk == 0) {
+      // crc32c(-1, a . b) from crc32c(-1, a) and crc32c(-1, b): the
+      // seed of b changes from -1 to crc32c(-1, a)
+      unsigned i = pos / chunk;
+      unsigned end = i + p.length() / chunk;
+      uint32_t crc = csum[i++];
+      for (; i < end; ++i) {
+	crc = csum[i] ^ ceph_crc32c(crc ^ 0xffffffff, nullptr, chunk);
+      }
+      p.set_crc32c(0xffffffff, crc);
+    }
+    pos += p.length();
+  }
+}
+
 int BlueStore::_decompress(bufferlist& source, bufferlist* result)
 {
   int r = 0;
@@ -10160,6 +10984,7 @@ int BlueStore::_do_readv(
   _dump_onode<30>(cct, *o);
 
   IOContext ioc(cct, NULL, true); // allow EIO
+  ioc.io_class = _read_io_class(op_flags);
   vector<std::tuple<ready_regions_t, vector<bufferlist>, blobs2read_t>> raw_results;
   raw_results.reserve(m.num_intervals());
   int i = 0;
@@ -10709,15 +11534,19 @@ int BlueStore::omap_get_values(
     const string& prefix = o->get_omap_prefix();
     o->get_omap_key(string(), &final_key);
     size_t base_key_len = final_key.size();
-    for (set<string>::const_iterator p = keys.begin(); p != keys.end(); ++p) {
+    // one batched lookup for all keys
+    set<string> final_keys;
+    for (auto& k : keys) {
       final_key.resize(base_key_len); // keep prefix
-      final_key += *p;
-      bufferlist val;
-      if (db->get(prefix, final_key, &val) >= 0) {
-	dout(30) << __func__ << "  got " << pretty_binary_string(final_key)
-		 << " -> " << *p << dendl;
-	out->insert(make_pair(*p, val));
-      }
+      final_key += k;
+      final_keys.insert(final_keys.end(), final_key);
+    }
+    map<string, bufferlist> vals;
+    db->get(prefix, final_keys, &vals);
+    for (auto& [k, val] : vals) {
+      dout(30) << __func__ << "  got " << pretty_binary_string(k)
+	       << " -> " << k.substr(base_key_len) << dendl;
+      out->emplace(k.substr(base_key_len), std::move(val));
     }
   }
  out:
@@ -10795,18 +11624,18 @@ int BlueStore::omap_check_keys(
     const string& prefix = o->get_omap_prefix();
     o->get_omap_key(string(), &final_key);
     size_t base_key_len = final_key.size();
-    for (set<string>::const_iterator p = keys.begin(); p != keys.end(); ++p) {
+    set<string> final_keys;
+    for (auto& k : keys) {
       final_key.resize(base_key_len); // keep prefix
-      final_key += *p;
-      bufferlist val;
-      if (db->get(prefix, final_key, &val) >= 0) {
-	dout(30) << __func__ << "  have " << pretty_binary_string(final_key)
-		 << " -> " << *p << dendl;
-	out->insert(*p);
-      } else {
-	dout(30) << __func__ << "  miss " << pretty_binary_string(final_key)
-		 << " -> " << *p << dendl;
-      }
+      final_key += k;
+      final_keys.insert(final_keys.end(), final_key);
+    }
+    map<string, bufferlist> vals;
+    db->get(prefix, final_keys, &vals);
+    for (auto& p : vals) {
+      dout(30) << __func__ << "  have " << pretty_binary_string(p.first)
+	       << dendl;
+      out->insert(p.first.substr(base_key_len));
     }
   }
  out:
@@ -10840,6 +11669,25 @@ ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
 // -----------------
 // write helpers
 
+int BlueStore::_zoned_check_layout()
+{
+  uint64_t zone_size = bdev->get_zone_size();
+  if (!zone_size || zone_size % min_alloc_size) {
+    derr << __func__ << " zone size 0x" << std::hex << zone_size
+	 << " is not a multiple of min_alloc_size 0x" << min_alloc_size
+	 << std::dec << dendl;
+    return -EINVAL;
+  }
+  // label and superblock are rewritten in place
+  if (bdev->get_conventional_region_size() < _get_ondisk_reserved()) {
+    derr << __func__ << " zoned device needs 0x" << std::hex
+	 << _get_ondisk_reserved() << std::dec
+	 << " of conventional zones at its start" << dendl;
+    return -EINVAL;
+  }
+  return 0;
+}
+
 uint64_t BlueStore::_get_ondisk_reserved() const {
   return round_up_to(
     std::max<uint64_t>(SUPER_RESERVED, min_alloc_size), min_alloc_size);
@@ -11139,12 +11987,19 @@ void BlueStore::_txc_state_proc(TransContext *txc)
     switch (txc->state) {
     case TransContext::STATE_PREPARE:
       throttle.log_state_latency(*txc, logger, l_bluestore_state_prepare_lat);
+      if (txc->zoned_slot >= 0) {
+	_txc_zoned_fill(txc);
+      }
       if (txc->ioc.has_pending_aios()) {
 	txc->state = TransContext::STATE_AIO_WAIT;
 	txc->had_ios = true;
 	_txc_aio_submit(txc);
 	return;
       }
+      if (txc->zoned_slot >= 0) {
+	static_cast<ZonedAllocator*>(alloc)->put_slot(txc->zoned_slot);
+	txc->zoned_slot = -1;
+      }
       // ** fall-thru **
 
     case TransContext::STATE_AIO_WAIT:
@@ -11156,6 +12011,9 @@ void BlueStore::_txc_state_proc(TransContext *txc)
 		  << ", latency = " << lat
 		  << dendl;
 	}
+	if (txc->had_ios) {
+	  _sample_io_cost(txc->ios, txc->bytes, lat);
+	}
       }
 
       _txc_finish_io(txc);  // may trigger blocked txc's too
@@ -11717,6 +12575,15 @@ void BlueStore::_kv_start()
   dout(10) << __func__ << dendl;
 
   finisher.start();
+  ceph_assert(kv_submit_shards.empty());
+  unsigned num_shards = cct->_conf.get_val<uint64_t>("bluestore_kv_sync_shards");
+  if (num_shards > 1) {
+    dout(10) << __func__ << " " << num_shards << " kv submit shards" << dendl;
+    for (unsigned i = 0; i < num_shards; ++i) {
+      kv_submit_shards.emplace_back(new KVSubmitShard(this));
+      kv_submit_shards.back()->create("bstore_kv_sub");
+    }
+  }
   kv_sync_thread.create("bstore_kv_sync");
   kv_finalize_thread.create("bstore_kv_final");
 }
@@ -11742,6 +12609,16 @@ void BlueStore::_kv_stop()
   }
   kv_sync_thread.join();
   kv_finalize_thread.join();
+  // kv_sync_thread waits for the shards every cycle, so they are idle now
+  for (auto& shard : kv_submit_shards) {
+    {
+      std::lock_guard l(shard->lock);
+      shard->stop = true;
+      shard->cond.notify_all();
+    }
+    shard->join();
+  }
+  kv_submit_shards.clear();
   ceph_assert(removed_collections.empty());
   {
     std::lock_guard l(kv_lock);
@@ -11844,38 +12721,55 @@ void BlueStore::_kv_sync_thread()
       // increase {nid,blobid}_max?  note that this covers both the
       // case where we are approaching the max and the case we passed
       // it.  in either case, we increase the max in the earlier txn
-      // we submit.
+      // we submit.  with sharded submission there is no single earliest
+      // txn, so the new max values get a txn of their own that is
+      // submitted before any shard starts.
       uint64_t new_nid_max = 0, new_blobid_max = 0;
+      KeyValueDB::Transaction maxt =
+	!kv_submit_shards.empty() ? db->get_transaction() :
+	kv_submitting.empty() ? synct : kv_submitting.front()->t;
       if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
-	KeyValueDB::Transaction t =
-	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
 	new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
 	bufferlist bl;
 	encode(new_nid_max, bl);
-	t->set(PREFIX_SUPER, "nid_max", bl);
+	maxt->set(PREFIX_SUPER, "nid_max", bl);
 	dout(10) << __func__ << " new_nid_max " << new_nid_max << dendl;
       }
       if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
-	KeyValueDB::Transaction t =
-	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
 	new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
 	bufferlist bl;
 	encode(new_blobid_max, bl);
-	t->set(PREFIX_SUPER, "blobid_max", bl);
+	maxt->set(PREFIX_SUPER, "blobid_max", bl);
 	dout(10) << __func__ << " new_blobid_max " << new_blobid_max << dendl;
       }
 
-      for (auto txc : kv_committing) {
-	throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_queued_lat);
-	if (txc->state == TransContext::STATE_KV_QUEUED) {
-	  _txc_apply_kv(txc, false);
-	  --txc->osr->kv_committing_serially;
-	} else {
-	  ceph_assert(txc->state == TransContext::STATE_KV_SUBMITTED);
+      if (kv_submit_shards.empty()) {
+	for (auto txc : kv_committing) {
+	  throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_queued_lat);
+	  if (txc->state == TransContext::STATE_KV_QUEUED) {
+	    _txc_apply_kv(txc, false);
+	    --txc->osr->kv_committing_serially;
+	  } else {
+	    ceph_assert(txc->state == TransContext::STATE_KV_SUBMITTED);
+	  }
+	  if (txc->had_ios) {
+	    --txc->osr->txc_with_unstable_io;
+	  }
 	}
-	if (txc->had_ios) {
-	  --txc->osr->txc_with_unstable_io;
+      } else {
+	if (new_nid_max || new_blobid_max) {
+	  int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 : db->submit_transaction(maxt);
+	  ceph_assert(r == 0);
 	}
+	for (auto txc : kv_committing) {
+	  throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_queued_lat);
+	  // ordering within the sequencer is still guarded by
+	  // kv_committing_serially, which the shard drops after applying.
+	  if (txc->had_ios) {
+	    --txc->osr->txc_with_unstable_io;
+	  }
+	}
+	_kv_submit_sharded(kv_committing);
       }
 
       // release throttle *before* we commit.  this allows new ops
@@ -12023,6 +12917,77 @@ clear:
   kv_sync_started = false;
 }
 
+void BlueStore::_kv_submit_sharded(const deque<TransContext*>& txcs)
+{
+  // hash by sequencer so that each osr's txcs are applied in order by a
+  // single shard; different sequencers proceed in parallel and rocksdb
+  // groups their writes into the WAL.
+  size_t num_shards = kv_submit_shards.size();
+  std::vector<deque<TransContext*>> per_shard(num_shards);
+  size_t n = 0;
+  for (auto txc : txcs) {
+    if (txc->state == TransContext::STATE_KV_QUEUED) {
+      per_shard[txc->osr->get_sequencer_id() % num_shards].push_back(txc);
+      ++n;
+    } else {
+      ceph_assert(txc->state == TransContext::STATE_KV_SUBMITTED);
+    }
+  }
+  if (n == 0) {
+    return;
+  }
+  dout(20) << __func__ << " " << n << " txcs across " << num_shards
+	   << " shards" << dendl;
+  {
+    std::lock_guard l(kv_submit_lock);
+    ceph_assert(kv_submit_pending == 0);
+    kv_submit_pending = n;
+  }
+  for (size_t i = 0; i < num_shards; ++i) {
+    if (per_shard[i].empty()) {
+      continue;
+    }
+    KVSubmitShard *shard = kv_submit_shards[i].get();
+    std::lock_guard l(shard->lock);
+    shard->q.insert(shard->q.end(), per_shard[i].begin(), per_shard[i].end());
+    shard->cond.notify_one();
+  }
+  std::unique_lock l(kv_submit_lock);
+  kv_submit_cond.wait(l, [this] { return kv_submit_pending == 0; });
+}
+
+void BlueStore::_kv_submit_shard_thread(KVSubmitShard *shard)
+{
+  dout(10) << __func__ << " start" << dendl;
+  deque<TransContext*> submitting;
+  std::unique_lock l(shard->lock);
+  while (true) {
+    if (shard->q.empty()) {
+      if (shard->stop)
+	break;
+      shard->cond.wait(l);
+      continue;
+    }
+    submitting.swap(shard->q);
+    l.unlock();
+    for (auto txc : submitting) {
+      _txc_apply_kv(txc, false);
+      --txc->osr->kv_committing_serially;
+    }
+    {
+      std::lock_guard m(kv_submit_lock);
+      ceph_assert(kv_submit_pending >= submitting.size());
+      kv_submit_pending -= submitting.size();
+      if (kv_submit_pending == 0) {
+	kv_submit_cond.notify_all();
+      }
+    }
+    submitting.clear();
+    l.lock();
+  }
+  dout(10) << __func__ << " finish" << dendl;
+}
+
 void BlueStore::_kv_finalize_thread()
 {
   deque<TransContext*> kv_committed;
@@ -12140,31 +13105,50 @@ void BlueStore::deferred_try_submit()
 {
   dout(20) << __func__ << " " << deferred_queue.size() << " osrs, "
 	   << deferred_queue_size << " txcs" << dendl;
-  std::lock_guard l(deferred_lock);
   vector<OpSequencerRef> osrs;
-  osrs.reserve(deferred_queue.size());
-  for (auto& osr : deferred_queue) {
-    osrs.push_back(&osr);
-  }
-  for (auto& osr : osrs) {
-    if (osr->deferred_pending) {
-      if (!osr->deferred_running) {
-	_deferred_submit_unlock(osr.get());
-	deferred_lock.lock();
+  vector<DeferredBatch*> batches;
+  {
+    std::lock_guard l(deferred_lock);
+    osrs.reserve(deferred_queue.size());
+    batches.reserve(deferred_queue.size());
+    for (auto& osr : deferred_queue) {
+      if (osr.deferred_pending) {
+	if (!osr.deferred_running) {
+	  osrs.push_back(&osr);
+	  batches.push_back(_deferred_start(&osr));
+	} else {
+	  dout(20) << __func__ << "  osr " << &osr << " already has running"
+		   << dendl;
+	}
       } else {
-	dout(20) << __func__ << "  osr " << osr << " already has running"
-		 << dendl;
+	dout(20) << __func__ << "  osr " << &osr << " has no pending" << dendl;
       }
-    } else {
-      dout(20) << __func__ << "  osr " << osr << " has no pending" << dendl;
     }
   }
 
+  // each sequencer's batch is already sorted and merged by offset; order
+  // the batches themselves by offset too and submit them back to back so
+  // that the device sees one elevator sweep instead of a seek per
+  // sequencer, and can merge adjacent ios from different sequencers.
+  if (cct->_conf->bluestore_deferred_submit_sorted && batches.size() > 1) {
+    std::sort(batches.begin(), batches.end(),
+	      [](const DeferredBatch *a, const DeferredBatch *b) {
+		return a->get_first_offset() < b->get_first_offset();
+	      });
+  }
+  for (auto b : batches) {
+    _deferred_prepare_writes(b);
+  }
+  for (auto b : batches) {
+    bdev->aio_submit(&b->ioc);
+  }
+
   deferred_last_submitted = ceph_clock_now();
 }
 
-void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
+BlueStore::DeferredBatch *BlueStore::_deferred_start(OpSequencer *osr)
 {
+  ceph_assert(ceph_mutex_is_locked(deferred_lock));
   dout(10) << __func__ << " osr " << osr
 	   << " " << osr->deferred_pending->iomap.size() << " ios pending "
 	   << dendl;
@@ -12177,9 +13161,11 @@ void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
 
   osr->deferred_running = osr->deferred_pending;
   osr->deferred_pending = nullptr;
+  return b;
+}
 
-  deferred_lock.unlock();
-
+void BlueStore::_deferred_prepare_writes(DeferredBatch *b)
+{
   for (auto& txc : b->txcs) {
     throttle.log_state_latency(txc, logger, l_bluestore_state_deferred_queued_lat);
   }
@@ -12216,7 +13202,14 @@ void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
     bl.claim_append(i->second.bl);
     ++i;
   }
+}
 
+void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
+{
+  auto b = _deferred_start(osr);
+  deferred_lock.unlock();
+
+  _deferred_prepare_writes(b);
   bdev->aio_submit(&b->ioc);
 }
 
@@ -12329,6 +13322,351 @@ int BlueStore::_deferred_replay()
 // ---------------------------
 // transactions
 
+// ---------------
+// defrag
+
+uint64_t BlueStore::_defrag_count_extents(OnodeRef& o)
+{
+  std::set<Blob*> seen;
+  std::vector<std::pair<uint64_t, uint64_t>> runs;
+  for (auto& e : o->extent_map.extent_map) {
+    if (!seen.insert(e.blob.get()).second) {
+      continue;
+    }
+    for (auto& p : e.blob->get_blob().get_extents()) {
+      if (p.is_valid()) {
+	runs.emplace_back(p.offset, p.length);
+      }
+    }
+  }
+  std::sort(runs.begin(), runs.end());
+  uint64_t count = 0;
+  uint64_t end = 0;
+  for (auto& [offset, length] : runs) {
+    if (!count || offset != end) {
+      ++count;
+    }
+    end = offset + length;
+  }
+  return count;
+}
+
+bool BlueStore::_defrag_wanted(OnodeRef& o, uint64_t *extents)
+{
+  auto min_extents = cct->_conf.get_val<uint64_t>("bluestore_defrag_min_extents");
+  o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
+  uint64_t data_bytes = 0;
+  for (auto& e : o->extent_map.extent_map) {
+    // rewriting would undo the sharing with clones
+    if (e.blob->get_blob().is_shared()) {
+      return false;
+    }
+    data_bytes += e.length;
+  }
+  *extents = _defrag_count_extents(o);
+  uint64_t needed = std::max<uint64_t>(
+    1, p2roundup<uint64_t>(data_bytes, max_blob_size) / max_blob_size);
+  return min_extents && *extents >= min_extents && *extents > needed * 2;
+}
+
+int BlueStore::_defrag_onode(CollectionRef& c, const ghobject_t& oid,
+			     uint64_t *bytes, uint64_t *extents_removed)
+{
+  uint64_t before = 0;
+  return _rewrite_onode(
+    c, oid,
+    [&](OnodeRef& o, interval_set<uint64_t> *ranges) {
+      if (!_defrag_wanted(o, &before)) {
+	return;
+      }
+      dout(10) << __func__ << " " << c->cid << " " << oid
+	       << " " << before << " extents" << dendl;
+      // rewrite the ranges holding data, holes stay holes
+      for (auto& e : o->extent_map.extent_map) {
+	ranges->union_insert(e.logical_offset, e.length);
+      }
+    },
+    [&](OnodeRef& o) {
+      auto after = _defrag_count_extents(o);
+      *extents_removed = before > after ? before - after : 0;
+      dout(10) << __func__ << " " << c->cid << " " << oid
+	       << " now " << after << " extents" << dendl;
+    },
+    bytes);
+}
+
+int BlueStore::_rewrite_onode(
+  CollectionRef& c, const ghobject_t& oid,
+  std::function<void(OnodeRef&, interval_set<uint64_t>*)> pick,
+  std::function<void(OnodeRef&)> rewritten,
+  uint64_t *bytes)
+{
+  list<Context*> on_commit;
+  C_SaferCond done;
+  on_commit.push_back(&done);
+  TransContext *txc = _txc_create(c.get(), c->osr.get(), &on_commit);
+  int r = 0;
+  {
+    std::unique_lock l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    interval_set<uint64_t> ranges;
+    if (!o || !o->exists) {
+      r = -ENOENT;
+    } else if (o->flushing_count.load() ||
+	       c->osr->has_preparing_other(txc)) {
+      // Clients don't serialize with us through the PG lock: a txc still
+      // being prepared may be adding ops to or encoding this onode.  Any
+      // newer one waits for c->lock before touching it.
+      r = -EAGAIN;
+    } else {
+      pick(o, &ranges);
+    }
+    if (r >= 0 && !ranges.empty() && bdev->is_smr()) {
+      // clients wait for their slot under c->lock, never do it here
+      auto zalloc = static_cast<ZonedAllocator*>(alloc);
+      unsigned slot = c->cid.hash_to_shard(zalloc->get_num_slots());
+      if (zalloc->try_get_slot(slot)) {
+	txc->zoned_slot = slot;
+      } else {
+	r = -EAGAIN;
+      }
+    }
+    for (auto p = ranges.begin(); p != ranges.end() && r >= 0; ++p) {
+      bufferlist bl;
+      r = _do_read(c.get(), o, p.get_start(), p.get_len(), bl,
+		   CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL |
+		   CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
+      if (r >= 0) {
+	r = _write(txc, c, o, p.get_start(), p.get_len(), bl, 0);
+	*bytes += p.get_len();
+      }
+    }
+    if (r >= 0 && !ranges.empty() && rewritten) {
+      rewritten(o);
+    }
+    // an empty txc completes right away, failed reads leave nothing behind
+    // as _write is never called after one.  the onode is encoded before
+    // dropping c->lock so a client txc cannot change it meanwhile.
+    _txc_prepare_kv(txc);
+  }
+  _txc_throttle_start(txc);
+  logger->inc(l_bluestore_txc);
+  _txc_state_proc(txc);
+  done.wait();
+  return r < 0 ? r : 0;
+}
+
+void BlueStore::_defrag_thread()
+{
+  // objects checked per wakeup
+  static constexpr int batch = 64;
+  // collection after the given one in cid order, wrapping around
+  auto pick_next = [this](const CollectionRef& cur) {
+    std::shared_lock l(coll_lock);
+    CollectionRef first, after;
+    for (auto& p : coll_map) {
+      if (!first || p.first < first->cid) {
+	first = p.second;
+      }
+      if (cur && cur->cid < p.first && (!after || p.first < after->cid)) {
+	after = p.second;
+      }
+    }
+    return after ? after : first;
+  };
+  CollectionRef c;
+  ghobject_t next;
+  std::unique_lock l(defrag_thread.lock);
+  dout(10) << __func__ << " start" << dendl;
+  while (!defrag_thread.stop) {
+    double interval = cct->_conf->bluestore_defrag_interval;
+    defrag_thread.cond.wait_for(
+      l, ceph::make_timespan(interval > 0 ? interval : 1.0));
+    if (defrag_thread.stop || interval <= 0) {
+      continue;
+    }
+    l.unlock();
+    if (!c || !c->exists || next.is_max()) {
+      c = pick_next(c);
+      next = ghobject_t();
+    }
+    vector<ghobject_t> ls;
+    ghobject_t pnext = ghobject_t::get_max();
+    if (c) {
+      std::shared_lock cl(c->lock);
+      int r = _collection_list(c.get(), next, ghobject_t::get_max(), batch,
+			       &ls, &pnext);
+      if (r < 0) {
+	ls.clear();
+	pnext = ghobject_t::get_max();
+      }
+    }
+    next = pnext;
+    for (auto& oid : ls) {
+      bool wanted = false;
+      {
+	std::shared_lock cl(c->lock);
+	OnodeRef o = c->get_onode(oid, false);
+	uint64_t extents = 0;
+	wanted = o && o->exists && _defrag_wanted(o, &extents);
+      }
+      logger->inc(l_bluestore_defrag_scanned);
+      if (!wanted) {
+	continue;
+      }
+      uint64_t bytes = 0, removed = 0;
+      int r = _defrag_onode(c, oid, &bytes, &removed);
+      dout(20) << __func__ << " " << c->cid << " " << oid << " = " << r
+	       << " rewrote 0x" << std::hex << bytes << std::dec << dendl;
+      if (bytes) {
+	logger->inc(l_bluestore_defrag_onodes);
+	logger->inc(l_bluestore_defrag_bytes, bytes);
+	logger->inc(l_bluestore_defrag_extents_removed, removed);
+      }
+      uint64_t rate = cct->_conf.get_val<Option::size_t>(
+	"bluestore_defrag_max_bytes_per_sec");
+      std::unique_lock tl(defrag_thread.lock);
+      if (bytes && rate && !defrag_thread.stop) {
+	defrag_thread.cond.wait_for(
+	  tl, ceph::make_timespan((double)bytes / rate));
+      }
+      if (defrag_thread.stop) {
+	break;
+      }
+    }
+    l.lock();
+  }
+  dout(10) << __func__ << " finish" << dendl;
+}
+
+bool BlueStore::_zoned_clean()
+{
+  // objects listed per collection_list call
+  static constexpr int batch = 64;
+  auto zalloc = static_cast<ZonedAllocator*>(alloc);
+  double free_ratio = cct->_conf.get_val<double>(
+    "bluestore_zoned_cleaner_free_ratio");
+  if (zalloc->get_free() >= bdev->get_size() * free_ratio) {
+    return false;
+  }
+  uint64_t zone;
+  if (!zalloc->start_cleaning(
+	cct->_conf.get_val<double>("bluestore_zoned_cleaner_min_dead_ratio"),
+	&zone)) {
+    return false;
+  }
+  uint64_t zone_size = zalloc->get_zone_size();
+  uint64_t zstart = zone * zone_size;
+  uint64_t zend = zstart + zone_size;
+  dout(10) << __func__ << " zone " << zone << dendl;
+
+  // there is no reverse map, walk everything for data in the zone
+  vector<CollectionRef> colls;
+  {
+    std::shared_lock l(coll_lock);
+    for (auto& p : coll_map) {
+      colls.push_back(p.second);
+    }
+  }
+  bool stop = false;
+  for (auto& c : colls) {
+    ghobject_t next;
+    while (!stop && c->exists && !next.is_max()) {
+      vector<ghobject_t> ls;
+      {
+	std::shared_lock cl(c->lock);
+	int r = _collection_list(c.get(), next, ghobject_t::get_max(), batch,
+				 &ls, &next);
+	if (r < 0) {
+	  break;
+	}
+      }
+      for (auto& oid : ls) {
+	uint64_t bytes = 0;
+	int r = _rewrite_onode(
+	  c, oid,
+	  [&](OnodeRef& o, interval_set<uint64_t> *ranges) {
+	    o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
+	    for (auto& e : o->extent_map.extent_map) {
+	      for (auto& p : e.blob->get_blob().get_extents()) {
+		if (p.is_valid() && p.offset < zend && p.end() > zstart) {
+		  // rewriting a shared blob unshares it, the clones
+		  // holding it are moved when the walk reaches them
+		  ranges->union_insert(e.logical_offset, e.length);
+		  break;
+		}
+	      }
+	    }
+	  },
+	  nullptr,
+	  &bytes);
+	dout(20) << __func__ << " " << c->cid << " " << oid << " = " << r
+		 << " moved 0x" << std::hex << bytes << std::dec << dendl;
+	logger->inc(l_bluestore_zoned_cleaned_bytes, bytes);
+	uint64_t rate = cct->_conf.get_val<Option::size_t>(
+	  "bluestore_zoned_cleaner_max_bytes_per_sec");
+	std::unique_lock tl(zoned_cleaner_thread.lock);
+	if (bytes && rate && !zoned_cleaner_thread.stop) {
+	  zoned_cleaner_thread.cond.wait_for(
+	    tl, ceph::make_timespan((double)bytes / rate));
+	}
+	if (zoned_cleaner_thread.stop) {
+	  stop = true;
+	  break;
+	}
+      }
+    }
+  }
+
+  // old extents are released as the rewrites finish up, give them a moment
+  for (int i = 0; i < 10 && !stop && !zalloc->is_zone_dead(zone); ++i) {
+    std::unique_lock tl(zoned_cleaner_thread.lock);
+    zoned_cleaner_thread.cond.wait_for(tl, ceph::make_timespan(0.1));
+    stop = zoned_cleaner_thread.stop;
+  }
+  if (!zalloc->is_zone_dead(zone)) {
+    dout(10) << __func__ << " zone " << zone << " still has live data"
+	     << dendl;
+    zalloc->stop_cleaning(zone);
+    return false;
+  }
+  int r = bdev->reset_zone(zone);
+  if (r < 0) {
+    derr << __func__ << " failed to reset zone " << zone << ": "
+	 << cpp_strerror(r) << dendl;
+    zalloc->stop_cleaning(zone);
+    return false;
+  }
+  zalloc->reset_zone(zone);
+  logger->inc(l_bluestore_zoned_zones_reset);
+  return true;
+}
+
+void BlueStore::_zoned_cleaner_thread()
+{
+  std::unique_lock l(zoned_cleaner_thread.lock);
+  dout(10) << __func__ << " start" << dendl;
+  while (!zoned_cleaner_thread.stop) {
+    double interval = cct->_conf.get_val<double>(
+      "bluestore_zoned_cleaner_interval");
+    zoned_cleaner_thread.cond.wait_for(
+      l, ceph::make_timespan(interval > 0 ? interval : 1.0));
+    if (zoned_cleaner_thread.stop || interval <= 0) {
+      continue;
+    }
+    l.unlock();
+    // keep going while there is work, the interval is for idle checks
+    while (_zoned_clean()) {
+      std::lock_guard tl(zoned_cleaner_thread.lock);
+      if (zoned_cleaner_thread.stop) {
+	break;
+      }
+    }
+    l.lock();
+  }
+  dout(10) << __func__ << " finish" << dendl;
+}
+
 int BlueStore::queue_transactions(
   CollectionHandle& ch,
   vector<Transaction>& tls,
@@ -12346,6 +13684,10 @@ int BlueStore::queue_transactions(
   OpSequencer *osr = c->osr.get();
   dout(10) << __func__ << " ch " << c << " " << c->cid << dendl;
 
+  if (capturing) {
+    _capture_transactions(c->cid, tls);
+  }
+
   // prepare
   TransContext *txc = _txc_create(static_cast<Collection*>(ch.get()), osr,
 				  &on_commit);
@@ -12354,6 +13696,47 @@ int BlueStore::queue_transactions(
     txc->bytes += (*p).get_num_bytes();
     _txc_add_transaction(txc, &(*p));
   }
+  _txc_prepare_kv(txc);
+  if (handle)
+    handle->suspend_tp_timeout();
+
+  auto tstart = mono_clock::now();
+  _txc_throttle_start(txc);
+  auto tend = mono_clock::now();
+
+  if (handle)
+    handle->reset_tp_timeout();
+
+  logger->inc(l_bluestore_txc);
+
+  // execute (start)
+  _txc_state_proc(txc);
+
+  // we're immediately readable (unlike FileStore)
+  for (auto c : on_applied_sync) {
+    c->complete(0);
+  }
+  if (!on_applied.empty()) {
+    if (c->commit_queue) {
+      c->commit_queue->queue(on_applied);
+    } else {
+      finisher.queue(on_applied);
+    }
+  }
+
+  log_latency("submit_transact",
+    l_bluestore_submit_lat,
+    mono_clock::now() - start,
+    cct->_conf->bluestore_log_op_age);
+  log_latency("throttle_transact",
+    l_bluestore_throttle_lat,
+    tend - tstart,
+    cct->_conf->bluestore_log_op_age);
+  return 0;
+}
+
+void BlueStore::_txc_prepare_kv(TransContext *txc)
+{
   _txc_calc_cost(txc);
 
   _txc_write_nodes(txc, txc->t);
@@ -12369,11 +13752,11 @@ int BlueStore::queue_transactions(
   }
 
   _txc_finalize_kv(txc, txc->t);
-  if (handle)
-    handle->suspend_tp_timeout();
+}
 
+void BlueStore::_txc_throttle_start(TransContext *txc)
+{
   auto tstart = mono_clock::now();
-
   if (!throttle.try_start_transaction(
 	*db,
 	*txc,
@@ -12394,43 +13777,43 @@ int BlueStore::queue_transactions(
     throttle.finish_start_transaction(*db, *txc, tstart);
     --deferred_aggressive;
   }
-  auto tend = mono_clock::now();
-
-  if (handle)
-    handle->reset_tp_timeout();
-
-  logger->inc(l_bluestore_txc);
-
-  // execute (start)
-  _txc_state_proc(txc);
-
-  // we're immediately readable (unlike FileStore)
-  for (auto c : on_applied_sync) {
-    c->complete(0);
-  }
-  if (!on_applied.empty()) {
-    if (c->commit_queue) {
-      c->commit_queue->queue(on_applied);
-    } else {
-      finisher.queue(on_applied);
-    }
-  }
-
-  log_latency("submit_transact",
-    l_bluestore_submit_lat,
-    mono_clock::now() - start,
-    cct->_conf->bluestore_log_op_age);
-  log_latency("throttle_transact",
-    l_bluestore_throttle_lat,
-    tend - tstart,
-    cct->_conf->bluestore_log_op_age);
-  return 0;
 }
 
 void BlueStore::_txc_aio_submit(TransContext *txc)
 {
   dout(10) << __func__ << " txc " << txc << dendl;
+  int zoned_slot = txc->zoned_slot;
   bdev->aio_submit(&txc->ioc);
+  // txc may be gone by now
+  if (zoned_slot >= 0) {
+    static_cast<ZonedAllocator*>(alloc)->put_slot(zoned_slot);
+  }
+}
+
+void BlueStore::_txc_zoned_fill(TransContext *txc)
+{
+  interval_set<uint64_t> unwritten;
+  static_cast<ZonedAllocator*>(alloc)->get_unsubmitted(txc->zoned_slot,
+						       &unwritten);
+  interval_set<uint64_t> written, overlap;
+  for (auto& aio : txc->ioc.pending_aios) {
+    written.union_insert(aio.offset, aio.length);
+  }
+  overlap.intersection_of(unwritten, written);
+  unwritten.subtract(overlap);
+  // released or unused allocations, a failed write...
+  for (auto p = unwritten.begin(); p != unwritten.end(); ++p) {
+    dout(20) << __func__ << " txc " << txc << " zero 0x" << std::hex
+	     << p.get_start() << "~" << p.get_len() << std::dec << dendl;
+    bufferlist bl;
+    bl.append_zero(p.get_len());
+    bdev->aio_write(p.get_start(), bl, &txc->ioc, false);
+    logger->inc(l_bluestore_write_pad_bytes, p.get_len());
+  }
+  // the writes of a zone are dispatched in the order they are submitted
+  txc->ioc.pending_aios.sort([](const aio_t& a, const aio_t& b) {
+    return a.offset < b.offset;
+  });
 }
 
 void BlueStore::_txc_add_transaction(TransContext *txc, Transaction *t)
@@ -12985,7 +14368,8 @@ void BlueStore::_do_write_small(
 	uint64_t b_len = length + head_pad + tail_pad;
 
 	// direct write into unused blocks of an existing mutable blob?
-	if ((b_off % chunk_size == 0 && b_len % chunk_size == 0) &&
+	if (!bdev->is_smr() &&
+	    (b_off % chunk_size == 0 && b_len % chunk_size == 0) &&
 	    b->get_blob().get_ondisk_length() >= b_off + b_len &&
 	    b->get_blob().is_unused(b_off, b_len) &&
 	    b->get_blob().is_allocated(b_off, b_len)) {
@@ -13046,7 +14430,8 @@ void BlueStore::_do_write_small(
 	}
 
 	// chunk-aligned deferred overwrite?
-	if (b->get_blob().get_ondisk_length() >= b_off + b_len &&
+	if (!bdev->is_smr() &&
+	    b->get_blob().get_ondisk_length() >= b_off + b_len &&
 	    b_off % chunk_size == 0 &&
 	    b_len % chunk_size == 0 &&
 	    b->get_blob().is_allocated(b_off, b_len)) {
@@ -13543,6 +14928,68 @@ void BlueStore::_do_write_big(
   }
 }
 
+/*
+ * Compress the blobs of a write that are worth it. When there are several,
+ * all but one are handed to the compression threads and the one left is
+ * compressed here, so the latencies of the blobs do not add up.
+ */
+void BlueStore::_compress_blobs(
+  CompressorRef& c,
+  WriteContext *wctx)
+{
+  auto compress_one = [&c](WriteContext::write_item& wi) {
+    auto start = mono_clock::now();
+    ceph_assert(wi.b_off == 0);
+    ceph_assert(wi.blob_length == wi.bl.length());
+    // FIXME: memory alignment here is bad
+    wi.compress_r = c->compress(wi.bl, wi.compress_out);
+    wi.compress_lat = mono_clock::now() - start;
+  };
+
+  std::vector<WriteContext::write_item*> todo;
+  for (auto& wi : wctx->writes) {
+    if (wi.blob_length > min_alloc_size) {
+      todo.push_back(&wi);
+    }
+  }
+  if (todo.empty()) {
+    return;
+  }
+  unsigned threads =
+    cct->_conf.get_val<uint64_t>("bluestore_compression_threads");
+#ifdef HAVE_QATZIP
+  // the QAT sessions are not shared between threads
+  if (c->qat_enabled) {
+    threads = 0;
+  }
+#endif
+  if (todo.size() == 1 || threads == 0) {
+    for (auto wi : todo) {
+      compress_one(*wi);
+    }
+    return;
+  }
+  std::call_once(compress_pool_once, [this, threads] {
+    compress_pool = std::make_unique<boost::asio::thread_pool>(threads);
+  });
+
+  ceph::mutex lock = ceph::make_mutex("BlueStore::_compress_blobs");
+  ceph::condition_variable cond;
+  size_t pending = todo.size() - 1;
+  for (size_t i = 1; i < todo.size(); ++i) {
+    boost::asio::post(*compress_pool, [&, wi = todo[i]] {
+      compress_one(*wi);
+      std::lock_guard l{lock};
+      if (--pending == 0) {
+	cond.notify_one();
+      }
+    });
+  }
+  compress_one(*todo[0]);
+  std::unique_lock l{lock};
+  cond.wait(l, [&pending] { return pending == 0; });
+}
+
 int BlueStore::_do_alloc_write(
   TransContext *txc,
   CollectionRef coll,
@@ -13608,6 +15055,10 @@ int BlueStore::_do_alloc_write(
     }
   );
 
+  if (c) {
+    _compress_blobs(c, wctx);
+  }
+
   // compress (as needed) and calc needed space
   uint64_t need = 0;
   auto max_bsize = std::max(wctx->target_blob_size, min_alloc_size);
@@ -13615,13 +15066,8 @@ int BlueStore::_do_alloc_write(
     if (c && wi.blob_length > min_alloc_size) {
       auto start = mono_clock::now();
 
-      // compress
-      ceph_assert(wi.b_off == 0);
-      ceph_assert(wi.blob_length == wi.bl.length());
-
-      // FIXME: memory alignment here is bad
-      bufferlist t;
-      int r = c->compress(wi.bl, t);
+      bufferlist& t = wi.compress_out;
+      int r = wi.compress_r;
       uint64_t want_len_raw = wi.blob_length * crr;
       uint64_t want_len = p2roundup(want_len_raw, min_alloc_size);
       bool rejected = false;
@@ -13683,7 +15129,7 @@ int BlueStore::_do_alloc_write(
       }
       log_latency("compress@_do_alloc_write",
 	l_bluestore_compress_lat,
-        mono_clock::now() - start,
+        wi.compress_lat + (mono_clock::now() - start),
 	cct->_conf->bluestore_log_op_age );
     } else {
       need += wi.blob_length;
@@ -13692,9 +15138,21 @@ int BlueStore::_do_alloc_write(
   PExtentVector prealloc;
   prealloc.reserve(2 * wctx->writes.size());;
   int64_t prealloc_left = 0;
-  prealloc_left = alloc->allocate(
-    need, min_alloc_size, need,
-    0, &prealloc);
+  if (bdev->is_smr()) {
+    auto zalloc = static_cast<ZonedAllocator*>(alloc);
+    if (txc->zoned_slot < 0) {
+      // the writes of the txc are submitted in one go, hold the slot until
+      // then so nobody allocates after us and writes before us
+      txc->zoned_slot = txc->ch->cid.hash_to_shard(zalloc->get_num_slots());
+      zalloc->get_slot(txc->zoned_slot);
+    }
+    prealloc_left = zalloc->allocate_in(
+      txc->zoned_slot, need, min_alloc_size, need, &prealloc);
+  } else {
+    prealloc_left = alloc->allocate(
+      need, min_alloc_size, need,
+      0, &prealloc);
+  }
   if (prealloc_left < 0 || prealloc_left < (int64_t)need) {
     derr << __func__ << " failed to allocate 0x" << std::hex << need
          << " allocated 0x " << (prealloc_left < 0 ? 0 : prealloc_left)
@@ -13827,6 +15285,24 @@ int BlueStore::_do_alloc_write(
         ceph_assert(r == 0);
 	op->data = *l;
 	logger->inc(l_bluestore_write_deferred);
+      } else if (bdev->is_smr()) {
+	// zones are written at their write pointer only, so cover the
+	// whole allocation rather than leave a gap for later
+	uint64_t a_off = p2align(b_off, min_alloc_size);
+	uint64_t a_end = a_off + final_length;
+	bufferlist padded;
+	padded.append_zero(b_off - a_off);
+	padded.append(*l);
+	if (a_end > b_off + l->length()) {
+	  padded.append_zero(a_end - b_off - l->length());
+	}
+	logger->inc(l_bluestore_write_pad_bytes, padded.length() - l->length());
+	b->get_blob().map_bl(
+	  a_off, padded,
+	  [&](uint64_t offset, bufferlist& t) {
+	    bdev->aio_write(offset, t, &txc->ioc, false);
+	  });
+	logger->inc(l_bluestore_write_new);
       } else {
 	b->get_blob().map_bl(
 	  b_off, *l,
@@ -13996,17 +15472,34 @@ void BlueStore::_choose_write_options(
      (cm == Compressor::COMP_PASSIVE &&
       (alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_COMPRESSIBLE)));
 
-  if ((alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_SEQUENTIAL_READ) &&
-      (alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_RANDOM_READ) == 0 &&
-      (alloc_hints & (CEPH_OSD_ALLOC_HINT_FLAG_IMMUTABLE |
-                      CEPH_OSD_ALLOC_HINT_FLAG_APPEND_ONLY)) &&
-      (alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_RANDOM_WRITE) == 0) {
-
+  bool large_writes =
+    (alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_SEQUENTIAL_READ) &&
+    (alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_RANDOM_READ) == 0 &&
+    (alloc_hints & (CEPH_OSD_ALLOC_HINT_FLAG_IMMUTABLE |
+		    CEPH_OSD_ALLOC_HINT_FLAG_APPEND_ONLY)) &&
+    (alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_RANDOM_WRITE) == 0;
+
+  // without hints, fall back to what the collection has been doing lately
+  uint64_t observed_write_size = 0;
+  if (!large_writes &&
+      cct->_conf->bluestore_adaptive_write_sizing &&
+      (alloc_hints & CEPH_OSD_ALLOC_HINT_FLAG_RANDOM_WRITE) == 0 &&
+      c->avg_write_size >= max_blob_size.load()) {
+    observed_write_size = 1ull << (cbits(c->avg_write_size) - 1);
+    dout(20) << __func__ << " collection average write size 0x" << std::hex
+	     << c->avg_write_size << std::dec << dendl;
+    large_writes = true;
+  }
+
+  if (large_writes) {
     dout(20) << __func__ << " will prefer large blob and csum sizes" << dendl;
 
     if (o->onode.expected_write_size) {
       wctx->csum_order = std::max(min_alloc_size_order,
 			          (uint8_t)ctz(o->onode.expected_write_size));
+    } else if (observed_write_size) {
+      wctx->csum_order = std::max(min_alloc_size_order,
+				  (uint8_t)ctz(observed_write_size));
     } else {
       wctx->csum_order = min_alloc_size_order;
     }
@@ -14145,6 +15638,7 @@ int BlueStore::_do_write(
   }
 
   uint64_t end = offset + length;
+  c->note_write_size(length);
 
   GarbageCollector gc(c->store->cct);
   int64_t benefit = 0;
@@ -15294,6 +16788,13 @@ mono_clock::duration BlueStore::BlueStoreThrottle::log_state_latency(
   mono_clock::time_point now = mono_clock::now();
   mono_clock::duration lat = now - txc.last_stamp;
   logger->tinc(state, lat);
+  if (state >= l_bluestore_state_prepare_lat &&
+      state <= l_bluestore_state_done_lat) {
+    int64_t lat_ns = std::chrono::nanoseconds(lat).count();
+    logger->hinc(l_bluestore_state_lat_histogram, lat_ns,
+		 state - l_bluestore_state_prepare_lat);
+    txc.osr->state_lat_hist.inc(lat_ns, state - l_bluestore_state_prepare_lat);
+  }
 #if defined(WITH_LTTNG)
   if (txc.tracing &&
       state >= l_bluestore_state_prepare_lat &&
@@ -15947,6 +17448,24 @@ unsigned BlueStoreRepairer::apply(KeyValueDB* db)
 // =======================================================
 // RocksDBBlueFSVolumeSelector
 
+uint64_t RocksDBBlueFSVolumeSelector::_get_db_avail4slow()
+{
+  // considering statically available db space vs.
+  // - observed maximums on DB dev for DB/WAL/UNSORTED data
+  // - observed maximum spillovers
+  uint64_t max_db_use = 0; // max db usage we potentially observed
+  max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_LOG - LEVEL_FIRST);
+  max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_WAL - LEVEL_FIRST);
+  max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_DB - LEVEL_FIRST);
+  // this could go to db hence using it in the estimation
+  max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_SLOW, LEVEL_DB - LEVEL_FIRST);
+
+  auto db_total = l_totals[LEVEL_DB - LEVEL_FIRST];
+  return min(
+    db_avail4slow,
+    max_db_use < db_total ? db_total - max_db_use : 0);
+}
+
 uint8_t RocksDBBlueFSVolumeSelector::select_prefer_bdev(void* h) {
   ceph_assert(h != nullptr);
   uint64_t hint = reinterpret_cast<uint64_t>(h);
@@ -15955,20 +17474,7 @@ uint8_t RocksDBBlueFSVolumeSelector::select_prefer_bdev(void* h) {
   case LEVEL_SLOW:
     res = BlueFS::BDEV_SLOW;
     if (db_avail4slow > 0) {
-      // considering statically available db space vs.
-      // - observed maximums on DB dev for DB/WAL/UNSORTED data
-      // - observed maximum spillovers
-      uint64_t max_db_use = 0; // max db usage we potentially observed
-      max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_LOG - LEVEL_FIRST);
-      max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_WAL - LEVEL_FIRST);
-      max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_DB - LEVEL_FIRST);
-      // this could go to db hence using it in the estimation
-      max_db_use += per_level_per_dev_max.at(BlueFS::BDEV_SLOW, LEVEL_DB - LEVEL_FIRST);
-
-      auto db_total = l_totals[LEVEL_DB - LEVEL_FIRST];
-      uint64_t avail = min(
-        db_avail4slow,
-        max_db_use < db_total ? db_total - max_db_use : 0);
+      uint64_t avail = _get_db_avail4slow();
 
       // considering current DB dev usage for SLOW data
       if (avail > per_level_per_dev_usage.at(BlueFS::BDEV_DB, LEVEL_SLOW - LEVEL_FIRST)) {
@@ -15988,6 +17494,35 @@ uint8_t RocksDBBlueFSVolumeSelector::select_prefer_bdev(void* h) {
   return res;
 }
 
+bool RocksDBBlueFSVolumeSelector::should_promote(
+  void* h,
+  const bluefs_fnode_t& fnode,
+  uint64_t heat)
+{
+  if (h == nullptr || heat_threshold == 0 || heat < heat_threshold) {
+    return false;
+  }
+  uint64_t need = 0;
+  for (auto& p : fnode.extents) {
+    if (p.bdev != BlueFS::BDEV_DB) {
+      need += p.length;
+    }
+  }
+  uint64_t hint = reinterpret_cast<uint64_t>(h);
+  if (hint == LEVEL_SLOW) {
+    // stay within the extra space 'use some extra' policy may take
+    return db_avail4slow > 0 &&
+      _get_db_avail4slow() >=
+        per_level_per_dev_usage.at(BlueFS::BDEV_DB, LEVEL_SLOW - LEVEL_FIRST) + need;
+  }
+  // spilled over DB data, keep room for the log and WAL seen so far
+  uint64_t used =
+    per_level_per_dev_usage.at(BlueFS::BDEV_DB, LEVEL_MAX - LEVEL_FIRST);
+  used += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_LOG - LEVEL_FIRST);
+  used += per_level_per_dev_max.at(BlueFS::BDEV_DB, LEVEL_WAL - LEVEL_FIRST);
+  return used + need <= l_totals[LEVEL_DB - LEVEL_FIRST];
+}
+
 void RocksDBBlueFSVolumeSelector::get_paths(const std::string& base, paths& res) const
 {
   res.emplace_back(base, l_totals[LEVEL_DB - LEVEL_FIRST]);
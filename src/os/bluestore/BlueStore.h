@@ -51,11 +51,14 @@
 #include "bluestore_types.h"
 #include "BlockDevice.h"
 #include "BlueFS.h"
+#include "CacheArena.h"
+#include "IOCostModel.h"
 #include "common/EventTrace.h"
 
 class Allocator;
 class FreelistManager;
 class BlueStoreRepairer;
+namespace boost::asio { class thread_pool; }
 
 //#define DEBUG_CACHE
 //#define DEBUG_DEFERRED
@@ -83,6 +86,7 @@ enum {
   l_bluestore_state_deferred_cleanup_lat,
   l_bluestore_state_finishing_lat,
   l_bluestore_state_done_lat,
+  l_bluestore_state_lat_histogram,
   l_bluestore_throttle_lat,
   l_bluestore_submit_lat,
   l_bluestore_commit_lat,
@@ -109,6 +113,8 @@ enum {
   l_bluestore_onode_misses,
   l_bluestore_onode_shard_hits,
   l_bluestore_onode_shard_misses,
+  l_bluestore_onode_shard_unloads,
+  l_bluestore_onode_prefetched,
   l_bluestore_extents,
   l_bluestore_blobs,
   l_bluestore_buffers,
@@ -138,6 +144,12 @@ enum {
   l_bluestore_omap_lower_bound_lat,
   l_bluestore_omap_next_lat,
   l_bluestore_clist_lat,
+  l_bluestore_defrag_scanned,
+  l_bluestore_defrag_onodes,
+  l_bluestore_defrag_bytes,
+  l_bluestore_defrag_extents_removed,
+  l_bluestore_zoned_cleaned_bytes,
+  l_bluestore_zoned_zones_reset,
   l_bluestore_last
 };
 
@@ -170,6 +182,10 @@ public:
 
   typedef std::map<uint64_t, ceph::buffer::list> ready_regions_t;
 
+  /// axes of the per-state txc latency histograms (latency x state)
+  static const PerfHistogramCommon::axis_config_d state_lat_hist_x_axis_config;
+  static const PerfHistogramCommon::axis_config_d state_lat_hist_y_axis_config;
+
 
   struct BufferSpace;
   struct Collection;
@@ -314,6 +330,7 @@ public:
           writing.insert(it, *b);
         }
       } else {
+	cache->_copy_to_arena(b);
 	b->data.reassign_to_mempool(mempool::mempool_bluestore_cache_data);
 	cache->_add(b, level, near);
       }
@@ -860,6 +877,11 @@ public:
     /// initialize Shards from the onode
     void init_shards(bool loaded, bool dirty);
 
+    /// drop all decoded shards, returning the map to the state it has
+    /// right after Onode::decode().  only possible if the map is sharded
+    /// and every shard is clean.  @return true if anything was dropped
+    bool unload_shards();
+
     /// return index of shard containing offset
     /// or -1 if not found
     int seek_shard(uint32_t offset) {
@@ -1232,6 +1254,8 @@ public:
     std::atomic<uint64_t> num_extents = {0};
     std::atomic<uint64_t> num_blobs = {0};
     uint64_t buffer_bytes = 0;
+    /// where the data of the clean buffers goes, if not on the heap
+    std::shared_ptr<CacheArena> arena;
 
   public:
     BufferCacheShard(CephContext* cct) : CacheShard(cct) {}
@@ -1247,6 +1271,17 @@ public:
       return buffer_bytes;
     }
 
+    /// move the data of a buffer that turns clean into the arena, unless it
+    /// is cached already; false if it stays where it is
+    bool _copy_to_arena(Buffer *b) {
+      if (!arena ||
+	  (b->data.get_num_buffers() == 1 &&
+	   b->data.get_mempool() == mempool::mempool_bluestore_cache_data)) {
+	return false;
+      }
+      return arena->copy_in(b->data);
+    }
+
     void add_extent() {
       ++num_extents;
     }
@@ -1276,6 +1311,12 @@ public:
     OnodeCacheShard *cache;
 
   private:
+    /// protect onode_map.  lookups only take this (shared), so cache hits
+    /// do not contend on the cache shard lock; anything modifying the map
+    /// takes cache->lock first, then this exclusively.
+    ceph::shared_mutex lock =
+      ceph::make_shared_mutex("BlueStore::OnodeSpace::lock");
+
     /// forward lookups
     mempool::bluestore_cache_other::unordered_map<ghobject_t,OnodeRef> onode_map;
 
@@ -1290,12 +1331,22 @@ public:
     OnodeRef add(const ghobject_t& oid, OnodeRef o);
     OnodeRef lookup(const ghobject_t& o);
     void remove(const ghobject_t& oid) {
+      std::unique_lock l(lock);
       onode_map.erase(oid);
     }
+    /// remove oid on behalf of cache trim, unless someone other than the
+    /// map and the caller (i.e. a racing lookup) holds a reference.
+    /// caller holds cache->lock.
+    bool remove_unreferenced(const ghobject_t& oid);
+    /// unload o's extent map shards on behalf of cache trim, if nobody but
+    /// the map references it.  caller holds cache->lock.
+    bool unload_unreferenced(Onode *o);
     void rename(OnodeRef& o, const ghobject_t& old_oid,
 		const ghobject_t& new_oid,
 		const mempool::bluestore_cache_other::string& new_okey);
     void clear();
+    /// cached, without counting a hit or touching the lru
+    bool contains(const ghobject_t& oid);
     bool empty();
 
     template <int LogLevelV>
@@ -1328,7 +1379,20 @@ public:
     pool_opts_t pool_opts;
     ContextQueue *commit_queue;
 
+    /// moving average of recent write sizes; updated under exclusive lock
+    uint64_t avg_write_size = 0;
+
+    void note_write_size(uint64_t len) {
+      if (avg_write_size) {
+	avg_write_size = avg_write_size - (avg_write_size >> 3) + (len >> 3);
+      } else {
+	avg_write_size = len;
+      }
+    }
+
     OnodeRef get_onode(const ghobject_t& oid, bool create, bool is_createop=false);
+    /// load the onodes (and extent shards) of objects not cached yet
+    void prefetch_onodes(const std::vector<ghobject_t>& oids);
 
     // the terminology is confusing here, sorry!
     //
@@ -1528,8 +1592,7 @@ public:
       return "???";
     }
 
-#if defined(WITH_LTTNG)
-    const char *get_state_latency_name(int state) {
+    static const char *get_state_latency_name(int state) {
       switch (state) {
       case l_bluestore_state_prepare_lat: return "prepare";
       case l_bluestore_state_aio_wait_lat: return "aio_wait";
@@ -1538,13 +1601,13 @@ public:
       case l_bluestore_state_kv_committing_lat: return "kv_committing";
       case l_bluestore_state_kv_done_lat: return "kv_done";
       case l_bluestore_state_deferred_queued_lat: return "deferred_queued";
+      case l_bluestore_state_deferred_aio_wait_lat: return "deferred_aio_wait";
       case l_bluestore_state_deferred_cleanup_lat: return "deferred_cleanup";
       case l_bluestore_state_finishing_lat: return "finishing";
       case l_bluestore_state_done_lat: return "done";
       }
       return "???";
     }
-#endif
 
     CollectionRef ch;
     OpSequencerRef osr;  // this should be ch->osr
@@ -1570,6 +1633,7 @@ public:
 
     IOContext ioc;
     bool had_ios = false;  ///< true if we submitted IOs before our kv txn
+    int zoned_slot = -1;   ///< ZonedAllocator slot held until aio submit
 
     uint64_t seq = 0;
     ceph::mono_clock::time_point start;
@@ -1753,7 +1817,14 @@ public:
     void _audit(CephContext *cct);
 
     DeferredBatch(CephContext *cct, OpSequencer *osr)
-      : osr(osr), ioc(cct, this) {}
+      : osr(osr), ioc(cct, this) {
+      ioc.io_class = BLK_IO_DEFERRED;
+    }
+
+    /// lowest device offset written by this batch
+    uint64_t get_first_offset() const {
+      return iomap.empty() ? 0 : iomap.begin()->first;
+    }
 
     /// prepare a write
     void prepare_write(CephContext *cct,
@@ -1797,6 +1868,9 @@ public:
 
     const uint32_t sequencer_id;
 
+    /// txc state latencies seen by this sequencer, see log_state_latency
+    PerfHistogram<> state_lat_hist;
+
     uint32_t get_sequencer_id() const {
       return sequencer_id;
     }
@@ -1813,6 +1887,17 @@ public:
 	qcond.wait(l);
     }
 
+    /// is a txc other than @txc still having ops added or being encoded?
+    bool has_preparing_other(TransContext *txc) {
+      std::lock_guard l(qlock);
+      for (auto& p : q) {
+	if (&p != txc && p.state == TransContext::STATE_PREPARE) {
+	  return true;
+	}
+      }
+      return false;
+    }
+
     void drain_preceding(TransContext *txc) {
       std::unique_lock l(qlock);
       while (&q.front() != txc)
@@ -1885,7 +1970,9 @@ public:
     FRIEND_MAKE_REF(OpSequencer);
     OpSequencer(BlueStore *store, uint32_t sequencer_id, const coll_t& c)
       : RefCountedObject(store->cct),
-	store(store), cid(c), sequencer_id(sequencer_id) {
+	store(store), cid(c), sequencer_id(sequencer_id),
+	state_lat_hist{state_lat_hist_x_axis_config,
+		       state_lat_hist_y_axis_config} {
     }
     ~OpSequencer() {
       ceph_assert(q.empty());
@@ -1915,6 +2002,21 @@ public:
       return NULL;
     }
   };
+  /// applies kv transactions for the sequencers hashed onto it; the
+  /// kv_sync_thread hands out work and waits for all shards before the
+  /// final sync transaction of each commit cycle.
+  struct KVSubmitShard : public Thread {
+    BlueStore *store;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::KVSubmitShard::lock");
+    ceph::condition_variable cond;
+    std::deque<TransContext*> q;  ///< KV_QUEUED txcs, in sequencer order
+    bool stop = false;
+    explicit KVSubmitShard(BlueStore *s) : store(s) {}
+    void *entry() override {
+      store->_kv_submit_shard_thread(this);
+      return NULL;
+    }
+  };
 
   struct DBHistogram {
     struct value_dist {
@@ -2022,6 +2124,15 @@ private:
   std::deque<DeferredBatch*> deferred_done_queue;   ///< deferred ios done
   bool kv_sync_in_progress = false;
 
+  std::vector<std::unique_ptr<KVSubmitShard>> kv_submit_shards;
+
+  /// compresses the blobs of the writes having several of them
+  std::unique_ptr<boost::asio::thread_pool> compress_pool;
+  std::once_flag compress_pool_once;
+  ceph::mutex kv_submit_lock = ceph::make_mutex("BlueStore::kv_submit_lock");
+  ceph::condition_variable kv_submit_cond;
+  size_t kv_submit_pending = 0;  ///< txcs handed to shards, not yet applied
+
   KVFinalizeThread kv_finalize_thread;
   ceph::mutex kv_finalize_lock = ceph::make_mutex("BlueStore::kv_finalize_lock");
   ceph::condition_variable kv_finalize_cond;
@@ -2031,6 +2142,15 @@ private:
 
   PerfCounters *logger = nullptr;
 
+  class SocketHook;
+  SocketHook *asok_hook = nullptr;
+
+  // transaction capture, see start_txc_capture()
+  ceph::mutex capture_lock = ceph::make_mutex("BlueStore::capture_lock");
+  std::atomic<bool> capturing = {false};
+  int capture_fd = -1;
+  uint64_t capture_records = 0;
+
   std::list<CollectionRef> removed_collections;
 
   ceph::shared_mutex debug_read_error_lock =
@@ -2065,6 +2185,11 @@ private:
   ///< approx cost per io, in bytes
   std::atomic<uint64_t> throttle_cost_per_io = {0};
 
+  /// measured io latencies, for get_cost_per_io()
+  ceph::mutex io_cost_lock = ceph::make_mutex("BlueStore::io_cost_lock");
+  IOCostModel io_cost_model;
+  std::atomic<uint64_t> io_cost_sample_seq = {0};
+
   std::atomic<Compressor::CompressionMode> comp_mode =
     {Compressor::COMP_NONE}; ///< compression mode
   CompressorRef compressor;
@@ -2107,6 +2232,7 @@ private:
     ceph::mutex lock = ceph::make_mutex("BlueStore::MempoolThread::lock");
     bool stop = false;
     std::shared_ptr<PriorityCache::PriCache> binned_kv_cache = nullptr;
+    std::shared_ptr<PriorityCache::PriCache> memtable_cache = nullptr;
     std::shared_ptr<PriorityCache::Manager> pcm = nullptr;
 
     struct MempoolCache : public PriorityCache::PriCache {
@@ -2236,11 +2362,110 @@ private:
     void _resize_shards(bool interval_stats);
   } mempool_thread;
 
+  /// rewrites onodes whose data got scattered over many extents
+  struct DefragThread : public Thread {
+    BlueStore *store;
+    ceph::condition_variable cond;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::DefragThread::lock");
+    bool stop = false;
+
+    explicit DefragThread(BlueStore *s) : store(s) {}
+    void *entry() override {
+      store->_defrag_thread();
+      return nullptr;
+    }
+    void init() {
+      ceph_assert(stop == false);
+      create("bstore_defrag");
+    }
+    void shutdown() {
+      if (!is_started()) {
+	return;
+      }
+      lock.lock();
+      stop = true;
+      cond.notify_all();
+      lock.unlock();
+      join();
+      stop = false;
+    }
+  } defrag_thread;
+
+  /// frees zones of a zoned device by moving their live data elsewhere
+  struct ZonedCleanerThread : public Thread {
+    BlueStore *store;
+    ceph::condition_variable cond;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::ZonedCleanerThread::lock");
+    bool stop = false;
+
+    explicit ZonedCleanerThread(BlueStore *s) : store(s) {}
+    void *entry() override {
+      store->_zoned_cleaner_thread();
+      return nullptr;
+    }
+    void init() {
+      ceph_assert(stop == false);
+      create("bstore_zclean");
+    }
+    void shutdown() {
+      if (!is_started()) {
+	return;
+      }
+      lock.lock();
+      stop = true;
+      cond.notify_all();
+      lock.unlock();
+      join();
+      stop = false;
+    }
+  } zoned_cleaner_thread;
+
+  struct PrefetchThread : public Thread {
+    BlueStore *store;
+    ceph::condition_variable cond;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::PrefetchThread::lock");
+    bool stop = false;
+    /// pending hints, dropped rather than queued past max_queued oids
+    std::deque<std::pair<CollectionRef, std::vector<ghobject_t>>> queue;
+    uint64_t queued = 0;
+    static constexpr uint64_t max_queued = 1024;
+
+    explicit PrefetchThread(BlueStore *s) : store(s) {}
+    void *entry() override {
+      store->_prefetch_thread();
+      return nullptr;
+    }
+    void init() {
+      ceph_assert(stop == false);
+      create("bstore_prefetch");
+    }
+    void shutdown() {
+      if (!is_started()) {
+	return;
+      }
+      lock.lock();
+      stop = true;
+      cond.notify_all();
+      lock.unlock();
+      join();
+      stop = false;
+      queue.clear();
+      queued = 0;
+    }
+  } prefetch_thread;
+
   // --------------------------------------------------------
   // private methods
 
   void _init_logger();
   void _shutdown_logger();
+  void dump_state_lat_histograms(ceph::Formatter *f, bool reset);
+
+  /// append the transactions queued from now on to a file, for replay
+  int start_txc_capture(const std::string& path, std::ostream& ss);
+  int stop_txc_capture(std::ostream& ss);
+  void _capture_transactions(const coll_t& cid,
+			     const std::vector<Transaction>& tls);
   int _reload_logger();
 
   int _open_path();
@@ -2299,6 +2524,9 @@ private:
   int _write_out_fm_meta(uint64_t target_size);
   int _open_alloc();
   void _close_alloc();
+  int _load_alloc_snapshot(uint64_t *num, uint64_t *bytes);
+  void _write_alloc_snapshot();
+  void _remove_alloc_snapshot();
   int _open_collections();
   void _fsck_collections(int64_t* errors);
   void _close_collections();
@@ -2354,6 +2582,8 @@ private:
   void _txc_write_nodes(TransContext *txc, KeyValueDB::Transaction t);
   void _txc_state_proc(TransContext *txc);
   void _txc_aio_submit(TransContext *txc);
+  /// write the space of the zoned slot of the txc left unwritten
+  void _txc_zoned_fill(TransContext *txc);
 public:
   void txc_aio_finish(void *p) {
     _txc_state_proc(static_cast<TransContext*>(p));
@@ -2376,12 +2606,42 @@ private:
   void _kv_stop();
   void _kv_sync_thread();
   void _kv_finalize_thread();
+  void _kv_submit_shard_thread(KVSubmitShard *shard);
+
+  void _defrag_thread();
+  void _prefetch_thread();
+  void _zoned_cleaner_thread();
+  void _sample_io_cost(uint64_t ios, uint64_t bytes,
+		       ceph::mono_clock::duration lat);
+  /// clean one zone; false if there was nothing to do
+  bool _zoned_clean();
+  int _zoned_check_layout();
+  /// number of physically contiguous runs the object data takes
+  uint64_t _defrag_count_extents(OnodeRef& o);
+  bool _defrag_wanted(OnodeRef& o, uint64_t *extents);
+  int _defrag_onode(CollectionRef& c, const ghobject_t& oid,
+		    uint64_t *bytes, uint64_t *extents_removed);
+  /**
+   * rewrite the logical ranges of an object @p pick selects in a
+   * transaction of its own and wait for it to commit; -EAGAIN if the
+   * onode is in use by an unfinished transaction
+   */
+  int _rewrite_onode(
+    CollectionRef& c, const ghobject_t& oid,
+    std::function<void(OnodeRef&, interval_set<uint64_t>*)> pick,
+    std::function<void(OnodeRef&)> rewritten,
+    uint64_t *bytes);
+  void _txc_prepare_kv(TransContext *txc);
+  void _txc_throttle_start(TransContext *txc);
+  void _kv_submit_sharded(const std::deque<TransContext*>& txcs);
 
   bluestore_deferred_op_t *_get_deferred_op(TransContext *txc);
   void _deferred_queue(TransContext *txc);
 public:
   void deferred_try_submit();
 private:
+  DeferredBatch *_deferred_start(OpSequencer *osr);
+  void _deferred_prepare_writes(DeferredBatch *b);
   void _deferred_submit_unlock(OpSequencer *osr);
   void _deferred_aio_finish(OpSequencer *osr);
   int _deferred_replay();
@@ -2488,6 +2748,7 @@ public:
   int get_devices(std::set<std::string> *ls) override;
 
   bool is_rotational() override;
+  uint64_t get_cost_per_io() override;
   bool is_journal_rotational() override;
 
   std::string get_default_device_class() override {
@@ -2609,6 +2870,14 @@ public:
   void collect_metadata(std::map<std::string,std::string> *pm) override;
 
   bool exists(CollectionHandle &c, const ghobject_t& oid) override;
+  void prefetch(CollectionHandle &c,
+		const std::vector<ghobject_t>& oids) override;
+  bool enable_inline_poll() override {
+    return bdev && bdev->enable_inline_poll();
+  }
+  unsigned poll_completions() override {
+    return bdev ? bdev->poll_completions() : 0;
+  }
   int set_collection_opts(
     CollectionHandle& c,
     const pool_opts_t& opts) override;
@@ -2699,6 +2968,14 @@ private:
     bool* csum_error,
     ceph::buffer::list& bl);
 
+  /// reads hinted both sequential and don't-need come from bulk readers
+  /// such as deep scrub, recovery and defrag
+  static blk_io_class_t _read_io_class(uint32_t op_flags) {
+    constexpr uint32_t bulk = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL |
+      CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
+    return (op_flags & bulk) == bulk ? BLK_IO_BACKGROUND : BLK_IO_CLIENT;
+  }
+
   int _do_read(
     Collection *c,
     OnodeRef o,
@@ -2996,6 +3273,11 @@ private:
     uint64_t blob_xoffset,
     const ceph::buffer::list& bl,
     uint64_t logical_offset) const;
+  /// cache the crc32c of the buffers of @p bl, verified against @p blob
+  void _seed_read_crc(
+    const bluestore_blob_t* blob,
+    uint64_t blob_xoffset,
+    const ceph::buffer::list& bl) const;
   int _decompress(ceph::buffer::list& source, ceph::buffer::list* result);
 
 
@@ -3027,6 +3309,10 @@ private:
       ceph::buffer::list compressed_bl;
       size_t compressed_len = 0;
 
+      int compress_r = 0;               ///< result of the compressor
+      ceph::buffer::list compress_out;  ///< its output, without the header
+      ceph::timespan compress_lat = ceph::timespan::zero();
+
       write_item(
 	uint64_t logical_offs,
         BlobRef b,
@@ -3106,6 +3392,9 @@ private:
     uint64_t offset, uint64_t length,
     ceph::buffer::list::iterator& blp,
     WriteContext *wctx);
+  void _compress_blobs(
+    CompressorRef& c,
+    WriteContext *wctx);
   int _do_alloc_write(
     TransContext *txc,
     CollectionRef c,
@@ -3361,6 +3650,9 @@ public:
     std::map<BlobRef, bluestore_blob_t::unused_t>* referenced,
     const BlueStore::FSCK_ObjectCtx& ctx);
 
+  /// read back all object data for deep fsck, returns number of errors
+  int64_t fsck_read_object_data(CollectionRef c, OnodeRef o);
+
 private:
   void _fsck_check_object_omap(FSCKDepth depth,
     OnodeRef& o,
@@ -3638,11 +3930,14 @@ class RocksDBBlueFSVolumeSelector : public BlueFSVolumeSelector
 
   uint64_t l_totals[LEVEL_MAX - LEVEL_FIRST];
   uint64_t db_avail4slow = 0;
+  uint64_t heat_threshold = 0; ///< reads per check to promote a file, 0 - off
   enum {
     OLD_POLICY,
     USE_SOME_EXTRA
   };
 
+  uint64_t _get_db_avail4slow();
+
 public:
   RocksDBBlueFSVolumeSelector(
     uint64_t _wal_total,
@@ -3653,7 +3948,9 @@ public:
     uint64_t _level_multiplier,
     double reserved_factor,
     uint64_t reserved,
-    bool new_pol)
+    bool new_pol,
+    uint64_t _heat_threshold = 0)
+    : heat_threshold(_heat_threshold)
   {
     l_totals[LEVEL_LOG - LEVEL_FIRST] = 0; // not used at the moment
     l_totals[LEVEL_WAL - LEVEL_FIRST] = _wal_total;
@@ -3774,6 +4071,8 @@ public:
   }
 
   uint8_t select_prefer_bdev(void* h) override;
+  bool should_promote(void* h, const bluefs_fnode_t& fnode,
+		      uint64_t heat) override;
   void get_paths(
     const std::string& base,
     BlueFSVolumeSelector::paths& res) const override;
@@ -0,0 +1,198 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <sys/mman.h>
+#include <vector>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "CacheArena.h"
+#include "common/ceph_context.h"
+#include "common/debug.h"
+#include "common/deleter.h"
+#include "common/errno.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bluestore
+#undef dout_prefix
+#define dout_prefix *_dout << "bluestore.CacheArena(" << this << ") "
+
+CacheArena::CacheArena(CephContext *cct, int numa_node, bool hugetlb)
+  : cct(cct), numa_node(numa_node), hugetlb(hugetlb)
+{
+}
+
+CacheArena::~CacheArena()
+{
+  // every buffer holds a reference to us, so only empty regions are left
+  for (unsigned o = 0; o + 1 < ORDERS; ++o) {
+    ceph_assert(free[o].empty());
+  }
+  for (auto p : free[ORDERS - 1]) {
+    _unmap_region(p);
+  }
+}
+
+bool CacheArena::copy_in(ceph::buffer::list& bl)
+{
+  size_t len = bl.length();
+  if (len == 0 || len > REGION_SIZE) {
+    return false;
+  }
+  unsigned order = 0;
+  while ((1ull << (BLOCK_SHIFT + order)) < len) {
+    ++order;
+  }
+  char *p;
+  {
+    std::lock_guard l(lock);
+    p = _allocate(order);
+  }
+  if (!p) {
+    return false;
+  }
+  size_t size = 1ull << (BLOCK_SHIFT + order);
+  used += size;
+  bl.begin().copy(len, p);
+
+  // the raw is as long as the block, for the mempools to see what the
+  // cache really takes
+  ceph::buffer::ptr bp(ceph::buffer::claim_buffer(
+    size, p,
+    make_deleter([arena = shared_from_this(), p, order] {
+      arena->release(p, order);
+    })));
+  bp.set_length(len);
+  bl.clear();
+  bl.push_back(std::move(bp));
+  return true;
+}
+
+char *CacheArena::_allocate(unsigned order)
+{
+  unsigned o = order;
+  while (o < ORDERS && free[o].empty()) {
+    ++o;
+  }
+  char *p;
+  if (o < ORDERS) {
+    // the lowest block, to leave the regions at the top to empty out
+    p = *free[o].begin();
+    free[o].erase(free[o].begin());
+  } else {
+    p = _map_region();
+    if (!p) {
+      return nullptr;
+    }
+    o = ORDERS - 1;
+  }
+  // split it down to size, leaving the upper halves free
+  while (o > order) {
+    --o;
+    free[o].insert(p + (1ull << (BLOCK_SHIFT + o)));
+  }
+  return p;
+}
+
+void CacheArena::release(char *p, unsigned order)
+{
+  used -= 1ull << (BLOCK_SHIFT + order);
+  std::lock_guard l(lock);
+  // regions are aligned to their size, so the buddy of a block differs from
+  // it in the one bit of its size
+  while (order + 1 < ORDERS) {
+    char *buddy = reinterpret_cast<char*>(
+      reinterpret_cast<uintptr_t>(p) ^ (1ull << (BLOCK_SHIFT + order)));
+    auto i = free[order].find(buddy);
+    if (i == free[order].end()) {
+      break;
+    }
+    free[order].erase(i);
+    p = std::min(p, buddy);
+    ++order;
+  }
+  if (order + 1 == ORDERS && !free[order].empty()) {
+    // keep one empty region around, not to map and unmap one as buffers
+    // come and go at the boundary
+    _unmap_region(p);
+    return;
+  }
+  free[order].insert(p);
+}
+
+char *CacheArena::_map_region()
+{
+  void *m = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (hugetlb && !hugetlb_failed) {
+    m = ::mmap(nullptr, REGION_SIZE, PROT_READ|PROT_WRITE,
+	       MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB
+#ifdef MAP_HUGE_2MB
+	       |MAP_HUGE_2MB
+#endif
+	       , -1, 0);
+    if (m == MAP_FAILED) {
+      // do not ask again for every region
+      int r = -errno;
+      derr << __func__ << " no huge page for a region: " << cpp_strerror(r)
+	   << ", using normal pages" << dendl;
+      hugetlb_failed = true;
+    }
+  }
+#endif
+  if (m == MAP_FAILED) {
+    // map twice the size to cut an aligned region out of it, for the buddy
+    // arithmetic and for the kernel to back it with one huge page
+    m = ::mmap(nullptr, REGION_SIZE * 2, PROT_READ|PROT_WRITE,
+	       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) {
+      int r = -errno;
+      derr << __func__ << " failed to map a region: " << cpp_strerror(r)
+	   << dendl;
+      return nullptr;
+    }
+    char *c = static_cast<char*>(m);
+    char *aligned = reinterpret_cast<char*>(
+      (reinterpret_cast<uintptr_t>(c) + REGION_SIZE - 1) & ~(REGION_SIZE - 1));
+    if (aligned > c) {
+      ::munmap(c, aligned - c);
+    }
+    if (aligned + REGION_SIZE < c + REGION_SIZE * 2) {
+      ::munmap(aligned + REGION_SIZE, c + REGION_SIZE * 2 - aligned - REGION_SIZE);
+    }
+    m = aligned;
+#ifdef MADV_HUGEPAGE
+    // a no-op while the process has THP disabled, see the thp option
+    ::madvise(m, REGION_SIZE, MADV_HUGEPAGE);
+#endif
+  }
+#ifdef __linux__
+  if (numa_node >= 0) {
+    // before anything touches it, so that no page lands elsewhere
+    constexpr unsigned bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(numa_node / bits + 1);
+    mask[numa_node / bits] = 1ul << (numa_node % bits);
+    if (::syscall(SYS_mbind, m, REGION_SIZE, MPOL_PREFERRED, mask.data(),
+		  mask.size() * bits + 1, 0) < 0) {
+      int r = -errno;
+      dout(10) << __func__ << " unable to place region on numa node "
+	       << numa_node << ": " << cpp_strerror(r) << dendl;
+    }
+  }
+#endif
+  ++num_regions;
+  dout(20) << __func__ << " " << m << ", " << num_regions << " regions"
+	   << dendl;
+  return static_cast<char*>(m);
+}
+
+void CacheArena::_unmap_region(char *p)
+{
+  ::munmap(p, REGION_SIZE);
+  --num_regions;
+  dout(20) << __func__ << " " << (void*)p << ", " << num_regions << " regions"
+	   << dendl;
+}
@@ -0,0 +1,61 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <set>
+
+#include "common/ceph_mutex.h"
+#include "include/buffer.h"
+#include "include/common_fwd.h"
+
+/// Memory for the data of the cached buffers of a BlueStore cache shard,
+/// carved out of 2 MiB regions that are backed by huge pages and placed on
+/// one NUMA node, so that cache hits need fewer TLB entries and do not
+/// cross sockets.  Buffers are handed out by a buddy allocator in power of
+/// two multiples of 4 KiB; they outlive the arena if they have to.
+class CacheArena : public std::enable_shared_from_this<CacheArena> {
+public:
+  static constexpr unsigned BLOCK_SHIFT = 12;
+  static constexpr unsigned REGION_SHIFT = 21;
+  static constexpr size_t REGION_SIZE = 1ull << REGION_SHIFT;
+
+  /// numa_node < 0 for no placement; hugetlb to take the regions from
+  /// the reserved huge pages rather than to ask for transparent ones
+  CacheArena(CephContext *cct, int numa_node, bool hugetlb);
+  ~CacheArena();
+
+  /// move the contents of bl into a single buffer of the arena, or
+  /// return false for bl to stay where it is if it is larger than a region
+  /// or no region can be mapped
+  bool copy_in(ceph::buffer::list& bl);
+
+  uint64_t get_mapped() const {
+    return num_regions * REGION_SIZE;
+  }
+  uint64_t get_used() const {
+    return used;
+  }
+
+private:
+  static constexpr unsigned ORDERS = REGION_SHIFT - BLOCK_SHIFT + 1;
+
+  char *_allocate(unsigned order);
+  void release(char *p, unsigned order);
+  char *_map_region();
+  void _unmap_region(char *p);
+
+  CephContext *cct;
+  const int numa_node;
+  const bool hugetlb;
+
+  ceph::mutex lock = ceph::make_mutex("CacheArena::lock");
+  /// free blocks of 1 << (BLOCK_SHIFT + order) bytes, by order
+  std::set<char*> free[ORDERS];
+  bool hugetlb_failed = false;
+
+  std::atomic<uint64_t> num_regions = {0};
+  std::atomic<uint64_t> used = {0};
+};
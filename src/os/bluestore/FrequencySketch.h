@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/// Approximate access counts in the style of TinyLFU: a count-min sketch
+/// of saturating 4-bit counters, halved once enough increments have been
+/// recorded so that old popularity fades away.
+class FrequencySketch {
+  static constexpr unsigned depth = 4;
+  static constexpr uint8_t max_count = 15;
+
+  std::vector<uint8_t> table;
+  uint64_t mask = 0;
+  uint64_t additions = 0;
+  uint64_t sample_size = 0;
+
+  size_t index(uint64_t h, unsigned i) const {
+    static constexpr uint64_t seeds[depth] = {
+      0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+      0x9ae16a3b2f90404full, 0xcbf29ce484222325ull
+    };
+    uint64_t x = (h + seeds[i]) * seeds[i];
+    x ^= x >> 32;
+    return x & mask;
+  }
+
+  void age() {
+    for (auto& c : table) {
+      c >>= 1;
+    }
+    additions /= 2;
+  }
+
+public:
+  /// size for tracking about @p capacity distinct hot keys; drops history
+  /// when the table has to grow
+  void resize(uint64_t capacity) {
+    uint64_t width = 64;
+    while (width < capacity && width < (1ull << 24)) {
+      width <<= 1;
+    }
+    if (width == table.size()) {
+      return;
+    }
+    table.assign(width, 0);
+    mask = width - 1;
+    additions = 0;
+    sample_size = width * 10;
+  }
+
+  size_t size() const {
+    return table.size();
+  }
+
+  void increment(uint64_t h) {
+    if (table.empty()) {
+      return;
+    }
+    for (unsigned i = 0; i < depth; ++i) {
+      auto& c = table[index(h, i)];
+      if (c < max_count) {
+	++c;
+      }
+    }
+    if (++additions >= sample_size) {
+      age();
+    }
+  }
+
+  unsigned estimate(uint64_t h) const {
+    if (table.empty()) {
+      return 0;
+    }
+    unsigned r = max_count;
+    for (unsigned i = 0; i < depth; ++i) {
+      r = std::min<unsigned>(r, table[index(h, i)]);
+    }
+    return r;
+  }
+};
@@ -14,7 +14,7 @@
 #define dout_prefix *_dout << "HybridAllocator "
 
 
-int64_t HybridAllocator::allocate(
+int64_t HybridAllocator::_allocate_shared(
   uint64_t want,
   uint64_t unit,
   uint64_t max_alloc_size,
@@ -27,16 +27,6 @@ int64_t HybridAllocator::allocate(
                  << " max_alloc_size 0x" << max_alloc_size
                  << " hint 0x" << hint
                  << std::dec << dendl;
-  ceph_assert(isp2(unit));
-  ceph_assert(want % unit == 0);
-
-  if (max_alloc_size == 0) {
-    max_alloc_size = want;
-  }
-  if (constexpr auto cap = std::numeric_limits<decltype(bluestore_pextent_t::length)>::max();
-      max_alloc_size >= cap) {
-    max_alloc_size = p2align(uint64_t(cap), (uint64_t)get_block_size());
-  }
 
   std::lock_guard l(lock);
 
@@ -106,6 +96,9 @@ int64_t HybridAllocator::allocate(
 }
 
 void HybridAllocator::release(const interval_set<uint64_t>& release_set) {
+  if (trace_enabled()) {
+    _trace_release(release_set);
+  }
   std::lock_guard l(lock);
   // this will attempt to put free ranges into AvlAllocator first and
   // fallback to bitmap one via _try_insert_range call
@@ -115,7 +108,8 @@ void HybridAllocator::release(const interval_set<uint64_t>& release_set) {
 uint64_t HybridAllocator::get_free()
 {
   std::lock_guard l(lock);
-  return (bmap_alloc ? bmap_alloc->get_free() : 0) + _get_free();
+  return (bmap_alloc ? bmap_alloc->get_free() : 0) + _get_free() +
+    _get_arena_free();
 }
 
 double HybridAllocator::get_fragmentation()
@@ -155,6 +149,10 @@ void HybridAllocator::dump(std::function<void(uint64_t offset, uint64_t length)>
 
 void HybridAllocator::init_rm_free(uint64_t offset, uint64_t length)
 {
+  if (trace_enabled()) {
+    _trace_init(false, offset, length);
+  }
+  _drain_arenas();
   std::lock_guard l(lock);
   ldout(cct, 10) << __func__ << std::hex
                  << " offset 0x" << offset
@@ -178,6 +176,7 @@ void HybridAllocator::init_rm_free(uint64_t offset, uint64_t length)
 
 void HybridAllocator::shutdown()
 {
+  _clear_arenas();
   std::lock_guard l(lock);
   _shutdown();
   if (bmap_alloc) {
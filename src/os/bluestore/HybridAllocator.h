@@ -16,12 +16,6 @@ public:
 	          const std::string& name) :
       AvlAllocator(cct, device_size, _block_size, max_mem, name) {
   }
-  int64_t allocate(
-    uint64_t want,
-    uint64_t unit,
-    uint64_t max_alloc_size,
-    int64_t  hint,
-    PExtentVector *extents) override;
   void release(const interval_set<uint64_t>& release_set) override;
   uint64_t get_free() override;
   double get_fragmentation() override;
@@ -41,6 +35,13 @@ protected:
   }
 private:
 
+  int64_t _allocate_shared(
+    uint64_t want,
+    uint64_t unit,
+    uint64_t max_alloc_size,
+    int64_t  hint,
+    PExtentVector *extents) override;
+
   void _spillover_range(uint64_t start, uint64_t end) override;
 
   // called when extent to be released/marked free
@@ -0,0 +1,56 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <cstdint>
+
+/// Online fit of io latency = per_io * ios + per_byte * bytes by least
+/// squares, with older samples decaying away so that the fit follows the
+/// device.  Latencies measured under load include queueing; that inflates
+/// both terms alike and leaves their ratio mostly intact.
+class IOCostModel {
+  static constexpr uint64_t min_samples = 100;
+
+  double decay;
+  double s_ii = 0, s_ib = 0, s_bb = 0;  ///< regressor products
+  double s_iy = 0, s_by = 0;            ///< regressors times latency
+  uint64_t samples = 0;
+
+public:
+  explicit IOCostModel(double decay = 0.999) : decay(decay) {}
+
+  void add(uint64_t ios, uint64_t bytes, double usec) {
+    double i = ios, b = bytes;
+    s_ii = s_ii * decay + i * i;
+    s_ib = s_ib * decay + i * b;
+    s_bb = s_bb * decay + b * b;
+    s_iy = s_iy * decay + i * usec;
+    s_by = s_by * decay + b * usec;
+    ++samples;
+  }
+
+  uint64_t get_samples() const {
+    return samples;
+  }
+
+  /// false until there are enough samples of different sizes for a fit
+  bool get(double *per_io_usec, double *per_byte_usec) const {
+    if (samples < min_samples) {
+      return false;
+    }
+    double det = s_ii * s_bb - s_ib * s_ib;
+    // all ios of about the same size can't tell the two terms apart
+    if (det <= 1e-6 * s_ii * s_bb) {
+      return false;
+    }
+    double per_io = (s_iy * s_bb - s_by * s_ib) / det;
+    double per_byte = (s_by * s_ii - s_iy * s_ib) / det;
+    if (per_io <= 0 || per_byte <= 0) {
+      return false;
+    }
+    *per_io_usec = per_io;
+    *per_byte_usec = per_byte;
+    return true;
+  }
+};
@@ -70,7 +70,13 @@ KernelDevice::KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, ai
   unsigned int iodepth = cct->_conf->bdev_aio_max_queue_depth;
 
   if (use_ioring && ioring_queue_t::supported()) {
-    io_queue = std::make_unique<ioring_queue_t>(iodepth);
+    io_queue = std::make_unique<ioring_queue_t>(
+      iodepth,
+      cct->_conf.get_val<bool>("bdev_ioring_hipri"),
+      cct->_conf.get_val<bool>("bdev_ioring_sqthread_poll"),
+      cct->_conf.get_val<uint64_t>("bdev_ioring_sqthread_idle_ms"),
+      cct->_conf.get_val<uint64_t>("bdev_ioring_registered_buffers"),
+      cct->_conf.get_val<Option::size_t>("bdev_ioring_registered_buffer_size"));
   } else {
     static bool once;
     if (use_ioring && !once) {
@@ -80,6 +86,18 @@ KernelDevice::KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, ai
     }
     io_queue = std::make_unique<aio_queue_t>(iodepth);
   }
+
+  if (cct->_conf.get_val<bool>("bdev_aio_ioprio")) {
+    // best effort class, levels 0 (highest) to 7; background io stays
+    // in best effort rather than idle so it can't be starved for good
+    auto be = [](uint16_t level) -> uint16_t { return (2 << 13) | level; };
+    class_ioprio[BLK_IO_CLIENT] = be(0);
+    class_ioprio[BLK_IO_DEFERRED] = be(2);
+    class_ioprio[BLK_IO_BLUEFS] = be(4);
+    class_ioprio[BLK_IO_BACKGROUND] = be(7);
+  }
+  background_max_inflight = cct->_conf.get_val<uint64_t>(
+    "bdev_aio_background_max_inflight");
 }
 
 int KernelDevice::_lock()
@@ -208,6 +226,12 @@ int KernelDevice::open(const string& p)
       support_discard = blkdev_buffered.support_discard();
       this->devname = devname;
       _detect_vdo();
+      if (blkdev_buffered.is_host_managed_zoned()) {
+	r = _detect_zones(blkdev_direct);
+	if (r < 0) {
+	  goto out_fail;
+	}
+      }
     }
   }
 
@@ -228,6 +252,7 @@ int KernelDevice::open(const string& p)
 	  << " (" << byte_u_t(block_size) << ")"
 	  << " " << (rotational ? "rotational" : "non-rotational")
       << " discard " << (support_discard ? "supported" : "not supported")
+	  << (smr ? " zoned" : "")
 	  << dendl;
   return 0;
 
@@ -281,10 +306,78 @@ void KernelDevice::close()
   path.clear();
 }
 
+int KernelDevice::_detect_zones(const BlkDev& blkdev)
+{
+  std::vector<BlkDev::zone_t> zones;
+  int r = blkdev.report_zones(&zones);
+  int64_t zs = blkdev.get_zone_size();
+  if (r < 0 || zs <= 0 || zones.empty()) {
+    derr << __func__ << " " << path << " is host managed zoned but zones can't"
+	 << " be reported: " << cpp_strerror(r < 0 ? r : -EINVAL) << dendl;
+    return r < 0 ? r : -EINVAL;
+  }
+  // the writes to a zone are submitted in order, the scheduler must not
+  // dispatch more than one of them at a time
+  char sched[128] = {0};
+  if (blkdev.scheduler(sched, sizeof(sched)) < 0 ||
+      !strstr(sched, "[mq-deadline]")) {
+    derr << __func__ << " " << path << " is host managed zoned, its io"
+	 << " scheduler must be mq-deadline, not '" << sched << "'" << dendl;
+    return -EINVAL;
+  }
+  smr = true;
+  zone_size = zs;
+  conventional_region_size = 0;
+  for (auto& z : zones) {
+    if (!z.conventional) {
+      break;
+    }
+    conventional_region_size = z.start + z.length;
+  }
+  dout(1) << __func__ << " " << zones.size() << " zones of 0x" << std::hex
+	  << zone_size << ", conventional up to 0x" << conventional_region_size
+	  << std::dec << dendl;
+  return 0;
+}
+
+int KernelDevice::get_zone_write_pointers(std::vector<uint64_t> *written)
+{
+  if (!smr) {
+    return -EOPNOTSUPP;
+  }
+  std::vector<BlkDev::zone_t> zones;
+  int r = BlkDev{fd_directs[WRITE_LIFE_NOT_SET]}.report_zones(&zones);
+  if (r < 0) {
+    derr << __func__ << " report zones failed: " << cpp_strerror(r) << dendl;
+    return r;
+  }
+  written->clear();
+  for (auto& z : zones) {
+    written->push_back(z.written);
+  }
+  return 0;
+}
+
+int KernelDevice::reset_zone(uint64_t zone)
+{
+  if (!smr) {
+    return -EOPNOTSUPP;
+  }
+  dout(10) << __func__ << " zone " << zone << dendl;
+  int r = BlkDev{fd_directs[WRITE_LIFE_NOT_SET]}.reset_zone(
+    zone * zone_size, zone_size);
+  if (r < 0) {
+    derr << __func__ << " zone " << zone << " failed: " << cpp_strerror(r)
+	 << dendl;
+  }
+  return r;
+}
+
 int KernelDevice::collect_metadata(const string& prefix, map<string,string> *pm) const
 {
   (*pm)[prefix + "support_discard"] = stringify((int)(bool)support_discard);
   (*pm)[prefix + "rotational"] = stringify((int)(bool)rotational);
+  (*pm)[prefix + "zoned"] = stringify((int)smr);
   (*pm)[prefix + "size"] = stringify(get_size());
   (*pm)[prefix + "block_size"] = stringify(get_block_size());
   (*pm)[prefix + "driver"] = "KernelDevice";
@@ -582,12 +675,21 @@ void KernelDevice::_aio_thread()
                << " but returned: " << r << dendl;
           ceph_abort_msg("unexpected aio return value: does not match length");
         }
+	if (r >= 0 && aio[i]->copy_to.length()) {
+	  aio[i]->bl.begin().copy(aio[i]->copy_to.length(),
+				  aio[i]->copy_to.c_str());
+	  aio[i]->bl.clear();
+	}
 
         dout(10) << __func__ << " finished aio " << aio[i] << " r " << r
                  << " ioc " << ioc
                  << " with " << (ioc->num_running.load() - 1)
                  << " aios left" << dendl;
 
+	if (ioc->io_class == BLK_IO_BACKGROUND && background_max_inflight) {
+	  _background_finish();
+	}
+
 	// NOTE: once num_running and we either call the callback or
 	// call aio_wake we cannot touch ioc or aio[] as the caller
 	// may free it.
@@ -771,6 +873,9 @@ void KernelDevice::aio_submit(IOContext *ioc)
   ioc->running_aios.splice(e, ioc->pending_aios);
 
   int pending = ioc->num_pending.load();
+  if (ioc->io_class == BLK_IO_BACKGROUND && background_max_inflight) {
+    _background_throttle(pending);
+  }
   ioc->num_running += pending;
   ioc->num_pending -= pending;
   ceph_assert(ioc->num_pending.load() == 0);  // we should be only thread doing this
@@ -785,6 +890,12 @@ void KernelDevice::aio_submit(IOContext *ioc)
     }
   }
 
+  if (uint16_t prio = class_ioprio[ioc->io_class]; prio) {
+    for (auto p = ioc->running_aios.begin(); p != e; ++p) {
+      p->ioprio = prio;
+    }
+  }
+
   void *priv = static_cast<void*>(ioc);
   int r, retries = 0;
   r = io_queue->submit_batch(ioc->running_aios.begin(), e,
@@ -798,6 +909,26 @@ void KernelDevice::aio_submit(IOContext *ioc)
   }
 }
 
+void KernelDevice::_background_throttle(int ios)
+{
+  // leave queue slots to client io; a batch larger than the limit goes
+  // alone once nothing else of ours is in flight
+  std::unique_lock l(background_lock);
+  background_cond.wait(l, [&] {
+    return background_inflight == 0 ||
+      background_inflight + ios <= background_max_inflight;
+  });
+  background_inflight += ios;
+}
+
+void KernelDevice::_background_finish()
+{
+  std::lock_guard l(background_lock);
+  ceph_assert(background_inflight > 0);
+  --background_inflight;
+  background_cond.notify_all();
+}
+
 int KernelDevice::_sync_write(uint64_t off, bufferlist &bl, bool buffered, int write_hint)
 {
   uint64_t len = bl.length();
@@ -1039,12 +1170,20 @@ int KernelDevice::aio_read(
     ioc->pending_aios.push_back(aio_t(ioc, fd_directs[WRITE_LIFE_NOT_SET]));
     ++ioc->num_pending;
     aio_t& aio = ioc->pending_aios.back();
-    bufferptr p = ceph::buffer::create_small_page_aligned(len);
+    bool registered;
+    bufferptr p = io_queue->create_read_buffer(len, &registered);
     aio.bl.append(std::move(p));
     aio.bl.prepare_iov(&aio.iov);
     aio.preadv(off, len);
     dout(30) << aio << dendl;
-    pbl->append(aio.bl);
+    if (registered) {
+      // the caller may keep the data for long (in the cache, say), the
+      // registered buffer goes back to the pool as soon as it is copied
+      aio.copy_to = ceph::buffer::create_small_page_aligned(len);
+      pbl->append(aio.copy_to);
+    } else {
+      pbl->append(aio.bl);
+    }
     dout(5) << __func__ << " 0x" << std::hex << off << "~" << len
 	    << std::dec << " aio " << &aio << dendl;
   } else
@@ -27,6 +27,7 @@
 
 #define RW_IO_MAX (INT_MAX & CEPH_PAGE_MASK)
 
+class BlkDev;
 
 class KernelDevice : public BlockDevice {
   std::vector<int> fd_directs, fd_buffereds;
@@ -39,6 +40,10 @@ class KernelDevice : public BlockDevice {
 
   std::string devname;  ///< kernel dev name (/sys/block/$devname), if any
 
+  bool smr = false;
+  uint64_t zone_size = 0;
+  uint64_t conventional_region_size = 0;
+
   ceph::mutex debug_lock = ceph::make_mutex("KernelDevice::debug_lock");
   interval_set<uint64_t> debug_inflight;
 
@@ -46,6 +51,16 @@ class KernelDevice : public BlockDevice {
   ceph::mutex flush_mutex = ceph::make_mutex("KernelDevice::flush_mutex");
 
   std::unique_ptr<io_queue_t> io_queue;
+  /// kernel io priority for each blk_io_class_t, all 0 when not tagging
+  uint16_t class_ioprio[BLK_IO_NUM_CLASSES] = {};
+
+  /// background aios may only take up this many slots, 0 for no limit
+  unsigned background_max_inflight = 0;
+  ceph::mutex background_lock =
+    ceph::make_mutex("KernelDevice::background_lock");
+  ceph::condition_variable background_cond;
+  unsigned background_inflight = 0;
+
   aio_callback_t discard_callback;
   void *discard_callback_priv;
   bool aio_stop;
@@ -88,6 +103,9 @@ class KernelDevice : public BlockDevice {
   int _discard_start();
   void _discard_stop();
 
+  void _background_throttle(int ios);
+  void _background_finish();
+
   void _aio_log_start(IOContext *ioc, uint64_t offset, uint64_t length);
   void _aio_log_finish(IOContext *ioc, uint64_t offset, uint64_t length);
 
@@ -106,6 +124,7 @@ class KernelDevice : public BlockDevice {
   void debug_aio_unlink(aio_t& aio);
 
   void _detect_vdo();
+  int _detect_zones(const BlkDev& blkdev);
   int choose_fd(bool buffered, int write_hint) const;
 
 public:
@@ -126,6 +145,14 @@ public:
 
   bool get_thin_utilization(uint64_t *total, uint64_t *avail) const override;
 
+  bool is_smr() const override { return smr; }
+  uint64_t get_zone_size() const override { return zone_size; }
+  uint64_t get_conventional_region_size() const override {
+    return conventional_region_size;
+  }
+  int get_zone_write_pointers(std::vector<uint64_t> *written) override;
+  int reset_zone(uint64_t zone) override;
+
   int read(uint64_t off, uint64_t len, ceph::buffer::list *pbl,
 	   IOContext *ioc,
 	   bool buffered) override;
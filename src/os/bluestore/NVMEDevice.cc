@@ -48,6 +48,8 @@
 #define dout_prefix *_dout << "bdev(" << sn << ") "
 
 thread_local SharedDriverQueueData *queue_t;
+// the thread reaps its own completions, see NVMEDevice::enable_inline_poll()
+thread_local bool inline_poll = false;
 
 static constexpr uint16_t data_buffer_default_num = 1024;
 
@@ -136,6 +138,7 @@ class SharedDriverQueueData {
     std::atomic_ulong completed_op_seq, queue_op_seq;
     bi::slist<data_cache_buf, bi::constant_time_size<true>> data_buf_list;
     void _aio_handle(Task *t, IOContext *ioc);
+    unsigned poll_completions();
 
     SharedDriverQueueData(NVMEDevice *bdev, SharedDriverData *driver)
       : bdev(bdev),
@@ -342,8 +345,11 @@ void SharedDriverQueueData::_aio_handle(Task *t, IOContext *ioc)
   uint64_t lba_off, lba_count;
   uint32_t max_io_completion = (uint32_t)g_conf().get_val<uint64_t>("bluestore_spdk_max_io_completion");
   uint64_t io_sleep_in_us = g_conf().get_val<uint64_t>("bluestore_spdk_io_sleep");
+  // a polling thread only waits for its synchronous I/O; the callback
+  // driven kind completes from a later poll_completions()
+  bool wait = !(inline_poll && ioc->priv);
 
-  while (ioc->num_running) {
+  while (wait ? ioc->num_running.load() : t != nullptr) {
  again:
     dout(40) << __func__ << " polling" << dendl;
     if (current_queue_depth) {
@@ -426,6 +432,20 @@ void SharedDriverQueueData::_aio_handle(Task *t, IOContext *ioc)
   dout(20) << __func__ << " end" << dendl;
 }
 
+unsigned SharedDriverQueueData::poll_completions()
+{
+  if (current_queue_depth) {
+    uint32_t max_io_completion = (uint32_t)g_conf().get_val<uint64_t>("bluestore_spdk_max_io_completion");
+    int r = spdk_nvme_qpair_process_completions(qpair, max_io_completion);
+    if (r < 0) {
+      ceph_abort();
+    }
+  }
+  if (reap_io)
+    bdev->reap_ioc();
+  return current_queue_depth;
+}
+
 #define dout_subsys ceph_subsys_bdev
 #undef dout_prefix
 #define dout_prefix *_dout << "bdev "
@@ -779,6 +799,24 @@ void NVMEDevice::aio_submit(IOContext *ioc)
   }
 }
 
+bool NVMEDevice::enable_inline_poll()
+{
+  if (!g_conf().get_val<bool>("bluestore_spdk_inline_poll")) {
+    return false;
+  }
+  dout(10) << __func__ << dendl;
+  inline_poll = true;
+  return true;
+}
+
+unsigned NVMEDevice::poll_completions()
+{
+  if (!queue_t) {
+    return 0;
+  }
+  return queue_t->poll_completions();
+}
+
 static void ioc_append_task(IOContext *ioc, Task *t)
 {
   Task *first, *last;
@@ -56,6 +56,8 @@ class NVMEDevice : public BlockDevice {
   bool supported_bdev_label() override { return false; }
 
   void aio_submit(IOContext *ioc) override;
+  bool enable_inline_poll() override;
+  unsigned poll_completions() override;
 
   int read(uint64_t off, uint64_t len, bufferlist *pbl,
            IOContext *ioc,
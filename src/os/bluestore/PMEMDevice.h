@@ -40,6 +40,7 @@ public:
 
 
   void aio_submit(IOContext *ioc) override;
+  bool is_persistent_memory() const override { return true; }
 
   int collect_metadata(const std::string& prefix, map<std::string,std::string> *pm) const override;
 
@@ -191,6 +191,8 @@ int64_t StupidAllocator::allocate(
   uint64_t offset = 0;
   uint32_t length = 0;
   int res = 0;
+  // pieces may get merged into the caller's last extent
+  PExtentVector traced;
 
   if (max_alloc_size == 0) {
     max_alloc_size = want_size;
@@ -222,10 +224,16 @@ int64_t StupidAllocator::allocate(
     if (can_append) {
       extents->emplace_back(bluestore_pextent_t(offset, length));
     }
+    if (trace_enabled()) {
+      traced.emplace_back(offset, length);
+    }
 
     allocated_size += length;
     hint = offset + length;
   }
+  if (trace_enabled()) {
+    _trace_allocate(want_size, alloc_unit, max_alloc_size, traced, 0);
+  }
 
   if (allocated_size == 0) {
     return -ENOSPC;
@@ -236,6 +244,9 @@ int64_t StupidAllocator::allocate(
 void StupidAllocator::release(
   const interval_set<uint64_t>& release_set)
 {
+  if (trace_enabled()) {
+    _trace_release(release_set);
+  }
   std::lock_guard l(lock);
   for (interval_set<uint64_t>::const_iterator p = release_set.begin();
        p != release_set.end();
@@ -307,6 +318,9 @@ void StupidAllocator::dump(std::function<void(uint64_t offset, uint64_t length)>
 
 void StupidAllocator::init_add_free(uint64_t offset, uint64_t length)
 {
+  if (trace_enabled()) {
+    _trace_init(true, offset, length);
+  }
   std::lock_guard l(lock);
   ldout(cct, 10) << __func__ << " 0x" << std::hex << offset << "~" << length
 		 << std::dec << dendl;
@@ -316,6 +330,9 @@ void StupidAllocator::init_add_free(uint64_t offset, uint64_t length)
 
 void StupidAllocator::init_rm_free(uint64_t offset, uint64_t length)
 {
+  if (trace_enabled()) {
+    _trace_init(false, offset, length);
+  }
   std::lock_guard l(lock);
   ldout(cct, 10) << __func__ << " 0x" << std::hex << offset << "~" << length
 	   	 << std::dec << dendl;
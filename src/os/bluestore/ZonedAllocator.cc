@@ -0,0 +1,432 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <algorithm>
+
+#include "ZonedAllocator.h"
+#include "bluestore_types.h"
+#include "common/debug.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bluestore
+#undef dout_prefix
+#define dout_prefix *_dout << "zonedalloc 0x" << this << " "
+
+ZonedAllocator::ZonedAllocator(CephContext* cct,
+			       int64_t size,
+			       int64_t block_size,
+			       uint64_t zone_size,
+			       uint64_t first_seq_zone,
+			       const std::string& name)
+  : Allocator(name), cct(cct),
+    size(size),
+    block_size(block_size),
+    zone_size(zone_size),
+    first_seq_zone(first_seq_zone),
+    zones(p2roundup<uint64_t>(size, zone_size) / zone_size),
+    slots(std::max<uint64_t>(
+      1, cct->_conf.get_val<uint64_t>("bluestore_zoned_open_zones")))
+{
+  ceph_assert(zone_size % block_size == 0);
+  for (uint64_t z = 0; z < zones.size(); ++z) {
+    zones[z].free_tail = _zone_len(z);
+  }
+  for (auto& slot : slots) {
+    slot.zone = zones.size();
+  }
+}
+
+ZonedAllocator::~ZonedAllocator()
+{
+}
+
+template <typename F>
+void ZonedAllocator::_for_each_zone(uint64_t offset, uint64_t length, F&& f)
+{
+  while (length) {
+    uint64_t z = _zone_of(offset);
+    uint64_t l = std::min(length, _zone_start(z) + _zone_len(z) - offset);
+    f(z, offset, l);
+    offset += l;
+    length -= l;
+  }
+}
+
+void ZonedAllocator::_load()
+{
+  if (loaded) {
+    return;
+  }
+  loaded = true;
+  num_free = 0;
+  for (uint64_t z = 0; z < zones.size(); ++z) {
+    auto& zs = zones[z];
+    uint64_t len = _zone_len(z);
+    if (z < first_seq_zone) {
+      // conventional, never handed out
+      zs.written = zs.submitted = len;
+      zs.dead = 0;
+      continue;
+    }
+    uint64_t w = std::min(zs.device_written, len);
+    if (zs.free_tail <= w && w % block_size == 0) {
+      zs.written = w;
+      zs.dead = zs.init_free - (len - w);
+      num_free += len - w;
+    } else {
+      // allocated space past the write pointer, or a torn write left the
+      // pointer unaligned: nothing can be appended, leave it to the cleaner
+      ldout(cct, 1) << __func__ << " zone " << z << " written 0x" << std::hex
+		    << w << " free from 0x" << zs.free_tail << std::dec
+		    << ", closing" << dendl;
+      zs.written = len;
+      zs.dead = zs.init_free;
+    }
+    zs.submitted = zs.written;
+    ceph_assert(zs.dead <= zs.written);
+  }
+  ldout(cct, 10) << __func__ << " 0x" << std::hex << num_free << std::dec
+		 << " free in " << zones.size() << " zones" << dendl;
+}
+
+bool ZonedAllocator::_is_open(uint64_t zone) const
+{
+  for (auto& slot : slots) {
+    if (slot.zone == zone) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ZonedAllocator::_open_zone(slot_t& slot, uint64_t alloc_unit)
+{
+  auto usable = [&](uint64_t z) {
+    auto& zs = zones[z];
+    return !zs.cleaning &&
+      p2align(_zone_len(z) - zs.written, alloc_unit) > 0;
+  };
+  if (slot.zone < zones.size() && usable(slot.zone)) {
+    return true;
+  }
+  // go on from the zone the slot had, if any
+  uint64_t n = zones.size() - first_seq_zone;
+  uint64_t from = slot.zone < zones.size() ?
+    slot.zone - first_seq_zone + 1 : 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    uint64_t z = first_seq_zone + (from + i) % n;
+    if (usable(z) && !_is_open(z)) {
+      ldout(cct, 10) << __func__ << " zone " << z << " slot "
+		     << (&slot - &slots[0]) << dendl;
+      slot.zone = z;
+      return true;
+    }
+  }
+  slot.zone = zones.size();
+  return false;
+}
+
+int64_t ZonedAllocator::_allocate(
+  slot_t& slot,
+  uint64_t want_size,
+  uint64_t alloc_unit,
+  uint64_t max_alloc_size,
+  PExtentVector *extents)
+{
+  ceph_assert(slot.busy);
+  uint64_t want = p2roundup(want_size, alloc_unit);
+  uint64_t max_extent = p2align<uint64_t>(
+    std::min<uint64_t>(max_alloc_size ? max_alloc_size : want, 1ull << 31),
+    alloc_unit);
+  max_extent = std::max(max_extent, alloc_unit);
+  auto orig_size = extents->size();
+  uint64_t allocated = 0;
+  _load();
+  ldout(cct, 10) << __func__ << " want 0x" << std::hex << want
+		 << " unit 0x" << alloc_unit << std::dec << dendl;
+  while (allocated < want && _open_zone(slot, alloc_unit)) {
+    auto& zs = zones[slot.zone];
+    uint64_t len = std::min(want - allocated,
+			    p2align(_zone_len(slot.zone) - zs.written,
+				    alloc_unit));
+    uint64_t offset = _zone_start(slot.zone) + zs.written;
+    if (std::find(slot.touched.begin(), slot.touched.end(), slot.zone) ==
+	slot.touched.end()) {
+      slot.touched.push_back(slot.zone);
+    }
+    zs.written += len;
+    num_free -= len;
+    allocated += len;
+    while (len) {
+      if (extents->size() > orig_size &&
+	  extents->back().end() == offset &&
+	  extents->back().length + alloc_unit <= max_extent) {
+	uint64_t l = std::min(len, max_extent - extents->back().length);
+	extents->back().length += l;
+	offset += l;
+	len -= l;
+      } else {
+	uint64_t l = std::min(len, max_extent);
+	extents->emplace_back(offset, l);
+	offset += l;
+	len -= l;
+      }
+    }
+  }
+  if (trace_enabled()) {
+    _trace_allocate(want_size, alloc_unit, max_alloc_size, *extents, orig_size);
+  }
+  if (allocated == 0) {
+    return -ENOSPC;
+  }
+  return allocated;
+}
+
+void ZonedAllocator::_put_slot(slot_t& slot)
+{
+  ceph_assert(slot.busy);
+  for (auto z : slot.touched) {
+    zones[z].submitted = zones[z].written;
+  }
+  slot.touched.clear();
+  slot.busy = false;
+  slot_cond.notify_all();
+}
+
+int64_t ZonedAllocator::allocate(
+  uint64_t want_size,
+  uint64_t alloc_unit,
+  uint64_t max_alloc_size,
+  int64_t hint,
+  PExtentVector *extents)
+{
+  std::unique_lock l(lock);
+  slot_cond.wait(l, [this] { return !slots[0].busy; });
+  slots[0].busy = true;
+  auto r = _allocate(slots[0], want_size, alloc_unit, max_alloc_size,
+		     extents);
+  _put_slot(slots[0]);
+  return r;
+}
+
+void ZonedAllocator::get_slot(unsigned slot)
+{
+  std::unique_lock l(lock);
+  ceph_assert(slot < slots.size());
+  slot_cond.wait(l, [&] { return !slots[slot].busy; });
+  slots[slot].busy = true;
+}
+
+bool ZonedAllocator::try_get_slot(unsigned slot)
+{
+  std::lock_guard l(lock);
+  ceph_assert(slot < slots.size());
+  if (slots[slot].busy) {
+    return false;
+  }
+  slots[slot].busy = true;
+  return true;
+}
+
+int64_t ZonedAllocator::allocate_in(
+  unsigned slot,
+  uint64_t want_size,
+  uint64_t alloc_unit,
+  uint64_t max_alloc_size,
+  PExtentVector *extents)
+{
+  std::lock_guard l(lock);
+  ceph_assert(slot < slots.size());
+  return _allocate(slots[slot], want_size, alloc_unit, max_alloc_size,
+		   extents);
+}
+
+void ZonedAllocator::get_unsubmitted(unsigned slot,
+				     interval_set<uint64_t> *ranges)
+{
+  std::lock_guard l(lock);
+  ceph_assert(slot < slots.size() && slots[slot].busy);
+  for (auto z : slots[slot].touched) {
+    auto& zs = zones[z];
+    if (zs.submitted < zs.written) {
+      ranges->union_insert(_zone_start(z) + zs.submitted,
+			   zs.written - zs.submitted);
+    }
+  }
+}
+
+void ZonedAllocator::put_slot(unsigned slot)
+{
+  std::lock_guard l(lock);
+  ceph_assert(slot < slots.size());
+  _put_slot(slots[slot]);
+}
+
+void ZonedAllocator::release(
+  const interval_set<uint64_t>& release_set)
+{
+  if (trace_enabled()) {
+    _trace_release(release_set);
+  }
+  std::lock_guard l(lock);
+  for (auto p = release_set.begin(); p != release_set.end(); ++p) {
+    ldout(cct, 10) << __func__ << " 0x" << std::hex << p.get_start() << "~"
+		   << p.get_len() << std::dec << dendl;
+    _for_each_zone(p.get_start(), p.get_len(),
+      [&](uint64_t z, uint64_t offset, uint64_t length) {
+	auto& zs = zones[z];
+	ceph_assert(offset + length <= _zone_start(z) + zs.written);
+	zs.dead += length;
+	ceph_assert(zs.dead <= zs.written);
+      });
+  }
+}
+
+uint64_t ZonedAllocator::get_free()
+{
+  std::lock_guard l(lock);
+  _load();
+  return num_free;
+}
+
+void ZonedAllocator::dump()
+{
+  std::lock_guard l(lock);
+  for (uint64_t z = first_seq_zone; z < zones.size(); ++z) {
+    auto& zs = zones[z];
+    if (!zs.written) {
+      continue;
+    }
+    ldout(cct, 0) << __func__ << " zone " << z << " written 0x" << std::hex
+		  << zs.written << " dead 0x" << zs.dead << std::dec
+		  << (zs.cleaning ? " cleaning" : "") << dendl;
+  }
+}
+
+void ZonedAllocator::dump(std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  std::lock_guard l(lock);
+  for (uint64_t z = first_seq_zone; z < zones.size(); ++z) {
+    auto& zs = zones[z];
+    if (zs.written < _zone_len(z)) {
+      notify(_zone_start(z) + zs.written, _zone_len(z) - zs.written);
+    }
+  }
+}
+
+void ZonedAllocator::init_zones(const std::vector<uint64_t>& written)
+{
+  std::lock_guard l(lock);
+  ceph_assert(!loaded);
+  for (uint64_t z = 0; z < zones.size() && z < written.size(); ++z) {
+    zones[z].device_written = written[z];
+  }
+}
+
+void ZonedAllocator::init_add_free(uint64_t offset, uint64_t length)
+{
+  if (trace_enabled()) {
+    _trace_init(true, offset, length);
+  }
+  std::lock_guard l(lock);
+  ceph_assert(!loaded);
+  ldout(cct, 10) << __func__ << " 0x" << std::hex << offset << "~" << length
+		 << std::dec << dendl;
+  _for_each_zone(offset, length,
+    [&](uint64_t z, uint64_t offset, uint64_t length) {
+      auto& zs = zones[z];
+      zs.init_free += length;
+      if (offset + length == _zone_start(z) + _zone_len(z)) {
+	zs.free_tail = std::min(zs.free_tail, offset - _zone_start(z));
+      }
+    });
+}
+
+void ZonedAllocator::init_rm_free(uint64_t offset, uint64_t length)
+{
+  if (trace_enabled()) {
+    _trace_init(false, offset, length);
+  }
+  std::lock_guard l(lock);
+  ceph_assert(!loaded);
+  ldout(cct, 10) << __func__ << " 0x" << std::hex << offset << "~" << length
+		 << std::dec << dendl;
+  _for_each_zone(offset, length,
+    [&](uint64_t z, uint64_t offset, uint64_t length) {
+      auto& zs = zones[z];
+      ceph_assert(zs.init_free >= length);
+      zs.init_free -= length;
+      uint64_t end = offset + length - _zone_start(z);
+      if (end > zs.free_tail) {
+	zs.free_tail = end;
+      }
+    });
+}
+
+void ZonedAllocator::shutdown()
+{
+  ldout(cct, 1) << __func__ << dendl;
+}
+
+bool ZonedAllocator::start_cleaning(double min_dead_ratio, uint64_t *zone)
+{
+  std::lock_guard l(lock);
+  _load();
+  uint64_t best = 0;
+  uint64_t best_dead = 0;
+  for (uint64_t z = first_seq_zone; z < zones.size(); ++z) {
+    auto& zs = zones[z];
+    // nor a zone with allocations whose writes are still to be submitted
+    if (_is_open(z) || zs.submitted < zs.written || zs.cleaning ||
+	!zs.written || zs.dead < zs.written * min_dead_ratio) {
+      continue;
+    }
+    if (zs.dead > best_dead) {
+      best = z;
+      best_dead = zs.dead;
+    }
+  }
+  if (!best_dead) {
+    return false;
+  }
+  // close the zone: what is left past the write pointer won't be written
+  auto& zs = zones[best];
+  uint64_t tail = _zone_len(best) - zs.written;
+  num_free -= tail;
+  zs.written += tail;
+  zs.submitted = zs.written;
+  zs.dead += tail;
+  zs.cleaning = true;
+  ldout(cct, 10) << __func__ << " zone " << best << " dead 0x" << std::hex
+		 << zs.dead << std::dec << dendl;
+  *zone = best;
+  return true;
+}
+
+bool ZonedAllocator::is_zone_dead(uint64_t zone)
+{
+  std::lock_guard l(lock);
+  ceph_assert(zone < zones.size());
+  return zones[zone].dead == zones[zone].written;
+}
+
+void ZonedAllocator::reset_zone(uint64_t zone)
+{
+  std::lock_guard l(lock);
+  auto& zs = zones[zone];
+  ceph_assert(zs.cleaning);
+  ceph_assert(zs.dead == zs.written);
+  ldout(cct, 10) << __func__ << " zone " << zone << dendl;
+  num_free += zs.written;
+  zs.written = 0;
+  zs.submitted = 0;
+  zs.dead = 0;
+  zs.cleaning = false;
+}
+
+void ZonedAllocator::stop_cleaning(uint64_t zone)
+{
+  std::lock_guard l(lock);
+  ldout(cct, 10) << __func__ << " zone " << zone << dendl;
+  zones[zone].cleaning = false;
+}
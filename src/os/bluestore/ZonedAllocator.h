@@ -0,0 +1,141 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_OS_BLUESTORE_ZONEDALLOCATOR_H
+#define CEPH_OS_BLUESTORE_ZONEDALLOCATOR_H
+
+#include <mutex>
+#include <vector>
+
+#include "Allocator.h"
+#include "common/ceph_mutex.h"
+
+/**
+ * Allocator for host managed zoned devices.
+ *
+ * Space is handed out at the allocation pointer of the zone open in a
+ * slot.  A writer takes a slot before its first allocation and gives it
+ * back once its writes are submitted, so the writes of a zone reach the
+ * device in the order of their allocations; the allocated space nobody
+ * wrote has to be filled before giving the slot back, see
+ * get_unsubmitted().  Released space is only counted as dead: it becomes
+ * free again when the cleaner has moved whatever is still live out of the
+ * zone and the zone has been reset.  Conventional zones at the start of
+ * the device are never handed out.
+ */
+class ZonedAllocator : public Allocator {
+  CephContext* cct;
+  ceph::mutex lock = ceph::make_mutex("ZonedAllocator::lock");
+
+  int64_t size;
+  int64_t block_size;
+  uint64_t zone_size;
+  uint64_t first_seq_zone;  ///< zones before are conventional
+
+  struct zone_state_t {
+    uint64_t written = 0;   ///< bytes before the allocation pointer
+    uint64_t submitted = 0; ///< bytes whose writes have been submitted
+    uint64_t dead = 0;      ///< released bytes before the allocation pointer
+    bool cleaning = false;  ///< closed for allocation by the cleaner
+
+    // only while loading the free space
+    uint64_t device_written = 0;
+    uint64_t init_free = 0;
+    uint64_t free_tail = 0; ///< where the free run up to the zone end starts
+  };
+  std::vector<zone_state_t> zones;
+
+  struct slot_t {
+    uint64_t zone;          ///< open zone, zones.size() if none
+    bool busy = false;      ///< taken by a writer
+    std::vector<uint64_t> touched; ///< zones allocated from while taken
+  };
+  std::vector<slot_t> slots;
+  ceph::condition_variable slot_cond;
+
+  uint64_t num_free = 0;    ///< bytes past the allocation pointers
+  bool loaded = false;
+
+  uint64_t _zone_of(uint64_t offset) const {
+    return offset / zone_size;
+  }
+  uint64_t _zone_start(uint64_t zone) const {
+    return zone * zone_size;
+  }
+  uint64_t _zone_len(uint64_t zone) const {
+    return std::min<uint64_t>(zone_size, size - _zone_start(zone));
+  }
+  /// turn what init_* collected into write pointers and dead space
+  void _load();
+  bool _is_open(uint64_t zone) const;
+  bool _open_zone(slot_t& slot, uint64_t alloc_unit);
+  int64_t _allocate(slot_t& slot, uint64_t want_size, uint64_t alloc_unit,
+		    uint64_t max_alloc_size, PExtentVector *extents);
+  void _put_slot(slot_t& slot);
+  /// call f(zone, offset, length) for each zone piece of offset~length
+  template <typename F>
+  void _for_each_zone(uint64_t offset, uint64_t length, F&& f);
+
+public:
+  ZonedAllocator(CephContext* cct, int64_t size, int64_t block_size,
+		 uint64_t zone_size, uint64_t first_seq_zone,
+		 const std::string& name);
+  ~ZonedAllocator() override;
+
+  /// from slot 0, for callers writing what they got right away
+  int64_t allocate(
+    uint64_t want_size, uint64_t alloc_unit, uint64_t max_alloc_size,
+    int64_t hint, PExtentVector *extents) override;
+
+  unsigned get_num_slots() const {
+    return slots.size();
+  }
+  /// wait for the slot to be free and take it
+  void get_slot(unsigned slot);
+  /// take the slot if free
+  bool try_get_slot(unsigned slot);
+  /// allocate from the zone open in a slot taken by the caller
+  int64_t allocate_in(
+    unsigned slot, uint64_t want_size, uint64_t alloc_unit,
+    uint64_t max_alloc_size, PExtentVector *extents);
+  /**
+   * the space allocated from the slot since it was taken, written or not:
+   * the part the caller did not write has to be written (with zeros)
+   * along with the rest, the device would refuse the writes past a hole
+   */
+  void get_unsubmitted(unsigned slot, interval_set<uint64_t> *ranges);
+  /// the writes of the allocations from the slot are submitted
+  void put_slot(unsigned slot);
+
+  void release(
+    const interval_set<uint64_t>& release_set) override;
+
+  uint64_t get_free() override;
+
+  void dump() override;
+  void dump(std::function<void(uint64_t offset, uint64_t length)> notify) override;
+
+  /// write pointers as the device reports them, before init_add_free()
+  void init_zones(const std::vector<uint64_t>& written);
+  void init_add_free(uint64_t offset, uint64_t length) override;
+  void init_rm_free(uint64_t offset, uint64_t length) override;
+
+  void shutdown() override;
+
+  uint64_t get_zone_size() const {
+    return zone_size;
+  }
+  /**
+   * pick the zone with the most dead space, if at least @p min_dead_ratio
+   * of what was written to it, and close it for further allocation
+   */
+  bool start_cleaning(double min_dead_ratio, uint64_t *zone);
+  /// true once nothing written to a zone being cleaned is live anymore
+  bool is_zone_dead(uint64_t zone);
+  /// the device zone has been reset, make its space free again
+  void reset_zone(uint64_t zone);
+  /// reopen a zone the cleaner gave up on
+  void stop_cleaning(uint64_t zone);
+};
+
+#endif
@@ -29,6 +29,12 @@ int aio_queue_t::submit_batch(aio_iter begin, aio_iter end,
   int left = 0;
   while (cur != end) {
     cur->priv = priv;
+#if defined(HAVE_LIBAIO)
+    if (cur->ioprio) {
+      cur->iocb.u.c.flags |= IOCB_FLAG_IOPRIO;
+      cur->iocb.aio_reqprio = cur->ioprio;
+    }
+#endif
     *(piocb+left) = &(*cur);
     ++left;
     ++cur;
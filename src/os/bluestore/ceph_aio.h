@@ -7,6 +7,9 @@
 
 #if defined(HAVE_LIBAIO)
 #include <libaio.h>
+#ifndef IOCB_FLAG_IOPRIO
+#define IOCB_FLAG_IOPRIO (1 << 1)
+#endif
 #elif defined(HAVE_POSIXAIO)
 #include <aio.h>
 #include <sys/event.h>
@@ -34,7 +37,9 @@ struct aio_t {
   boost::container::small_vector<iovec,4> iov;
   uint64_t offset, length;
   long rval;
+  uint16_t ioprio = 0;    ///< kernel io priority, 0 for the submitter's
   ceph::buffer::list bl;  ///< write payload (so that it remains stable for duration)
+  ceph::bufferptr copy_to; ///< reads into a registered buffer land here
 
   boost::intrusive::list_member_hook<> queue_item;
 
@@ -103,6 +108,17 @@ struct io_queue_t {
   virtual int submit_batch(aio_iter begin, aio_iter end, uint16_t aios_size,
 			   void *priv, int *retries) = 0;
   virtual int get_next_completed(int timeout_ms, aio_t **paio, int max) = 0;
+
+  /**
+   * allocate the destination buffer for a read of @len bytes
+   *
+   * @param registered set if the buffer belongs to the pool registered with
+   *        the kernel, it has to be copied out and released once read
+   */
+  virtual ceph::bufferptr create_read_buffer(uint64_t len, bool *registered) {
+    *registered = false;
+    return ceph::buffer::create_small_page_aligned(len);
+  }
 };
 
 struct aio_queue_t final : public io_queue_t {
@@ -8,10 +8,99 @@
 #include "liburing.h"
 #include <sys/epoll.h>
 
-/* Options */
+#include "include/buffer_raw.h"
+#include "include/intarith.h"
+
+/*
+ * Pool of read buffers registered with the ring (IORING_REGISTER_BUFFERS).
+ * The pages are pinned and mapped once at registration time, so reads
+ * landing in them are issued as READ_FIXED and skip the per-IO
+ * get_user_pages() work in the kernel.  The pool is shared with the
+ * bufferptrs handed out to callers, which may outlive the ring.
+ */
+struct ioring_buffer_pool {
+  char *base = nullptr;
+  uint64_t buffer_size;
+  unsigned num_buffers;
+
+  std::mutex lock;
+  std::vector<unsigned> free_buffers;
+
+  ioring_buffer_pool(unsigned n, uint64_t size)
+    : buffer_size(size), num_buffers(n) {
+    free_buffers.reserve(num_buffers);
+    for (unsigned i = num_buffers; i > 0; --i) {
+      free_buffers.push_back(i - 1);
+    }
+  }
+  ~ioring_buffer_pool() {
+    ::free(base);
+  }
+
+  int allocate() {
+    int r = ::posix_memalign((void**)&base, CEPH_PAGE_SIZE,
+			     buffer_size * num_buffers);
+    if (r) {
+      base = nullptr;
+      return -r;
+    }
+    return 0;
+  }
+
+  void get_iovecs(std::vector<iovec> *iovs) {
+    iovs->resize(num_buffers);
+    for (unsigned i = 0; i < num_buffers; ++i) {
+      (*iovs)[i].iov_base = base + i * buffer_size;
+      (*iovs)[i].iov_len = buffer_size;
+    }
+  }
+
+  /// buffer index if [p, p+len) lies within a single registered buffer
+  int find(const void *p, size_t len) const {
+    const char *c = static_cast<const char*>(p);
+    if (c < base || c >= base + buffer_size * num_buffers) {
+      return -1;
+    }
+    uint64_t off = c - base;
+    unsigned idx = off / buffer_size;
+    if (off + len > (uint64_t)(idx + 1) * buffer_size) {
+      return -1;
+    }
+    return idx;
+  }
 
-static bool hipri = false;      /* use IO polling */
-static bool sq_thread = false;  /* use kernel submission/poller thread */
+  int get() {
+    std::lock_guard l(lock);
+    if (free_buffers.empty()) {
+      return -1;
+    }
+    int idx = free_buffers.back();
+    free_buffers.pop_back();
+    return idx;
+  }
+  void put(unsigned idx) {
+    std::lock_guard l(lock);
+    free_buffers.push_back(idx);
+  }
+};
+
+class raw_ioring_registered : public ceph::buffer::raw {
+  std::shared_ptr<ioring_buffer_pool> pool;
+  unsigned idx;
+public:
+  raw_ioring_registered(std::shared_ptr<ioring_buffer_pool> p, unsigned i,
+			unsigned l)
+    : raw(p->base + i * p->buffer_size, l),
+      pool(std::move(p)),
+      idx(i) {
+  }
+  ~raw_ioring_registered() override {
+    pool->put(idx);
+  }
+  raw* clone_empty() override {
+    return ceph::buffer::create_page_aligned(len).release();
+  }
+};
 
 struct ioring_data {
   struct io_uring io_uring;
@@ -19,6 +108,7 @@ struct ioring_data {
   pthread_mutex_t sq_mutex;
   int epoll_fd = -1;
   std::map<int, int> fixed_fds_map;
+  std::shared_ptr<ioring_buffer_pool> buffer_pool;
 };
 
 static int ioring_get_cqe(struct ioring_data *d, unsigned int max,
@@ -59,15 +149,29 @@ static void init_sqe(struct ioring_data *d, struct io_uring_sqe *sqe,
 
   ceph_assert(fixed_fd != -1);
 
-  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV)
-    io_uring_prep_writev(sqe, fixed_fd, &io->iov[0],
-			 io->iov.size(), io->offset);
-  else if (io->iocb.aio_lio_opcode == IO_CMD_PREADV)
-    io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
-			io->iov.size(), io->offset);
-  else
+  int buf_index = -1;
+  if (d->buffer_pool && io->iov.size() == 1)
+    buf_index = d->buffer_pool->find(io->iov[0].iov_base,
+				     io->iov[0].iov_len);
+
+  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV) {
+    if (buf_index >= 0)
+      io_uring_prep_write_fixed(sqe, fixed_fd, io->iov[0].iov_base,
+				io->iov[0].iov_len, io->offset, buf_index);
+    else
+      io_uring_prep_writev(sqe, fixed_fd, &io->iov[0],
+			   io->iov.size(), io->offset);
+  } else if (io->iocb.aio_lio_opcode == IO_CMD_PREADV) {
+    if (buf_index >= 0)
+      io_uring_prep_read_fixed(sqe, fixed_fd, io->iov[0].iov_base,
+			       io->iov[0].iov_len, io->offset, buf_index);
+    else
+      io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
+			  io->iov.size(), io->offset);
+  } else
     ceph_assert(0);
 
+  sqe->ioprio = io->ioprio;
   io_uring_sqe_set_data(sqe, io);
   io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
 }
@@ -108,9 +212,16 @@ static void build_fixed_fds_map(struct ioring_data *d,
   }
 }
 
-ioring_queue_t::ioring_queue_t(unsigned iodepth_) :
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_,
+			       unsigned sq_thread_idle_ms_,
+			       unsigned num_buffers_, uint64_t buffer_size_) :
   d(make_unique<ioring_data>()),
-  iodepth(iodepth_)
+  iodepth(iodepth_),
+  hipri(hipri_),
+  sq_thread(sq_thread_),
+  sq_thread_idle_ms(sq_thread_idle_ms_),
+  num_buffers(num_buffers_),
+  buffer_size(p2roundup<uint64_t>(buffer_size_, CEPH_PAGE_SIZE))
 {
 }
 
@@ -118,22 +229,44 @@ ioring_queue_t::~ioring_queue_t()
 {
 }
 
+static void register_buffers(struct ioring_data *d, unsigned num_buffers,
+			     uint64_t buffer_size)
+{
+  auto pool = std::make_shared<ioring_buffer_pool>(num_buffers, buffer_size);
+  if (pool->allocate() < 0)
+    return;
+
+  std::vector<iovec> iovs;
+  pool->get_iovecs(&iovs);
+  /* Failing here (e.g. RLIMIT_MEMLOCK) only costs us the fast path */
+  if (io_uring_register_buffers(&d->io_uring, &iovs[0], iovs.size()) < 0)
+    return;
+
+  d->buffer_pool = std::move(pool);
+}
+
 int ioring_queue_t::init(std::vector<int> &fds)
 {
-  unsigned flags = 0;
+  struct io_uring_params p;
 
   pthread_mutex_init(&d->cq_mutex, NULL);
   pthread_mutex_init(&d->sq_mutex, NULL);
 
+  memset(&p, 0, sizeof(p));
   if (hipri)
-    flags |= IORING_SETUP_IOPOLL;
-  if (sq_thread)
-    flags |= IORING_SETUP_SQPOLL;
+    p.flags |= IORING_SETUP_IOPOLL;
+  if (sq_thread) {
+    p.flags |= IORING_SETUP_SQPOLL;
+    p.sq_thread_idle = sq_thread_idle_ms;
+  }
 
-  int ret = io_uring_queue_init(iodepth, &d->io_uring, flags);
+  int ret = io_uring_queue_init_params(iodepth, &d->io_uring, &p);
   if (ret < 0)
     return ret;
 
+  if (num_buffers && buffer_size)
+    register_buffers(d.get(), num_buffers, buffer_size);
+
   ret = io_uring_register(d->io_uring.ring_fd, IORING_REGISTER_FILES,
 			  &fds[0], fds.size());
   if (ret < 0) {
@@ -170,6 +303,8 @@ close_ring_fd:
 void ioring_queue_t::shutdown()
 {
   d->fixed_fds_map.clear();
+  /* Outstanding bufferptrs keep the pool memory alive */
+  d->buffer_pool.reset();
   close(d->epoll_fd);
   d->epoll_fd = -1;
   io_uring_queue_exit(&d->io_uring);
@@ -209,6 +344,23 @@ get_cqe:
   return events;
 }
 
+ceph::bufferptr ioring_queue_t::create_read_buffer(uint64_t len,
+						  bool *registered)
+{
+  auto& pool = d->buffer_pool;
+  *registered = false;
+  // small reads would waste most of a buffer
+  if (pool && len <= pool->buffer_size && len * 4 >= pool->buffer_size) {
+    int idx = pool->get();
+    if (idx >= 0) {
+      *registered = true;
+      return ceph::bufferptr(ceph::unique_leakable_ptr<ceph::buffer::raw>(
+	new raw_ioring_registered(pool, idx, len)));
+    }
+  }
+  return ceph::buffer::create_small_page_aligned(len);
+}
+
 bool ioring_queue_t::supported()
 {
   struct io_uring_params p;
@@ -227,7 +379,9 @@ bool ioring_queue_t::supported()
 
 struct ioring_data {};
 
-ioring_queue_t::ioring_queue_t(unsigned iodepth_)
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_,
+			       unsigned sq_thread_idle_ms_,
+			       unsigned num_buffers_, uint64_t buffer_size_)
 {
   ceph_assert(0);
 }
@@ -259,6 +413,12 @@ int ioring_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
   ceph_assert(0);
 }
 
+ceph::bufferptr ioring_queue_t::create_read_buffer(uint64_t len,
+						  bool *registered)
+{
+  ceph_assert(0);
+}
+
 bool ioring_queue_t::supported()
 {
   return false;
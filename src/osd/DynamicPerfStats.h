@@ -4,7 +4,8 @@
 #ifndef DYNAMIC_PERF_STATS_H
 #define DYNAMIC_PERF_STATS_H
 
-#include "include/random.h"
+#include <algorithm>
+
 #include "messages/MOSDOp.h"
 #include "mgr/OSDPerfMetricTypes.h"
 #include "osd/OSD.h"
@@ -12,19 +13,24 @@
 
 class DynamicPerfStats {
 public:
+  /// keys kept per reported one by a query with limits
+  static constexpr size_t KEYS_PER_RESULT = 10;
+
   DynamicPerfStats() {
   }
 
-  DynamicPerfStats(const std::list<OSDPerfMetricQuery> &queries) {
-    for (auto &query : queries) {
-      data[query];
+  DynamicPerfStats(
+      const std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> &queries) {
+    for (auto &[query, limits] : queries) {
+      data[query].set_limits(query, limits);
     }
   }
 
   void merge(const DynamicPerfStats &dps) {
     for (auto &query_it : dps.data) {
       auto &query = query_it.first;
-      for (auto &key_it : query_it.second) {
+      auto &stats = data[query];
+      for (auto &key_it : query_it.second.counters) {
         auto &key = key_it.first;
         auto counter_it = key_it.second.begin();
         auto update_counter_fnc =
@@ -35,17 +41,20 @@ public:
               counter_it++;
             };
 
-        ceph_assert(key_it.second.size() >= data[query][key].size());
-        query.update_counters(update_counter_fnc, &data[query][key]);
+        auto counters = stats.get_counters(key);
+        ceph_assert(key_it.second.size() >= counters->size());
+        query.update_counters(update_counter_fnc, counters);
       }
     }
   }
 
-  void set_queries(const std::list<OSDPerfMetricQuery> &queries) {
-    std::map<OSDPerfMetricQuery,
-             std::map<OSDPerfMetricKey, PerformanceCounters>> new_data;
-    for (auto &query : queries) {
-      std::swap(new_data[query], data[query]);
+  void set_queries(
+      const std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> &queries) {
+    std::map<OSDPerfMetricQuery, QueryStats> new_data;
+    for (auto &[query, limits] : queries) {
+      auto &stats = new_data[query];
+      std::swap(stats, data[query]);
+      stats.set_limits(query, limits);
     }
     std::swap(data, new_data);
   }
@@ -163,7 +172,7 @@ public:
       auto &query = it.first;
       OSDPerfMetricKey key;
       if (query.get_key(get_subkey_fnc, &key)) {
-        query.update_counters(update_counter_fnc, &it.second[key]);
+        query.update_counters(update_counter_fnc, it.second.get_counters(key));
       }
     }
   }
@@ -178,7 +187,7 @@ public:
         continue;
       }
       auto &query_limits = limit_it->second;
-      auto &counters = it.second;
+      auto &counters = it.second.counters;
       auto &report = (*reports)[query];
 
       query.get_performance_counter_descriptors(
@@ -207,31 +216,25 @@ public:
           continue;
         }
 
-        // Weighted Random Sampling (Algorithm A-Chao):
-        // Select the first [0, max_count) samples, randomly replace
-        // with samples from [max_count, end) using weighted
-        // probability, and return [0, max_count) as the result.
-
+        // the heaviest max_count keys
         ceph_assert(limit.max_count < counters.size());
         typedef std::map<OSDPerfMetricKey, PerformanceCounters>::iterator
             Iterator;
         std::vector<Iterator> counter_iterators;
-        counter_iterators.reserve(limit.max_count);
-
-        Iterator it_counters = counters.begin();
-        uint64_t wsum = 0;
-        for (size_t i = 0; i < limit.max_count; i++) {
-          wsum += it_counters->second[index].first;
-          counter_iterators.push_back(it_counters++);
-        }
-        for (; it_counters != counters.end(); it_counters++) {
-          wsum += it_counters->second[index].first;
-          if (ceph::util::generate_random_number(0, wsum) <=
-              it_counters->second[index].first) {
-            auto i = ceph::util::generate_random_number(0, limit.max_count - 1);
-            counter_iterators[i] = it_counters;
-          }
+        counter_iterators.reserve(counters.size());
+        for (auto it_counters = counters.begin(); it_counters != counters.end();
+             it_counters++) {
+          counter_iterators.push_back(it_counters);
         }
+        std::nth_element(
+            counter_iterators.begin(),
+            counter_iterators.begin() + limit.max_count,
+            counter_iterators.end(),
+            [index](const Iterator &a, const Iterator &b) {
+              return get_weight(a->second, index) >
+                  get_weight(b->second, index);
+            });
+        counter_iterators.resize(limit.max_count);
 
         for (auto it_counters : counter_iterators) {
           auto &bl =
@@ -245,6 +248,71 @@ public:
   }
 
 private:
+  static uint64_t get_weight(const PerformanceCounters &counters,
+                             size_t index) {
+    return index < counters.size() ? counters[index].first : 0;
+  }
+
+  /**
+   * The counters of a query by key.  The keys of a query with limits are
+   * bounded to KEYS_PER_RESULT times the keys it reports, with the
+   * Space-Saving algorithm: a new key takes the place of the lightest one
+   * by the counter of the first limit, and inherits that counter, so that
+   * it is overestimated by at most what the lightest key had.  Any key
+   * weighing more than the total over the number of keys kept is so
+   * sure to be kept, whatever the number of keys seen.
+   */
+  struct QueryStats {
+    size_t max_keys = 0;     ///< 0 for no bound
+    size_t weight_index = 0; ///< the counter the keys are weighed by
+    std::map<OSDPerfMetricKey, PerformanceCounters> counters;
+
+    void set_limits(const OSDPerfMetricQuery &query,
+                    const OSDPerfMetricLimits &limits) {
+      max_keys = 0;
+      weight_index = 0;
+      if (limits.empty()) {
+        return;
+      }
+      auto &descriptors = query.performance_counter_descriptors;
+      auto d = std::find(descriptors.begin(), descriptors.end(),
+                         limits.begin()->order_by);
+      if (d == descriptors.end()) {
+        return;
+      }
+      weight_index = d - descriptors.begin();
+      for (auto &limit : limits) {
+        max_keys = std::max<size_t>(max_keys,
+                                    limit.max_count * KEYS_PER_RESULT);
+      }
+    }
+
+    PerformanceCounters *get_counters(const OSDPerfMetricKey &key) {
+      auto it = counters.find(key);
+      if (it != counters.end()) {
+        return &it->second;
+      }
+      if (!max_keys || counters.size() < max_keys) {
+        return &counters[key];
+      }
+      auto lightest = std::min_element(
+          counters.begin(), counters.end(),
+          [this](auto &a, auto &b) {
+            return get_weight(a.second, weight_index) <
+                get_weight(b.second, weight_index);
+          });
+      PerformanceCounter weight;
+      if (weight_index < lightest->second.size()) {
+        weight = lightest->second[weight_index];
+      }
+      counters.erase(lightest);
+      auto &c = counters[key];
+      c.resize(weight_index + 1);
+      c[weight_index] = weight;
+      return &c;
+    }
+  };
+
   static bool is_limited(const OSDPerfMetricLimits &limits,
                          size_t counters_size) {
     if (limits.empty()) {
@@ -260,8 +328,7 @@ private:
     return true;
   }
 
-  std::map<OSDPerfMetricQuery,
-           std::map<OSDPerfMetricKey, PerformanceCounters>> data;
+  std::map<OSDPerfMetricQuery, QueryStats> data;
 };
 
 #endif // DYNAMIC_PERF_STATS_H
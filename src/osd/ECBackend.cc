@@ -59,15 +59,9 @@ struct ECRecoveryHandle : public PGBackend::RecoveryHandle {
 };
 
 ostream &operator<<(ostream &lhs, const ECBackend::pipeline_state_t &rhs) {
-  switch (rhs.pipeline_state) {
-  case ECBackend::pipeline_state_t::CACHE_VALID:
+  if (rhs.invalid.empty())
     return lhs << "CACHE_VALID";
-  case ECBackend::pipeline_state_t::CACHE_INVALID:
-    return lhs << "CACHE_INVALID";
-  default:
-    ceph_abort_msg("invalid pipeline state");
-  }
-  return lhs; // unreachable
+  return lhs << "CACHE_INVALID(" << rhs.invalid << ")";
 }
 
 static ostream &operator<<(ostream &lhs, const map<pg_shard_t, bufferlist> &rhs)
@@ -1035,24 +1029,21 @@ void ECBackend::handle_sub_read(
         dout(25) << __func__ << " case2: going to do fragmented read." << dendl;
         int subchunk_size =
           sinfo.get_chunk_size() / ec_impl->get_sub_chunk_count();
-        bool error = false;
-        for (int m = 0; m < (int)j->get<1>() && !error;
+        // the same sub-chunks of every chunk in the extent, in one go
+        interval_set<uint64_t> fragments;
+        for (int m = 0; m < (int)j->get<1>();
              m += sinfo.get_chunk_size()) {
           for (auto &&k:op.subchunks.find(i->first)->second) {
-            bufferlist bl0;
-            r = store->read(
-                ch,
-                ghobject_t(i->first, ghobject_t::NO_GEN, shard),
+            fragments.insert(
                 j->get<0>() + m + (k.first)*subchunk_size,
-                (k.second)*subchunk_size,
-                bl0, j->get<2>());
-            if (r < 0) {
-              error = true;
-              break;
-            }
-            bl.claim_append(bl0);
+                (k.second)*subchunk_size);
           }
         }
+        r = store->readv(
+            ch,
+            ghobject_t(i->first, ghobject_t::NO_GEN, shard),
+            fragments,
+            bl, j->get<2>());
       }
 
       if (r < 0) {
@@ -1676,6 +1667,16 @@ int ECBackend::get_remaining_shards(
     return -EIO;
   }
 
+  if (ec_impl->get_sub_chunk_count() > 1) {
+    // the sub-chunks read so far were picked for the shards we had, and
+    // most likely are not the ones the new set needs: read it all again
+    for (auto &&p : need) {
+      ceph_assert(shards.count(shard_id_t(p.first)));
+      to_read->insert(make_pair(shards[shard_id_t(p.first)], p.second));
+    }
+    return 0;
+  }
+
   set<int> shards_left;
   for (auto p : need) {
     if (avail.find(p.first) == avail.end()) {
@@ -1887,7 +1888,7 @@ bool ECBackend::try_state_to_reads()
     return false;
 
   Op *op = &(waiting_state.front());
-  if (op->requires_rmw() && pipeline_state.cache_invalid()) {
+  if (op->requires_rmw() && pipeline_state.cache_invalid(*op)) {
     ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
     dout(20) << __func__ << ": blocking " << *op
 	     << " because it requires an rmw and the cache is invalid "
@@ -1896,12 +1897,13 @@ bool ECBackend::try_state_to_reads()
     return false;
   }
 
-  if (!pipeline_state.caching_enabled()) {
+  if (!pipeline_state.caching_enabled(*op)) {
     op->using_cache = false;
+    pipeline_state.invalidate(*op);
   } else if (op->invalidates_cache()) {
     dout(20) << __func__ << ": invalidating cache after this op"
 	     << dendl;
-    pipeline_state.invalidate();
+    pipeline_state.invalidate(*op);
   }
 
   waiting_state.pop_front();
@@ -2155,6 +2157,9 @@ bool ECBackend::try_finish_rmw()
   if (op->using_cache) {
     cache.release_write_pin(op->pin);
   }
+  if (!op->using_cache || op->invalidates_cache()) {
+    pipeline_state.release(*op);
+  }
   tid_to_op_map.erase(op->tid);
 
   if (waiting_reads.empty() &&
@@ -2196,6 +2201,7 @@ void ECBackend::objects_read_async(
 
   uint32_t flags = 0;
   extent_set es;
+  set<int> data_chunks;
   for (list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
 	 pair<bufferlist*, Context*> > >::const_iterator i =
 	 to_read.begin();
@@ -2207,6 +2213,19 @@ void ECBackend::objects_read_async(
 
     es.union_insert(tmp.first, tmp.second);
     flags |= i->first.get<2>();
+    sinfo.offset_len_to_data_chunks(
+      make_pair(i->first.get<0>(), i->first.get<1>()), &data_chunks);
+  }
+
+  // reads within part of a stripe only need the data shards holding them
+  map<hobject_t, set<int>> want_to_read;
+  if (cct->_conf.get_val<bool>("osd_ec_partial_reads") &&
+      data_chunks.size() < ec_impl->get_data_chunk_count()) {
+    const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+    auto &want = want_to_read[hoid];
+    for (auto i : data_chunks) {
+      want.insert((int)chunk_mapping.size() > i ? chunk_mapping[i] : i);
+    }
   }
 
   if (!es.empty()) {
@@ -2300,7 +2319,8 @@ void ECBackend::objects_read_async(
 	cb(this,
 	   hoid,
 	   to_read,
-	   on_complete)));
+	   on_complete)),
+    want_to_read);
 }
 
 struct CallClientContexts :
@@ -2309,12 +2329,14 @@ struct CallClientContexts :
   ECBackend *ec;
   ECBackend::ClientAsyncReadStatus *status;
   list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+  set<int> want;  ///< data shards to decode, empty for whole stripes
   CallClientContexts(
     hobject_t hoid,
     ECBackend *ec,
     ECBackend::ClientAsyncReadStatus *status,
-    const list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read)
-    : hoid(hoid), ec(ec), status(status), to_read(to_read) {}
+    const list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
+    const set<int> &want)
+    : hoid(hoid), ec(ec), status(status), to_read(to_read), want(want) {}
   void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
     ECBackend::read_result_t &res = in.second;
     extent_map result;
@@ -2336,11 +2358,21 @@ struct CallClientContexts :
 	   ++j) {
 	to_decode[j->first.shard].claim(j->second);
       }
-      int r = ECUtil::decode(
-	ec->sinfo,
-	ec->ec_impl,
-	to_decode,
-	&bl);
+      int r;
+      if (want.empty()) {
+	r = ECUtil::decode(
+	  ec->sinfo,
+	  ec->ec_impl,
+	  to_decode,
+	  &bl);
+      } else {
+	r = ECUtil::decode(
+	  ec->sinfo,
+	  ec->ec_impl,
+	  want,
+	  to_decode,
+	  &bl);
+      }
       if (r < 0) {
         res.r = r;
         goto out;
@@ -2366,7 +2398,8 @@ void ECBackend::objects_read_and_reconstruct(
     std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
   > &reads,
   bool fast_read,
-  GenContextURef<map<hobject_t,pair<int, extent_map> > &&> &&func)
+  GenContextURef<map<hobject_t,pair<int, extent_map> > &&> &&func,
+  const map<hobject_t, set<int>> &want_to_read)
 {
   in_progress_client_reads.emplace_back(
     reads.size(), std::move(func));
@@ -2376,15 +2409,18 @@ void ECBackend::objects_read_and_reconstruct(
   }
 
   map<hobject_t, set<int>> obj_want_to_read;
-  set<int> want_to_read;
-  get_want_to_read_shards(&want_to_read);
+  set<int> all_data_shards;
+  get_want_to_read_shards(&all_data_shards);
     
   map<hobject_t, read_request_t> for_read_op;
   for (auto &&to_read: reads) {
+    auto partial = want_to_read.find(to_read.first);
+    const set<int> &want = partial != want_to_read.end() ?
+      partial->second : all_data_shards;
     map<pg_shard_t, vector<pair<int, int>>> shards;
     int r = get_min_avail_to_read_shards(
       to_read.first,
-      want_to_read,
+      want,
       false,
       fast_read,
       &shards);
@@ -2394,7 +2430,8 @@ void ECBackend::objects_read_and_reconstruct(
       to_read.first,
       this,
       &(in_progress_client_reads.back()),
-      to_read.second);
+      to_read.second,
+      partial != want_to_read.end() ? partial->second : set<int>());
     for_read_op.insert(
       make_pair(
 	to_read.first,
@@ -2403,7 +2440,7 @@ void ECBackend::objects_read_and_reconstruct(
 	  shards,
 	  false,
 	  c)));
-    obj_want_to_read.insert(make_pair(to_read.first, want_to_read));
+    obj_want_to_read.insert(make_pair(to_read.first, want));
   }
 
   start_read_op(
@@ -2444,6 +2481,13 @@ int ECBackend::send_all_remaining_reads(
     dout(10) << __func__ << " want attrs again" << dendl;
   }
 
+  if (ec_impl->get_sub_chunk_count() > 1) {
+    // decode must only see the shards of the new set, as read for it
+    for (auto &&i : rop.complete[hoid].returned) {
+      i.get<2>().clear();
+    }
+  }
+
   rop.to_read.erase(hoid);
   rop.to_read.insert(make_pair(
       hoid,
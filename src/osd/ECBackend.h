@@ -135,12 +135,17 @@ public:
    * still only perform a client read from shards in the acting std::set.  This
    * ensures that we won't ever have to restart a client initiated read in
    * check_recovery_sources.
+   *
+   * Reads of an object present in want_to_read only need its listed data
+   * shards; the other data chunks of the returned stripes are zeroed.
+   * Objects not in it are read in full stripes.
    */
   void objects_read_and_reconstruct(
     const std::map<hobject_t, std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
     > &reads,
     bool fast_read,
-    GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func);
+    GenContextURef<std::map<hobject_t,std::pair<int, extent_map> > &&> &&func,
+    const std::map<hobject_t, std::set<int>> &want_to_read = {});
 
   friend struct CallClientContexts;
   struct ClientAsyncReadStatus {
@@ -537,23 +542,42 @@ public:
    * versioned.  We can't assign versions to them until we actually
    * submit the operation.  That's probably going to be the hard part.
    */
+  /**
+   * The cache is tracked per object: an op that invalidates it (or that
+   * started on an object whose cache was already invalid and so bypassed
+   * it) only blocks the rmw writes to the objects it touches until it
+   * completes, rather than every rmw write in the pg until the pipeline
+   * drains.  A blocked write still blocks the writes behind it.
+   */
   class pipeline_state_t {
-    enum {
-      CACHE_VALID = 0,
-      CACHE_INVALID = 1
-    } pipeline_state = CACHE_VALID;
+    /// objects -> in-flight ops that invalidated or bypassed their cache
+    std::map<hobject_t, unsigned> invalid;
   public:
-    bool caching_enabled() const {
-      return pipeline_state == CACHE_VALID;
+    bool caching_enabled(const Op &op) const {
+      for (auto &&i : op.plan.hash_infos) {
+	if (invalid.count(i.first))
+	  return false;
+      }
+      return true;
     }
-    bool cache_invalid() const {
-      return !caching_enabled();
+    bool cache_invalid(const Op &op) const {
+      return !caching_enabled(op);
     }
-    void invalidate() {
-      pipeline_state = CACHE_INVALID;
+    void invalidate(const Op &op) {
+      for (auto &&i : op.plan.hash_infos) {
+	++invalid[i.first];
+      }
+    }
+    void release(const Op &op) {
+      for (auto &&i : op.plan.hash_infos) {
+	auto p = invalid.find(i.first);
+	ceph_assert(p != invalid.end());
+	if (--p->second == 0)
+	  invalid.erase(p);
+      }
     }
     void clear() {
-      pipeline_state = CACHE_VALID;
+      invalid.clear();
     }
     friend ostream &operator<<(ostream &lhs, const pipeline_state_t &rhs);
   } pipeline_state;
@@ -120,6 +120,49 @@ int ECUtil::decode(
   return 0;
 }
 
+int ECUtil::decode(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const set<int> &want,
+  map<int, bufferlist> &to_decode,
+  bufferlist *out) {
+  ceph_assert(to_decode.size());
+  ceph_assert(want.size());
+
+  uint64_t total_data_size = to_decode.begin()->second.length();
+  ceph_assert(total_data_size % sinfo.get_chunk_size() == 0);
+
+  ceph_assert(out);
+  ceph_assert(out->length() == 0);
+
+  for (auto &&i : to_decode) {
+    ceph_assert(i.second.length() == total_data_size);
+  }
+
+  const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+  unsigned k = ec_impl->get_data_chunk_count();
+  for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
+    map<int, bufferlist> chunks;
+    for (auto &&j : to_decode) {
+      chunks[j.first].substr_of(j.second, i, sinfo.get_chunk_size());
+    }
+    map<int, bufferlist> decoded;
+    int r = ec_impl->decode(want, chunks, &decoded, sinfo.get_chunk_size());
+    if (r < 0)
+      return r;
+    for (unsigned j = 0; j < k; ++j) {
+      int chunk = chunk_mapping.size() > j ? chunk_mapping[j] : (int)j;
+      if (want.count(chunk)) {
+	ceph_assert(decoded[chunk].length() == sinfo.get_chunk_size());
+	out->claim_append(decoded[chunk]);
+      } else {
+	out->append_zero(sinfo.get_chunk_size());
+      }
+    }
+  }
+  return 0;
+}
+
 int ECUtil::encode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
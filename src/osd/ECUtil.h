@@ -77,6 +77,27 @@ public:
       (in.first - off) + in.second);
     return std::make_pair(off, len);
   }
+  /// positions (0 .. k-1) of the data chunks holding logical off~len
+  void offset_len_to_data_chunks(
+    std::pair<uint64_t, uint64_t> in,
+    std::set<int> *out) const {
+    uint64_t k = stripe_width / chunk_size;
+    if (in.second == 0) {
+      return;
+    }
+    uint64_t last = in.first + in.second - 1;
+    uint64_t first_chunk = in.first / chunk_size;
+    uint64_t last_chunk = last / chunk_size;
+    if (last_chunk - first_chunk + 1 >= k) {
+      for (uint64_t i = 0; i < k; ++i) {
+	out->insert(i);
+      }
+      return;
+    }
+    for (uint64_t i = first_chunk; i <= last_chunk; ++i) {
+      out->insert(i % k);
+    }
+  }
 };
 
 int decode(
@@ -91,6 +112,15 @@ int decode(
   std::map<int, ceph::buffer::list> &to_decode,
   std::map<int, ceph::buffer::list*> &out);
 
+/// decode the data chunks in want only; the other data chunks of each
+/// stripe are left zeroed in out
+int decode(
+  const stripe_info_t &sinfo,
+  ceph::ErasureCodeInterfaceRef &ec_impl,
+  const std::set<int> &want,
+  std::map<int, ceph::buffer::list> &to_decode,
+  ceph::buffer::list *out);
+
 int encode(
   const stripe_info_t &sinfo,
   ceph::ErasureCodeInterfaceRef &ec_impl,
@@ -40,6 +40,7 @@
 #include "include/types.h"
 #include "include/compat.h"
 #include "include/random.h"
+#include "include/scope_guard.h"
 
 #include "OSD.h"
 #include "OSDMap.h"
@@ -2215,6 +2216,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  op_tracker.set_sample_rate(
+    cct->_conf.get_val<uint64_t>("osd_op_tracker_sample_rate"));
   ObjectCleanRegions::set_max_num_intervals(cct->_conf->osd_object_clean_region_max_num_intervals);
 #ifdef WITH_BLKIN
   std::stringstream ss;
@@ -4140,6 +4143,7 @@ int OSD::shutdown()
 
   osd_op_tp.drain();
   osd_op_tp.stop();
+  op_shardedwq.remove_inline_workers();
   dout(10) << "op sharded tp stopped" << dendl;
 
   dout(10) << "stopping agent" << dendl;
@@ -5396,6 +5400,8 @@ void OSD::handle_osd_ping(MOSDPing *m)
                      << " and older pending ping(s)"
                      << dendl;
 
+	    i->second.add_acked(now);
+
 #define ROUND_S_TO_USEC(sec) (uint32_t)((sec) * 1000 * 1000 + 0.5)
 	    ++i->second.hb_average_count;
 	    uint32_t back_pingtime = ROUND_S_TO_USEC(i->second.last_rx_back - m->ping_stamp);
@@ -5604,10 +5610,34 @@ void OSD::heartbeat_entry()
   }
 }
 
+double OSD::HeartbeatInfo::get_phi(utime_t now) const
+{
+  if (acked_intervals.size() < PHI_MIN_SAMPLES) {
+    return -1;
+  }
+  double sum = 0, sq = 0;
+  for (auto i : acked_intervals) {
+    sum += i;
+    sq += i * i;
+  }
+  double n = acked_intervals.size();
+  double mean = sum / n;
+  // the pings are sent at random intervals, the floor keeps a run of
+  // regular replies from making the detector jumpy
+  double stddev = std::max(std::sqrt(std::max(0.0, sq / n - mean * mean)),
+			   mean / 4);
+  double elapsed = now - last_acked;
+  // the probability of a reply coming later still, with the intervals
+  // normally distributed
+  double p_later = 0.5 * std::erfc((elapsed - mean) / (stddev * M_SQRT2));
+  return -std::log10(std::max(p_later, 1e-300));
+}
+
 void OSD::heartbeat_check()
 {
   ceph_assert(ceph_mutex_is_locked(heartbeat_lock));
   utime_t now = ceph_clock_now();
+  double phi_threshold = cct->_conf.get_val<double>("osd_heartbeat_phi_threshold");
 
   // check for incoming heartbeats (move me elsewhere?)
   for (map<int,HeartbeatInfo>::iterator p = heartbeat_peers.begin();
@@ -5626,8 +5656,21 @@ void OSD::heartbeat_check()
 	     << " last_rx_back " << p->second.last_rx_back
 	     << " last_rx_front " << p->second.last_rx_front
 	     << dendl;
-    if (p->second.is_unhealthy(now)) {
-      utime_t oldest_deadline = p->second.ping_history.begin()->second.first;
+    bool failed;
+    double phi = phi_threshold > 0 ? p->second.get_phi(now) : -1;
+    if (phi >= 0) {
+      failed = phi > phi_threshold;
+      if (failed) {
+	derr << "heartbeat_check: phi of osd." << p->first << " is " << phi
+	     << " > " << phi_threshold << ", last reply " << p->second.last_acked
+	     << dendl;
+      }
+    } else {
+      failed = p->second.is_unhealthy(now);
+    }
+    if (failed) {
+      utime_t oldest_deadline = p->second.ping_history.empty() ? utime_t() :
+	p->second.ping_history.begin()->second.first;
       if (p->second.last_rx_back == utime_t() ||
 	  p->second.last_rx_front == utime_t()) {
         derr << "heartbeat_check: no reply from "
@@ -7086,10 +7129,12 @@ void OSD::ms_fast_dispatch(Message *m)
   if (m->get_connection()->has_features(CEPH_FEATUREMASK_RESEND_ON_SPLIT) ||
       m->get_type() != CEPH_MSG_OSD_OP) {
     // queue it directly
+    const spg_t pgid = static_cast<MOSDFastDispatchOp*>(m)->get_spg();
     enqueue_op(
-      static_cast<MOSDFastDispatchOp*>(m)->get_spg(),
+      pgid,
       std::move(op),
       static_cast<MOSDFastDispatchOp*>(m)->get_map_epoch());
+    op_shardedwq.maybe_run_inline(pgid);
   } else {
     // legacy client, and this is an MOSDOp (the *only* fast dispatch
     // message that didn't have an explicit spg_t); we need to map
@@ -7459,6 +7504,7 @@ void OSD::sched_scrub()
   bool time_permit = scrub_time_permit(now);
   bool load_is_low = scrub_load_below_threshold();
   dout(20) << "sched_scrub load_is_low=" << (int)load_is_low << dendl;
+  bool auto_schedule = cct->_conf.get_val<bool>("osd_scrub_auto_schedule");
 
   OSDService::ScrubJob scrub;
   if (service.first_scrub_stamp(&scrub)) {
@@ -7495,6 +7541,13 @@ void OSD::sched_scrub()
                  << dendl;
         continue;
       }
+      // Periodic scrubs are left to whoever requests them instead
+      if (!auto_schedule && !pg->get_must_scrub() && !pg->scrubber.need_auto) {
+	pg->unlock();
+	dout(20) << __func__ << " skip " << scrub.pgid
+		 << " because it was not requested" << dendl;
+	continue;
+      }
       // If it is reserving, let it resolve before going to the next scrub job
       if (pg->scrubber.local_reserved && !pg->scrubber.active) {
 	pg->unlock();
@@ -7906,14 +7959,27 @@ void OSD::handle_osd_map(MOSDMap *m)
 
       OSDMap *o = new OSDMap;
       if (e > 1) {
-	bufferlist obl;
-        bool got = get_map_bl(e - 1, obl);
-	if (!got) {
-	  auto p = added_maps_bl.find(e - 1);
-	  ceph_assert(p != added_maps_bl.end());
-	  obl = p->second;
+	// start from the previous map in memory if we have it: a copy
+	// shares crush and the addrs and is far cheaper than decoding the
+	// full map again for every incremental
+	OSDMapRef prev;
+	if (auto q = added_maps.find(e - 1); q != added_maps.end()) {
+	  prev = q->second;
+	} else if (auto cur = get_osdmap(); cur && cur->get_epoch() == e - 1) {
+	  prev = cur;
+	}
+	if (prev) {
+	  o->deepish_copy_from(*prev);
+	} else {
+	  bufferlist obl;
+	  bool got = get_map_bl(e - 1, obl);
+	  if (!got) {
+	    auto p = added_maps_bl.find(e - 1);
+	    ceph_assert(p != added_maps_bl.end());
+	    obl = p->second;
+	  }
+	  o->decode(obl);
 	}
-	o->decode(obl);
       }
 
       OSDMap::Incremental inc;
@@ -8455,6 +8521,9 @@ bool OSD::advance_pg(
 
   unsigned old_pg_num = lastmap->have_pg_pool(pg->pg_id.pool()) ?
     lastmap->get_pg_num(pg->pg_id.pool()) : 0;
+  const bool skip_maps = cct->_conf.get_val<bool>("osd_pg_advance_skip_maps");
+  OSDMapRef prevmap = lastmap;  // the map before nextmap, even if skipped
+  epoch_t skipped = 0;
   for (epoch_t next_epoch = pg->get_osdmap_epoch() + 1;
        next_epoch <= osd_epoch;
        ++next_epoch) {
@@ -8464,6 +8533,27 @@ bool OSD::advance_pg(
       continue;
     }
 
+    // skip a map if neither it nor the next one matters to the pg, so
+    // that whatever does is still seen against the map right before it
+    if (skip_maps &&
+	next_epoch < osd_epoch &&
+	prevmap->get_epoch() + 1 == next_epoch &&
+	pg->can_skip_map(*prevmap, *nextmap)) {
+      OSDMapRef peekmap = service.try_get_map(next_epoch + 1);
+      if (peekmap && pg->can_skip_map(*nextmap, *peekmap)) {
+	prevmap = nextmap;
+	++skipped;
+	handle.reset_tp_timeout();
+	continue;
+      }
+    }
+    prevmap = nextmap;
+    if (skipped) {
+      dout(20) << __func__ << " " << pg->pg_id << " skipped " << skipped
+	       << " maps up to " << next_epoch << dendl;
+      skipped = 0;
+    }
+
     unsigned new_pg_num =
       (old_pg_num && nextmap->have_pg_pool(pg->pg_id.pool())) ?
       nextmap->get_pg_num(pg->pg_id.pool()) : 0;
@@ -9388,11 +9478,18 @@ void OSDService::queue_check_readable(spg_t spgid,
 void OSDService::_maybe_queue_recovery() {
   ceph_assert(ceph_mutex_is_locked_by_me(recovery_lock));
   uint64_t available_pushes;
+  const bool share = cct->_conf.get_val<bool>(
+    "osd_recovery_share_available_pushes");
   while (!awaiting_throttle.empty() &&
 	 _recover_now(&available_pushes)) {
-    uint64_t to_start = std::min(
-      available_pushes,
-      cct->_conf->osd_recovery_max_single_start);
+    uint64_t to_start = cct->_conf->osd_recovery_max_single_start;
+    if (share) {
+      // hand what no other pg is waiting for to the ones that are, so
+      // that their objects go out together in one push or pull message
+      to_start = std::max<uint64_t>(
+	to_start, available_pushes / awaiting_throttle.size());
+    }
+    to_start = std::min(available_pushes, to_start);
     _queue_for_recovery(awaiting_throttle.front(), to_start);
     awaiting_throttle.pop_front();
     dout(10) << __func__ << " starting " << to_start
@@ -9745,6 +9842,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_op_history_slow_op_size",
     "osd_op_history_slow_op_threshold",
     "osd_enable_op_tracker",
+    "osd_op_tracker_sample_rate",
     "osd_map_cache_size",
     "osd_pg_epoch_max_lag_factor",
     "osd_pg_epoch_persisted_max_stale",
@@ -9805,6 +9903,10 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
+  if (changed.count("osd_op_tracker_sample_rate")) {
+    op_tracker.set_sample_rate(
+      cct->_conf.get_val<uint64_t>("osd_op_tracker_sample_rate"));
+  }
   if (changed.count("osd_map_cache_size")) {
     service.map_cache.set_size(cct->_conf->osd_map_cache_size);
     service.map_bl_cache.set_size(cct->_conf->osd_map_cache_size);
@@ -9923,11 +10025,11 @@ void OSD::set_perf_queries(const ConfigPayload &config_payload) {
   const std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> &queries = osd_config_payload.config;
   dout(10) << "setting " << queries.size() << " queries" << dendl;
 
-  std::list<OSDPerfMetricQuery> supported_queries;
+  std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> supported_queries;
   for (auto &it : queries) {
     auto &query = it.first;
     if (!query.key_descriptor.empty()) {
-      supported_queries.push_back(query);
+      supported_queries.insert(it);
     }
   }
   if (supported_queries.size() < queries.size()) {
@@ -9953,7 +10055,8 @@ MetricPayload OSD::get_perf_reports() {
 
   std::vector<PGRef> pgs;
   _get_pgs(&pgs);
-  DynamicPerfStats dps;
+  // bounded like those of the pgs, not to hold the keys of all of them
+  DynamicPerfStats dps(m_perf_queries);
   for (auto& pg : pgs) {
     // m_perf_queries can be modified only in set_perf_queries by mgr client
     // request, and it is protected by by mgr client's lock, which is held
@@ -10379,7 +10482,8 @@ OSDShard::OSDShard(
     osdmap_lock{make_mutex(shard_name + "::osdmap_lock")},
     shard_lock_name(shard_name + "::shard_lock"),
     shard_lock{make_mutex(shard_lock_name)},
-    scheduler(ceph::osd::scheduler::make_scheduler(cct)),
+    scheduler(ceph::osd::scheduler::make_scheduler(
+      cct, [osd] { return osd->store->get_cost_per_io(); })),
     context_queue(sdata_wait_lock, sdata_cond)
 {
   dout(0) << "using op scheduler " << *scheduler << dendl;
@@ -10416,10 +10520,89 @@ void OSD::ShardedOpWQ::_add_slot_waiter(
 #undef dout_prefix
 #define dout_prefix *_dout << "osd." << osd->whoami << " op_wq(" << shard_index << ") "
 
+OSDShard *OSD::ShardedOpWQ::_steal(uint32_t shard_index)
+{
+  for (uint32_t i = 1; i < osd->num_shards; ++i) {
+    OSDShard *s = osd->shards[(shard_index + i) % osd->num_shards];
+    if (s->stealers.load() >= steal_max_per_shard) {
+      continue;
+    }
+    // never wait on another shard, it is busy by definition
+    if (!s->shard_lock.try_lock()) {
+      continue;
+    }
+    if (!s->scheduler->empty()) {
+      if (s->stealers.fetch_add(1) < steal_max_per_shard) {
+	return s;
+      }
+      // lost the race for the last stealer slot
+      --s->stealers;
+    }
+    s->shard_lock.unlock();
+  }
+  return nullptr;
+}
+
+void OSD::ShardedOpWQ::_wake_stealer(OSDShard *sdata, uint32_t shard_index)
+{
+  if (sdata->stealers.load() >= steal_max_per_shard) {
+    return;
+  }
+  for (uint32_t i = 1; i < osd->num_shards; ++i) {
+    OSDShard *s = osd->shards[(shard_index + i) % osd->num_shards];
+    if (s->idle_waiters.load()) {
+      // it looks for a backlogged shard once woken
+      std::lock_guard l{s->sdata_wait_lock};
+      s->sdata_cond.notify_one();
+      return;
+    }
+  }
+}
+
+namespace {
+// set while a messenger thread runs an item, see maybe_run_inline()
+thread_local bool in_inline_run = false;
+}
+
+void OSD::ShardedOpWQ::maybe_run_inline(spg_t pgid)
+{
+  if (!run_to_completion || osd->is_stopping()) {
+    return;
+  }
+  heartbeat_handle_d *hb;
+  {
+    std::lock_guard l{inline_hb_lock};
+    auto& h = inline_hbs[pthread_self()];
+    if (!h) {
+      h = osd->cct->get_heartbeat_map()->add_worker(
+	"OSD::run_to_completion", pthread_self());
+    }
+    hb = h;
+  }
+  // the item taken is the next one of the shard, which may not be ours,
+  // but the shard threads are not woken for nothing.  a thread index past
+  // the shard threads' keeps the oncommits with the shard's own thread.
+  uint32_t shard_index = pgid.hash_to_shard(osd->shards.size());
+  in_inline_run = true;
+  _process(shard_index + osd->num_shards, hb);
+  in_inline_run = false;
+  osd->cct->get_heartbeat_map()->clear_timeout(hb);
+  osd->logger->inc(l_osd_op_wq_run_inline);
+}
+
+void OSD::ShardedOpWQ::remove_inline_workers()
+{
+  std::lock_guard l{inline_hb_lock};
+  for (auto& [thread, hb] : inline_hbs) {
+    osd->cct->get_heartbeat_map()->remove_worker(hb);
+  }
+  inline_hbs.clear();
+}
+
 void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
 {
   uint32_t shard_index = thread_index % osd->num_shards;
-  auto& sdata = osd->shards[shard_index];
+  OSDShard *sdata = osd->shards[shard_index];
   ceph_assert(sdata);
 
   // If all threads of shards do oncommits, there is a out-of-order
@@ -10428,19 +10611,65 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   // callback.
   bool is_smallest_thread_index = thread_index < osd->num_shards;
 
+  // with a polled-mode store this thread owns a device queue and has to
+  // reap its own completions
+  // (not a messenger thread running an item, it would not come back to poll)
+  static thread_local bool inline_poll =
+    !in_inline_run && osd->store->enable_inline_poll();
+  unsigned io_inflight = inline_poll ? osd->store->poll_completions() : 0;
+
   // peek at spg_t
   sdata->shard_lock.lock();
+  OSDShard *stolen_from = nullptr;
+  if (steal_max_per_shard && osd->num_shards > 1 && !in_inline_run &&
+      sdata->scheduler->empty() &&
+      (!is_smallest_thread_index || sdata->context_queue.empty())) {
+    // Idle: take an item from a shard with a backlog instead.  The item
+    // goes through that shard's pg slot like any other, which keeps its
+    // pg's ops in order; oncommits stay with the shard's own thread.
+    sdata->shard_lock.unlock();
+    stolen_from = _steal(shard_index);
+    if (stolen_from) {
+      dout(20) << __func__ << " shard " << shard_index << " helping shard "
+	       << stolen_from->shard_id << dendl;
+      sdata = stolen_from;
+      is_smallest_thread_index = false;
+      osd->logger->inc(l_osd_op_wq_stolen);
+    } else {
+      sdata->shard_lock.lock();
+    }
+  }
+  auto steal_done = make_scope_guard([stolen_from] {
+    if (stolen_from) {
+      --stolen_from->stealers;
+    }
+  });
   if (sdata->scheduler->empty() &&
       (!is_smallest_thread_index || sdata->context_queue.empty())) {
+    if (in_inline_run) {
+      // a shard thread took the item first
+      sdata->shard_lock.unlock();
+      return;
+    }
     std::unique_lock wait_lock{sdata->sdata_wait_lock};
     if (is_smallest_thread_index && !sdata->context_queue.empty()) {
       // we raced with a context_queue addition, don't wait
       wait_lock.unlock();
+    } else if (io_inflight) {
+      // keep polling our own I/O rather than sleeping on it
+      dout(30) << __func__ << " empty q, " << io_inflight
+	       << " ios in flight" << dendl;
+      wait_lock.unlock();
+      sdata->shard_lock.unlock();
+      return;
     } else if (!sdata->stop_waiting) {
       dout(20) << __func__ << " empty q, waiting" << dendl;
       osd->cct->get_heartbeat_map()->clear_timeout(hb);
       sdata->shard_lock.unlock();
+      // under sdata_wait_lock, so that _wake_stealer() can't miss us
+      ++sdata->idle_waiters;
       sdata->sdata_cond.wait(wait_lock);
+      --sdata->idle_waiters;
       wait_lock.unlock();
       sdata->shard_lock.lock();
       if (sdata->scheduler->empty() &&
@@ -10730,6 +10959,9 @@ void OSD::ShardedOpWQ::_enqueue(OpSchedulerItem&& item) {
   if (empty) {
     std::lock_guard l{sdata->sdata_wait_lock};
     sdata->sdata_cond.notify_all();
+  } else if (steal_max_per_shard && osd->num_shards > 1) {
+    // a backlog is building up
+    _wake_stealer(sdata, shard_index);
   }
 }
 
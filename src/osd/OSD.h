@@ -1020,6 +1020,11 @@ struct OSDShard {
   /// priority queue
   ceph::osd::scheduler::OpSchedulerRef scheduler;
 
+  /// threads of other shards currently working on our queue
+  std::atomic<unsigned> stealers = {0};
+  /// our threads waiting on sdata_cond for want of work
+  std::atomic<unsigned> idle_waiters = {0};
+
   bool stop_waiting = false;
 
   ContextQueue context_queue;
@@ -1392,6 +1397,28 @@ private:
     std::vector<uint32_t> hb_front_min;
     std::vector<uint32_t> hb_front_max;
 
+    /// intervals between complete ping replies, for the phi accrual
+    /// failure detector, see osd_heartbeat_phi_threshold
+    static constexpr size_t PHI_WINDOW = 100;
+    static constexpr size_t PHI_MIN_SAMPLES = 10;
+    utime_t last_acked;
+    std::deque<double> acked_intervals;
+
+    void add_acked(utime_t now) {
+      if (last_acked != utime_t()) {
+	acked_intervals.push_back(now - last_acked);
+	if (acked_intervals.size() > PHI_WINDOW) {
+	  acked_intervals.pop_front();
+	}
+      }
+      last_acked = now;
+    }
+
+    /// the suspicion that the peer is down, from how unlikely it is to go
+    /// that long without a reply given the past intervals; -1 without
+    /// enough samples
+    double get_phi(utime_t now) const;
+
     bool is_stale(utime_t stale) {
       if (ping_history.empty()) {
         return false;
@@ -1570,6 +1597,20 @@ protected:
     : public ShardedThreadPool::ShardedWQ<OpSchedulerItem>
   {
     OSD *osd;
+    /// idle threads help shards with fewer than this many stealers
+    const unsigned steal_max_per_shard;
+
+    /// pick a backlogged shard to take an item from, returned locked
+    OSDShard *_steal(uint32_t shard_index);
+    /// wake an idle thread of another shard to help the backlogged one
+    void _wake_stealer(OSDShard *sdata, uint32_t shard_index);
+
+    /// the messenger thread queueing an op runs an item of its shard
+    const bool run_to_completion;
+    /// the heartbeat handles of the messenger threads running items
+    ceph::mutex inline_hb_lock =
+      ceph::make_mutex("OSD::ShardedOpWQ::inline_hb_lock");
+    std::map<pthread_t, ceph::heartbeat_handle_d*> inline_hbs;
 
   public:
     ShardedOpWQ(OSD *o,
@@ -1577,7 +1618,11 @@ protected:
 		time_t si,
 		ShardedThreadPool* tp)
       : ShardedThreadPool::ShardedWQ<OpSchedulerItem>(ti, si, tp),
-        osd(o) {
+        osd(o),
+	steal_max_per_shard(
+	  o->cct->_conf.get_val<uint64_t>("osd_op_steal_max_per_shard")),
+	run_to_completion(
+	  o->cct->_conf.get_val<bool>("osd_op_run_to_completion")) {
     }
 
     void _add_slot_waiter(
@@ -1594,6 +1639,13 @@ protected:
     /// requeue an old item (at the front of the line)
     void _enqueue_front(OpSchedulerItem&& item) override;
 
+    /// with osd_op_run_to_completion, process an item of the shard of the
+    /// pg on the calling (messenger) thread
+    void maybe_run_inline(spg_t pgid);
+
+    /// drop the heartbeat handles of the messenger threads
+    void remove_inline_workers();
+
     void return_waiting_threads() override {
       for(uint32_t i = 0; i < osd->num_shards; i++) {
 	OSDShard* sdata = osd->shards[i];
@@ -2070,7 +2122,7 @@ private:
   MetricPayload get_perf_reports();
 
   ceph::mutex m_perf_queries_lock = ceph::make_mutex("OSD::m_perf_queries_lock");
-  std::list<OSDPerfMetricQuery> m_perf_queries;
+  std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> m_perf_queries;
   std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> m_perf_limits;
 };
 
@@ -1362,6 +1362,76 @@ void OSDMap::get_blacklist(std::set<entity_addr_t> *bl) const
   }
 }
 
+bool OSDMap::CrushResultCache::lookup(const key_t& key,
+				      vector<int> *osds) const
+{
+  std::shared_lock l{lock};
+  auto p = results.find(key);
+  if (p == results.end()) {
+    return false;
+  }
+  osds->assign(p->second.begin(), p->second.end());
+  return true;
+}
+
+void OSDMap::CrushResultCache::insert(const key_t& key,
+				      const vector<int>& osds)
+{
+  std::unique_lock l{lock};
+  if (results.size() >= max_entries) {
+    results.clear();
+  }
+  results[key].assign(osds.begin(), osds.end());
+}
+
+void OSDMap::set_crush_cache_size(size_t entries)
+{
+  if (entries) {
+    crush_cache = std::make_shared<CrushResultCache>(entries);
+  } else {
+    crush_cache.reset();
+  }
+}
+
+void OSDMap::_invalidate_crush_cache(const set<int>& osds)
+{
+  set<int> rules;
+  for (int rule = 0; rule < crush->get_max_rules(); ++rule) {
+    if (!crush->rule_exists(rule)) {
+      continue;
+    }
+    set<int> roots;
+    crush->find_takes_by_rule(rule, &roots);
+    for (auto root : roots) {
+      set<int> reachable;
+      if (root >= 0) {
+	reachable.insert(root);
+      } else {
+	crush->get_all_children(root, &reachable);
+      }
+      if (std::any_of(osds.begin(), osds.end(),
+		      [&](int osd) { return reachable.count(osd); })) {
+	rules.insert(rule);
+	break;
+      }
+    }
+  }
+  if (rules.empty()) {
+    return;
+  }
+  // maps sharing the old cache still have the old weights
+  auto cache = std::make_shared<CrushResultCache>(crush_cache->max_entries);
+  {
+    std::shared_lock l{crush_cache->lock};
+    for (auto& [key, result] : crush_cache->results) {
+      if (!rules.count(key.rule)) {
+	cache->results.emplace(key, result);
+      }
+    }
+  }
+  crush_cache = std::move(cache);
+}
+
 void OSDMap::set_max_osd(int m)
 {
   int o = max_osd;
@@ -2117,7 +2187,11 @@ int OSDMap::apply_incremental(const Incremental &inc)
     pool_name.erase(pool);
   }
 
+  set<int> reweighted;
   for (const auto &weight : inc.new_weight) {
+    if (crush_cache && osd_weight[weight.first] != weight.second) {
+      reweighted.insert(weight.first);
+    }
     set_weight(weight.first, weight.second);
 
     // if we are marking in, clear the AUTOOUT and NEW bits, and clear
@@ -2294,6 +2368,15 @@ int OSDMap::apply_incremental(const Incremental &inc)
       flags |= CEPH_OSDMAP_PGLOG_HARDLIMIT;
     }
   }
+  if (crush_cache) {
+    if (inc.crush.length() || inc.new_max_osd >= 0) {
+      crush_cache = std::make_shared<CrushResultCache>(
+	crush_cache->max_entries);
+    } else if (!reweighted.empty()) {
+      _invalidate_crush_cache(reweighted);
+    }
+  }
+
   // do new crush map last (after up/down stuff)
   if (inc.crush.length()) {
     ceph::buffer::list bl(inc.crush);
@@ -2403,8 +2486,17 @@ void OSDMap::_pg_to_raw_osds(
 
   // what crush rule?
   int ruleno = crush->find_rule(pool.get_crush_rule(), pool.get_type(), size);
-  if (ruleno >= 0)
-    crush->do_rule(ruleno, pps, *osds, size, osd_weight, pg.pool());
+  if (ruleno >= 0) {
+    if (crush_cache) {
+      CrushResultCache::key_t key{pg.pool(), ruleno, pps, size};
+      if (!crush_cache->lookup(key, osds)) {
+	crush->do_rule(ruleno, pps, *osds, size, osd_weight, pg.pool());
+	crush_cache->insert(key, *osds);
+      }
+    } else {
+      crush->do_rule(ruleno, pps, *osds, size, osd_weight, pg.pool());
+    }
+  }
 
   _remove_nonexistent_osds(pool, *osds);
 
@@ -3411,6 +3503,10 @@ void OSDMap::post_decode()
 
   calc_num_osds();
   _calc_up_osd_features();
+
+  if (crush_cache) {
+    crush_cache = std::make_shared<CrushResultCache>(crush_cache->max_entries);
+  }
 }
 
 void OSDMap::dump_erasure_code_profiles(
@@ -4631,7 +4727,7 @@ int OSDMap::calc_pg_upmaps(
   }
   float stddev = 0;
   map<int,float> osd_deviation;       // osd, deviation(pgs)
-  multimap<float,int> deviation_osd;  // deviation(pgs), osd
+  set<pair<float,int>> deviation_osd;  // deviation(pgs), osd
   float cur_max_deviation = 0;
   for (auto& i : pgs_by_osd) {
     // make sure osd is still there (belongs to this crush-tree)
@@ -4655,13 +4751,28 @@ int OSDMap::calc_pg_upmaps(
                    << dendl;
     return 0;
   }
+  // pgs with an upmap pair moving them off each osd
+  map<int,set<pg_t>> upmaps_by_from;
+  for (auto& i : tmp.pg_upmap_items) {
+    if (!only_pools.empty() && !only_pools.count(i.first.pool()))
+      continue;
+    for (auto& j : i.second)
+      upmaps_by_from[j.first].insert(i.first);
+  }
   bool skip_overfull = false;
   auto aggressive =
     cct->_conf.get_val<bool>("osd_calc_pg_upmaps_aggressively");
   auto local_fallback_retries =
     cct->_conf.get_val<uint64_t>("osd_calc_pg_upmaps_local_fallback_retries");
+  auto max_time = cct->_conf.get_val<double>("osd_calc_pg_upmaps_max_time");
+  auto deadline = ceph::mono_clock::now() + ceph::make_timespan(max_time);
   while (max--) {
     ldout(cct, 30) << "Top of loop #" << max+1 << dendl;
+    if (max_time > 0 && ceph::mono_clock::now() >= deadline) {
+      ldout(cct, 10) << __func__ << " out of time after " << num_changed
+		     << " changes" << dendl;
+      break;
+    }
     // build overfull and underfull
     set<int> overfull;
     set<int> more_overfull;
@@ -4711,7 +4822,7 @@ int OSDMap::calc_pg_upmaps(
 
     set<pg_t> to_unmap;
     map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>> to_upmap;
-    auto temp_pgs_by_osd = pgs_by_osd;
+    vector<std::tuple<pg_t,int,int>> moves;  // pg, from osd, to osd
     // always start with fullest, break if we find any changes to make
     for (auto p = deviation_osd.rbegin(); p != deviation_osd.rend(); ++p) {
       if (skip_overfull && !underfull.empty()) {
@@ -4768,8 +4879,7 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " into overfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[q.second].erase(pg);
-            temp_pgs_by_osd[q.first].insert(pg);
+            moves.emplace_back(pg, q.second, q.first);
           } else {
             new_upmap_items.push_back(q);
           }
@@ -4861,8 +4971,7 @@ int OSDMap::calc_pg_upmaps(
                          << dendl;
           existing.insert(orig[i]);
           existing.insert(out[i]);
-          temp_pgs_by_osd[orig[i]].erase(pg);
-          temp_pgs_by_osd[out[i]].insert(pg);
+          moves.emplace_back(pg, orig[i], out[i]);
           ceph_assert(new_upmap_items.size() < (size_t)pg_pool_size);
           new_upmap_items.push_back(make_pair(orig[i], out[i]));
           // append new remapping pairs slowly
@@ -4899,13 +5008,14 @@ int OSDMap::calc_pg_upmaps(
       // look for remaps we can un-remap
       vector<pair<pg_t,
         mempool::osdmap::vector<pair<int32_t,int32_t>>>> candidates;
-      candidates.reserve(tmp.pg_upmap_items.size());
-      for (auto& i : tmp.pg_upmap_items) {
-        if (to_skip.count(i.first))
-          continue;
-        if (!only_pools.empty() && !only_pools.count(i.first.pool()))
-          continue;
-        candidates.push_back(make_pair(i.first, i.second));
+      if (auto from = upmaps_by_from.find(osd);
+	  from != upmaps_by_from.end()) {
+        candidates.reserve(from->second.size());
+        for (auto& pg : from->second) {
+          if (to_skip.count(pg))
+            continue;
+          candidates.push_back(make_pair(pg, tmp.pg_upmap_items.at(pg)));
+        }
       }
       if (aggressive) {
         // shuffle candidates so they all get equal (in)attention
@@ -4924,8 +5034,7 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " out from underfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[j.second].erase(pg);
-            temp_pgs_by_osd[j.first].insert(pg);
+            moves.emplace_back(pg, j.second, j.first);
           } else {
             new_upmap_items.push_back(j);
           }
@@ -4975,26 +5084,46 @@ int OSDMap::calc_pg_upmaps(
 
     // test change, apply if change is good
     ceph_assert(to_unmap.size() || to_upmap.size());
-    float new_stddev = 0;
+    // only the osds the change moves pgs between need a new deviation
+    map<int,int> pg_delta;
+    for (auto& [pg, from, to] : moves) {
+      --pg_delta[from];
+      ++pg_delta[to];
+    }
+    float new_stddev = stddev;
     map<int,float> temp_osd_deviation;
-    multimap<float,int> temp_deviation_osd;
     float cur_max_deviation = 0;
-    for (auto& i : temp_pgs_by_osd) {
+    for (auto& [osd, delta] : pg_delta) {
+      if (!delta)
+        continue;
       // make sure osd is still there (belongs to this crush-tree)
-      ceph_assert(osd_weight.count(i.first));
-      float target = osd_weight[i.first] * pgs_per_weight;
-      float deviation = (float)i.second.size() - target;
-      ldout(cct, 20) << " osd." << i.first
-                     << "\tpgs " << i.second.size()
+      ceph_assert(osd_weight.count(osd));
+      float target = osd_weight[osd] * pgs_per_weight;
+      int pgs = (int)pgs_by_osd[osd].size() + delta;
+      float deviation = (float)pgs - target;
+      ldout(cct, 20) << " osd." << osd
+                     << "\tpgs " << pgs
                      << "\ttarget " << target
                      << "\tdeviation " << deviation
                      << dendl;
-      temp_osd_deviation[i.first] = deviation;
-      temp_deviation_osd.insert(make_pair(deviation, i.first));
-       new_stddev += deviation * deviation;
+      temp_osd_deviation[osd] = deviation;
+      new_stddev += deviation * deviation - osd_deviation[osd] * osd_deviation[osd];
       if (fabsf(deviation) > cur_max_deviation)
         cur_max_deviation = fabsf(deviation);
     }
+    // and the extremes of the others
+    for (auto p = deviation_osd.begin(); p != deviation_osd.end(); ++p) {
+      if (!temp_osd_deviation.count(p->second)) {
+        cur_max_deviation = std::max(cur_max_deviation, fabsf(p->first));
+        break;
+      }
+    }
+    for (auto p = deviation_osd.rbegin(); p != deviation_osd.rend(); ++p) {
+      if (!temp_osd_deviation.count(p->second)) {
+        cur_max_deviation = std::max(cur_max_deviation, fabsf(p->first));
+        break;
+      }
+    }
     ldout(cct, 10) << " stddev " << stddev << " -> " << new_stddev << dendl;
     if (new_stddev >= stddev) {
       if (!aggressive) {
@@ -5027,12 +5156,20 @@ int OSDMap::calc_pg_upmaps(
     // ready to go
     ceph_assert(new_stddev < stddev);
     stddev = new_stddev;
-    pgs_by_osd = temp_pgs_by_osd;
-    osd_deviation = temp_osd_deviation;
-    deviation_osd = temp_deviation_osd;
+    for (auto& [pg, from, to] : moves) {
+      pgs_by_osd[from].erase(pg);
+      pgs_by_osd[to].insert(pg);
+    }
+    for (auto& [osd, deviation] : temp_osd_deviation) {
+      deviation_osd.erase(make_pair(osd_deviation[osd], osd));
+      deviation_osd.insert(make_pair(deviation, osd));
+      osd_deviation[osd] = deviation;
+    }
     for (auto& i : to_unmap) {
       ldout(cct, 10) << " unmap pg " << i << dendl;
       ceph_assert(tmp.pg_upmap_items.count(i));
+      for (auto& j : tmp.pg_upmap_items[i])
+        upmaps_by_from[j.first].erase(i);
       tmp.pg_upmap_items.erase(i);
       pending_inc->old_pg_upmap_items.insert(i);
       ++num_changed;
@@ -5041,7 +5178,12 @@ int OSDMap::calc_pg_upmaps(
       ldout(cct, 10) << " upmap pg " << i.first
                      << " new pg_upmap_items " << i.second
                      << dendl;
-      tmp.pg_upmap_items[i.first] = i.second;
+      auto& items = tmp.pg_upmap_items[i.first];
+      for (auto& j : items)
+        upmaps_by_from[j.first].erase(i.first);
+      for (auto& j : i.second)
+        upmaps_by_from[j.first].insert(i.first);
+      items = i.second;
       pending_inc->new_pg_upmap_items[i.first] = i.second;
       ++num_changed;
     }
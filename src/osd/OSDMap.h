@@ -34,6 +34,7 @@
 #include "include/btree_map.h"
 #include "include/common_fwd.h"
 #include "include/types.h"
+#include "common/ceph_mutex.h"
 #include "common/ceph_releases.h"
 #include "osd_types.h"
 
@@ -616,6 +617,49 @@ private:
 private:
   uint32_t crush_version = 1;
 
+  /**
+   * raw crush results by pool, rule, placement seed and size
+   *
+   * Shared between copies of the map as long as their crush map and osd
+   * weights are the same; apply_incremental() switches to a new cache
+   * without the rules a change may affect rather than modifying this one.
+   */
+  struct CrushResultCache {
+    struct key_t {
+      int64_t pool;
+      int32_t rule;
+      uint32_t pps;
+      uint32_t size;
+      bool operator==(const key_t& o) const {
+	return pool == o.pool && rule == o.rule && pps == o.pps &&
+	  size == o.size;
+      }
+    };
+    struct key_hash {
+      size_t operator()(const key_t& k) const {
+	return std::hash<uint64_t>()(
+	  ((uint64_t)k.pps << 32 | (uint64_t)k.rule << 8 | k.size) ^
+	  ((uint64_t)k.pool * 0x9e3779b97f4a7c15ull));
+      }
+    };
+
+    const size_t max_entries;
+    mutable ceph::shared_mutex lock =
+      ceph::make_shared_mutex("OSDMap::CrushResultCache::lock");
+    mempool::osdmap::unordered_map<key_t, mempool::osdmap::vector<int32_t>,
+				   key_hash> results;
+
+    explicit CrushResultCache(size_t max_entries)
+      : max_entries(max_entries) {}
+
+    bool lookup(const key_t& key, std::vector<int> *osds) const;
+    void insert(const key_t& key, const std::vector<int>& osds);
+  };
+  std::shared_ptr<CrushResultCache> crush_cache;
+
+  /// forget the cached results of rules that can reach any of @p osds
+  void _invalidate_crush_cache(const std::set<int>& osds);
+
   friend class OSDMonitor;
 
  public:
@@ -755,6 +799,14 @@ public:
     ceph_assert(o < max_osd);
     osd_state[o] = s;
   }
+  /**
+   * keep up to @p entries raw crush results across epochs, 0 to disable
+   *
+   * The cache follows apply_incremental() and decode(); the crush map and
+   * osd weights of a map with a cache must not be modified otherwise.
+   */
+  void set_crush_cache_size(size_t entries);
+
   void set_weight(int o, unsigned w) {
     ceph_assert(o < max_osd);
     osd_weight[o] = w;
@@ -59,6 +59,155 @@ void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
 }
 
+void OSDMapMapping::note_incremental(const OSDMap& osdmap,
+				     const OSDMap::Incremental& inc,
+				     Changes *changes) const
+{
+  if (changes->all) {
+    return;
+  }
+  // anything that can make crush choose an osd it did not choose before
+  // may move any pg
+  if (inc.fullmap.length() || inc.crush.length() || inc.new_max_osd >= 0 ||
+      !inc.new_up_client.empty()) {
+    changes->all = true;
+    return;
+  }
+  for (auto& p : inc.new_pools) {
+    changes->pools.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_temp) {
+    changes->pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    changes->pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    changes->pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap_items) {
+    changes->pgs.insert(p.first);
+  }
+  changes->pgs.insert(inc.old_pg_upmap.begin(), inc.old_pg_upmap.end());
+  changes->pgs.insert(inc.old_pg_upmap_items.begin(),
+		      inc.old_pg_upmap_items.end());
+
+  // osds that can only leave the pgs they are mapped to: these pgs have
+  // them in their up or acting set here...
+  std::vector<bool> leaving;
+  // ...unless they are down already, then crush still chose them for pgs
+  // that are now missing a member
+  bool check_degraded = false;
+  auto leave = [&](int osd) {
+    if (osd >= 0 && osd < osdmap.get_max_osd()) {
+      leaving.resize(osdmap.get_max_osd());
+      leaving[osd] = true;
+    }
+  };
+  for (auto& [osd, state] : inc.new_state) {
+    uint32_t s = state ? state : CEPH_OSD_UP;
+    if (s & CEPH_OSD_EXISTS) {
+      changes->all = true;
+      return;
+    }
+    if (s & CEPH_OSD_UP) {
+      if (osdmap.is_up(osd)) {
+	changes->all = true;
+	return;
+      }
+      leave(osd);
+    }
+  }
+  bool marked_out = false;
+  for (auto& [osd, weight] : inc.new_weight) {
+    if (weight != CEPH_OSD_OUT) {
+      changes->all = true;
+      return;
+    }
+    leave(osd);
+    marked_out = true;
+    if (!osdmap.is_up(osd)) {
+      check_degraded = true;
+    }
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    leave(p.first);
+  }
+  if (marked_out) {
+    // upmaps to or from an out osd are ignored
+    std::vector<pg_t> upmap_pgs;
+    osdmap.get_upmap_pgs(&upmap_pgs);
+    changes->pgs.insert(upmap_pgs.begin(), upmap_pgs.end());
+  }
+  if (leaving.empty() && !check_degraded) {
+    return;
+  }
+
+  auto mapped = [&](int32_t osd) {
+    return osd >= 0 && (size_t)osd < leaving.size() && leaving[osd];
+  };
+  for (auto& [poolid, pm] : pools) {
+    if (changes->pools.count(poolid)) {
+      continue;
+    }
+    for (unsigned ps = 0; ps < pm.pg_num; ++ps) {
+      const int32_t *row = &pm.table[pm.row_size() * ps];
+      const int32_t *acting = row + 4;
+      const int32_t *up = row + 4 + pm.size;
+      bool hit = check_degraded && (unsigned)row[3] < pm.size;
+      for (int i = 0; !hit && i < row[3]; ++i) {
+	hit = mapped(up[i]) || (check_degraded && up[i] == CRUSH_ITEM_NONE);
+      }
+      for (int i = 0; !hit && i < row[2]; ++i) {
+	hit = mapped(acting[i]);
+      }
+      if (hit) {
+	changes->pgs.insert(pg_t(ps, poolid));
+      }
+    }
+  }
+}
+
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& map,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item,
+  const Changes& changes)
+{
+  if (changes.all || !changes.base || changes.base != epoch ||
+      map.get_pools().empty()) {
+    return start_update(map, mapper, pgs_per_item);
+  }
+  std::vector<pg_t> pgs;
+  std::set<int64_t> whole;
+  for (auto& [poolid, pool] : map.get_pools()) {
+    auto q = pools.find(poolid);
+    if (changes.pools.count(poolid) || q == pools.end() ||
+	q->second.pg_num != pool.get_pg_num() ||
+	q->second.size != pool.get_size()) {
+      whole.insert(poolid);
+      for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+	pgs.emplace_back(ps, poolid);
+      }
+    }
+  }
+  for (auto& pg : changes.pgs) {
+    auto p = map.get_pools().find(pg.pool());
+    if (p == map.get_pools().end() || whole.count(pg.pool()) ||
+	pg.ps() >= p->second.get_pg_num()) {
+      continue;
+    }
+    pgs.push_back(pg);
+  }
+  if (pgs.empty()) {
+    // nothing can have moved, but let the job complete the usual way
+    pgs.emplace_back(0, map.get_pools().begin()->first);
+  }
+  std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
+  mapper.queue(job.get(), pgs_per_item, pgs);
+  return job;
+}
+
 void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 {
   acting_rmap.resize(osdmap.get_max_osd());
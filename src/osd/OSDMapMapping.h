@@ -9,6 +9,7 @@
 #include <map>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
@@ -275,7 +276,11 @@ private:
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
-    void process(const std::vector<pg_t>& pgs) override {}
+    void process(const std::vector<pg_t>& pgs) override {
+      for (auto& pg : pgs) {
+	mapping->_update_range(*osdmap, pg.pool(), pg.ps(), pg.ps() + 1);
+      }
+    }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -285,6 +290,24 @@ private:
   };
 
 public:
+  /**
+   * what the incrementals applied since a mapping was built may have
+   * remapped, so that the next update only recomputes those pgs
+   */
+  struct Changes {
+    epoch_t base = 0;  ///< epoch of the mapping these are relative to
+    bool all = false;
+    std::set<int64_t> pools;
+    std::set<pg_t> pgs;
+
+    void reset(epoch_t e) {
+      base = e;
+      all = false;
+      pools.clear();
+      pgs.clear();
+    }
+  };
+
   void get(pg_t pgid,
 	   std::vector<int> *up,
 	   int *up_primary,
@@ -334,6 +357,22 @@ public:
     mapper.queue(job.get(), pgs_per_item, {});
     return job;
   }
+  /// recompute only what @p changes says may have moved, if they are
+  /// relative to this mapping; everything otherwise
+  std::unique_ptr<MappingJob> start_update(
+    const OSDMap& map,
+    ParallelPGMapper& mapper,
+    unsigned pgs_per_item,
+    const Changes& changes);
+
+  /**
+   * add the pgs that @p inc may have remapped to @p changes
+   *
+   * @param osdmap the map right after applying @p inc
+   */
+  void note_incremental(const OSDMap& osdmap,
+			const OSDMap::Incremental& inc,
+			Changes *changes) const;
 
   epoch_t get_epoch() const {
     return epoch;
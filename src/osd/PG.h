@@ -188,6 +188,10 @@ public:
     return recovery_state.get_current_state();
   }
 
+  bool can_skip_map(const OSDMap &lastmap, const OSDMap &osdmap) const {
+    return recovery_state.can_skip_map(lastmap, osdmap);
+  }
+
   const OSDMapRef& get_osdmap() const {
     ceph_assert(is_locked());
     return recovery_state.get_osdmap();
@@ -554,7 +558,7 @@ public:
   void _delete_some(ObjectStore::Transaction *t);
 
   virtual void set_dynamic_perf_stats_queries(
-    const std::list<OSDPerfMetricQuery> &queries) {
+    const std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> &queries) {
   }
   virtual void get_dynamic_perf_stats(DynamicPerfStats *stats) {
   }
@@ -772,6 +776,10 @@ public:
 protected:
   BackfillInterval backfill_info;
   std::map<pg_shard_t, BackfillInterval> peer_backfill_info;
+  /// intervals the backfill targets scanned ahead of peer_backfill_info
+  std::map<pg_shard_t, BackfillInterval> peer_backfill_prefetch;
+  /// where the scans ahead still in flight start
+  std::map<pg_shard_t, hobject_t> prefetching_backfill;
   bool backfill_reserving;
 
   // The primary's num_bytes and local num_bytes for this pg, only valid
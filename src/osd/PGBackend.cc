@@ -593,6 +593,21 @@ int PGBackend::be_scan_list(
   ceph_assert(pos.pos < pos.ls.size());
   hobject_t& poid = pos.ls[pos.pos];
 
+  // let the store load the metadata of the objects a batch ahead
+  constexpr size_t prefetch_batch = 32;
+  if (pos.pos % prefetch_batch == 0) {
+    vector<ghobject_t> next;
+    size_t from = pos.pos ? pos.pos + prefetch_batch : 0;
+    size_t to = std::min(pos.ls.size(), pos.pos + 2 * prefetch_batch);
+    for (size_t i = from; i < to; ++i) {
+      next.emplace_back(
+	pos.ls[i], ghobject_t::NO_GEN, get_parent()->whoami_shard().shard);
+    }
+    if (!next.empty()) {
+      store->prefetch(ch, next);
+    }
+  }
+
   struct stat st;
   int r = store->stat(
     ch,
@@ -176,6 +176,8 @@ void PGLog::clear() {
   log.clear();
   log_keys_debug.clear();
   undirty();
+  written_can_rollback_to = eversion_t::max();
+  written_rollback_info_trimmed_to = eversion_t::max();
 }
 
 void PGLog::clear_info_log(
@@ -626,6 +628,12 @@ void PGLog::write_log_and_missing(
 	     << ", trimmed_dups: " << trimmed_dups
 	     << ", clear_divergent_priors: " << clear_divergent_priors
 	     << dendl;
+    // the rollback bounds often stay put from one write to the next,
+    // don't put the same two keys again then
+    bool write_rollback = require_rollback &&
+      (!touched_log ||
+       log.get_can_rollback_to() != written_can_rollback_to ||
+       log.get_rollback_info_trimmed_to() != written_rollback_info_trimmed_to);
     _write_log_and_missing(
       t, km, log, coll, log_oid,
       dirty_to,
@@ -635,13 +643,20 @@ void PGLog::write_log_and_missing(
       std::move(trimmed_dups),
       missing,
       !touched_log,
-      require_rollback,
+      write_rollback,
       clear_divergent_priors,
       dirty_to_dups,
       dirty_from_dups,
       write_from_dups,
       &may_include_deletes_in_missing_dirty,
       (pg_log_debug ? &log_keys_debug : nullptr));
+    if (write_rollback) {
+      written_can_rollback_to = log.get_can_rollback_to();
+      written_rollback_info_trimmed_to = log.get_rollback_info_trimmed_to();
+    } else if (!require_rollback) {
+      written_can_rollback_to = eversion_t::max();
+      written_rollback_info_trimmed_to = eversion_t::max();
+    }
     undirty();
   } else {
     dout(10) << "log is not dirty" << dendl;
@@ -938,7 +953,11 @@ void PGLog::_write_log_and_missing(
       if (!missing.is_missing(obj, &item)) {
 	to_remove.insert(key);
       } else {
-	uint64_t features = missing.may_include_deletes ? CEPH_FEATURE_OSD_RECOVERY_DELETES : 0;
+	// the octopus encoding keeps the clean regions, so that what is
+	// still missing after a restart can be recovered partially, too
+	uint64_t features = CEPH_FEATUREMASK_SERVER_OCTOPUS;
+	if (missing.may_include_deletes)
+	  features |= CEPH_FEATURE_OSD_RECOVERY_DELETES;
 	encode(make_pair(obj, item), (*km)[key], features);
       }
     });
@@ -115,6 +115,8 @@ public:
 	  break;
 	}
 	f(*rollback_info_trimmed_to_riter);
+	// nothing reads it anymore, and it is most of what an EC entry holds
+	rollback_info_trimmed_to_riter->mod_desc.release_rollback_info();
       }
 
       return dirty_log;
@@ -588,6 +590,9 @@ protected:
   bool dirty_log;
   bool clear_divergent_priors;
   bool may_include_deletes_in_missing_dirty = false;
+  /// rollback bounds as last written out, max() if not known
+  eversion_t written_can_rollback_to = eversion_t::max();
+  eversion_t written_rollback_info_trimmed_to = eversion_t::max();
 
   void mark_dirty_to(eversion_t to) {
     if (to > dirty_to)
@@ -543,6 +543,51 @@ bool PeeringState::should_restart_peering(
   return false;
 }
 
+bool PeeringState::can_skip_map(
+  const OSDMap &lastmap,
+  const OSDMap &osdmap) const
+{
+  ceph_assert(lastmap.get_epoch() + 1 == osdmap.get_epoch());
+  if (!machine.state_cast<const Reset*>()) {
+    return false;
+  }
+  int64_t poolid = info.pgid.pool();
+  const pg_pool_t *pi = osdmap.get_pg_pool(poolid);
+  if (!pi || !lastmap.have_pg_pool(poolid) ||
+      pi->last_change > lastmap.get_epoch() ||
+      osdmap.get_new_removed_snaps().count(poolid) ||
+      osdmap.get_new_purged_snaps().count(poolid)) {
+    return false;
+  }
+  if (lastmap.get_flags() != osdmap.get_flags() ||
+      lastmap.require_osd_release != osdmap.require_osd_release) {
+    return false;
+  }
+  int whoami = pg_whoami.osd;
+  if (lastmap.exists(whoami) != osdmap.exists(whoami) ||
+      lastmap.is_up(whoami) != osdmap.is_up(whoami)) {
+    return false;
+  }
+  if (osdmap.exists(whoami) &&
+      (lastmap.get_up_from(whoami) != osdmap.get_up_from(whoami) ||
+       lastmap.get_up_thru(whoami) != osdmap.get_up_thru(whoami))) {
+    return false;
+  }
+  vector<int> oldup, oldacting, newup, newacting;
+  int oldupprimary, oldactingprimary, newupprimary, newactingprimary;
+  lastmap.pg_to_up_acting_osds(
+    info.pgid.pgid, &oldup, &oldupprimary, &oldacting, &oldactingprimary);
+  osdmap.pg_to_up_acting_osds(
+    info.pgid.pgid, &newup, &newupprimary, &newacting, &newactingprimary);
+  return !PastIntervals::is_new_interval(
+    oldactingprimary, newactingprimary,
+    oldacting, newacting,
+    oldupprimary, newupprimary,
+    oldup, newup,
+    &osdmap, &lastmap,
+    info.pgid.pgid);
+}
+
 /* Called before initializing peering during advance_map */
 void PeeringState::start_peering_interval(
   const OSDMapRef lastmap,
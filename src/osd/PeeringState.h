@@ -2036,6 +2036,14 @@ public:
   void recalc_readable_until();
 
   //============================ const helpers ================================
+  /**
+   * true if the step from @p lastmap to the following @p osdmap has
+   * nothing for this pg to act on, so that an osd catching up on maps
+   * needn't feed it through the state machine.  Only pgs in Reset
+   * qualify: they hold no peer state the map could invalidate.
+   */
+  bool can_skip_map(const OSDMap &lastmap, const OSDMap &osdmap) const;
+
   const char *get_current_state() const {
     return state_history.get_current_state();
   }
@@ -893,7 +893,7 @@ bool PrimaryLogPG::pgls_filter(const PGLSFilter& filter, const hobject_t& sobj)
       sobj,
       filter.get_xattr(),
       &bl);
-    dout(0) << "getattr (sobj=" << sobj << ", attr=" << filter.get_xattr() << ") returned " << ret << dendl;
+    dout(20) << "getattr (sobj=" << sobj << ", attr=" << filter.get_xattr() << ") returned " << ret << dendl;
     if (ret < 0) {
       if (ret != -ENODATA || filter.reject_empty_xattr()) {
         return false;
@@ -920,6 +920,8 @@ PrimaryLogPG::get_pgls_filter(bufferlist::const_iterator& iter)
 
   if (type.compare("plain") == 0) {
     filter = std::make_unique<PGLSPlainFilter>();
+  } else if (type.compare("match") == 0) {
+    filter = std::make_unique<PGLSMatchFilter>();
   } else {
     std::size_t dot = type.find(".");
     if (dot == std::string::npos || dot == 0 || dot == type.size() - 1) {
@@ -4028,6 +4030,8 @@ void PrimaryLogPG::execute_ctx(OpContext *ctx)
 	MOSDOpReply *reply = ctx->reply;
 	ctx->reply = nullptr;
 	reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
+	if (ctx->op)
+	  set_reply_stage_times(*ctx->op, reply);
 	dout(10) << " sending reply on " << *m << " " << reply << dendl;
 	osd->send_message_osd_client(reply, m->get_connection());
 	ctx->sent_reply = true;
@@ -4126,8 +4130,26 @@ void PrimaryLogPG::log_op_stats(const OpRequest& op,
   }
 }
 
+void PrimaryLogPG::set_reply_stage_times(const OpRequest& op,
+					 MOSDOpReply *reply)
+{
+  auto m = op.get_req<MOSDOp>();
+  if (!m->has_flag(CEPH_OSD_FLAG_TRACE_STAGES)) {
+    return;
+  }
+  auto usec = [](utime_t from, utime_t to) -> uint32_t {
+    return to > from ?
+      std::min<uint64_t>((to - from).to_nsec() / 1000, UINT32_MAX) : 0;
+  };
+  const utime_t now = ceph_clock_now();
+  reply->set_stage_usec({
+      usec(m->get_recv_stamp(), m->get_dispatch_stamp()),
+      usec(m->get_dispatch_stamp(), op.get_dequeued_time()),
+      usec(op.get_dequeued_time(), now)});
+}
+
 void PrimaryLogPG::set_dynamic_perf_stats_queries(
-    const std::list<OSDPerfMetricQuery> &queries)
+    const std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> &queries)
 {
   m_dynamic_perf_stats.set_queries(queries);
 }
@@ -4188,7 +4210,18 @@ void PrimaryLogPG::do_scan(
       // Check that from is in backfill_targets vector
       ceph_assert(is_backfill_target(from));
 
-      BackfillInterval& bi = peer_backfill_info[from];
+      auto pf = prefetching_backfill.find(from);
+      bool prefetched = pf != prefetching_backfill.end() &&
+	pf->second == m->begin;
+      if (prefetched) {
+	prefetching_backfill.erase(pf);
+      }
+      // unless we are waiting for it already, keep it for later
+      bool keep = prefetched &&
+	!(waiting_on_backfill.count(from) &&
+	  peer_backfill_info[from].end == m->begin);
+      BackfillInterval& bi = keep ?
+	peer_backfill_prefetch[from] : peer_backfill_info[from];
       bi.begin = m->begin;
       bi.end = m->end;
       auto p = m->get_data().cbegin();
@@ -4196,6 +4229,11 @@ void PrimaryLogPG::do_scan(
       // take care to preserve ordering!
       bi.clear_objects();
       decode_noclear(bi.objects, p);
+      if (keep) {
+	dout(20) << __func__ << " prefetched " << bi << " from " << from
+		 << dendl;
+	break;
+      }
 
       if (waiting_on_backfill.erase(from)) {
 	if (waiting_on_backfill.empty()) {
@@ -5525,7 +5563,8 @@ int PrimaryLogPG::do_read(OpContext *ctx, OSDOp& osd_op) {
       new ReadFinisher(osd_op));
   } else {
     int r = pgbackend->objects_read_sync(
-      soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata);
+      soid, op.extent.offset, op.extent.length,
+      read_cache_hint(soid, op.flags), &osd_op.outdata);
     // whole object?  can we verify the checksum?
     if (r >= 0 && op.extent.offset == 0 &&
         (uint64_t)r == oi.size && oi.is_data_digest()) {
@@ -5609,7 +5648,9 @@ int PrimaryLogPG::do_sparse_read(OpContext *ctx, OSDOp& osd_op) {
     }
 
     bufferlist data_bl;
-    r = pgbackend->objects_readv_sync(soid, std::move(m), op.flags, &data_bl);
+    r = pgbackend->objects_readv_sync(soid, std::move(m),
+				      read_cache_hint(soid, op.flags),
+				      &data_bl);
     if (r == -EIO) {
       r = rep_repair_primary_object(soid, ctx);
     }
@@ -5811,6 +5852,41 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
       }
       break;
 
+    /* the chunks of the local shard, for clients decoding ec objects */
+    case CEPH_OSD_OP_SHARD_READ:
+      if (!pool.info.is_erasure()) {
+	result = -EOPNOTSUPP;
+	break;
+      }
+      ++ctx->num_read;
+      if (!obs.exists) {
+	result = -ENOENT;
+	break;
+      }
+      if (recovery_state.get_pg_log().get_missing().is_missing(soid)) {
+	// not ours to serve yet, the client reads through the primary
+	result = -EAGAIN;
+	break;
+      }
+      {
+	bufferlist bl;
+	int r = osd->store->read(ch, ghobject_t(soid, ghobject_t::NO_GEN,
+						info.pgid.shard),
+				 op.extent.offset, op.extent.length, bl,
+				 op.flags);
+	if (r < 0) {
+	  result = r;
+	  break;
+	}
+	op.extent.length = r;
+	osd_op.outdata.claim_append(bl);
+	ctx->delta_stats.num_rd_kb += shift_round_up(r, 10);
+	ctx->delta_stats.num_rd++;
+	dout(10) << " shard_read got " << r << " bytes from shard "
+		 << info.pgid.shard << " of " << soid << dendl;
+      }
+      break;
+
     /* map extents */
     case CEPH_OSD_OP_SPARSE_READ:
       tracepoint(osd, do_osd_op_pre_sparse_read, soid.oid.name.c_str(),
@@ -7807,6 +7883,59 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
   return result;
 }
 
+// the OMAPGETVALS of the object classes, handing them the entries as
+// the store iterates them
+int PrimaryLogPG::do_omap_iterate(
+  OpContext *ctx,
+  const string& start_after,
+  const string& filter_prefix,
+  uint64_t max_return,
+  const std::function<bool(const string&, const bufferlist&)>& f,
+  bool *more)
+{
+  const object_info_t& oi = ctx->new_obs.oi;
+  const hobject_t& soid = oi.soid;
+  ++ctx->num_read;
+  *more = false;
+  if (max_return > cct->_conf->osd_max_omap_entries_per_request) {
+    max_return = cct->_conf->osd_max_omap_entries_per_request;
+  }
+  if (!oi.is_omap()) {
+    return 0;
+  }
+  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
+    ch, ghobject_t(soid));
+  if (!iter) {
+    return -ENOENT;
+  }
+  iter->upper_bound(start_after);
+  if (filter_prefix > start_after) {
+    iter->lower_bound(filter_prefix);
+  }
+  uint64_t num = 0;
+  uint64_t bytes = 0;
+  for (; iter->valid(); iter->next()) {
+    string key = iter->key();
+    if (key.compare(0, filter_prefix.size(), filter_prefix) != 0) {
+      break;
+    }
+    if (num >= max_return ||
+	bytes >= cct->_conf->osd_max_omap_bytes_per_request) {
+      *more = true;
+      break;
+    }
+    bufferlist val = iter->value();
+    ++num;
+    bytes += key.size() + val.length();
+    if (!f(key, val)) {
+      break;
+    }
+  }
+  ctx->delta_stats.num_rd_kb += shift_round_up(bytes, 10);
+  ctx->delta_stats.num_rd++;
+  return num;
+}
+
 int PrimaryLogPG::_get_tmap(OpContext *ctx, bufferlist *header, bufferlist *vals)
 {
   if (ctx->new_obs.oi.size == 0) {
@@ -8426,13 +8555,21 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
       dout(10) << "notify_ack " << make_pair(*(p->watch_cookie), p->notify_id) << dendl;
     else
       dout(10) << "notify_ack " << make_pair("NULL", p->notify_id) << dendl;
+    if (p->watch_cookie) {
+      // a lookup rather than a walk of all the watchers, as every watcher
+      // of the object acks the notify
+      auto i = ctx->obc->watchers.find(make_pair(*(p->watch_cookie), entity));
+      if (i != ctx->obc->watchers.end()) {
+	dout(10) << "acking notify on watch " << i->first << dendl;
+	i->second->notify_ack(p->notify_id, p->reply_bl);
+      }
+      continue;
+    }
     for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
 	   ctx->obc->watchers.begin();
 	 i != ctx->obc->watchers.end();
 	 ++i) {
       if (i->first.second != entity) continue;
-      if (p->watch_cookie &&
-	  *(p->watch_cookie) != i->first.first) continue;
       dout(10) << "acking notify on watch " << i->first << dendl;
       i->second->notify_ack(p->notify_id, p->reply_bl);
     }
@@ -8702,6 +8839,7 @@ void PrimaryLogPG::complete_read_ctx(int result, OpContext *ctx)
 
   reply->set_result(result);
   reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
+  set_reply_stage_times(*ctx->op, reply);
   osd->send_message_osd_client(reply, m->get_connection());
   close_op_ctx(ctx);
 }
@@ -12291,6 +12429,9 @@ void PrimaryLogPG::plpg_on_role_change()
     dout(10) << " clearing hit set" << dendl;
     hit_set_clear();
   }
+  if (get_role() != 0) {
+    read_hit_sets.clear();
+  }
 }
 
 void PrimaryLogPG::plpg_on_pool_change()
@@ -12999,6 +13140,7 @@ uint64_t PrimaryLogPG::recover_backfill(
 	recovery_state.get_peer_info(*i).last_backfill);
     }
     backfill_info.reset(last_backfill_started);
+    peer_backfill_prefetch.clear();
 
     backfills_in_flight.clear();
     pending_backfill_updates.clear();
@@ -13056,6 +13198,27 @@ uint64_t PrimaryLogPG::recover_backfill(
       dout(20) << " peer shard " << bt << " backfill " << pbi << dendl;
       if (pbi.begin <= backfill_info.begin &&
 	  !pbi.extends_to_end() && pbi.empty()) {
+	auto pf = peer_backfill_prefetch.find(bt);
+	if (pf != peer_backfill_prefetch.end()) {
+	  if (pf->second.begin == pbi.end) {
+	    dout(10) << " peer osd." << bt << " prefetched " << pf->second
+		     << dendl;
+	    pbi = std::move(pf->second);
+	  }
+	  peer_backfill_prefetch.erase(pf);
+	}
+      }
+      if (pbi.begin <= backfill_info.begin &&
+	  !pbi.extends_to_end() && pbi.empty()) {
+	auto pf = prefetching_backfill.find(bt);
+	if (pf != prefetching_backfill.end() && pf->second == pbi.end) {
+	  dout(10) << " waiting for peer osd." << bt << " to finish scanning from "
+		   << pbi.end << dendl;
+	  ceph_assert(waiting_on_backfill.find(bt) == waiting_on_backfill.end());
+	  waiting_on_backfill.insert(bt);
+	  sent_scan = true;
+	  continue;
+	}
 	dout(10) << " scanning peer osd." << bt << " from " << pbi.end << dendl;
 	epoch_t e = get_osdmap_epoch();
 	MOSDPGScan *m = new MOSDPGScan(
@@ -13066,6 +13229,19 @@ uint64_t PrimaryLogPG::recover_backfill(
 	ceph_assert(waiting_on_backfill.find(bt) == waiting_on_backfill.end());
 	waiting_on_backfill.insert(bt);
         sent_scan = true;
+      } else if (!pbi.extends_to_end() && !pbi.empty() &&
+		 !peer_backfill_prefetch.count(bt) &&
+		 !prefetching_backfill.count(bt) &&
+		 cct->_conf.get_val<bool>("osd_backfill_scan_prefetch")) {
+	// get the next interval scanned while we work through this one
+	dout(10) << " prefetching peer osd." << bt << " from " << pbi.end
+		 << dendl;
+	MOSDPGScan *m = new MOSDPGScan(
+	  MOSDPGScan::OP_SCAN_GET_DIGEST, pg_whoami, get_osdmap_epoch(),
+	  get_last_peering_reset(), spg_t(info.pgid.pgid, bt.shard),
+	  pbi.end, hobject_t());
+	osd->send_message_osd_cluster(bt.osd, m, get_osdmap_epoch());
+	prefetching_backfill[bt] = pbi.end;
       }
     }
 
@@ -13659,6 +13835,81 @@ void PrimaryLogPG::hit_set_create()
   hit_set_start_stamp = now;
 }
 
+void PrimaryLogPG::read_hit_set_create(utime_t now)
+{
+  utime_t period(
+    cct->_conf.get_val<std::chrono::seconds>("osd_read_cache_hit_set_period"));
+  auto count = cct->_conf.get_val<uint64_t>("osd_read_cache_hit_set_count");
+
+  uint64_t target_size = 0;
+  if (!read_hit_sets.empty()) {
+    utime_t dur = now - read_hit_set_start_stamp;
+    unsigned unique = read_hit_sets.front()->approx_unique_insert_count();
+    target_size = (double)unique * (double)period / (double)dur;
+    // periods without any reads
+    for (unsigned idle = (double)dur / (double)period;
+	 idle > 1 && !read_hit_sets.empty();
+	 --idle) {
+      read_hit_sets.pop_back();
+    }
+  }
+  target_size = std::clamp<uint64_t>(target_size,
+				     cct->_conf->osd_hit_set_min_size,
+				     cct->_conf->osd_hit_set_max_size);
+  // convert false positive rate so it holds up across all of them
+  double fpp = cct->_conf.get_val<double>("osd_read_cache_hit_set_fpp") / count;
+  if (fpp <= 0.0) {
+    fpp = .01;
+  }
+  dout(20) << __func__ << " target_size " << target_size
+	   << " fpp " << fpp << dendl;
+  read_hit_sets.push_front(
+    HitSetRef(new HitSet(new BloomHitSet(target_size, fpp, now.sec()))));
+  while (read_hit_sets.size() > count) {
+    read_hit_sets.pop_back();
+  }
+  read_hit_set_start_stamp = now;
+}
+
+uint32_t PrimaryLogPG::read_cache_hint(const hobject_t& oid, uint32_t flags)
+{
+  if (!cct->_conf.get_val<bool>("osd_read_cache_admission") ||
+      (flags & (CEPH_OSD_OP_FLAG_FADVISE_WILLNEED |
+		CEPH_OSD_OP_FLAG_FADVISE_DONTNEED |
+		CEPH_OSD_OP_FLAG_FADVISE_NOCACHE))) {
+    // the client knows better
+    return flags;
+  }
+  utime_t now = ceph_clock_now();
+  utime_t period(
+    cct->_conf.get_val<std::chrono::seconds>("osd_read_cache_hit_set_period"));
+  if (read_hit_sets.empty() || now - read_hit_set_start_stamp >= period) {
+    read_hit_set_create(now);
+  }
+
+  // grade it like agent_estimate_temp() does
+  double decay =
+    1.0 - cct->_conf.get_val<uint64_t>("osd_read_cache_hit_set_decay_rate") / 100.0;
+  double grade = 1000000;
+  uint64_t temp = 0;
+  for (auto& h : read_hit_sets) {
+    if (h->contains(oid)) {
+      temp += grade;
+    }
+    grade *= decay;
+  }
+  read_hit_sets.front()->insert(oid);
+
+  if (temp >= cct->_conf.get_val<uint64_t>("osd_read_cache_min_temperature")) {
+    dout(20) << __func__ << " " << oid << " temp " << temp << ", cache" << dendl;
+    osd->logger->inc(l_osd_read_cache_admit);
+    return flags | CEPH_OSD_OP_FLAG_FADVISE_WILLNEED;
+  }
+  dout(20) << __func__ << " " << oid << " temp " << temp << ", bypass" << dendl;
+  osd->logger->inc(l_osd_read_cache_bypass);
+  return flags | CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
+}
+
 /**
  * apply log entries to set
  *
@@ -15284,6 +15535,8 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
   snapid_t snap_to_trim = context<Trimming>().snap_to_trim;
   auto &in_flight = context<Trimming>().in_flight;
   ceph_assert(in_flight.empty());
+  auto &bytes_trimmed = context<Trimming>().bytes_trimmed;
+  bytes_trimmed = 0;
 
   ceph_assert(pg->is_primary() && pg->is_active());
   if (!context< SnapTrimmer >().can_trim()) {
@@ -15366,6 +15619,9 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
     }
 
     in_flight.insert(object);
+    if (ctx->delta_stats.num_bytes < 0) {
+      bytes_trimmed += -ctx->delta_stats.num_bytes;
+    }
     ctx->register_on_success(
       [pg, object, &in_flight]() {
 	ceph_assert(in_flight.find(object) != in_flight.end());
@@ -1005,6 +1005,14 @@ protected:
   void hit_set_in_memory_trim(uint32_t max_in_memory); ///< discard old in memory HitSets
   void hit_set_remove_all();
 
+  // read cache admission
+  std::list<HitSetRef> read_hit_sets;  ///< newest first
+  utime_t read_hit_set_start_stamp;  ///< time the newest one started recording
+
+  void read_hit_set_create(utime_t now);
+  /// note a read of oid and hint whether to cache it in the op flags
+  uint32_t read_cache_hint(const hobject_t& oid, uint32_t flags);
+
   hobject_t get_hit_set_current_object(utime_t stamp);
   hobject_t get_hit_set_archive_object(utime_t start,
 				       utime_t end,
@@ -1207,6 +1215,7 @@ protected:
   void reply_ctx(OpContext *ctx, int err);
   void make_writeable(OpContext *ctx);
   void log_op_stats(const OpRequest& op, uint64_t inb, uint64_t outb);
+  void set_reply_stage_times(const OpRequest& op, MOSDOpReply *reply);
 
   void write_update_size_and_usage(object_stat_sum_t& stats, object_info_t& oi,
 				   interval_set<uint64_t>& modified, uint64_t offset,
@@ -1548,6 +1557,13 @@ public:
   void kick_snap_trim() override;
   void snap_trimmer_scrub_complete() override;
   int do_osd_ops(OpContext *ctx, std::vector<OSDOp>& ops);
+  int do_omap_iterate(
+    OpContext *ctx,
+    const std::string& start_after,
+    const std::string& filter_prefix,
+    uint64_t max_return,
+    const std::function<bool(const std::string&, const ceph::buffer::list&)>& f,
+    bool *more);
 
   int _get_tmap(OpContext *ctx, ceph::buffer::list *header, ceph::buffer::list *vals);
   int do_tmap2omap(OpContext *ctx, unsigned flags);
@@ -1661,6 +1677,7 @@ private:
 
     std::set<hobject_t> in_flight;
     snapid_t snap_to_trim;
+    uint64_t bytes_trimmed = 0;  ///< clone data removed by the in_flight trims
 
     explicit Trimming(my_context ctx)
       : my_base(ctx),
@@ -1705,6 +1722,12 @@ private:
       };
       auto *pg = context< SnapTrimmer >().pg;
       float osd_snap_trim_sleep = pg->osd->osd->get_osd_snap_trim_sleep();
+      uint64_t bytes_per_sec =
+	pg->cct->_conf.get_val<Option::size_t>("osd_snap_trim_bytes_per_sec");
+      if (bytes_per_sec) {
+	osd_snap_trim_sleep =
+	  (float)context<Trimming>().bytes_trimmed / bytes_per_sec;
+      }
       if (osd_snap_trim_sleep > 0) {
 	std::lock_guard l(pg->osd->sleep_lock);
 	wakeup = pg->osd->sleep_timer.add_event_after(
@@ -1976,7 +1999,7 @@ public:
 
 public:
   void set_dynamic_perf_stats_queries(
-      const std::list<OSDPerfMetricQuery> &queries)  override;
+      const std::map<OSDPerfMetricQuery, OSDPerfMetricLimits> &queries)  override;
   void get_dynamic_perf_stats(DynamicPerfStats *stats)  override;
 
 private:
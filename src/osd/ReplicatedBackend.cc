@@ -257,6 +257,10 @@ void ReplicatedBackend::on_change()
     op.second->on_commit = nullptr;
   }
   in_progress_ops.clear();
+  if (pending_batch) {
+    delete pending_batch->on_all_commit;
+    pending_batch.reset();
+  }
   clear_recovery_state();
 }
 
@@ -492,6 +496,87 @@ void ReplicatedBackend::submit_transaction(
   ceph_assert(added.size() <= 1);
   ceph_assert(removed.size() <= 1);
 
+  // Hold small writes to an object back while the pg has writes in
+  // flight, and send them together once one of those commits.  Only
+  // writes to the same object go together, the replica decides on
+  // applying the transaction by object.
+  uint64_t batch_max_ops = cct->_conf.get_val<uint64_t>(
+    "osd_repop_batch_max_ops");
+  if (batch_max_ops > 1 &&
+      !in_progress_ops.empty() &&
+      added.empty() && removed.empty() && !hset_history &&
+      !log_entries.empty() &&
+      (!pending_batch || pending_batch->soid == soid)) {
+    if (!pending_batch) {
+      pending_batch.emplace();
+      pending_batch->soid = soid;
+      pending_batch->on_all_commit = new C_Contexts(cct);
+    }
+    auto& b = *pending_batch;
+    b.at_version = at_version;
+    b.tid = tid;
+    b.reqid = reqid;
+    b.trim_to = trim_to;
+    b.min_last_complete_ondisk = min_last_complete_ondisk;
+    b.log_entries.insert(b.log_entries.end(),
+			 log_entries.begin(), log_entries.end());
+    b.op_t.append(op_t);
+    b.on_all_commit->add(on_all_commit);
+    b.op = orig_op;
+    ++b.num_ops;
+    dout(20) << __func__ << " " << soid << " " << at_version
+	     << " batched with " << (b.num_ops - 1) << " others" << dendl;
+    if (b.num_ops >= batch_max_ops ||
+	b.op_t.get_num_bytes() >= cct->_conf.get_val<Option::size_t>(
+	  "osd_repop_batch_max_bytes")) {
+      flush_pending_batch();
+    }
+    return;
+  }
+  // keep log order: anything held back goes first
+  flush_pending_batch();
+
+  _submit_transaction(
+    soid, at_version, tid, reqid, trim_to, min_last_complete_ondisk,
+    added.size() ? *(added.begin()) : hobject_t(),
+    removed.size() ? *(removed.begin()) : hobject_t(),
+    std::move(log_entries), hset_history, on_all_commit, orig_op,
+    std::move(op_t));
+  add_temp_objs(added);
+  clear_temp_objs(removed);
+}
+
+void ReplicatedBackend::flush_pending_batch()
+{
+  if (!pending_batch) {
+    return;
+  }
+  auto b = std::move(*pending_batch);
+  pending_batch.reset();
+  dout(10) << __func__ << " " << b.soid << " " << b.num_ops << " ops up to "
+	   << b.at_version << dendl;
+  _submit_transaction(
+    b.soid, b.at_version, b.tid, b.reqid, b.trim_to,
+    b.min_last_complete_ondisk, hobject_t(), hobject_t(),
+    std::move(b.log_entries), b.hset_history, b.on_all_commit, b.op,
+    std::move(b.op_t));
+}
+
+void ReplicatedBackend::_submit_transaction(
+  const hobject_t &soid,
+  const eversion_t &at_version,
+  ceph_tid_t tid,
+  osd_reqid_t reqid,
+  const eversion_t &trim_to,
+  const eversion_t &min_last_complete_ondisk,
+  const hobject_t &new_temp_oid,
+  const hobject_t &discard_temp_oid,
+  vector<pg_log_entry_t>&& log_entries,
+  std::optional<pg_hit_set_history_t> &hset_history,
+  Context *on_all_commit,
+  OpRequestRef orig_op,
+  ObjectStore::Transaction&& op_t)
+{
   auto insert_res = in_progress_ops.insert(
     make_pair(
       tid,
@@ -514,16 +599,13 @@ void ReplicatedBackend::submit_transaction(
     reqid,
     trim_to,
     min_last_complete_ondisk,
-    added.size() ? *(added.begin()) : hobject_t(),
-    removed.size() ? *(removed.begin()) : hobject_t(),
+    new_temp_oid,
+    discard_temp_oid,
     log_entries,
     hset_history,
     &op,
     op_t);
 
-  add_temp_objs(added);
-  clear_temp_objs(removed);
-
   parent->log_operation(
     std::move(log_entries),
     hset_history,
@@ -567,6 +649,7 @@ void ReplicatedBackend::op_commit(const ceph::ref_t<InProgressOp>& op)
     op->on_commit->complete(0);
     op->on_commit = 0;
     in_progress_ops.erase(op->tid);
+    flush_pending_batch();
   }
 }
 
@@ -622,6 +705,7 @@ void ReplicatedBackend::do_repop_reply(OpRequestRef op)
       ip_op.on_commit->complete(0);
       ip_op.on_commit = 0;
       in_progress_ops.erase(iter);
+      flush_pending_batch();
     }
   }
 }
@@ -718,14 +802,19 @@ int ReplicatedBackend::be_deep_scrub(
   }
   int max = g_conf()->osd_deep_scrub_keys;
   while (iter->status() == 0 && iter->valid()) {
-    pos.omap_bytes += iter->value().length();
+    std::string key = iter->key();
+    bufferlist value = iter->value();
+    pos.omap_bytes += value.length();
     ++pos.omap_keys;
     --max;
-    // fixme: we can do this more efficiently.
-    bufferlist bl;
-    encode(iter->key(), bl);
-    encode(iter->value(), bl);
-    pos.omap_hash << bl;
+    // hash the encoding of the key and the value, without building it
+    ceph_le32 len;
+    len = key.length();
+    pos.omap_hash.update((const char*)&len, sizeof(len));
+    pos.omap_hash.update(key.data(), key.length());
+    len = value.length();
+    pos.omap_hash.update((const char*)&len, sizeof(len));
+    pos.omap_hash << value;
 
     iter->next();
 
@@ -350,12 +350,50 @@ private:
 	op(op), v(v) {}
   };
   std::map<ceph_tid_t, ceph::ref_t<InProgressOp>> in_progress_ops;
+
+  /**
+   * Writes to one object held back while earlier writes replicate, to be
+   * sent as a single transaction and MOSDRepOp once one of those commits.
+   */
+  struct PendingBatch {
+    hobject_t soid;
+    eversion_t at_version;
+    ceph_tid_t tid = 0;
+    osd_reqid_t reqid;
+    eversion_t trim_to;
+    eversion_t min_last_complete_ondisk;
+    std::vector<pg_log_entry_t> log_entries;
+    std::optional<pg_hit_set_history_t> hset_history;
+    ObjectStore::Transaction op_t;
+    C_Contexts *on_all_commit = nullptr;
+    OpRequestRef op;
+    unsigned num_ops = 0;
+  };
+  std::optional<PendingBatch> pending_batch;
+
+  /// send what is in pending_batch
+  void flush_pending_batch();
+  void _submit_transaction(
+    const hobject_t &soid,
+    const eversion_t &at_version,
+    ceph_tid_t tid,
+    osd_reqid_t reqid,
+    const eversion_t &trim_to,
+    const eversion_t &min_last_complete_ondisk,
+    const hobject_t &new_temp_oid,
+    const hobject_t &discard_temp_oid,
+    std::vector<pg_log_entry_t>&& log_entries,
+    std::optional<pg_hit_set_history_t> &hset_history,
+    Context *on_all_commit,
+    OpRequestRef orig_op,
+    ObjectStore::Transaction&& op_t);
 public:
   friend class C_OSD_OnOpCommit;
 
   void call_write_ordered(std::function<void(void)> &&cb) override {
     // ReplicatedBackend submits writes inline in submit_transaction, so
-    // we can just call the callback.
+    // we can just call the callback once held back writes are out.
+    flush_pending_batch();
     cb();
   }
 
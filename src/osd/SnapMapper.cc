@@ -322,12 +322,40 @@ int SnapMapper::get_next_objects_to_trim(
 {
   ceph_assert(out);
   ceph_assert(out->empty());
+  if (snap != trim_snap) {
+    trim_snap = snap;
+    trim_pos.clear();
+  }
+  int r = _get_next_objects_to_trim(snap, max, out);
+  if (r == -ENOENT && !trim_pos.empty()) {
+    // make sure nothing was mapped behind us before calling it done
+    // and for whatever could not be trimmed when we got to it
+    dout(20) << __func__ << " nothing after " << trim_pos
+	     << ", rescanning" << dendl;
+    trim_pos.clear();
+    r = _get_next_objects_to_trim(snap, max, out);
+  }
+  return r;
+}
+
+int SnapMapper::_get_next_objects_to_trim(
+  snapid_t snap,
+  unsigned max,
+  vector<hobject_t> *out)
+{
   int r = 0;
   for (set<string>::iterator i = prefixes.begin();
        i != prefixes.end() && out->size() < max && r == 0;
        ++i) {
     string prefix(get_prefix(pool, snap) + *i);
     string pos = prefix;
+    if (trim_pos > prefix) {
+      if (trim_pos.compare(0, prefix.size(), prefix) != 0) {
+	continue; // went through all of this prefix already
+      }
+      // go on after what we returned last
+      pos = trim_pos;
+    }
     while (out->size() < max) {
       pair<string, bufferlist> next;
       r = backend.get_next(pos, &next);
@@ -351,6 +379,7 @@ int SnapMapper::get_next_objects_to_trim(
 
       out->push_back(next_decoded.second);
       pos = next.first;
+      trim_pos = pos;
     }
   }
   if (out->size() == 0) {
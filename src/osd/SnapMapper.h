@@ -249,6 +249,16 @@ private:
     MapCacher::Transaction<std::string, ceph::buffer::list> *t ///< [out] transaction
     );
 
+  /// last key get_next_objects_to_trim() returned for trim_snap, to go on
+  /// from there rather than seek over the tombstones of what was trimmed
+  snapid_t trim_snap;
+  std::string trim_pos;
+
+  int _get_next_objects_to_trim(
+    snapid_t snap,
+    unsigned max,
+    std::vector<hobject_t> *out);
+
 public:
   static std::string make_shard_prefix(shard_id_t shard) {
     if (shard == shard_id_t::NO_SHARD)
@@ -283,6 +293,7 @@ public:
     uint32_t new_bits  ///< [in] new split bits
     ) {
     mask_bits = new_bits;
+    trim_pos.clear();
     std::set<std::string> _prefixes = hobject_t::get_prefixes(
       mask_bits,
       match,
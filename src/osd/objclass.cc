@@ -425,6 +425,15 @@ int cls_cxx_map_get_vals(cls_method_context_t hctx, const string &start_obj,
   return vals->size();
 }
 
+int cls_cxx_map_iterate(cls_method_context_t hctx, const string &start_after,
+			const string &filter_prefix, uint64_t max_to_get,
+			const cls_map_iterate_cb_t& f, bool *more)
+{
+  PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
+  return (*pctx)->pg->do_omap_iterate(*pctx, start_after, filter_prefix,
+				      max_to_get, f, more);
+}
+
 int cls_cxx_map_read_header(cls_method_context_t hctx, bufferlist *outbl)
 {
   PrimaryLogPG::OpContext **pctx = (PrimaryLogPG::OpContext **)hctx;
@@ -7,6 +7,8 @@
 
 PerfCounters *build_osd_logger(CephContext *cct) {
   PerfCountersBuilder osd_plb(cct, "osd", l_osd_first, l_osd_last);
+  // op counters are updated by every shard thread for every op
+  osd_plb.set_striped(true);
 
   // Latency axis configuration for op histograms, values are in nanoseconds
   PerfHistogramCommon::axis_config_d op_hist_x_axis_config{
@@ -262,6 +264,13 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_object_ctx_cache_total, "object_ctx_cache_total", "Object context cache lookups");
 
+  osd_plb.add_u64_counter(
+    l_osd_read_cache_admit, "read_cache_admit",
+    "Reads of hot objects hinted to be cached");
+  osd_plb.add_u64_counter(
+    l_osd_read_cache_bypass, "read_cache_bypass",
+    "Reads of cold objects hinted not to be cached");
+
   osd_plb.add_u64_counter(l_osd_op_cache_hit, "op_cache_hit");
   osd_plb.add_time_avg(
     l_osd_tier_flush_lat, "osd_tier_flush_lat", "Object flush latency");
@@ -278,6 +287,13 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_op_wq_stolen, "op_wq_stolen",
+    "Op queue items run by a thread of another shard");
+  osd_plb.add_u64_counter(
+    l_osd_op_wq_run_inline, "op_wq_run_inline",
+    "Op queue runs by the messenger thread that queued an op");
+
   return osd_plb.create_perf_counters();
 }
  
@@ -109,6 +109,9 @@ enum {
   l_osd_object_ctx_cache_hit,
   l_osd_object_ctx_cache_total,
 
+  l_osd_read_cache_admit,
+  l_osd_read_cache_bypass,
+
   l_osd_op_cache_hit,
   l_osd_tier_flush_lat,
   l_osd_tier_promote_lat,
@@ -118,6 +121,9 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_op_wq_stolen,
+  l_osd_op_wq_run_inline,
+
   l_osd_last,
 };
 
@@ -92,6 +92,7 @@ const char *ceph_osd_flag_name(unsigned flag)
   case CEPH_OSD_FLAG_FULL_FORCE: return "full_force";
   case CEPH_OSD_FLAG_IGNORE_REDIRECT: return "ignore_redirect";
   case CEPH_OSD_FLAG_RETURNVEC: return "returnvec";
+  case CEPH_OSD_FLAG_TRACE_STAGES: return "trace_stages";
   default: return "???";
   }
 }
@@ -6720,6 +6721,7 @@ ostream& operator<<(ostream& out, const OSDOp& op)
     case CEPH_OSD_OP_APPEND:
     case CEPH_OSD_OP_MAPEXT:
     case CEPH_OSD_OP_CMPEXT:
+    case CEPH_OSD_OP_SHARD_READ:
       out << " " << op.op.extent.offset << "~" << op.op.extent.length;
       if (op.op.extent.truncate_seq)
 	out << " [" << op.op.extent.truncate_seq << "@"
@@ -6796,6 +6798,26 @@ void OSDOp::merge_osd_op_vector_in_data(vector<OSDOp>& ops, ceph::buffer::list&
   }
 }
 
+void OSDOp::encode_op_vector(const vector<OSDOp>& ops, ceph::buffer::list& out)
+{
+  // ceph_osd_op is encoded raw; fill a single hole rather than appending
+  // the ops one by one
+  auto filler = out.append_hole(ops.size() * sizeof(ceph_osd_op));
+  for (auto& op : ops) {
+    filler.copy_in(sizeof(op.op), reinterpret_cast<const char*>(&op.op));
+  }
+}
+
+void OSDOp::encode_rval_vector(const vector<OSDOp>& ops, ceph::buffer::list& out)
+{
+  auto filler = out.append_hole(ops.size() * sizeof(ceph_le32));
+  for (auto& op : ops) {
+    ceph_le32 rval;
+    rval = op.rval;
+    filler.copy_in(sizeof(rval), reinterpret_cast<const char*>(&rval));
+  }
+}
+
 void OSDOp::split_osd_op_vector_out_data(vector<OSDOp>& ops, ceph::buffer::list& in)
 {
   auto datap = in.begin();
@@ -6975,3 +6997,27 @@ bool PGLSPlainFilter::filter(const hobject_t& obj,
 {
   return xattr_data.contents_equal(val.c_str(), val.size());
 }
+
+int PGLSMatchFilter::init(ceph::bufferlist::const_iterator &params)
+{
+  try {
+    DECODE_START(1, params);
+    decode(prefix, params);
+    decode(xattr, params);
+    decode(match_val, params);
+    decode(val, params);
+    DECODE_FINISH(params);
+  } catch (ceph::buffer::error &e) {
+    return -EINVAL;
+  }
+  return 0;
+}
+
+bool PGLSMatchFilter::filter(const hobject_t& obj,
+                             const ceph::bufferlist& xattr_data) const
+{
+  if (obj.oid.name.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  return !match_val || xattr_data.contents_equal(val.c_str(), val.size());
+}
@@ -477,21 +477,13 @@ struct pg_t {
     }
   }
 
-  void encode(ceph::buffer::list& bl) const {
-    using ceph::encode;
-    __u8 v = 1;
-    encode(v, bl);
-    encode(m_pool, bl);
-    encode(m_seed, bl);
-    encode((int32_t)-1, bl); // was preferred
-  }
-  void decode(ceph::buffer::list::const_iterator& bl) {
-    using ceph::decode;
-    __u8 v;
-    decode(v, bl);
-    decode(m_pool, bl);
-    decode(m_seed, bl);
-    bl += sizeof(int32_t); // was preferred
+  DENC(pg_t, v, p) {
+    __u8 struct_v = 1;
+    denc(struct_v, p);
+    denc(v.m_pool, p);
+    denc(v.m_seed, p);
+    int32_t preferred = -1; // was preferred
+    denc(preferred, p);
   }
   void decode_old(ceph::buffer::list::const_iterator& bl) {
     using ceph::decode;
@@ -502,7 +494,7 @@ struct pg_t {
   void dump(ceph::Formatter *f) const;
   static void generate_test_instances(std::list<pg_t*>& o);
 };
-WRITE_CLASS_ENCODER(pg_t)
+WRITE_CLASS_DENC_BOUNDED(pg_t)
 
 inline bool operator<(const pg_t& l, const pg_t& r) {
   return l.compare(r) < 0;
@@ -885,30 +877,18 @@ public:
     ritoa<uint32_t, 10, 10>(epoch, key + 10);
   }
 
-  void encode(ceph::buffer::list &bl) const {
-#if defined(CEPH_LITTLE_ENDIAN)
-    bl.append((char *)this, sizeof(version_t) + sizeof(epoch_t));
-#else
-    using ceph::encode;
-    encode(version, bl);
-    encode(epoch, bl);
-#endif
-  }
-  void decode(ceph::buffer::list::const_iterator &bl) {
-#if defined(CEPH_LITTLE_ENDIAN)
-    bl.copy(sizeof(version_t) + sizeof(epoch_t), (char *)this);
-#else
-    using ceph::decode;
-    decode(version, bl);
-    decode(epoch, bl);
-#endif
-  }
-  void decode(ceph::buffer::list& bl) {
-    auto p = std::cbegin(bl);
-    decode(p);
+  DENC(eversion_t, v, p) {
+    denc(v.version, p);
+    denc(v.epoch, p);
   }
+  void decode(ceph::buffer::list& bl);
 };
-WRITE_CLASS_ENCODER(eversion_t)
+WRITE_CLASS_DENC_BOUNDED(eversion_t)
+
+inline void eversion_t::decode(ceph::buffer::list& bl) {
+  auto p = std::cbegin(bl);
+  ceph::decode(*this, p);
+}
 
 inline bool operator==(const eversion_t& l, const eversion_t& r) {
   return (l.epoch == r.epoch) && (l.version == r.version);
@@ -3883,6 +3863,14 @@ public:
     if (bl.length() > 0)
       bl.rebuild();
   }
+  /**
+   * Drop the rollback info of an entry that was rolled forward (or
+   * trimmed) and so won't ever be rolled back, keeping the flags so
+   * that the entry still reads the same to those who look at them
+   */
+  void release_rollback_info() {
+    bl.clear();
+  }
   void encode(ceph::buffer::list &bl) const;
   void decode(ceph::buffer::list::const_iterator &bl);
   void dump(ceph::Formatter *f) const;
@@ -3989,6 +3977,18 @@ struct OSDOp {
    */
   static void merge_osd_op_vector_out_data(std::vector<OSDOp>& ops, ceph::buffer::list& out);
 
+  /**
+   * encode the ceph_osd_op of each OSDOp, as encode() of each would, into
+   * a single piece of the ceph::buffer::list
+   *
+   * @param ops [in] vector of OSDOps
+   * @param out [out] buffer to append the ops to
+   */
+  static void encode_op_vector(const std::vector<OSDOp>& ops, ceph::buffer::list& out);
+
+  /// encode the rval of each OSDOp in one go, as encode_op_vector() does
+  static void encode_rval_vector(const std::vector<OSDOp>& ops, ceph::buffer::list& out);
+
   /**
    * Clear data as much as possible, leave minimal data for historical op dump
    *
@@ -6305,5 +6305,18 @@ public:
               const ceph::buffer::list& xattr_data) const override;
 };
 
+/// built-in filter on a name prefix and, optionally, on an xattr being
+/// present or having a given value
+class PGLSMatchFilter : public PGLSFilter {
+  std::string prefix;
+  bool match_val = false;
+  std::string val;
+public:
+  int init(ceph::buffer::list::const_iterator &params) override;
+  ~PGLSMatchFilter() override {}
+  bool filter(const hobject_t& obj,
+              const ceph::buffer::list& xattr_data) const override;
+};
+
 
 #endif
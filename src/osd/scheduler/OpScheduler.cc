@@ -21,7 +21,9 @@
 
 namespace ceph::osd::scheduler {
 
-OpSchedulerRef make_scheduler(CephContext *cct)
+OpSchedulerRef make_scheduler(
+  CephContext *cct,
+  cost_per_io_source_t get_cost_per_io)
 {
   const std::string *type = &cct->_conf->osd_op_queue;
   if (*type == "debug_random") {
@@ -41,7 +43,7 @@ OpSchedulerRef make_scheduler(CephContext *cct)
 	cct->_conf->osd_op_pq_min_cost
     );
   } else if (*type == "mclock_scheduler") {
-    return std::make_unique<mClockScheduler>(cct);
+    return std::make_unique<mClockScheduler>(cct, std::move(get_cost_per_io));
   } else {
     ceph_assert("Invalid choice of wq" == 0);
   }
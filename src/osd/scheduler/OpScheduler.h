@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <functional>
 #include <ostream>
 
 #include "common/ceph_context.h"
@@ -55,7 +56,12 @@ public:
 std::ostream &operator<<(std::ostream &lhs, const OpScheduler &);
 using OpSchedulerRef = std::unique_ptr<OpScheduler>;
 
-OpSchedulerRef make_scheduler(CephContext *cct);
+/// returns the fixed cost of an io in bytes, 0 when unknown
+using cost_per_io_source_t = std::function<uint64_t()>;
+
+OpSchedulerRef make_scheduler(
+  CephContext *cct,
+  cost_per_io_source_t get_cost_per_io = {});
 
 /**
  * Implements OpScheduler in terms of OpQueue
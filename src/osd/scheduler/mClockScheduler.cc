@@ -30,16 +30,35 @@ using namespace std::placeholders;
 
 namespace ceph::osd::scheduler {
 
-mClockScheduler::mClockScheduler(CephContext *cct) :
+mClockScheduler::mClockScheduler(CephContext *cct,
+				 cost_per_io_source_t get_cost_per_io) :
   scheduler(
     std::bind(&mClockScheduler::ClientRegistry::get_info,
 	      &client_registry,
 	      _1),
     dmc::AtLimit::Allow,
-    cct->_conf.get_val<double>("osd_mclock_scheduler_anticipation_timeout"))
+    cct->_conf.get_val<double>("osd_mclock_scheduler_anticipation_timeout")),
+  cct(cct),
+  get_store_cost_per_io(std::move(get_cost_per_io))
 {
   cct->_conf.add_observer(this);
   client_registry.update_from_config(cct->_conf);
+  refresh_cost_per_io();
+}
+
+void mClockScheduler::refresh_cost_per_io()
+{
+  enqueues_since_refresh = 0;
+  uint64_t c = cct->_conf.get_val<Option::size_t>("osd_mclock_cost_per_io");
+  if (!c && get_store_cost_per_io) {
+    // follows what the store measures of its device
+    c = get_store_cost_per_io();
+  }
+  if (c != cost_per_io) {
+    ldout(cct, 10) << "mClockScheduler " << __func__ << " " << cost_per_io
+		   << " -> " << c << dendl;
+    cost_per_io = c;
+  }
 }
 
 void mClockScheduler::ClientRegistry::update_from_config(const ConfigProxy &conf)
@@ -88,13 +107,17 @@ const dmc::ClientInfo *mClockScheduler::ClientRegistry::get_info(
 
 void mClockScheduler::dump(ceph::Formatter &f) const
 {
+  f.dump_unsigned("cost_per_io", cost_per_io);
 }
 
 void mClockScheduler::enqueue(OpSchedulerItem&& item)
 {
   auto id = get_scheduler_id(item);
-  // TODO: express cost, mclock params in terms of per-node capacity?
-  auto cost = 1; //std::max(item.get_cost(), 1);
+  if (++enqueues_since_refresh >= 1024) {
+    refresh_cost_per_io();
+  }
+  // reservations and limits count ios the size of a minimal one
+  auto cost = calc_cost(item.get_cost());
 
   // TODO: move this check into OpSchedulerItem, handle backwards compat
   if (op_scheduler_class::immediate == item.get_scheduler_class()) {
@@ -151,6 +174,7 @@ const char** mClockScheduler::get_tracked_conf_keys() const
     "osd_mclock_scheduler_background_best_effort_res",
     "osd_mclock_scheduler_background_best_effort_wgt",
     "osd_mclock_scheduler_background_best_effort_lim",
+    "osd_mclock_cost_per_io",
     NULL
   };
   return KEYS;
@@ -161,6 +185,9 @@ void mClockScheduler::handle_conf_change(
   const std::set<std::string> &changed)
 {
   client_registry.update_from_config(conf);
+  if (changed.count("osd_mclock_cost_per_io")) {
+    refresh_cost_per_io();
+  }
 }
 
 }
@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <ostream>
 #include <map>
 #include <vector>
@@ -90,6 +91,14 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
   mclock_queue_t scheduler;
   std::list<OpSchedulerItem> immediate;
 
+  CephContext *cct;
+  cost_per_io_source_t get_store_cost_per_io;
+  /// bytes worth one io; 0 makes every op cost the same
+  uint64_t cost_per_io = 0;
+  unsigned enqueues_since_refresh = 0;
+
+  void refresh_cost_per_io();
+
   static scheduler_id_t get_scheduler_id(const OpSchedulerItem &item) {
     return scheduler_id_t{
       item.get_scheduler_class(),
@@ -101,7 +110,19 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
   }
 
 public:
-  mClockScheduler(CephContext *cct);
+  mClockScheduler(CephContext *cct,
+		  cost_per_io_source_t get_cost_per_io = {});
+
+  /// cost of an op in units of a minimal io
+  unsigned calc_cost(int item_cost) const {
+    if (!cost_per_io || item_cost <= 0) {
+      return 1;
+    }
+    return 1 + std::min<uint64_t>(item_cost / cost_per_io, 1u << 20);
+  }
+  uint64_t get_cost_per_io() const {
+    return cost_per_io;
+  }
 
   // Enqueue op in the back of the regular queue
   void enqueue(OpSchedulerItem &&item) final;
@@ -724,6 +724,9 @@ void ObjectCacher::perf_start()
 		      "Write data blocked on dirty limit", NULL, 0, unit_t(UNIT_BYTES));
   plb.add_time(l_objectcacher_write_time_blocked, "write_time_blocked",
 	       "Time spent blocking a write due to dirty limits");
+  plb.add_u64_counter(l_objectcacher_readahead_bytes, "readahead_bytes",
+		      "Data prefetched by readahead", NULL, 0,
+		      unit_t(UNIT_BYTES));
 
   perfcounter = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(perfcounter);
@@ -1259,7 +1262,8 @@ void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid,
     finish_contexts(cct, ls, r);
 }
 
-void ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount)
+void ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount,
+			 int *max_count)
 {
   ceph_assert(trace != nullptr);
   ceph_assert(ceph_mutex_is_locked(lock));
@@ -1274,17 +1278,19 @@ void ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount)
    * lru_dirty.lru_get_next_expire() again.
    */
   int64_t left = amount;
-  while (amount == 0 || left > 0) {
+  while ((amount == 0 || left > 0) && (!max_count || *max_count > 0)) {
     BufferHead *bh = static_cast<BufferHead*>(
       bh_lru_dirty.lru_get_next_expire());
     if (!bh) break;
     if (bh->last_write > cutoff) break;
 
     if (scattered_write) {
-      bh_write_adjacencies(bh, cutoff, amount > 0 ? &left : NULL, NULL);
+      bh_write_adjacencies(bh, cutoff, amount > 0 ? &left : NULL, max_count);
     } else {
       left -= bh->length();
       bh_write(bh, *trace);
+      if (max_count)
+	--*max_count;
     }
   }
 }
@@ -1632,6 +1638,9 @@ int ObjectCacher::_readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
       if (dontneed && o->include_all_cached_data(ex_it->offset, ex_it->length))
 	  bottouch_ob(o);
     }
+
+    if (external_call && readahead_max)
+      _readahead(o, *ex_it, rd->fadvise_flags, *trace);
   }
 
   if (!success) {
@@ -1691,6 +1700,87 @@ int ObjectCacher::_readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
   return ret;
 }
 
+void ObjectCacher::_readahead(Object *o, const ObjectExtent& ex,
+			      int op_flags, const ZTracer::Trace &trace)
+{
+  ObjectSet *oset = o->oset;
+  if (!oset->object_size ||
+      (op_flags & (LIBRADOS_OP_FLAG_FADVISE_RANDOM |
+		   LIBRADOS_OP_FLAG_FADVISE_NOCACHE |
+		   LIBRADOS_OP_FLAG_FADVISE_DONTNEED)))
+    return;
+
+  loff_t end = ex.offset + ex.length;
+  if ((loff_t)ex.offset == o->ra_pos) {
+    ++o->ra_seq;
+  } else {
+    o->ra_seq = 1;
+    o->ra_window = 0;
+    o->ra_end = 0;
+  }
+  o->ra_pos = end;
+  if (o->ra_seq < 2)
+    return;
+
+  // refill once less than half a window is left ahead of the reader
+  if (o->ra_window && o->ra_end - end >= (loff_t)o->ra_window / 2)
+    return;
+  uint64_t window = o->ra_window ?
+    std::min(o->ra_window * 2, readahead_max) : readahead_min;
+  if (!waitfor_read.empty() || stat_rx + window > max_size) {
+    ldout(cct, 20) << "readahead " << *o << " skipped, cache is busy" << dendl;
+    return;
+  }
+  o->ra_window = window;
+
+  loff_t object_size = oset->object_size;
+  loff_t want = end + window;
+  loff_t start = std::max(end, o->ra_end);
+  if (start < std::min(want, object_size)) {
+    _prefetch(o, start, std::min(want, object_size) - start, op_flags, trace);
+  }
+  o->ra_end = std::max(o->ra_end, std::min(want, object_size));
+  if (want <= object_size || !oset->object_name)
+    return;
+
+  // the stream continues in the next object of the layout: start it there
+  // too, so that its first read is already seen as sequential
+  uint64_t next_no = o->get_object_number() + oset->stripe_count;
+  sobject_t soid(oset->object_name(next_no), o->get_snap());
+  object_locator_t oloc(o->get_oloc());
+  Object *next = get_object(soid, next_no, oset, oloc, o->truncate_size,
+			    o->truncate_seq);
+  loff_t next_want = std::min(want - object_size, object_size);
+  if (next->ra_pos != 0 || next->ra_end < next_want) {
+    if (next->ra_pos != 0)
+      next->ra_end = 0;
+    _prefetch(next, next->ra_end, next_want - next->ra_end, op_flags, trace);
+    next->ra_pos = 0;
+    next->ra_seq = o->ra_seq;
+    next->ra_window = window;
+    next->ra_end = next_want;
+  }
+}
+
+void ObjectCacher::_prefetch(Object *o, loff_t off, uint64_t len,
+			     int op_flags, const ZTracer::Trace &trace)
+{
+  ObjectExtent ex(o->get_oid(), o->get_object_number(), off, len,
+		  o->truncate_size);
+  ex.oloc = o->get_oloc();
+  map<loff_t, BufferHead*> hits, missing, rx, errors;
+  o->map_read(ex, hits, missing, rx, errors);
+  uint64_t bytes = 0;
+  for (auto& p : missing) {
+    bh_read(p.second, op_flags, trace);
+    bytes += p.second->length();
+  }
+  ldout(cct, 10) << "readahead " << *o << " " << off << "~" << len
+		 << " reading " << bytes << dendl;
+  if (perfcounter && bytes)
+    perfcounter->inc(l_objectcacher_readahead_bytes, bytes);
+}
+
 void ObjectCacher::retry_waiting_reads()
 {
   list<Context *> ls;
@@ -1936,18 +2026,21 @@ void ObjectCacher::flusher_entry()
       trace.event("start");
     }
 
+    // the lock is shared with every reader and writer of the cache (and,
+    // for the client, with everything else): start writeback on at most
+    // MAX_FLUSH_UNDER_LOCK bhs before giving them a turn
+    int max = MAX_FLUSH_UNDER_LOCK;
     if (actual > 0 && (uint64_t) actual > target_dirty) {
       // flush some dirty pages
       ldout(cct, 10) << "flusher " << get_stat_dirty() << " dirty + "
 		     << get_stat_dirty_waiting() << " dirty_waiting > target "
 		     << target_dirty << ", flushing some dirty bhs" << dendl;
-      flush(&trace, actual - target_dirty);
+      flush(&trace, actual - target_dirty, &max);
     } else {
       // check tail of lru for old dirty items
       ceph::real_time cutoff = ceph::real_clock::now();
       cutoff -= max_dirty_age;
       BufferHead *bh = 0;
-      int max = MAX_FLUSH_UNDER_LOCK;
       while ((bh = static_cast<BufferHead*>(bh_lru_dirty.
 					    lru_get_next_expire())) != 0 &&
 	     bh->last_write <= cutoff &&
@@ -1960,13 +2053,13 @@ void ObjectCacher::flusher_entry()
 	  --max;
 	}
       }
-      if (!max) {
-	// back off the lock to avoid starving other threads
-        trace.event("backoff");
-	l.unlock();
-	l.lock();
-	continue;
-      }
+    }
+    if (max <= 0) {
+      // back off the lock to avoid starving other threads
+      trace.event("backoff");
+      l.unlock();
+      l.lock();
+      continue;
     }
 
     trace.event("finish");
@@ -45,6 +45,7 @@ enum {
   l_objectcacher_write_time_blocked, // total time in seconds spent
 				     // blocking a write due to dirty
 				     // limits
+  l_objectcacher_readahead_bytes, // bytes prefetched by readahead
 
   l_objectcacher_last,
 };
@@ -253,6 +254,12 @@ class ObjectCacher {
     std::map< ceph_tid_t, std::list<Context*> > waitfor_commit;
     xlist<C_ReadFinish*> reads;
 
+    // sequential read detection for readahead
+    loff_t ra_pos = -1;      // where the last read ended
+    loff_t ra_end = 0;       // end of what has been prefetched
+    uint64_t ra_window = 0;
+    unsigned ra_seq = 0;     // sequential reads in a row
+
     Object(const Object&) = delete;
     Object& operator=(const Object&) = delete;
 
@@ -384,6 +391,13 @@ class ObjectCacher {
     int dirty_or_tx;
     bool return_enoent;
 
+    // readahead only runs when the owner sets the object size; it carries
+    // a stream over into the object that follows in the layout, named by
+    // object_name, if one is given
+    uint64_t object_size = 0;
+    uint64_t stripe_count = 1;
+    std::function<object_t(uint64_t)> object_name;
+
     ObjectSet(void *p, int64_t _poolid, inodeno_t i)
       : parent(p), ino(i), truncate_seq(0),
 	truncate_size(0), poolid(_poolid), dirty_or_tx(0),
@@ -402,6 +416,7 @@ class ObjectCacher {
   ceph::mutex& lock;
 
   uint64_t max_dirty, target_dirty, max_size, max_objects;
+  uint64_t readahead_min = 0, readahead_max = 0;
   ceph::timespan max_dirty_age;
   bool block_writes_upfront;
 
@@ -534,7 +549,7 @@ class ObjectCacher {
 			    int64_t *amount, int *max_count);
 
   void trim();
-  void flush(ZTracer::Trace *trace, loff_t amount=0);
+  void flush(ZTracer::Trace *trace, loff_t amount=0, int *max_count=nullptr);
 
   /**
    * flush a range of buffers
@@ -557,6 +572,10 @@ class ObjectCacher {
 
   int _readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
 	     bool external_call, ZTracer::Trace *trace);
+  void _readahead(Object *o, const ObjectExtent& ex, int op_flags,
+		  const ZTracer::Trace &trace);
+  void _prefetch(Object *o, loff_t off, uint64_t len, int op_flags,
+		 const ZTracer::Trace &trace);
   void retry_waiting_reads();
 
  public:
@@ -669,6 +688,11 @@ public:
   void set_max_objects(int64_t v) {
     max_objects = v;
   }
+  /// prefetch window for sequential reads, grown from min to max; 0 disables
+  void set_readahead(uint64_t min, uint64_t max) {
+    readahead_min = std::min(min, max);
+    readahead_max = max;
+  }
 
 
   // file functions
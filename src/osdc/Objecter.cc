@@ -16,6 +16,7 @@
 
 #include "Objecter.h"
 #include "osd/OSDMap.h"
+#include "osd/ECUtil.h"
 #include "Filer.h"
 
 #include "mon/MonClient.h"
@@ -51,6 +52,7 @@
 #include "include/str_list.h"
 #include "common/errno.h"
 #include "common/EventTrace.h"
+#include "erasure-code/ErasureCodePlugin.h"
 
 using std::list;
 using std::make_pair;
@@ -161,6 +163,14 @@ enum {
   l_osdc_osdop_omap_rd,
   l_osdc_osdop_omap_del,
 
+  l_osdc_op_trace_client_lat,
+  l_osdc_op_trace_osd_dispatch_lat,
+  l_osdc_op_trace_osd_queue_lat,
+  l_osdc_op_trace_osd_exec_lat,
+  l_osdc_op_trace_network_lat,
+
+  l_osdc_op_ec_direct_read,
+
   l_osdc_last,
 };
 
@@ -169,6 +179,10 @@ enum {
 
 static const char *config_keys[] = {
   "crush_location",
+  "objecter_balance_reads_by_latency",
+  "objecter_ec_direct_read",
+  "objecter_read_latency_explore_ratio",
+  "objecter_op_trace_sample_ratio",
   NULL
 };
 
@@ -242,6 +256,21 @@ void Objecter::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("crush_location")) {
     update_crush_location();
   }
+  if (changed.count("objecter_balance_reads_by_latency")) {
+    balance_reads_by_latency =
+      conf.get_val<bool>("objecter_balance_reads_by_latency");
+  }
+  if (changed.count("objecter_ec_direct_read")) {
+    ec_direct_read = conf.get_val<bool>("objecter_ec_direct_read");
+  }
+  if (changed.count("objecter_read_latency_explore_ratio")) {
+    read_latency_explore_ratio =
+      conf.get_val<double>("objecter_read_latency_explore_ratio");
+  }
+  if (changed.count("objecter_op_trace_sample_ratio")) {
+    op_trace_sample_ratio =
+      conf.get_val<double>("objecter_op_trace_sample_ratio");
+  }
 }
 
 void Objecter::update_crush_location()
@@ -379,6 +408,27 @@ void Objecter::init()
     pcb.add_u64_counter(l_osdc_osdop_omap_del, "omap_del",
 			"OSD OMAP delete operations");
 
+    // sampled ops only, see objecter_op_trace_sample_ratio
+    pcb.add_time_avg(l_osdc_op_trace_client_lat, "op_trace_client_lat",
+		     "Time from submit until sent", NULL,
+		     PerfCountersBuilder::PRIO_USEFUL);
+    pcb.add_time_avg(l_osdc_op_trace_osd_dispatch_lat,
+		     "op_trace_osd_dispatch_lat",
+		     "Time in the OSD from receipt until dispatch", NULL,
+		     PerfCountersBuilder::PRIO_USEFUL);
+    pcb.add_time_avg(l_osdc_op_trace_osd_queue_lat, "op_trace_osd_queue_lat",
+		     "Time in the OSD op queue", NULL,
+		     PerfCountersBuilder::PRIO_USEFUL);
+    pcb.add_time_avg(l_osdc_op_trace_osd_exec_lat, "op_trace_osd_exec_lat",
+		     "Time in the OSD from dequeue until reply, including commit",
+		     NULL, PerfCountersBuilder::PRIO_USEFUL);
+    pcb.add_time_avg(l_osdc_op_trace_network_lat, "op_trace_network_lat",
+		     "Round trip time outside of the OSD", NULL,
+		     PerfCountersBuilder::PRIO_USEFUL);
+
+    pcb.add_u64_counter(l_osdc_op_ec_direct_read, "op_ec_direct_read",
+			"Reads decoded from the erasure coded shards");
+
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -489,15 +539,17 @@ void Objecter::shutdown()
     lop->put();
   }
 
-  while(!homeless_session->ops.empty()) {
-    std::map<ceph_tid_t, Op*>::iterator i = homeless_session->ops.begin();
-    ldout(cct, 10) << " op " << i->first << dendl;
-    Op *op = i->second;
-    {
-      OSDSession::unique_lock swl(homeless_session->lock);
-      _session_op_remove(homeless_session, op);
+  for (auto& shard : homeless_session->op_shards) {
+    while (!shard.ops.empty()) {
+      std::map<ceph_tid_t, Op*>::iterator i = shard.ops.begin();
+      ldout(cct, 10) << " op " << i->first << dendl;
+      Op *op = i->second;
+      {
+	OSDSession::unique_lock swl(homeless_session->lock);
+	_session_op_remove(homeless_session, op);
+      }
+      op->put();
     }
-    op->put();
   }
 
   while(!homeless_session->command_ops.empty()) {
@@ -587,8 +639,7 @@ void Objecter::_send_linger(LingerOp *info,
   if (info->register_tid) {
     // repeat send.  cancel old registration op, if any.
     OSDSession::unique_lock sl(info->session->lock);
-    if (info->session->ops.count(info->register_tid)) {
-      Op *o = info->session->ops[info->register_tid];
+    if (Op *o = info->session->find_op(info->register_tid); o) {
       _op_cancel_map_check(o);
       _cancel_linger_op(o);
     }
@@ -1080,31 +1131,33 @@ void Objecter::_scan_requests(
   }
 
   // check for changed request mappings
-  map<ceph_tid_t,Op*>::iterator p = s->ops.begin();
-  while (p != s->ops.end()) {
-    Op *op = p->second;
-    ++p;   // check_op_pool_dne() may touch ops; prevent iterator invalidation
-    ldout(cct, 10) << " checking op " << op->tid << dendl;
-    _prune_snapc(osdmap->get_new_removed_snaps(), op);
-    bool force_resend_writes = cluster_full;
-    if (pool_full_map)
-      force_resend_writes = force_resend_writes ||
-	(*pool_full_map)[op->target.base_oloc.pool];
-    int r = _calc_target(&op->target,
-			 op->session ? op->session->con.get() : nullptr);
-    switch (r) {
-    case RECALC_OP_TARGET_NO_ACTION:
-      if (!skipped_map && !(force_resend_writes && op->target.respects_full()))
+  for (auto& shard : s->op_shards) {
+    map<ceph_tid_t,Op*>::iterator p = shard.ops.begin();
+    while (p != shard.ops.end()) {
+      Op *op = p->second;
+      ++p;   // check_op_pool_dne() may touch ops; prevent iterator invalidation
+      ldout(cct, 10) << " checking op " << op->tid << dendl;
+      _prune_snapc(osdmap->get_new_removed_snaps(), op);
+      bool force_resend_writes = cluster_full;
+      if (pool_full_map)
+	force_resend_writes = force_resend_writes ||
+	  (*pool_full_map)[op->target.base_oloc.pool];
+      int r = _calc_target(&op->target,
+			   op->session ? op->session->con.get() : nullptr);
+      switch (r) {
+      case RECALC_OP_TARGET_NO_ACTION:
+	if (!skipped_map && !(force_resend_writes && op->target.respects_full()))
+	  break;
+	// -- fall-thru --
+      case RECALC_OP_TARGET_NEED_RESEND:
+	_session_op_remove(op->session, op);
+	need_resend[op->tid] = op;
+	_op_cancel_map_check(op);
 	break;
-      // -- fall-thru --
-    case RECALC_OP_TARGET_NEED_RESEND:
-      _session_op_remove(op->session, op);
-      need_resend[op->tid] = op;
-      _op_cancel_map_check(op);
-      break;
-    case RECALC_OP_TARGET_POOL_DNE:
-      _check_op_pool_dne(op, &sl);
-      break;
+      case RECALC_OP_TARGET_POOL_DNE:
+	_check_op_pool_dne(op, &sl);
+	break;
+      }
     }
   }
 
@@ -1207,6 +1260,8 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	else if (m->maps.count(e)) {
 	  ldout(cct, 3) << "handle_osd_map decoding full epoch " << e << dendl;
           auto new_osdmap = std::make_unique<OSDMap>();
+          new_osdmap->set_crush_cache_size(
+	    cct->_conf.get_val<uint64_t>("objecter_crush_cache_size"));
           new_osdmap->decode(m->maps[e]);
 
           emit_blacklist_events(*osdmap, *new_osdmap);
@@ -1873,11 +1928,13 @@ void Objecter::close_session(OSDSession *s)
     _session_linger_op_remove(s, i->second);
   }
 
-  while (!s->ops.empty()) {
-    std::map<ceph_tid_t, Op*>::iterator i = s->ops.begin();
-    ldout(cct, 10) << " op " << i->first << dendl;
-    homeless_ops.push_back(i->second);
-    _session_op_remove(s, i->second);
+  for (auto& shard : s->op_shards) {
+    while (!shard.ops.empty()) {
+      std::map<ceph_tid_t, Op*>::iterator i = shard.ops.begin();
+      ldout(cct, 10) << " op " << i->first << dendl;
+      homeless_ops.push_back(i->second);
+      _session_op_remove(s, i->second);
+    }
   }
 
   while (!s->command_ops.empty()) {
@@ -2045,16 +2102,18 @@ void Objecter::_kick_requests(OSDSession *session,
 
   // resend ops
   map<ceph_tid_t,Op*> resend;  // resend in tid order
-  for (map<ceph_tid_t, Op*>::iterator p = session->ops.begin();
-       p != session->ops.end();) {
-    Op *op = p->second;
-    ++p;
-    if (op->should_resend) {
-      if (!op->target.paused)
-	resend[op->tid] = op;
-    } else {
-      _op_cancel_map_check(op);
-      _cancel_linger_op(op);
+  for (auto& shard : session->op_shards) {
+    for (map<ceph_tid_t, Op*>::iterator p = shard.ops.begin();
+	 p != shard.ops.end();) {
+      Op *op = p->second;
+      ++p;
+      if (op->should_resend) {
+	if (!op->target.paused)
+	  resend[op->tid] = op;
+      } else {
+	_op_cancel_map_check(op);
+	_cancel_linger_op(op);
+      }
     }
   }
 
@@ -2140,18 +2199,15 @@ void Objecter::tick()
     OSDSession *s = siter->second;
     OSDSession::lock_guard l(s->lock);
     bool found = false;
-    for (map<ceph_tid_t,Op*>::iterator p = s->ops.begin();
-	p != s->ops.end();
-	++p) {
-      Op *op = p->second;
-      ceph_assert(op->session);
-      if (op->stamp < cutoff) {
-	ldout(cct, 2) << " tid " << p->first << " on osd." << op->session->osd
-		      << " is laggy" << dendl;
-	found = true;
-	++laggy_ops;
-      }
-    }
+    s->for_each_op([&](Op *op) {
+	ceph_assert(op->session);
+	if (op->stamp < cutoff) {
+	  ldout(cct, 2) << " tid " << op->tid << " on osd." << op->session->osd
+			<< " is laggy" << dendl;
+	  found = true;
+	  ++laggy_ops;
+	}
+      });
     for (map<uint64_t,LingerOp*>::iterator p = s->linger_ops.begin();
 	p != s->linger_ops.end();
 	++p) {
@@ -2260,9 +2316,25 @@ void Objecter::op_submit(Op *op, ceph_tid_t *ptid, int *ctx_budget)
   if (!ptid)
     ptid = &tid;
   op->trace.event("op submit");
+  if (!ctx_budget && _ec_direct_read(op, rl))
+    return;
   _op_submit_with_budget(op, rl, ptid, ctx_budget);
 }
 
+void Objecter::op_submit(std::vector<std::pair<Op*, ceph_tid_t*>>& ops)
+{
+  // one trip through rwlock, and messages to the same osd that go out
+  // back to back get written together
+  shunique_lock rl(rwlock, ceph::acquire_shared);
+  for (auto& [op, ptid] : ops) {
+    ceph_tid_t tid = 0;
+    op->trace.event("op submit");
+    if (_ec_direct_read(op, rl))
+      continue;
+    _op_submit_with_budget(op, rl, ptid ? ptid : &tid, nullptr);
+  }
+}
+
 void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
 				      ceph_tid_t *ptid,
 				      int *ctx_budget)
@@ -2273,6 +2345,12 @@ void Objecter::_op_submit_with_budget(Op *op, shunique_lock& sul,
   ceph_assert(op->ops.size() == op->out_rval.size());
   ceph_assert(op->ops.size() == op->out_handler.size());
 
+  if (op_trace_sample_ratio > 0 &&
+      rand() < op_trace_sample_ratio * RAND_MAX) {
+    op->trace_stages = true;
+    op->submit_stamp = ceph::mono_clock::now();
+  }
+
   // throttle.  before we look at any state, because
   // _take_op_budget() may drop our lock while it blocks.
   if (!op->ctx_budgeted || (ctx_budget && (*ctx_budget == -1))) {
@@ -2431,7 +2509,9 @@ void Objecter::_op_submit(Op *op, shunique_lock& sul, ceph_tid_t *ptid)
     _maybe_request_map();
   }
 
-  OSDSession::unique_lock sl(s->lock);
+  // shared is enough to add an op and send it; whatever has to look at
+  // all the ops of the session takes the lock unique
+  OSDSession::shared_lock sl(s->lock);
   if (op->tid == 0)
     op->tid = ++last_tid;
 
@@ -2469,8 +2549,8 @@ int Objecter::op_cancel(OSDSession *s, ceph_tid_t tid, int r)
 
   OSDSession::unique_lock sl(s->lock);
 
-  map<ceph_tid_t, Op*>::iterator p = s->ops.find(tid);
-  if (p == s->ops.end()) {
+  Op *op = s->find_op(tid);
+  if (!op) {
     ldout(cct, 10) << __func__ << " tid " << tid << " dne in session "
 		   << s->osd << dendl;
     return -ENOENT;
@@ -2486,7 +2566,6 @@ int Objecter::op_cancel(OSDSession *s, ceph_tid_t tid, int r)
 
   ldout(cct, 10) << __func__ << " tid " << tid << " in session " << s->osd
 		 << dendl;
-  Op *op = p->second;
   if (op->onfinish) {
     num_in_flight--;
     op->onfinish->complete(r);
@@ -2532,7 +2611,7 @@ start:
        siter != osd_sessions.end(); ++siter) {
     OSDSession *s = siter->second;
     OSDSession::shared_lock sl(s->lock);
-    if (s->ops.find(tid) != s->ops.end()) {
+    if (s->find_op(tid)) {
       sl.unlock();
       ret = op_cancel(s, tid, r);
       if (ret == -ENOENT) {
@@ -2548,7 +2627,7 @@ start:
 
   // Handle case where the op is in homeless session
   OSDSession::shared_lock sl(homeless_session->lock);
-  if (homeless_session->ops.find(tid) != homeless_session->ops.end()) {
+  if (homeless_session->find_op(tid)) {
     sl.unlock();
     ret = op_cancel(homeless_session, tid, r);
     if (ret == -ENOENT) {
@@ -2579,13 +2658,12 @@ epoch_t Objecter::op_cancel_writes(int r, int64_t pool)
        siter != osd_sessions.end(); ++siter) {
     OSDSession *s = siter->second;
     OSDSession::shared_lock sl(s->lock);
-    for (map<ceph_tid_t, Op*>::iterator op_i = s->ops.begin();
-	 op_i != s->ops.end(); ++op_i) {
-      if (op_i->second->target.flags & CEPH_OSD_FLAG_WRITE
-	  && (pool == -1 || op_i->second->target.target_oloc.pool == pool)) {
-	to_cancel.push_back(op_i->first);
-      }
-    }
+    s->for_each_op([&](Op *op) {
+	if (op->target.flags & CEPH_OSD_FLAG_WRITE
+	    && (pool == -1 || op->target.target_oloc.pool == pool)) {
+	  to_cancel.push_back(op->tid);
+	}
+      });
     sl.unlock();
 
     for (std::vector<ceph_tid_t>::iterator titer = to_cancel.begin();
@@ -2756,6 +2834,333 @@ void Objecter::_prune_snapc(
   }
 }
 
+int Objecter::_pick_fastest_replica(const std::vector<int>& acting)
+{
+  // now and then go anywhere, so that the estimate of a replica that was
+  // slow once doesn't keep it unused forever
+  if (read_latency_explore_ratio > 0 &&
+      rand() < read_latency_explore_ratio * RAND_MAX) {
+    return rand() % acting.size();
+  }
+  // osds we have no sample for yet come first; prefer the primary on ties
+  int best = 0;
+  uint32_t best_lat = std::numeric_limits<uint32_t>::max();
+  for (unsigned i = 0; i < acting.size(); ++i) {
+    auto p = osd_sessions.find(acting[i]);
+    uint32_t lat = p == osd_sessions.end() ? 0 : p->second->read_lat_us.load();
+    ldout(cct, 20) << __func__ << " osd." << acting[i]
+		   << " read latency " << lat << "us" << dendl;
+    if (lat < best_lat) {
+      best = i;
+      best_lat = lat;
+    }
+  }
+  return best;
+}
+
+void Objecter::_account_op_stages(Op *op, MOSDOpReply *m)
+{
+  // older osds reply without the osd side
+  auto& osd_usec = m->get_stage_usec();
+  if (osd_usec.size() < 3) {
+    return;
+  }
+  using std::chrono::microseconds;
+  auto now = ceph::mono_clock::now();
+  logger->tinc(l_osdc_op_trace_client_lat, op->sent_stamp - op->submit_stamp);
+  logger->tinc(l_osdc_op_trace_osd_dispatch_lat, microseconds(osd_usec[0]));
+  logger->tinc(l_osdc_op_trace_osd_queue_lat, microseconds(osd_usec[1]));
+  logger->tinc(l_osdc_op_trace_osd_exec_lat, microseconds(osd_usec[2]));
+  ceph::timespan osd = microseconds(
+    (uint64_t)osd_usec[0] + osd_usec[1] + osd_usec[2]);
+  ceph::timespan rtt = now - op->sent_stamp;
+  logger->tinc(l_osdc_op_trace_network_lat,
+	       rtt > osd ? rtt - osd : ceph::timespan::zero());
+}
+
+void Objecter::_update_read_latency(OSDSession *s, Op *op)
+{
+  // caller holds s->lock; replies on a session come in one at a time, and
+  // should two race, losing a sample of an average is harmless
+  auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+    ceph::mono_clock::now() - op->sent_stamp).count();
+  uint32_t lat = std::clamp<int64_t>(
+    usec, 1, std::numeric_limits<uint32_t>::max());
+  uint32_t old = s->read_lat_us;
+  s->read_lat_us = old ? (uint32_t)(((uint64_t)old * 7 + lat) / 8) : lat;
+}
+
+// ec direct reads ------------------------------------------------------
+// A plain read of an ec object is sent to the osds holding the data shards
+// it covers, or to enough shards to decode them if some are down, and the
+// chunks are decoded here.  Each shard also stats the object, and a shard
+// read that fails or sees another version than the others sends the read
+// back to the primary.
+
+struct Objecter::ECDirectRead {
+  struct Shard {
+    ceph::buffer::list bl;
+    uint64_t size = 0;
+    version_t version = 0;
+    int stat_r = 0;
+    int read_r = 0;
+    int r = 0;
+  };
+
+  Op *op;  ///< the client read, completed or resent by us
+  ceph::ErasureCodeInterfaceRef ec_impl;
+  ECUtil::stripe_info_t sinfo;
+  uint64_t off, len;        ///< the client read
+  uint64_t stripe_off;      ///< logical offset of the first stripe read
+  uint64_t chunk_len;       ///< read from each shard
+  std::set<int> want;       ///< data shards holding the read
+  std::map<int, Shard> shards;
+  std::mutex lock;
+  unsigned pending = 0;
+
+  ECDirectRead(Op *op, ceph::ErasureCodeInterfaceRef ec_impl,
+	       uint64_t stripe_width)
+    : op(op), ec_impl(ec_impl),
+      sinfo(ec_impl->get_data_chunk_count(), stripe_width) {}
+};
+
+struct C_ECDirectRead_Shard : public Context {
+  Objecter *objecter;
+  Objecter::ECDirectRead *rd;
+  int shard;
+  C_ECDirectRead_Shard(Objecter *objecter, Objecter::ECDirectRead *rd,
+		       int shard)
+    : objecter(objecter), rd(rd), shard(shard) {}
+  void finish(int r) override {
+    bool last;
+    {
+      std::lock_guard l(rd->lock);
+      rd->shards[shard].r = r;
+      last = --rd->pending == 0;
+    }
+    if (last) {
+      objecter->_finish_ec_direct_read(rd);
+    }
+  }
+};
+
+ceph::ErasureCodeInterfaceRef Objecter::_get_ec_impl(const pg_pool_t& pi)
+{
+  // rwlock is locked
+  std::lock_guard l(ec_lock);
+  auto p = ec_impls.find(pi.erasure_code_profile);
+  if (p != ec_impls.end()) {
+    return p->second;
+  }
+  ceph::ErasureCodeProfile profile =
+    osdmap->get_erasure_code_profile(pi.erasure_code_profile);
+  ceph::ErasureCodeInterfaceRef ec_impl;
+  auto plugin = profile.find("plugin");
+  if (plugin != profile.end()) {
+    std::stringstream ss;
+    int r = ceph::ErasureCodePluginRegistry::instance().factory(
+      plugin->second,
+      cct->_conf.get_val<std::string>("erasure_code_dir"),
+      profile,
+      &ec_impl,
+      &ss);
+    if (r < 0) {
+      lderr(cct) << __func__ << " profile " << pi.erasure_code_profile
+		 << ": " << ss.str() << dendl;
+      ec_impl.reset();
+    }
+  }
+  ec_impls[pi.erasure_code_profile] = ec_impl;
+  return ec_impl;
+}
+
+bool Objecter::_ec_direct_read(Op *op, shunique_lock& sul)
+{
+  if (!ec_direct_read || op->no_ec_direct_read || op->ops.size() != 1) {
+    return false;
+  }
+  const ceph_osd_op& rop = op->ops[0].op;
+  if (rop.op != CEPH_OSD_OP_READ || rop.extent.length == 0 ||
+      rop.extent.truncate_seq ||
+      (op->target.flags & (CEPH_OSD_FLAG_WRITE | CEPH_OSD_FLAG_RWORDERED))) {
+    return false;
+  }
+
+  op_target_t t = op->target;
+  if (_calc_target(&t, nullptr) == RECALC_OP_TARGET_POOL_DNE ||
+      t.osd < 0 || t.paused || t.target_oloc.pool != t.base_oloc.pool) {
+    return false;
+  }
+  const pg_pool_t *pi = osdmap->get_pg_pool(t.base_oloc.pool);
+  if (!pi || !pi->is_erasure() || !pi->get_stripe_width()) {
+    return false;
+  }
+  auto ec_impl = _get_ec_impl(*pi);
+  if (!ec_impl || ec_impl->get_sub_chunk_count() != 1) {
+    return false;
+  }
+
+  auto rd = new ECDirectRead(op, ec_impl, pi->get_stripe_width());
+  rd->off = rop.extent.offset;
+  rd->len = rop.extent.length;
+  auto bounds = rd->sinfo.offset_len_to_stripe_bounds(
+    std::make_pair(rd->off, rd->len));
+  rd->stripe_off = bounds.first;
+  auto chunk = rd->sinfo.aligned_offset_len_to_chunk(bounds);
+  rd->chunk_len = chunk.second;
+
+  std::set<int> data_chunks;
+  rd->sinfo.offset_len_to_data_chunks(std::make_pair(rd->off, rd->len),
+				      &data_chunks);
+  const std::vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+  for (auto i : data_chunks) {
+    rd->want.insert((int)chunk_mapping.size() > i ? chunk_mapping[i] : i);
+  }
+  std::set<int> avail;
+  for (unsigned i = 0; i < t.acting.size(); ++i) {
+    if (t.acting[i] != CRUSH_ITEM_NONE && osdmap->is_up(t.acting[i])) {
+      avail.insert(i);
+    }
+  }
+  std::map<int, std::vector<std::pair<int, int>>> need;
+  if (ec_impl->minimum_to_decode(rd->want, avail, &need) < 0) {
+    delete rd;
+    return false;
+  }
+  ldout(cct, 10) << __func__ << " " << t.base_oid << " " << rd->off << "~"
+		 << rd->len << " from shards " << need << dendl;
+
+  for (auto& i : need) {
+    rd->shards[i.first];
+  }
+  rd->pending = rd->shards.size();
+  // the replies may complete the read before we are done sending
+  std::vector<Op*> sub_ops;
+  for (auto& [shard, s] : rd->shards) {
+    ObjectOperation sub;
+    sub.stat(&s.size, (ceph::real_time *)nullptr, &s.stat_r);
+    sub.shard_read(chunk.first, chunk.second, &s.bl, &s.read_r);
+    Op *o = prepare_read_op(
+      op->target.base_oid, op->target.base_oloc, sub, op->snapid, nullptr,
+      op->target.flags | CEPH_OSD_FLAG_BALANCE_READS,
+      new C_ECDirectRead_Shard(this, rd, shard), &s.version);
+    o->priority = op->priority;
+    o->target.ec_shard = shard;
+    o->no_ec_direct_read = true;
+    sub_ops.push_back(o);
+  }
+  for (auto o : sub_ops) {
+    ceph_tid_t tid = 0;
+    _op_submit_with_budget(o, sul, &tid, nullptr);
+  }
+  return true;
+}
+
+void Objecter::_finish_ec_direct_read(ECDirectRead *rd)
+{
+  // decode and complete from the finisher: the last shard may complete
+  // inside op_submit, and falling back resubmits
+  finisher->queue(new LambdaContext([this, rd](int) {
+    std::unique_ptr<ECDirectRead> rdp(rd);
+    Op *op = rd->op;
+    int r = 0;
+    const ECDirectRead::Shard *first = nullptr;
+    for (auto& [shard, s] : rd->shards) {
+      if (s.r < 0 || s.stat_r < 0 || s.read_r < 0) {
+	ldout(cct, 10) << "ec_direct_read shard " << shard << " r=" << s.r
+		       << dendl;
+	r = -EAGAIN;
+	break;
+      }
+      if (first &&
+	  (s.version != first->version || s.size != first->size)) {
+	ldout(cct, 10) << "ec_direct_read shard " << shard << " v"
+		       << s.version << " != v" << first->version << dendl;
+	r = -EAGAIN;
+	break;
+      }
+      first = &s;
+    }
+
+    // the shards are padded to whole stripes only up to the object size
+    ceph::buffer::list data;
+    if (r == 0) {
+      uint64_t chunk_size = rd->sinfo.get_chunk_size();
+      std::map<int, ceph::buffer::list> to_decode;
+      for (auto& [shard, s] : rd->shards) {
+	auto& bl = to_decode[shard];
+	bl.claim(s.bl);
+	if (bl.length() < rd->chunk_len) {
+	  bl.append_zero(rd->chunk_len - bl.length());
+	}
+      }
+      const std::vector<int> &chunk_mapping =
+	rd->ec_impl->get_chunk_mapping();
+      unsigned k = rd->ec_impl->get_data_chunk_count();
+      ceph::buffer::list stripes;
+      for (uint64_t i = 0; r == 0 && i < rd->chunk_len; i += chunk_size) {
+	std::map<int, ceph::buffer::list> chunks, decoded;
+	for (auto& j : to_decode) {
+	  chunks[j.first].substr_of(j.second, i, chunk_size);
+	}
+	r = rd->ec_impl->decode(rd->want, chunks, &decoded, chunk_size);
+	for (unsigned j = 0; r == 0 && j < k; ++j) {
+	  int chunk = chunk_mapping.size() > j ? chunk_mapping[j] : (int)j;
+	  if (rd->want.count(chunk)) {
+	    stripes.claim_append(decoded[chunk]);
+	  } else {
+	    stripes.append_zero(chunk_size);
+	  }
+	}
+      }
+      uint64_t end = std::min(rd->off + rd->len, first->size);
+      if (r == 0 && rd->off < end) {
+	data.substr_of(stripes, rd->off - rd->stripe_off, end - rd->off);
+      }
+    }
+
+    if (r < 0) {
+      ldout(cct, 10) << "ec_direct_read " << op->target.base_oid
+		     << " resending to the primary" << dendl;
+      op->no_ec_direct_read = true;
+      op_submit(op);
+      return;
+    }
+
+    logger->inc(l_osdc_op_ec_direct_read);
+    if (op->objver)
+      *op->objver = first->version;
+    if (op->outbl) {
+      if (op->outbl->length() == data.length() &&
+	  data.get_num_buffers() <= 1) {
+	// read into the caller's buffer, @see handle_osd_op_reply
+	ceph::buffer::list t;
+	t.claim(*op->outbl);
+	t.invalidate_crc();
+	data.begin().copy(data.length(), t.c_str());
+	op->outbl->substr_of(t, 0, data.length());
+      } else {
+	*op->outbl = data;
+      }
+      op->outbl = nullptr;
+    }
+    if (op->out_bl[0])
+      *op->out_bl[0] = data;
+    if (op->out_rval[0])
+      *op->out_rval[0] = 0;
+    if (op->out_handler[0]) {
+      op->out_handler[0]->complete(0);
+      op->out_handler[0] = nullptr;
+    }
+    Context *onfinish = op->onfinish;
+    op->onfinish = nullptr;
+    op->put();
+    if (onfinish) {
+      onfinish->complete(0);
+    }
+  }));
+}
+
 int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
 {
   // rwlock is locked
@@ -2911,7 +3316,9 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
     t->pg_num_mask = pg_num_mask;
     t->pg_num_pending = pg_num_pending;
     spg_t spgid(actual_pgid);
-    if (pi->is_erasure()) {
+    if (pi->is_erasure() && t->ec_shard >= 0) {
+      spgid.reset_shard(shard_id_t(t->ec_shard));
+    } else if (pi->is_erasure()) {
       for (uint8_t i = 0; i < acting.size(); ++i) {
         if (acting[i] == acting_primary) {
           spgid.reset_shard(shard_id_t(i));
@@ -2932,13 +3339,27 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
     } else {
       int osd;
       bool read = is_read && !is_write;
-      if (read && (t->flags & CEPH_OSD_FLAG_BALANCE_READS)) {
-	int p = rand() % acting.size();
+      if (read && t->ec_shard >= 0) {
+	// the osd holding the shard, or none until it maps to one
+	osd = (unsigned)t->ec_shard < acting.size() ?
+	  acting[t->ec_shard] : CRUSH_ITEM_NONE;
+	if (osd == CRUSH_ITEM_NONE)
+	  osd = -1;
+	t->used_replica = osd != acting_primary;
+	ldout(cct, 10) << " shard " << t->ec_shard << " on osd." << osd
+		       << dendl;
+      } else if (read && (t->flags & CEPH_OSD_FLAG_BALANCE_READS)) {
+	int p;
+	if (balance_reads_by_latency && acting.size() > 1) {
+	  p = _pick_fastest_replica(acting);
+	} else {
+	  p = rand() % acting.size();
+	}
 	if (p)
 	  t->used_replica = true;
 	osd = acting[p];
-	ldout(cct, 10) << " chose random osd." << osd << " of " << acting
-		       << dendl;
+	ldout(cct, 10) << " chose " << (balance_reads_by_latency ? "" : "random ")
+		       << "osd." << osd << " of " << acting << dendl;
       } else if (read && (t->flags & CEPH_OSD_FLAG_LOCALIZE_READS) &&
 		 acting.size() > 1) {
 	// look for a local replica.  prefer the primary if the
@@ -2996,7 +3417,11 @@ void Objecter::_session_op_assign(OSDSession *to, Op *op)
 
   get_session(to);
   op->session = to;
-  to->ops[op->tid] = op;
+  {
+    auto& shard = to->get_op_shard(op->tid);
+    std::lock_guard l(shard.lock);
+    shard.ops[op->tid] = op;
+  }
 
   if (to->is_homeless()) {
     num_homeless_ops++;
@@ -3014,7 +3439,11 @@ void Objecter::_session_op_remove(OSDSession *from, Op *op)
     num_homeless_ops--;
   }
 
-  from->ops.erase(op->tid);
+  {
+    auto& shard = from->get_op_shard(op->tid);
+    std::lock_guard l(shard.lock);
+    shard.ops.erase(op->tid);
+  }
   put_session(from);
   op->session = NULL;
 
@@ -3136,7 +3565,7 @@ void Objecter::_finish_op(Op *op, int r)
 {
   ldout(cct, 15) << __func__ << " " << op->tid << dendl;
 
-  // op->session->lock is locked unique or op->session is null
+  // op->session->lock is locked or op->session is null
 
   if (!op->ctx_budgeted && op->budget >= 0) {
     put_op_budget_bytes(op->budget);
@@ -3173,8 +3602,12 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
   if (!honor_pool_full)
     flags |= CEPH_OSD_FLAG_FULL_FORCE;
 
+  if (op->trace_stages)
+    flags |= CEPH_OSD_FLAG_TRACE_STAGES;
+
   op->target.paused = false;
   op->stamp = ceph::coarse_mono_clock::now();
+  op->sent_stamp = ceph::mono_clock::now();
 
   hobject_t hobj = op->target.get_hobj();
   MOSDOp *m = new MOSDOp(client_inc, op->tid,
@@ -3361,10 +3794,12 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
-  OSDSession::unique_lock sl(s->lock);
+  // the op is ours once found: everything else that might finish it
+  // takes the session lock unique
+  OSDSession::shared_lock sl(s->lock);
 
-  map<ceph_tid_t, Op *>::iterator iter = s->ops.find(tid);
-  if (iter == s->ops.end()) {
+  Op *op = s->find_op(tid);
+  if (!op) {
     ldout(cct, 7) << "handle_osd_op_reply " << tid
 		  << (m->is_ondisk() ? " ondisk" : (m->is_onnvram() ?
 						    " onnvram" : " ack"))
@@ -3381,7 +3816,6 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 		<< " in " << m->get_pg()
 		<< " attempt " << m->get_retry_attempt()
 		<< dendl;
-  Op *op = iter->second;
   op->trace.event("osd op reply");
 
   if (retry_writes_after_first_reply && op->attempts == 1 &&
@@ -3439,7 +3873,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
-  if (rc == -EAGAIN) {
+  if (rc == -EAGAIN && op->target.ec_shard < 0) {
     ldout(cct, 7) << " got -EAGAIN, resubmitting" << dendl;
     if (op->onfinish)
       num_in_flight--;
@@ -3455,6 +3889,14 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
+  if (balance_reads_by_latency && rc >= 0 &&
+      !(op->target.flags & CEPH_OSD_FLAG_WRITE)) {
+    _update_read_latency(s, op);
+  }
+  if (op->trace_stages) {
+    _account_op_stages(op, m);
+  }
+
   sul.unlock();
 
   if (op->objver)
@@ -3629,13 +4071,15 @@ void Objecter::handle_osd_backoff(MOSDBackoff *m)
 	s->backoffs_by_id.erase(p);
 
 	// check for any ops to resend
-	for (auto& q : s->ops) {
-	  if (q.second->target.actual_pgid == m->pgid) {
-	    int r = q.second->target.contained_by(m->begin, m->end);
-	    ldout(cct, 20) << __func__ <<  " contained_by " << r << " on "
-			   << q.second->target.get_hobj() << dendl;
-	    if (r) {
-	      _send_op(q.second);
+	for (auto& shard : s->op_shards) {
+	  for (auto& q : shard.ops) {
+	    if (q.second->target.actual_pgid == m->pgid) {
+	      int r = q.second->target.contained_by(m->begin, m->end);
+	      ldout(cct, 20) << __func__ <<  " contained_by " << r << " on "
+			     << q.second->target.get_hobj() << dendl;
+	      if (r) {
+		_send_op(q.second);
+	      }
 	    }
 	  }
 	}
@@ -4467,15 +4911,12 @@ void Objecter::op_target_t::dump(Formatter *f) const
 
 void Objecter::_dump_active(OSDSession *s)
 {
-  for (map<ceph_tid_t,Op*>::iterator p = s->ops.begin();
-       p != s->ops.end();
-       ++p) {
-    Op *op = p->second;
-    ldout(cct, 20) << op->tid << "\t" << op->target.pgid
-		   << "\tosd." << (op->session ? op->session->osd : -1)
-		   << "\t" << op->target.base_oid
-		   << "\t" << op->ops << dendl;
-  }
+  s->for_each_op([&](Op *op) {
+      ldout(cct, 20) << op->tid << "\t" << op->target.pgid
+		     << "\tosd." << (op->session ? op->session->osd : -1)
+		     << "\t" << op->target.base_oid
+		     << "\t" << op->ops << dendl;
+    });
 }
 
 void Objecter::_dump_active()
@@ -4514,31 +4955,28 @@ void Objecter::dump_requests(Formatter *fmt)
 
 void Objecter::_dump_ops(const OSDSession *s, Formatter *fmt)
 {
-  for (map<ceph_tid_t,Op*>::const_iterator p = s->ops.begin();
-       p != s->ops.end();
-       ++p) {
-    Op *op = p->second;
-    auto age = std::chrono::duration<double>(ceph::coarse_mono_clock::now() - op->stamp);
-    fmt->open_object_section("op");
-    fmt->dump_unsigned("tid", op->tid);
-    op->target.dump(fmt);
-    fmt->dump_stream("last_sent") << op->stamp;
-    fmt->dump_float("age", age.count());
-    fmt->dump_int("attempts", op->attempts);
-    fmt->dump_stream("snapid") << op->snapid;
-    fmt->dump_stream("snap_context") << op->snapc;
-    fmt->dump_stream("mtime") << op->mtime;
-
-    fmt->open_array_section("osd_ops");
-    for (vector<OSDOp>::const_iterator it = op->ops.begin();
-	 it != op->ops.end();
-	 ++it) {
-      fmt->dump_stream("osd_op") << *it;
-    }
-    fmt->close_section(); // osd_ops array
+  s->for_each_op([&](Op *op) {
+      auto age = std::chrono::duration<double>(ceph::coarse_mono_clock::now() - op->stamp);
+      fmt->open_object_section("op");
+      fmt->dump_unsigned("tid", op->tid);
+      op->target.dump(fmt);
+      fmt->dump_stream("last_sent") << op->stamp;
+      fmt->dump_float("age", age.count());
+      fmt->dump_int("attempts", op->attempts);
+      fmt->dump_stream("snapid") << op->snapid;
+      fmt->dump_stream("snap_context") << op->snapc;
+      fmt->dump_stream("mtime") << op->mtime;
+
+      fmt->open_array_section("osd_ops");
+      for (vector<OSDOp>::const_iterator it = op->ops.begin();
+	   it != op->ops.end();
+	   ++it) {
+	fmt->dump_stream("osd_op") << *it;
+      }
+      fmt->close_section(); // osd_ops array
 
-    fmt->close_section(); // op object
-  }
+      fmt->close_section(); // op object
+    });
 }
 
 void Objecter::dump_ops(Formatter *fmt)
@@ -4957,7 +5395,7 @@ Objecter::OSDSession::~OSDSession()
 {
   // Caller is responsible for re-assigning or
   // destroying any ops that were assigned to us
-  ceph_assert(ops.empty());
+  ceph_assert(ops_empty());
   ceph_assert(linger_ops.empty());
   ceph_assert(command_ops.empty());
 }
@@ -4975,8 +5413,18 @@ Objecter::Objecter(CephContext *cct_, Messenger *m, MonClient *mc,
   op_throttle_bytes(cct, "objecter_bytes",
 		    cct->_conf->objecter_inflight_op_bytes),
   op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops),
-  retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply)
-{}
+  retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply),
+  balance_reads_by_latency(
+    cct->_conf.get_val<bool>("objecter_balance_reads_by_latency")),
+  ec_direct_read(cct->_conf.get_val<bool>("objecter_ec_direct_read")),
+  read_latency_explore_ratio(
+    cct->_conf.get_val<double>("objecter_read_latency_explore_ratio")),
+  op_trace_sample_ratio(
+    cct->_conf.get_val<double>("objecter_op_trace_sample_ratio"))
+{
+  osdmap->set_crush_cache_size(
+    cct->_conf.get_val<uint64_t>("objecter_crush_cache_size"));
+}
 
 Objecter::~Objecter()
 {
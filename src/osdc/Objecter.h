@@ -15,6 +15,7 @@
 #ifndef CEPH_OBJECTER_H
 #define CEPH_OBJECTER_H
 
+#include <array>
 #include <condition_variable>
 #include <list>
 #include <map>
@@ -40,6 +41,8 @@
 #include "common/Finisher.h"
 #include "common/Throttle.h"
 
+#include "erasure-code/ErasureCodeInterface.h"
+
 #include "messages/MOSDOp.h"
 #include "msg/Dispatcher.h"
 
@@ -326,6 +329,15 @@ struct ObjectOperation {
     out_rval[p] = prval;
     out_handler[p] = ctx;
   }
+  /// off~len of the chunks of the ec shard the op is sent to
+  void shard_read(uint64_t off, uint64_t len, ceph::buffer::list *pbl,
+		  int *prval) {
+    ceph::buffer::list bl;
+    add_data(CEPH_OSD_OP_SHARD_READ, off, len, bl);
+    unsigned p = ops.size() - 1;
+    out_bl[p] = pbl;
+    out_rval[p] = prval;
+  }
 
   struct C_ObjectOperation_sparse_read : public Context {
     ceph::buffer::list bl;
@@ -1407,6 +1419,8 @@ public:
 
     int osd = -1;      ///< the final target osd, or -1
 
+    int ec_shard = -1; ///< ec shard to read from, or -1 for the primary
+
     epoch_t last_force_resend = 0;
 
     op_target_t(object_t oid, object_locator_t oloc, int flags)
@@ -1478,6 +1492,9 @@ public:
     epoch_t *reply_epoch;
 
     ceph::coarse_mono_time stamp;
+    ceph::mono_time sent_stamp;  ///< precise send time, for read latency
+    bool trace_stages = false;   ///< sampled for per-stage latency
+    ceph::mono_time submit_stamp;
 
     epoch_t map_dne_bound;
 
@@ -1494,6 +1511,9 @@ public:
 
     int *data_offset;
 
+    /// true if the read must not be served from the ec shards directly
+    bool no_ec_direct_read = false;
+
     osd_reqid_t reqid; // explicitly setting reqid
     ZTracer::Trace trace;
 
@@ -1935,8 +1955,47 @@ public:
     using shared_lock = boost::shared_lock<decltype(lock)>;
     using shunique_lock = ceph::shunique_lock<decltype(lock)>;
 
-    // pending ops
-    std::map<ceph_tid_t,Op*> ops;
+    // pending ops, sharded by tid so that submits and replies only need
+    // lock shared.  a shard is changed under its own lock with lock held
+    // shared or unique; walking the shards needs either lock unique or
+    // the shard locks.
+    struct OpShard {
+      mutable std::mutex lock;
+      std::map<ceph_tid_t,Op*> ops;
+    };
+    static constexpr unsigned num_op_shards = 8;
+    std::array<OpShard, num_op_shards> op_shards;
+
+    OpShard& get_op_shard(ceph_tid_t tid) {
+      return op_shards[tid % num_op_shards];
+    }
+    Op *find_op(ceph_tid_t tid) {
+      auto& shard = get_op_shard(tid);
+      std::lock_guard l(shard.lock);
+      auto p = shard.ops.find(tid);
+      return p == shard.ops.end() ? nullptr : p->second;
+    }
+    /// visit the pending ops with lock held shared; f must not add or
+    /// remove ops
+    template <typename F>
+    void for_each_op(F&& f) const {
+      for (auto& shard : op_shards) {
+	std::lock_guard l(shard.lock);
+	for (auto& p : shard.ops) {
+	  f(p.second);
+	}
+      }
+    }
+    bool ops_empty() const {
+      for (auto& shard : op_shards) {
+	std::lock_guard l(shard.lock);
+	if (!shard.ops.empty()) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
     std::map<uint64_t, LingerOp*> linger_ops;
     std::map<ceph_tid_t,CommandOp*> command_ops;
 
@@ -1947,6 +2006,8 @@ public:
     int osd;
     int incarnation;
     ConnectionRef con;
+    /// moving average of read latency in usec, 0 until the first reply
+    std::atomic<uint32_t> read_lat_us = {0};
     int num_locks;
     std::unique_ptr<std::mutex[]> completion_locks;
     using unique_completion_lock = std::unique_lock<
@@ -2031,6 +2092,18 @@ public:
     Op *op);
 
   bool target_should_be_paused(op_target_t *op);
+  int _pick_fastest_replica(const std::vector<int>& acting);
+  void _update_read_latency(OSDSession *s, Op *op);
+  void _account_op_stages(Op *op, MOSDOpReply *m);
+
+  struct ECDirectRead;
+  friend struct C_ECDirectRead_Shard;
+  std::mutex ec_lock;
+  /// by profile name; null if the plugin failed to load
+  std::map<std::string, ceph::ErasureCodeInterfaceRef> ec_impls;
+  ceph::ErasureCodeInterfaceRef _get_ec_impl(const pg_pool_t& pi);
+  bool _ec_direct_read(Op *op, shunique_lock& sul);
+  void _finish_ec_direct_read(ECDirectRead *rd);
   int _calc_target(op_target_t *t, Connection *con,
 		   bool any_change = false);
   int _map_session(op_target_t *op, OSDSession **s,
@@ -2237,6 +2310,8 @@ private:
   // public interface
 public:
   void op_submit(Op *op, ceph_tid_t *ptid = NULL, int *ctx_budget = NULL);
+  /// submit several ops in order, each with where to put its tid
+  void op_submit(std::vector<std::pair<Op*, ceph_tid_t*>>& ops);
   bool is_active() {
     shared_lock l(rwlock);
     return !((!inflight_ops) && linger_ops.empty() &&
@@ -3146,6 +3221,10 @@ public:
 private:
   epoch_t epoch_barrier = 0;
   bool retry_writes_after_first_reply;
+  std::atomic<bool> balance_reads_by_latency;
+  std::atomic<bool> ec_direct_read;
+  std::atomic<double> read_latency_explore_ratio;
+  std::atomic<double> op_trace_sample_ratio;
 public:
   void set_epoch_barrier(epoch_t epoch);
 
@@ -16,6 +16,7 @@
 
 #include "include/types.h"
 #include "include/buffer.h"
+#include "include/intarith.h"
 #include "osd/OSDMap.h"
 
 #include "common/config.h"
@@ -130,6 +131,14 @@ void Striper::file_to_extents(
   __u32 stripe_count = layout->stripe_count;
   ceph_assert(object_size >= su);
   if (stripe_count == 1) {
+    // objects are mapped in order, each one at most once: as long as the
+    // first one sorts after what is already there, simply append
+    if (object_extents->empty() ||
+        object_extents->back().object_no < offset / object_size) {
+      file_to_extents_unstriped(cct, layout, offset, len, trunc_size,
+                                buffer_offset, object_extents);
+      return;
+    }
     ldout(cct, 20) << " sc is one, reset su to os" << dendl;
     su = object_size;
   }
@@ -203,6 +212,45 @@ void Striper::file_to_extents(
   }
 }
 
+void Striper::file_to_extents_unstriped(
+    CephContext *cct, const file_layout_t *layout, uint64_t offset,
+    uint64_t len, uint64_t trunc_size, uint64_t buffer_offset,
+    striper::LightweightObjectExtents* object_extents) {
+  uint64_t object_size = layout->object_size;
+  // the default layouts have power of two object sizes: shift and mask
+  // instead of dividing
+  int order = -1;
+  if ((object_size & (object_size - 1)) == 0) {
+    order = ctz(object_size);
+  }
+  object_extents->reserve(object_extents->size() +
+                          (offset % object_size + len - 1) / object_size + 1);
+
+  uint64_t cur = offset;
+  uint64_t left = len;
+  while (left > 0) {
+    uint64_t objectno;
+    uint64_t x_offset;
+    if (order >= 0) {
+      objectno = cur >> order;
+      x_offset = cur & (object_size - 1);
+    } else {
+      objectno = cur / object_size;
+      x_offset = cur % object_size;
+    }
+    uint64_t x_len = std::min(left, object_size - x_offset);
+
+    auto& ex = object_extents->emplace_back(
+      objectno, x_offset, x_len,
+      object_truncate_size(cct, layout, objectno, trunc_size));
+    ex.buffer_extents.emplace_back(cur - offset + buffer_offset, x_len);
+    ldout(cct, 15) << "file_to_extents  " << ex << dendl;
+
+    left -= x_len;
+    cur += x_len;
+  }
+}
+
 void Striper::extent_to_file(CephContext *cct, file_layout_t *layout,
 			   uint64_t objectno, uint64_t off, uint64_t len,
 			   std::vector<pair<uint64_t, uint64_t> >& extents)
@@ -128,6 +128,12 @@
           uint64_t* bl_off, uint64_t tofs, uint64_t tlen);
     };
 
+  private:
+    /// file_to_extents() for stripe_count == 1 layouts
+    static void file_to_extents_unstriped(
+        CephContext *cct, const file_layout_t *layout, uint64_t offset,
+        uint64_t len, uint64_t trunc_size, uint64_t buffer_offset,
+        striper::LightweightObjectExtents* object_extents);
   };
 
 //};
@@ -25,8 +25,13 @@ class MappingState:
         self.crush_dump = self.crush.dump()
         self.raw_pg_stats = raw_pg_stats
         self.raw_pool_stats = raw_pool_stats
+        # raw_pg_stats is the columnar 'pg_stats_columns'
         self.pg_stat = {
-            i['pgid']: i['stat_sum'] for i in raw_pg_stats.get('pg_stats', [])
+            '%d.%x' % (pool, ps): {'num_bytes': b, 'num_objects': o}
+            for pool, ps, b, o in zip(raw_pg_stats['pool'],
+                                      raw_pg_stats['ps'],
+                                      raw_pg_stats['num_bytes'],
+                                      raw_pg_stats['num_objects'])
         }
         osd_poolids = [p['pool'] for p in self.osdmap_dump.get('pools', [])]
         pg_poolids = [p['poolid'] for p in raw_pool_stats.get('pool_stats', [])]
@@ -451,7 +456,7 @@ class Module(MgrModule):
                     return (-errno.EPERM, '', warn)
             elif command['mode'] == 'crush-compat':
                 ms = MappingState(self.get_osdmap(),
-                                  self.get("pg_stats"),
+                                  self.get("pg_stats_columns"),
                                   self.get("pool_stats"),
                                   'initialize compat weight-set')
                 self.get_compat_weight_set_weights(ms) # ignore error
@@ -529,7 +534,7 @@ class Module(MgrModule):
                     if option not in valid_pool_names:
                          return (-errno.EINVAL, '', 'option "%s" not a plan or a pool' % option)
                     pools.append(option)
-                    ms = MappingState(osdmap, self.get("pg_stats"), self.get("pool_stats"), 'pool "%s"' % option)
+                    ms = MappingState(osdmap, self.get("pg_stats_columns"), self.get("pool_stats"), 'pool "%s"' % option)
                 else:
                     pools = plan.pools
                     if plan.mode == 'upmap':
@@ -540,14 +545,14 @@ class Module(MgrModule):
                         # using an old snapshotted osdmap vs a fresh copy of pg_stats.
                         # It should not be a big deal though..
                         ms = MappingState(plan.osdmap,
-                                          self.get("pg_stats"),
+                                          self.get("pg_stats_columns"),
                                           self.get("pool_stats"),
                                           'plan "%s"' % plan.name)
                     else:
                         ms = plan.final_state()
             else:
                 ms = MappingState(self.get_osdmap(),
-                                  self.get("pg_stats"),
+                                  self.get("pg_stats_columns"),
                                   self.get("pool_stats"),
                                   'current cluster')
             return (0, self.evaluate(ms, pools, verbose=verbose), '')
@@ -704,7 +709,7 @@ class Module(MgrModule):
             plan = MsPlan(name,
                           mode,
                           MappingState(osdmap,
-                                       self.get("pg_stats"),
+                                       self.get("pg_stats_columns"),
                                        self.get("pool_stats"),
                                        'plan %s initial' % name),
                           pools)
@@ -885,11 +885,15 @@ class MgrModule(ceph_module.BaseMgrModule, MgrModuleLoggingMixin):
                 osd_map, osd_map_tree, osd_map_crush, config, mon_map, fs_map,
                 osd_metadata, pg_summary, io_rate, pg_dump, df, osd_stats,
                 health, mon_status, devices, device <devid>, pg_stats,
-                pool_stats, pg_ready, osd_ping_times.
+                pg_stats_columns, pool_stats, pg_ready, osd_ping_times.
 
         Note:
             All these structures have their own JSON representations: experiment
             or look at the C++ ``dump()`` methods to learn about them.
+            The exception is pg_stats_columns: a dict of equally long
+            read-only memoryviews (pool, ps, state, num_bytes,
+            num_objects) plus the pgmap version, for modules that want a
+            few fields of every PG without building a dict per PG.
         """
         return self._ceph_get(data_name)
 
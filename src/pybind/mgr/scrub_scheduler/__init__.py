@@ -0,0 +1 @@
+from .module import ScrubScheduler, plan_scrubs
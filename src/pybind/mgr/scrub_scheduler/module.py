@@ -0,0 +1,354 @@
+"""
+Schedule periodic scrubs cluster-wide.
+
+Left to themselves, the OSDs each start scrubs whenever their own PGs come
+due, so a cluster whose PGs were created together tends to scrub them all
+at once.  This module instead picks the most overdue PGs across the whole
+cluster and asks for them to be scrubbed, keeping the number of scrubs per
+OSD and in total bounded, and the bytes deep scrubbed within a budget.
+OSDs that are busy with client I/O are left alone until they calm down.
+
+For the OSDs to leave the periodic scrubs to this module, set
+osd_scrub_auto_schedule to false.
+"""
+
+import json
+import threading
+import time
+from collections import deque
+from datetime import datetime, timedelta
+from typing import Any, Deque, Dict, Iterable, List, Optional, Tuple
+
+from mgr_module import MgrModule
+from mgr_util import to_pretty_timedelta
+
+# give up on a request the OSD has not started by then, it likely could
+# not get its reservations
+REQUEST_TIMEOUT = 600
+
+# window for the observed scrub rate
+RATE_WINDOW = 3600
+
+
+def parse_stamp(stamp: str) -> float:
+    """
+    Turn a utime_t as dumped by the pg stats into seconds since the epoch.
+    """
+    if 'T' not in stamp:
+        # never scrubbed, or a relative time
+        return float(stamp)
+    return datetime.strptime(stamp, '%Y-%m-%dT%H:%M:%S.%f%z').timestamp()
+
+
+def plan_scrubs(candidates: Iterable[Dict[str, Any]],
+                busy_osds: Iterable[int],
+                scrubs_per_osd: Dict[int, int],
+                max_new: int,
+                max_per_osd: int,
+                tokens: Optional[float]) -> Tuple[List[Dict[str, Any]],
+                                                  Optional[float]]:
+    """
+    Pick which of the candidates to scrub now, most urgent first.
+
+    A candidate is skipped if any of its acting OSDs is busy or already
+    runs max_per_osd scrubs.  Deep scrubs are paid for with their bytes
+    from tokens, which may be None for no limit; the last one started may
+    overdraw it so that PGs larger than a refill still get their turn.
+
+    :return: the chosen candidates and the tokens left
+    """
+    busy = set(busy_osds)
+    per_osd = dict(scrubs_per_osd)
+    chosen = []
+    for c in sorted(candidates, key=lambda c: -c['urgency']):
+        if len(chosen) >= max_new:
+            break
+        if c['deep'] and tokens is not None and tokens <= 0:
+            continue
+        osds = [o for o in c['acting'] if o >= 0]
+        if any(o in busy or per_osd.get(o, 0) >= max_per_osd for o in osds):
+            continue
+        for o in osds:
+            per_osd[o] = per_osd.get(o, 0) + 1
+        if c['deep'] and tokens is not None:
+            tokens -= c['bytes']
+        chosen.append(c)
+    return chosen, tokens
+
+
+class ScrubScheduler(MgrModule):
+    COMMANDS = [
+        {
+            "cmd": "scrub_scheduler status "
+                   "name=format,type=CephChoices,strings=json|json-pretty|plain,req=false",
+            "desc": "show the scrub backlog and what is being scrubbed",
+            "perm": "r"
+        },
+    ]
+
+    MODULE_OPTIONS = [
+        {
+            'name': 'active',
+            'type': 'bool',
+            'default': False,
+            'desc': 'schedule scrubs',
+            'runtime': True,
+        },
+        {
+            'name': 'sleep_interval',
+            'type': 'secs',
+            'default': 60,
+            'desc': 'how frequently to look for PGs to scrub',
+            'runtime': True,
+        },
+        {
+            'name': 'max_scrubs',
+            'type': 'uint',
+            'default': 32,
+            'desc': 'maximum number of scrubs in the cluster at a time',
+            'runtime': True,
+        },
+        {
+            'name': 'max_scrubs_per_osd',
+            'type': 'uint',
+            'default': 1,
+            'desc': 'maximum number of scrubs an OSD takes part in at a time',
+            'runtime': True,
+        },
+        {
+            'name': 'bytes_per_sec',
+            'type': 'size',
+            'default': 0,
+            'desc': 'budget of bytes deep scrubbed per second in the cluster, 0 for no limit',
+            'runtime': True,
+        },
+        {
+            'name': 'max_commit_latency_ms',
+            'type': 'uint',
+            'default': 0,
+            'desc': 'do not scrub on OSDs whose commit latency is higher, 0 to ignore the latency',
+            'runtime': True,
+        },
+    ]
+
+    NATIVE_OPTIONS = [
+        'osd_scrub_min_interval',
+        'osd_scrub_max_interval',
+        'osd_deep_scrub_interval',
+    ]
+
+    def __init__(self, *args: Any, **kwargs: Any) -> None:
+        super(ScrubScheduler, self).__init__(*args, **kwargs)
+        self._shutdown = threading.Event()
+        self._lock = threading.Lock()
+        # pgid -> what we asked for, and the stamp it had back then
+        self._requested = {}  # type: Dict[str, Dict[str, Any]]
+        # (time, bytes) of deep scrubs done within RATE_WINDOW
+        self._done = deque()  # type: Deque[Tuple[float, int]]
+        self._tokens = 0.0
+        self._last_refill = time.time()
+        self._status = {}  # type: Dict[str, Any]
+        self.config_notify()
+
+    def config_notify(self) -> None:
+        for opt in self.NATIVE_OPTIONS:
+            setattr(self,
+                    opt,
+                    self.get_ceph_option(opt))
+            self.log.debug(' native option %s = %s', opt, getattr(self, opt))
+        for opt in self.MODULE_OPTIONS:
+            setattr(self,
+                    opt['name'],
+                    self.get_module_option(opt['name']))
+            self.log.debug(' mgr option %s = %s',
+                           opt['name'], getattr(self, opt['name']))
+
+    def handle_command(self, inbuf, cmd):
+        if cmd['prefix'] == 'scrub_scheduler status':
+            with self._lock:
+                status = dict(self._status)
+            status['active'] = self.active
+            fmt = cmd.get('format', 'plain')
+            if fmt == 'json':
+                return 0, json.dumps(status, sort_keys=True), ''
+            if fmt == 'json-pretty':
+                return 0, json.dumps(status, indent=4, sort_keys=True), ''
+            return 0, self._format_status(status), ''
+        else:
+            assert False  # ceph-mgr should never pass us unknown cmds
+
+    def _format_status(self, status: Dict[str, Any]) -> str:
+        lines = ['active: %s' % status['active']]
+        if 'overdue_pgs' in status:
+            lines += [
+                'overdue: %d pgs, %d bytes' % (status['overdue_pgs'],
+                                               status['overdue_bytes']),
+                'due: %d pgs' % status['due_pgs'],
+                'scrubbing: %d pgs, %d requested' % (status['scrubbing_pgs'],
+                                                     status['requested_pgs']),
+                'deep scrubbed in the last hour: %d bytes' % status['recent_bytes'],
+            ]
+            eta = status.get('eta_sec')
+            lines.append('backlog eta: %s' % (
+                to_pretty_timedelta(timedelta(seconds=eta)) if eta is not None else 'unknown'))
+        return '\n'.join(lines)
+
+    def serve(self) -> None:
+        while not self._shutdown.is_set():
+            try:
+                self._tick()
+            except Exception as e:
+                self.log.exception('scrub scheduling failed: %s', e)
+            self._shutdown.wait(timeout=int(self.sleep_interval))
+
+    def shutdown(self) -> None:
+        self.log.info('Stopping scrub_scheduler')
+        self._shutdown.set()
+
+    def _pool_intervals(self) -> Dict[int, Tuple[float, float, float]]:
+        """
+        (min, max, deep) scrub intervals of each pool, the pool options
+        taking precedence over the osd ones like they do on the OSDs
+        """
+        r = {}
+        for pool in self.get('osd_map')['pools']:
+            opts = pool.get('options', {})
+            r[pool['pool']] = (
+                float(opts.get('scrub_min_interval') or
+                      self.osd_scrub_min_interval),
+                float(opts.get('scrub_max_interval') or
+                      self.osd_scrub_max_interval),
+                float(opts.get('deep_scrub_interval') or
+                      self.osd_deep_scrub_interval))
+        return r
+
+    def _busy_osds(self) -> List[int]:
+        if not self.max_commit_latency_ms:
+            return []
+        return [s['osd'] for s in self.get('osd_stats')['osd_stats']
+                if s['perf_stat']['commit_latency_ms'] >
+                self.max_commit_latency_ms]
+
+    def _tick(self) -> None:
+        now = time.time()
+        intervals = self._pool_intervals()
+        candidates = []
+        scrubbing = 0
+        scrubs_per_osd = {}  # type: Dict[int, int]
+        overdue_pgs = 0
+        overdue_bytes = 0
+        stamps = {}
+        for pg in self.get('pg_stats')['pg_stats']:
+            pgid = pg['pgid']
+            state = pg['state'].split('+')
+            deep_stamp = parse_stamp(pg['last_deep_scrub_stamp'])
+            stamp = parse_stamp(pg['last_scrub_stamp'])
+            stamps[pgid] = (stamp, deep_stamp)
+            num_bytes = pg['stat_sum']['num_bytes']
+            if 'scrubbing' in state or pgid in self._requested:
+                scrubbing += 'scrubbing' in state
+                for o in pg['acting']:
+                    scrubs_per_osd[o] = scrubs_per_osd.get(o, 0) + 1
+                continue
+            pool = int(pgid.split('.')[0])
+            if pool not in intervals:
+                continue
+            min_interval, max_interval, deep_interval = intervals[pool]
+            age = now - stamp
+            deep_age = now - deep_stamp
+            deep = deep_interval > 0 and deep_age >= deep_interval
+            if (max_interval > 0 and age > max_interval) or deep:
+                overdue_pgs += 1
+                overdue_bytes += num_bytes if deep else 0
+            if not deep and age < min_interval:
+                continue
+            if 'active' not in state or 'clean' not in state:
+                continue
+            urgency = max(age / max_interval if max_interval > 0 else 0,
+                          deep_age / deep_interval if deep_interval > 0 else 0)
+            candidates.append({
+                'pgid': pgid,
+                'acting': pg['acting'],
+                'deep': deep,
+                'bytes': num_bytes,
+                'urgency': urgency,
+            })
+
+        self._reap_requests(now, stamps)
+
+        tokens = None
+        if self.bytes_per_sec:
+            # allow one interval worth of burst
+            self._tokens = min(
+                self._tokens + (now - self._last_refill) * self.bytes_per_sec,
+                float(self.bytes_per_sec * self.sleep_interval))
+            tokens = self._tokens
+        self._last_refill = now
+
+        if self.active:
+            max_new = max(0, self.max_scrubs - scrubbing -
+                          len(self._requested))
+            chosen, tokens = plan_scrubs(candidates, self._busy_osds(),
+                                         scrubs_per_osd, max_new,
+                                         self.max_scrubs_per_osd, tokens)
+            for c in chosen:
+                self._request(c, now, stamps[c['pgid']])
+            if tokens is not None:
+                self._tokens = tokens
+
+        recent_bytes = sum(b for _, b in self._done)
+        if self.bytes_per_sec:
+            rate = float(self.bytes_per_sec)
+        else:
+            rate = recent_bytes / RATE_WINDOW
+        eta = None
+        if overdue_bytes == 0:
+            eta = 0.0
+        elif rate > 0:
+            eta = overdue_bytes / rate
+        with self._lock:
+            self._status = {
+                'overdue_pgs': overdue_pgs,
+                'overdue_bytes': overdue_bytes,
+                'due_pgs': len(candidates),
+                'scrubbing_pgs': scrubbing,
+                'requested_pgs': len(self._requested),
+                'recent_bytes': recent_bytes,
+                'eta_sec': eta,
+            }
+
+    def _reap_requests(self, now: float,
+                       stamps: Dict[str, Tuple[float, float]]) -> None:
+        for pgid, req in list(self._requested.items()):
+            stamp, deep_stamp = stamps.get(pgid, (None, None))
+            if stamp is None:
+                # gone with a pg merge or pool deletion
+                del self._requested[pgid]
+            elif (deep_stamp if req['deep'] else stamp) > req['stamp']:
+                self.log.debug('%s scrubbed', pgid)
+                if req['deep']:
+                    self._done.append((now, req['bytes']))
+                del self._requested[pgid]
+            elif now - req['at'] > REQUEST_TIMEOUT:
+                self.log.info('%s did not start scrubbing, giving up', pgid)
+                del self._requested[pgid]
+        while self._done and self._done[0][0] < now - RATE_WINDOW:
+            self._done.popleft()
+
+    def _request(self, c: Dict[str, Any], now: float,
+                 stamps: Tuple[float, float]) -> None:
+        prefix = 'pg deep-scrub' if c['deep'] else 'pg scrub'
+        self.log.info('%s %s (%d bytes)', prefix, c['pgid'], c['bytes'])
+        r, outb, outs = self.mon_command({
+            'prefix': prefix,
+            'pgid': c['pgid'],
+        })
+        if r != 0:
+            self.log.warning('%s %s failed: %s', prefix, c['pgid'], outs)
+            return
+        self._requested[c['pgid']] = {
+            'at': now,
+            'deep': c['deep'],
+            'bytes': c['bytes'],
+            'stamp': stamps[1] if c['deep'] else stamps[0],
+        }
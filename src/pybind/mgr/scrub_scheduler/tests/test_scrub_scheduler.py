@@ -0,0 +1,54 @@
+from scrub_scheduler import plan_scrubs
+from scrub_scheduler.module import parse_stamp
+
+
+def pg(pgid, acting, urgency, deep=False, num_bytes=0):
+    return {
+        'pgid': pgid,
+        'acting': acting,
+        'deep': deep,
+        'bytes': num_bytes,
+        'urgency': urgency,
+    }
+
+
+def pgids(chosen):
+    return [c['pgid'] for c in chosen]
+
+
+def test_most_urgent_first():
+    cands = [pg('1.0', [0, 1], 1.0), pg('1.1', [2, 3], 3.0),
+             pg('1.2', [4, 5], 2.0)]
+    chosen, _ = plan_scrubs(cands, [], {}, 2, 1, None)
+    assert pgids(chosen) == ['1.1', '1.2']
+
+
+def test_per_osd_limit():
+    cands = [pg('1.0', [0, 1], 3.0), pg('1.1', [1, 2], 2.0),
+             pg('1.2', [3, 4], 1.0)]
+    chosen, _ = plan_scrubs(cands, [], {4: 1}, 10, 1, None)
+    assert pgids(chosen) == ['1.0']
+    chosen, _ = plan_scrubs(cands, [], {}, 10, 2, None)
+    assert pgids(chosen) == ['1.0', '1.1', '1.2']
+
+
+def test_busy_osds():
+    cands = [pg('1.0', [0, 1], 2.0), pg('1.1', [2, 3], 1.0)]
+    chosen, _ = plan_scrubs(cands, [1], {}, 10, 1, None)
+    assert pgids(chosen) == ['1.1']
+
+
+def test_byte_budget():
+    cands = [pg('1.0', [0], 3.0, True, 100), pg('1.1', [1], 2.0, True, 100),
+             pg('1.2', [2], 1.0, False, 100)]
+    chosen, tokens = plan_scrubs(cands, [], {}, 10, 1, 50.0)
+    # the first may overdraw, shallow scrubs are not charged
+    assert pgids(chosen) == ['1.0', '1.2']
+    assert tokens == -50.0
+    chosen, tokens = plan_scrubs(cands, [], {}, 10, 1, -1.0)
+    assert pgids(chosen) == ['1.2']
+
+
+def test_parse_stamp():
+    assert parse_stamp('0.000000') == 0.0
+    assert parse_stamp('1970-01-01T00:01:40.500000+0000') == 100.5
@@ -239,6 +239,7 @@ class Module(MgrModule):
                 "pg_ready",
                 "df",
                 "pg_stats",
+                "pg_stats_columns",
                 "pool_stats",
                 "osd_stats",
                 "osd_ping_times",
@@ -269,19 +269,29 @@ void UnknownAction::dump(Formatter *f) const {
 }
 
 void ActionEntry::encode(bufferlist &bl) const {
-  ENCODE_START(1, 1, bl);
+  ENCODE_START(2, 1, bl);
   boost::apply_visitor(EncodeVisitor(bl), action);
+  encode(start_time, bl);
   ENCODE_FINISH(bl);
 }
 
 void ActionEntry::decode(bufferlist::const_iterator &it) {
-  DECODE_START(1, it);
+  DECODE_START(2, it);
   decode_versioned(struct_v, it);
+  if (struct_v >= 2) {
+    decode(start_time, it);
+    m_timed = true;
+  } else {
+    start_time = 0;
+    m_timed = false;
+  }
   DECODE_FINISH(it);
 }
 
 void ActionEntry::decode_unversioned(bufferlist::const_iterator &it) {
   decode_versioned(0, it);
+  start_time = 0;
+  m_timed = false;
 }
 
 void ActionEntry::decode_versioned(__u8 version, bufferlist::const_iterator &it) {
@@ -334,6 +344,7 @@ void ActionEntry::decode_versioned(__u8 version, bufferlist::const_iterator &it)
 
 void ActionEntry::dump(Formatter *f) const {
   boost::apply_visitor(DumpVisitor(f), action);
+  f->dump_unsigned("start_time", start_time);
 }
 
 void ActionEntry::generate_test_instances(std::list<ActionEntry *> &o) {
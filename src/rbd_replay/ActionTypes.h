@@ -311,10 +311,13 @@ typedef boost::variant<StartThreadAction,
 class ActionEntry {
 public:
   Action action;
+  /// Nanoseconds from the start of the trace to the start of the action.
+  uint64_t start_time;
 
-  ActionEntry() : action(UnknownAction()) {
+  ActionEntry() : action(UnknownAction()), start_time(0), m_timed(false) {
   }
-  ActionEntry(const Action &action) : action(action) {
+  ActionEntry(const Action &action, uint64_t start_time = 0)
+    : action(action), start_time(start_time), m_timed(true) {
   }
 
   void encode(bufferlist &bl) const;
@@ -322,9 +325,16 @@ public:
   void decode_unversioned(bufferlist::const_iterator &it);
   void dump(Formatter *f) const;
 
+  /// Whether the entry has a start_time, traces prior to v2 do not.
+  bool is_timed() const {
+    return m_timed;
+  }
+
   static void generate_test_instances(std::list<ActionEntry *> &o);
 
 private:
+  bool m_timed;
+
   void decode_versioned(__u8 version, bufferlist::const_iterator &it);
 };
 
@@ -26,8 +26,11 @@ void rbd_replay_pending_io_callback(librbd::completion_t cb, void *arg) {
 }
 
 PendingIO::PendingIO(action_id_t id,
-		     ActionCtx &worker)
+		     ActionCtx &worker,
+		     const char *action_name)
   : m_id(id),
+    m_action_name(action_name),
+    m_start_time(std::chrono::steady_clock::now()),
     m_completion(new librbd::RBD::AioCompletion(this, rbd_replay_pending_io_callback)),
     m_worker(worker) {
     }
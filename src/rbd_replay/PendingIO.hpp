@@ -15,6 +15,7 @@
 #ifndef _INCLUDED_RBD_REPLAY_PENDINGIO_HPP
 #define _INCLUDED_RBD_REPLAY_PENDINGIO_HPP
 
+#include <chrono>
 #include <boost/enable_shared_from_this.hpp>
 #include "actions.hpp"
 
@@ -32,7 +33,8 @@ public:
   typedef boost::shared_ptr<PendingIO> ptr;
 
   PendingIO(action_id_t id,
-            ActionCtx &worker);
+            ActionCtx &worker,
+            const char *action_name);
 
   ~PendingIO();
 
@@ -48,12 +50,23 @@ public:
     return *m_completion;
   }
 
+  /// Name of the type of the action of the IO
+  const char *action_name() const {
+    return m_action_name;
+  }
+
+  std::chrono::steady_clock::time_point start_time() const {
+    return m_start_time;
+  }
+
 private:
   void completed(librbd::completion_t cb);
 
   friend void ::rbd_replay_pending_io_callback(librbd::completion_t cb, void *arg);
 
   const action_id_t m_id;
+  const char *m_action_name;
+  const std::chrono::steady_clock::time_point m_start_time;
   ceph::bufferlist m_bl;
   librbd::RBD::AioCompletion *m_completion;
   ActionCtx &m_worker;
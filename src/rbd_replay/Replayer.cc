@@ -18,10 +18,13 @@
 #include "rbd_replay/ActionTypes.h"
 #include "rbd_replay/BufferReader.h"
 #include <boost/foreach.hpp>
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
+#include <optional>
 #include <thread>
 #include <fstream>
+#include <type_traits>
 #include "global/global_context.h"
 #include "rbd_replay_debug.hpp"
 
@@ -51,6 +54,42 @@ bool is_versioned_replay(BufferReader &buffer_reader) {
   return versioned;
 }
 
+/// The image of the action, if any
+struct ImageVisitor
+  : public boost::static_visitor<std::optional<action::imagectx_id_t>> {
+  template <typename Action>
+  std::optional<action::imagectx_id_t> operator()(const Action &action) const {
+    if constexpr (std::is_base_of_v<action::ImageActionBase, Action>) {
+      return action.imagectx_id;
+    } else {
+      return std::nullopt;
+    }
+  }
+};
+
+void dump_latencies(std::vector<uint64_t> &latencies, Formatter *f) {
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double pct) {
+    size_t i = std::min(latencies.size() - 1,
+                        (size_t)(latencies.size() * pct / 100));
+    return latencies[i];
+  };
+  uint64_t sum = 0;
+  for (auto l : latencies) {
+    sum += l;
+  }
+  f->dump_unsigned("count", latencies.size());
+  if (latencies.empty()) {
+    return;
+  }
+  f->dump_unsigned("avg_us", sum / latencies.size());
+  f->dump_unsigned("p50_us", percentile(50));
+  f->dump_unsigned("p90_us", percentile(90));
+  f->dump_unsigned("p99_us", percentile(99));
+  f->dump_unsigned("p999_us", percentile(99.9));
+  f->dump_unsigned("max_us", latencies.back());
+}
+
 } // anonymous namespace
 
 Worker::Worker(Replayer &replayer)
@@ -77,6 +116,10 @@ void Worker::send(Action::ptr action) {
   m_buffer.push_front(action);
 }
 
+void Worker::send_stop() {
+  m_buffer.push_front(Action::ptr());
+}
+
 void Worker::add_pending(PendingIO::ptr io) {
   ceph_assert(io);
   std::scoped_lock lock{m_pending_ios_mutex};
@@ -89,6 +132,11 @@ void Worker::run() {
   while (!m_done) {
     Action::ptr action;
     m_buffer.pop_back(&action);
+    if (!action) {
+      m_done = true;
+      break;
+    }
+    m_replayer.wait_for_start(*action);
     m_replayer.wait_for_actions(action->predecessors());
     action->perform(*this);
     m_replayer.set_action_complete(action->id());
@@ -115,6 +163,8 @@ void Worker::run() {
 void Worker::remove_pending(PendingIO::ptr io) {
   ceph_assert(io);
   m_replayer.set_action_complete(io->id());
+  m_replayer.record_latency(io->action_name(),
+                            std::chrono::steady_clock::now() - io->start_time());
   std::scoped_lock lock{m_pending_ios_mutex};
   size_t num_erased = m_pending_ios.erase(io->id());
   assertf(num_erased == 1, "id = %d", io->id());
@@ -166,6 +216,7 @@ Replayer::Replayer(int num_action_trackers)
   : m_rbd(NULL), m_ioctx(0),
     m_latency_multiplier(1.0),
     m_readonly(false), m_dump_perf_counters(false),
+    m_strict_timing(false), m_image_threads(false), m_latency_report(false),
     m_num_action_trackers(num_action_trackers),
     m_action_trackers(new action_tracker_d[m_num_action_trackers]) {
   assertf(num_action_trackers > 0, "num_action_trackers = %d", num_action_trackers);
@@ -213,6 +264,8 @@ void Replayer::run(const std::string& replay_file) {
       }
       m_rbd = new librbd::RBD();
       map<thread_id_t, Worker*> workers;
+      // the workers of the images of each thread, with --image-threads
+      map<pair<thread_id_t, imagectx_id_t>, Worker*> image_workers;
 
       int fd = open(replay_file.c_str(), O_RDONLY);
       if (fd < 0) {
@@ -224,6 +277,7 @@ void Replayer::run(const std::string& replay_file) {
 
       BufferReader buffer_reader(fd);
       bool versioned = is_versioned_replay(buffer_reader);
+      m_start_time = std::chrono::steady_clock::now();
       while (true) {
         action::ActionEntry action_entry;
         try {
@@ -253,12 +307,36 @@ void Replayer::run(const std::string& replay_file) {
           // unknown / unsupported action
 	  continue;
 	}
+	if (m_strict_timing && !action->is_timed()) {
+	  std::cerr << "Strict timing needs a trace with the start times of "
+		    << "the actions, prepare it again with this version of "
+		    << "rbd-replay-prep" << std::endl;
+	  exit(1);
+	}
 
+	auto imagectx_id = boost::apply_visitor(ImageVisitor(),
+						action_entry.action);
 	if (action->is_start_thread()) {
 	  Worker *worker = new Worker(*this);
 	  workers[action->thread_id()] = worker;
 	  worker->start();
+	} else if (m_image_threads && imagectx_id) {
+	  auto key = make_pair(action->thread_id(), *imagectx_id);
+	  auto p = image_workers.find(key);
+	  if (p == image_workers.end()) {
+	    p = image_workers.emplace(key, new Worker(*this)).first;
+	    p->second->start();
+	  }
+	  p->second->send(action);
 	} else {
+	  if (m_image_threads) {
+	    // the thread is stopping, so are the workers of its images
+	    auto p = image_workers.lower_bound(make_pair(action->thread_id(), 0));
+	    for (; p != image_workers.end() &&
+		   p->first.first == action->thread_id(); ++p) {
+	      p->second->send_stop();
+	    }
+	  }
 	  workers[action->thread_id()]->send(action);
 	}
       }
@@ -269,6 +347,13 @@ void Replayer::run(const std::string& replay_file) {
 	w.second->join();
 	delete w.second;
       }
+      for (auto& [key, worker] : image_workers) {
+	worker->join();
+	delete worker;
+      }
+      if (m_latency_report) {
+	report_latencies();
+      }
       clear_images();
       delete m_rbd;
       m_rbd = NULL;
@@ -328,6 +413,57 @@ bool Replayer::is_action_complete(action_id_t id) {
   return tracker.actions.count(id) > 0;
 }
 
+void Replayer::wait_for_start(const Action &action) {
+  if (!m_strict_timing) {
+    return;
+  }
+  auto start_time = m_start_time + std::chrono::nanoseconds{
+    static_cast<long long>(action.start_time() * m_latency_multiplier)};
+  auto now = std::chrono::steady_clock::now();
+  if (start_time > now) {
+    dout(SLEEP_LEVEL) << "Sleeping for "
+		      << std::chrono::duration_cast<std::chrono::microseconds>(start_time - now).count()
+		      << " microseconds" << dendl;
+    std::this_thread::sleep_until(start_time);
+  } else {
+    // the replay is behind the trace
+    auto lag = std::chrono::duration_cast<std::chrono::microseconds>(now - start_time);
+    std::scoped_lock lock{m_latencies_mutex};
+    m_start_lags.push_back(lag.count());
+  }
+}
+
+void Replayer::record_latency(const char *action_name,
+			      std::chrono::nanoseconds latency) {
+  if (!m_latency_report) {
+    return;
+  }
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(latency);
+  std::scoped_lock lock{m_latencies_mutex};
+  m_latencies[action_name].push_back(micros.count());
+}
+
+void Replayer::report_latencies() {
+  std::scoped_lock lock{m_latencies_mutex};
+  JSONFormatter jf(true);
+  jf.open_object_section("latencies");
+  for (auto& [action_name, latencies] : m_latencies) {
+    jf.open_object_section(action_name.c_str());
+    dump_latencies(latencies, &jf);
+    jf.close_section();
+  }
+  if (m_strict_timing) {
+    // how late the actions started, when they could not start in time
+    jf.open_object_section("start_lag");
+    dump_latencies(m_start_lags, &jf);
+    jf.close_section();
+  }
+  jf.close_section();
+  jf.flush(cout);
+  cout << std::endl;
+  cout.flush();
+}
+
 void Replayer::wait_for_actions(const action::Dependencies &deps) {
   auto release_time = std::chrono::time_point<std::chrono::system_clock>::min();
   for(auto& dep : deps) {
@@ -350,6 +486,10 @@ void Replayer::wait_for_actions(const action::Dependencies &deps) {
     dout(DEPGRAPH_LEVEL) << "Finished waiting for " << dep.id << " after " << micros << " microseconds" << dendl;
     // Apparently the nanoseconds constructor is optional:
     // http://www.boost.org/doc/libs/1_46_0/doc/html/date_time/details.html#compile_options
+    if (m_strict_timing) {
+      // the timing is the one of the trace, see wait_for_start()
+      continue;
+    }
     auto sub_release_time{action_completed_time +
 	std::chrono::microseconds{static_cast<long long>(dep.time_delta * m_latency_multiplier / 1000)}};
     if (sub_release_time > release_time) {
@@ -16,7 +16,11 @@
 #define _INCLUDED_RBD_REPLAY_REPLAYER_HPP
 
 #include <chrono>
+#include <map>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
 #include <thread>
 #include <condition_variable>
 #include "rbd_replay/ActionTypes.h"
@@ -44,6 +48,9 @@ public:
 
   void send(Action::ptr action);
 
+  /// Stops the worker once the actions sent before are performed
+  void send_stop();
+
   void add_pending(PendingIO::ptr io) override;
 
   void remove_pending(PendingIO::ptr io) override;
@@ -123,6 +130,27 @@ public:
     m_dump_perf_counters = dump_perf_counters;
   }
 
+  /// Replay each action at the time it started in the trace, scaled by the
+  /// latency multiplier, instead of after the delays of its dependencies
+  void set_strict_timing(bool strict_timing) {
+    m_strict_timing = strict_timing;
+  }
+
+  /// Replay the actions of each image of a traced thread in a thread of
+  /// their own
+  void set_image_threads(bool image_threads) {
+    m_image_threads = image_threads;
+  }
+
+  void set_latency_report(bool latency_report) {
+    m_latency_report = latency_report;
+  }
+
+  /// Waits until the time of the action in the trace, in strict timing
+  void wait_for_start(const Action &action);
+
+  void record_latency(const char *action_name, std::chrono::nanoseconds latency);
+
   const ImageNameMap &image_name_map() const {
     return m_image_name_map;
   }
@@ -137,6 +165,8 @@ private:
 
   void clear_images();
 
+  void report_latencies();
+
   action_tracker_d &tracker_for(action_id_t id);
 
   /// Disallow copying
@@ -151,6 +181,18 @@ private:
   bool m_readonly;
   ImageNameMap m_image_name_map;
   bool m_dump_perf_counters;
+  bool m_strict_timing;
+  bool m_image_threads;
+  bool m_latency_report;
+
+  /// The start of the replay, the origin of the trace in strict timing
+  std::chrono::steady_clock::time_point m_start_time;
+
+  /// Microseconds to complete the actions, by action name
+  std::map<std::string, std::vector<uint64_t>> m_latencies;
+  /// Microseconds the actions started after their time, in strict timing
+  std::vector<uint64_t> m_start_lags;
+  std::mutex m_latencies_mutex;
 
   std::map<imagectx_id_t, librbd::Image*> m_images;
   std::shared_mutex m_images_mutex;
@@ -93,7 +93,13 @@ std::ostream& rbd_replay::operator<<(std::ostream& o, const Action& a) {
 }
 
 Action::ptr Action::construct(const action::ActionEntry &action_entry) {
-  return boost::apply_visitor(ConstructVisitor(), action_entry.action);
+  Action::ptr action = boost::apply_visitor(ConstructVisitor(),
+                                            action_entry.action);
+  if (action && action_entry.is_timed()) {
+    action->m_start_time = action_entry.start_time;
+    action->m_timed = true;
+  }
+  return action;
 }
 
 void StartThreadAction::perform(ActionCtx &ctx) {
@@ -110,7 +116,7 @@ void AioReadAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
   ceph_assert(image);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   worker.add_pending(io);
   int r = image->aio_read(m_action.offset, m_action.length, io->bufferlist(), &io->completion());
   assertf(r >= 0, "id = %d, r = %d", id(), r);
@@ -119,7 +125,7 @@ void AioReadAction::perform(ActionCtx &worker) {
 void ReadAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   worker.add_pending(io);
   ssize_t r = image->read(m_action.offset, m_action.length, io->bufferlist());
   assertf(r >= 0, "id = %d, r = %d", id(), r);
@@ -130,7 +136,7 @@ void AioWriteAction::perform(ActionCtx &worker) {
   static const std::string fake_data(create_fake_data());
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   uint64_t remaining = m_action.length;
   while (remaining > 0) {
     uint64_t n = std::min(remaining, (uint64_t)fake_data.length());
@@ -149,7 +155,7 @@ void AioWriteAction::perform(ActionCtx &worker) {
 void WriteAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   worker.add_pending(io);
   io->bufferlist().append_zero(m_action.length);
   if (!worker.readonly()) {
@@ -162,7 +168,7 @@ void WriteAction::perform(ActionCtx &worker) {
 void AioDiscardAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   worker.add_pending(io);
   if (worker.readonly()) {
     worker.remove_pending(io);
@@ -175,7 +181,7 @@ void AioDiscardAction::perform(ActionCtx &worker) {
 void DiscardAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_action.imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   worker.add_pending(io);
   if (!worker.readonly()) {
     ssize_t r = image->discard(m_action.offset, m_action.length);
@@ -186,7 +192,7 @@ void DiscardAction::perform(ActionCtx &worker) {
 
 void OpenImageAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   worker.add_pending(io);
   librbd::Image *image = new librbd::Image();
   librbd::RBD *rbd = worker.rbd();
@@ -218,7 +224,7 @@ void CloseImageAction::perform(ActionCtx &worker) {
 void AioOpenImageAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   // TODO: Make it async
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, get_action_name()));
   worker.add_pending(io);
   librbd::Image *image = new librbd::Image();
   librbd::RBD *rbd = worker.rbd();
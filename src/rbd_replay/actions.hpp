@@ -116,9 +116,26 @@ public:
   virtual thread_id_t thread_id() const = 0;
   virtual const action::Dependencies& predecessors() const = 0;
 
+  /// Name of the type of the action, the latencies are reported by it
+  virtual const char *get_action_name() const = 0;
+
   virtual std::ostream& dump(std::ostream& o) const = 0;
 
+  /// Nanoseconds from the start of the trace to the start of the action,
+  /// if the trace has them (see is_timed())
+  uint64_t start_time() const {
+    return m_start_time;
+  }
+
+  bool is_timed() const {
+    return m_timed;
+  }
+
   static ptr construct(const action::ActionEntry &action_entry);
+
+private:
+  uint64_t m_start_time = 0;
+  bool m_timed = false;
 };
 
 template <typename ActionType>
@@ -151,8 +168,6 @@ public:
 
 protected:
   const ActionType m_action;
-
-  virtual const char *get_action_name() const = 0;
 };
 
 /// Writes human-readable debug information about the action to the stream.
@@ -186,7 +201,7 @@ public:
 
 protected:
   const char *get_action_name() const override {
-    return "StartThreadAction";
+    return "StopThreadAction";
   }
 };
 
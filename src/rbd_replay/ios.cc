@@ -71,7 +71,7 @@ void StartThreadIO::encode(bufferlist &bl) const {
   using ceph::encode;
   action::Action action((action::StartThreadAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()))));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void StartThreadIO::write_debug(std::ostream& out) const {
@@ -82,7 +82,7 @@ void StopThreadIO::encode(bufferlist &bl) const {
   using ceph::encode;
   action::Action action((action::StopThreadAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()))));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void StopThreadIO::write_debug(std::ostream& out) const {
@@ -94,7 +94,7 @@ void ReadIO::encode(bufferlist &bl) const {
   action::Action action((action::ReadAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_offset, m_length)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void ReadIO::write_debug(std::ostream& out) const {
@@ -107,7 +107,7 @@ void WriteIO::encode(bufferlist &bl) const {
   action::Action action((action::WriteAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_offset, m_length)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void WriteIO::write_debug(std::ostream& out) const {
@@ -120,7 +120,7 @@ void DiscardIO::encode(bufferlist &bl) const {
   action::Action action((action::DiscardAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_offset, m_length)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void DiscardIO::write_debug(std::ostream& out) const {
@@ -133,7 +133,7 @@ void AioReadIO::encode(bufferlist &bl) const {
   action::Action action((action::AioReadAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_offset, m_length)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void AioReadIO::write_debug(std::ostream& out) const {
@@ -146,7 +146,7 @@ void AioWriteIO::encode(bufferlist &bl) const {
   action::Action action((action::AioWriteAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_offset, m_length)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void AioWriteIO::write_debug(std::ostream& out) const {
@@ -159,7 +159,7 @@ void AioDiscardIO::encode(bufferlist &bl) const {
   action::Action action((action::AioDiscardAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_offset, m_length)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void AioDiscardIO::write_debug(std::ostream& out) const {
@@ -172,7 +172,7 @@ void OpenImageIO::encode(bufferlist &bl) const {
   action::Action action((action::OpenImageAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_name, m_snap_name, m_readonly)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void OpenImageIO::write_debug(std::ostream& out) const {
@@ -185,7 +185,7 @@ void CloseImageIO::encode(bufferlist &bl) const {
   action::Action action((action::CloseImageAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void CloseImageIO::write_debug(std::ostream& out) const {
@@ -198,7 +198,7 @@ void AioOpenImageIO::encode(bufferlist &bl) const {
   action::Action action((action::AioOpenImageAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx, m_name, m_snap_name, m_readonly)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void AioOpenImageIO::write_debug(std::ostream& out) const {
@@ -211,7 +211,7 @@ void AioCloseImageIO::encode(bufferlist &bl) const {
   action::Action action((action::AioCloseImageAction(
     ionum(), thread_id(), convert_dependencies(start_time(), dependencies()),
     m_imagectx)));
-  encode(action, bl);
+  encode(action::ActionEntry(action, start_time()), bl);
 }
 
 void AioCloseImageIO::write_debug(std::ostream& out) const {
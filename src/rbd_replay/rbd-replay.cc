@@ -38,6 +38,13 @@ static void usage(const char* program) {
   cout << "Options:" << std::endl;
   cout << "  -p, --pool-name <pool>          Name of the pool to use.  Default: rbd" << std::endl;
   cout << "  --latency-multiplier <float>    Multiplies inter-request latencies.  Default: 1" << std::endl;
+  cout << "  --strict-timing                 Start each request at its time in the trace, scaled" << std::endl;
+  cout << "                                  by the latency multiplier, whatever the latencies of" << std::endl;
+  cout << "                                  the replay." << std::endl;
+  cout << "  --image-threads                 Replay the requests of each image of a traced thread" << std::endl;
+  cout << "                                  in a thread of their own." << std::endl;
+  cout << "  --latency-report                Print the latencies of the requests by type at the" << std::endl;
+  cout << "                                  end of the replay." << std::endl;
   cout << "  --read-only                     Only perform non-destructive operations." << std::endl;
   cout << "  --map-image <rule>              Add a rule to map image names in the trace to" << std::endl;
   cout << "                                  image names in the replay cluster." << std::endl;
@@ -77,6 +84,9 @@ int main(int argc, const char **argv) {
   std::string val;
   std::ostringstream err;
   bool dump_perf_counters = false;
+  bool strict_timing = false;
+  bool image_threads = false;
+  bool latency_report = false;
   for (i = args.begin(); i != args.end(); ) {
     if (ceph_argparse_double_dash(args, i)) {
       break;
@@ -100,6 +110,12 @@ int main(int argc, const char **argv) {
       }
     } else if (ceph_argparse_flag(args, i, "--dump-perf-counters", (char*)NULL)) {
       dump_perf_counters = true;
+    } else if (ceph_argparse_flag(args, i, "--strict-timing", (char*)NULL)) {
+      strict_timing = true;
+    } else if (ceph_argparse_flag(args, i, "--image-threads", (char*)NULL)) {
+      image_threads = true;
+    } else if (ceph_argparse_flag(args, i, "--latency-report", (char*)NULL)) {
+      latency_report = true;
     } else if (get_remainder(*i, "-")) {
       cerr << "Unrecognized argument: " << *i << std::endl;
       return 1;
@@ -127,5 +143,8 @@ int main(int argc, const char **argv) {
   replayer.set_readonly(readonly);
   replayer.set_image_name_map(image_name_map);
   replayer.set_dump_perf_counters(dump_perf_counters);
+  replayer.set_strict_timing(strict_timing);
+  replayer.set_image_threads(image_threads);
+  replayer.set_latency_report(latency_report);
   replayer.run(replay_file);
 }
@@ -2,6 +2,8 @@
 // vim: ts=8 sw=2 smarttab ft=cpp
 
 #include <atomic>
+#include <mutex>
+#include <optional>
 #include <thread>
 #include <vector>
 
@@ -47,6 +49,63 @@ auto make_stack_allocator() {
   return boost::context::protected_fixedsize_stack{512*1024};
 }
 
+// keeps the stacks of the coroutines of closed connections for the next
+// connections, instead of a mmap/mprotect/munmap for each of them
+class StackPool {
+  decltype(make_stack_allocator()) allocator = make_stack_allocator();
+  std::mutex mutex;
+  std::vector<boost::context::stack_context> stacks;
+  size_t max_stacks = 256;
+ public:
+  ~StackPool() {
+    for (auto& sctx : stacks) {
+      allocator.deallocate(sctx);
+    }
+  }
+
+  void set_max(size_t max) {
+    std::lock_guard lock{mutex};
+    max_stacks = max;
+  }
+
+  boost::context::stack_context allocate() {
+    {
+      std::lock_guard lock{mutex};
+      if (!stacks.empty()) {
+        auto sctx = stacks.back();
+        stacks.pop_back();
+        return sctx;
+      }
+    }
+    return allocator.allocate();
+  }
+
+  void deallocate(boost::context::stack_context& sctx) noexcept {
+    {
+      std::lock_guard lock{mutex};
+      if (stacks.size() < max_stacks) {
+        stacks.push_back(sctx);
+        return;
+      }
+    }
+    allocator.deallocate(sctx);
+  }
+};
+
+// the stack allocator of the coroutines, copied into each of them
+class PooledStackAllocator {
+  StackPool* pool;
+ public:
+  explicit PooledStackAllocator(StackPool& pool) : pool(&pool) {}
+
+  boost::context::stack_context allocate() {
+    return pool->allocate();
+  }
+  void deallocate(boost::context::stack_context& sctx) noexcept {
+    pool->deallocate(sctx);
+  }
+};
+
 template <typename Stream>
 class StreamIO : public rgw::asio::ClientIO {
   CephContext* const cct;
@@ -75,12 +134,19 @@ class StreamIO : public rgw::asio::ClientIO {
   }
 
   size_t recv_body(char* buf, size_t max) override {
+    if (direct_body_left) {
+      return recv_body_direct(buf, max);
+    }
+
     auto& message = parser.get();
     auto& body_remaining = message.body();
     body_remaining.data = buf;
     body_remaining.size = max;
 
     while (body_remaining.size && !parser.is_done()) {
+      if (start_body_direct()) {
+        break;
+      }
       boost::system::error_code ec;
       http::async_read_some(stream, buffer, parser, yield[ec]);
       if (ec == http::error::need_buffer) {
@@ -91,7 +157,56 @@ class StreamIO : public rgw::asio::ClientIO {
         throw rgw::io::Exception(ec.value(), std::system_category());
       }
     }
-    return max - body_remaining.size;
+    const size_t len = max - body_remaining.size;
+    if (direct_body_left && len < max) {
+      return len + recv_body_direct(buf + len, max - len);
+    }
+    return len;
+  }
+
+  // the bytes of the body not read yet, once it bypasses the parser
+  const std::optional<uint64_t>& get_direct_body_left() const {
+    return direct_body_left;
+  }
+
+ private:
+  std::optional<uint64_t> direct_body_left;
+
+  // once the bytes read along with the header went through the parser, the
+  // rest of a body of known length is read from the stream straight into the
+  // caller's buffer, which the parser would only copy it into. the parser is
+  // not used for the rest of the message then
+  bool start_body_direct() {
+    if (buffer.size() > 0 || parser.chunked()) {
+      return false;
+    }
+#if BOOST_VERSION >= 107000
+    auto remaining = parser.content_length_remaining();
+#else
+    auto remaining = parser.content_length();
+#endif
+    if (!remaining) {
+      return false;
+    }
+    direct_body_left = *remaining;
+    return true;
+  }
+
+  size_t recv_body_direct(char* buf, size_t max) {
+    const size_t len = std::min<uint64_t>(max, *direct_body_left);
+    if (len == 0) {
+      return 0;
+    }
+
+    boost::system::error_code ec;
+    auto bytes = boost::asio::async_read(stream, boost::asio::buffer(buf, len),
+                                         yield[ec]);
+    if (ec) {
+      ldout(cct, 4) << "failed to read body: " << ec.message() << dendl;
+      throw rgw::io::Exception(ec.value(), std::system_category());
+    }
+    *direct_body_left -= bytes;
+    return bytes;
   }
 };
 
@@ -119,6 +234,8 @@ void handle_connection(boost::asio::io_context& context,
     rgw::asio::parser_type parser;
     parser.header_limit(header_limit);
     parser.body_limit(body_limit);
+    // the body not read yet, if it was read without the parser
+    std::optional<uint64_t> direct_body_left;
 
     // parse the header
     http::async_read_header(stream, buffer, parser, yield[ec]);
@@ -179,12 +296,31 @@ void handle_connection(boost::asio::io_context& context,
       auto y = optional_yield{context, yield};
       process_request(env.store, env.rest, &req, env.uri_prefix,
                       *env.auth_registry, &client, env.olog, y, scheduler);
+      direct_body_left = real_client.get_direct_body_left();
     }
 
     if (!parser.keep_alive()) {
       return;
     }
 
+    if (direct_body_left) {
+      // the parser did not see the body, discard its remaining bytes from
+      // the stream itself
+      static std::array<char, 4096> discard_buffer;
+      while (*direct_body_left > 0) {
+        auto len = std::min<uint64_t>(*direct_body_left, discard_buffer.size());
+        auto bytes = boost::asio::async_read(
+            stream, boost::asio::buffer(discard_buffer.data(), len), yield[ec]);
+        if (ec) {
+          ldout(cct, 5) << "failed to discard unread message: "
+              << ec.message() << dendl;
+          return;
+        }
+        *direct_body_left -= bytes;
+      }
+      continue;
+    }
+
     // if we failed before reading the entire message, discard any remaining
     // bytes before reading the next
     while (!parser.is_done()) {
@@ -252,6 +388,8 @@ namespace dmc = rgw::dmclock;
 class AsioFrontend {
   RGWProcessEnv env;
   RGWFrontendConfig* conf;
+  // destroyed after the context, with the coroutines that use its stacks
+  StackPool stack_pool;
   boost::asio::io_context context;
 #ifdef WITH_RADOSGW_BEAST_OPENSSL
   boost::optional<ssl::context> ssl_context;
@@ -444,6 +582,18 @@ int AsioFrontend::init()
     listeners.emplace_back(context);
     listeners.back().endpoint = endpoint;
   }
+  // parse the number of coroutine stacks kept for reuse
+  auto stack_pool_size = config.find("stack_pool_size");
+  if (stack_pool_size != config.end()) {
+    string err;
+    auto size = strict_strtol(stack_pool_size->second.c_str(), 10, &err);
+    if (!err.empty() || size < 0) {
+      ldout(ctx(), 0) << "WARNING: invalid value for stack_pool_size="
+          << stack_pool_size->second << dendl;
+    } else {
+      stack_pool.set_max(size);
+    }
+  }
   // parse tcp nodelay
   auto nodelay = config.find("tcp_nodelay");
   if (nodelay != config.end()) {
@@ -811,7 +961,7 @@ void AsioFrontend::accept(Listener& l, boost::system::error_code ec)
           stream.async_shutdown(yield[ec]);
         }
         s.shutdown(tcp::socket::shutdown_both, ec);
-      }, make_stack_allocator());
+      }, PooledStackAllocator{stack_pool});
   } else {
 #else
   {
@@ -825,7 +975,7 @@ void AsioFrontend::accept(Listener& l, boost::system::error_code ec)
         handle_connection(context, env, s, *buffer, false, pause_mutex,
                           scheduler.get(), ec, yield);
         s.shutdown(tcp::socket::shutdown_both, ec);
-      }, make_stack_allocator());
+      }, PooledStackAllocator{stack_pool});
   }
 }
 
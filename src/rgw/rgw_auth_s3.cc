@@ -42,6 +42,8 @@ static const auto signed_subresources = {
   "response-content-language",
   "response-content-type",
   "response-expires",
+  "select",
+  "select-type",
   "tagging",
   "torrent",
   "uploadId",
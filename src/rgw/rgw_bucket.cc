@@ -2118,6 +2118,7 @@ RGWDataChangesLog::RGWDataChangesLog(RGWSI_Zone *zone_svc, RGWSI_Cls *cls_svc)
   num_shards = cct->_conf->rgw_data_log_num_shards;
 
   oids = new string[num_shards];
+  batches.reset(new ShardBatches[num_shards]);
 
   string prefix = cct->_conf->rgw_data_log_obj_prefix;
 
@@ -2305,7 +2306,6 @@ int RGWDataChangesLog::add_entry(const RGWBucketInfo& bucket_info, int shard_id)
   status->cond = new RefCountedCond;
   status->pending = true;
 
-  string& oid = oids[index];
   real_time expiration;
 
   int ret;
@@ -2328,7 +2328,9 @@ int RGWDataChangesLog::add_entry(const RGWBucketInfo& bucket_info, int shard_id)
 
     ldout(cct, 20) << "RGWDataChangesLog::add_entry() sending update with now=" << now << " cur_expiration=" << expiration << dendl;
 
-    ret = svc.cls->timelog.add(oid, now, section, change.key, bl, null_yield);
+    cls_log_entry entry;
+    svc.cls->timelog.prepare_entry(entry, now, section, change.key, bl);
+    ret = add_batched(index, std::move(entry));
 
     now = real_clock::now();
 
@@ -2350,6 +2352,40 @@ int RGWDataChangesLog::add_entry(const RGWBucketInfo& bucket_info, int shard_id)
   return ret;
 }
 
+int RGWDataChangesLog::add_batched(int index, cls_log_entry&& entry)
+{
+  auto& b = batches[index];
+
+  std::unique_lock l{b.lock};
+  if (!b.open) {
+    b.open = std::make_shared<LogBatch>();
+  }
+  auto batch = b.open;
+  batch->entries.push_back(std::move(entry));
+
+  b.cond.wait(l, [&] { return batch->done || !b.writing; });
+  if (batch->done) {
+    return batch->ret;
+  }
+
+  /* no write in flight, this one takes all the entries queued meanwhile */
+  b.writing = true;
+  b.open.reset();
+  l.unlock();
+
+  ldout(cct, 20) << "RGWDataChangesLog::add_batched() writing " << batch->entries.size()
+                 << " entries to " << oids[index] << dendl;
+  int ret = svc.cls->timelog.add(oids[index], batch->entries, nullptr, true, null_yield);
+
+  l.lock();
+  batch->ret = ret;
+  batch->done = true;
+  b.writing = false;
+  b.cond.notify_all();
+
+  return ret;
+}
+
 int RGWDataChangesLog::list_entries(int shard, const real_time& start_time, const real_time& end_time, int max_entries,
 				    list<rgw_data_change_log_entry>& entries,
 				    const string& marker,
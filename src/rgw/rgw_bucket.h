@@ -534,6 +534,26 @@ private:
 
   map<rgw_bucket_shard, bool> cur_cycle;
 
+  /* the entries added to a log shard while a write to it is in flight go in
+   * the next write, together
+   */
+  struct LogBatch {
+    list<cls_log_entry> entries;
+    bool done = false;
+    int ret = 0;
+  };
+
+  struct ShardBatches {
+    ceph::mutex lock = ceph::make_mutex("RGWDataChangesLog::ShardBatches");
+    ceph::condition_variable cond;
+    std::shared_ptr<LogBatch> open;
+    bool writing = false;
+  };
+
+  std::unique_ptr<ShardBatches[]> batches;
+
+  int add_batched(int index, cls_log_entry&& entry);
+
   void _get_change(const rgw_bucket_shard& bs, ChangeStatusPtr& status);
   void register_renew(rgw_bucket_shard& bs);
   void update_renewed(rgw_bucket_shard& bs, real_time& expiration);
@@ -46,25 +46,9 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << lru_counter
-                   << " promotion_ts=" << entry->lru_promotion_ts << dendl;
-    rl.unlock();
-    std::unique_lock wl{lock};  // write lock for insertion
-    /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
-      ldout(cct, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
-      if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
-      return -ENOENT;
-    }
-
-    entry = &iter->second;
-    /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(name, *entry, iter->second.lru_iter);
-    }
-  }
+  /* no write lock for the lru, the entry is given a second chance when
+   * it comes up for eviction */
+  entry->referenced.store(true, std::memory_order_relaxed);
 
   ObjectCacheInfo& src = iter->second.info;
   if ((src.flags & mask) != mask) {
@@ -142,8 +126,18 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
   ldout(cct, 10) << "cache put: name=" << name << " info.flags=0x"
                  << std::hex << info.flags << std::dec << dendl;
 
-  auto [iter, inserted] = cache_map.emplace(name, ObjectCacheEntry{});
+  auto [iter, inserted] = cache_map.try_emplace(name);
   ObjectCacheEntry& entry = iter->second;
+  if (!inserted && info.status >= 0 &&
+      (info.flags & CACHE_FLAG_OBJV) && (entry.info.flags & CACHE_FLAG_OBJV) &&
+      info.version.tag == entry.info.version.tag &&
+      info.version.ver < entry.info.version.ver) {
+    /* a notification overtaken by a newer one, or a read racing with it */
+    ldout(cct, 10) << "cache put: name=" << name << " version="
+                   << info.version.ver << " older than cached version="
+                   << entry.info.version.ver << ", ignored" << dendl;
+    return;
+  }
   entry.info.time_added = ceph::coarse_mono_clock::now();
   if (inserted) {
     entry.lru_iter = lru.end();
@@ -230,6 +224,8 @@ bool ObjectCache::remove(const string& name)
 void ObjectCache::touch_lru(const string& name, ObjectCacheEntry& entry,
 			    std::list<string>::iterator& lru_iter)
 {
+  // each entry gets at most one second chance per pass over the lru
+  unsigned long chances = lru_size;
   while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
     auto iter = lru.begin();
     if ((*iter).compare(name) == 0) {
@@ -240,6 +236,12 @@ void ObjectCache::touch_lru(const string& name, ObjectCacheEntry& entry,
       break;
     }
     auto map_iter = cache_map.find(*iter);
+    if (map_iter != cache_map.end() && chances > 0 &&
+        map_iter->second.referenced.exchange(false, std::memory_order_relaxed)) {
+      --chances;
+      lru.splice(lru.end(), lru, iter);
+      continue;
+    }
     ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
     if (map_iter != cache_map.end()) {
       ObjectCacheEntry& entry = map_iter->second;
@@ -257,14 +259,9 @@ void ObjectCache::touch_lru(const string& name, ObjectCacheEntry& entry,
     ldout(cct, 10) << "adding " << name << " to cache LRU end" << dendl;
   } else {
     ldout(cct, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
-    --lru_iter;
+    lru.splice(lru.end(), lru, lru_iter);
   }
-
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  entry.referenced.store(false, std::memory_order_relaxed);
 }
 
 void ObjectCache::remove_lru(const string& name,
@@ -311,8 +308,6 @@ void ObjectCache::do_invalidate_all()
   lru.clear();
 
   lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
 
   for (auto& cache : chained_cache) {
     cache->invalidate_all();
@@ -5,6 +5,7 @@
 #define CEPH_RGWCACHE_H
 
 #include <string>
+#include <atomic>
 #include <map>
 #include <unordered_map>
 #include "include/types.h"
@@ -18,6 +19,8 @@
 enum {
   UPDATE_OBJ,
   REMOVE_OBJ,
+  /* the RGWCacheNotifyInfo of the objects follow in the notify payload */
+  BATCH_OBJS,
 };
 
 #define CACHE_FLAG_DATA           0x01
@@ -147,19 +150,20 @@ public:
 struct ObjectCacheEntry {
   ObjectCacheInfo info;
   std::list<string>::iterator lru_iter;
-  uint64_t lru_promotion_ts;
+  // set by the readers under the shared lock; an entry referenced since
+  // it was last at the head of the lru is moved back to the end instead
+  // of being evicted
+  mutable std::atomic<bool> referenced{false};
   uint64_t gen;
   std::vector<pair<RGWChainedCache *, string> > chained_entries;
 
-  ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
+  ObjectCacheEntry() : gen(0) {}
 };
 
 class ObjectCache {
   std::unordered_map<string, ObjectCacheEntry> cache_map;
   std::list<string> lru;
   unsigned long lru_size;
-  unsigned long lru_counter;
-  unsigned long lru_window;
   ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache");
   CephContext *cct;
 
@@ -176,7 +180,7 @@ class ObjectCache {
   void do_invalidate_all();
 
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), cct(NULL), enabled(false) { }
+  ObjectCache() : lru_size(0), cct(NULL), enabled(false) { }
   ~ObjectCache();
   int get(const std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   std::optional<ObjectCacheInfo> get(const std::string& name) {
@@ -202,7 +206,6 @@ public:
   bool remove(const std::string& name);
   void set_ctx(CephContext *_cct) {
     cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
     expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
 						"rgw_cache_expiry_interval"));
   }
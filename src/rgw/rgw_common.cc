@@ -850,7 +850,9 @@ void RGWHTTPArgs::append(const string& name, const string& val)
       (name.compare("append") == 0) ||
       (name.compare("position") == 0) ||
       (name.compare("policyStatus") == 0) ||
-      (name.compare("publicAccessBlock") == 0)) {
+      (name.compare("publicAccessBlock") == 0) ||
+      (name.compare("select") == 0) ||
+      (name.compare("select-type") == 0)) {
     sub_resources[name] = val;
   } else if (name[0] == 'r') { // root of all evil
     if ((name.compare("response-content-type") == 0) ||
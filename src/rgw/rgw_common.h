@@ -18,6 +18,7 @@
 #define CEPH_RGW_COMMON_H
 
 #include <array>
+#include <memory_resource>
 
 #include <boost/utility/string_view.hpp>
 
@@ -373,9 +374,13 @@ class RGWHTTPArgs {
   }
 }; // RGWHTTPArgs
 
-const char *rgw_conf_get(const map<string, string, ltstr_nocase>& conf_map, const char *name, const char *def_val);
-int rgw_conf_get_int(const map<string, string, ltstr_nocase>& conf_map, const char *name, int def_val);
-bool rgw_conf_get_bool(const map<string, string, ltstr_nocase>& conf_map, const char *name, bool def_val);
+/* the headers and variables of a request, in the arena of its RGWEnv */
+using rgw_env_map_t = std::pmr::map<std::string, std::string,
+                                    ltstr_nocase_transparent>;
+
+const char *rgw_conf_get(const rgw_env_map_t& conf_map, const char *name, const char *def_val);
+int rgw_conf_get_int(const rgw_env_map_t& conf_map, const char *name, int def_val);
+bool rgw_conf_get_bool(const rgw_env_map_t& conf_map, const char *name, bool def_val);
 
 class RGWEnv;
 
@@ -394,7 +399,13 @@ public:
 };
 
 class RGWEnv {
-  std::map<string, string, ltstr_nocase> env_map;
+  /* the nodes of the env map of a request are carved out of a buffer of the
+   * env, and of the blocks the arena grows into past it, and are released
+   * all at once with the env at the end of the request */
+  static constexpr size_t ARENA_INLINE_SIZE = 2048;
+  alignas(std::max_align_t) char arena_buf[ARENA_INLINE_SIZE];
+  std::pmr::monotonic_buffer_resource arena{arena_buf, sizeof(arena_buf)};
+  rgw_env_map_t env_map{&arena};
   RGWConf conf;
 public:
   void init(CephContext *cct);
@@ -407,7 +418,7 @@ public:
   bool exists(const char *name) const;
   bool exists_prefix(const char *prefix) const;
   void remove(const char *name);
-  const std::map<string, string, ltstr_nocase>& get_map() const { return env_map; }
+  const rgw_env_map_t& get_map() const { return env_map; }
   int get_enable_ops_log() const {
     return conf.enable_ops_log;
   }
@@ -544,6 +555,9 @@ enum RGWOpType {
   RGW_OP_PUT_BUCKET_PUBLIC_ACCESS_BLOCK,
   RGW_OP_GET_BUCKET_PUBLIC_ACCESS_BLOCK,
   RGW_OP_DELETE_BUCKET_PUBLIC_ACCESS_BLOCK,
+
+  /* s3 select */
+  RGW_OP_SELECT_OBJ_CONTENT,
 };
 
 class RGWAccessControlPolicy;
@@ -1,6 +1,11 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab ft=cpp
 
+#include <algorithm>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
 #include "rgw_compression.h"
 
 #define dout_subsys ceph_subsys_rgw
@@ -32,38 +37,138 @@ int rgw_compression_info_from_attrset(map<string, bufferlist>& attrs,
 
 //------------RGWPutObj_Compress---------------
 
+/* the workers shared by the compression filters of all the requests */
+static boost::asio::thread_pool& get_compression_pool(CephContext* cct)
+{
+  static boost::asio::thread_pool pool(
+    cct->_conf.get_val<uint64_t>("rgw_compression_threads"));
+  return pool;
+}
+
+RGWPutObj_Compress::RGWPutObj_Compress(CephContext* cct_,
+                                       CompressorRef compressor,
+                                       rgw::putobj::DataProcessor *next)
+  : Pipe(next), cct(cct_), compressor(compressor),
+    max_jobs(cct->_conf.get_val<uint64_t>("rgw_compression_threads"))
+{
+#ifdef HAVE_QATZIP
+  // the accelerator does the work, over a single session
+  if (compressor->qat_enabled) {
+    max_jobs = 0;
+  }
+#endif
+}
+
+RGWPutObj_Compress::~RGWPutObj_Compress()
+{
+  // the jobs of a failed upload are left to the workers, which own them
+  std::unique_lock l{lock};
+  cond.wait(l, [this] {
+    return std::all_of(jobs.begin(), jobs.end(),
+                       [] (const auto& job) { return job->done; });
+  });
+}
+
+int RGWPutObj_Compress::handle_compressed(bufferlist& in, bufferlist& out,
+                                          int cr, uint64_t logical_offset)
+{
+  if ((logical_offset > 0 && compressed) || // if previous part was compressed
+      (logical_offset == 0)) {              // or it's the first part
+    if (cr < 0) {
+      if (logical_offset > 0) {
+        lderr(cct) << "Compression failed with exit code " << cr
+            << " for next part, compression process failed" << dendl;
+        return -EIO;
+      }
+      compressed = false;
+      ldout(cct, 5) << "Compression failed with exit code " << cr
+          << " for first part, storing uncompressed" << dendl;
+      out.claim(in);
+    } else {
+      compressed = true;
+
+      compression_block newbl;
+      size_t bs = blocks.size();
+      newbl.old_ofs = logical_offset;
+      newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
+      newbl.len = out.length();
+      blocks.push_back(newbl);
+    }
+  } else {
+    compressed = false;
+    out.claim(in);
+  }
+  return 0;
+}
+
+int RGWPutObj_Compress::submit(bufferlist&& in, uint64_t logical_offset)
+{
+  auto job = std::make_shared<Job>();
+  job->in = std::move(in);
+  job->logical_offset = logical_offset;
+  jobs.push_back(job);
+
+  boost::asio::post(get_compression_pool(cct),
+    [this, job, compressor = compressor] {
+      bufferlist out;
+      int r = compressor->compress(job->in, out);
+      std::lock_guard l{lock};
+      job->out = std::move(out);
+      job->r = r;
+      job->done = true;
+      cond.notify_all();
+    });
+
+  if (jobs.size() > max_jobs) {
+    return complete_front();
+  }
+  return 0;
+}
+
+int RGWPutObj_Compress::complete_front()
+{
+  auto job = jobs.front();
+  {
+    std::unique_lock l{lock};
+    cond.wait(l, [&job] { return job->done; });
+  }
+  jobs.pop_front();
+
+  int r = handle_compressed(job->in, job->out, job->r, job->logical_offset);
+  if (r < 0) {
+    return r;
+  }
+  return Pipe::process(std::move(job->out), job->logical_offset);
+}
+
 int RGWPutObj_Compress::process(bufferlist&& in, uint64_t logical_offset)
 {
+  if (in.length() > 0 && max_jobs > 0 &&
+      (logical_offset == 0 || compressed)) {
+    ldout(cct, 10) << "Compression for rgw is enabled, compress part " << in.length() << dendl;
+    return submit(std::move(in), logical_offset);
+  }
+
+  // the chunks being compressed go first, and the flush drains them
+  while (!jobs.empty()) {
+    int r = complete_front();
+    if (r < 0) {
+      return r;
+    }
+  }
+
   bufferlist out;
   if (in.length() > 0) {
     // compression stuff
+    int cr = 0;
     if ((logical_offset > 0 && compressed) || // if previous part was compressed
         (logical_offset == 0)) {              // or it's the first part
       ldout(cct, 10) << "Compression for rgw is enabled, compress part " << in.length() << dendl;
-      int cr = compressor->compress(in, out);
-      if (cr < 0) {
-        if (logical_offset > 0) {
-          lderr(cct) << "Compression failed with exit code " << cr
-              << " for next part, compression process failed" << dendl;
-          return -EIO;
-        }
-        compressed = false;
-        ldout(cct, 5) << "Compression failed with exit code " << cr
-            << " for first part, storing uncompressed" << dendl;
-        out.claim(in);
-      } else {
-        compressed = true;
-    
-        compression_block newbl;
-        size_t bs = blocks.size();
-        newbl.old_ofs = logical_offset;
-        newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
-        newbl.len = out.length();
-        blocks.push_back(newbl);
-      }
-    } else {
-      compressed = false;
-      out.claim(in);
+      cr = compressor->compress(in, out);
+    }
+    int r = handle_compressed(in, out, cr, logical_offset);
+    if (r < 0) {
+      return r;
     }
     // end of compression stuff
   }
@@ -4,8 +4,12 @@
 #ifndef CEPH_RGW_COMPRESSION_H
 #define CEPH_RGW_COMPRESSION_H
 
+#include <deque>
+#include <memory>
 #include <vector>
 
+#include "common/ceph_mutex.h"
+
 #include "compressor/Compressor.h"
 #include "rgw_putobj.h"
 #include "rgw_op.h"
@@ -41,10 +45,30 @@ class RGWPutObj_Compress : public rgw::putobj::Pipe
   bool compressed{false};
   CompressorRef compressor;
   std::vector<compression_block> blocks;
+
+  /* a chunk compressed by the workers of rgw_compression_threads. the chunks
+   * go to the next filter in order, as their compression finishes */
+  struct Job {
+    bufferlist in;
+    bufferlist out;
+    uint64_t logical_offset;
+    int r = 0;
+    bool done = false;
+  };
+  std::deque<std::shared_ptr<Job>> jobs;
+  size_t max_jobs;
+  ceph::mutex lock = ceph::make_mutex("RGWPutObj_Compress::lock");
+  ceph::condition_variable cond;
+
+  int submit(bufferlist&& in, uint64_t logical_offset);
+  // wait for the oldest job and pass its chunk on
+  int complete_front();
+  int handle_compressed(bufferlist& in, bufferlist& out, int cr,
+                        uint64_t logical_offset);
 public:
   RGWPutObj_Compress(CephContext* cct_, CompressorRef compressor,
-                     rgw::putobj::DataProcessor *next)
-    : Pipe(next), cct(cct_), compressor(compressor) {}
+                     rgw::putobj::DataProcessor *next);
+  ~RGWPutObj_Compress() override;
 
   int process(bufferlist&& data, uint64_t logical_offset) override;
 
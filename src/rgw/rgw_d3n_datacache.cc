@@ -0,0 +1,224 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#include "rgw_d3n_datacache.h"
+#include "rgw_perf_counters.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/Thread.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/perf_counters.h"
+
+#define dout_subsys ceph_subsys_rgw
+#undef dout_prefix
+#define dout_prefix *_dout << "d3n cache: "
+
+// the bytes of the fills queued at most, the ones above are dropped
+static constexpr uint64_t max_fill_bytes = 256 << 20;
+static constexpr size_t max_file_name = 250;
+
+D3nDataCache::D3nDataCache(CephContext *cct)
+  : cct(cct),
+    path(cct->_conf.get_val<std::string>("rgw_d3n_l1_datacache_persistent_path")),
+    capacity(cct->_conf.get_val<Option::size_t>("rgw_d3n_l1_datacache_size"))
+{}
+
+D3nDataCache::~D3nDataCache()
+{
+  shutdown();
+}
+
+int D3nDataCache::init()
+{
+  // the files of a previous run are not indexed, start afresh
+  if (::mkdir(path.c_str(), 0755) < 0 && errno != EEXIST) {
+    int r = -errno;
+    lderr(cct) << "ERROR: failed to create " << path << ": "
+               << cpp_strerror(r) << dendl;
+    return r;
+  }
+  DIR *dir = ::opendir(path.c_str());
+  if (!dir) {
+    int r = -errno;
+    lderr(cct) << "ERROR: failed to open " << path << ": "
+               << cpp_strerror(r) << dendl;
+    return r;
+  }
+  while (struct dirent *de = ::readdir(dir)) {
+    if (de->d_name[0] == '.') {
+      continue;
+    }
+    std::string file_path = path + "/" + de->d_name;
+    ::unlink(file_path.c_str());
+  }
+  ::closedir(dir);
+
+  ldout(cct, 1) << "caching in " << path << ", up to " << capacity
+                << " bytes" << dendl;
+  writer = make_named_thread("rgw_d3n_fill", &D3nDataCache::writer_entry,
+                             this);
+  return 0;
+}
+
+void D3nDataCache::shutdown()
+{
+  {
+    std::lock_guard l{lock};
+    stopping = true;
+  }
+  fill_cond.notify_all();
+  if (writer.joinable()) {
+    writer.join();
+  }
+}
+
+std::string D3nDataCache::get_key(const std::string& pool,
+                                  const std::string& oid)
+{
+  std::string key;
+  key.reserve(pool.size() + oid.size() + 1);
+  key.append(pool).append("/").append(oid);
+  return key;
+}
+
+std::string D3nDataCache::get_file_path(const std::string& key) const
+{
+  static const char hex[] = "0123456789ABCDEF";
+  std::string file_path = path;
+  file_path.append("/");
+  for (unsigned char c : key) {
+    if (isalnum(c) || c == '-' || c == '_' || c == '.') {
+      file_path.push_back(c);
+    } else {
+      file_path.push_back('%');
+      file_path.push_back(hex[c >> 4]);
+      file_path.push_back(hex[c & 0xf]);
+    }
+  }
+  return file_path;
+}
+
+bool D3nDataCache::get(const std::string& key, uint64_t ofs, uint64_t len,
+                       ceph::bufferlist *bl)
+{
+  {
+    std::lock_guard l{lock};
+    auto i = entries.find(key);
+    if (i == entries.end() || ofs + len > i->second.size) {
+      if (perfcounter) {
+        perfcounter->inc(l_rgw_d3n_cache_miss);
+      }
+      return false;
+    }
+    lru.splice(lru.end(), lru, i->second.lru_iter);
+  }
+
+  std::string error;
+  bufferlist data;
+  ssize_t r = data.pread_file(get_file_path(key).c_str(), ofs, len, &error);
+  if (r < 0 || data.length() != len) {
+    // evicted meanwhile
+    ldout(cct, 10) << "failed to read " << key << ": " << error << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_d3n_cache_miss);
+    }
+    return false;
+  }
+  ldout(cct, 20) << "hit " << key << " ofs=" << ofs << " len=" << len << dendl;
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_d3n_cache_hit);
+  }
+  bl->claim_append(data);
+  return true;
+}
+
+void D3nDataCache::put(const std::string& key, const ceph::bufferlist& bl)
+{
+  if (bl.length() == 0 || bl.length() > capacity ||
+      get_file_path(key).size() - path.size() > max_file_name) {
+    return;
+  }
+  std::lock_guard l{lock};
+  if (stopping || entries.count(key) || filling.count(key)) {
+    return;
+  }
+  if (fill_bytes + bl.length() > max_fill_bytes) {
+    ldout(cct, 10) << "dropped the fill of " << key << dendl;
+    return;
+  }
+  filling.insert(key);
+  fills.emplace_back(key, bl);
+  fill_bytes += bl.length();
+  fill_cond.notify_one();
+}
+
+void D3nDataCache::writer_entry()
+{
+  std::unique_lock l{lock};
+  while (!stopping) {
+    if (fills.empty()) {
+      fill_cond.wait(l);
+      continue;
+    }
+    auto [key, bl] = std::move(fills.front());
+    fills.pop_front();
+    fill_bytes -= bl.length();
+    l.unlock();
+    fill(key, bl);
+    l.lock();
+    filling.erase(key);
+  }
+}
+
+void D3nDataCache::fill(const std::string& key, ceph::bufferlist& bl)
+{
+  // readers only ever see whole files
+  const std::string file_path = get_file_path(key);
+  const std::string tmp_path = file_path + ".tmp";
+  int r = bl.write_file(tmp_path.c_str(), 0600);
+  if (r < 0) {
+    ldout(cct, 0) << "ERROR: failed to write " << tmp_path << ": "
+                  << cpp_strerror(r) << dendl;
+    ::unlink(tmp_path.c_str());
+    return;
+  }
+  if (::rename(tmp_path.c_str(), file_path.c_str()) < 0) {
+    r = -errno;
+    ldout(cct, 0) << "ERROR: failed to rename " << tmp_path << ": "
+                  << cpp_strerror(r) << dendl;
+    ::unlink(tmp_path.c_str());
+    return;
+  }
+
+  std::list<std::string> evicted;
+  {
+    std::lock_guard l{lock};
+    lru.push_back(key);
+    entries[key] = Entry{bl.length(), std::prev(lru.end())};
+    size += bl.length();
+    while (size > capacity && lru.front() != key) {
+      auto i = entries.find(lru.front());
+      size -= i->second.size;
+      entries.erase(i);
+      evicted.splice(evicted.end(), lru, lru.begin());
+    }
+  }
+  ldout(cct, 20) << "filled " << key << " len=" << bl.length() << dendl;
+
+  for (const auto& k : evicted) {
+    ldout(cct, 20) << "evicted " << k << dendl;
+    ::unlink(get_file_path(k).c_str());
+  }
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_d3n_cache_fill);
+    if (!evicted.empty()) {
+      perfcounter->inc(l_rgw_d3n_cache_evict, evicted.size());
+    }
+  }
+}
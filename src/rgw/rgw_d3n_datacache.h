@@ -0,0 +1,69 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#pragma once
+
+#include <deque>
+#include <list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "include/buffer.h"
+#include "include/common_fwd.h"
+#include "common/ceph_mutex.h"
+
+/*
+ * A read-through cache of the data of the tail objects, as files in a
+ * local directory meant to be on a fast local device.
+ *
+ * The tail objects are not modified once written, and their names carry
+ * the prefix of the manifest that wrote them, so an object name is a key
+ * good for a version of the object data. Each cached object holds the
+ * bytes from the start of the tail object read the first time; the read
+ * from rados that missed fills it asynchronously. The least recently
+ * used objects are evicted above rgw_d3n_l1_datacache_size.
+ */
+class D3nDataCache {
+  struct Entry {
+    uint64_t size;
+    std::list<std::string>::iterator lru_iter;
+  };
+
+  CephContext *cct;
+  std::string path;
+  uint64_t capacity;
+
+  ceph::mutex lock = ceph::make_mutex("D3nDataCache::lock");
+  std::unordered_map<std::string, Entry> entries;
+  std::list<std::string> lru; // least recently used first
+  uint64_t size = 0;
+
+  // the fills waiting for the writer thread
+  ceph::condition_variable fill_cond;
+  std::deque<std::pair<std::string, ceph::bufferlist>> fills;
+  std::unordered_set<std::string> filling;
+  uint64_t fill_bytes = 0;
+  bool stopping = false;
+  std::thread writer;
+
+  std::string get_file_path(const std::string& key) const;
+  void writer_entry();
+  void fill(const std::string& key, ceph::bufferlist& bl);
+
+public:
+  explicit D3nDataCache(CephContext *cct);
+  ~D3nDataCache();
+
+  int init();
+  void shutdown();
+
+  static std::string get_key(const std::string& pool, const std::string& oid);
+
+  // read len bytes at ofs of the tail object if they are cached
+  bool get(const std::string& key, uint64_t ofs, uint64_t len,
+           ceph::bufferlist *bl);
+  // queue the bytes from the start of the tail object to be cached
+  void put(const std::string& key, const ceph::bufferlist& bl);
+};
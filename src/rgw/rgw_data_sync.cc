@@ -3323,6 +3323,35 @@ public:
   }
 };
 
+// lists a bilog page alongside the sync of the previous one, the result is
+// left for the parent so that its collect() sees no error
+class RGWPrefetchBucketIndexLogCR : public RGWCoroutine {
+  RGWDataSyncCtx *sc;
+  const rgw_bucket_shard& bs;
+  string marker;
+  list<rgw_bi_log_entry> *result;
+  int *ret;
+  bool *done;
+
+public:
+  RGWPrefetchBucketIndexLogCR(RGWDataSyncCtx *_sc, const rgw_bucket_shard& _bs,
+                              const string& _marker,
+                              list<rgw_bi_log_entry> *_result,
+                              int *_ret, bool *_done)
+    : RGWCoroutine(_sc->cct), sc(_sc), bs(_bs), marker(_marker),
+      result(_result), ret(_ret), done(_done) {}
+
+  int operate() override {
+    reenter(this) {
+      yield call(new RGWListBucketIndexLogCR(sc, bs, marker, result));
+      *ret = retcode;
+      *done = true;
+      return set_cr_done();
+    }
+    return 0;
+  }
+};
+
 #define BUCKET_SYNC_UPDATE_MARKER_WINDOW 10
 
 class RGWBucketFullSyncShardMarkerTrack : public RGWSyncShardMarkerTrack<rgw_obj_key, rgw_obj_key> {
@@ -3802,11 +3831,12 @@ int RGWBucketShardFullSyncCR::operate()
                                  entry->key, &marker_tracker, zones_trace, tn),
                       false);
         }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while ((int)num_spawned() > sc->bucket_sync_window.get()) {
           yield wait_for_child();
           bool again = true;
           while (again) {
             again = collect(&ret, nullptr);
+            sc->bucket_sync_window.update(ret);
             if (ret < 0) {
               tn->log(10, "a sync operation returned error");
               sync_status = ret;
@@ -3874,6 +3904,11 @@ class RGWBucketShardIncrementalSyncCR : public RGWCoroutine {
   list<rgw_bi_log_entry> list_result;
   list<rgw_bi_log_entry>::iterator entries_iter, entries_end;
   map<pair<string, string>, pair<real_time, RGWModifyOp> > squash_map;
+  string next_marker;
+  list<rgw_bi_log_entry> next_list_result;
+  int prefetch_ret{0};
+  bool prefetching{false};
+  bool prefetch_done{false};
   rgw_bucket_shard_sync_info& sync_info;
   rgw_obj_key key;
   rgw_bi_log_entry *entry{nullptr};
@@ -3938,10 +3973,17 @@ int RGWBucketShardIncrementalSyncCR::operate()
         tn->log(0, "ERROR: lease is not taken, abort");
         return set_cr_error(-ECANCELED);
       }
-      tn->log(20, SSTR("listing bilog for incremental sync" << sync_info.inc_marker.position));
-      set_status() << "listing bilog; position=" << sync_info.inc_marker.position;
-      yield call(new RGWListBucketIndexLogCR(sc, bs, sync_info.inc_marker.position,
-                                             &list_result));
+      if (prefetching) {
+        prefetching = false;
+        list_result = std::move(next_list_result);
+        next_list_result.clear();
+        retcode = prefetch_ret;
+      } else {
+        tn->log(20, SSTR("listing bilog for incremental sync" << sync_info.inc_marker.position));
+        set_status() << "listing bilog; position=" << sync_info.inc_marker.position;
+        yield call(new RGWListBucketIndexLogCR(sc, bs, sync_info.inc_marker.position,
+                                               &list_result));
+      }
       if (retcode < 0 && retcode != -ENOENT) {
         /* wait for all operations to complete */
         drain_all();
@@ -3980,6 +4022,24 @@ int RGWBucketShardIncrementalSyncCR::operate()
         }
       }
 
+      /* list the next page of the bilog while the objects of this one sync */
+      if (!syncstopped && !list_result.empty()) {
+        next_marker = list_result.back().id;
+        {
+          ssize_t p = next_marker.find('#');
+          if (p >= 0) {
+            next_marker = next_marker.substr(p + 1);
+          }
+        }
+        tn->log(20, SSTR("prefetching bilog for incremental sync" << next_marker));
+        prefetching = true;
+        prefetch_done = false;
+        spawn(new RGWPrefetchBucketIndexLogCR(sc, bs, next_marker,
+                                              &next_list_result,
+                                              &prefetch_ret, &prefetch_done),
+              false);
+      }
+
       entries_iter = list_result.begin();
       for (; entries_iter != entries_end; ++entries_iter) {
         if (lease_cr && !lease_cr->is_locked()) {
@@ -4107,12 +4167,13 @@ int RGWBucketShardIncrementalSyncCR::operate()
                   false);
           }
         // }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while ((int)num_spawned() > sc->bucket_sync_window.get()) {
           set_status() << "num_spawned() > spawn_window";
           yield wait_for_child();
           bool again = true;
           while (again) {
             again = collect(&ret, nullptr);
+            sc->bucket_sync_window.update(ret);
             if (ret < 0) {
               tn->log(10, "a sync operation returned error");
               sync_status = ret;
@@ -4122,6 +4183,20 @@ int RGWBucketShardIncrementalSyncCR::operate()
           }
         }
       }
+      /* the next page is used once it arrived, the sync ops that completed
+       * meanwhile are collected */
+      while (prefetching && !prefetch_done) {
+        yield wait_for_child();
+        bool again = true;
+        while (again) {
+          again = collect(&ret, nullptr);
+          if (ret < 0) {
+            tn->log(10, "a sync operation returned error");
+            sync_status = ret;
+            /* we have reported this error */
+          }
+        }
+      }
     } while (!list_result.empty() && sync_status == 0 && !syncstopped);
 
     while (num_spawned()) {
@@ -330,6 +330,35 @@ struct RGWDataSyncEnv {
   string status_oid();
 };
 
+/* the number of objects the bucket shard syncs fetch at once from a zone:
+ * halved when the zone pushes back, and grown by one after a window of
+ * fetches that succeeded
+ */
+class RGWBucketSyncWindow {
+  int max_window{1};
+  int window{1};
+  int succeeded{0};
+
+public:
+  void init(int max) {
+    max_window = std::max(max, 1);
+    window = max_window;
+    succeeded = 0;
+  }
+
+  int get() const { return window; }
+
+  void update(int ret) {
+    if (ret == -EBUSY || ret == -EIO || ret == -ETIMEDOUT) {
+      window = std::max(window / 2, 1);
+      succeeded = 0;
+    } else if (ret >= 0 && window < max_window && ++succeeded >= window) {
+      ++window;
+      succeeded = 0;
+    }
+  }
+};
+
 struct RGWDataSyncCtx {
   CephContext *cct{nullptr};
   RGWDataSyncEnv *env{nullptr};
@@ -337,6 +366,8 @@ struct RGWDataSyncCtx {
   RGWRESTConn *conn{nullptr};
   rgw_zone_id source_zone;
 
+  RGWBucketSyncWindow bucket_sync_window;
+
   void init(RGWDataSyncEnv *_env,
             RGWRESTConn *_conn,
             const rgw_zone_id& _source_zone) {
@@ -344,6 +375,7 @@ struct RGWDataSyncCtx {
     env = _env;
     conn = _conn;
     source_zone = _source_zone;
+    bucket_sync_window.init(cct->_conf->rgw_bucket_sync_spawn_window);
   }
 };
 
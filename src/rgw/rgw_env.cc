@@ -41,7 +41,7 @@ void RGWEnv::init(CephContext *cct, char **envp)
   init(cct);
 }
 
-const char *rgw_conf_get(const map<string, string, ltstr_nocase>& conf_map, const char *name, const char *def_val)
+const char *rgw_conf_get(const rgw_env_map_t& conf_map, const char *name, const char *def_val)
 {
   auto iter = conf_map.find(name);
   if (iter == conf_map.end())
@@ -55,7 +55,7 @@ const char *RGWEnv::get(const char *name, const char *def_val) const
   return rgw_conf_get(env_map, name, def_val);
 }
 
-int rgw_conf_get_int(const map<string, string, ltstr_nocase>& conf_map, const char *name, int def_val)
+int rgw_conf_get_int(const rgw_env_map_t& conf_map, const char *name, int def_val)
 {
   auto iter = conf_map.find(name);
   if (iter == conf_map.end())
@@ -70,7 +70,7 @@ int RGWEnv::get_int(const char *name, int def_val) const
   return rgw_conf_get_int(env_map, name, def_val);
 }
 
-bool rgw_conf_get_bool(const map<string, string, ltstr_nocase>& conf_map, const char *name, bool def_val)
+bool rgw_conf_get_bool(const rgw_env_map_t& conf_map, const char *name, bool def_val)
 {
   auto iter = conf_map.find(name);
   if (iter == conf_map.end())
@@ -122,7 +122,7 @@ bool RGWEnv::exists_prefix(const char *prefix) const
 
 void RGWEnv::remove(const char *name)
 {
-  map<string, string, ltstr_nocase>::iterator iter = env_map.find(name);
+  auto iter = env_map.find(name);
   if (iter != env_map.end())
     env_map.erase(iter);
 }
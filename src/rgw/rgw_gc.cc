@@ -17,6 +17,7 @@
 
 #include <list> // XXX
 #include <sstream>
+#include <thread>
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rgw
@@ -33,6 +34,7 @@ void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
   max_objs = min(static_cast<int>(cct->_conf->rgw_gc_max_objs), rgw_shards_max());
 
   obj_names = new string[max_objs];
+  transitioned_objects_cache = vector<std::atomic<bool>>(max_objs);
 
   for (int i = 0; i < max_objs; i++) {
     obj_names[i] = gc_oid_prefix;
@@ -40,9 +42,6 @@ void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
     snprintf(buf, 32, ".%d", i);
     obj_names[i].append(buf);
 
-    auto it = transitioned_objects_cache.begin() + i;
-    transitioned_objects_cache.insert(it, false);
-
     //version = 0 -> not ready for transition
     //version = 1 -> marked ready for transition
     librados::ObjectWriteOperation op;
@@ -293,6 +292,7 @@ class RGWGCIOManager {
     string oid;
     int index{-1};
     string tag;
+    ceph::mono_time start;
   };
 
   deque<IO> ios;
@@ -304,6 +304,24 @@ class RGWGCIOManager {
 
 #define MAX_AIO_DEFAULT 10
   size_t max_aio{MAX_AIO_DEFAULT};
+  size_t max_aio_limit{MAX_AIO_DEFAULT};
+  ceph::timespan target_latency;
+
+  /* the window of ios in flight is halved when the osds are slow to complete
+   * one, or push back, and grows by one with every io that completes in time
+   */
+  void adapt_window(int ret, ceph::timespan latency) {
+    if (target_latency == ceph::timespan::zero()) {
+      return;
+    }
+    if (latency > target_latency || ret == -EBUSY || ret == -ETIMEDOUT) {
+      max_aio = std::max<size_t>(1, max_aio / 2);
+      ldpp_dout(dpp, 20) << "gc io took " << latency << " ret=" << ret <<
+        ", max_aio=" << max_aio << dendl;
+    } else if (max_aio < max_aio_limit) {
+      ++max_aio;
+    }
+  }
 
 public:
   RGWGCIOManager(const DoutPrefixProvider* _dpp, CephContext *_cct, RGWGC *_gc) : dpp(_dpp),
@@ -311,13 +329,19 @@ public:
                                                   gc(_gc),
                                                   remove_tags(cct->_conf->rgw_gc_max_objs),
                                                   tag_io_size(cct->_conf->rgw_gc_max_objs) {
-    max_aio = cct->_conf->rgw_gc_max_concurrent_io;
+    max_aio_limit = cct->_conf->rgw_gc_max_concurrent_io;
+    max_aio = max_aio_limit;
+    target_latency = std::chrono::milliseconds(
+      cct->_conf->rgw_gc_io_target_latency_ms);
   }
 
   ~RGWGCIOManager() {
     for (auto io : ios) {
       io.c->release();
     }
+    if (perfcounter) {
+      perfcounter->dec(l_rgw_gc_ios, ios.size());
+    }
   }
 
   int schedule_io(IoCtx *ioctx, const string& oid, ObjectWriteOperation *op,
@@ -338,7 +362,10 @@ public:
     if (ret < 0) {
       return ret;
     }
-    ios.push_back(IO{IO::TailIO, c, oid, index, tag});
+    ios.push_back(IO{IO::TailIO, c, oid, index, tag, ceph::mono_clock::now()});
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_gc_ios);
+    }
 
     return 0;
   }
@@ -346,9 +373,16 @@ public:
   int handle_next_completion() {
     ceph_assert(!ios.empty());
     IO& io = ios.front();
+    // an io completed before we got to it says nothing about its latency
+    const bool was_complete = io.c->is_complete();
     io.c->wait_for_complete();
     int ret = io.c->get_return_value();
     io.c->release();
+    if (perfcounter) {
+      perfcounter->dec(l_rgw_gc_ios);
+    }
+    adapt_window(ret, was_complete ? ceph::timespan::zero() :
+                 ceph::mono_clock::now() - io.start);
 
     if (ret == -ENOENT) {
       ret = 0;
@@ -368,6 +402,10 @@ public:
       goto done;
     }
 
+    if (io.type == IO::TailIO && perfcounter) {
+      perfcounter->inc(l_rgw_gc_remove_tail);
+    }
+
     if (! gc->transitioned_objects_cache[io.index]) {
       schedule_tag_removal(io.index, io.tag);
     }
@@ -434,6 +472,7 @@ public:
     IO index_io;
     index_io.type = IO::IndexIO;
     index_io.index = index;
+    index_io.start = ceph::mono_clock::now();
 
     ldpp_dout(dpp, 20) << __func__ <<
       " removing entries from gc log shard index=" << index << ", size=" <<
@@ -458,6 +497,7 @@ public:
     if (perfcounter) {
       /* log the count of tags retired for rate estimation */
       perfcounter->inc(l_rgw_gc_retire, rt.size());
+      perfcounter->inc(l_rgw_gc_ios);
     }
     ios.push_back(index_io);
   }
@@ -479,6 +519,9 @@ public:
 	    index << " ret=" << ret << dendl;
       return ret;
     }
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_gc_retire, num_entries);
+    }
     return 0;
   }
 }; // class RGWGCIOManger
@@ -666,20 +709,41 @@ int RGWGC::process(bool expired_only)
   int max_secs = cct->_conf->rgw_gc_processor_max_time;
 
   const int start = ceph::util::generate_random_number(0, max_objs - 1);
+  const int num_threads = std::min<int>(cct->_conf->rgw_gc_processor_threads,
+                                        max_objs);
 
-  RGWGCIOManager io_manager(this, store->ctx(), this);
+  /* the threads take the next shard as they are done with one, each with
+   * its own ios
+   */
+  std::atomic<int> next = { 0 };
+  std::atomic<int> result = { 0 };
+  auto process_shards = [&] {
+    RGWGCIOManager io_manager(this, store->ctx(), this);
+
+    for (int i = next++; i < max_objs; i = next++) {
+      int index = (i + start) % max_objs;
+      int ret = process(index, max_secs, expired_only, io_manager);
+      if (ret < 0) {
+        result = ret;
+        next = max_objs; // stops the other threads too
+        return;
+      }
+    }
+    if (!going_down()) {
+      io_manager.drain();
+    }
+  };
 
-  for (int i = 0; i < max_objs; i++) {
-    int index = (i + start) % max_objs;
-    int ret = process(index, max_secs, expired_only, io_manager);
-    if (ret < 0)
-      return ret;
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; i++) {
+    threads.push_back(make_named_thread("rgw_gc_shards", process_shards));
   }
-  if (!going_down()) {
-    io_manager.drain();
+  process_shards();
+  for (auto& t : threads) {
+    t.join();
   }
 
-  return 0;
+  return result;
 }
 
 bool RGWGC::going_down()
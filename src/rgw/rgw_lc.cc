@@ -4,6 +4,7 @@
 #include <string.h>
 #include <iostream>
 #include <map>
+#include <thread>
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string.hpp>
@@ -482,9 +483,11 @@ class LCObjsLister {
   int64_t delay_ms;
 
 public:
-  LCObjsLister(rgw::sal::RGWRadosStore *_store, RGWBucketInfo& _bucket_info) :
+  LCObjsLister(rgw::sal::RGWRadosStore *_store, RGWBucketInfo& _bucket_info,
+               int shard_id = RGW_NO_SHARD) :
       store(_store), bucket_info(_bucket_info),
       target(store->getRados(), bucket_info), list_op(&target) {
+    target.set_shard_id(shard_id);
     list_op.params.list_versions = bucket_info.versioned();
     list_op.params.allow_unordered = true;
     delay_ms = store->ctx()->_conf.get_val<int64_t>("rgw_lc_thread_delay");
@@ -555,15 +558,48 @@ public:
 };
 
 
+/* spaces the object operations of the workers of a bucket out to at most
+ * rgw_lc_max_ops_per_sec
+ */
+class LCOpThrottle {
+  ceph::mutex lock = ceph::make_mutex("LCOpThrottle");
+  ceph::timespan interval = ceph::timespan::zero();
+  ceph::mono_time next;
+
+public:
+  explicit LCOpThrottle(uint64_t max_ops_per_sec) {
+    if (max_ops_per_sec > 0) {
+      interval = std::chrono::nanoseconds(std::chrono::seconds(1)) / max_ops_per_sec;
+    }
+  }
+
+  void wait() {
+    if (interval == ceph::timespan::zero()) {
+      return;
+    }
+    std::unique_lock l{lock};
+    auto now = ceph::mono_clock::now();
+    if (next < now) {
+      next = now;
+    }
+    auto when = next;
+    next += interval;
+    l.unlock();
+    std::this_thread::sleep_for(when - now);
+  }
+};
+
 struct op_env {
   lc_op& op;
   rgw::sal::RGWRadosStore *store;
   RGWLC *lc;
   RGWBucketInfo& bucket_info;
   LCObjsLister& ol;
+  LCOpThrottle& throttle;
 
   op_env(lc_op& _op, rgw::sal::RGWRadosStore *_store, RGWLC *_lc, RGWBucketInfo& _bucket_info,
-         LCObjsLister& _ol) : op(_op), store(_store), lc(_lc), bucket_info(_bucket_info), ol(_ol) {}
+         LCObjsLister& _ol, LCOpThrottle& _throttle) : op(_op), store(_store), lc(_lc),
+         bucket_info(_bucket_info), ol(_ol), throttle(_throttle) {}
 };
 
 class LCRuleOp;
@@ -1013,6 +1049,7 @@ int LCOpRule::process(rgw_bucket_dir_entry& o, const DoutPrefixProvider *dpp)
       return 0;
     }
 
+    env.throttle.wait();
     int r = (*selected)->process(ctx);
     if (r < 0) {
       ldpp_dout(dpp, 0) << "ERROR: remove_expired_obj " 
@@ -1072,6 +1109,17 @@ int RGWLC::bucket_lc_process(string& shard_id)
 		      << prefix_map.size()
 		      << dendl;
 
+  /* the objects of a prefix are processed by up to rgw_lc_max_wp_worker
+   * threads, each listing and processing the index shards it takes in turn.
+   * All the versions of an object are on the same shard, in order.
+   */
+  const uint32_t bucket_shards =
+    bucket_info.layout.current_index.layout.normal.num_shards;
+  const int num_shards = std::max<uint32_t>(bucket_shards, 1);
+  const int num_workers = std::clamp<int>(cct->_conf->rgw_lc_max_wp_worker,
+                                          1, num_shards);
+  LCOpThrottle throttle(cct->_conf->rgw_lc_max_ops_per_sec);
+
   rgw_obj_key pre_marker;
   rgw_obj_key next_marker;
   for(auto prefix_iter = prefix_map.begin(); prefix_iter != prefix_map.end(); ++prefix_iter) {
@@ -1087,37 +1135,75 @@ int RGWLC::bucket_lc_process(string& shard_id)
       pre_marker = next_marker;
     }
 
-    LCObjsLister ol(store, bucket_info);
-    ol.set_prefix(prefix_iter->first);
+    auto process_shard = [&](int shard_id) {
+      LCObjsLister ol(store, bucket_info, shard_id);
+      ol.set_prefix(prefix_iter->first);
 
-    ret = ol.init();
+      int ret = ol.init();
 
-    if (ret < 0) {
-      if (ret == (-ENOENT))
-        return 0;
-      ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
-      return ret;
-    }
+      if (ret < 0) {
+        if (ret != -ENOENT) {
+          ldpp_dout(this, 0) << "ERROR: store->list_objects():" <<dendl;
+        }
+        return ret;
+      }
 
-    op_env oenv(op, store, this, bucket_info, ol);
+      op_env oenv(op, store, this, bucket_info, ol, throttle);
 
-    LCOpRule orule(oenv);
+      LCOpRule orule(oenv);
 
-    orule.build();
+      orule.build();
 
-    rgw_bucket_dir_entry o;
-    for (; ol.get_obj(&o); ol.next()) {
-      ldpp_dout(this, 20) << __func__ << "(): key=" << o.key << dendl;
-      int ret = orule.process(o, this);
-      if (ret < 0) {
-        ldpp_dout(this, 20) << "ERROR: orule.process() returned ret="
-			    << ret
-			    << dendl;
-      }
+      rgw_bucket_dir_entry o;
+      for (; ol.get_obj(&o); ol.next()) {
+        ldpp_dout(this, 20) << __func__ << "(): key=" << o.key << dendl;
+        int ret = orule.process(o, this);
+        if (ret < 0) {
+          ldpp_dout(this, 20) << "ERROR: orule.process() returned ret="
+			      << ret
+			      << dendl;
+        }
 
-      if (going_down()) {
-        return 0;
+        if (going_down()) {
+          break;
+        }
       }
+      return 0;
+    };
+
+    std::atomic<int> next_shard = { 0 };
+    std::atomic<int> result = { 0 };
+    auto process_shards = [&] {
+      for (int i = next_shard++; i < num_shards; i = next_shard++) {
+        int r = process_shard(bucket_shards > 0 ? i : RGW_NO_SHARD);
+        if (r < 0) {
+          result = r;
+          next_shard = num_shards; // stops the other workers too
+          return;
+        }
+        if (going_down()) {
+          return;
+        }
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < num_workers; i++) {
+      workers.push_back(make_named_thread("lifecycle_wp", process_shards));
+    }
+    process_shards();
+    for (auto& t : workers) {
+      t.join();
+    }
+
+    if (result == -ENOENT) {
+      return 0;
+    }
+    if (result < 0) {
+      return result;
+    }
+    if (going_down()) {
+      return 0;
     }
   }
 
@@ -1,6 +1,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab ft=cpp
 
+#include "common/ceph_time.h"
 #include "common/errno.h"
 #include "common/Throttle.h"
 #include "common/WorkQueue.h"
@@ -24,6 +25,17 @@ void RGWLoadGenProcess::checkpoint()
   m_tp.drain(&req_wq);
 }
 
+/* report the rate of a phase of the load, once its requests are drained */
+static void report_phase(CephContext* cct, const char* phase, int num_reqs,
+			 ceph::mono_time start)
+{
+  double secs = std::chrono::duration<double>(ceph::mono_clock::now() -
+					      start).count();
+  ldout(cct, 0) << "loadgen: " << num_reqs << " " << phase << " requests in "
+		<< secs << "s, " << (secs > 0 ? num_reqs / secs : 0)
+		<< " req/s" << dendl;
+}
+
 void RGWLoadGenProcess::run()
 {
   m_tp.start(); /* start thread pool */
@@ -37,6 +49,12 @@ void RGWLoadGenProcess::run()
   int num_buckets;
   conf->get_val("num_buckets", 1, &num_buckets);
 
+  /* the small object reads are repeated to measure the request path */
+  int get_rounds;
+  conf->get_val("get_rounds", 1, &get_rounds);
+
+  ceph::mono_time start;
+
   vector<string> buckets(num_buckets);
 
   std::atomic<bool> failed = { false };
@@ -65,28 +83,36 @@ void RGWLoadGenProcess::run()
     objs[i] = buckets[i % num_buckets] + "/" + buf;
   }
 
+  start = ceph::mono_clock::now();
   for (i = 0; i < num_objs; i++) {
     gen_request("PUT", objs[i], 4096, &failed);
   }
 
   checkpoint();
+  report_phase(cct, "PUT", num_objs, start);
 
   if (failed) {
     derr << "ERROR: bucket creation failed" << dendl;
     goto done;
   }
 
-  for (i = 0; i < num_objs; i++) {
-    gen_request("GET", objs[i], 4096, NULL);
+  start = ceph::mono_clock::now();
+  for (int round = 0; round < get_rounds; round++) {
+    for (i = 0; i < num_objs; i++) {
+      gen_request("GET", objs[i], 4096, NULL);
+    }
   }
 
   checkpoint();
+  report_phase(cct, "GET", num_objs * get_rounds, start);
 
+  start = ceph::mono_clock::now();
   for (i = 0; i < num_objs; i++) {
     gen_request("DELETE", objs[i], 0, NULL);
   }
 
   checkpoint();
+  report_phase(cct, "DELETE", num_objs, start);
 
   for (i = 0; i < num_buckets; i++) {
     gen_request("DELETE", buckets[i], 0, NULL);
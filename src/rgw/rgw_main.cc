@@ -38,6 +38,7 @@
 #include "rgw_frontend.h"
 #include "rgw_http_client_curl.h"
 #include "rgw_perf_counters.h"
+#include "rgw_notify.h"
 #ifdef WITH_RADOSGW_AMQP_ENDPOINT
 #include "rgw_amqp.h"
 #endif
@@ -400,6 +401,9 @@ int radosgw_Main(int argc, const char **argv)
         dout(1) << "ERROR: failed to initialize Kafka manager" << dendl;
     }
 #endif
+    if (rgw::notify::init(cct.get(), store) < 0) {
+        dout(1) << "ERROR: failed to initialize persistent notifications" << dendl;
+    }
   }
 
   if (apis_map.count("swift") > 0) {
@@ -642,6 +646,7 @@ int radosgw_Main(int argc, const char **argv)
   shutdown_async_signal_handler();
 
   rgw_log_usage_finalize();
+  rgw::notify::shutdown();
 
   delete olog;
 
@@ -3,16 +3,355 @@
 
 #include "rgw_notify.h"
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
 #include <boost/algorithm/hex.hpp>
+#include "cls/2pc_queue/cls_2pc_queue_client.h"
+#include "cls/2pc_queue/cls_2pc_queue_const.h"
+#include "cls/2pc_queue/cls_2pc_queue_ops.h"
+#include "cls/lock/cls_lock_client.h"
 #include "rgw_pubsub.h"
 #include "rgw_pubsub_push.h"
 #include "rgw_perf_counters.h"
+#include "rgw_rados.h"
+#include "rgw_sal.h"
+#include "rgw_tools.h"
+#include "rgw_zone.h"
+#include "services/svc_zone.h"
 #include "common/dout.h"
+#include "common/random_string.h"
+#include "include/compat.h"
 
 #define dout_subsys ceph_subsys_rgw
 
 namespace rgw::notify {
 
+// an event of a persistent topic, with what is needed to push it
+struct event_entry_t {
+  rgw_pubsub_s3_record event;
+  std::string push_endpoint;
+  std::string push_endpoint_args;
+  std::string arn_topic;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(event, bl);
+    encode(push_endpoint, bl);
+    encode(push_endpoint_args, bl);
+    encode(arn_topic, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(event, bl);
+    decode(push_endpoint, bl);
+    decode(push_endpoint_args, bl);
+    decode(arn_topic, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(event_entry_t)
+
+// the names of all queues are kept as the omap keys of this object
+static const std::string queues_oid = "notif_queues";
+static const std::string queue_lock_name = "rgw_notify_queue";
+
+static std::string get_queue_name(CephContext* cct, const rgw_pubsub_topic& topic,
+    const rgw_obj_key& key) {
+  std::string name = "notif_queue." + topic.user.to_str() + "." + topic.name;
+  const auto shards = cct->_conf.get_val<uint64_t>("rgw_notify_persistent_queue_shards");
+  if (shards > 1) {
+    name += "." + std::to_string(rgw_shard_id(key.name, shards));
+  }
+  return name;
+}
+
+static int open_log_pool(rgw::sal::RGWRadosStore* store, librados::IoCtx& ioctx) {
+  return rgw_init_ioctx(store->getRados()->get_rados_handle(),
+      store->svc()->zone->get_zone_params().log_pool, ioctx, true);
+}
+
+static int reserve(librados::IoCtx& ioctx, const std::string& queue_name,
+    uint64_t size, cls_2pc_reservation::id_t& res_id, optional_yield y) {
+  cls_2pc_queue_reserve_op reserve_op;
+  reserve_op.size = size;
+  reserve_op.entries = 1;
+  bufferlist in, out;
+  encode(reserve_op, in);
+  int rval;
+  librados::ObjectWriteOperation op;
+  op.assert_exists();
+  op.exec(TPC_QUEUE_CLASS, TPC_QUEUE_RESERVE, in, &out, &rval);
+  const auto rc = rgw_rados_operate(ioctx, queue_name, &op, y,
+      librados::OPERATION_RETURNVEC);
+  if (rc < 0) {
+    return rc;
+  }
+  cls_2pc_queue_reserve_ret op_ret;
+  try {
+    auto iter = out.cbegin();
+    decode(op_ret, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+  res_id = op_ret.id;
+  return 0;
+}
+
+static int create_queue(CephContext* cct, librados::IoCtx& ioctx,
+    const std::string& queue_name, optional_yield y) {
+  librados::ObjectWriteOperation op;
+  op.create(true);
+  cls_2pc_queue_init(op, queue_name,
+      cct->_conf.get_val<Option::size_t>("rgw_notify_persistent_queue_size"));
+  auto rc = rgw_rados_operate(ioctx, queue_name, &op, y);
+  if (rc < 0 && rc != -EEXIST) {
+    return rc;
+  }
+  // let the queue be found by the workers
+  librados::ObjectWriteOperation reg_op;
+  std::map<std::string, bufferlist> keys{{queue_name, bufferlist()}};
+  reg_op.omap_set(keys);
+  return rgw_rados_operate(ioctx, queues_oid, &reg_op, y);
+}
+
+// add the event to the queue of the topic, the queue is created on the
+// first event of the topic
+static int enqueue(const req_state* s, rgw::sal::RGWRadosStore* store,
+    const rgw_pubsub_topic& topic, const rgw_obj_key& key,
+    const rgw_pubsub_s3_record& record) {
+  librados::IoCtx ioctx;
+  auto rc = open_log_pool(store, ioctx);
+  if (rc < 0) {
+    return rc;
+  }
+  event_entry_t entry{record, topic.dest.push_endpoint,
+      topic.dest.push_endpoint_args, topic.dest.arn_topic};
+  bufferlist bl;
+  encode(entry, bl);
+
+  const auto queue_name = get_queue_name(s->cct, topic, key);
+  cls_2pc_reservation::id_t res_id;
+  rc = reserve(ioctx, queue_name, bl.length(), res_id, s->yield);
+  if (rc == -ENOENT) {
+    rc = create_queue(s->cct, ioctx, queue_name, s->yield);
+    if (rc < 0) {
+      ldout(s->cct, 1) << "ERROR: failed to create notification queue: " <<
+          queue_name << ", with error: " << rc << dendl;
+      return rc;
+    }
+    rc = reserve(ioctx, queue_name, bl.length(), res_id, s->yield);
+  }
+  if (rc < 0) {
+    ldout(s->cct, 1) << "ERROR: failed to reserve on notification queue: " <<
+        queue_name << ", with error: " << rc << dendl;
+    return rc;
+  }
+  librados::ObjectWriteOperation op;
+  std::vector<bufferlist> bl_data_vec{std::move(bl)};
+  cls_2pc_queue_commit(op, std::move(bl_data_vec), res_id);
+  rc = rgw_rados_operate(ioctx, queue_name, &op, s->yield);
+  if (rc < 0) {
+    ldout(s->cct, 1) << "ERROR: failed to commit to notification queue: " <<
+        queue_name << ", with error: " << rc << dendl;
+    return rc;
+  }
+  return 0;
+}
+
+// the workers push the events of the persistent queues, each takes the
+// queues of its hash and holds their lock while pushing, so that a queue
+// is pushed by one gateway at a time and in order
+class Manager {
+  CephContext* const cct;
+  librados::IoCtx ioctx;
+  const std::string lock_cookie;
+  const unsigned max_workers;
+  static const uint32_t max_batch = 100;
+
+  std::mutex lock;
+  std::condition_variable cond;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+
+  // push a batch of the entries of the queue, returns the number pushed
+  int process_queue(const std::string& queue_name) {
+    rados::cls::lock::Lock l(queue_lock_name);
+    l.set_cookie(lock_cookie);
+    l.set_duration(utime_t(30, 0));
+    l.set_may_renew(true);
+    auto rc = l.lock_exclusive(&ioctx, queue_name);
+    if (rc == -EBUSY || rc == -EEXIST) {
+      // pushed by another gateway
+      return 0;
+    }
+    if (rc < 0) {
+      ldout(cct, 1) << "ERROR: failed to lock notification queue: " <<
+          queue_name << ", with error: " << rc << dendl;
+      return rc;
+    }
+
+    std::vector<cls_queue_entry> entries;
+    bool truncated;
+    std::string next_marker;
+    rc = cls_2pc_queue_list_entries(ioctx, queue_name, "", max_batch,
+        entries, &truncated, next_marker);
+    if (rc < 0) {
+      ldout(cct, 1) << "ERROR: failed to list notification queue: " <<
+          queue_name << ", with error: " << rc << dendl;
+      return rc;
+    }
+
+    // the endpoints of the batch, by their configuration
+    std::unordered_map<std::string, RGWPubSubEndpoint::Ptr> endpoints;
+    // the marker up to which (excluded) the entries were pushed
+    std::string end_marker = next_marker;
+    int pushed = 0;
+    for (auto& entry : entries) {
+      event_entry_t event_entry;
+      try {
+        auto iter = entry.data.cbegin();
+        decode(event_entry, iter);
+      } catch (buffer::error& err) {
+        // not going to push it ever, skip it
+        ldout(cct, 1) << "ERROR: failed to decode entry " << entry.marker <<
+            " of notification queue: " << queue_name << dendl;
+        ++pushed;
+        continue;
+      }
+      const auto ep_key = event_entry.push_endpoint + "|" +
+          event_entry.push_endpoint_args + "|" + event_entry.arn_topic;
+      auto ep = endpoints.find(ep_key);
+      try {
+        if (ep == endpoints.end()) {
+          ep = endpoints.emplace(ep_key, RGWPubSubEndpoint::create(
+                event_entry.push_endpoint, event_entry.arn_topic,
+                RGWHTTPArgs(event_entry.push_endpoint_args), cct)).first;
+        }
+      } catch (const RGWPubSubEndpoint::configuration_error& e) {
+        ldout(cct, 1) << "ERROR: failed to create push endpoint: " <<
+            event_entry.push_endpoint << " due to: " << e.what() << dendl;
+        if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_failed);
+        ++pushed;
+        continue;
+      }
+      rc = ep->second->send_to_completion_async(cct, event_entry.event, null_yield);
+      if (rc < 0) {
+        // retried on the next round, the entries after it wait for it
+        ldout(cct, 5) << "push to endpoint " << ep->second->to_str() <<
+            " of notification queue: " << queue_name << " failed, with error: " <<
+            rc << dendl;
+        if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_failed);
+        end_marker = entry.marker;
+        break;
+      }
+      if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_ok);
+      ++pushed;
+    }
+
+    if (pushed > 0) {
+      librados::ObjectWriteOperation op;
+      cls_2pc_queue_remove_entries(op, end_marker);
+      rc = ioctx.operate(queue_name, &op);
+      if (rc < 0) {
+        ldout(cct, 1) << "ERROR: failed to remove entries up to " << end_marker <<
+            " of notification queue: " << queue_name << ", with error: " << rc << dendl;
+        return rc;
+      }
+    }
+    return pushed;
+  }
+
+  void process_queues(unsigned worker_id) {
+    std::hash<std::string> hash;
+    while (true) {
+      int pushed = 0;
+      std::string start_after;
+      bool more = true;
+      while (more) {
+        std::set<std::string> queues;
+        auto rc = ioctx.omap_get_keys2(queues_oid, start_after, 100, &queues, &more);
+        if (rc < 0) {
+          if (rc != -ENOENT) {
+            ldout(cct, 1) << "ERROR: failed to list notification queues, with error: " <<
+                rc << dendl;
+          }
+          break;
+        }
+        for (const auto& queue_name : queues) {
+          if (hash(queue_name) % max_workers != worker_id) {
+            continue;
+          }
+          rc = process_queue(queue_name);
+          if (rc > 0) {
+            pushed += rc;
+          }
+        }
+        if (!queues.empty()) {
+          start_after = *queues.rbegin();
+        }
+      }
+      std::unique_lock l(lock);
+      if (stopping) {
+        return;
+      }
+      if (pushed == 0) {
+        cond.wait_for(l, std::chrono::seconds(1));
+        if (stopping) {
+          return;
+        }
+      }
+    }
+  }
+
+public:
+  Manager(CephContext* cct, librados::IoCtx&& ioctx, unsigned max_workers) :
+    cct(cct), ioctx(std::move(ioctx)),
+    lock_cookie(gen_rand_alphanumeric(cct, 16)),
+    max_workers(std::max(max_workers, 1U)) {
+    for (unsigned i = 0; i < this->max_workers; ++i) {
+      workers.emplace_back(&Manager::process_queues, this, i);
+      const auto name = "notif-" + std::to_string(i);
+      ceph_pthread_setname(workers.back().native_handle(), name.c_str());
+    }
+  }
+
+  ~Manager() {
+    {
+      std::lock_guard l(lock);
+      stopping = true;
+    }
+    cond.notify_all();
+    for (auto& w : workers) {
+      w.join();
+    }
+  }
+};
+
+static Manager* s_manager = nullptr;
+
+int init(CephContext* cct, rgw::sal::RGWRadosStore* store) {
+  if (s_manager) {
+    return -EEXIST;
+  }
+  librados::IoCtx ioctx;
+  const auto rc = open_log_pool(store, ioctx);
+  if (rc < 0) {
+    return rc;
+  }
+  s_manager = new Manager(cct, std::move(ioctx),
+      cct->_conf.get_val<uint64_t>("rgw_notify_persistent_threads"));
+  return 0;
+}
+
+void shutdown() {
+  delete s_manager;
+  s_manager = nullptr;
+}
+
 // populate record from request
 void populate_record_from_request(const req_state *s, 
         const rgw_obj_key& key,
@@ -97,6 +436,15 @@ int publish(const req_state* s,
             "' and bucket: '" << s->bucket.name << 
             "' (unique topic: '" << topic_cfg.name <<
             "') apply to event of type: '" << to_string(event_type) << "'" << dendl;
+        if (topic_cfg.dest.persistent) {
+            // pushed by the workers of the queue
+            rc = enqueue(s, store, topic_cfg, key, record);
+            if (rc < 0) {
+                return rc;
+            }
+            event_handled = true;
+            continue;
+        }
         try {
             // TODO add endpoint LRU cache
             const auto push_endpoint = RGWPubSubEndpoint::create(topic_cfg.dest.push_endpoint, 
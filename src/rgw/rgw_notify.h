@@ -18,6 +18,12 @@ struct rgw_obj_key;
 
 namespace rgw::notify {
 
+// start the workers pushing the events of the persistent topics
+int init(CephContext* cct, rgw::sal::RGWRadosStore* store);
+
+// stop the workers
+void shutdown();
+
 // publish notification
 int publish(const req_state* s, 
         const rgw_obj_key& key,
@@ -22,6 +22,7 @@
 #include "common/utf8.h"
 #include "common/ceph_json.h"
 #include "common/static_ptr.h"
+#include "common/shared_cache.hpp"
 
 #include "rgw_rados.h"
 #include "rgw_zone.h"
@@ -280,13 +281,39 @@ static int get_obj_policy_from_attr(CephContext *cct,
 }
 
 
+/* the parsed bucket policies, keyed by tenant and policy text so that a
+ * policy update of a bucket is a new entry rather than a stale one */
+static const Policy* get_cached_iam_policy(CephContext* cct,
+					   const string& tenant,
+					   const bufferlist& text,
+					   std::shared_ptr<const Policy>* ref)
+{
+  static SharedLRU<string, const Policy> policy_cache(
+    cct, cct->_conf.get_val<uint64_t>("rgw_iam_policy_cache_size"));
+
+  string key = tenant;
+  key.push_back('\0');
+  key.append(text.c_str(), text.length());
+
+  *ref = policy_cache.lookup(key);
+  if (!*ref) {
+    /* a policy that does not parse throws and is not cached */
+    *ref = policy_cache.add(key, new Policy(cct, tenant, text));
+  }
+  return ref->get();
+}
+
 static boost::optional<Policy> get_iam_policy_from_attr(CephContext* cct,
 							rgw::sal::RGWRadosStore* store,
 							map<string, bufferlist>& attrs,
 							const string& tenant) {
   auto i = attrs.find(RGW_ATTR_IAM_POLICY);
   if (i != attrs.end()) {
-    return Policy(cct, tenant, i->second);
+    if (cct->_conf.get_val<uint64_t>("rgw_iam_policy_cache_size") == 0) {
+      return Policy(cct, tenant, i->second);
+    }
+    std::shared_ptr<const Policy> ref;
+    return *get_cached_iam_policy(cct, tenant, i->second, &ref);
   } else {
     return none;
   }
@@ -6067,7 +6094,9 @@ void RGWCompleteMultipart::execute()
 
   int total_parts = 0;
   int handled_parts = 0;
-  int max_parts = 1000;
+  /* the parts of the request are read in one go, the omap reads of the
+   * default 1000 entries made a round trip per 1000 parts */
+  int max_parts = std::max<int>(1000, parts->parts.size());
   int marker = 0;
   bool truncated;
   RGWCompressionInfo cs_info;
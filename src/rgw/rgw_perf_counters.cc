@@ -35,6 +35,13 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
   plb.add_u64_counter(l_rgw_gc_retire, "gc_retire_object", "GC object retires");
+  plb.add_u64_counter(l_rgw_gc_remove_tail, "gc_remove_tail_object", "GC tail objects removed");
+  plb.add_u64(l_rgw_gc_ios, "gc_ios", "GC IOs in flight");
+
+  plb.add_u64_counter(l_rgw_d3n_cache_hit, "d3n_cache_hit", "Local data cache hits");
+  plb.add_u64_counter(l_rgw_d3n_cache_miss, "d3n_cache_miss", "Local data cache misses");
+  plb.add_u64_counter(l_rgw_d3n_cache_fill, "d3n_cache_fill", "Objects written to the local data cache");
+  plb.add_u64_counter(l_rgw_d3n_cache_evict, "d3n_cache_evict", "Objects evicted from the local data cache");
 
   plb.add_u64_counter(l_rgw_pubsub_event_triggered, "pubsub_event_triggered", "Pubsub events with at least one topic");
   plb.add_u64_counter(l_rgw_pubsub_event_lost, "pubsub_event_lost", "Pubsub events lost");
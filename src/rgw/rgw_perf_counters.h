@@ -32,6 +32,13 @@ enum {
   l_rgw_keystone_token_cache_miss,
 
   l_rgw_gc_retire,
+  l_rgw_gc_remove_tail,
+  l_rgw_gc_ios,
+
+  l_rgw_d3n_cache_hit,
+  l_rgw_d3n_cache_miss,
+  l_rgw_d3n_cache_fill,
+  l_rgw_d3n_cache_evict,
 
   l_rgw_pubsub_event_triggered,
   l_rgw_pubsub_event_lost,
@@ -71,6 +71,7 @@ using namespace librados;
 #include "rgw_data_sync.h"
 #include "rgw_realm_watcher.h"
 #include "rgw_reshard.h"
+#include "rgw_d3n_datacache.h"
 
 #include "services/svc_zone.h"
 #include "services/svc_zone_utils.h"
@@ -1052,6 +1053,9 @@ void RGWRados::finalize()
   delete obj_expirer;
   obj_expirer = NULL;
 
+  delete d3n_data_cache;
+  d3n_data_cache = nullptr;
+
   RGWQuotaHandler::free_handler(quota_handler);
   if (cr_registry) {
     cr_registry->put();
@@ -1179,6 +1183,19 @@ int RGWRados::init_complete()
     obj_expirer->start_processor();
   }
 
+  /* the gateways only, the tools would clear the cache of the gateway
+   * on the same host */
+  if (use_gc_thread &&
+      cct->_conf.get_val<bool>("rgw_d3n_l1_local_datacache_enabled")) {
+    d3n_data_cache = new D3nDataCache(cct);
+    ret = d3n_data_cache->init();
+    if (ret < 0) {
+      lderr(cct) << "ERROR: failed to initialize the local data cache: "
+                 << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+  }
+
   auto& current_period = svc.zone->get_current_period();
   auto& zonegroup = svc.zone->get_zonegroup();
   auto& zone_params = svc.zone->get_zone_params();
@@ -6203,11 +6220,85 @@ struct get_obj_data {
   rgw::AioResultList completed; // completed read results, sorted by offset
   optional_yield yield;
 
+  // the bytes read ahead of the client follow the bandwidth-delay product of
+  // the client and the reads from rados, between min_window and max_window
+  // (the window of the aio throttle)
+  uint64_t window;
+  const uint64_t min_window;
+  const uint64_t max_window;
+  const uint64_t start_offset;
+  const ceph::mono_time start_time = ceph::mono_clock::now();
+  uint64_t pending_size = 0; // bytes of the reads in flight
+  std::map<uint64_t, std::pair<uint64_t, ceph::mono_time>> pending_reads; // by id
+  ceph::timespan read_latency = ceph::timespan::zero(); // moving average
+  std::map<uint64_t, std::string> cache_fills; // local data cache keys by id
+
   get_obj_data(RGWRados* store, RGWGetDataCB* cb, rgw::Aio* aio,
-               uint64_t offset, optional_yield yield)
-    : store(store), client_cb(cb), aio(aio), offset(offset), yield(yield) {}
+               uint64_t offset, optional_yield yield, uint64_t window,
+               uint64_t min_window, uint64_t max_window)
+    : store(store), client_cb(cb), aio(aio), offset(offset), yield(yield),
+      window(window), min_window(min_window), max_window(max_window),
+      start_offset(offset) {}
+
+  // wait for the reads in flight until len more bytes fit in the window
+  int throttle(uint64_t len) {
+    while (pending_size > 0 && pending_size + len > window) {
+      int r = flush(aio->wait());
+      if (r < 0) {
+        return r;
+      }
+    }
+    return 0;
+  }
+
+  void add_pending(uint64_t id, uint64_t cost) {
+    pending_reads[id] = {cost, ceph::mono_clock::now()};
+    pending_size += cost;
+  }
+
+  void update_window() {
+    // the pipeline only reflects the client and rados once the initial
+    // window went through
+    const uint64_t delivered = offset - start_offset;
+    if (max_window == min_window || delivered < window ||
+        read_latency == ceph::timespan::zero()) {
+      return;
+    }
+    const double elapsed = std::chrono::duration<double>(
+        ceph::mono_clock::now() - start_time).count();
+    if (elapsed <= 0) {
+      return;
+    }
+    // keep twice the bytes in flight that the client takes during a read,
+    // so that the reads from rados are not the bottleneck
+    const double rate = delivered / elapsed;
+    const double latency = std::chrono::duration<double>(read_latency).count();
+    const uint64_t bdp = 2 * rate * latency;
+    window = std::clamp(bdp, min_window, max_window);
+  }
 
   int flush(rgw::AioResultList&& results) {
+    const auto now = ceph::mono_clock::now();
+    for (auto& e : results) {
+      auto p = pending_reads.find(e.id);
+      if (p == pending_reads.end()) {
+        continue;
+      }
+      const ceph::timespan latency = now - p->second.second;
+      read_latency = read_latency == ceph::timespan::zero() ? latency :
+          (read_latency * 7 + latency) / 8;
+      pending_size -= p->second.first;
+      pending_reads.erase(p);
+
+      auto f = cache_fills.find(e.id);
+      if (f != cache_fills.end()) {
+        if (e.result >= 0) {
+          store->d3n_data_cache->put(f->second, e.data);
+        }
+        cache_fills.erase(f);
+      }
+    }
+
     int r = rgw::check_for_errors(results);
     if (r < 0) {
       return r;
@@ -6227,6 +6318,7 @@ struct get_obj_data {
         return r;
       }
     }
+    update_window();
     return 0;
   }
 
@@ -6290,6 +6382,23 @@ int RGWRados::get_obj_iterate_cb(const rgw_raw_obj& read_obj, off_t obj_ofs,
     }
   }
 
+  /* the tail objects are never modified, so their data can be cached */
+  if (!is_head_obj && d3n_data_cache) {
+    string key = D3nDataCache::get_key(read_obj.pool.to_str(), read_obj.oid);
+    bufferlist bl;
+    if (d3n_data_cache->get(key, read_ofs, len, &bl)) {
+      auto e = std::make_unique<rgw::AioResultEntry>();
+      e->id = obj_ofs;
+      e->data = std::move(bl);
+      rgw::AioResultList results;
+      results.push_back(*e.release());
+      return d->flush(std::move(results));
+    }
+    if (read_ofs == 0) {
+      d->cache_fills[obj_ofs] = std::move(key);
+    }
+  }
+
   auto obj = d->store->svc.rados->obj(read_obj);
   int r = obj.open();
   if (r < 0) {
@@ -6303,6 +6412,11 @@ int RGWRados::get_obj_iterate_cb(const rgw_raw_obj& read_obj, off_t obj_ofs,
   const uint64_t cost = len;
   const uint64_t id = obj_ofs; // use logical object offset for sorting replies
 
+  r = d->throttle(cost);
+  if (r < 0) {
+    return r;
+  }
+  d->add_pending(id, cost);
   auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
 
   return d->flush(std::move(completed));
@@ -6316,9 +6430,14 @@ int RGWRados::Object::Read::iterate(int64_t ofs, int64_t end, RGWGetDataCB *cb,
   RGWObjectCtx& obj_ctx = source->get_ctx();
   const uint64_t chunk_size = cct->_conf->rgw_get_obj_max_req_size;
   const uint64_t window_size = cct->_conf->rgw_get_obj_window_size;
+  const uint64_t max_window_size = std::max<uint64_t>(window_size,
+      cct->_conf.get_val<Option::size_t>("rgw_get_obj_max_window_size"));
+  const uint64_t min_window_size = std::min(window_size, chunk_size);
 
-  auto aio = rgw::make_throttle(window_size, y);
-  get_obj_data data(store, cb, &*aio, ofs, y);
+  auto aio = rgw::make_throttle(max_window_size, y);
+  get_obj_data data(store, cb, &*aio, ofs, y, window_size,
+                    max_window_size > window_size ? min_window_size : window_size,
+                    max_window_size);
 
   int r = store->iterate_obj(obj_ctx, source->get_bucket_info(), state.obj,
                              ofs, end, chunk_size, _get_obj_iterate_cb, &data, y);
@@ -6611,7 +6730,9 @@ int RGWRados::block_while_resharding(RGWRados::BucketShard *bs,
       return ret;
     }
 
-    if (!entry.resharding_in_progress()) {
+    // an osd which does not know about IN_LOGRECORD blocks the writes
+    // through all the resharding
+    if (!entry.resharding_in_progress() && !entry.resharding_in_logrecord()) {
       return fetch_new_bucket_id("get_bucket_resharding_succeeded",
 				 new_bucket_id);
     }
@@ -8262,18 +8383,39 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     const std::string& oid_name;
     RGWRados::ent_map_t::iterator cursor;
     RGWRados::ent_map_t::iterator end;
+    // the key to continue the shard's listing after, and the raw index
+    // key of the last entry in the current batch; they are saved when
+    // a batch is loaded as the entries are moved out of it
+    cls_rgw_obj_key last_key;
+    std::string last_raw_key;
+    // the number of entries to request in the next batch
+    uint32_t batch_size;
 
     // manages an iterator through a shard and provides other
     // accessors
     ShardTracker(size_t _shard_idx,
 		 rgw_cls_list_ret& _result,
-		 const std::string& _oid_name):
+		 const std::string& _oid_name,
+		 uint32_t _batch_size):
       shard_idx(_shard_idx),
       result(_result),
       oid_name(_oid_name),
-      cursor(_result.dir.m.begin()),
-      end(_result.dir.m.end())
-    {}
+      batch_size(_batch_size)
+    {
+      reset();
+    }
+
+    // start over with the entries in result, once a new batch is
+    // loaded into it
+    void reset() {
+      cursor = result.dir.m.begin();
+      end = result.dir.m.end();
+      if (!result.dir.m.empty()) {
+	auto last = result.dir.m.rbegin();
+	last_key = last->second.key;
+	last_raw_key = last->first;
+      }
+    }
 
     inline const std::string& entry_name() const {
       return cursor->first;
@@ -8311,7 +8453,8 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   std::vector<ShardTracker> results_trackers;
   results_trackers.reserve(shard_list_results.size());
   for (auto& r : shard_list_results) {
-    results_trackers.emplace_back(r.first, r.second, shard_oids[r.first]);
+    results_trackers.emplace_back(r.first, r.second, shard_oids[r.first],
+				  num_entries_per_shard);
 
     // if any *one* shard's result is trucated, the entire result is
     // truncated
@@ -8336,10 +8479,58 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     ++tracker_idx;
   }
 
-  rgw_bucket_dir_entry*
-    last_entry_visited = nullptr; // to set last_entry (marker)
-  map<string, bufferlist> updates;
   uint32_t count = 0;
+
+  // read the next batch of a shard whose entries were all consumed;
+  // the batches grow as the shard keeps being drained, and the shard
+  // is told not to return any entry past the last one buffered from
+  // the other shards, as they have to be consumed first anyway
+  auto refill = [&](ShardTracker& t) -> int {
+    const uint32_t remaining = num_entries - count;
+    t.batch_size = std::min(num_entries, t.batch_size * 2);
+
+    const std::string* end_key = nullptr;
+    for (const auto& other : results_trackers) {
+      if (&other != &t && other.is_truncated() && !other.at_end() &&
+	  (!end_key || other.last_raw_key < *end_key)) {
+	end_key = &other.last_raw_key;
+      }
+    }
+
+    for (;;) {
+      rgw_cls_list_ret result;
+      librados::ObjectReadOperation op;
+      cls_rgw_bucket_list_op(op, t.last_key, prefix, delimiter,
+			     std::min(remaining, t.batch_size),
+			     list_versions, &result,
+			     end_key ? *end_key : std::string());
+      int ret = rgw_rados_operate(ioctx, t.oid_name, &op, nullptr, y);
+      if (ret < 0) {
+	return ret;
+      }
+
+      ldout(cct, 20) << "RGWRados::cls_bucket_list_ordered: read " <<
+	result.dir.m.size() << " more entries from shard " << t.shard_idx <<
+	" after " << t.last_key << dendl;
+
+      if (result.dir.m.empty() && result.is_truncated && end_key) {
+	// the shard's next entry lies past the others', so it is
+	// needed after all
+	end_key = nullptr;
+	continue;
+      }
+
+      *cls_filtered = *cls_filtered && result.cls_filtered;
+      t.result = std::move(result);
+      t.reset();
+      return 0;
+    }
+  };
+
+  // to set last_entry (marker)
+  rgw_obj_index_key last_entry_visited;
+  bool visited = false;
+  map<string, bufferlist> updates;
   while (count < num_entries && !candidates.empty()) {
     r = 0;
     // select the next entry in lexical order (first key in map);
@@ -8379,14 +8570,15 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     if (r >= 0) {
       ldout(cct, 10) << "RGWRados::" << __func__ << ": got " <<
 	dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
+      last_entry_visited = dirent.key;
       m[name] = std::move(dirent);
-      last_entry_visited = &(m[name]);
       ++count;
     } else {
       ldout(cct, 10) << "RGWRados::" << __func__ << ": skipping " <<
 	dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
-      last_entry_visited = &tracker.dir_entry();
+      last_entry_visited = dirent.key;
     }
+    visited = true;
 
     // refresh the candidates map
     candidates.erase(candidates.begin());
@@ -8394,12 +8586,21 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 
     next_candidate(tracker, candidates, tracker_idx);
 
-    if (tracker.at_end() && tracker.is_truncated()) {
-      // once we exhaust one shard that is truncated, we need to stop,
-      // as we cannot be certain that one of the next entries needs to
-      // come from that shard; S3 and swift protocols allow returning
-      // fewer than what was requested
-      break;
+    if (tracker.at_end() && tracker.is_truncated() && count < num_entries) {
+      // we cannot be certain that one of the next entries does not
+      // need to come from the exhausted shard, so read more of it
+      r = refill(tracker);
+      if (r < 0) {
+	return r;
+      }
+      next_candidate(tracker, candidates, tracker_idx);
+
+      if (tracker.at_end() && tracker.is_truncated()) {
+	// the shard returned nothing though it has more entries;
+	// S3 and swift protocols allow returning fewer than what was
+	// requested
+	break;
+      }
     }
   } // while we haven't provided requested # of result entries
 
@@ -8436,8 +8637,8 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
       count << ", which is truncated" << dendl;
   }
 
-  if (last_entry_visited != nullptr && last_entry) {
-    *last_entry = last_entry_visited->key;
+  if (visited && last_entry) {
+    *last_entry = last_entry_visited;
     ldout(cct, 20) << "RGWRados::" << __func__ <<
       ": returning, last_entry=" << *last_entry << dendl;
   } else {
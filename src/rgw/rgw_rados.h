@@ -46,6 +46,7 @@ struct RGWZoneGroup;
 struct RGWZoneParams;
 class RGWReshard;
 class RGWReshardWait;
+class D3nDataCache;
 
 class RGWSysObjectCtx;
 
@@ -581,6 +582,7 @@ public:
 
   RGWReshard *reshard;
   std::shared_ptr<RGWReshardWait> reshard_wait;
+  D3nDataCache *d3n_data_cache{nullptr};
 
   virtual ~RGWRados() = default;
 
@@ -27,6 +27,10 @@ const string reshard_oid_prefix = "reshard.";
 const string reshard_lock_name = "reshard_process";
 const string bucket_instance_lock_name = "bucket_instance_lock";
 
+// the passes over the entries changed by the writes during the copy
+// before the writes are blocked anyway for the last one
+constexpr int max_reshard_log_passes = 10;
+
 /* All primes up to 2000 used to attempt to make dynamic sharding use
  * a prime numbers of shards. Note: this list also includes 1 for when
  * 1 shard is the most appropriate, even though 1 is not prime.
@@ -122,15 +126,31 @@ public:
     return num_shard;
   }
 
+  static void add_stats(map<RGWObjCategory, rgw_bucket_category_stats>& stats,
+                        RGWObjCategory category,
+                        const rgw_bucket_category_stats& entry_stats) {
+    rgw_bucket_category_stats& target = stats[category];
+    target.num_entries += entry_stats.num_entries;
+    target.total_size += entry_stats.total_size;
+    target.total_size_rounded += entry_stats.total_size_rounded;
+    target.actual_size += entry_stats.actual_size;
+  }
+
+  static void add_stats(map<RGWObjCategory, rgw_bucket_category_stats>& stats,
+                        rgw_cls_bi_entry& entry) {
+    cls_rgw_obj_key cls_key;
+    RGWObjCategory category;
+    rgw_bucket_category_stats entry_stats;
+    if (entry.get_info(&cls_key, &category, &entry_stats)) {
+      add_stats(stats, category, entry_stats);
+    }
+  }
+
   int add_entry(rgw_cls_bi_entry& entry, bool account, RGWObjCategory category,
                 const rgw_bucket_category_stats& entry_stats) {
     entries.push_back(entry);
     if (account) {
-      rgw_bucket_category_stats& target = stats[category];
-      target.num_entries += entry_stats.num_entries;
-      target.total_size += entry_stats.total_size;
-      target.total_size_rounded += entry_stats.total_size_rounded;
-      target.actual_size += entry_stats.actual_size;
+      add_stats(stats, category, entry_stats);
     }
     if (entries.size() >= reshard_shard_batch_size) {
       int ret = flush();
@@ -178,6 +198,60 @@ public:
     }
     return ret;
   }
+
+  // replace the entries of the object name copied earlier with the
+  // current ones of the source shard, and their stats along; the
+  // entries added before must have been flushed
+  int recopy(const string& name, list<rgw_cls_bi_entry>& new_entries) {
+    list<rgw_cls_bi_entry> old_entries;
+    string marker;
+    bool is_truncated = true;
+    while (is_truncated) {
+      list<rgw_cls_bi_entry> batch;
+      int ret = store->getRados()->bi_list(bs, name, marker,
+                                           reshard_shard_batch_size,
+                                           &batch, &is_truncated);
+      if (ret < 0 && ret != -ENOENT) {
+        derr << "ERROR: bi_list(): " << cpp_strerror(-ret) << dendl;
+        return ret;
+      }
+      if (batch.empty()) {
+        break;
+      }
+      marker = batch.back().idx;
+      old_entries.splice(old_entries.end(), batch);
+    }
+
+    librados::ObjectWriteOperation op;
+    map<RGWObjCategory, rgw_bucket_category_stats> new_stats;
+    map<RGWObjCategory, rgw_bucket_category_stats> old_stats;
+    set<string> new_keys;
+    for (auto& entry : new_entries) {
+      store->getRados()->bi_put(op, bs, entry);
+      add_stats(new_stats, entry);
+      new_keys.insert(entry.idx);
+    }
+    set<string> removed_keys;
+    for (auto& entry : old_entries) {
+      add_stats(old_stats, entry);
+      if (new_keys.find(entry.idx) == new_keys.end()) {
+        removed_keys.insert(entry.idx);
+      }
+    }
+    if (!removed_keys.empty()) {
+      op.omap_rm_keys(removed_keys);
+    }
+    cls_rgw_bucket_update_stats(op, false, new_stats, &old_stats);
+
+    int ret = bs.bucket_obj.operate(&op, null_yield);
+    if (ret < 0) {
+      derr << "ERROR: failed to update entries of " << name <<
+        " in target bucket shard (bs=" << bs.bucket << "/" << bs.shard_id <<
+        ") error=" << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+    return 0;
+  }
 }; // class BucketReshardShard
 
 
@@ -226,6 +300,31 @@ public:
     return 0;
   }
 
+  int recopy(int shard_index, const string& name,
+             list<rgw_cls_bi_entry>& entries) {
+    return target_shards[shard_index]->recopy(name, entries);
+  }
+
+  // write out all the entries added so far
+  int flush() {
+    int ret = 0;
+    for (auto& shard : target_shards) {
+      int r = shard->flush();
+      if (r < 0) {
+        derr << "ERROR: target_shards[" << shard->get_num_shard() << "].flush() returned error: " << cpp_strerror(-r) << dendl;
+        ret = r;
+      }
+    }
+    for (auto& shard : target_shards) {
+      int r = shard->wait_all_aio();
+      if (r < 0) {
+        derr << "ERROR: target_shards[" << shard->get_num_shard() << "].wait_all_aio() returned error: " << cpp_strerror(-r) << dendl;
+        ret = r;
+      }
+    }
+    return ret;
+  }
+
   int finish() {
     int ret = 0;
     for (auto& shard : target_shards) {
@@ -520,6 +619,171 @@ int RGWBucketReshardLock::renew(const Clock::time_point& now) {
 }
 
 
+static int get_target_shard(rgw::sal::RGWRadosStore *store,
+			    const RGWBucketInfo& new_bucket_info,
+			    const cls_rgw_obj_key& cls_key,
+			    int *shard_index)
+{
+  rgw_obj_key key(cls_key);
+  rgw_obj obj(new_bucket_info.bucket, key);
+  RGWMPObj mp;
+  if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
+    // place the multipart .meta object on the same shard as its head object
+    obj.index_hash_source = mp.get_key();
+  }
+  int target_shard_id;
+  int ret = store->getRados()->get_target_shard_id(new_bucket_info.layout.current_index.layout.normal, obj.get_hash_object(), &target_shard_id);
+  if (ret < 0) {
+    lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
+    return ret;
+  }
+
+  *shard_index = (target_shard_id > 0 ? target_shard_id : 0);
+  return 0;
+}
+
+int RGWBucketReshard::renew_lock_if_needed()
+{
+  Clock::time_point now = Clock::now();
+  if (reshard_lock.should_renew(now)) {
+    // assume outer locks have timespans at least the size of ours, so
+    // can call inside conditional
+    if (outer_reshard_lock) {
+      int ret = outer_reshard_lock->renew(now);
+      if (ret < 0) {
+	return ret;
+      }
+    }
+    int ret = reshard_lock.renew(now);
+    if (ret < 0) {
+      lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int RGWBucketReshard::copy_changed_entries(const RGWBucketInfo& new_bucket_info,
+					   BucketReshardManager& target_shards_mgr,
+					   int max_entries,
+					   uint64_t *num_changed)
+{
+  *num_changed = 0;
+
+  const int num_source_shards =
+    (bucket_info.layout.current_index.layout.normal.num_shards > 0 ? bucket_info.layout.current_index.layout.normal.num_shards : 1);
+  for (int i = 0; i < num_source_shards; ++i) {
+    RGWRados::BucketShard bs(store->getRados());
+    int ret = bs.init(bucket_info.bucket, i, bucket_info.layout.current_index,
+		      nullptr /* no RGWBucketInfo */);
+    if (ret < 0) {
+      return ret;
+    }
+
+    string marker;
+    bool is_truncated = true;
+    while (is_truncated) {
+      cls_rgw_reshard_log_list_ret log;
+      librados::ObjectReadOperation op;
+      cls_rgw_reshard_log_list(op, marker, max_entries, &log);
+      ret = bs.bucket_obj.operate(&op, nullptr, null_yield);
+      if (ret < 0) {
+	derr << "ERROR: failed to list the entries changed on shard " << i <<
+	  ": " << cpp_strerror(-ret) << dendl;
+	return ret;
+      }
+      if (log.entries.empty()) {
+	break;
+      }
+      is_truncated = log.is_truncated;
+      marker = log.entries.back();
+
+      // forget the names before their entries are read, so the writes
+      // coming after log them again
+      librados::ObjectWriteOperation trim_op;
+      cls_rgw_reshard_log_trim(trim_op, log.entries);
+      ret = bs.bucket_obj.operate(&trim_op, null_yield);
+      if (ret < 0) {
+	derr << "ERROR: failed to trim the entries changed on shard " << i <<
+	  ": " << cpp_strerror(-ret) << dendl;
+	return ret;
+      }
+
+      for (auto& name : log.entries) {
+	list<rgw_cls_bi_entry> entries;
+	string entry_marker;
+	bool more = true;
+	while (more) {
+	  list<rgw_cls_bi_entry> batch;
+	  ret = store->getRados()->bi_list(bs, name, entry_marker, max_entries,
+					   &batch, &more);
+	  if (ret < 0 && ret != -ENOENT) {
+	    derr << "ERROR: bi_list(): " << cpp_strerror(-ret) << dendl;
+	    return ret;
+	  }
+	  if (batch.empty()) {
+	    break;
+	  }
+	  entry_marker = batch.back().idx;
+	  entries.splice(entries.end(), batch);
+	}
+
+	int shard_index;
+	ret = get_target_shard(store, new_bucket_info, cls_rgw_obj_key(name),
+			       &shard_index);
+	if (ret < 0) {
+	  return ret;
+	}
+	ret = target_shards_mgr.recopy(shard_index, name, entries);
+	if (ret < 0) {
+	  return ret;
+	}
+	++(*num_changed);
+
+	ret = renew_lock_if_needed();
+	if (ret < 0) {
+	  return ret;
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
+void RGWBucketReshard::purge_reshard_log()
+{
+  const int num_source_shards =
+    (bucket_info.layout.current_index.layout.normal.num_shards > 0 ? bucket_info.layout.current_index.layout.normal.num_shards : 1);
+  for (int i = 0; i < num_source_shards; ++i) {
+    RGWRados::BucketShard bs(store->getRados());
+    int ret = bs.init(bucket_info.bucket, i, bucket_info.layout.current_index,
+		      nullptr /* no RGWBucketInfo */);
+    if (ret < 0) {
+      continue;
+    }
+
+    for (;;) {
+      cls_rgw_reshard_log_list_ret log;
+      librados::ObjectReadOperation op;
+      cls_rgw_reshard_log_list(op, string(), 1000, &log);
+      ret = bs.bucket_obj.operate(&op, nullptr, null_yield);
+      if (ret < 0 || log.entries.empty()) {
+	break;
+      }
+      librados::ObjectWriteOperation trim_op;
+      cls_rgw_reshard_log_trim(trim_op, log.entries);
+      ret = bs.bucket_obj.operate(&trim_op, null_yield);
+      if (ret < 0) {
+	ldout(store->ctx(), 0) << "WARNING: " << __func__ <<
+	  " failed to trim the entries changed on shard " << i << ": " <<
+	  cpp_strerror(-ret) << dendl;
+	break;
+      }
+    }
+  }
+}
+
 int RGWBucketReshard::do_reshard(int num_shards,
 				 RGWBucketInfo& new_bucket_info,
 				 int max_entries,
@@ -602,47 +866,26 @@ int RGWBucketReshard::do_reshard(int num_shards,
 
 	marker = entry.idx;
 
-	int target_shard_id;
 	cls_rgw_obj_key cls_key;
 	RGWObjCategory category;
 	rgw_bucket_category_stats stats;
 	bool account = entry.get_info(&cls_key, &category, &stats);
-	rgw_obj_key key(cls_key);
-	rgw_obj obj(new_bucket_info.bucket, key);
-	RGWMPObj mp;
-	if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
-	  // place the multipart .meta object on the same shard as its head object
-	  obj.index_hash_source = mp.get_key();
-	}
-	int ret = store->getRados()->get_target_shard_id(new_bucket_info.layout.current_index.layout.normal, obj.get_hash_object(), &target_shard_id);
+	int shard_index;
+	int ret = get_target_shard(store, new_bucket_info, cls_key,
+				   &shard_index);
 	if (ret < 0) {
-	  lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
 	  return ret;
 	}
 
-	int shard_index = (target_shard_id > 0 ? target_shard_id : 0);
-
 	ret = target_shards_mgr.add_entry(shard_index, entry, account,
 					  category, stats);
 	if (ret < 0) {
 	  return ret;
 	}
 
-	Clock::time_point now = Clock::now();
-	if (reshard_lock.should_renew(now)) {
-	  // assume outer locks have timespans at least the size of ours, so
-	  // can call inside conditional
-	  if (outer_reshard_lock) {
-	    ret = outer_reshard_lock->renew(now);
-	    if (ret < 0) {
-	      return ret;
-	    }
-	  }
-	  ret = reshard_lock.renew(now);
-	  if (ret < 0) {
-	    lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
-	    return ret;
-	  }
+	ret = renew_lock_if_needed();
+	if (ret < 0) {
+	  return ret;
 	}
 	if (verbose_json_out) {
 	  formatter->close_section();
@@ -661,6 +904,42 @@ int RGWBucketReshard::do_reshard(int num_shards,
     (*out) << " " << total_entries << std::endl;
   }
 
+  ret = target_shards_mgr.flush();
+  if (ret < 0) {
+    lderr(store->ctx()) << "ERROR: failed to reshard" << dendl;
+    return -EIO;
+  }
+
+  // the writes went on during the copy; copy again the entries they
+  // changed until few are left, then block the writes for the last ones
+  uint64_t num_changed = 0;
+  int pass = 0;
+  do {
+    ret = copy_changed_entries(new_bucket_info, target_shards_mgr,
+			       max_entries, &num_changed);
+    if (ret < 0) {
+      return ret;
+    }
+    ldout(store->ctx(), 10) << __func__ << ": copied " << num_changed <<
+      " changed entries again in pass " << pass << dendl;
+  } while (num_changed > static_cast<uint64_t>(max_entries) &&
+	   ++pass < max_reshard_log_passes);
+
+  ret = set_resharding_status(new_bucket_info.bucket.bucket_id, num_shards,
+			      cls_rgw_reshard_status::IN_PROGRESS);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = copy_changed_entries(new_bucket_info, target_shards_mgr,
+			     max_entries, &num_changed);
+  if (ret < 0) {
+    return ret;
+  }
+  if (out && !verbose_json_out) {
+    (*out) << "entries changed while resharding: " << num_changed << std::endl;
+  }
+
   ret = target_shards_mgr.finish();
   if (ret < 0) {
     lderr(store->ctx()) << "ERROR: failed to reshard" << dendl;
@@ -713,9 +992,10 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
   }
 
   // set resharding status of current bucket_info & shards with
-  // information about planned resharding
+  // information about planned resharding; the shards take writes and
+  // log the entries they change until the copy is nearly done
   ret = set_resharding_status(new_bucket_info.bucket.bucket_id,
-			      num_shards, cls_rgw_reshard_status::IN_PROGRESS);
+			      num_shards, cls_rgw_reshard_status::IN_LOGRECORD);
   if (ret < 0) {
     goto error_out;
   }
@@ -762,6 +1042,9 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
 
 error_out:
 
+  // the old shards may be left logging the entries changed
+  purge_reshard_log();
+
   reshard_lock.unlock();
 
   // since the real problem is the issue that led to this error code
@@ -24,6 +24,7 @@
 
 
 class RGWReshard;
+class BucketReshardManager;
 namespace rgw { namespace sal {
   class RGWRadosStore;
 } }
@@ -86,6 +87,14 @@ private:
 
   int create_new_bucket_instance(int new_num_shards,
 				 RGWBucketInfo& new_bucket_info);
+  int renew_lock_if_needed();
+  // copy again the entries changed since the old shards started logging
+  // them, or since the previous call
+  int copy_changed_entries(const RGWBucketInfo& new_bucket_info,
+			   BucketReshardManager& target_shards_mgr,
+			   int max_entries,
+			   uint64_t *num_changed);
+  void purge_reshard_log();
   int do_reshard(int num_shards,
 		 RGWBucketInfo& new_bucket_info,
 		 int max_entries,
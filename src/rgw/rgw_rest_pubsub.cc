@@ -39,8 +39,11 @@ public:
     if (!validate_and_update_endpoint_secret(dest, s->cct, *(s->info.env))) {
       return -EINVAL;
     }
+    s->info.args.get_bool("persistent", &dest.persistent, false);
+
     for (const auto param : s->info.args.get_params()) {
-      if (param.first == "Action" || param.first == "Name" || param.first == "PayloadHash") {
+      if (param.first == "Action" || param.first == "Name" || param.first == "PayloadHash" ||
+          param.first == "persistent") {
         continue;
       }
       dest.push_endpoint_args.append(param.first+"="+param.second+"&");
@@ -419,6 +419,223 @@ int RGWGetObj_ObjStore_S3::get_decrypt_filter(std::unique_ptr<RGWGetObj_Filter>
   return res;
 }
 
+namespace {
+
+struct S3SelectCSV {
+  string file_header_info;
+  string comments;
+  string quote_escape_character;
+  string record_delimiter;
+  string field_delimiter;
+  string quote_character;
+  string quote_fields;
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("FileHeaderInfo", file_header_info, obj);
+    RGWXMLDecoder::decode_xml("Comments", comments, obj);
+    RGWXMLDecoder::decode_xml("QuoteEscapeCharacter", quote_escape_character, obj);
+    RGWXMLDecoder::decode_xml("RecordDelimiter", record_delimiter, obj);
+    RGWXMLDecoder::decode_xml("FieldDelimiter", field_delimiter, obj);
+    RGWXMLDecoder::decode_xml("QuoteCharacter", quote_character, obj);
+    RGWXMLDecoder::decode_xml("QuoteFields", quote_fields, obj);
+  }
+};
+
+struct S3SelectSerialization {
+  string compression_type;
+  std::optional<S3SelectCSV> csv;
+  bool other_format = false; // JSON or Parquet
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("CompressionType", compression_type, obj);
+    RGWXMLDecoder::decode_xml("CSV", csv, obj);
+    other_format = obj->find_first("JSON") || obj->find_first("Parquet");
+  }
+};
+
+struct S3SelectRequest {
+  string expression;
+  string expression_type;
+  S3SelectSerialization input;
+  S3SelectSerialization output;
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("Expression", expression, obj, true);
+    RGWXMLDecoder::decode_xml("ExpressionType", expression_type, obj, true);
+    RGWXMLDecoder::decode_xml("InputSerialization", input, obj, true);
+    RGWXMLDecoder::decode_xml("OutputSerialization", output, obj, true);
+  }
+};
+
+// the delimiters and quotes are single characters, the default if not set
+bool get_select_char(const string& val, char *c)
+{
+  if (val.size() > 1) {
+    return false;
+  }
+  if (!val.empty()) {
+    *c = val[0];
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+int RGWSelectObj_ObjStore_S3::get_params()
+{
+  int r = RGWGetObj_ObjStore_S3::get_params();
+  if (r < 0) {
+    return r;
+  }
+  // the query runs on the whole object
+  range_str = nullptr;
+
+  RGWXMLParser parser;
+  if (!parser.init()) {
+    return -EINVAL;
+  }
+
+  bufferlist data;
+  std::tie(r, data) = rgw_rest_read_all_input(s,
+                          s->cct->_conf->rgw_max_put_param_size, false);
+  if (r < 0) {
+    return r;
+  }
+
+  if (!parser.parse(data.c_str(), data.length(), 1)) {
+    return -ERR_MALFORMED_XML;
+  }
+
+  S3SelectRequest req;
+  try {
+    RGWXMLDecoder::decode_xml("SelectObjectContentRequest", req, &parser, true);
+  } catch (RGWXMLDecoder::err& err) {
+    ldpp_dout(this, 5) << "Malformed select request: " << err << dendl;
+    return -ERR_MALFORMED_XML;
+  }
+
+  if (req.expression_type != "SQL") {
+    s->err.message = "Only the SQL expression type is supported";
+    return -EINVAL;
+  }
+  if (!req.input.compression_type.empty() &&
+      req.input.compression_type != "NONE") {
+    s->err.message = "Compressed input is not supported";
+    return -ERR_NOT_IMPLEMENTED;
+  }
+  if (req.input.other_format || req.output.other_format ||
+      !req.input.csv || !req.output.csv) {
+    s->err.message = "Only the CSV serialization is supported";
+    return -ERR_NOT_IMPLEMENTED;
+  }
+
+  const S3SelectCSV& in = *req.input.csv;
+  if (!get_select_char(in.field_delimiter, &csv_input.field_delimiter) ||
+      !get_select_char(in.record_delimiter, &csv_input.record_delimiter) ||
+      !get_select_char(in.quote_character, &csv_input.quote) ||
+      !get_select_char(in.quote_escape_character, &csv_input.quote_escape) ||
+      !get_select_char(in.comments, &csv_input.comments)) {
+    s->err.message = "The delimiters, quotes and comments are single characters";
+    return -EINVAL;
+  }
+  if (in.file_header_info.empty() || in.file_header_info == "NONE") {
+    csv_input.header = rgw::s3select::CSVInput::Header::NONE;
+  } else if (in.file_header_info == "USE") {
+    csv_input.header = rgw::s3select::CSVInput::Header::USE;
+  } else if (in.file_header_info == "IGNORE") {
+    csv_input.header = rgw::s3select::CSVInput::Header::IGNORE;
+  } else {
+    s->err.message = "Invalid FileHeaderInfo " + in.file_header_info;
+    return -EINVAL;
+  }
+
+  const S3SelectCSV& out = *req.output.csv;
+  if (!get_select_char(out.field_delimiter, &csv_output.field_delimiter) ||
+      !get_select_char(out.record_delimiter, &csv_output.record_delimiter) ||
+      !get_select_char(out.quote_character, &csv_output.quote)) {
+    s->err.message = "The delimiters and quotes are single characters";
+    return -EINVAL;
+  }
+  if (out.quote_fields.empty() || out.quote_fields == "ASNEEDED") {
+    csv_output.quote_always = false;
+  } else if (out.quote_fields == "ALWAYS") {
+    csv_output.quote_always = true;
+  } else {
+    s->err.message = "Invalid QuoteFields " + out.quote_fields;
+    return -EINVAL;
+  }
+
+  string err;
+  if (!rgw::s3select::parse_query(req.expression, &query, &err)) {
+    ldpp_dout(this, 5) << "invalid select expression: " << err << dendl;
+    s->err.message = err;
+    return -EINVAL;
+  }
+  scanner = std::make_unique<rgw::s3select::CSVScanner>(query, csv_input,
+                                                        csv_output);
+  return 0;
+}
+
+int RGWSelectObj_ObjStore_S3::send_response_data(bufferlist& bl, off_t bl_ofs,
+                                                 off_t bl_len)
+{
+  if (!sent_header) {
+    set_req_state_err(s, op_ret);
+    dump_errno(s);
+    if (op_ret < 0) {
+      end_header(s, this, "application/xml");
+      sent_header = true;
+      finished = true;
+      return 0;
+    }
+    end_header(s, this, "application/octet-stream", CHUNKED_TRANSFER_ENCODING);
+    sent_header = true;
+  }
+  if (finished) {
+    return 0;
+  }
+
+  string events;
+  string records;
+  if (op_ret < 0) {
+    // the status is already sent, the error goes in the event stream
+    rgw::s3select::append_error_event(events, "InternalError",
+                                      "error reading the object");
+    finished = true;
+  } else if (bl_len > 0) {
+    bytes_processed += bl_len;
+    if (!scanner->done()) {
+      if (!scanner->process(bl.c_str() + bl_ofs, bl_len, records)) {
+        rgw::s3select::append_error_event(events, "InvalidQuery",
+                                          scanner->get_error());
+        finished = true;
+      } else if (!records.empty()) {
+        rgw::s3select::append_records_event(events, records);
+      }
+    }
+  } else {
+    // the end of the object
+    if (!scanner->finish(records)) {
+      rgw::s3select::append_error_event(events, "InvalidQuery",
+                                        scanner->get_error());
+    } else {
+      if (!records.empty()) {
+        rgw::s3select::append_records_event(events, records);
+      }
+      rgw::s3select::append_stats_event(events, scanner->get_bytes_scanned(),
+                                        bytes_processed,
+                                        scanner->get_bytes_returned());
+      rgw::s3select::append_end_event(events);
+    }
+    finished = true;
+  }
+
+  if (events.empty()) {
+    return 0;
+  }
+  return dump_body(s, events.data(), events.size());
+}
+
 void RGWGetObjTags_ObjStore_S3::send_response_data(bufferlist& bl)
 {
   dump_errno(s);
@@ -4517,6 +4734,9 @@ RGWOp *RGWHandler_REST_Obj_S3::op_post()
   if (s->info.args.exists("uploads"))
     return new RGWInitMultipart_ObjStore_S3;
 
+  if (s->info.args.exists("select"))
+    return new RGWSelectObj_ObjStore_S3;
+
   return new RGWPostObj_ObjStore_S3;
 }
 
@@ -5281,6 +5501,7 @@ AWSGeneralAbstractor::get_auth_data_v4(const req_state* const s,
         case RGW_OP_PUT_BUCKET_PUBLIC_ACCESS_BLOCK:
         case RGW_OP_GET_BUCKET_PUBLIC_ACCESS_BLOCK:
         case RGW_OP_DELETE_BUCKET_PUBLIC_ACCESS_BLOCK:
+        case RGW_OP_SELECT_OBJ_CONTENT:
           break;
         default:
           dout(10) << "ERROR: AWS4 completion for this operation NOT IMPLEMENTED" << dendl;
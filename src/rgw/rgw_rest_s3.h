@@ -27,6 +27,7 @@
 #include "rgw_auth.h"
 #include "rgw_auth_filters.h"
 #include "rgw_sts.h"
+#include "rgw_s3select.h"
 
 struct rgw_http_error {
   int http_ret;
@@ -55,6 +56,27 @@ public:
                          bufferlist* manifest_bl) override;
 };
 
+// SelectObjectContent: the object is read like a GET, and each chunk of its
+// data is run through the query instead of being sent back
+class RGWSelectObj_ObjStore_S3 : public RGWGetObj_ObjStore_S3
+{
+  rgw::s3select::Query query;
+  rgw::s3select::CSVInput csv_input;
+  rgw::s3select::CSVOutput csv_output;
+  std::unique_ptr<rgw::s3select::CSVScanner> scanner;
+  uint64_t bytes_processed = 0;
+  bool finished = false;
+
+public:
+  RGWSelectObj_ObjStore_S3() { get_data = true; }
+  ~RGWSelectObj_ObjStore_S3() override {}
+
+  int get_params() override;
+  int send_response_data(bufferlist& bl, off_t ofs, off_t len) override;
+  const char* name() const override { return "select_obj_content"; }
+  RGWOpType get_type() override { return RGW_OP_SELECT_OBJ_CONTENT; }
+};
+
 class RGWGetObjTags_ObjStore_S3 : public RGWGetObjTags_ObjStore
 {
 public:
@@ -0,0 +1,1327 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#include "rgw_s3select.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <strings.h>
+
+#include <boost/crc.hpp>
+
+namespace rgw::s3select {
+
+namespace {
+
+struct EvalError {
+  std::string msg;
+};
+
+bool iequals(std::string_view a, std::string_view b)
+{
+  return a.size() == b.size() &&
+    strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+std::string_view trim(std::string_view s)
+{
+  while (!s.empty() && isspace((unsigned char)s.front())) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && isspace((unsigned char)s.back())) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+// the number a string holds, if it holds only that
+bool parse_number(std::string_view s, Value* v)
+{
+  s = trim(s);
+  if (s.empty() || s.size() > 64) {
+    return false;
+  }
+  char buf[65];
+  memcpy(buf, s.data(), s.size());
+  buf[s.size()] = '\0';
+  char* end;
+  errno = 0;
+  long long i = strtoll(buf, &end, 10);
+  if (*end == '\0' && errno == 0) {
+    *v = Value::integer(i);
+    return true;
+  }
+  double f = strtod(buf, &end);
+  if (*end == '\0' && end != buf) {
+    *v = Value::floating(f);
+    return true;
+  }
+  return false;
+}
+
+bool is_numeric(const Value& v)
+{
+  return v.type == Value::Type::INT || v.type == Value::Type::FLOAT;
+}
+
+double as_double(const Value& v)
+{
+  return v.type == Value::Type::INT ? static_cast<double>(v.i) : v.f;
+}
+
+// a number for the arithmetic, the strings of the records are converted
+Value to_number(const Value& v)
+{
+  if (is_numeric(v) || v.is_null()) {
+    return v;
+  }
+  Value n;
+  if (v.type == Value::Type::STRING && parse_number(v.s, &n)) {
+    return n;
+  }
+  throw EvalError{"not a number: " + v.to_string()};
+}
+
+// <0, 0, >0 or false if unknown (a NULL)
+bool compare(const Value& a, const Value& b, int* result)
+{
+  if (a.is_null() || b.is_null()) {
+    return false;
+  }
+  Value na = a, nb = b;
+  if (is_numeric(a) != is_numeric(b)) {
+    // a field of a record compared to a number compares as a number
+    Value& s = is_numeric(a) ? nb : na;
+    Value n;
+    if (s.type == Value::Type::STRING && parse_number(s.s, &n)) {
+      s = n;
+    }
+  }
+  if (is_numeric(na) && is_numeric(nb)) {
+    if (na.type == Value::Type::INT && nb.type == Value::Type::INT) {
+      *result = (na.i > nb.i) - (na.i < nb.i);
+    } else {
+      double x = as_double(na), y = as_double(nb);
+      *result = (x > y) - (x < y);
+    }
+    return true;
+  }
+  if (na.type == Value::Type::BOOL && nb.type == Value::Type::BOOL) {
+    *result = int(na.b) - int(nb.b);
+    return true;
+  }
+  *result = na.to_string().compare(nb.to_string());
+  return true;
+}
+
+bool like(std::string_view s, std::string_view p)
+{
+  // the position after the last %, to backtrack to
+  size_t si = 0, pi = 0;
+  size_t star_p = std::string_view::npos, star_s = 0;
+  while (si < s.size()) {
+    if (pi < p.size() && (p[pi] == '_' || p[pi] == s[si])) {
+      ++si;
+      ++pi;
+    } else if (pi < p.size() && p[pi] == '%') {
+      star_p = ++pi;
+      star_s = si;
+    } else if (star_p != std::string_view::npos) {
+      pi = star_p;
+      si = ++star_s;
+    } else {
+      return false;
+    }
+  }
+  while (pi < p.size() && p[pi] == '%') {
+    ++pi;
+  }
+  return pi == p.size();
+}
+
+Value make_bool_or_null(bool known, bool v)
+{
+  return known ? Value::boolean(v) : Value();
+}
+
+// TRUE, FALSE or NULL of a condition
+int truth(const Value& v)
+{
+  switch (v.type) {
+  case Value::Type::NUL:
+    return -1;
+  case Value::Type::BOOL:
+    return v.b;
+  default:
+    throw EvalError{"not a condition: " + v.to_string()};
+  }
+}
+
+} // anonymous namespace
+
+std::string Value::to_string() const
+{
+  switch (type) {
+  case Type::NUL:
+    return {};
+  case Type::BOOL:
+    return b ? "true" : "false";
+  case Type::INT:
+    return std::to_string(i);
+  case Type::FLOAT: {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", f);
+    return buf;
+  }
+  case Type::STRING:
+    return s;
+  }
+  return {};
+}
+
+class Expr {
+public:
+  virtual ~Expr() = default;
+  virtual Value eval(const Record& r) const = 0;
+};
+
+namespace {
+
+class Literal : public Expr {
+  Value v;
+public:
+  explicit Literal(Value v) : v(std::move(v)) {}
+  Value eval(const Record&) const override { return v; }
+};
+
+class Column : public Expr {
+  std::string name;
+  bool positional = false;
+  // the header the index was looked up in
+  mutable const std::map<std::string, size_t>* resolved_names = nullptr;
+  mutable size_t index = 0;
+public:
+  explicit Column(std::string name) : name(std::move(name)) {
+    // _1, _2, ... are the positions of the fields
+    if (this->name.size() > 1 && this->name.size() < 10 &&
+        this->name[0] == '_' &&
+        std::all_of(this->name.begin() + 1, this->name.end(), ::isdigit)) {
+      index = std::stoul(this->name.substr(1)) - 1;
+      positional = true;
+    }
+  }
+  Value eval(const Record& r) const override {
+    if (!positional && (!resolved_names || resolved_names != r.names)) {
+      if (!r.names) {
+        throw EvalError{"no header for the column " + name};
+      }
+      auto i = r.names->find(name);
+      if (i == r.names->end()) {
+        i = std::find_if(r.names->begin(), r.names->end(),
+                         [this] (const auto& n) { return iequals(n.first, name); });
+      }
+      if (i == r.names->end()) {
+        throw EvalError{"no column " + name};
+      }
+      index = i->second;
+      resolved_names = r.names;
+    }
+    if (index >= r.fields.size()) {
+      return {};
+    }
+    return Value::string(std::string(r.fields[index]));
+  }
+};
+
+class Unary : public Expr {
+  char op; // '-' or '!'
+  std::unique_ptr<Expr> e;
+public:
+  Unary(char op, std::unique_ptr<Expr> e) : op(op), e(std::move(e)) {}
+  Value eval(const Record& r) const override {
+    Value v = e->eval(r);
+    if (op == '!') {
+      int t = truth(v);
+      return make_bool_or_null(t >= 0, !t);
+    }
+    v = to_number(v);
+    if (v.type == Value::Type::INT) {
+      v.i = -v.i;
+    } else if (v.type == Value::Type::FLOAT) {
+      v.f = -v.f;
+    }
+    return v;
+  }
+};
+
+class Logical : public Expr {
+  bool is_and;
+  std::unique_ptr<Expr> l, r;
+public:
+  Logical(bool is_and, std::unique_ptr<Expr> l, std::unique_ptr<Expr> r)
+    : is_and(is_and), l(std::move(l)), r(std::move(r)) {}
+  Value eval(const Record& rec) const override {
+    int a = truth(l->eval(rec));
+    if (a == !is_and) {
+      return Value::boolean(a); // short circuit
+    }
+    int b = truth(r->eval(rec));
+    if (b == !is_and) {
+      return Value::boolean(b);
+    }
+    return make_bool_or_null(a >= 0 && b >= 0, is_and);
+  }
+};
+
+class Comparison : public Expr {
+  std::string op;
+  std::unique_ptr<Expr> l, r;
+public:
+  Comparison(std::string op, std::unique_ptr<Expr> l, std::unique_ptr<Expr> r)
+    : op(std::move(op)), l(std::move(l)), r(std::move(r)) {}
+  Value eval(const Record& rec) const override {
+    int c;
+    if (!compare(l->eval(rec), r->eval(rec), &c)) {
+      return {};
+    }
+    bool v;
+    if (op == "=") {
+      v = c == 0;
+    } else if (op == "!=" || op == "<>") {
+      v = c != 0;
+    } else if (op == "<") {
+      v = c < 0;
+    } else if (op == "<=") {
+      v = c <= 0;
+    } else if (op == ">") {
+      v = c > 0;
+    } else {
+      v = c >= 0;
+    }
+    return Value::boolean(v);
+  }
+};
+
+class Arithmetic : public Expr {
+  char op;
+  std::unique_ptr<Expr> l, r;
+public:
+  Arithmetic(char op, std::unique_ptr<Expr> l, std::unique_ptr<Expr> r)
+    : op(op), l(std::move(l)), r(std::move(r)) {}
+  Value eval(const Record& rec) const override {
+    Value a = to_number(l->eval(rec));
+    Value b = to_number(r->eval(rec));
+    if (a.is_null() || b.is_null()) {
+      return {};
+    }
+    if (a.type == Value::Type::INT && b.type == Value::Type::INT) {
+      switch (op) {
+      case '+': return Value::integer(a.i + b.i);
+      case '-': return Value::integer(a.i - b.i);
+      case '*': return Value::integer(a.i * b.i);
+      case '/':
+      case '%':
+        if (b.i == 0) {
+          throw EvalError{"division by zero"};
+        }
+        return Value::integer(op == '/' ? a.i / b.i : a.i % b.i);
+      }
+    }
+    double x = as_double(a), y = as_double(b);
+    switch (op) {
+    case '+': return Value::floating(x + y);
+    case '-': return Value::floating(x - y);
+    case '*': return Value::floating(x * y);
+    case '/':
+      if (y == 0) {
+        throw EvalError{"division by zero"};
+      }
+      return Value::floating(x / y);
+    default:
+      if (y == 0) {
+        throw EvalError{"division by zero"};
+      }
+      return Value::floating(std::fmod(x, y));
+    }
+  }
+};
+
+class Like : public Expr {
+  std::unique_ptr<Expr> e;
+  std::string pattern;
+public:
+  Like(std::unique_ptr<Expr> e, std::string pattern)
+    : e(std::move(e)), pattern(std::move(pattern)) {}
+  Value eval(const Record& rec) const override {
+    Value v = e->eval(rec);
+    if (v.is_null()) {
+      return {};
+    }
+    return Value::boolean(like(v.to_string(), pattern));
+  }
+};
+
+class Between : public Expr {
+  std::unique_ptr<Expr> e, low, high;
+public:
+  Between(std::unique_ptr<Expr> e, std::unique_ptr<Expr> low,
+          std::unique_ptr<Expr> high)
+    : e(std::move(e)), low(std::move(low)), high(std::move(high)) {}
+  Value eval(const Record& rec) const override {
+    Value v = e->eval(rec);
+    int a, b;
+    if (!compare(v, low->eval(rec), &a) || !compare(v, high->eval(rec), &b)) {
+      return {};
+    }
+    return Value::boolean(a >= 0 && b <= 0);
+  }
+};
+
+class In : public Expr {
+  std::unique_ptr<Expr> e;
+  std::vector<std::unique_ptr<Expr>> list;
+public:
+  In(std::unique_ptr<Expr> e, std::vector<std::unique_ptr<Expr>> list)
+    : e(std::move(e)), list(std::move(list)) {}
+  Value eval(const Record& rec) const override {
+    Value v = e->eval(rec);
+    bool known = true;
+    for (auto& i : list) {
+      int c;
+      if (!compare(v, i->eval(rec), &c)) {
+        known = false;
+      } else if (c == 0) {
+        return Value::boolean(true);
+      }
+    }
+    return make_bool_or_null(known, false);
+  }
+};
+
+class IsNull : public Expr {
+  std::unique_ptr<Expr> e;
+public:
+  explicit IsNull(std::unique_ptr<Expr> e) : e(std::move(e)) {}
+  Value eval(const Record& rec) const override {
+    Value v = e->eval(rec);
+    // the missing fields and the empty ones
+    return Value::boolean(v.is_null() ||
+                          (v.type == Value::Type::STRING && v.s.empty()));
+  }
+};
+
+class Function : public Expr {
+  std::string name;
+  std::vector<std::unique_ptr<Expr>> args;
+public:
+  Function(std::string name, std::vector<std::unique_ptr<Expr>> args)
+    : name(std::move(name)), args(std::move(args)) {}
+  Value eval(const Record& rec) const override {
+    if (name == "COALESCE") {
+      for (auto& a : args) {
+        Value v = a->eval(rec);
+        if (!v.is_null()) {
+          return v;
+        }
+      }
+      return {};
+    }
+    Value v = args[0]->eval(rec);
+    if (v.is_null()) {
+      return v;
+    }
+    if (name == "LOWER" || name == "UPPER") {
+      std::string s = v.to_string();
+      std::transform(s.begin(), s.end(), s.begin(),
+                     name == "LOWER" ? ::tolower : ::toupper);
+      return Value::string(std::move(s));
+    }
+    if (name == "TRIM") {
+      return Value::string(std::string(trim(v.to_string())));
+    }
+    if (name == "CHAR_LENGTH" || name == "CHARACTER_LENGTH") {
+      return Value::integer(v.to_string().size());
+    }
+    if (name == "SUBSTRING") {
+      std::string s = v.to_string();
+      Value start = to_number(args[1]->eval(rec));
+      // the positions start at 1, the ones before the string count
+      int64_t from = start.type == Value::Type::INT ? start.i :
+        static_cast<int64_t>(start.f);
+      int64_t to = INT64_MAX;
+      if (args.size() > 2) {
+        Value len = to_number(args[2]->eval(rec));
+        int64_t l = len.type == Value::Type::INT ? len.i :
+          static_cast<int64_t>(len.f);
+        if (l < 0) {
+          throw EvalError{"negative SUBSTRING length"};
+        }
+        to = from + l;
+      }
+      from = std::max<int64_t>(from, 1);
+      to = std::min<int64_t>(to, s.size() + 1);
+      if (from >= to) {
+        return Value::string({});
+      }
+      return Value::string(s.substr(from - 1, to - from));
+    }
+    // CAST AS <type>, the type is the last argument
+    const std::string type = args[1]->eval(rec).s;
+    if (type == "STRING" || type == "VARCHAR") {
+      return Value::string(v.to_string());
+    }
+    if (type == "BOOL" || type == "BOOLEAN") {
+      if (v.type == Value::Type::BOOL) {
+        return v;
+      }
+      std::string s(trim(v.to_string()));
+      if (iequals(s, "true")) {
+        return Value::boolean(true);
+      }
+      if (iequals(s, "false")) {
+        return Value::boolean(false);
+      }
+      throw EvalError{"can't cast to BOOL: " + s};
+    }
+    Value n;
+    if (is_numeric(v)) {
+      n = v;
+    } else if (!parse_number(v.to_string(), &n)) {
+      throw EvalError{"can't cast to " + type + ": " + v.to_string()};
+    }
+    if (type == "INT" || type == "INTEGER") {
+      return n.type == Value::Type::INT ? n :
+        Value::integer(static_cast<int64_t>(n.f));
+    }
+    return Value::floating(as_double(n));
+  }
+};
+
+} // anonymous namespace
+
+class Aggregate {
+public:
+  enum class Fn { COUNT, SUM, MIN, MAX, AVG };
+
+private:
+  Fn fn;
+  std::unique_ptr<Expr> arg; // none for COUNT(*)
+  int64_t count = 0;
+  Value acc;
+
+public:
+  Aggregate(Fn fn, std::unique_ptr<Expr> arg) : fn(fn), arg(std::move(arg)) {}
+
+  void update(const Record& rec) {
+    if (!arg) {
+      ++count;
+      return;
+    }
+    Value v = arg->eval(rec);
+    if (v.is_null() || (v.type == Value::Type::STRING && v.s.empty())) {
+      return;
+    }
+    ++count;
+    switch (fn) {
+    case Fn::COUNT:
+      break;
+    case Fn::SUM:
+    case Fn::AVG:
+      v = to_number(v);
+      if (acc.is_null()) {
+        acc = v;
+      } else if (acc.type == Value::Type::INT && v.type == Value::Type::INT) {
+        acc.i += v.i;
+      } else {
+        acc = Value::floating(as_double(acc) + as_double(v));
+      }
+      break;
+    case Fn::MIN:
+    case Fn::MAX: {
+      int c;
+      if (acc.is_null() ||
+          (compare(v, acc, &c) && (fn == Fn::MIN ? c < 0 : c > 0))) {
+        acc = std::move(v);
+      }
+      break;
+    }
+    }
+  }
+
+  Value result() const {
+    switch (fn) {
+    case Fn::COUNT:
+      return Value::integer(count);
+    case Fn::AVG:
+      if (count == 0) {
+        return {};
+      }
+      return Value::floating(as_double(acc) / count);
+    default:
+      return acc;
+    }
+  }
+};
+
+Query::Query() = default;
+Query::~Query() = default;
+
+namespace {
+
+struct Token {
+  enum class Kind { IDENT, QUOTED_IDENT, STRING, NUMBER, SYMBOL, END } kind;
+  std::string text;
+};
+
+bool tokenize(const std::string& sql, std::vector<Token>* tokens,
+              std::string* err)
+{
+  size_t i = 0;
+  while (i < sql.size()) {
+    char c = sql[i];
+    if (isspace((unsigned char)c)) {
+      ++i;
+    } else if (isalpha((unsigned char)c) || c == '_') {
+      size_t start = i;
+      while (i < sql.size() &&
+             (isalnum((unsigned char)sql[i]) || sql[i] == '_')) {
+        ++i;
+      }
+      tokens->push_back({Token::Kind::IDENT, sql.substr(start, i - start)});
+    } else if (isdigit((unsigned char)c) ||
+               (c == '.' && i + 1 < sql.size() &&
+                isdigit((unsigned char)sql[i + 1]))) {
+      size_t start = i;
+      while (i < sql.size() &&
+             (isalnum((unsigned char)sql[i]) || sql[i] == '.')) {
+        ++i;
+      }
+      tokens->push_back({Token::Kind::NUMBER, sql.substr(start, i - start)});
+    } else if (c == '\'' || c == '"') {
+      // '' and "" inside quote themselves
+      std::string text;
+      ++i;
+      for (;;) {
+        if (i >= sql.size()) {
+          *err = "unterminated quotes";
+          return false;
+        }
+        if (sql[i] == c) {
+          if (i + 1 < sql.size() && sql[i + 1] == c) {
+            text.push_back(c);
+            i += 2;
+            continue;
+          }
+          ++i;
+          break;
+        }
+        text.push_back(sql[i++]);
+      }
+      tokens->push_back({c == '\'' ? Token::Kind::STRING :
+                         Token::Kind::QUOTED_IDENT, std::move(text)});
+    } else {
+      static const char* two[] = {"<=", ">=", "<>", "!="};
+      std::string text;
+      for (auto t : two) {
+        if (sql.compare(i, 2, t) == 0) {
+          text = t;
+          break;
+        }
+      }
+      if (text.empty()) {
+        if (!strchr("*,().=<>+-/%[]", c)) {
+          *err = std::string("unexpected character: ") + c;
+          return false;
+        }
+        text.push_back(c);
+      }
+      i += text.size();
+      tokens->push_back({Token::Kind::SYMBOL, std::move(text)});
+    }
+  }
+  tokens->push_back({Token::Kind::END, {}});
+  return true;
+}
+
+class Parser {
+  std::vector<Token> tokens;
+  size_t pos = 0;
+
+  struct ParseError {
+    std::string msg;
+  };
+
+  const Token& peek(size_t ahead = 0) const {
+    return tokens[std::min(pos + ahead, tokens.size() - 1)];
+  }
+  bool is_keyword(const char* kw, size_t ahead = 0) const {
+    const Token& t = peek(ahead);
+    return t.kind == Token::Kind::IDENT && iequals(t.text, kw);
+  }
+  bool is_symbol(const char* s, size_t ahead = 0) const {
+    const Token& t = peek(ahead);
+    return t.kind == Token::Kind::SYMBOL && t.text == s;
+  }
+  bool accept_keyword(const char* kw) {
+    if (is_keyword(kw)) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+  bool accept_symbol(const char* s) {
+    if (is_symbol(s)) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+  void expect_keyword(const char* kw) {
+    if (!accept_keyword(kw)) {
+      fail(std::string("expected ") + kw);
+    }
+  }
+  void expect_symbol(const char* s) {
+    if (!accept_symbol(s)) {
+      fail(std::string("expected ") + s);
+    }
+  }
+  [[noreturn]] void fail(const std::string& msg) const {
+    const Token& t = peek();
+    throw ParseError{msg + (t.kind == Token::Kind::END ? " at the end" :
+                            " before " + t.text)};
+  }
+
+  static bool is_reserved(const std::string& s) {
+    static const char* reserved[] = {
+      "SELECT", "FROM", "WHERE", "LIMIT", "AS", "AND", "OR", "NOT", "LIKE",
+      "BETWEEN", "IN", "IS", "NULL", "TRUE", "FALSE", "FOR",
+    };
+    for (auto r : reserved) {
+      if (iequals(s, r)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static std::optional<Aggregate::Fn> aggregate_fn(const std::string& s) {
+    if (iequals(s, "COUNT")) return Aggregate::Fn::COUNT;
+    if (iequals(s, "SUM")) return Aggregate::Fn::SUM;
+    if (iequals(s, "MIN")) return Aggregate::Fn::MIN;
+    if (iequals(s, "MAX")) return Aggregate::Fn::MAX;
+    if (iequals(s, "AVG")) return Aggregate::Fn::AVG;
+    return std::nullopt;
+  }
+
+  std::unique_ptr<Expr> parse_or() {
+    auto e = parse_and();
+    while (accept_keyword("OR")) {
+      e = std::make_unique<Logical>(false, std::move(e), parse_and());
+    }
+    return e;
+  }
+
+  std::unique_ptr<Expr> parse_and() {
+    auto e = parse_not();
+    while (accept_keyword("AND")) {
+      e = std::make_unique<Logical>(true, std::move(e), parse_not());
+    }
+    return e;
+  }
+
+  std::unique_ptr<Expr> parse_not() {
+    if (accept_keyword("NOT")) {
+      return std::make_unique<Unary>('!', parse_not());
+    }
+    return parse_comparison();
+  }
+
+  std::unique_ptr<Expr> parse_comparison() {
+    auto e = parse_additive();
+    static const char* ops[] = {"=", "!=", "<>", "<=", ">=", "<", ">"};
+    for (auto op : ops) {
+      if (accept_symbol(op)) {
+        return std::make_unique<Comparison>(op, std::move(e),
+                                            parse_additive());
+      }
+    }
+    if (accept_keyword("IS")) {
+      bool negate = accept_keyword("NOT");
+      expect_keyword("NULL");
+      std::unique_ptr<Expr> r = std::make_unique<IsNull>(std::move(e));
+      return negate ? std::make_unique<Unary>('!', std::move(r)) : std::move(r);
+    }
+    bool negate = false;
+    if (is_keyword("NOT") &&
+        (is_keyword("LIKE", 1) || is_keyword("BETWEEN", 1) ||
+         is_keyword("IN", 1))) {
+      ++pos;
+      negate = true;
+    }
+    std::unique_ptr<Expr> r;
+    if (accept_keyword("LIKE")) {
+      if (peek().kind != Token::Kind::STRING) {
+        fail("expected a pattern");
+      }
+      r = std::make_unique<Like>(std::move(e), tokens[pos++].text);
+    } else if (accept_keyword("BETWEEN")) {
+      auto low = parse_additive();
+      expect_keyword("AND");
+      r = std::make_unique<Between>(std::move(e), std::move(low),
+                                    parse_additive());
+    } else if (accept_keyword("IN")) {
+      expect_symbol("(");
+      std::vector<std::unique_ptr<Expr>> list;
+      do {
+        list.push_back(parse_additive());
+      } while (accept_symbol(","));
+      expect_symbol(")");
+      r = std::make_unique<In>(std::move(e), std::move(list));
+    } else {
+      return e;
+    }
+    return negate ? std::make_unique<Unary>('!', std::move(r)) : std::move(r);
+  }
+
+  std::unique_ptr<Expr> parse_additive() {
+    auto e = parse_multiplicative();
+    for (;;) {
+      if (accept_symbol("+")) {
+        e = std::make_unique<Arithmetic>('+', std::move(e),
+                                         parse_multiplicative());
+      } else if (accept_symbol("-")) {
+        e = std::make_unique<Arithmetic>('-', std::move(e),
+                                         parse_multiplicative());
+      } else {
+        return e;
+      }
+    }
+  }
+
+  std::unique_ptr<Expr> parse_multiplicative() {
+    auto e = parse_unary();
+    for (;;) {
+      char op;
+      if (accept_symbol("*")) {
+        op = '*';
+      } else if (accept_symbol("/")) {
+        op = '/';
+      } else if (accept_symbol("%")) {
+        op = '%';
+      } else {
+        return e;
+      }
+      e = std::make_unique<Arithmetic>(op, std::move(e), parse_unary());
+    }
+  }
+
+  std::unique_ptr<Expr> parse_unary() {
+    if (accept_symbol("-")) {
+      return std::make_unique<Unary>('-', parse_unary());
+    }
+    return parse_primary();
+  }
+
+  std::unique_ptr<Expr> parse_function(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    std::vector<std::unique_ptr<Expr>> args;
+    if (name == "CAST") {
+      args.push_back(parse_or());
+      expect_keyword("AS");
+      if (peek().kind != Token::Kind::IDENT) {
+        fail("expected a type");
+      }
+      std::string type = tokens[pos++].text;
+      std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+      static const char* types[] = {
+        "INT", "INTEGER", "FLOAT", "DECIMAL", "NUMERIC", "STRING", "VARCHAR",
+        "BOOL", "BOOLEAN",
+      };
+      if (std::none_of(std::begin(types), std::end(types),
+                       [&type] (const char* t) { return type == t; })) {
+        fail("unknown type " + type);
+      }
+      args.push_back(std::make_unique<Literal>(Value::string(type)));
+    } else if (name == "SUBSTRING") {
+      args.push_back(parse_or());
+      if (accept_keyword("FROM")) {
+        args.push_back(parse_or());
+        if (accept_keyword("FOR")) {
+          args.push_back(parse_or());
+        }
+      } else {
+        expect_symbol(",");
+        args.push_back(parse_or());
+        if (accept_symbol(",")) {
+          args.push_back(parse_or());
+        }
+      }
+    } else if (name == "LOWER" || name == "UPPER" || name == "TRIM" ||
+               name == "CHAR_LENGTH" || name == "CHARACTER_LENGTH") {
+      args.push_back(parse_or());
+    } else if (name == "COALESCE") {
+      do {
+        args.push_back(parse_or());
+      } while (accept_symbol(","));
+    } else {
+      fail("unknown function " + name);
+    }
+    expect_symbol(")");
+    return std::make_unique<Function>(std::move(name), std::move(args));
+  }
+
+  std::unique_ptr<Expr> parse_primary() {
+    const Token& t = peek();
+    switch (t.kind) {
+    case Token::Kind::NUMBER: {
+      Value v;
+      if (!parse_number(t.text, &v)) {
+        fail("bad number");
+      }
+      ++pos;
+      return std::make_unique<Literal>(std::move(v));
+    }
+    case Token::Kind::STRING:
+      ++pos;
+      return std::make_unique<Literal>(Value::string(t.text));
+    case Token::Kind::QUOTED_IDENT:
+      ++pos;
+      return std::make_unique<Column>(t.text);
+    case Token::Kind::IDENT:
+      break;
+    default:
+      if (accept_symbol("(")) {
+        auto e = parse_or();
+        expect_symbol(")");
+        return e;
+      }
+      fail("expected an expression");
+    }
+
+    if (accept_keyword("TRUE")) {
+      return std::make_unique<Literal>(Value::boolean(true));
+    }
+    if (accept_keyword("FALSE")) {
+      return std::make_unique<Literal>(Value::boolean(false));
+    }
+    if (accept_keyword("NULL")) {
+      return std::make_unique<Literal>(Value());
+    }
+    if (is_reserved(t.text)) {
+      fail("expected an expression");
+    }
+    std::string name = tokens[pos++].text;
+    if (accept_symbol("(")) {
+      if (aggregate_fn(name)) {
+        fail("aggregates only go in the select list");
+      }
+      return parse_function(std::move(name));
+    }
+    // <alias>.<column>
+    if (accept_symbol(".")) {
+      const Token& c = peek();
+      if (c.kind != Token::Kind::IDENT && c.kind != Token::Kind::QUOTED_IDENT) {
+        fail("expected a column");
+      }
+      ++pos;
+      return std::make_unique<Column>(c.text);
+    }
+    return std::make_unique<Column>(std::move(name));
+  }
+
+  void parse_projection(Query* q) {
+    if (accept_symbol("*")) {
+      q->select_all = true;
+      return;
+    }
+    do {
+      std::optional<Aggregate::Fn> fn;
+      if (peek().kind == Token::Kind::IDENT && is_symbol("(", 1)) {
+        fn = aggregate_fn(peek().text);
+      }
+      if (fn) {
+        pos += 2;
+        std::unique_ptr<Expr> arg;
+        if (!accept_symbol("*")) {
+          arg = parse_or();
+        } else if (*fn != Aggregate::Fn::COUNT) {
+          fail("only COUNT takes *");
+        }
+        expect_symbol(")");
+        q->aggregates.push_back(std::make_unique<Aggregate>(*fn, std::move(arg)));
+      } else {
+        q->projections.push_back(parse_or());
+      }
+      // the names of the output columns don't show in CSV
+      if (accept_keyword("AS")) {
+        if (peek().kind != Token::Kind::IDENT &&
+            peek().kind != Token::Kind::QUOTED_IDENT) {
+          fail("expected a name");
+        }
+        ++pos;
+      }
+    } while (accept_symbol(","));
+    if (!q->aggregates.empty() && !q->projections.empty()) {
+      throw ParseError{"aggregates and columns can't be mixed"};
+    }
+  }
+
+public:
+  explicit Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {}
+
+  bool parse(Query* q, std::string* err) {
+    try {
+      expect_keyword("SELECT");
+      parse_projection(q);
+      expect_keyword("FROM");
+      expect_keyword("S3Object");
+      // S3Object[*] of the JSON paths
+      if (accept_symbol("[")) {
+        expect_symbol("*");
+        expect_symbol("]");
+      }
+      accept_keyword("AS");
+      if (peek().kind == Token::Kind::IDENT && !is_reserved(peek().text)) {
+        q->alias = tokens[pos++].text;
+      }
+      if (accept_keyword("WHERE")) {
+        q->where = parse_or();
+      }
+      if (accept_keyword("LIMIT")) {
+        Value v;
+        if (peek().kind != Token::Kind::NUMBER ||
+            !parse_number(peek().text, &v) || v.type != Value::Type::INT ||
+            v.i < 0) {
+          fail("expected a limit");
+        }
+        ++pos;
+        q->limit = v.i;
+      }
+      if (peek().kind != Token::Kind::END) {
+        fail("unexpected");
+      }
+    } catch (const ParseError& e) {
+      *err = e.msg;
+      return false;
+    }
+    return true;
+  }
+};
+
+} // anonymous namespace
+
+bool parse_query(const std::string& sql, Query* query, std::string* err)
+{
+  std::vector<Token> tokens;
+  if (!tokenize(sql, &tokens, err)) {
+    return false;
+  }
+  return Parser(std::move(tokens)).parse(query, err);
+}
+
+size_t CSVScanner::find_record_end(std::string_view chunk, size_t pos)
+{
+  const char* data = chunk.data();
+  while (pos < chunk.size()) {
+    if (!in_quotes && !escaped) {
+      // most records have no quotes, look for both at once
+      const void* d = memchr(data + pos, input.record_delimiter,
+                             chunk.size() - pos);
+      size_t end = d ? static_cast<const char*>(d) - data : chunk.size();
+      const void* q = memchr(data + pos, input.quote, end - pos);
+      if (!q) {
+        return d ? end : std::string_view::npos;
+      }
+      pos = static_cast<const char*>(q) - data + 1;
+      in_quotes = true;
+      continue;
+    }
+    // in quotes
+    for (; pos < chunk.size(); ++pos) {
+      char c = chunk[pos];
+      if (escaped) {
+        escaped = false;
+      } else if (c == input.quote_escape && input.quote_escape != input.quote) {
+        escaped = true;
+      } else if (c == input.quote) {
+        // a doubled quote leaves and enters again
+        in_quotes = false;
+        ++pos;
+        break;
+      }
+    }
+  }
+  return std::string_view::npos;
+}
+
+void CSVScanner::split_fields(std::string_view rec)
+{
+  fields.clear();
+  if (rec.find(input.quote) == std::string_view::npos) {
+    size_t pos = 0;
+    for (;;) {
+      size_t d = rec.find(input.field_delimiter, pos);
+      if (d == std::string_view::npos) {
+        fields.push_back(rec.substr(pos));
+        return;
+      }
+      fields.push_back(rec.substr(pos, d - pos));
+      pos = d + 1;
+    }
+  }
+
+  // the unquoted fields are never longer than the record, so the views
+  // into the buffer stay valid
+  unquoted.clear();
+  unquoted.reserve(rec.size());
+  std::vector<std::pair<size_t, size_t>> ranges;
+  size_t start = 0;
+  bool quoted = false;
+  for (size_t i = 0; i < rec.size(); ++i) {
+    char c = rec[i];
+    if (quoted) {
+      if (c == input.quote_escape && i + 1 < rec.size() &&
+          rec[i + 1] == input.quote) {
+        unquoted.push_back(input.quote);
+        ++i;
+      } else if (c == input.quote) {
+        quoted = false;
+      } else {
+        unquoted.push_back(c);
+      }
+    } else if (c == input.quote) {
+      quoted = true;
+    } else if (c == input.field_delimiter) {
+      ranges.emplace_back(start, unquoted.size() - start);
+      start = unquoted.size();
+    } else {
+      unquoted.push_back(c);
+    }
+  }
+  ranges.emplace_back(start, unquoted.size() - start);
+  for (auto& [ofs, len] : ranges) {
+    fields.push_back(std::string_view(unquoted).substr(ofs, len));
+  }
+}
+
+void CSVScanner::write_field(std::string_view f, std::string& out) const
+{
+  bool quote = output.quote_always ||
+    f.find_first_of(std::string{output.field_delimiter,
+                                output.record_delimiter, output.quote, '\r'}) !=
+    std::string_view::npos;
+  if (!quote) {
+    out.append(f);
+    return;
+  }
+  out.push_back(output.quote);
+  for (char c : f) {
+    if (c == output.quote) {
+      out.push_back(c);
+    }
+    out.push_back(c);
+  }
+  out.push_back(output.quote);
+}
+
+bool CSVScanner::process_record(std::string_view rec, std::string& out)
+{
+  if (input.record_delimiter == '\n' && !rec.empty() && rec.back() == '\r') {
+    rec.remove_suffix(1);
+  }
+  if (rec.empty() || done()) {
+    return true;
+  }
+  if (input.comments && rec.front() == input.comments) {
+    return true;
+  }
+  split_fields(rec);
+  if (!header_done && input.header != CSVInput::Header::NONE) {
+    header_done = true;
+    if (input.header == CSVInput::Header::USE) {
+      for (size_t i = 0; i < fields.size(); ++i) {
+        names.emplace(std::string(trim(fields[i])), i);
+      }
+    }
+    return true;
+  }
+  header_done = true;
+
+  Record r{fields, input.header == CSVInput::Header::USE ? &names : nullptr};
+  if (query.where && truth(query.where->eval(r)) != 1) {
+    return true;
+  }
+  if (!query.aggregates.empty()) {
+    for (auto& a : query.aggregates) {
+      a->update(r);
+    }
+    return true;
+  }
+
+  if (query.select_all) {
+    for (size_t i = 0; i < fields.size(); ++i) {
+      if (i) {
+        out.push_back(output.field_delimiter);
+      }
+      write_field(fields[i], out);
+    }
+  } else {
+    for (size_t i = 0; i < query.projections.size(); ++i) {
+      if (i) {
+        out.push_back(output.field_delimiter);
+      }
+      write_field(query.projections[i]->eval(r).to_string(), out);
+    }
+  }
+  out.push_back(output.record_delimiter);
+  ++returned_records;
+  return true;
+}
+
+bool CSVScanner::process(const char* data, size_t len, std::string& out)
+{
+  const size_t out_start = out.size();
+  bytes_scanned += len;
+  std::string_view chunk(data, len);
+  size_t pos = 0;
+  try {
+    while (pos < chunk.size() && !done()) {
+      // the quote state carries on from the partial record
+      size_t end = find_record_end(chunk, pos);
+      if (end == std::string_view::npos) {
+        partial.append(chunk.substr(pos));
+        break;
+      }
+      if (partial.empty()) {
+        process_record(chunk.substr(pos, end - pos), out);
+      } else {
+        partial.append(chunk.substr(pos, end - pos));
+        process_record(partial, out);
+        partial.clear();
+      }
+      pos = end + 1;
+    }
+  } catch (const EvalError& e) {
+    error = e.msg;
+    return false;
+  }
+  bytes_returned += out.size() - out_start;
+  return true;
+}
+
+bool CSVScanner::finish(std::string& out)
+{
+  const size_t out_start = out.size();
+  try {
+    if (!partial.empty()) {
+      process_record(partial, out);
+      partial.clear();
+    }
+    if (!query.aggregates.empty()) {
+      for (size_t i = 0; i < query.aggregates.size(); ++i) {
+        if (i) {
+          out.push_back(output.field_delimiter);
+        }
+        write_field(query.aggregates[i]->result().to_string(), out);
+      }
+      out.push_back(output.record_delimiter);
+    }
+  } catch (const EvalError& e) {
+    error = e.msg;
+    return false;
+  }
+  bytes_returned += out.size() - out_start;
+  return true;
+}
+
+namespace {
+
+void append_be32(std::string& out, uint32_t v)
+{
+  out.push_back(static_cast<char>(v >> 24));
+  out.push_back(static_cast<char>(v >> 16));
+  out.push_back(static_cast<char>(v >> 8));
+  out.push_back(static_cast<char>(v));
+}
+
+void append_header(std::string& out, std::string_view name,
+                   std::string_view value)
+{
+  static constexpr char string_type = 7;
+  out.push_back(static_cast<char>(name.size()));
+  out.append(name);
+  out.push_back(string_type);
+  out.push_back(static_cast<char>(value.size() >> 8));
+  out.push_back(static_cast<char>(value.size()));
+  out.append(value);
+}
+
+uint32_t crc32(std::string_view data)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(data.data(), data.size());
+  return crc.checksum();
+}
+
+// the prelude of the lengths and its crc, the headers, the payload and
+// the crc of the whole message
+void append_message(std::string& out, std::string_view headers,
+                    std::string_view payload)
+{
+  const size_t start = out.size();
+  append_be32(out, 12 + headers.size() + payload.size() + 4);
+  append_be32(out, headers.size());
+  append_be32(out, crc32(std::string_view(out).substr(start, 8)));
+  out.append(headers);
+  out.append(payload);
+  append_be32(out, crc32(std::string_view(out).substr(start)));
+}
+
+} // anonymous namespace
+
+void append_records_event(std::string& out, std::string_view payload)
+{
+  std::string headers;
+  append_header(headers, ":event-type", "Records");
+  append_header(headers, ":content-type", "application/octet-stream");
+  append_header(headers, ":message-type", "event");
+  append_message(out, headers, payload);
+}
+
+void append_stats_event(std::string& out, uint64_t bytes_scanned,
+                        uint64_t bytes_processed, uint64_t bytes_returned)
+{
+  std::string headers;
+  append_header(headers, ":event-type", "Stats");
+  append_header(headers, ":content-type", "text/xml");
+  append_header(headers, ":message-type", "event");
+  std::string payload = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Stats>"
+    "<BytesScanned>" + std::to_string(bytes_scanned) + "</BytesScanned>"
+    "<BytesProcessed>" + std::to_string(bytes_processed) + "</BytesProcessed>"
+    "<BytesReturned>" + std::to_string(bytes_returned) + "</BytesReturned>"
+    "</Stats>";
+  append_message(out, headers, payload);
+}
+
+void append_end_event(std::string& out)
+{
+  std::string headers;
+  append_header(headers, ":event-type", "End");
+  append_header(headers, ":message-type", "event");
+  append_message(out, headers, {});
+}
+
+void append_error_event(std::string& out, std::string_view code,
+                        std::string_view message)
+{
+  std::string headers;
+  append_header(headers, ":error-code", code);
+  append_header(headers, ":error-message", message);
+  append_header(headers, ":message-type", "error");
+  append_message(out, headers, {});
+}
+
+} // namespace rgw::s3select
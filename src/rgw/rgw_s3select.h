@@ -0,0 +1,142 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * The engine of S3 Select: a subset of the SQL of S3 Select run over the
+ * records of a CSV object, and the event stream framing of its response.
+ *
+ * SELECT * | <expr> [, <expr>]... | <aggregate> [, <aggregate>]...
+ *   FROM S3Object [[AS] <alias>] [WHERE <condition>] [LIMIT <n>]
+ *
+ * The columns are _1, _2, ... or, with FileHeaderInfo USE, the names of
+ * the header record, optionally prefixed by the alias. The conditions and
+ * expressions have the comparisons, AND, OR, NOT, LIKE, BETWEEN, IN,
+ * IS [NOT] NULL, the arithmetic operators and CAST, LOWER, UPPER, TRIM,
+ * CHAR_LENGTH, SUBSTRING and COALESCE; the aggregates are COUNT, SUM, MIN,
+ * MAX and AVG.
+ */
+namespace rgw::s3select {
+
+struct CSVInput {
+  char field_delimiter = ',';
+  char record_delimiter = '\n';
+  char quote = '"';
+  char quote_escape = '"';
+  char comments = '\0';
+  enum class Header { NONE, USE, IGNORE } header = Header::NONE;
+};
+
+struct CSVOutput {
+  char field_delimiter = ',';
+  char record_delimiter = '\n';
+  char quote = '"';
+  bool quote_always = false;
+};
+
+struct Value {
+  enum class Type { NUL, BOOL, INT, FLOAT, STRING } type = Type::NUL;
+  bool b = false;
+  int64_t i = 0;
+  double f = 0;
+  std::string s;
+
+  Value() = default;
+  static Value boolean(bool v) { Value r; r.type = Type::BOOL; r.b = v; return r; }
+  static Value integer(int64_t v) { Value r; r.type = Type::INT; r.i = v; return r; }
+  static Value floating(double v) { Value r; r.type = Type::FLOAT; r.f = v; return r; }
+  static Value string(std::string v) {
+    Value r; r.type = Type::STRING; r.s = std::move(v); return r;
+  }
+
+  bool is_null() const { return type == Type::NUL; }
+  std::string to_string() const;
+};
+
+// the fields of the record being evaluated
+struct Record {
+  std::vector<std::string_view> fields;
+  // the columns of the header record, if used
+  const std::map<std::string, size_t>* names = nullptr;
+};
+
+class Expr;
+class Aggregate;
+
+struct Query {
+  bool select_all = false;
+  std::vector<std::unique_ptr<Expr>> projections;
+  std::vector<std::unique_ptr<Aggregate>> aggregates;
+  std::unique_ptr<Expr> where;
+  std::string alias;
+  int64_t limit = -1;
+
+  Query();
+  ~Query();
+};
+
+// parse the SQL expression of a request, returns false with the reason
+bool parse_query(const std::string& sql, Query* query, std::string* err);
+
+// runs a query on the CSV records fed to it
+class CSVScanner {
+  Query& query;
+  const CSVInput input;
+  const CSVOutput output;
+
+  std::string partial; // the start of a record cut by the end of a chunk
+  bool in_quotes = false; // at the end of partial
+  bool escaped = false; // the last char of partial escapes the next one
+  bool header_done = false;
+  std::map<std::string, size_t> names;
+  int64_t returned_records = 0;
+  uint64_t bytes_scanned = 0;
+  uint64_t bytes_returned = 0;
+  std::string error;
+
+  std::vector<std::string_view> fields;
+  std::string unquoted; // the fields of a record with quotes, unquoted
+
+  size_t find_record_end(std::string_view chunk, size_t pos);
+
+  void split_fields(std::string_view rec);
+  bool process_record(std::string_view rec, std::string& out);
+  void write_field(std::string_view f, std::string& out) const;
+
+public:
+  CSVScanner(Query& query, const CSVInput& input, const CSVOutput& output)
+    : query(query), input(input), output(output) {}
+
+  // append the output records of the records of the data to out, false
+  // on an evaluation error
+  bool process(const char* data, size_t len, std::string& out);
+  // the last record if not delimited, and the aggregates
+  bool finish(std::string& out);
+  // whether the limit was reached, the rest of the data does not matter
+  bool done() const {
+    return query.limit >= 0 && returned_records >= query.limit &&
+      query.aggregates.empty();
+  }
+
+  uint64_t get_bytes_scanned() const { return bytes_scanned; }
+  uint64_t get_bytes_returned() const { return bytes_returned; }
+  const std::string& get_error() const { return error; }
+};
+
+// the messages of the event stream of the response
+void append_records_event(std::string& out, std::string_view payload);
+void append_stats_event(std::string& out, uint64_t bytes_scanned,
+                        uint64_t bytes_processed, uint64_t bytes_returned);
+void append_end_event(std::string& out);
+void append_error_event(std::string& out, std::string_view code,
+                        std::string_view message);
+
+} // namespace rgw::s3select
@@ -19,6 +19,26 @@ struct ltstr_nocase
   }
 };
 
+/* ltstr_nocase that looks up the C strings of the callers without building
+ * a std::string for them */
+struct ltstr_nocase_transparent
+{
+  using is_transparent = void;
+
+  bool operator()(const std::string& s1, const std::string& s2) const
+  {
+    return strcasecmp(s1.c_str(), s2.c_str()) < 0;
+  }
+  bool operator()(const std::string& s1, const char *s2) const
+  {
+    return strcasecmp(s1.c_str(), s2) < 0;
+  }
+  bool operator()(const char *s1, const std::string& s2) const
+  {
+    return strcasecmp(s1, s2.c_str()) < 0;
+  }
+};
+
 static inline int stringcasecmp(const std::string& s1, const std::string& s2)
 {
   return strcasecmp(s1.c_str(), s2.c_str());
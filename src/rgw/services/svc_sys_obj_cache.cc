@@ -3,6 +3,7 @@
 // vim: ts=8 sw=2 smarttab ft=cpp
 
 #include "common/admin_socket.h"
+#include "common/Thread.h"
 
 #include "svc_sys_obj_cache.h"
 #include "svc_zone.h"
@@ -13,6 +14,9 @@
 
 #define dout_subsys ceph_subsys_rgw
 
+// the objects in one batch notification at most
+static constexpr size_t max_notify_batch = 100;
+
 class RGWSI_SysObj_Cache_CB : public RGWSI_Notify::CB
 {
   RGWSI_SysObj_Cache *svc;
@@ -53,11 +57,26 @@ int RGWSI_SysObj_Cache::do_start()
 
   notify_svc->register_watch_cb(cb.get());
 
+  batch_interval = std::chrono::milliseconds(
+    cct->_conf.get_val<uint64_t>("rgw_cache_notify_batch_interval_ms"));
+  if (batch_interval.count() > 0) {
+    batch_thread = make_named_thread("rgw_cache_batch",
+                                     &RGWSI_SysObj_Cache::batch_entry, this);
+  }
+
   return 0;
 }
 
 void RGWSI_SysObj_Cache::shutdown()
 {
+  if (batch_thread.joinable()) {
+    {
+      std::lock_guard l{batch_lock};
+      batch_stopping = true;
+    }
+    batch_cond.notify_all();
+    batch_thread.join();
+  }
   asocket.shutdown();
   RGWSI_SysObj_Core::shutdown();
 }
@@ -422,21 +441,100 @@ int RGWSI_SysObj_Cache::distribute_cache(const string& normal_name,
   info.op = op;
   info.obj_info = obj_info;
   info.obj = obj;
+  if (batch_interval.count() > 0) {
+    queue_notify(normal_name, std::move(info));
+    return 0;
+  }
   bufferlist bl;
   encode(info, bl);
   return notify_svc->distribute(normal_name, bl, y);
 }
 
+void RGWSI_SysObj_Cache::queue_notify(const string& normal_name,
+                                      RGWCacheNotifyInfo&& info)
+{
+  std::lock_guard l{batch_lock};
+  auto [iter, inserted] = batch.try_emplace(normal_name, std::move(info));
+  if (inserted) {
+    return;
+  }
+
+  // a removal, or an update of all the pending one updated, supersedes
+  // it; the peers drop the object for the changes that can't be merged
+  RGWCacheNotifyInfo& pending = iter->second;
+  if (info.op == REMOVE_OBJ ||
+      (pending.op == UPDATE_OBJ &&
+       !(info.obj_info.flags & CACHE_FLAG_MODIFY_XATTRS) &&
+       (info.obj_info.flags & pending.obj_info.flags) == pending.obj_info.flags)) {
+    pending = std::move(info);
+  } else {
+    pending.op = REMOVE_OBJ;
+    pending.obj_info = ObjectCacheInfo();
+  }
+}
+
+void RGWSI_SysObj_Cache::batch_entry()
+{
+  std::unique_lock l{batch_lock};
+  while (!batch_stopping) {
+    batch_cond.wait_for(l, batch_interval);
+    if (batch.empty()) {
+      continue;
+    }
+    std::map<string, RGWCacheNotifyInfo> pending;
+    pending.swap(batch);
+    l.unlock();
+    send_batch(pending);
+    l.lock();
+  }
+
+  std::map<string, RGWCacheNotifyInfo> pending;
+  pending.swap(batch);
+  l.unlock();
+  send_batch(pending);
+}
+
+int RGWSI_SysObj_Cache::send_batch(std::map<string, RGWCacheNotifyInfo>& pending)
+{
+  int ret = 0;
+  auto iter = pending.begin();
+  while (iter != pending.end()) {
+    // the first name picks the control object
+    const string key = iter->first;
+    std::vector<RGWCacheNotifyInfo> infos;
+    for (; iter != pending.end() && infos.size() < max_notify_batch; ++iter) {
+      infos.push_back(std::move(iter->second));
+    }
+
+    RGWCacheNotifyInfo header;
+    header.op = BATCH_OBJS;
+    bufferlist bl;
+    encode(header, bl);
+    encode(infos, bl);
+    int r = notify_svc->distribute(key, bl, null_yield);
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: failed to distribute cache for "
+                    << infos.size() << " objects: r=" << r << dendl;
+      ret = r;
+    }
+  }
+  return ret;
+}
+
 int RGWSI_SysObj_Cache::watch_cb(uint64_t notify_id,
                                  uint64_t cookie,
                                  uint64_t notifier_id,
                                  bufferlist& bl)
 {
   RGWCacheNotifyInfo info;
+  std::vector<RGWCacheNotifyInfo> infos;
 
   try {
     auto iter = bl.cbegin();
     decode(info, iter);
+    if (info.op == BATCH_OBJS) {
+      decode(infos, iter);
+    }
   } catch (buffer::end_of_buffer& err) {
     ldout(cct, 0) << "ERROR: got bad notification" << dendl;
     return -EIO;
@@ -445,6 +543,22 @@ int RGWSI_SysObj_Cache::watch_cb(uint64_t notify_id,
     return -EIO;
   }
 
+  if (info.op != BATCH_OBJS) {
+    return apply_notify(info);
+  }
+
+  int ret = 0;
+  for (auto& i : infos) {
+    int r = apply_notify(i);
+    if (r < 0) {
+      ret = r;
+    }
+  }
+  return ret;
+}
+
+int RGWSI_SysObj_Cache::apply_notify(RGWCacheNotifyInfo& info)
+{
   rgw_pool pool;
   string oid;
   normalize_pool_and_obj(info.obj.pool, info.obj.oid, pool, oid);
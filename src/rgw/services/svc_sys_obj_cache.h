@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <thread>
+
 #include "rgw/rgw_service.h"
 #include "rgw/rgw_cache.h"
 
@@ -24,6 +26,19 @@ class RGWSI_SysObj_Cache : public RGWSI_SysObj_Core
 
   std::shared_ptr<RGWSI_SysObj_Cache_CB> cb;
 
+  // the notifications waiting to be sent together, by cache name, if
+  // rgw_cache_notify_batch_interval_ms is set
+  ceph::mutex batch_lock = ceph::make_mutex("RGWSI_SysObj_Cache::batch_lock");
+  ceph::condition_variable batch_cond;
+  std::map<string, RGWCacheNotifyInfo> batch;
+  std::chrono::milliseconds batch_interval{0};
+  bool batch_stopping{false};
+  std::thread batch_thread;
+
+  void queue_notify(const string& normal_name, RGWCacheNotifyInfo&& info);
+  void batch_entry();
+  int send_batch(std::map<string, RGWCacheNotifyInfo>& pending);
+
   void normalize_pool_and_obj(const rgw_pool& src_pool, const string& src_obj, rgw_pool& dst_pool, string& dst_obj);
 protected:
   void init(RGWSI_RADOS *_rados_svc,
@@ -89,6 +104,7 @@ protected:
                uint64_t cookie,
                uint64_t notifier_id,
                bufferlist& bl);
+  int apply_notify(RGWCacheNotifyInfo& info);
 
   void set_enabled(bool status);
 
@@ -0,0 +1,95 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+// ceph_bench_denc: nanoseconds per encode and decode of the types the OSD
+// encodes most, to track the cost of their encoding from build to build.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+
+#include "common/ceph_time.h"
+#include "common/hobject.h"
+#include "include/encoding.h"
+#include "osd/osd_types.h"
+
+using namespace std;
+
+template <typename T>
+static void bench(const char *name, const T& v, unsigned n)
+{
+  using ceph::mono_clock;
+  bufferlist one;
+  encode(v, one);
+
+  bufferlist bl;
+  auto start = mono_clock::now();
+  for (unsigned i = 0; i < n; ++i) {
+    encode(v, bl);
+  }
+  auto encoded = mono_clock::now();
+  auto p = bl.cbegin();
+  for (unsigned i = 0; i < n; ++i) {
+    T t;
+    decode(t, p);
+  }
+  auto decoded = mono_clock::now();
+
+  // one at a time into a fresh list, as most messages and transactions do
+  auto single_start = mono_clock::now();
+  for (unsigned i = 0; i < n; ++i) {
+    bufferlist b;
+    encode(v, b);
+  }
+  auto single = mono_clock::now();
+
+  auto ns = [n](auto d) {
+    return double(std::chrono::nanoseconds(d).count()) / n;
+  };
+  cout << std::left << std::setw(16) << name << std::right
+       << std::setw(8) << one.length()
+       << std::fixed << std::setprecision(1)
+       << std::setw(12) << ns(encoded - start)
+       << std::setw(12) << ns(decoded - encoded)
+       << std::setw(12) << ns(single - single_start) << std::endl;
+}
+
+template <typename T>
+static void bench_instances(const char *name, unsigned n)
+{
+  std::list<T*> o;
+  T::generate_test_instances(o);
+  // the last instance is the most populated one
+  bench(name, *o.back(), n);
+  for (auto i : o) {
+    delete i;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  unsigned n = 1000000;
+  if (argc > 1) {
+    n = atoi(argv[1]);
+  }
+  if (!n) {
+    cerr << "usage: " << argv[0] << " [iterations]" << std::endl;
+    return 1;
+  }
+  cout << std::left << std::setw(16) << "type" << std::right
+       << std::setw(8) << "bytes"
+       << std::setw(12) << "encode ns"
+       << std::setw(12) << "decode ns"
+       << std::setw(12) << "single ns" << std::endl;
+  bench("eversion_t", eversion_t(12, 345678), n);
+  bench("shard_id_t", shard_id_t(1), n);
+  bench_instances<pg_t>("pg_t", n);
+  bench("spg_t", spg_t(pg_t(7, 1), shard_id_t(2)), n);
+  bench("pg_shard_t", pg_shard_t(3, shard_id_t(1)), n);
+  bench_instances<osd_reqid_t>("osd_reqid_t", n);
+  bench_instances<hobject_t>("hobject_t", n);
+  bench_instances<ghobject_t>("ghobject_t", n);
+  bench_instances<pg_log_entry_t>("pg_log_entry_t", n / 10);
+  return 0;
+}
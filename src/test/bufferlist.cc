@@ -20,6 +20,7 @@
  */
 
 #include <limits.h>
+#include <thread>
 #include <errno.h>
 #include <sys/uio.h>
 
@@ -1322,6 +1323,59 @@ TEST(BufferList, append_after_move) {
   EXPECT_EQ(0, ::memcmp("ABC123", moved_to_bl.c_str(), 6));
 }
 
+TEST(BufferPtr, aligned_pool) {
+  size_t pooled = mempool::buffer_pool::allocated_bytes();
+  const char* data;
+  {
+    bufferptr bp = buffer::create_page_aligned(65536);
+    data = bp.c_str();
+  }
+  EXPECT_EQ(pooled + 65536, mempool::buffer_pool::allocated_bytes());
+  {
+    // handed out again, whatever the alignment asked for
+    bufferptr bp = buffer::create(65536);
+    EXPECT_EQ(data, bp.c_str());
+    EXPECT_TRUE(bp.is_page_aligned());
+  }
+  EXPECT_EQ(pooled + 65536, mempool::buffer_pool::allocated_bytes());
+
+  // freed by another thread, the buffer is queued back to this one
+  bufferptr bp = buffer::create_page_aligned(65536);
+  EXPECT_EQ(data, bp.c_str());
+  std::thread other([bp = std::move(bp)]() mutable {
+    bp = bufferptr();
+  });
+  other.join();
+  EXPECT_EQ(pooled + 65536, mempool::buffer_pool::allocated_bytes());
+}
+
+TEST(BufferList, ptr_node_stash) {
+  // nodes freed by one thread are reused by another
+  std::vector<bufferlist> bls(1000);
+  std::thread producer([&bls] {
+    for (unsigned i = 0; i < bls.size(); ++i) {
+      bls[i].append(bufferptr("ABC", 3));
+      bls[i].append(bufferptr("123", 3));
+    }
+  });
+  producer.join();
+  std::thread consumer([&bls] {
+    for (auto& bl : bls) {
+      bufferlist other;
+      other.claim_append(bl);
+      EXPECT_EQ(2u, other.get_num_buffers());
+      EXPECT_EQ(0, ::memcmp("ABC123", other.c_str(), 6));
+    }
+    bls.clear();
+  });
+  consumer.join();
+  for (unsigned i = 0; i < 1000; ++i) {
+    bufferlist bl;
+    bl.append(bufferptr("XYZ", 3));
+    EXPECT_EQ(0, ::memcmp("XYZ", bl.c_str(), 3));
+  }
+}
+
 void bench_bufferlist_alloc(int size, int num, int per)
 {
   utime_t start = ceph_clock_now();
@@ -2372,6 +2426,56 @@ TEST(BufferList, crc32c_append) {
   ASSERT_EQ(bl1.crc32c(0), bl2.crc32c(0));
 }
 
+TEST(BufferList, crc32c_cached_part) {
+  bufferptr bp(buffer::create(4096));
+  for (unsigned i = 0; i < bp.length(); ++i) {
+    bp.c_str()[i] = rand();
+  }
+  uint32_t expected = ceph_crc32c(7, (unsigned char*)bp.c_str(), bp.length());
+  buffer::track_cached_crc(true);
+  {
+    // cache the crc of the middle of the raw
+    bufferlist bl;
+    bl.append(bp, 1000, 2000);
+    bl.crc32c(3);
+  }
+  int adjusted = buffer::get_cached_crc_adjusted();
+  bufferlist bl;
+  bl.append(bp);
+  EXPECT_EQ(expected, bl.crc32c(7));
+  EXPECT_EQ(adjusted + 1, buffer::get_cached_crc_adjusted());
+  // and the whole of it is cached now
+  int cached = buffer::get_cached_crc();
+  EXPECT_EQ(expected, bl.crc32c(7));
+  EXPECT_EQ(cached + 1, buffer::get_cached_crc());
+  buffer::track_cached_crc(false);
+}
+
+TEST(BufferList, crc32c_seeded) {
+  const unsigned chunk = 4096;
+  bufferptr p(buffer::create(chunk * 3));
+  for (unsigned i = 0; i < p.length(); ++i) {
+    p.c_str()[i] = rand();
+  }
+  uint32_t whole = ceph_crc32c(-1, (unsigned char*)p.c_str(), p.length());
+
+  // put it together from the crcs of the chunks the way a store
+  // holding per-chunk checksums would
+  uint32_t crc = ceph_crc32c(-1, (unsigned char*)p.c_str(), chunk);
+  for (unsigned i = 1; i < 3; ++i) {
+    uint32_t c = ceph_crc32c(-1, (unsigned char*)p.c_str() + i * chunk, chunk);
+    crc = c ^ ceph_crc32c(crc ^ 0xffffffff, nullptr, chunk);
+  }
+  EXPECT_EQ(whole, crc);
+
+  p.set_crc32c(-1, crc);
+  bufferlist bl;
+  bl.push_back(p);
+  EXPECT_EQ(whole, bl.crc32c(-1));
+  EXPECT_EQ(ceph_crc32c(0, (unsigned char*)p.c_str(), p.length()),
+	    bl.crc32c(0));
+}
+
 TEST(BufferList, crc32c_zeros) {
   char buffer[4*1024];
   for (size_t i=0; i < sizeof(buffer); i++)
@@ -2886,6 +2990,13 @@ TEST(BufferHash, all) {
     EXPECT_EQ(&returned_hash, &hash);
     EXPECT_EQ((unsigned)0xB3109EBF, hash.digest());
   }
+  {
+    bufferhash hash;
+    hash.update("A", 1);
+    EXPECT_EQ((unsigned)0xB3109EBF, hash.digest());
+    hash.update("A", 1);
+    EXPECT_EQ((unsigned)0x5FA5C0CC, hash.digest());
+  }
 }
 
 /*
@@ -121,6 +121,8 @@
      --set-subtree-class <bucket-name> <class>
                            set class for all items beneath bucket-name
      --compare <otherfile> compare two maps using --test parameters
+     --bench <rounds>      time the mappings of the --test range, rounds
+                           times over
   
   Options for the output stage
   
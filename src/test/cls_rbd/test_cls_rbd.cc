@@ -7,6 +7,7 @@
 #include "common/snap_types.h"
 #include "common/Clock.h"
 #include "common/bit_vector.hpp"
+#include "compressor/Compressor.h"
 #include "include/encoding.h"
 #include "include/types.h"
 #include "include/rados/librados.h"
@@ -3412,3 +3413,71 @@ TEST_F(TestClsRbd, sparsify)
   ASSERT_EQ(0, ioctx.remove(oid));
   ioctx.close();
 }
+
+TEST_F(TestClsRbd, compressed_read)
+{
+  librados::IoCtx ioctx;
+  ASSERT_EQ(0, _rados.ioctx_create(_pool_name.c_str(), ioctx));
+
+  string oid = get_temp_image_name();
+  ioctx.remove(oid);
+
+  std::vector<std::map<uint64_t, uint64_t>> extent_maps;
+  std::string compressor;
+  uint32_t raw_length;
+  bufferlist data;
+  ASSERT_EQ(-ENOENT, compressed_read(&ioctx, oid, {{0, 4096}}, 4096, "",
+                                     &extent_maps, &compressor, &raw_length,
+                                     &data));
+  ASSERT_EQ(-EINVAL, compressed_read(&ioctx, oid, {{0, 4096}}, 0, "",
+                                     &extent_maps, &compressor, &raw_length,
+                                     &data));
+
+  bufferlist inbl;
+  inbl.append(std::string(4096, '1'));
+  inbl.append(std::string(4096, '\0'));
+  inbl.append(std::string(4096, '2'));
+  ASSERT_EQ(0, ioctx.write(oid, inbl, inbl.length(), 0));
+
+  // the zeroed blocks are skipped, also past the end of the object
+  bufferlist expected_data;
+  expected_data.append(std::string(4096, '1'));
+  expected_data.append(std::string(2048, '2'));
+  std::vector<std::map<uint64_t, uint64_t>> expected_extent_maps = {
+    {{0, 4096}}, {{8192, 2048}}, {}};
+  ASSERT_EQ(0, compressed_read(&ioctx, oid,
+                               {{0, 8192}, {8192, 2048}, {16384, 4096}}, 4096,
+                               "", &extent_maps, &compressor, &raw_length,
+                               &data));
+  ASSERT_EQ(expected_extent_maps, extent_maps);
+  ASSERT_EQ("", compressor);
+  ASSERT_EQ(expected_data.length(), raw_length);
+  ASSERT_TRUE(data.contents_equal(expected_data));
+
+  // the data is returned as is unless the compressor is available
+  expected_extent_maps = {{{0, 4096}, {8192, 4096}}};
+  expected_data.clear();
+  expected_data.append(std::string(4096, '1'));
+  expected_data.append(std::string(4096, '2'));
+  ASSERT_EQ(0, compressed_read(&ioctx, oid, {{0, 3 * 4096}}, 4096, "zlib",
+                               &extent_maps, &compressor, &raw_length,
+                               &data));
+  ASSERT_EQ(expected_extent_maps, extent_maps);
+  ASSERT_EQ(expected_data.length(), raw_length);
+  if (compressor.empty()) {
+    ASSERT_TRUE(data.contents_equal(expected_data));
+  } else {
+    ASSERT_EQ("zlib", compressor);
+    ASSERT_GT(raw_length, data.length());
+
+    auto cct = reinterpret_cast<CephContext*>(ioctx.cct());
+    auto zlib = Compressor::create(cct, compressor);
+    ASSERT_TRUE(zlib);
+    bufferlist decompressed_data;
+    ASSERT_EQ(0, zlib->decompress(data, decompressed_data));
+    ASSERT_TRUE(decompressed_data.contents_equal(expected_data));
+  }
+
+  ASSERT_EQ(0, ioctx.remove(oid));
+  ioctx.close();
+}
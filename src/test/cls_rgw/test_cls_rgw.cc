@@ -444,6 +444,57 @@ TEST_F(cls_rgw, index_list)
 }
 
 
+TEST_F(cls_rgw, index_list_end_key)
+{
+  string bucket_oid = str_int("bucket", 8);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  uint64_t epoch = 1;
+  uint64_t obj_size = 1024;
+  const int num_objs = 10;
+
+  for (int i = 0; i < num_objs; i++) {
+    string obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc,
+		  0 /* bi_flags */, false /* log_op */);
+
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::None;
+    meta.size = obj_size;
+    index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, epoch, obj, meta,
+		   0 /* bi_flags */, false /* log_op */);
+  }
+
+  // the entries at or past end_key are left out
+  rgw_cls_list_ret result;
+  librados::ObjectReadOperation rop;
+  cls_rgw_obj_key start_key("obj-1", "");
+  cls_rgw_bucket_list_op(rop, start_key, string(), string(), 1000, false,
+			 &result, "obj-4");
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &rop, nullptr));
+  ASSERT_EQ(2u, result.dir.m.size());
+  ASSERT_EQ(1u, result.dir.m.count("obj-2"));
+  ASSERT_EQ(1u, result.dir.m.count("obj-3"));
+  ASSERT_TRUE(result.is_truncated);
+
+  // and the listing goes on from there
+  result = rgw_cls_list_ret();
+  librados::ObjectReadOperation rop2;
+  cls_rgw_obj_key start_key2("obj-3", "");
+  cls_rgw_bucket_list_op(rop2, start_key2, string(), string(), 1000, false,
+			 &result);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &rop2, nullptr));
+  ASSERT_EQ(6u, result.dir.m.size());
+  ASSERT_EQ("obj-4", result.dir.m.begin()->first);
+  ASSERT_FALSE(result.is_truncated);
+}
+
 /*
  * This case is used to test when bucket index list that includes a
  * delimiter can handle the first chunk ending in a delimiter.
@@ -1141,3 +1192,66 @@ TEST_F(cls_rgw, bi_log_trim)
     EXPECT_FALSE(truncated);
   }
 }
+
+TEST_F(cls_rgw, index_complete_ops)
+{
+  string bucket_oid = str_int("bucket", 100);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  uint64_t obj_size = 1024;
+  vector<rgw_cls_obj_complete_op> ops;
+  for (int i = 0; i < NUM_OBJS; i++) {
+    rgw_cls_obj_complete_op c;
+    c.op = CLS_RGW_OP_ADD;
+    c.key = str_int("obj", i);
+    c.tag = str_int("tag", i);
+    c.ver.pool = ioctx.get_id();
+    c.ver.epoch = 1;
+    c.meta.category = RGWObjCategory::None;
+    c.meta.size = c.meta.accounted_size = obj_size;
+    c.log_op = true;
+    string loc = str_int("loc", i);
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, c.tag, c.key, loc);
+    ops.push_back(c);
+  }
+  // an op without its prepare fails on its own
+  rgw_cls_obj_complete_op missing = ops.back();
+  missing.key = str_int("obj", NUM_OBJS);
+  ops.push_back(missing);
+
+  ObjectWriteOperation cop;
+  bufferlist out;
+  int rval = 0;
+  cls_rgw_bucket_complete_ops(cop, ops, &out, &rval);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &cop, librados::OPERATION_RETURNVEC));
+  ASSERT_EQ(0, rval);
+  vector<int32_t> results;
+  ASSERT_EQ(0, cls_rgw_bucket_complete_ops_decode(out, &results));
+  ASSERT_EQ(ops.size(), results.size());
+  for (int i = 0; i < NUM_OBJS; i++) {
+    ASSERT_EQ(0, results[i]);
+  }
+  ASSERT_EQ(-EINVAL, results[NUM_OBJS]);
+
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS,
+	     obj_size * NUM_OBJS);
+
+  // each op got its own bucket index log entry
+  cls_rgw_bi_log_list_ret bilog;
+  ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+  set<string> markers;
+  for (auto& e : bilog.entries) {
+    markers.insert(e.id);
+  }
+  ASSERT_EQ(bilog.entries.size(), markers.size());
+  ASSERT_EQ((size_t)NUM_OBJS, markers.size());
+
+  // the keys of a call must be distinct
+  ObjectWriteOperation dop;
+  vector<rgw_cls_obj_complete_op> dups = {ops[0], ops[0]};
+  cls_rgw_bucket_complete_ops(dop, dups);
+  ASSERT_EQ(-EINVAL, ioctx.operate(bucket_oid, &dop));
+}
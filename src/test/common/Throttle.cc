@@ -163,6 +163,26 @@ TEST_F(ThrottleTest, get_or_fail) {
   }
 }
 
+TEST_F(ThrottleTest, get_put_concurrent) {
+  // with more getters than max, most gets and puts race with waiters
+  // going to sleep: a lost wake up would hang here
+  Throttle throttle(g_ceph_context, "throttle", 2);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&throttle] {
+      for (int i = 0; i < 10000; ++i) {
+	throttle.get(1);
+	ASSERT_LE(throttle.get_current(), 2);
+	throttle.put(1);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(0, throttle.get_current());
+}
+
 TEST_F(ThrottleTest, wait) {
   int64_t throttle_max = 10;
   Throttle throttle(g_ceph_context, "throttle");
@@ -19,6 +19,7 @@
  *
  *
  */
+#include "common/ceph_context.h"
 #include "common/config_proxy.h"
 #include "common/errno.h"
 #include "gtest/gtest.h"
@@ -258,6 +259,30 @@ TEST(md_config_t, set_val)
   }
 }
 
+TEST(md_config_t, update_mon_vals)
+{
+  auto cct = new CephContext(CEPH_ENTITY_TYPE_CLIENT);
+  auto& conf = cct->_conf;
+  const auto mgr_osd_bytes = conf.get_val<Option::size_t>("mgr_osd_bytes");
+  EXPECT_EQ(0, conf.set_mon_vals(cct, {{"mgr_tick_period", "10"},
+				       {"mgr_osd_bytes", "512M"}}, nullptr));
+  EXPECT_EQ(10, conf.get_val<std::chrono::seconds>("mgr_tick_period").count());
+  EXPECT_EQ(Option::size_t{512 << 20},
+	    conf.get_val<Option::size_t>("mgr_osd_bytes"));
+
+  // the options not in the delta are left as they are
+  EXPECT_EQ(0, conf.update_mon_vals(cct, {{"mgr_tick_period", "20"}},
+				    {"mgr_osd_bytes"}, nullptr));
+  EXPECT_EQ(20, conf.get_val<std::chrono::seconds>("mgr_tick_period").count());
+  EXPECT_EQ(mgr_osd_bytes, conf.get_val<Option::size_t>("mgr_osd_bytes"));
+
+  // just as the full map would
+  EXPECT_EQ(0, conf.set_mon_vals(cct, {{"mgr_tick_period", "20"}}, nullptr));
+  EXPECT_EQ(20, conf.get_val<std::chrono::seconds>("mgr_tick_period").count());
+  EXPECT_EQ(mgr_osd_bytes, conf.get_val<Option::size_t>("mgr_osd_bytes"));
+  cct->put();
+}
+
 TEST(Option, validation)
 {
   Option opt_int("foo", Option::TYPE_INT, Option::LEVEL_BASIC);
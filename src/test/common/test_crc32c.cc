@@ -24,6 +24,22 @@ TEST(Crc32c, Small) {
   ASSERT_EQ(3743019208u, ceph_crc32c(5678, (unsigned char *)b, strlen(b)));
 }
 
+TEST(Crc32c, Combine) {
+  const char *a = "foo bar baz";
+  const char *b = "whiz bang boom, and then some more";
+  char ab[64];
+  strcpy(ab, a);
+  strcat(ab, b);
+  uint32_t crc_a = ceph_crc32c(1234, (unsigned char *)a, strlen(a));
+  uint32_t crc_b = ceph_crc32c(0, (unsigned char *)b, strlen(b));
+  ASSERT_EQ(ceph_crc32c(1234, (unsigned char *)ab, strlen(ab)),
+	    ceph_crc32c_combine(crc_a, crc_b, strlen(b)));
+  // rebase a crc to another initial value
+  uint32_t crc_b5 = ceph_crc32c(5678, (unsigned char *)b, strlen(b));
+  ASSERT_EQ(ceph_crc32c(99, (unsigned char *)b, strlen(b)),
+	    ceph_crc32c_combine(5678 ^ 99, crc_b5, strlen(b)));
+}
+
 TEST(Crc32c, PartialWord) {
   const char *a = (const char *)malloc(5);
   const char *b = (const char *)malloc(35);
@@ -11,9 +11,11 @@
 #include "crimson/net/Dispatcher.h"
 #include "crimson/net/Messenger.h"
 #include "crimson/net/Interceptor.h"
+#include "crimson/net/Socket.h"
 
 #include <map>
 #include <random>
+#include <boost/iterator/counting_iterator.hpp>
 #include <boost/program_options.hpp>
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -451,6 +453,118 @@ seastar::future<> test_preemptive_shutdown(bool v2) {
   });
 }
 
+// measure the bytes the receive path copies, for ops carrying data
+static seastar::future<> test_read_copies(unsigned ops, size_t op_size)
+{
+  struct test_state {
+    struct Server final
+      : public crimson::net::Dispatcher {
+      crimson::net::MessengerRef msgr;
+      crimson::auth::DummyAuthClientServer dummy_auth;
+      unsigned ops;
+      size_t op_size;
+      unsigned count = 0;
+      seastar::promise<> on_done;
+
+      Server(unsigned ops, size_t op_size) : ops{ops}, op_size{op_size} {}
+
+      seastar::future<> ms_dispatch(crimson::net::Connection* c,
+                                    MessageRef m) override {
+        if (m->get_data().length() != op_size) {
+          throw std::runtime_error("unexpected data length");
+        }
+        if (++count == ops) {
+          on_done.set_value();
+        }
+        return seastar::now();
+      }
+
+      seastar::future<> init(const entity_name_t& name,
+                             const std::string& lname,
+                             const uint64_t nonce,
+                             const entity_addr_t& addr) {
+        msgr = crimson::net::Messenger::create(name, lname, nonce);
+        msgr->set_default_policy(crimson::net::SocketPolicy::stateless_server(0));
+        msgr->set_auth_client(&dummy_auth);
+        msgr->set_auth_server(&dummy_auth);
+        return msgr->bind(entity_addrvec_t{addr}).then([this] {
+          return msgr->start(this);
+        });
+      }
+    };
+
+    struct Client final
+      : public crimson::net::Dispatcher {
+      crimson::net::MessengerRef msgr;
+      crimson::auth::DummyAuthClientServer dummy_auth;
+
+      seastar::future<> init(const entity_name_t& name,
+                             const std::string& lname,
+                             const uint64_t nonce) {
+        msgr = crimson::net::Messenger::create(name, lname, nonce);
+        msgr->set_default_policy(crimson::net::SocketPolicy::lossy_client(0));
+        msgr->set_auth_client(&dummy_auth);
+        msgr->set_auth_server(&dummy_auth);
+        return msgr->start(this);
+      }
+    };
+  };
+
+  logger().info("test_read_copies(ops={}, op_size={}):", ops, op_size);
+  auto server = seastar::make_shared<test_state::Server>(ops, op_size);
+  auto client = seastar::make_shared<test_state::Client>();
+  entity_addr_t addr;
+  addr.parse("127.0.0.1:9010", nullptr);
+  addr.set_type(entity_addr_t::TYPE_MSGR2);
+  addr.set_family(AF_INET);
+  return seastar::when_all_succeed(
+      server->init(entity_name_t::OSD(6), "server4", 7, addr),
+      client->init(entity_name_t::OSD(7), "client4", 8)
+  ).then([server, client, ops, op_size] {
+    auto conn = client->msgr->connect(server->msgr->get_myaddr(),
+                                      entity_name_t::TYPE_OSD);
+    const auto copied_before = crimson::net::Socket::get_read_bytes_copied();
+    const auto start = mono_clock::now();
+    return seastar::do_for_each(
+        boost::make_counting_iterator(0u),
+        boost::make_counting_iterator(ops),
+        [conn, op_size] (unsigned) {
+      pg_t pgid;
+      object_locator_t oloc;
+      hobject_t hobj(object_t(), oloc.key, CEPH_NOSNAP, pgid.ps(),
+                     pgid.pool(), oloc.nspace);
+      spg_t spgid(pgid);
+      auto m = make_message<MOSDOp>(0, 0, hobj, spgid, 0, 0, 0);
+      bufferlist data;
+      data.append_zero(op_size);
+      m->write(0, op_size, data);
+      return conn->send(m);
+    }).then([server] {
+      return server->on_done.get_future();
+    }).then([ops, op_size, copied_before, start] {
+      const auto copied =
+        crimson::net::Socket::get_read_bytes_copied() - copied_before;
+      const std::chrono::duration<double> elapsed = mono_clock::now() - start;
+      logger().info("test_read_copies(): {} bytes copied per op of {} bytes,"
+                    " {:.1f} MiB/s",
+                    copied / ops, op_size,
+                    ops * op_size / elapsed.count() / (1 << 20));
+      // only the preambles and epilogues of the frames may be copied
+      if (copied / ops >= op_size) {
+        throw std::runtime_error("the data of ops is copied");
+      }
+    });
+  }).finally([client] {
+    logger().info("client shutdown...");
+    return client->msgr->shutdown();
+  }).finally([server] {
+    logger().info("server shutdown...");
+    return server->msgr->shutdown();
+  }).finally([server, client] {
+    logger().info("test_read_copies() done!\n");
+  });
+}
+
 using ceph::msgr::v2::Tag;
 using crimson::net::bp_action_t;
 using crimson::net::bp_type_t;
@@ -3540,7 +3654,11 @@ int main(int argc, char** argv)
      "addresses of v2 failover testpeer"
      " (CmdSrv address and TestPeer address with port+=1)")
     ("v2-testpeer-islocal", bpo::value<bool>()->default_value(true),
-     "create a local crimson testpeer, or connect to a remote testpeer");
+     "create a local crimson testpeer, or connect to a remote testpeer")
+    ("copy-test-ops", bpo::value<unsigned>()->default_value(64),
+     "number of ops sent to measure the bytes copied when reading them")
+    ("copy-test-op-size", bpo::value<size_t>()->default_value(1 << 20),
+     "size of the data of these ops");
   return app.run(argc, argv, [&app] {
     std::vector<const char*> args;
     std::string cluster;
@@ -3564,6 +3682,8 @@ int main(int argc, char** argv)
       ceph_assert(v2_testpeer_addr.parse(
           config["v2-testpeer-addr"].as<std::string>().c_str(), nullptr));
       auto v2_testpeer_islocal = config["v2-testpeer-islocal"].as<bool>();
+      auto copy_test_ops = config["copy-test-ops"].as<unsigned>();
+      auto copy_test_op_size = config["copy-test-op-size"].as<size_t>();
       return test_echo(rounds, keepalive_ratio, false)
       .then([rounds, keepalive_ratio] {
         return test_echo(rounds, keepalive_ratio, true);
@@ -3575,6 +3695,8 @@ int main(int argc, char** argv)
         return test_preemptive_shutdown(false);
       }).then([] {
         return test_preemptive_shutdown(true);
+      }).then([copy_test_ops, copy_test_op_size] {
+        return test_read_copies(copy_test_ops, copy_test_op_size);
       }).then([v2_test_addr, v2_testpeer_addr, v2_testpeer_islocal] {
         return test_v2_protocol(v2_test_addr, v2_testpeer_addr, v2_testpeer_islocal);
       }).then([] {
@@ -656,3 +656,41 @@ TEST_F(CRUSHTest, straw2_reweight) {
     cout << "     vs " << estddev << std::endl;
   }
 }
+
+TEST_F(CRUSHTest, straw2_simd) {
+  // the vector draws must pick exactly what the scalar ones pick, also
+  // for the tail of a bucket that is not a multiple of the batch size
+  // and for zero weight items
+  for (int n : {7, 8, 45, 64}) {
+    std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+    c->set_type_name(1, "root");
+    c->set_type_name(0, "osd");
+    vector<int> items(n), weights(n);
+    for (int i = 0; i < n; ++i) {
+      items[i] = i;
+      weights[i] = (i % 5 == 3) ? 0 : 0x10000 * (1 + i % 4) + i;
+    }
+    c->set_max_devices(n);
+    int root;
+    crush_bucket *b = crush_make_bucket(c->get_crush_map(),
+					CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+					1, n, &items[0], &weights[0]);
+    ASSERT_EQ(0, crush_add_bucket(c->get_crush_map(), 0, b, &root));
+    ASSERT_EQ(0, c->set_item_name(root, "root"));
+    int rule = c->add_simple_rule("rule", "root", "osd", "",
+				  "firstn", pg_pool_t::TYPE_REPLICATED);
+    ASSERT_EQ(0, rule);
+    c->finalize();
+
+    vector<__u32> reweight(n, 0x10000);
+    for (int x = 0; x < 100000; ++x) {
+      vector<int> out0, out1;
+      crush_straw2_simd = 1;
+      c->do_rule(rule, x, out0, 3, reweight, 0);
+      crush_straw2_simd = 0;
+      c->do_rule(rule, x, out1, 3, reweight, 0);
+      ASSERT_EQ(out0, out1) << "n " << n << " x " << x;
+    }
+    crush_straw2_simd = 1;
+  }
+}
@@ -366,6 +366,65 @@ TEST_F(IsaErasureCodeTest, encode)
   }
 }
 
+TEST_F(IsaErasureCodeTest, apply_delta)
+{
+  ErasureCodeIsaDefault Isa(tcache);
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  Isa.init(profile, &cerr);
+
+  unsigned object_size = Isa.get_chunk_size(4096) * 4;
+  unsigned chunk_size = object_size / 4;
+  string payload;
+  for (unsigned i = 0; i < object_size; i++)
+    payload.push_back(rand());
+  bufferlist in;
+  in.append(payload);
+  set<int> want_to_encode = { 0, 1, 2, 3, 4, 5 };
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+
+  // change the first and the third data chunk
+  for (unsigned i = 0; i < chunk_size; i += 7) {
+    payload[i] ^= 0x11;
+    payload[2 * chunk_size + i] ^= 0xee;
+  }
+  bufferlist changed;
+  changed.append(payload);
+  map<int, bufferlist> reencoded;
+  EXPECT_EQ(0, Isa.encode(want_to_encode, changed, &reencoded));
+
+  map<int, bufferlist> deltas;
+  for (int i : { 0, 2 })
+    EXPECT_EQ(0, Isa.encode_delta(encoded[i], reencoded[i], &deltas[i]));
+
+  // all coding chunks at once
+  {
+    map<int, bufferlist> coding;
+    for (int i = 4; i < 6; i++)
+      coding[i].append(encoded[i].c_str(), chunk_size);
+    EXPECT_EQ(0, Isa.apply_delta(deltas, &coding));
+    for (int i = 4; i < 6; i++)
+      EXPECT_TRUE(coding[i].contents_equal(reencoded[i]));
+  }
+
+  // just one of them
+  {
+    map<int, bufferlist> coding;
+    coding[5].append(encoded[5].c_str(), chunk_size);
+    EXPECT_EQ(0, Isa.apply_delta(deltas, &coding));
+    EXPECT_TRUE(coding[5].contents_equal(reencoded[5]));
+  }
+
+  // a data chunk is not a coding chunk
+  {
+    map<int, bufferlist> coding;
+    coding[1].append(encoded[1].c_str(), chunk_size);
+    EXPECT_EQ(-EINVAL, Isa.apply_delta(deltas, &coding));
+  }
+}
+
 TEST_F(IsaErasureCodeTest, sanity_check_k)
 {
   ErasureCodeIsaDefault Isa(tcache);
@@ -776,6 +835,42 @@ TEST_F(IsaErasureCodeTest, isa_cauchy_cache_trash)
   EXPECT_EQ(2516, tcache.getDecodingTableCacheSize(ErasureCodeIsaDefault::kCauchy));
 }
 
+TEST_F(IsaErasureCodeTest, isa_cache_shared_k_m)
+{
+  // the same erasures of codes with a different m have the same
+  // signature but need their own decoding tables
+  ErasureCodeIsaTableCache cache;
+  for (const char* m : { "2", "3" }) {
+    ErasureCodeIsaDefault Isa(cache);
+    ErasureCodeProfile profile;
+    profile["k"] = "3";
+    profile["m"] = m;
+    Isa.init(profile, &cerr);
+
+    string payload(Isa.get_chunk_size(4096) * 3, 'X');
+    for (unsigned i = 0; i < payload.length(); i++)
+      payload[i] = rand();
+    bufferlist in;
+    in.append(payload);
+    set<int> want_to_encode;
+    for (unsigned i = 0; i < Isa.get_chunk_count(); i++)
+      want_to_encode.insert(i);
+    map<int, bufferlist> encoded;
+    EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+
+    // decode the first chunk from the following three, twice
+    for (int round = 0; round < 2; round++) {
+      map<int, bufferlist> degraded;
+      for (int i : { 1, 2, 3 })
+        degraded[i] = encoded[i];
+      map<int, bufferlist> decoded;
+      EXPECT_EQ(0, Isa._decode(set<int>{0}, degraded, &decoded));
+      EXPECT_TRUE(decoded[0].contents_equal(encoded[0]));
+    }
+  }
+  EXPECT_EQ(2, cache.getDecodingTableCacheSize());
+}
+
 TEST_F(IsaErasureCodeTest, isa_xor_codec)
 {
   // Test all possible failure scenarios and reconstruction cases for
@@ -129,6 +129,43 @@ TYPED_TEST(ErasureCodeTest, encode_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, apply_delta)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  unsigned object_size = jerasure.get_chunk_size(2048) * 2;
+  string payload;
+  for (unsigned i = 0; i < object_size; i++)
+    payload.push_back(rand());
+  bufferlist in;
+  in.append(payload);
+  set<int> want_to_encode = { 0, 1, 2, 3 };
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+
+  // change the second data chunk
+  for (unsigned i = object_size / 2; i < object_size; i += 3)
+    payload[i] ^= 0x5a;
+  bufferlist changed;
+  changed.append(payload);
+  map<int, bufferlist> reencoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, changed, &reencoded));
+
+  map<int, bufferlist> deltas;
+  EXPECT_EQ(0, jerasure.encode_delta(encoded[1], reencoded[1], &deltas[1]));
+  map<int, bufferlist> coding;
+  for (int i = 2; i < 4; i++)
+    coding[i].append(encoded[i].c_str(), encoded[i].length());
+  EXPECT_EQ(0, jerasure.apply_delta(deltas, &coding));
+  for (int i = 2; i < 4; i++)
+    EXPECT_TRUE(coding[i].contents_equal(reencoded[i]));
+}
+
 TYPED_TEST(ErasureCodeTest, minimum_to_decode)
 {
   TypeParam jerasure;
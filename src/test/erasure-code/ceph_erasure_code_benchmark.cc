@@ -50,7 +50,7 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run either encode, decode or delta")
     ("erasures,e", po::value<int>()->default_value(1),
      "number of erasures when decoding")
     ("erased", po::value<vector<int> >(),
@@ -149,6 +149,8 @@ int ErasureCodeBench::run() {
 
   if (workload == "encode")
     return encode();
+  else if (workload == "delta")
+    return delta();
   else
     return decode();
 }
@@ -185,6 +187,59 @@ int ErasureCodeBench::encode()
   return 0;
 }
 
+int ErasureCodeBench::delta()
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf().get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+
+  bufferlist in;
+  in.append(string(in_size, 'X'));
+  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  set<int> want_to_encode;
+  for (int i = 0; i < k + m; i++) {
+    want_to_encode.insert(i);
+  }
+  map<int,bufferlist> encoded;
+  code = erasure_code->encode(want_to_encode, in, &encoded);
+  if (code)
+    return code;
+  map<int,bufferlist> coding;
+  for (int i = k; i < k + m; i++) {
+    unsigned chunk = erasure_code->get_chunk_mapping().size() > (unsigned)i ?
+      erasure_code->get_chunk_mapping()[i] : i;
+    coding[chunk] = encoded[chunk];
+  }
+
+  // overwrite the whole of the first data chunk, over and over
+  unsigned chunk = erasure_code->get_chunk_mapping().size() ?
+    erasure_code->get_chunk_mapping()[0] : 0;
+  bufferlist new_data;
+  new_data.append(string(encoded[chunk].length(), 'Y'));
+  new_data.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  utime_t begin_time = ceph_clock_now();
+  for (int i = 0; i < max_iterations; i++) {
+    map<int,bufferlist> deltas;
+    code = erasure_code->encode_delta(encoded[chunk], new_data, &deltas[chunk]);
+    if (code)
+      return code;
+    code = erasure_code->apply_delta(deltas, &coding);
+    if (code)
+      return code;
+  }
+  utime_t end_time = ceph_clock_now();
+  cout << (end_time - begin_time) << "\t"
+       << (max_iterations * (new_data.length() / 1024)) << endl;
+  return 0;
+}
+
 static void display_chunks(const map<int,bufferlist> &chunks,
 			   unsigned int chunk_count) {
   cout << "chunks ";
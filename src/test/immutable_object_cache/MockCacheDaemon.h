@@ -25,6 +25,7 @@ class MockCacheClient {
   MOCK_METHOD0(connect, int());
   MOCK_METHOD1(connect, void(Context*));
   void lookup_object(std::string pool_nspace, uint64_t pool_id, uint64_t snap_id,
+              uint64_t object_off, uint64_t object_len,
               std::string oid, CacheGenContextURef&& on_finish) {
     // gmock don't support move
     internal_lookup(pool_nspace, pool_id, snap_id, oid);
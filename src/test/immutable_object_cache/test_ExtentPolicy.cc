@@ -0,0 +1,162 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <list>
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include "common/Formatter.h"
+#include "global/global_context.h"
+#include "tools/immutable_object_cache/ExtentPolicy.h"
+
+using namespace ceph::immutable_obj_cache;
+
+class TestExtentPolicy :public ::testing::Test {
+public:
+  static const uint64_t BLOCK_SIZE = 4;
+  ExtentPolicy* m_policy = nullptr;
+
+  void SetUp() override {
+    create_policy(64, 2);
+  }
+  void TearDown() override {
+    delete m_policy;
+  }
+
+  void create_policy(uint64_t cache_size, uint64_t admission_threshold) {
+    delete m_policy;
+    m_policy = new ExtentPolicy(g_ceph_context, cache_size, 128, 0.1,
+                                BLOCK_SIZE, admission_threshold);
+  }
+
+  void promote(const std::string& file_name, uint64_t off, uint64_t len,
+               uint64_t size) {
+    uint64_t promote_off;
+    uint64_t promote_len;
+    m_policy->get_promote_extent(off, len, &promote_off, &promote_len);
+    m_policy->update_extent_status(file_name, OBJ_CACHE_PROMOTED, size,
+                                   promote_off, promote_len);
+  }
+};
+
+TEST_F(TestExtentPolicy, Admission) {
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_extent("image.0", 0, 4));
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->get_status("image.0"));
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 0, 4));
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->get_status("image.0"));
+  ASSERT_EQ(1U, m_policy->get_promoting_entry_num());
+
+  create_policy(64, 1);
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 0, 4));
+}
+
+TEST_F(TestExtentPolicy, PartialObject) {
+  create_policy(64, 1);
+
+  uint64_t promote_off;
+  uint64_t promote_len;
+  m_policy->get_promote_extent(5, 2, &promote_off, &promote_len);
+  ASSERT_EQ(4U, promote_off);
+  ASSERT_EQ(4U, promote_len);
+
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 5, 2));
+  // the extent is under promoting
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_extent("image.0", 6, 4));
+  promote("image.0", 5, 2, 4);
+  ASSERT_EQ(0U, m_policy->get_promoting_entry_num());
+  ASSERT_EQ(4U, m_policy->get_cache_size());
+  ASSERT_FALSE(m_policy->is_complete("image.0"));
+
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image.0", 4, 4));
+  // the blocks missed of an admitted object are promoted at once
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 6, 4));
+  promote("image.0", 6, 4, 8);
+  ASSERT_EQ(8U, m_policy->get_cache_size());
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image.0", 4, 8));
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 0, 8));
+}
+
+TEST_F(TestExtentPolicy, ObjectEnd) {
+  create_policy(64, 1);
+
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 0, 8));
+  // the object is 6 bytes long
+  promote("image.0", 0, 8, 6);
+  ASSERT_EQ(6U, m_policy->get_cache_size());
+  ASSERT_TRUE(m_policy->is_complete("image.0"));
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image.0", 4, 8));
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image.0", 16, 4));
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_object("image.0"));
+
+  // a whole object promotion
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_object("image.1"));
+  promote("image.1", 0, 0, 10);
+  ASSERT_TRUE(m_policy->is_complete("image.1"));
+  ASSERT_EQ(16U, m_policy->get_cache_size());
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image.1", 8, 4));
+}
+
+TEST_F(TestExtentPolicy, PromoteFailed) {
+  create_policy(64, 1);
+
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 0, 4));
+  m_policy->update_extent_status("image.0", OBJ_CACHE_NONE, 0, 0, 4);
+  ASSERT_EQ(0U, m_policy->get_promoting_entry_num());
+  ASSERT_EQ(0U, m_policy->get_promoted_entry_num());
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->get_status("image.0"));
+}
+
+TEST_F(TestExtentPolicy, Evict) {
+  create_policy(30, 1);
+
+  // a small object read often and a large one read once
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.0", 0, 4));
+  promote("image.0", 0, 4, 4);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image.0", 0, 4));
+  }
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.1", 0, 16));
+  promote("image.1", 0, 16, 16);
+
+  std::list<std::string> evict_list;
+  m_policy->get_evict_list(&evict_list);
+  ASSERT_TRUE(evict_list.empty());
+
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.2", 0, 8));
+  promote("image.2", 0, 8, 8);
+  ASSERT_EQ(28U, m_policy->get_cache_size());
+
+  // the objects being promoted are not evicted
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image.2", 8, 4));
+  m_policy->get_evict_list(&evict_list);
+  ASSERT_EQ(std::list<std::string>{"image.1"}, evict_list);
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_extent("image.1", 0, 4));
+  m_policy->evict_entry("image.1");
+  ASSERT_EQ(12U, m_policy->get_cache_size());
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->get_status("image.1"));
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image.0", 0, 4));
+  promote("image.2", 8, 4, 4);
+}
+
+TEST_F(TestExtentPolicy, ImageStats) {
+  create_policy(64, 1);
+
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image_a.0", 0, 4));
+  promote("image_a.0", 0, 4, 4);
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_extent("image_a.0", 0, 4));
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_extent("image_b.1", 0, 2));
+
+  JSONFormatter f;
+  f.open_object_section("status");
+  m_policy->dump(&f);
+  f.close_section();
+  std::ostringstream oss;
+  f.flush(oss);
+  ASSERT_NE(std::string::npos, oss.str().find(
+    "{\"image\":\"image_a\",\"hits\":1,\"misses\":1,\"hit_bytes\":4,"
+    "\"miss_bytes\":4,\"promoted_bytes\":4,\"evicted_bytes\":0}"));
+  ASSERT_NE(std::string::npos, oss.str().find(
+    "{\"image\":\"image_b\",\"hits\":0,\"misses\":1,\"hit_bytes\":0,"
+    "\"miss_bytes\":2,\"promoted_bytes\":0,\"evicted_bytes\":0}"));
+  m_policy->update_extent_status("image_b.1", OBJ_CACHE_NONE, 0, 0, 4);
+}
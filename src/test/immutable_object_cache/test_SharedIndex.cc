@@ -0,0 +1,104 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "global/global_context.h"
+#include "tools/immutable_object_cache/SharedIndex.h"
+#include "tools/immutable_object_cache/Utils.h"
+
+using namespace ceph::immutable_obj_cache;
+
+class TestSharedIndex : public ::testing::Test {
+public:
+  std::string m_path;
+
+  void SetUp() override {
+    m_path = "/tmp/test_shared_index." + std::to_string(getpid());
+  }
+  void TearDown() override {
+    ::unlink(m_path.c_str());
+  }
+};
+
+TEST_F(TestSharedIndex, Lookup) {
+  SharedIndex index(g_ceph_context, m_path);
+  ASSERT_EQ(0, index.create("/tmp/cache/", 16));
+
+  SharedIndex client_index(g_ceph_context, m_path);
+  ASSERT_EQ(0, client_index.open());
+  ASSERT_TRUE(client_index.is_open());
+
+  std::string name = get_cache_file_name("ns", 1, 2, "object");
+  std::string file_path;
+  ASSERT_FALSE(client_index.lookup(name, &file_path));
+
+  index.insert(name);
+  ASSERT_TRUE(client_index.lookup(name, &file_path));
+  ASSERT_EQ("/tmp/cache/" + get_cache_file_dir(name) + name, file_path);
+  ASSERT_FALSE(client_index.lookup(get_cache_file_name("ns", 1, 3, "object"),
+                                   &file_path));
+
+  index.remove(name);
+  ASSERT_FALSE(client_index.lookup(name, &file_path));
+
+  // removed slots are reused
+  index.insert(name);
+  ASSERT_TRUE(client_index.lookup(name, &file_path));
+}
+
+TEST_F(TestSharedIndex, Full) {
+  SharedIndex index(g_ceph_context, m_path);
+  ASSERT_EQ(0, index.create("/tmp/cache/", 4));
+
+  SharedIndex client_index(g_ceph_context, m_path);
+  ASSERT_EQ(0, client_index.open());
+
+  std::string file_path;
+  for (int i = 0; i < 5; ++i) {
+    index.insert(get_cache_file_name("", 1, 2, std::to_string(i)));
+  }
+  int found = 0;
+  for (int i = 0; i < 5; ++i) {
+    if (client_index.lookup(get_cache_file_name("", 1, 2, std::to_string(i)),
+                            &file_path)) {
+      ++found;
+    }
+  }
+  ASSERT_EQ(4, found);
+}
+
+TEST_F(TestSharedIndex, Stale) {
+  SharedIndex index(g_ceph_context, m_path);
+  ASSERT_EQ(0, index.create("/tmp/cache/", 16));
+  std::string name = get_cache_file_name("", 1, 2, "object");
+  index.insert(name);
+
+  SharedIndex client_index(g_ceph_context, m_path);
+  ASSERT_EQ(0, client_index.open());
+  std::string file_path;
+  ASSERT_TRUE(client_index.lookup(name, &file_path));
+
+  // the daemon restarted with an empty index
+  SharedIndex new_index(g_ceph_context, m_path);
+  ASSERT_EQ(0, new_index.create("/tmp/cache/", 16));
+  index.close();
+
+  ASSERT_FALSE(client_index.lookup(name, &file_path));
+  ASSERT_FALSE(client_index.is_open());
+
+  ASSERT_EQ(0, client_index.open());
+  ASSERT_FALSE(client_index.lookup(name, &file_path));
+  new_index.insert(name);
+  ASSERT_TRUE(client_index.lookup(name, &file_path));
+}
+
+TEST_F(TestSharedIndex, OpenInvalid) {
+  SharedIndex client_index(g_ceph_context, m_path);
+  ASSERT_EQ(-ENOENT, client_index.open());
+  ASSERT_FALSE(client_index.is_open());
+
+  SharedIndex index(g_ceph_context, m_path);
+  ASSERT_EQ(-EINVAL, index.create("/tmp/cache/", 0));
+}
@@ -270,6 +270,52 @@ TEST_F(TestObjectRecorder, AppendFlushByAge) {
   ASSERT_EQ(0U, object->get_pending_appends());
 }
 
+TEST_F(TestObjectRecorder, AppendAdaptiveBatching) {
+  std::string oid = get_temp_oid();
+  ASSERT_EQ(0, create(oid));
+  ASSERT_EQ(0, client_register(oid));
+  auto metadata = create_metadata(oid);
+  ASSERT_EQ(0, init_metadata(metadata));
+
+  ceph::mutex lock = ceph::make_mutex("object_recorder_lock");
+  ObjectRecorderFlusher flusher(m_ioctx, m_work_queue, 0, 0, 0, 0);
+  auto object = flusher.create_object(oid, 24, &lock);
+  lock.lock();
+  object->set_adaptive_batching(true);
+  lock.unlock();
+
+  // sent right away without an append in flight
+  journal::AppendBuffer append_buffer1 = create_append_buffer(234, 123,
+                                                              "payload");
+  journal::AppendBuffers append_buffers;
+  append_buffers = {append_buffer1};
+  lock.lock();
+  ASSERT_FALSE(object->append(std::move(append_buffers)));
+  lock.unlock();
+  ASSERT_EQ(0U, object->get_pending_appends());
+
+  // many more appends are expected while one is in flight
+  lock.lock();
+  auto append_stats = object->get_append_stats();
+  append_stats.append_interval = 0.0001;
+  append_stats.append_latency = 10;
+  object->set_append_stats(append_stats);
+  lock.unlock();
+
+  journal::AppendBuffer append_buffer2 = create_append_buffer(234, 124,
+                                                              "payload");
+  append_buffers = {append_buffer2};
+  lock.lock();
+  ASSERT_FALSE(object->append(std::move(append_buffers)));
+  lock.unlock();
+  ASSERT_GE(1U, object->get_pending_appends());
+
+  C_SaferCond cond;
+  append_buffer2.first->flush(&cond);
+  ASSERT_EQ(0, cond.wait());
+  ASSERT_EQ(0U, object->get_pending_appends());
+}
+
 TEST_F(TestObjectRecorder, AppendFilledObject) {
   std::string oid = get_temp_oid();
   ASSERT_EQ(0, create(oid));
@@ -1333,6 +1333,25 @@ int cls_cxx_map_get_vals(cls_method_context_t hctx, const string &start_obj,
   return vals->size();
 }
 
+int cls_cxx_map_iterate(cls_method_context_t hctx, const string &start_after,
+                        const string &filter_prefix, uint64_t max_to_get,
+                        const cls_map_iterate_cb_t& f, bool *more) {
+  std::map<string, bufferlist> vals;
+  int r = cls_cxx_map_get_vals(hctx, start_after, filter_prefix, max_to_get,
+                               &vals, more);
+  if (r < 0) {
+    return r;
+  }
+  int num = 0;
+  for (auto& [key, val] : vals) {
+    ++num;
+    if (!f(key, val)) {
+      break;
+    }
+  }
+  return num;
+}
+
 int cls_cxx_map_remove_key(cls_method_context_t hctx, const string &key) {
   std::set<std::string> keys;
   keys.insert(key);
@@ -0,0 +1,268 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "test/librbd/mock/MockExclusiveLock.h"
+#include "test/librbd/mock/MockObjectMap.h"
+#include "include/rbd/librbd.hpp"
+#include "librbd/cache/ReadCacheObjectDispatch.h"
+
+namespace librbd {
+namespace {
+
+struct MockTestImageCtx : public MockImageCtx {
+  MockTestImageCtx(ImageCtx &image_ctx) : MockImageCtx(image_ctx) {
+  }
+};
+
+} // anonymous namespace
+} // namespace librbd
+
+#include "librbd/cache/ReadCacheObjectDispatch.cc"
+
+namespace librbd {
+namespace cache {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+struct TestMockCacheReadCacheObjectDispatch : public TestMockFixture {
+  typedef ReadCacheObjectDispatch<librbd::MockTestImageCtx> MockReadCacheObjectDispatch;
+
+  void expect_op_work_queue(MockTestImageCtx& mock_image_ctx) {
+    EXPECT_CALL(*mock_image_ctx.op_work_queue, queue(_, _))
+      .WillRepeatedly(Invoke([](Context* ctx, int r) {
+                        ctx->complete(r);
+                      }));
+  }
+
+  void expect_register_object_dispatch(MockTestImageCtx& mock_image_ctx) {
+    EXPECT_CALL(*mock_image_ctx.io_object_dispatcher,
+                register_object_dispatch(_));
+  }
+
+  void expect_accept_ops(MockExclusiveLock& mock_exclusive_lock,
+                         bool accept) {
+    EXPECT_CALL(mock_exclusive_lock, accept_ops())
+      .WillRepeatedly(Return(accept));
+  }
+
+  void init(MockTestImageCtx& mock_image_ctx,
+            MockReadCacheObjectDispatch& object_dispatch) {
+    expect_op_work_queue(mock_image_ctx);
+    expect_register_object_dispatch(mock_image_ctx);
+    object_dispatch.init();
+  }
+
+  void shut_down(MockReadCacheObjectDispatch& object_dispatch) {
+    C_SaferCond ctx;
+    object_dispatch.shut_down(&ctx);
+    ASSERT_EQ(0, ctx.wait());
+  }
+
+  void read_miss(MockReadCacheObjectDispatch& object_dispatch,
+                 uint64_t object_off, const std::string& data) {
+    ceph::bufferlist read_data;
+    io::ExtentMap extent_map;
+    io::DispatchResult dispatch_result;
+    C_SaferCond finish_ctx;
+    C_SaferCond dispatch_ctx;
+    Context* finish_ctx_ptr = &finish_ctx;
+    ASSERT_FALSE(object_dispatch.read(0, object_off, data.length(),
+                                      CEPH_NOSNAP, 0, {}, &read_data,
+                                      &extent_map, nullptr, &dispatch_result,
+                                      &finish_ctx_ptr, &dispatch_ctx));
+    ASSERT_NE(finish_ctx_ptr, &finish_ctx);
+
+    read_data.append(data);
+    finish_ctx_ptr->complete(0);
+    ASSERT_EQ(0, finish_ctx.wait());
+  }
+
+  void read_hit(MockReadCacheObjectDispatch& object_dispatch,
+                uint64_t object_off, const std::string& data) {
+    ceph::bufferlist read_data;
+    io::ExtentMap extent_map;
+    io::DispatchResult dispatch_result;
+    C_SaferCond finish_ctx;
+    C_SaferCond dispatch_ctx;
+    Context* finish_ctx_ptr = &finish_ctx;
+    ASSERT_TRUE(object_dispatch.read(0, object_off, data.length(),
+                                     CEPH_NOSNAP, 0, {}, &read_data,
+                                     &extent_map, nullptr, &dispatch_result,
+                                     &finish_ctx_ptr, &dispatch_ctx));
+    ASSERT_EQ(io::DISPATCH_RESULT_COMPLETE, dispatch_result);
+    ASSERT_EQ(0, dispatch_ctx.wait());
+    ASSERT_EQ(data, read_data.to_str());
+  }
+};
+
+TEST_F(TestMockCacheReadCacheObjectDispatch, ReadHit) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_accept_ops(mock_exclusive_lock, true);
+
+  MockReadCacheObjectDispatch object_dispatch(&mock_image_ctx);
+  init(mock_image_ctx, object_dispatch);
+
+  std::string data(8192, '1');
+  // the first read only validates the cache
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 0, data);
+  read_hit(object_dispatch, 0, data);
+  read_hit(object_dispatch, 1024, data.substr(0, 4096));
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheReadCacheObjectDispatch, ReadPartialBlocks) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_accept_ops(mock_exclusive_lock, true);
+
+  MockReadCacheObjectDispatch object_dispatch(&mock_image_ctx);
+  init(mock_image_ctx, object_dispatch);
+
+  std::string data(8192, '1');
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 1024, data);
+  read_hit(object_dispatch, 4096, std::string(4096, '1'));
+  read_miss(object_dispatch, 0, data);
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheReadCacheObjectDispatch, WriteInvalidates) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_accept_ops(mock_exclusive_lock, true);
+
+  MockReadCacheObjectDispatch object_dispatch(&mock_image_ctx);
+  init(mock_image_ctx, object_dispatch);
+
+  std::string data(8192, '1');
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 0, data);
+
+  ceph::bufferlist write_data;
+  write_data.append(std::string(512, '2'));
+  io::DispatchResult dispatch_result;
+  C_SaferCond finish_ctx;
+  C_SaferCond dispatch_ctx;
+  Context* finish_ctx_ptr = &finish_ctx;
+  ASSERT_FALSE(object_dispatch.write(0, 4096, std::move(write_data), {}, 0,
+                                     {}, nullptr, nullptr, &dispatch_result,
+                                     &finish_ctx_ptr, &dispatch_ctx));
+  ASSERT_NE(finish_ctx_ptr, &finish_ctx);
+  finish_ctx_ptr->complete(0);
+  ASSERT_EQ(0, finish_ctx.wait());
+
+  read_hit(object_dispatch, 0, std::string(4096, '1'));
+  read_miss(object_dispatch, 4096, std::string(4096, '2'));
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheReadCacheObjectDispatch, InvalidateCache) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_accept_ops(mock_exclusive_lock, true);
+
+  MockReadCacheObjectDispatch object_dispatch(&mock_image_ctx);
+  init(mock_image_ctx, object_dispatch);
+
+  std::string data(4096, '1');
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 0, data);
+
+  ASSERT_FALSE(object_dispatch.invalidate_cache(nullptr));
+
+  // the cache is validated again before it is filled
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 0, data);
+  read_hit(object_dispatch, 0, data);
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheReadCacheObjectDispatch, NotLockOwner) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_accept_ops(mock_exclusive_lock, false);
+
+  MockReadCacheObjectDispatch object_dispatch(&mock_image_ctx);
+  init(mock_image_ctx, object_dispatch);
+
+  std::string data(4096, '1');
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 0, data);
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheReadCacheObjectDispatch, ObjectDoesNotExist) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_accept_ops(mock_exclusive_lock, true);
+  MockObjectMap mock_object_map;
+  mock_image_ctx.object_map = &mock_object_map;
+  EXPECT_CALL(mock_object_map, object_may_exist(0))
+    .WillOnce(Return(true))
+    .WillOnce(Return(true))
+    .WillOnce(Return(false))
+    .WillOnce(Return(true));
+
+  MockReadCacheObjectDispatch object_dispatch(&mock_image_ctx);
+  init(mock_image_ctx, object_dispatch);
+
+  std::string data(4096, '1');
+  read_miss(object_dispatch, 0, data);
+  read_miss(object_dispatch, 0, data);
+
+  ceph::bufferlist read_data;
+  io::ExtentMap extent_map;
+  io::DispatchResult dispatch_result;
+  C_SaferCond finish_ctx;
+  C_SaferCond dispatch_ctx;
+  Context* finish_ctx_ptr = &finish_ctx;
+  ASSERT_FALSE(object_dispatch.read(0, 0, 4096, CEPH_NOSNAP, 0, {},
+                                    &read_data, &extent_map, nullptr,
+                                    &dispatch_result, &finish_ctx_ptr,
+                                    &dispatch_ctx));
+  ASSERT_EQ(finish_ctx_ptr, &finish_ctx);
+
+  read_miss(object_dispatch, 0, data);
+
+  shut_down(object_dispatch);
+}
+
+} // namespace cache
+} // namespace librbd
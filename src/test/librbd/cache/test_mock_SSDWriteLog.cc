@@ -0,0 +1,308 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <iostream>
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "include/rbd/librbd.hpp"
+#include "librbd/cache/rwl/ImageCacheState.h"
+#include "librbd/cache/ImageWriteback.h"
+#include "librbd/cache/SSDWriteLog.h"
+
+
+namespace librbd {
+namespace {
+
+struct MockContextSSD : public C_SaferCond  {
+  MOCK_METHOD1(complete, void(int));
+  MOCK_METHOD1(finish, void(int));
+
+  void do_complete(int r) {
+    C_SaferCond::complete(r);
+  }
+};
+
+} // anonymous namespace
+
+namespace util {
+
+inline ImageCtx *get_image_ctx(MockImageCtx *image_ctx) {
+  return image_ctx->image_ctx;
+}
+
+} // namespace util
+} // namespace librbd
+
+#include "librbd/cache/SSDWriteLog.cc"
+
+// template definitions
+#include "librbd/cache/ImageWriteback.cc"
+#include "librbd/cache/rwl/ImageCacheState.cc"
+
+template class librbd::cache::ImageWriteback<librbd::MockImageCtx>;
+template class librbd::cache::rwl::ImageCacheState<librbd::MockImageCtx>;
+
+namespace librbd {
+namespace cache {
+
+using ::testing::_;
+using ::testing::Invoke;
+
+struct TestMockCacheSSDWriteLog : public TestMockFixture {
+  typedef SSDWriteLog<librbd::MockImageCtx> MockSSDWriteLog;
+  typedef io::Extents Extents;
+  typedef librbd::cache::rwl::ImageCacheState<librbd::MockImageCtx> MockImageCacheState;
+
+  MockImageCacheState *get_cache_state(MockImageCtx& mock_image_ctx) {
+    return new MockImageCacheState(&mock_image_ctx);
+  }
+
+  void expect_op_work_queue(MockImageCtx& mock_image_ctx) {
+    EXPECT_CALL(*mock_image_ctx.op_work_queue, queue(_, _))
+      .WillRepeatedly(Invoke([](Context* ctx, int r) {
+                        ctx->complete(r);
+                      }));
+  }
+
+  void expect_context_complete(MockContextSSD& mock_context, int r) {
+    EXPECT_CALL(mock_context, complete(r))
+      .WillRepeatedly(Invoke([&mock_context](int r) {
+                        mock_context.do_complete(r);
+                      }));
+  }
+
+  void expect_metadata_set(MockImageCtx& mock_image_ctx) {
+    EXPECT_CALL(*mock_image_ctx.operations, execute_metadata_set(_, _, _))
+      .WillRepeatedly(Invoke([](std::string key, std::string val, Context* ctx) {
+                        ctx->complete(0);
+                      }));
+  }
+
+  void init(MockSSDWriteLog &ssd) {
+    MockContextSSD finish_ctx;
+    expect_context_complete(finish_ctx, 0);
+    ssd.init(&finish_ctx);
+    ASSERT_EQ(0, finish_ctx.wait());
+  }
+
+  void shut_down(MockSSDWriteLog &ssd) {
+    MockContextSSD finish_ctx;
+    expect_context_complete(finish_ctx, 0);
+    ssd.shut_down(&finish_ctx);
+    ASSERT_EQ(0, finish_ctx.wait());
+  }
+
+  void write(MockSSDWriteLog &ssd, Extents &&image_extents,
+             bufferlist bl) {
+    MockContextSSD finish_ctx;
+    expect_context_complete(finish_ctx, 0);
+    ssd.aio_write(std::move(image_extents), std::move(bl), 0, &finish_ctx);
+    ASSERT_EQ(0, finish_ctx.wait());
+  }
+};
+
+TEST_F(TestMockCacheSSDWriteLog, init_shutdown) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  auto cache_state = get_cache_state(mock_image_ctx);
+  MockSSDWriteLog ssd(mock_image_ctx, cache_state);
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  ASSERT_TRUE(cache_state->present);
+  ASSERT_TRUE(cache_state->empty);
+  ASSERT_TRUE(cache_state->clean);
+
+  shut_down(ssd);
+  ASSERT_FALSE(cache_state->present);
+}
+
+TEST_F(TestMockCacheSSDWriteLog, aio_write) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  MockSSDWriteLog ssd(mock_image_ctx, get_cache_state(mock_image_ctx));
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  write(ssd, {{0, 4096}}, bl);
+  shut_down(ssd);
+}
+
+TEST_F(TestMockCacheSSDWriteLog, aio_write_unaligned) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  MockSSDWriteLog ssd(mock_image_ctx, get_cache_state(mock_image_ctx));
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  bufferlist bl;
+  bl.append(std::string(512, '1'));
+  bl.append(std::string(1024, '2'));
+  write(ssd, {{512, 512}, {8192, 1024}}, bl);
+
+  MockContextSSD finish_ctx_read;
+  expect_context_complete(finish_ctx_read, 0);
+  bufferlist read_bl;
+  ssd.aio_read({{512, 512}, {8192, 1024}}, &read_bl, 0, &finish_ctx_read);
+  ASSERT_EQ(0, finish_ctx_read.wait());
+  ASSERT_TRUE(bl.contents_equal(read_bl));
+
+  shut_down(ssd);
+}
+
+TEST_F(TestMockCacheSSDWriteLog, aio_read_hit_ssd_cache) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  MockSSDWriteLog ssd(mock_image_ctx, get_cache_state(mock_image_ctx));
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  write(ssd, {{0, 4096}}, bl);
+  bufferlist bl2;
+  bl2.append(std::string(1024, '2'));
+  write(ssd, {{1024, 1024}}, bl2);
+
+  MockContextSSD finish_ctx_read;
+  expect_context_complete(finish_ctx_read, 0);
+  bufferlist read_bl;
+  ssd.aio_read({{0, 4096}}, &read_bl, 0, &finish_ctx_read);
+  ASSERT_EQ(0, finish_ctx_read.wait());
+  bufferlist expected_bl;
+  expected_bl.append(std::string(1024, '1'));
+  expected_bl.append(std::string(1024, '2'));
+  expected_bl.append(std::string(2048, '1'));
+  ASSERT_TRUE(expected_bl.contents_equal(read_bl));
+
+  shut_down(ssd);
+}
+
+TEST_F(TestMockCacheSSDWriteLog, aio_read_miss_ssd_cache) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  MockSSDWriteLog ssd(mock_image_ctx, get_cache_state(mock_image_ctx));
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  write(ssd, {{0, 4096}}, bl);
+
+  MockContextSSD finish_ctx_read;
+  expect_context_complete(finish_ctx_read, 4096);
+  bufferlist read_bl;
+  ssd.aio_read({{4096, 4096}}, &read_bl, 0, &finish_ctx_read);
+  ASSERT_EQ(4096, finish_ctx_read.wait());
+  ASSERT_EQ(4096, read_bl.length());
+
+  shut_down(ssd);
+}
+
+TEST_F(TestMockCacheSSDWriteLog, flush) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  auto cache_state = get_cache_state(mock_image_ctx);
+  MockSSDWriteLog ssd(mock_image_ctx, cache_state);
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  write(ssd, {{0, 4096}}, bl);
+
+  MockContextSSD finish_ctx_flush;
+  expect_context_complete(finish_ctx_flush, 0);
+  ssd.flush(&finish_ctx_flush);
+  ASSERT_EQ(0, finish_ctx_flush.wait());
+
+  shut_down(ssd);
+  ASSERT_TRUE(cache_state->clean);
+}
+
+TEST_F(TestMockCacheSSDWriteLog, aio_flush_source_user) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  MockSSDWriteLog ssd(mock_image_ctx, get_cache_state(mock_image_ctx));
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  write(ssd, {{0, 4096}}, bl);
+
+  MockContextSSD finish_ctx_flush;
+  expect_context_complete(finish_ctx_flush, 0);
+  ssd.aio_flush(io::FLUSH_SOURCE_USER, &finish_ctx_flush);
+  ASSERT_EQ(0, finish_ctx_flush.wait());
+
+  bufferlist bl2;
+  bl2.append(std::string(4096, '2'));
+  write(ssd, {{0, 4096}}, bl2);
+
+  MockContextSSD finish_ctx_read;
+  expect_context_complete(finish_ctx_read, 0);
+  bufferlist read_bl;
+  ssd.aio_read({{0, 4096}}, &read_bl, 0, &finish_ctx_read);
+  ASSERT_EQ(0, finish_ctx_read.wait());
+  ASSERT_TRUE(bl2.contents_equal(read_bl));
+
+  shut_down(ssd);
+}
+
+TEST_F(TestMockCacheSSDWriteLog, aio_discard) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+  MockSSDWriteLog ssd(mock_image_ctx, get_cache_state(mock_image_ctx));
+  expect_op_work_queue(mock_image_ctx);
+  expect_metadata_set(mock_image_ctx);
+
+  init(ssd);
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  write(ssd, {{0, 4096}}, bl);
+
+  MockContextSSD finish_ctx_discard;
+  expect_context_complete(finish_ctx_discard, 0);
+  ssd.aio_discard(0, 4096, 1, &finish_ctx_discard);
+  ASSERT_EQ(0, finish_ctx_discard.wait());
+
+  /* the discarded extent is read from the image */
+  MockContextSSD finish_ctx_read;
+  expect_context_complete(finish_ctx_read, 4096);
+  bufferlist read_bl;
+  ssd.aio_read({{0, 4096}}, &read_bl, 0, &finish_ctx_read);
+  ASSERT_EQ(4096, finish_ctx_read.wait());
+  ASSERT_TRUE(read_bl.is_zero());
+
+  shut_down(ssd);
+}
+
+} // namespace cache
+} // namespace librbd
@@ -0,0 +1,328 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "include/rbd/librbd.hpp"
+#include "librbd/cache/WriteBackObjectDispatch.h"
+#include "librbd/io/ObjectDispatchSpec.h"
+
+namespace librbd {
+namespace {
+
+struct MockTestImageCtx : public MockImageCtx {
+  MockTestImageCtx(ImageCtx &image_ctx) : MockImageCtx(image_ctx) {
+  }
+};
+
+struct MockContext : public C_SaferCond  {
+  MOCK_METHOD1(complete, void(int));
+  MOCK_METHOD1(finish, void(int));
+
+  void do_complete(int r) {
+    C_SaferCond::complete(r);
+  }
+};
+
+} // anonymous namespace
+} // namespace librbd
+
+#include "librbd/cache/WriteBackObjectDispatch.cc"
+
+namespace librbd {
+namespace cache {
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Invoke;
+
+struct TestMockCacheWriteBackObjectDispatch : public TestMockFixture {
+  typedef WriteBackObjectDispatch<librbd::MockTestImageCtx> MockWriteBackObjectDispatch;
+
+  void SetUp() override {
+    TestMockFixture::SetUp();
+
+    ASSERT_EQ(0, open_image(m_image_name, &m_ictx));
+    // only write back when a flush requires it
+    ASSERT_EQ(0, m_ictx->config.set_val("rbd_cache_target_dirty", "16M"));
+    ASSERT_EQ(0, m_ictx->config.set_val("rbd_cache_max_dirty_age", "3600"));
+  }
+
+  void expect_op_work_queue(MockTestImageCtx& mock_image_ctx) {
+    EXPECT_CALL(*mock_image_ctx.op_work_queue, queue(_, _))
+      .WillRepeatedly(Invoke([](Context* ctx, int r) {
+                        ctx->complete(r);
+                      }));
+  }
+
+  void expect_register_object_dispatch(MockTestImageCtx& mock_image_ctx) {
+    EXPECT_CALL(*mock_image_ctx.io_object_dispatcher,
+                register_object_dispatch(_));
+  }
+
+  void expect_writeback(MockTestImageCtx& mock_image_ctx, uint64_t object_no,
+                        uint64_t object_off, const bufferlist& data, int r) {
+    EXPECT_CALL(*mock_image_ctx.io_object_dispatcher, send(_))
+      .WillOnce(Invoke([&mock_image_ctx, object_no, object_off, data, r]
+                       (io::ObjectDispatchSpec* spec) {
+                  auto* write = boost::get<
+                    io::ObjectDispatchSpec::WriteRequest>(&spec->request);
+                  ASSERT_TRUE(write != nullptr);
+                  ASSERT_EQ(object_no, write->object_no);
+                  ASSERT_EQ(object_off, write->object_off);
+                  ASSERT_TRUE(data.contents_equal(write->data));
+
+                  spec->dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+                  mock_image_ctx.image_ctx->op_work_queue->queue(
+                    &spec->dispatcher_ctx, r);
+                }));
+  }
+
+  void expect_context_complete(MockContext& mock_context, int r) {
+    EXPECT_CALL(mock_context, complete(r))
+      .WillOnce(Invoke([&mock_context](int r) {
+                  mock_context.do_complete(r);
+                }));
+  }
+
+  void shut_down(MockWriteBackObjectDispatch& object_dispatch) {
+    C_SaferCond ctx;
+    object_dispatch.shut_down(&ctx);
+    ASSERT_EQ(0, ctx.wait());
+  }
+
+  librbd::ImageCtx *m_ictx = nullptr;
+};
+
+TEST_F(TestMockCacheWriteBackObjectDispatch, WriteBack) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  MockWriteBackObjectDispatch object_dispatch(&mock_image_ctx, 1 << 20,
+                                              false);
+  expect_op_work_queue(mock_image_ctx);
+  expect_register_object_dispatch(mock_image_ctx);
+  object_dispatch.init();
+
+  bufferlist data;
+  data.append(std::string(4096, '1'));
+
+  io::DispatchResult dispatch_result;
+  uint64_t journal_tid = 0;
+  MockContext finish_ctx;
+  MockContext dispatch_ctx;
+  Context* finish_ctx_ptr = &finish_ctx;
+  expect_context_complete(dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.write(0, 0, bufferlist{data}, {}, 0, {},
+                                    nullptr, &journal_tid, &dispatch_result,
+                                    &finish_ctx_ptr, &dispatch_ctx));
+  ASSERT_EQ(io::DISPATCH_RESULT_COMPLETE, dispatch_result);
+  ASSERT_EQ(0, dispatch_ctx.wait());
+
+  // the dirty data is read back from the cache
+  bufferlist read_data;
+  io::ExtentMap extent_map;
+  MockContext read_dispatch_ctx;
+  expect_context_complete(read_dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.read(0, 1024, 2048, CEPH_NOSNAP, 0, {},
+                                   &read_data, &extent_map, nullptr,
+                                   &dispatch_result, &finish_ctx_ptr,
+                                   &read_dispatch_ctx));
+  ASSERT_EQ(io::DISPATCH_RESULT_COMPLETE, dispatch_result);
+  ASSERT_EQ(0, read_dispatch_ctx.wait());
+  ASSERT_EQ(std::string(2048, '1'), read_data.to_str());
+
+  expect_writeback(mock_image_ctx, 0, 0, data, 0);
+  MockContext flush_dispatch_ctx;
+  expect_context_complete(flush_dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.flush(io::FLUSH_SOURCE_USER, {}, &journal_tid,
+                                    &dispatch_result, &finish_ctx_ptr,
+                                    &flush_dispatch_ctx));
+  ASSERT_EQ(io::DISPATCH_RESULT_CONTINUE, dispatch_result);
+  ASSERT_EQ(0, flush_dispatch_ctx.wait());
+  ASSERT_EQ(finish_ctx_ptr, &finish_ctx);
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheWriteBackObjectDispatch, WriteThroughUntilFlushed) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  MockWriteBackObjectDispatch object_dispatch(&mock_image_ctx, 1 << 20, true);
+  expect_op_work_queue(mock_image_ctx);
+  expect_register_object_dispatch(mock_image_ctx);
+  object_dispatch.init();
+
+  bufferlist data;
+  data.append(std::string(4096, '1'));
+
+  io::DispatchResult dispatch_result;
+  uint64_t journal_tid = 0;
+  MockContext finish_ctx;
+  MockContext dispatch_ctx;
+  Context* finish_ctx_ptr = &finish_ctx;
+  ASSERT_FALSE(object_dispatch.write(0, 0, bufferlist{data}, {}, 0, {},
+                                     nullptr, &journal_tid, &dispatch_result,
+                                     &finish_ctx_ptr, &dispatch_ctx));
+  ASSERT_EQ(finish_ctx_ptr, &finish_ctx);
+
+  MockContext flush_dispatch_ctx;
+  expect_context_complete(flush_dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.flush(io::FLUSH_SOURCE_USER, {}, &journal_tid,
+                                    &dispatch_result, &finish_ctx_ptr,
+                                    &flush_dispatch_ctx));
+  ASSERT_EQ(0, flush_dispatch_ctx.wait());
+
+  expect_context_complete(dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.write(0, 0, bufferlist{data}, {}, 0, {},
+                                    nullptr, &journal_tid, &dispatch_result,
+                                    &finish_ctx_ptr, &dispatch_ctx));
+  ASSERT_EQ(io::DISPATCH_RESULT_COMPLETE, dispatch_result);
+  ASSERT_EQ(0, dispatch_ctx.wait());
+
+  expect_writeback(mock_image_ctx, 0, 0, data, 0);
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheWriteBackObjectDispatch, CoalesceWrites) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  MockWriteBackObjectDispatch object_dispatch(&mock_image_ctx, 1 << 20,
+                                              false);
+  expect_op_work_queue(mock_image_ctx);
+  expect_register_object_dispatch(mock_image_ctx);
+  object_dispatch.init();
+
+  io::DispatchResult dispatch_result;
+  uint64_t journal_tid = 0;
+  MockContext finish_ctx;
+  Context* finish_ctx_ptr = &finish_ctx;
+
+  bufferlist data1;
+  data1.append(std::string(4096, '1'));
+  MockContext dispatch_ctx1;
+  expect_context_complete(dispatch_ctx1, 0);
+  ASSERT_TRUE(object_dispatch.write(0, 4096, std::move(data1), {}, 0, {},
+                                    nullptr, &journal_tid, &dispatch_result,
+                                    &finish_ctx_ptr, &dispatch_ctx1));
+  ASSERT_EQ(0, dispatch_ctx1.wait());
+
+  bufferlist data2;
+  data2.append(std::string(8192, '2'));
+  MockContext dispatch_ctx2;
+  expect_context_complete(dispatch_ctx2, 0);
+  ASSERT_TRUE(object_dispatch.write(0, 0, std::move(data2), {}, 0, {},
+                                    nullptr, &journal_tid, &dispatch_result,
+                                    &finish_ctx_ptr, &dispatch_ctx2));
+  ASSERT_EQ(0, dispatch_ctx2.wait());
+
+  bufferlist data3;
+  data3.append(std::string(4096, '3'));
+  MockContext dispatch_ctx3;
+  expect_context_complete(dispatch_ctx3, 0);
+  ASSERT_TRUE(object_dispatch.write(0, 8192, std::move(data3), {}, 0, {},
+                                    nullptr, &journal_tid, &dispatch_result,
+                                    &finish_ctx_ptr, &dispatch_ctx3));
+  ASSERT_EQ(0, dispatch_ctx3.wait());
+
+  bufferlist expected_data;
+  expected_data.append(std::string(8192, '2'));
+  expected_data.append(std::string(4096, '3'));
+  expect_writeback(mock_image_ctx, 0, 0, expected_data, 0);
+
+  MockContext flush_dispatch_ctx;
+  expect_context_complete(flush_dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.flush(io::FLUSH_SOURCE_USER, {}, &journal_tid,
+                                    &dispatch_result, &finish_ctx_ptr,
+                                    &flush_dispatch_ctx));
+  ASSERT_EQ(0, flush_dispatch_ctx.wait());
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheWriteBackObjectDispatch, FlushError) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  MockWriteBackObjectDispatch object_dispatch(&mock_image_ctx, 1 << 20,
+                                              false);
+  expect_op_work_queue(mock_image_ctx);
+  expect_register_object_dispatch(mock_image_ctx);
+  object_dispatch.init();
+
+  bufferlist data;
+  data.append(std::string(4096, '1'));
+
+  io::DispatchResult dispatch_result;
+  uint64_t journal_tid = 0;
+  MockContext finish_ctx;
+  MockContext dispatch_ctx;
+  Context* finish_ctx_ptr = &finish_ctx;
+  expect_context_complete(dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.write(0, 0, bufferlist{data}, {}, 0, {},
+                                    nullptr, &journal_tid, &dispatch_result,
+                                    &finish_ctx_ptr, &dispatch_ctx));
+  ASSERT_EQ(0, dispatch_ctx.wait());
+
+  expect_writeback(mock_image_ctx, 0, 0, data, -EPERM);
+  MockContext flush_dispatch_ctx;
+  expect_context_complete(flush_dispatch_ctx, -EPERM);
+  ASSERT_TRUE(object_dispatch.flush(io::FLUSH_SOURCE_USER, {}, &journal_tid,
+                                    &dispatch_result, &finish_ctx_ptr,
+                                    &flush_dispatch_ctx));
+  ASSERT_EQ(-EPERM, flush_dispatch_ctx.wait());
+
+  // the dirty data was dropped
+  bufferlist read_data;
+  io::ExtentMap extent_map;
+  MockContext read_dispatch_ctx;
+  ASSERT_FALSE(object_dispatch.read(0, 0, 4096, CEPH_NOSNAP, 0, {},
+                                    &read_data, &extent_map, nullptr,
+                                    &dispatch_result, &finish_ctx_ptr,
+                                    &read_dispatch_ctx));
+  ASSERT_NE(finish_ctx_ptr, &finish_ctx);
+
+  expect_context_complete(finish_ctx, -ENOENT);
+  finish_ctx_ptr->complete(-ENOENT);
+  ASSERT_EQ(-ENOENT, finish_ctx.wait());
+
+  shut_down(object_dispatch);
+}
+
+TEST_F(TestMockCacheWriteBackObjectDispatch, ReadCached) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  MockWriteBackObjectDispatch object_dispatch(&mock_image_ctx, 0, false);
+  expect_op_work_queue(mock_image_ctx);
+  expect_register_object_dispatch(mock_image_ctx);
+  object_dispatch.init();
+
+  InSequence seq;
+
+  bufferlist read_data;
+  io::ExtentMap extent_map;
+  io::DispatchResult dispatch_result;
+  MockContext finish_ctx;
+  MockContext dispatch_ctx;
+  Context* finish_ctx_ptr = &finish_ctx;
+  ASSERT_FALSE(object_dispatch.read(0, 0, 4096, CEPH_NOSNAP, 0, {},
+                                    &read_data, &extent_map, nullptr,
+                                    &dispatch_result, &finish_ctx_ptr,
+                                    &dispatch_ctx));
+  ASSERT_NE(finish_ctx_ptr, &finish_ctx);
+
+  read_data.append(std::string(4096, '1'));
+  expect_context_complete(finish_ctx, 0);
+  finish_ctx_ptr->complete(0);
+  ASSERT_EQ(0, finish_ctx.wait());
+
+  bufferlist cached_data;
+  finish_ctx_ptr = &finish_ctx;
+  expect_context_complete(dispatch_ctx, 0);
+  ASSERT_TRUE(object_dispatch.read(0, 512, 1024, CEPH_NOSNAP, 0, {},
+                                   &cached_data, &extent_map, nullptr,
+                                   &dispatch_result, &finish_ctx_ptr,
+                                   &dispatch_ctx));
+  ASSERT_EQ(io::DISPATCH_RESULT_COMPLETE, dispatch_result);
+  ASSERT_EQ(0, dispatch_ctx.wait());
+  ASSERT_EQ(std::string(1024, '1'), cached_data.to_str());
+
+  shut_down(object_dispatch);
+}
+
+} // namespace cache
+} // namespace librbd
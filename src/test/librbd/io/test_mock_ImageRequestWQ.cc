@@ -473,5 +473,32 @@ TEST_F(TestMockIoImageRequestWQ, BPSQosWithBurst) {
   ASSERT_TRUE(mock_image_request_wq.invoke_dequeue() == nullptr);
 }
 
+TEST_F(TestMockIoImageRequestWQ, QosScheduler) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+
+  MockImageDispatchSpec mock_queued_image_request;
+  expect_was_throttled(mock_queued_image_request, false);
+  expect_set_throttled(mock_queued_image_request);
+  EXPECT_CALL(mock_queued_image_request,
+              was_throttled(RBD_QOS_SCHEDULER_THROTTLE))
+    .WillOnce(Return(false));
+  EXPECT_CALL(mock_queued_image_request,
+              set_throttled(RBD_QOS_SCHEDULER_THROTTLE));
+
+  InSequence seq;
+  MockImageRequestWQ mock_image_request_wq(&mock_image_ctx, "io", 60, nullptr);
+
+  mock_image_request_wq.apply_qos_scheduler(true, 0, 1, 0, 0, 0);
+
+  expect_front(mock_image_request_wq, &mock_queued_image_request);
+  expect_dequeue(mock_image_request_wq, &mock_queued_image_request);
+  expect_requeue_back(mock_image_request_wq);
+  expect_signal(mock_image_request_wq);
+  ASSERT_TRUE(mock_image_request_wq.invoke_dequeue() == nullptr);
+}
+
 } // namespace io
 } // namespace librbd
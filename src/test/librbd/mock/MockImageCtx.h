@@ -95,7 +95,9 @@ struct MockImageCtx {
       trace_endpoint(image_ctx.trace_endpoint),
       sparse_read_threshold_bytes(image_ctx.sparse_read_threshold_bytes),
       discard_granularity_bytes(image_ctx.discard_granularity_bytes),
+      discard_on_zeroed_write(image_ctx.discard_on_zeroed_write),
       mirroring_replay_delay(image_ctx.mirroring_replay_delay),
+      disable_zero_copy(image_ctx.disable_zero_copy),
       non_blocking_aio(image_ctx.non_blocking_aio),
       blkin_trace_all(image_ctx.blkin_trace_all),
       enable_alloc_hint(image_ctx.enable_alloc_hint),
@@ -284,6 +286,7 @@ struct MockImageCtx {
   io::MockImageRequestWQ *io_work_queue;
   io::MockObjectDispatcher *io_object_dispatcher;
   MockContextWQ *op_work_queue;
+  std::vector<MockContextWQ*> io_dispatch_lanes;
 
   cache::MockImageCache *image_cache = nullptr;
 
@@ -305,7 +308,9 @@ struct MockImageCtx {
 
   uint64_t sparse_read_threshold_bytes;
   uint32_t discard_granularity_bytes;
+  bool discard_on_zeroed_write;
   int mirroring_replay_delay;
+  bool disable_zero_copy;
   bool non_blocking_aio;
   bool blkin_trace_all;
   bool enable_alloc_hint;
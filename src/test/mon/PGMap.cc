@@ -164,3 +164,82 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+TEST(pgmap, digest_delta)
+{
+  PGMap pg_map;
+  auto make_stat = [](unsigned ps, int a, int b) {
+    pg_stat_t s;
+    s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+    s.up = s.acting = {a, b};
+    s.up_primary = s.acting_primary = a;
+    s.stats.sum.num_objects = ps;
+    s.purged_snaps.insert(snapid_t(1), 4);
+    return s;
+  };
+  auto apply = [&](PGMap::Incremental& inc) {
+    inc.version = pg_map.version + 1;
+    inc.stamp = utime_t(pg_map.version + 1, 0);
+    pg_map.apply_incremental(nullptr, inc);
+    pg_map.calc_purged_snaps();
+  };
+  {
+    PGMap::Incremental inc;
+    for (unsigned ps = 0; ps < 8; ++ps) {
+      inc.pg_stat_updates[pg_t(ps, 1)] = make_stat(ps, ps % 3, (ps + 1) % 3);
+    }
+    for (unsigned ps = 0; ps < 4; ++ps) {
+      inc.pg_stat_updates[pg_t(ps, 2)] = make_stat(ps, 0, 1);
+    }
+    for (int osd = 0; osd < 3; ++osd) {
+      inc.update_stat(osd, osd_stat_t());
+    }
+    apply(inc);
+  }
+  ASSERT_EQ(2u, pg_map.purged_snaps.size());
+  PGMapDigest base = pg_map;
+
+  {
+    PGMap::Incremental inc;
+    // pool 1 mostly unchanged, one pg trimmed fewer snaps
+    auto s = make_stat(3, 1, 2);
+    s.purged_snaps.clear();
+    s.purged_snaps.insert(snapid_t(1), 2);
+    s.stats.sum.num_objects = 100;
+    inc.pg_stat_updates[pg_t(3, 1)] = s;
+    // pool 2 goes away
+    for (unsigned ps = 0; ps < 4; ++ps) {
+      inc.pg_remove.insert(pg_t(ps, 2));
+    }
+    osd_stat_t os;
+    os.seq = 10;
+    inc.update_stat(1, os);
+    apply(inc);
+  }
+  ASSERT_EQ(1u, pg_map.purged_snaps.size());
+  ASSERT_EQ(2u, pg_map.purged_snaps[1].range_end());
+
+  // purged_snaps was only redone for the pools that changed
+  PGMap fresh = pg_map;
+  fresh.calc_stats();
+  fresh.calc_purged_snaps();
+  ASSERT_EQ(fresh.purged_snaps, pg_map.purged_snaps);
+
+  bufferlist delta_bl;
+  pg_map.encode_delta(base, delta_bl, CEPH_FEATURES_ALL);
+  PGMapDigest applied = base;
+  auto p = delta_bl.cbegin();
+  applied.decode_delta(p);
+  ASSERT_TRUE(p.end());
+
+  bufferlist expected, actual;
+  pg_map.PGMapDigest::encode(expected, CEPH_FEATURES_ALL);
+  applied.encode(actual, CEPH_FEATURES_ALL);
+  ASSERT_TRUE(expected.contents_equal(actual));
+  ASSERT_LT(delta_bl.length(), expected.length());
+
+  // nothing changed: the delta is just the scalars
+  bufferlist empty_bl;
+  pg_map.encode_delta(applied, empty_bl, CEPH_FEATURES_ALL);
+  ASSERT_LT(empty_bl.length(), delta_bl.length());
+}
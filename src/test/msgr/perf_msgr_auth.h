@@ -0,0 +1,97 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <algorithm>
+#include <list>
+#include <string>
+
+#include "auth/DummyAuth.h"
+#include "include/str_list.h"
+
+/// DummyAuthClientServer that also sets up secure mode, with a fixed
+/// connection secret, so that ceph_perf_msgr_* can measure its cost.  The
+/// modes are taken from ms_client_mode on the client, the first one being
+/// preferred, and from ms_service_mode on the server.
+class PerfAuthClientServer : public DummyAuthClientServer {
+  std::vector<uint32_t> modes;
+
+  static std::string get_secret() {
+    // key and the two nonces
+    return std::string(64, 's');
+  }
+
+public:
+  PerfAuthClientServer(CephContext *cct, const std::string& option)
+    : DummyAuthClientServer(cct) {
+    std::list<std::string> l;
+    get_str_list(cct->_conf.get_val<std::string>(option), l);
+    for (auto& i : l) {
+      if (i == "secure") {
+	modes.push_back(CEPH_CON_MODE_SECURE);
+      } else if (i == "crc") {
+	modes.push_back(CEPH_CON_MODE_CRC);
+      }
+    }
+    if (modes.empty()) {
+      modes.push_back(CEPH_CON_MODE_CRC);
+    }
+  }
+
+  uint32_t get_mode() const {
+    return modes.front();
+  }
+
+  // client
+  int get_auth_request(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    uint32_t *method,
+    std::vector<uint32_t> *preferred_modes,
+    bufferlist *out) override {
+    *method = CEPH_AUTH_NONE;
+    *preferred_modes = modes;
+    return 0;
+  }
+
+  int handle_auth_done(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    uint64_t global_id,
+    uint32_t con_mode,
+    const bufferlist& bl,
+    CryptoKey *session_key,
+    std::string *connection_secret) override {
+    if (con_mode == CEPH_CON_MODE_SECURE) {
+      *connection_secret = get_secret();
+    }
+    return 0;
+  }
+
+  // server
+  uint32_t pick_con_mode(
+    int peer_type,
+    uint32_t auth_method,
+    const std::vector<uint32_t>& preferred_modes) override {
+    for (auto mode : preferred_modes) {
+      if (std::find(modes.begin(), modes.end(), mode) != modes.end()) {
+	return mode;
+      }
+    }
+    return CEPH_CON_MODE_UNKNOWN;
+  }
+
+  int handle_auth_request(
+    Connection *con,
+    AuthConnectionMeta *auth_meta,
+    bool more,
+    uint32_t auth_method,
+    const bufferlist& bl,
+    bufferlist *reply) override {
+    if (auth_meta->con_mode == CEPH_CON_MODE_SECURE) {
+      auth_meta->connection_secret = get_secret();
+    }
+    return 1;
+  }
+};
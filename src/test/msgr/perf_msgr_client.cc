@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <string>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <iostream>
 
 using namespace std;
@@ -28,8 +29,9 @@ using namespace std;
 #include "global/global_init.h"
 #include "msg/Messenger.h"
 #include "messages/MOSDOp.h"
-#include "auth/DummyAuth.h"
+#include "perf_msgr_auth.h"
 
+#include <algorithm>
 #include <atomic>
 
 class MessengerClient {
@@ -79,6 +81,8 @@ class MessengerClient {
     ceph::mutex lock = ceph::make_mutex("MessengerBenchmark::ClientThread::lock");
     ceph::condition_variable cond;
     uint64_t inflight;
+    vector<uint64_t> sent;      ///< send stamp of each op, in cycles
+    vector<uint64_t> latency;   ///< round trip of each op, in cycles
 
     ClientThread(Messenger *m, int c, ConnectionRef con, int len, int ops, int think_time_us):
         msgr(m), concurrent(c), conn(con), oid("object-name"), oloc(1, 1), msg_len(len), ops(ops),
@@ -87,11 +91,13 @@ class MessengerClient {
       bufferptr ptr(msg_len);
       memset(ptr.c_str(), 0, msg_len);
       data.append(ptr);
+      sent.resize(ops);
+      latency.reserve(ops);
     }
     void *entry() override {
       std::unique_lock locker{lock};
       for (int i = 0; i < ops; ++i) {
-        if (inflight > uint64_t(concurrent)) {
+        while (inflight >= uint64_t(concurrent)) {
 	  cond.wait(locker);
         }
 	hobject_t hobj(oid, oloc.key, CEPH_NOSNAP, pgid.ps(), pgid.pool(),
@@ -100,10 +106,14 @@ class MessengerClient {
         MOSDOp *m = new MOSDOp(client_inc, 0, hobj, spgid, 0, 0, 0);
         bufferlist msg_data(data);
         m->write(0, msg_len, msg_data);
+        m->set_tid(i);
         inflight++;
+        sent[i] = Cycles::rdtsc();
         conn->send_message(m);
         //cerr << __func__ << " send m=" << m << std::endl;
       }
+      // wait for the replies, their latencies are part of the run
+      cond.wait(locker, [this] { return inflight == 0; });
       locker.unlock();
       msgr->shutdown();
       return 0;
@@ -115,12 +125,13 @@ class MessengerClient {
   int think_time_us;
   vector<Messenger*> msgrs;
   vector<ClientThread*> clients;
-  DummyAuthClientServer dummy_auth;
 
  public:
+  PerfAuthClientServer dummy_auth;
+
   MessengerClient(const string &t, const string &addr, int delay):
       type(t), serveraddr(addr), think_time_us(delay),
-      dummy_auth(g_ceph_context) {
+      dummy_auth(g_ceph_context, "ms_client_mode") {
   }
   ~MessengerClient() {
     for (uint64_t i = 0; i < clients.size(); ++i)
@@ -154,12 +165,26 @@ class MessengerClient {
     for (uint64_t i = 0; i < msgrs.size(); ++i)
       msgrs[i]->wait();
   }
+  /// round trips of all the ops, in cycles, sorted
+  vector<uint64_t> get_latencies() {
+    vector<uint64_t> all;
+    for (auto c : clients) {
+      all.insert(all.end(), c->latency.begin(), c->latency.end());
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+  }
 };
 
 void MessengerClient::ClientDispatcher::ms_fast_dispatch(Message *m) {
+  uint64_t now = Cycles::rdtsc();
   usleep(think_time);
+  ceph_tid_t tid = m->get_tid();
   m->put();
   std::lock_guard l{thread->lock};
+  if (tid < thread->sent.size()) {
+    thread->latency.push_back(now - thread->sent[tid]);
+  }
   thread->inflight--;
   thread->cond.notify_all();
 }
@@ -173,6 +198,17 @@ void usage(const string &name) {
   cout << "       [ios]: how much messages sent for each client" << std::endl;
   cout << "       [thinktime]: sleep time when do fast dispatching(match client logic)" << std::endl;
   cout << "       [msg length]: message data bytes" << std::endl;
+  cout << " The stack, workers and mode are taken from --ms_type," << std::endl;
+  cout << " --ms_async_op_threads and --ms_client_mode (crc or secure; the" << std::endl;
+  cout << " server picks from its --ms_service_mode)." << std::endl;
+}
+
+static uint64_t get_cpu_us()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ull +
+    ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
 }
 
 int main(int argc, char **argv)
@@ -206,15 +242,34 @@ int main(int argc, char **argv)
   cout << "       ios " << ios << std::endl;
   cout << "       thinktime(us) " << think_time << std::endl;
   cout << "       message data bytes " << len << std::endl;
+  cout << "       async op threads " << g_conf().get_val<uint64_t>("ms_async_op_threads") << std::endl;
 
   MessengerClient client(public_msgr_type, args[0], think_time);
+  cout << "       mode " << ceph_con_mode_name(client.dummy_auth.get_mode()) << std::endl;
 
-  client.ready(concurrent, numjobs, ios, len);
   Cycles::init();
+  client.ready(concurrent, numjobs, ios, len);
+  uint64_t cpu_start = get_cpu_us();
   uint64_t start = Cycles::rdtsc();
   client.start();
   uint64_t stop = Cycles::rdtsc();
-  cout << " Total op " << (ios * numjobs) << " run time " << Cycles::to_microseconds(stop - start) << "us." << std::endl;
+  uint64_t cpu = get_cpu_us() - cpu_start;
+  uint64_t total = uint64_t(ios) * numjobs;
+  uint64_t run_us = std::max<uint64_t>(Cycles::to_microseconds(stop - start), 1);
+  cout << " Total op " << total << " run time " << run_us << "us." << std::endl;
+
+  auto lat = client.get_latencies();
+  auto pct = [&lat](double p) -> uint64_t {
+    if (lat.empty()) {
+      return 0;
+    }
+    return Cycles::to_microseconds(lat[std::min<size_t>(lat.size() * p, lat.size() - 1)]);
+  };
+  cout << " Throughput " << (total * 1000000 / run_us) << " op/s, "
+       << (total * len / run_us) << " MB/s" << std::endl;
+  cout << " Latency(us) p50 " << pct(0.5) << " p99 " << pct(0.99)
+       << " p999 " << pct(0.999) << std::endl;
+  cout << " CPU(us) per op " << (total ? double(cpu) / total : 0) << std::endl;
 
   return 0;
 }
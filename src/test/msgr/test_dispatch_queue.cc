@@ -0,0 +1,69 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "global/global_context.h"
+#include "msg/DispatchQueue.h"
+
+// the reader takes the throttle, a slow dispatch thread releases it
+TEST(DispatchQueue, throttle_released_by_another_thread)
+{
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val("ms_dispatch_throttle_bytes", "65536");
+  conf.set_val("ms_dispatch_throttle_batch_bytes", "262144");
+  std::string name = "test";
+  auto dq = std::make_unique<DispatchQueue>(g_ceph_context, nullptr, name);
+  const uint64_t max = dq->dispatch_throttler.get_max();
+  ASSERT_EQ(65536u, max);
+
+  std::mutex lock;
+  std::condition_variable cond;
+  std::deque<uint64_t> queued;
+  bool done = false;
+  std::thread dispatcher([&] {
+    std::unique_lock l(lock);
+    while (!done || !queued.empty()) {
+      if (queued.empty()) {
+	cond.wait(l);
+	continue;
+      }
+      uint64_t msize = queued.front();
+      queued.pop_front();
+      l.unlock();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      dq->dispatch_throttle_release(msize);
+      l.lock();
+    }
+  });
+
+  const uint64_t msize = 1024;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  for (int i = 0; i < 2000; ++i) {
+    // like a connection waiting for the throttle
+    while (!dq->dispatch_throttle_get(msize)) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    std::lock_guard l(lock);
+    queued.push_back(msize);
+    cond.notify_one();
+  }
+  {
+    std::lock_guard l(lock);
+    done = true;
+    cond.notify_one();
+  }
+  dispatcher.join();
+  // only the reader may still hold a little of the throttle
+  EXPECT_GE(max / 16, dq->dispatch_throttler.get_current());
+
+  conf.rm_val("ms_dispatch_throttle_bytes");
+  conf.rm_val("ms_dispatch_throttle_batch_bytes");
+}
@@ -4,7 +4,9 @@
  * In memory space allocator test cases.
  * Author: Ramesh Chander, Ramesh.Chander@sandisk.com
  */
+#include <fstream>
 #include <iostream>
+#include <thread>
 #include <boost/scoped_ptr.hpp>
 #include <gtest/gtest.h>
 
@@ -13,6 +15,7 @@
 #include "include/stringify.h"
 #include "include/Context.h"
 #include "os/bluestore/Allocator.h"
+#include "os/bluestore/ZonedAllocator.h"
 
 typedef boost::mt11213b gen_type;
 
@@ -480,7 +483,196 @@ TEST_P(AllocTest, test_alloc_contiguous)
   alloc->shutdown();
 }
 
+TEST_P(AllocTest, test_alloc_arenas)
+{
+  // arenas are ignored by allocators that don't support them
+  g_ceph_context->_conf.set_val("bluestore_alloc_arenas", "4");
+  g_ceph_context->_conf.set_val("bluestore_alloc_arena_size", "1048576");
+  int64_t block_size = 0x1000;
+  int64_t capacity = block_size * 1024;
+  init_alloc(capacity, block_size);
+  g_ceph_context->_conf.set_val("bluestore_alloc_arenas", "0");
+  g_ceph_context->_conf.set_val("bluestore_alloc_arena_size", "4194304");
+  alloc->init_add_free(0, capacity);
+
+  std::mutex lock;
+  interval_set<uint64_t> allocated;
+  PExtentVector all;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 96; i++) {
+	PExtentVector extents;
+	EXPECT_EQ(block_size * 2,
+	  alloc->allocate(block_size * 2, block_size, 0, (int64_t)0, &extents));
+	std::lock_guard l(lock);
+	for (auto& e : extents) {
+	  EXPECT_FALSE(allocated.intersects(e.offset, e.length));
+	  allocated.insert(e.offset, e.length);
+	  all.emplace_back(e);
+	}
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(capacity * 3 / 4, (int64_t)allocated.size());
+  EXPECT_EQ(capacity / 4, (int64_t)alloc->get_free());
+
+  // everything left in arenas is reported as free and can be reused
+  all.resize(all.size() / 8);
+  alloc->release(all);
+  uint64_t dumped = 0;
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+    dumped += length;
+  });
+  EXPECT_EQ(alloc->get_free(), dumped);
+  PExtentVector extents;
+  EXPECT_EQ((int64_t)dumped,
+    alloc->allocate(dumped, block_size, 0, (int64_t)0, &extents));
+  alloc->shutdown();
+}
+
+TEST_P(AllocTest, test_alloc_trace)
+{
+  int64_t block_size = 0x1000;
+  int64_t capacity = block_size * 1024;
+  init_alloc(capacity, block_size);
+  alloc->init_add_free(0, capacity);
+
+  string path = "alloc_trace." + string(GetParam());
+  ASSERT_EQ(0, alloc->start_trace(path));
+  ASSERT_EQ(-EBUSY, alloc->start_trace(path));
+  PExtentVector extents;
+  EXPECT_EQ(block_size * 4,
+    alloc->allocate(block_size * 4, block_size, 0, (int64_t)0, &extents));
+  alloc->release(extents);
+  alloc->stop_trace();
+  // not recorded
+  extents.clear();
+  EXPECT_EQ(block_size,
+    alloc->allocate(block_size, block_size, 0, (int64_t)0, &extents));
+
+  std::ifstream in(path);
+  std::map<string, int> ops;
+  string line;
+  while (std::getline(in, line)) {
+    ++ops[line.substr(0, line.find(' '))];
+  }
+  EXPECT_LE(1, ops["free"]);
+  EXPECT_EQ(1, ops["alloc"]);
+  EXPECT_EQ(1, ops["release"]);
+  ::unlink(path.c_str());
+  alloc->shutdown();
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
   ::testing::Values("stupid", "bitmap", "avl", "hybrid"));
+
+TEST(ZonedAllocatorTest, sequential_and_reset)
+{
+  int64_t block_size = 4096;
+  uint64_t zone_size = 256 * block_size;
+  int64_t size = 4 * zone_size;
+  // zone 0 is conventional
+  std::unique_ptr<Allocator> alloc(
+    Allocator::create(g_ceph_context, "zoned", size, block_size, "",
+		      zone_size, 1));
+  ASSERT_TRUE(alloc);
+  auto z = static_cast<ZonedAllocator*>(alloc.get());
+  // zone 1 has a write pointer at 8 blocks, all of it in use
+  z->init_zones({0, 8 * (uint64_t)block_size, 0, 0});
+  z->init_add_free(zone_size + 8 * block_size, 3 * zone_size - 8 * block_size);
+  EXPECT_EQ(3 * zone_size - 8 * block_size, alloc->get_free());
+
+  // handed out right at the write pointer, then following on
+  PExtentVector extents;
+  EXPECT_EQ(block_size,
+    alloc->allocate(block_size, block_size, 0, (int64_t)0, &extents));
+  ASSERT_EQ(1u, extents.size());
+  EXPECT_EQ(zone_size + 8 * block_size, extents[0].offset);
+  extents.clear();
+  EXPECT_EQ(2 * block_size,
+    alloc->allocate(2 * block_size, block_size, 0, (int64_t)0, &extents));
+  ASSERT_EQ(1u, extents.size());
+  EXPECT_EQ(zone_size + 9 * block_size, extents[0].offset);
+
+  // released space doesn't come back until the zone is reset
+  uint64_t free = alloc->get_free();
+  interval_set<uint64_t> release_set;
+  release_set.insert(zone_size, 11 * block_size);
+  alloc->release(release_set);
+  EXPECT_EQ(free, alloc->get_free());
+
+  // fill zone 1 up so allocation moves on to zone 2
+  extents.clear();
+  EXPECT_EQ((int64_t)zone_size,
+    alloc->allocate(zone_size, block_size, 0, (int64_t)0, &extents));
+  EXPECT_EQ(zone_size + 11 * block_size, extents[0].offset);
+  EXPECT_EQ(2 * zone_size + 11 * block_size, extents.back().end());
+  release_set.clear();
+  release_set.insert(zone_size + 11 * block_size, zone_size - 11 * block_size);
+  alloc->release(release_set);
+
+  uint64_t zone;
+  ASSERT_TRUE(z->start_cleaning(0.5, &zone));
+  EXPECT_EQ(1u, zone);
+  EXPECT_TRUE(z->is_zone_dead(zone));
+  free = alloc->get_free();
+  z->reset_zone(zone);
+  EXPECT_EQ(free + zone_size, alloc->get_free());
+  alloc->shutdown();
+}
+
+TEST(ZonedAllocatorTest, slots)
+{
+  int64_t block_size = 4096;
+  uint64_t zone_size = 16 * block_size;
+  int64_t size = 4 * zone_size;
+  std::unique_ptr<Allocator> alloc(
+    Allocator::create(g_ceph_context, "zoned", size, block_size, "",
+		      zone_size, 1));
+  ASSERT_TRUE(alloc);
+  auto z = static_cast<ZonedAllocator*>(alloc.get());
+  ASSERT_LE(2u, z->get_num_slots());
+  z->init_zones({0, 0, 0, 0});
+  z->init_add_free(zone_size, 3 * zone_size);
+
+  // each slot writes a zone of its own
+  PExtentVector a, b;
+  z->get_slot(0);
+  ASSERT_TRUE(z->try_get_slot(1));
+  EXPECT_FALSE(z->try_get_slot(1));
+  EXPECT_EQ(2 * block_size, z->allocate_in(0, 2 * block_size, block_size, 0, &a));
+  EXPECT_EQ(block_size, z->allocate_in(1, block_size, block_size, 0, &b));
+  ASSERT_EQ(1u, a.size());
+  ASSERT_EQ(1u, b.size());
+  EXPECT_EQ(zone_size, a[0].offset);
+  EXPECT_EQ(2 * zone_size, b[0].offset);
+
+  // what was allocated in a slot has to be written before it is given back,
+  // released or not
+  interval_set<uint64_t> release_set;
+  release_set.insert(a[0].offset, a[0].length);
+  alloc->release(release_set);
+  interval_set<uint64_t> unsubmitted;
+  z->get_unsubmitted(0, &unsubmitted);
+  EXPECT_EQ(1u, unsubmitted.num_intervals());
+  EXPECT_EQ(zone_size, unsubmitted.range_start());
+  EXPECT_EQ(2u * block_size, unsubmitted.size());
+
+  // not cleaned while the writes are not submitted, the zone is open anyway
+  uint64_t zone;
+  EXPECT_FALSE(z->start_cleaning(0.1, &zone));
+  z->put_slot(0);
+  unsubmitted.clear();
+  ASSERT_TRUE(z->try_get_slot(0));
+  z->get_unsubmitted(0, &unsubmitted);
+  EXPECT_TRUE(unsubmitted.empty());
+  z->put_slot(0);
+  z->put_slot(1);
+  alloc->shutdown();
+}
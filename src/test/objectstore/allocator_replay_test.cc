@@ -0,0 +1,430 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Allocator trace replay tool.
+ * Replays traces recorded with
+ *   ceph daemon osd.N bluestore allocator trace <name> start <path>
+ * against each allocator type and reports allocation throughput,
+ * latency percentiles, fragmentation and free extent histograms.
+ */
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/debug.h"
+#include "global/global_init.h"
+#include "include/intarith.h"
+#include "os/bluestore/Allocator.h"
+
+using namespace std;
+
+void usage(const string &name) {
+  cerr << "Usage: " << name << " <trace> [--interval <ops>]"
+       << " [--capacity <bytes>] [--block-size <bytes>]"
+       << " [<allocator type> ...]" << std::endl;
+  cerr << "Allocator types default to stupid, bitmap, avl and hybrid."
+       << std::endl;
+}
+
+struct trace_op_t {
+  enum {
+    OP_FREE,
+    OP_ADD,
+    OP_RM,
+    OP_ALLOC,
+    OP_RELEASE,
+  } op;
+  uint64_t want = 0, unit = 0, max = 0;
+  PExtentVector extents;
+};
+
+static bool parse_extents(char* sp, PExtentVector* extents)
+{
+  char* token;
+  while ((token = strtok(sp, " \n")) != nullptr) {
+    sp = nullptr;
+    char* e;
+    uint64_t offs = strtoull(token, &e, 16);
+    if (*e != '~') {
+      return false;
+    }
+    uint64_t len = strtoull(e + 1, nullptr, 16);
+    if (len == 0) {
+      return false;
+    }
+    extents->emplace_back(offs, len);
+  }
+  return true;
+}
+
+int load_trace(const char* fname, vector<trace_op_t>* ops,
+	       uint64_t* capacity, uint64_t* block_size)
+{
+  FILE* f = fopen(fname, "r");
+  if (!f) {
+    std::cerr << "error: unable to open " << fname << std::endl;
+    return -1;
+  }
+  char s[65536];
+  uint64_t max_end = 0;
+  uint64_t min_unit = 0;
+  while (fgets(s, sizeof(s), f) != nullptr) {
+    trace_op_t t;
+    char* sp = strchr(s, ' ');
+    if (!sp) {
+      continue;
+    }
+    *sp++ = 0;
+    if (strcmp(s, "free") == 0) {
+      t.op = trace_op_t::OP_FREE;
+    } else if (strcmp(s, "add") == 0) {
+      t.op = trace_op_t::OP_ADD;
+    } else if (strcmp(s, "rm") == 0) {
+      t.op = trace_op_t::OP_RM;
+    } else if (strcmp(s, "release") == 0) {
+      t.op = trace_op_t::OP_RELEASE;
+    } else if (strcmp(s, "alloc") == 0) {
+      t.op = trace_op_t::OP_ALLOC;
+      char* e;
+      t.want = strtoull(sp, &e, 16);
+      if (*e == '/') {
+	t.unit = strtoull(e + 1, &e, 16);
+      }
+      if (*e == '/') {
+	t.max = strtoull(e + 1, &e, 16);
+      }
+      if (t.want == 0 || t.unit == 0) {
+	std::cerr << "error: bad allocate: " << sp << std::endl;
+	fclose(f);
+	return -1;
+      }
+      sp = e;
+      if (!min_unit || t.unit < min_unit) {
+	min_unit = t.unit;
+      }
+    } else {
+      std::cerr << "error: unknown op: " << s << std::endl;
+      fclose(f);
+      return -1;
+    }
+    if (!parse_extents(sp, &t.extents)) {
+      std::cerr << "error: bad extents: " << sp << std::endl;
+      fclose(f);
+      return -1;
+    }
+    for (auto& e : t.extents) {
+      max_end = std::max(max_end, e.end());
+    }
+    ops->emplace_back(std::move(t));
+  }
+  fclose(f);
+  if (!*block_size) {
+    *block_size = min_unit ? min_unit : 4096;
+  }
+  if (!*capacity) {
+    *capacity = p2roundup(max_end, *block_size);
+  }
+  return 0;
+}
+
+class Replayer {
+  unique_ptr<Allocator> alloc;
+  uint64_t capacity;
+
+  // recorded offset -> (length, replayed offset)
+  std::map<uint64_t, std::pair<uint64_t, uint64_t>> mapped;
+  // space owned by the application when the trace started
+  interval_set<uint64_t> preowned;
+
+  vector<uint64_t> alloc_lat, release_lat;
+  uint64_t alloc_failures = 0;
+  uint64_t rm_conflicts = 0;
+
+  void map_extents(const PExtentVector& rec, const PExtentVector& rep) {
+    auto ri = rec.begin();
+    uint64_t roff = 0;
+    for (auto& p : rep) {
+      uint64_t poff = 0;
+      while (poff < p.length && ri != rec.end()) {
+	uint64_t l = std::min<uint64_t>(p.length - poff, ri->length - roff);
+	mapped[ri->offset + roff] = std::make_pair(l, p.offset + poff);
+	poff += l;
+	roff += l;
+	if (roff == ri->length) {
+	  ++ri;
+	  roff = 0;
+	}
+      }
+      if (poff < p.length) {
+	// got more than recorded, give the rest back right away
+	interval_set<uint64_t> r;
+	r.insert(p.offset + poff, p.length - poff);
+	alloc->release(r);
+      }
+    }
+  }
+
+  // translate a recorded range to the replayed one, forgetting it
+  void unmap(uint64_t offset, uint64_t length,
+	     interval_set<uint64_t>* rep, interval_set<uint64_t>* unmapped) {
+    uint64_t end = offset + length;
+    auto p = mapped.lower_bound(offset);
+    if (p != mapped.begin()) {
+      auto q = std::prev(p);
+      if (q->first + q->second.first > offset) {
+	p = q;
+      }
+    }
+    uint64_t pos = offset;
+    while (p != mapped.end() && p->first < end) {
+      uint64_t s = p->first, l = p->second.first, t = p->second.second;
+      if (pos < s) {
+	unmapped->insert(pos, s - pos);
+      }
+      uint64_t from = std::max(s, offset);
+      uint64_t to = std::min(s + l, end);
+      rep->insert(t + (from - s), to - from);
+      p = mapped.erase(p);
+      if (s < from) {
+	mapped[s] = std::make_pair(from - s, t);
+      }
+      if (to < s + l) {
+	mapped[to] = std::make_pair(s + l - to, t + (to - s));
+      }
+      pos = to;
+    }
+    if (pos < end) {
+      unmapped->insert(pos, end - pos);
+    }
+  }
+
+  // the part of @in still owned from before the trace start
+  interval_set<uint64_t> take_preowned(const interval_set<uint64_t>& in) {
+    interval_set<uint64_t> r;
+    r.intersection_of(in, preowned);
+    preowned.subtract(r);
+    return r;
+  }
+
+public:
+  Replayer(const string& type, uint64_t capacity, uint64_t block_size)
+    : alloc(Allocator::create(g_ceph_context, type, capacity, block_size)),
+      capacity(capacity) {
+    preowned.insert(0, capacity);
+  }
+  bool valid() const {
+    return !!alloc;
+  }
+
+  void apply(const trace_op_t& t) {
+    switch (t.op) {
+    case trace_op_t::OP_FREE:
+      for (auto& e : t.extents) {
+	if (preowned.contains(e.offset, e.length)) {
+	  preowned.erase(e.offset, e.length);
+	  alloc->init_add_free(e.offset, e.length);
+	}
+      }
+      break;
+    case trace_op_t::OP_ADD:
+    case trace_op_t::OP_RELEASE:
+      {
+	interval_set<uint64_t> rep, unmapped;
+	for (auto& e : t.extents) {
+	  unmap(e.offset, e.length, &rep, &unmapped);
+	}
+	auto own = take_preowned(unmapped);
+	if (t.op == trace_op_t::OP_ADD) {
+	  for (auto p = own.begin(); p != own.end(); ++p) {
+	    alloc->init_add_free(p.get_start(), p.get_len());
+	  }
+	  break;
+	}
+	rep.union_of(own);
+	if (!rep.empty()) {
+	  auto start = ceph::mono_clock::now();
+	  alloc->release(rep);
+	  release_lat.push_back(
+	    std::chrono::duration_cast<std::chrono::nanoseconds>(
+	      ceph::mono_clock::now() - start).count());
+	}
+      }
+      break;
+    case trace_op_t::OP_RM:
+      for (auto& e : t.extents) {
+	// anything the replay placed there already can't be taken over
+	interval_set<uint64_t> r, busy;
+	r.insert(e.offset, e.length);
+	for (auto& m : mapped) {
+	  busy.insert(m.second.second, m.second.first);
+	}
+	busy.union_of(preowned);
+	interval_set<uint64_t> conflict;
+	conflict.intersection_of(r, busy);
+	rm_conflicts += conflict.size();
+	r.subtract(conflict);
+	for (auto p = r.begin(); p != r.end(); ++p) {
+	  alloc->init_rm_free(p.get_start(), p.get_len());
+	  preowned.insert(p.get_start(), p.get_len());
+	}
+      }
+      break;
+    case trace_op_t::OP_ALLOC:
+      {
+	PExtentVector rep;
+	auto start = ceph::mono_clock::now();
+	int64_t r = alloc->allocate(t.want, t.unit, t.max, 0, &rep);
+	alloc_lat.push_back(
+	  std::chrono::duration_cast<std::chrono::nanoseconds>(
+	    ceph::mono_clock::now() - start).count());
+	if (r < (int64_t)t.want) {
+	  ++alloc_failures;
+	}
+	map_extents(t.extents, rep);
+      }
+      break;
+    }
+  }
+
+  void report_state(uint64_t ops) {
+    // free extent histogram, power of 2 buckets
+    std::map<unsigned, uint64_t> hist;
+    alloc->dump([&](uint64_t offset, uint64_t length) {
+      ++hist[cbits(length) - 1];
+    });
+    std::cout << "  ops " << ops
+	      << " free " << alloc->get_free()
+	      << " fragmentation " << alloc->get_fragmentation()
+	      << " score " << alloc->get_fragmentation_score()
+	      << std::endl;
+    std::cout << "    free extents:";
+    for (auto& [b, n] : hist) {
+      std::cout << " " << byte_u_t(1ull << b) << ":" << n;
+    }
+    std::cout << std::endl;
+  }
+
+  static void report_lat(const char* what, vector<uint64_t>& lat) {
+    if (lat.empty()) {
+      return;
+    }
+    std::sort(lat.begin(), lat.end());
+    uint64_t total = 0;
+    for (auto l : lat) {
+      total += l;
+    }
+    auto pct = [&](double p) {
+      return lat[std::min<size_t>(lat.size() - 1, lat.size() * p)];
+    };
+    std::cout << "  " << what << ": " << lat.size() << " ops, "
+	      << std::fixed << std::setprecision(0)
+	      << (double)lat.size() * 1000000000 / std::max<uint64_t>(total, 1)
+	      << " ops/s, latency ns p50 " << pct(.5)
+	      << " p90 " << pct(.9)
+	      << " p99 " << pct(.99)
+	      << " p99.9 " << pct(.999)
+	      << " max " << lat.back()
+	      << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+  }
+
+  void report_summary() {
+    report_lat("allocate", alloc_lat);
+    report_lat("release", release_lat);
+    std::cout << "  allocation failures " << alloc_failures
+	      << ", init_rm_free conflicts " << byte_u_t(rm_conflicts)
+	      << std::endl;
+  }
+
+  void shutdown() {
+    alloc->shutdown();
+  }
+};
+
+int main(int argc, char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+  if (args.empty()) {
+    usage(argv[0]);
+    return 1;
+  }
+  uint64_t interval = 100000;
+  uint64_t capacity = 0;
+  uint64_t block_size = 0;
+  vector<string> types;
+  const char* fname = nullptr;
+  for (auto i = args.begin(); i != args.end(); ++i) {
+    string arg(*i);
+    if ((arg == "--interval" || arg == "--capacity" ||
+	 arg == "--block-size") && i + 1 != args.end()) {
+      uint64_t v = strtoull(*++i, nullptr, 0);
+      if (arg == "--interval") {
+	interval = v;
+      } else if (arg == "--capacity") {
+	capacity = v;
+      } else {
+	block_size = v;
+      }
+    } else if (arg == "-h" || arg == "--help") {
+      usage(argv[0]);
+      return 0;
+    } else if (!fname) {
+      fname = *i;
+    } else {
+      types.push_back(arg);
+    }
+  }
+  if (!fname) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (types.empty()) {
+    types = { "stupid", "bitmap", "avl", "hybrid" };
+  }
+
+  vector<const char*> empty_args;
+  auto cct = global_init(NULL, empty_args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+  g_ceph_context->_conf.apply_changes(nullptr);
+
+  vector<trace_op_t> ops;
+  if (load_trace(fname, &ops, &capacity, &block_size) < 0) {
+    return 1;
+  }
+  std::cout << "trace " << fname << ": " << ops.size() << " ops, capacity "
+	    << byte_u_t(capacity) << ", block size " << block_size << std::endl;
+
+  for (auto& type : types) {
+    std::cout << type << ":" << std::endl;
+    Replayer r(type, capacity, block_size);
+    if (!r.valid()) {
+      std::cerr << "error: unknown allocator " << type << std::endl;
+      return 1;
+    }
+    uint64_t n = 0;
+    bool started = false;
+    for (auto& t : ops) {
+      r.apply(t);
+      if (t.op == trace_op_t::OP_FREE) {
+	continue;
+      }
+      if (!started) {
+	started = true;
+	r.report_state(0);
+      }
+      if (interval && ++n % interval == 0) {
+	r.report_state(n);
+      }
+    }
+    r.report_state(n);
+    r.report_summary();
+    r.shutdown();
+  }
+  return 0;
+}
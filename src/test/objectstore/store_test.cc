@@ -324,6 +324,69 @@ TEST_P(StoreTest, SimpleRemount) {
   }
 }
 
+TEST_P(StoreTest, AllocatorSnapshotRemount) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_allocator_snapshot", "true");
+  g_conf().apply_changes(nullptr);
+
+  coll_t cid;
+  bufferlist bl;
+  bl.append(std::string(65536, 'a'));
+  int r;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    for (unsigned i = 0; i < 16; ++i) {
+      ghobject_t hoid(hobject_t(sobject_t("Object " + stringify(i),
+                                          CEPH_NOSNAP)));
+      t.write(cid, hoid, 0, bl.length(), bl);
+    }
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  struct store_statfs_t statfs0;
+  ASSERT_EQ(0, store->statfs(&statfs0));
+  ch.reset();
+  // umount saves the snapshot, mount loads it
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->mount());
+  ch = store->open_collection(cid);
+  {
+    struct store_statfs_t statfs;
+    ASSERT_EQ(0, store->statfs(&statfs));
+    ASSERT_EQ(statfs0.allocated, statfs.allocated);
+  }
+  {
+    // these must not collide with anything allocated before the remount
+    ObjectStore::Transaction t;
+    for (unsigned i = 16; i < 32; ++i) {
+      ghobject_t hoid(hobject_t(sobject_t("Object " + stringify(i),
+                                          CEPH_NOSNAP)));
+      t.write(cid, hoid, 0, bl.length(), bl);
+    }
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ch.reset();
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->fsck(false));
+  ASSERT_EQ(0, store->mount());
+  ch = store->open_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    for (unsigned i = 0; i < 32; ++i) {
+      ghobject_t hoid(hobject_t(sobject_t("Object " + stringify(i),
+                                          CEPH_NOSNAP)));
+      t.remove(cid, hoid);
+    }
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, IORemount) {
   coll_t cid;
   bufferlist bl;
@@ -1315,6 +1378,67 @@ TEST_P(StoreTest, SimpleObjectTest) {
 
 #if defined(WITH_BLUESTORE)
 
+TEST_P(StoreTest, OnodePrefetch) {
+  if(string(GetParam()) != "bluestore")
+    return;
+  int r;
+  coll_t cid;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  vector<ghobject_t> oids;
+  bufferlist bl;
+  bl.append(string(8192, 'p'));
+  {
+    ObjectStore::Transaction t;
+    for (int i = 0; i < 10; ++i) {
+      oids.emplace_back(hobject_t(sobject_t("Object " + stringify(i),
+					    CEPH_NOSNAP)));
+      t.write(cid, oids.back(), 0, bl.length(), bl);
+    }
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // start with a cold cache
+  ch.reset();
+  r = store->umount();
+  ASSERT_EQ(0, r);
+  r = store->mount();
+  ASSERT_EQ(0, r);
+  ch = store->open_collection(cid);
+  const PerfCounters* logger = store->get_perf_counters();
+  store->prefetch(ch, oids);
+  for (int i = 0; i < 100 && logger->get(l_bluestore_onode_prefetched) < 10;
+       ++i) {
+    usleep(10000);
+  }
+  ASSERT_EQ(10u, logger->get(l_bluestore_onode_prefetched));
+  uint64_t misses = logger->get(l_bluestore_onode_misses);
+  for (auto& oid : oids) {
+    bufferlist out;
+    r = store->read(ch, oid, 0, bl.length(), out);
+    ASSERT_EQ((int)bl.length(), r);
+    ASSERT_TRUE(bl_eq(bl, out));
+  }
+  ASSERT_EQ(misses, logger->get(l_bluestore_onode_misses));
+  // already cached, nothing to load again
+  store->prefetch(ch, oids);
+  {
+    ObjectStore::Transaction t;
+    for (auto& oid : oids) {
+      t.remove(cid, oid);
+    }
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_EQ(10u, logger->get(l_bluestore_onode_prefetched));
+}
+
 TEST_P(StoreTestSpecificAUSize, ReproBug41901Test) {
   if(string(GetParam()) != "bluestore")
     return;
@@ -4827,6 +4951,82 @@ TEST_P(StoreTestSpecificAUSize, ZipperPatternSharded) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, DefragWhileOverwriting) {
+  if(string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_defrag_interval", "0.01");
+  SetVal(g_conf(), "bluestore_defrag_min_extents", "4");
+  SetVal(g_conf(), "bluestore_defrag_max_bytes_per_sec", "0");
+  SetVal(g_conf(), "bluestore_max_blob_size", "65536");
+  g_conf().apply_changes(nullptr);
+  StartDeferred(4096);
+
+  int r;
+  coll_t cid;
+  ghobject_t a(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  ghobject_t b(hobject_t(sobject_t("Object 2", CEPH_NOSNAP)));
+  const PerfCounters* logger = store->get_perf_counters();
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  const unsigned len = 4096, blocks = 64;
+  // interleave the allocations of a with those of b to fragment a
+  std::string expected(len * blocks, 0);
+  for (unsigned i = 0; i < blocks; ++i) {
+    bufferlist bl;
+    bl.append(std::string(len, 'a' + i % 26));
+    expected.replace(i * len, len, bl.to_str());
+    ObjectStore::Transaction t;
+    t.write(cid, a, i * len, len, bl, 0);
+    t.write(cid, b, i * len, len, bl, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // overwrite random blocks of a while the defrag thread rewrites it
+  for (unsigned n = 0;
+       n < 2000 || (n < 20000 && logger->get(l_bluestore_defrag_onodes) == 0);
+       ++n) {
+    unsigned i = rand() % blocks;
+    bufferlist bl;
+    bl.append(std::string(len, 'A' + n % 26));
+    expected.replace(i * len, len, bl.to_str());
+    ObjectStore::Transaction t;
+    t.write(cid, a, i * len, len, bl, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  EXPECT_LT(0u, logger->get(l_bluestore_defrag_onodes));
+  {
+    bufferlist out;
+    r = store->read(ch, a, 0, expected.size(), out);
+    ASSERT_EQ((int)expected.size(), r);
+    ASSERT_EQ(expected, out.to_str());
+  }
+  ch.reset();
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->fsck(false));
+  ASSERT_EQ(0, store->mount());
+  ch = store->open_collection(cid);
+  {
+    bufferlist out;
+    r = store->read(ch, a, 0, expected.size(), out);
+    ASSERT_EQ((int)expected.size(), r);
+    ASSERT_EQ(expected, out.to_str());
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, a);
+    t.remove(cid, b);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, SyntheticMatrixCsumAlgorithm) {
   if (string(GetParam()) != "bluestore")
     return;
@@ -4918,6 +5118,22 @@ TEST_P(StoreTestSpecificAUSize, SyntheticMatrixNoCsum) {
   do_matrix(m, std::bind(&StoreTest::doSyntheticTest, this, _1, _2, _3, _4));
 }
 
+TEST_P(StoreTestSpecificAUSize, SyntheticMatrixKVSyncShards) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  const char *m[][10] = {
+    { "bluestore_min_alloc_size", "4096", 0 }, // to be the first!
+    { "max_write", "65536", 0 },
+    { "max_size", "1048576", 0 },
+    { "alignment", "512", 0 },
+    { "bluestore_kv_sync_shards", "1", "4", 0 },
+    { "bluestore_sync_submit_transaction", "true", "false", 0 },
+    { 0 },
+  };
+  do_matrix(m, std::bind(&StoreTest::doSyntheticTest, this, _1, _2, _3, _4));
+}
+
 TEST_P(StoreTestSpecificAUSize, SyntheticMatrixPreferDeferred) {
   if (string(GetParam()) != "bluestore")
     return;
@@ -8,6 +8,8 @@
 #include "common/ceph_time.h"
 #include "os/bluestore/BlueStore.h"
 #include "os/bluestore/AvlAllocator.h"
+#include "os/bluestore/CacheArena.h"
+#include "os/bluestore/FrequencySketch.h"
 #include "common/ceph_argparse.h"
 #include "global/global_init.h"
 #include "global/global_context.h"
@@ -308,6 +310,44 @@ TEST(bluestore_blob_t, calc_csum)
   }
 }
 
+TEST(bluestore_blob_t, csum_fragmented)
+{
+  // blocks straddling buffer segments take the iterator path, the rest
+  // are checksummed straight from memory; both must agree
+  bufferptr bp(16384);
+  for (unsigned i = 0; i < bp.length(); ++i)
+    bp.c_str()[i] = (i * 7) & 0xff;
+  bufferlist flat;
+  flat.append(bp);
+  bufferlist frag;
+  unsigned cuts[] = {0, 100, 4096, 4097, 12288, 16384};
+  for (unsigned i = 0; i + 1 < std::size(cuts); ++i) {
+    bufferlist t;
+    t.substr_of(flat, cuts[i], cuts[i + 1] - cuts[i]);
+    frag.claim_append(t);
+  }
+  ASSERT_EQ(flat.length(), frag.length());
+  for (unsigned csum_type = Checksummer::CSUM_NONE + 1;
+       csum_type < Checksummer::CSUM_MAX;
+       ++csum_type) {
+    bluestore_blob_t a, b;
+    a.init_csum(csum_type, 12, flat.length());
+    b.init_csum(csum_type, 12, flat.length());
+    a.calc_csum(0, flat);
+    b.calc_csum(0, frag);
+    ASSERT_EQ(0, memcmp(a.csum_data.c_str(), b.csum_data.c_str(),
+			a.csum_data.length()));
+    int bad_off;
+    uint64_t bad_csum;
+    ASSERT_EQ(0, a.verify_csum(0, frag, &bad_off, &bad_csum));
+    ASSERT_EQ(-1, bad_off);
+    bp.c_str()[8192] ^= 1;  // shared with frag
+    ASSERT_EQ(-1, a.verify_csum(0, frag, &bad_off, &bad_csum));
+    ASSERT_EQ(8192, bad_off);
+    bp.c_str()[8192] ^= 1;
+  }
+}
+
 TEST(bluestore_blob_t, csum_bench)
 {
   bufferlist bl;
@@ -1598,6 +1638,83 @@ TEST(BlueStoreRepairer, StoreSpaceTracker)
   ASSERT_TRUE(bmap2.is_used(hoid, 0x3223b19ffff));
 }
 
+TEST(FrequencySketch, estimate)
+{
+  FrequencySketch s;
+  ASSERT_EQ(0u, s.estimate(1));
+  s.resize(1000);
+  ASSERT_EQ(1024u, s.size());
+  for (int i = 0; i < 5; ++i) {
+    s.increment(1);
+  }
+  s.increment(2);
+  ASSERT_GE(s.estimate(1), 5u);
+  ASSERT_GE(s.estimate(2), 1u);
+  ASSERT_LT(s.estimate(2), s.estimate(1));
+  // counters saturate
+  for (int i = 0; i < 100; ++i) {
+    s.increment(1);
+  }
+  ASSERT_EQ(15u, s.estimate(1));
+  // enough traffic halves everything
+  for (uint64_t i = 0; i < s.size() * 10; ++i) {
+    s.increment(1000 + i);
+  }
+  ASSERT_LT(s.estimate(1), 15u);
+}
+
+TEST(CacheArena, copy_in)
+{
+  auto arena = std::make_shared<CacheArena>(g_ceph_context, -1, false);
+  bufferlist a, b, big;
+  a.append(std::string(5000, 'a'));
+  b.append(std::string(100, 'b'));
+  b.append(std::string(100, 'c'));
+  big.append_zero(CacheArena::REGION_SIZE + 1);
+  bufferlist a0 = a, b0 = b;
+  ASSERT_TRUE(arena->copy_in(a));
+  ASSERT_TRUE(arena->copy_in(b));
+  ASSERT_FALSE(arena->copy_in(big));
+  ASSERT_TRUE(a.contents_equal(a0));
+  ASSERT_TRUE(b.contents_equal(b0));
+  ASSERT_EQ(1u, b.get_num_buffers());
+  // rounded up to 8 KiB and 4 KiB, out of one region
+  ASSERT_EQ(12288u, arena->get_used());
+  ASSERT_EQ(CacheArena::REGION_SIZE, arena->get_mapped());
+  ASSERT_EQ(8192u, a.front().raw_length());
+
+  // the buffers keep the arena alive
+  std::weak_ptr<CacheArena> w = arena;
+  arena.reset();
+  ASSERT_FALSE(w.expired());
+  a.clear();
+  ASSERT_EQ(4096u, w.lock()->get_used());
+  b.clear();
+  ASSERT_TRUE(w.expired());
+}
+
+TEST(CacheArena, regions)
+{
+  auto arena = std::make_shared<CacheArena>(g_ceph_context, -1, false);
+  std::vector<bufferlist> bls(3 * CacheArena::REGION_SIZE / 65536);
+  for (auto& bl : bls) {
+    bl.append_zero(65536);
+    ASSERT_TRUE(arena->copy_in(bl));
+  }
+  ASSERT_EQ(3 * CacheArena::REGION_SIZE, arena->get_mapped());
+  // all blocks of a region merge back into it, and empty regions but one
+  // are unmapped
+  for (auto& bl : bls) {
+    bl.clear();
+  }
+  ASSERT_EQ(0u, arena->get_used());
+  ASSERT_EQ(CacheArena::REGION_SIZE, arena->get_mapped());
+  bufferlist bl;
+  bl.append_zero(CacheArena::REGION_SIZE);
+  ASSERT_TRUE(arena->copy_in(bl));
+  ASSERT_EQ(CacheArena::REGION_SIZE, arena->get_mapped());
+}
+
 TEST(bluestore_blob_t, unused)
 {
   {
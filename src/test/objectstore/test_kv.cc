@@ -161,6 +161,31 @@ TEST_P(KVTest, PutReopen) {
   fini();
 }
 
+TEST_P(KVTest, MultiGet) {
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist value;
+    value.append("value");
+    t->set("prefix", "key1", value);
+    t->set("prefix", "key3", value);
+    t->set("other", "key2", value);
+    t->set("prefix", "empty", bufferlist());
+    db->submit_transaction_sync(t);
+  }
+  {
+    std::set<std::string> keys = {"empty", "key1", "key2", "key3", "key4"};
+    std::map<std::string, bufferlist> out;
+    ASSERT_EQ(0, db->get("prefix", keys, &out));
+    ASSERT_EQ(3u, out.size());
+    ASSERT_EQ(0u, out["empty"].length());
+    ASSERT_EQ("value", _bl_to_str(out["key1"]));
+    ASSERT_EQ("value", _bl_to_str(out["key3"]));
+    ASSERT_EQ(0u, out.count("key2"));
+  }
+  fini();
+}
+
 TEST_P(KVTest, BenchCommit) {
   int n = 1024;
   ASSERT_EQ(0, db->create_and_open(cout));
@@ -349,6 +374,95 @@ TEST_P(KVTest, ShardingRMRange) {
 }
 
 
+TEST_P(KVTest, RMRangeTombstone) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+  ASSERT_EQ(0, db->create_and_open(cout));
+  ASSERT_EQ(0, db->set_delete_range_threshold(1024));
+  // enough keys that the deletes below go through DeleteRange
+  const size_t n = 3000;
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist value;
+    value.append("value");
+    for (size_t i = 0; i < n; i++) {
+      char key[16];
+      snprintf(key, sizeof(key), "key%5.5ld", i);
+      t->set("prefix", key, value);
+      t->set("other", key, value);
+    }
+    db->submit_transaction_sync(t);
+  }
+
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("prefix", "key00100", "key02900");
+    t->rmkeys_by_prefix("other");
+    db->submit_transaction_sync(t);
+  }
+
+  size_t count = 0;
+  auto it = db->get_iterator("prefix");
+  for (it->seek_to_first(); it->valid(); it->next()) {
+    ++count;
+  }
+  ASSERT_EQ(200u, count);
+  bufferlist v;
+  ASSERT_EQ(0, db->get("prefix", "key00099", &v));
+  ASSERT_EQ(-ENOENT, db->get("prefix", "key00100", &v));
+  ASSERT_EQ(0, db->get("prefix", "key02900", &v));
+  it = db->get_iterator("other");
+  it->seek_to_first();
+  ASSERT_FALSE(it->valid());
+
+  fini();
+}
+
+TEST_P(KVTest, RocksDBReshard) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+  ASSERT_EQ(0, db->create_and_open(cout, "O(3) m"));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (size_t i = 0; i < 100; i++) {
+      bufferlist value;
+      value.append(stringify(i));
+      t->set("O", "key" + stringify(i), value);
+      t->set("m", "key" + stringify(i), value);
+      t->set("P", "key" + stringify(i), value);
+    }
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  fini();
+
+  // a different layout is refused unless resharding is asked for
+  init();
+  ASSERT_NE(0, db->open(cout, "O(5,0-4) P(2)"));
+  fini();
+  db.reset(KeyValueDB::create(g_ceph_context, string(GetParam()),
+			      "kv_test_temp_dir", {{"reshard", "1"}}));
+  ASSERT_EQ(0, db->open(cout, "O(5,0-4) P(2)"));
+  fini();
+
+  init();
+  ASSERT_NE(0, db->open(cout, "O(3) m"));
+  fini();
+  init();
+  ASSERT_EQ(0, db->open(cout, "O(5,0-4) P(2)"));
+  for (auto prefix : {"O", "m", "P"}) {
+    size_t n = 0;
+    auto it = db->get_iterator(prefix);
+    for (it->seek_to_first(); it->valid(); it->next()) {
+      ++n;
+    }
+    ASSERT_EQ(100u, n);
+    bufferlist v;
+    ASSERT_EQ(0, db->get(prefix, "key42", &v));
+    ASSERT_EQ("42", _bl_to_str(v));
+  }
+  fini();
+}
+
 TEST_P(KVTest, RocksDBColumnFamilyTest) {
   if(string(GetParam()) != "rocksdb")
     return;
@@ -0,0 +1,316 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Replay a transaction capture of a BlueStore OSD (see "bluestore txc
+ * capture start") into an object store, at the rate of the capture or a
+ * multiple of it, and report the commit latencies.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "os/ObjectStore.h"
+
+#include "global/global_init.h"
+
+#include "common/ceph_argparse.h"
+#include "common/errno.h"
+#include "common/Formatter.h"
+#include "common/perf_counters_collection.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_filestore
+
+using ceph::os::Transaction;
+using ceph::os::TransactionCapture;
+
+static void usage()
+{
+  cout << "usage: ceph_objectstore_replay --capture <file> [flags]\n"
+      "	 --capture\n"
+      "	       the transaction capture to replay\n"
+      "	 --rate-scale\n"
+      "	       replay at this multiple of the captured rate (default 1),\n"
+      "	       0 to queue the transactions as fast as the store takes them\n"
+      "	 --max-inflight\n"
+      "	       the most transaction batches waiting for commit (default 64)\n"
+      "	 --mkfs\n"
+      "	       replay into a new store instead of the one of osd_data; the\n"
+      "	       missing collections and clone sources are created on the way\n"
+      << std::endl;
+  generic_server_usage();
+}
+
+struct Config {
+  std::string capture;
+  double rate_scale = 1.0;
+  unsigned max_inflight = 64;
+  bool mkfs = false;
+};
+
+class Replayer {
+  ObjectStore *os;
+  const Config& cfg;
+
+  std::map<coll_t, ObjectStore::CollectionHandle> colls;
+
+  std::mutex lock;
+  std::condition_variable cond;
+  unsigned inflight = 0;
+  std::vector<double> commit_lat; // in seconds
+
+  class C_Committed : public Context {
+    Replayer *r;
+    ceph::mono_time start = ceph::mono_clock::now();
+  public:
+    explicit C_Committed(Replayer *r) : r(r) {}
+    void finish(int) override {
+      std::chrono::duration<double> lat = ceph::mono_clock::now() - start;
+      std::lock_guard l(r->lock);
+      r->commit_lat.push_back(lat.count());
+      --r->inflight;
+      r->cond.notify_all();
+    }
+  };
+
+  ObjectStore::CollectionHandle get_collection(const coll_t& cid,
+					       bool created) {
+    auto p = colls.find(cid);
+    if (p != colls.end()) {
+      return p->second;
+    }
+    auto ch = os->open_collection(cid);
+    if (!ch) {
+      if (!created && !cfg.mkfs) {
+	return ch;
+      }
+      ch = os->create_new_collection(cid);
+      if (!created) {
+	Transaction t;
+	t.create_collection(cid, 0);
+	os->queue_transaction(ch, std::move(t));
+      }
+    }
+    colls[cid] = ch;
+    return ch;
+  }
+
+  // the collections and clone sources a new store lacks
+  void prepare(std::vector<Transaction>& tls) {
+    for (auto& t : tls) {
+      std::set<coll_t> created;
+      for (auto i = t.begin(); i.have_op(); ) {
+	auto op = i.decode_op();
+	if (op->op == Transaction::OP_NOP) {
+	  continue;
+	}
+	const coll_t& cid = i.get_cid(op->cid);
+	if (op->op == Transaction::OP_MKCOLL) {
+	  created.insert(cid);
+	  get_collection(cid, true);
+	  continue;
+	}
+	if (created.count(cid) || !cfg.mkfs) {
+	  continue;
+	}
+	auto ch = get_collection(cid, false);
+	if (op->op == Transaction::OP_CLONE ||
+	    op->op == Transaction::OP_CLONERANGE ||
+	    op->op == Transaction::OP_CLONERANGE2) {
+	  const ghobject_t& oid = i.get_oid(op->oid);
+	  if (!os->exists(ch, oid)) {
+	    Transaction pt;
+	    pt.touch(cid, oid);
+	    os->queue_transaction(ch, std::move(pt));
+	  }
+	}
+      }
+    }
+  }
+
+public:
+  Replayer(ObjectStore *os, const Config& cfg) : os(os), cfg(cfg) {}
+
+  int replay(bufferlist& bl) {
+    auto p = bl.cbegin();
+    utime_t first;
+    auto start = ceph::mono_clock::now();
+    uint64_t batches = 0, ops = 0, bytes = 0;
+    while (!p.end()) {
+      TransactionCapture rec;
+      try {
+	rec.decode(p);
+      } catch (ceph::buffer::error& e) {
+	derr << "cannot decode the batch " << batches << " of the capture: "
+	     << e.what() << dendl;
+	return -EINVAL;
+      }
+      if (rec.tls.empty()) {
+	continue;
+      }
+      if (batches == 0) {
+	first = rec.stamp;
+      }
+      if (cfg.rate_scale > 0) {
+	double offset = (double)(rec.stamp - first) / cfg.rate_scale;
+	std::this_thread::sleep_until(start + ceph::make_timespan(offset));
+      }
+
+      prepare(rec.tls);
+      auto ch = get_collection(rec.cid, false);
+      if (!ch) {
+	derr << "the collection " << rec.cid << " does not exist, "
+	     << "replay into a copy of the captured store or use --mkfs"
+	     << dendl;
+	return -ENOENT;
+      }
+      for (auto& t : rec.tls) {
+	ops += t.get_num_ops();
+	bytes += t.get_num_bytes();
+      }
+      {
+	std::unique_lock l(lock);
+	cond.wait(l, [this] { return inflight < cfg.max_inflight; });
+	++inflight;
+      }
+      rec.tls.back().register_on_commit(new C_Committed(this));
+      os->queue_transactions(ch, rec.tls);
+      ++batches;
+    }
+    {
+      std::unique_lock l(lock);
+      cond.wait(l, [this] { return inflight == 0; });
+    }
+    std::chrono::duration<double> elapsed = ceph::mono_clock::now() - start;
+    report(elapsed.count(), batches, ops, bytes);
+    return 0;
+  }
+
+  void report(double elapsed, uint64_t batches, uint64_t ops,
+	      uint64_t bytes) {
+    std::sort(commit_lat.begin(), commit_lat.end());
+    auto percentile = [this](double pct) {
+      if (commit_lat.empty()) {
+	return 0.0;
+      }
+      size_t i = std::min(commit_lat.size() - 1,
+			  (size_t)(commit_lat.size() * pct / 100));
+      return commit_lat[i];
+    };
+    double sum = 0;
+    for (auto l : commit_lat) {
+      sum += l;
+    }
+
+    JSONFormatter f(true);
+    f.open_object_section("replay");
+    f.dump_float("elapsed", elapsed);
+    f.dump_unsigned("batches", batches);
+    f.dump_unsigned("ops", ops);
+    f.dump_unsigned("bytes", bytes);
+    f.open_object_section("commit_latency");
+    f.dump_float("avg", commit_lat.empty() ? 0 : sum / commit_lat.size());
+    f.dump_float("p50", percentile(50));
+    f.dump_float("p90", percentile(90));
+    f.dump_float("p99", percentile(99));
+    f.dump_float("p999", percentile(99.9));
+    f.dump_float("max", commit_lat.empty() ? 0 : commit_lat.back());
+    f.close_section();
+    // the latencies of the stages of the store
+    f.open_object_section("perf");
+    g_ceph_context->get_perfcounters_collection()->dump_formatted(&f, false);
+    f.close_section();
+    f.close_section();
+    f.flush(cout);
+    cout << std::endl;
+  }
+};
+
+int main(int argc, const char *argv[])
+{
+  Config cfg;
+
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+
+  if (args.empty()) {
+    cerr << argv[0] << ": -h or --help for usage" << std::endl;
+    exit(1);
+  }
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_OSD,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  std::string val;
+  vector<const char*>::iterator i = args.begin();
+  while (i != args.end()) {
+    if (ceph_argparse_double_dash(args, i))
+      break;
+
+    if (ceph_argparse_witharg(args, i, &val, "--capture", (char*)nullptr)) {
+      cfg.capture = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--rate-scale", (char*)nullptr)) {
+      cfg.rate_scale = atof(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--max-inflight", (char*)nullptr)) {
+      cfg.max_inflight = std::max(1, atoi(val.c_str()));
+    } else if (ceph_argparse_flag(args, i, "--mkfs", (char*)nullptr)) {
+      cfg.mkfs = true;
+    } else {
+      derr << "Error: can't understand argument: " << *i << "\n" << dendl;
+      exit(1);
+    }
+  }
+  if (cfg.capture.empty()) {
+    derr << "Error: --capture is required" << dendl;
+    exit(1);
+  }
+
+  common_init_finish(g_ceph_context);
+
+  bufferlist bl;
+  std::string err;
+  int r = bl.read_file(cfg.capture.c_str(), &err);
+  if (r < 0) {
+    derr << "cannot read " << cfg.capture << ": " << err << dendl;
+    return 1;
+  }
+
+  dout(0) << "objectstore " << g_conf()->osd_objectstore << dendl;
+  dout(0) << "data " << g_conf()->osd_data << dendl;
+  dout(0) << "capture " << cfg.capture << " (" << bl.length() << " bytes)"
+	  << dendl;
+  dout(0) << "rate-scale " << cfg.rate_scale << dendl;
+
+  auto os = std::unique_ptr<ObjectStore>(
+      ObjectStore::create(g_ceph_context,
+                          g_conf()->osd_objectstore,
+                          g_conf()->osd_data,
+                          g_conf()->osd_journal));
+  if (!os) {
+    derr << "bad objectstore type " << g_conf()->osd_objectstore << dendl;
+    return 1;
+  }
+  if (cfg.mkfs && os->mkfs() < 0) {
+    derr << "mkfs failed" << dendl;
+    return 1;
+  }
+  if (os->mount() < 0) {
+    derr << "mount failed" << dendl;
+    return 1;
+  }
+
+  r = Replayer(os.get(), cfg).replay(bl);
+  os->umount();
+  return r < 0 ? 1 : 0;
+}
@@ -56,5 +56,19 @@ TEST(ECUtil, stripe_info_t)
 
   ASSERT_EQ(s.offset_len_to_stripe_bounds(make_pair(swidth-10, (uint64_t)20)),
             make_pair((uint64_t)0, 2*swidth));
+
+  const uint64_t csize = s.get_chunk_size();
+  std::set<int> chunks;
+  s.offset_len_to_data_chunks(make_pair(swidth + csize, (uint64_t)10), &chunks);
+  ASSERT_EQ(chunks, std::set<int>({1}));
+  chunks.clear();
+  s.offset_len_to_data_chunks(make_pair(csize - 1, csize + 2), &chunks);
+  ASSERT_EQ(chunks, std::set<int>({0, 1, 2}));
+  chunks.clear();
+  s.offset_len_to_data_chunks(make_pair(swidth - 10, (uint64_t)20), &chunks);
+  ASSERT_EQ(chunks, std::set<int>({0, 3}));
+  chunks.clear();
+  s.offset_len_to_data_chunks(make_pair(csize, swidth), &chunks);
+  ASSERT_EQ(chunks, std::set<int>({0, 1, 2, 3}));
 }
 
@@ -154,3 +154,34 @@ TEST_F(mClockSchedulerTest, TestMultiClientOrderedEnqueueDequeue) {
   }
   ASSERT_TRUE(q.empty());
 }
+
+TEST_F(mClockSchedulerTest, TestCostPerIo) {
+  mClockScheduler sq(g_ceph_context, [] { return 4096; });
+  ASSERT_EQ(4096u, sq.get_cost_per_io());
+  ASSERT_EQ(1u, sq.calc_cost(0));
+  ASSERT_EQ(1u, sq.calc_cost(4095));
+  ASSERT_EQ(10u, sq.calc_cost(9 * 4096));
+
+  // client1 issues ops ten times the cost of client2's, with the same
+  // weight it gets about a tenth of the dequeues
+  for (unsigned i = 0; i < 100; ++i) {
+    sq.enqueue(OpSchedulerItem(
+      std::make_unique<MockDmclockItem>(op_scheduler_class::client),
+      9 * 4096, 12, utime_t(), client1, i));
+    sq.enqueue(OpSchedulerItem(
+      std::make_unique<MockDmclockItem>(op_scheduler_class::client),
+      0, 12, utime_t(), client2, i));
+  }
+  std::map<uint64_t, unsigned> dequeued;
+  for (unsigned i = 0; i < 44; ++i) {
+    ASSERT_FALSE(sq.empty());
+    ++dequeued[sq.dequeue().get_owner()];
+  }
+  ASSERT_GT(dequeued[client2], 3 * dequeued[client1]);
+}
+
+TEST_F(mClockSchedulerTest, TestCostPerIoUnknown) {
+  // without an estimate all ops cost the same
+  ASSERT_EQ(0u, q.get_cost_per_io());
+  ASSERT_EQ(1u, q.calc_cost(1 << 20));
+}
@@ -525,6 +525,170 @@ TEST_F(OSDMapTest, PrimaryAffinity) {
   }
 }
 
+TEST_F(OSDMapTest, CrushResultCache) {
+  set_up_map(12);
+  OSDMap nocache;
+  nocache.deepish_copy_from(osdmap);
+  nocache.set_crush_cache_size(0);
+  osdmap.set_crush_cache_size(1024);
+
+  auto check = [&]() {
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+	pg_t pgid(ps, poolid);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	nocache.pg_to_up_acting_osds(pgid, &up2, &up_primary2,
+				     &acting2, &acting_primary2);
+	ASSERT_EQ(up2, up) << pgid;
+	ASSERT_EQ(acting2, acting) << pgid;
+      }
+    }
+  };
+  auto apply = [&](OSDMap::Incremental& inc) {
+    osdmap.apply_incremental(inc);
+    nocache.apply_incremental(inc);
+  };
+
+  // fill the cache, then hit it; more pgs than entries
+  check();
+  check();
+
+  // weight changes drop the results of the rules reaching the osd
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_weight[3] = CEPH_OSD_OUT;
+    inc.new_weight[4] = 0x8000;
+    apply(inc);
+  }
+  check();
+
+  // a copy shares the cache until the next weight change
+  OSDMap copy;
+  copy.deepish_copy_from(osdmap);
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_weight[3] = CEPH_OSD_IN;
+    apply(inc);
+  }
+  check();
+  {
+    vector<int> up, acting;
+    int up_primary, acting_primary;
+    for (unsigned ps = 0; ps < 64; ++ps) {
+      pg_t pgid(ps, my_rep_pool);
+      copy.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				&acting, &acting_primary);
+      for (auto osd : up) {
+	ASSERT_NE(3, osd);
+      }
+    }
+  }
+
+  // so do crush changes
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    CrushWrapper crush;
+    get_crush(osdmap, crush);
+    crush.adjust_item_weightf(g_ceph_context, 5, 0.25);
+    crush.encode(inc.crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    apply(inc);
+  }
+  check();
+}
+
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map(12);
+
+  ThreadPool tp(g_ceph_context, "IncrementalMapping", "inc_map_tp", 2);
+  tp.start();
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  OSDMapMapping::Changes changes;
+  auto remap = [&]() {
+    auto job = mapping.start_update(osdmap, mapper, 16, changes);
+    job->wait();
+    changes.reset(osdmap.get_epoch());
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+	pg_t pgid(ps, poolid);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2) << pgid;
+	ASSERT_EQ(up_primary, up_primary2) << pgid;
+	ASSERT_EQ(acting, acting2) << pgid;
+	ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+  };
+  auto apply = [&](OSDMap::Incremental& inc) {
+    osdmap.apply_incremental(inc);
+    mapping.note_incremental(osdmap, inc, &changes);
+  };
+
+  remap();
+
+  // osd down
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_state[3] = CEPH_OSD_UP;
+    apply(inc);
+  }
+  ASSERT_FALSE(changes.all);
+  ASSERT_FALSE(changes.pgs.empty());
+  ASSERT_GT(mapping.get_num_pgs(), changes.pgs.size());
+  remap();
+
+  // the down osd out, and a pg_temp and an upmap
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_weight[3] = CEPH_OSD_OUT;
+    inc.new_pg_temp[pg_t(1, my_rep_pool)] = {0, 1, 2};
+    inc.new_pg_upmap_items[pg_t(2, my_rep_pool)] = {{0, 11}, {1, 11}};
+    apply(inc);
+  }
+  ASSERT_FALSE(changes.all);
+  remap();
+
+  // two incrementals at once: an up osd out, then primary affinity
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_weight[5] = CEPH_OSD_OUT;
+    apply(inc);
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_primary_affinity[7] = 0;
+    apply(inc);
+  }
+  ASSERT_FALSE(changes.all);
+  remap();
+
+  // marking in can move anything
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.fsid = osdmap.get_fsid();
+    inc.new_weight[5] = CEPH_OSD_IN;
+    apply(inc);
+  }
+  ASSERT_TRUE(changes.all);
+  remap();
+
+  tp.stop();
+}
+
 TEST_F(OSDMapTest, get_osd_crush_node_flags) {
   set_up_map();
 
@@ -537,6 +537,80 @@ TEST_F(PGLogTest, rewind_divergent_log) {
   }
 }
 
+TEST_F(PGLogTest, roll_forward_releases_rollback_info) {
+  clear();
+
+  for (unsigned i = 1; i <= 3; ++i) {
+    pg_log_entry_t e;
+    e.version = eversion_t(1, i);
+    e.soid.set_hash(i);
+    e.mod_desc.rmobject(i);
+    log.add(e);
+  }
+
+  struct RollforwardHandler : public TestHandler {
+    unsigned rolled_forward = 0;
+    using TestHandler::TestHandler;
+    void rollforward(
+      const pg_log_entry_t &entry) override {
+      // the rollback info is still there for the handler
+      EXPECT_NE(0u, entry.mod_desc.bl.length());
+      ++rolled_forward;
+    }
+  };
+  list<hobject_t> removed;
+  RollforwardHandler h(removed);
+  roll_forward_to(eversion_t(1, 2), &h);
+
+  EXPECT_EQ(2u, h.rolled_forward);
+  for (auto& e : log.log) {
+    EXPECT_TRUE(e.can_rollback());
+    if (e.version <= eversion_t(1, 2)) {
+      EXPECT_EQ(0u, e.mod_desc.bl.length());
+    } else {
+      EXPECT_NE(0u, e.mod_desc.bl.length());
+    }
+  }
+}
+
+TEST_F(PGLogTest, write_rollback_bounds_when_changed) {
+  clear();
+
+  ObjectStore::Transaction t;
+  coll_t coll(spg_t(pg_t(1, 1)));
+  hobject_t hoid;
+  hoid.pool = 1;
+  hoid.oid = "log";
+  ghobject_t log_oid(hoid);
+  map<string, bufferlist> km;
+
+  pg_log_entry_t e;
+  e.version = eversion_t(1, 1);
+  e.soid.set_hash(1);
+  add(e);
+  // the first write puts them anyway
+  write_log_and_missing(t, &km, coll, log_oid, true);
+  EXPECT_EQ(1u, km.count("can_rollback_to"));
+  EXPECT_EQ(1u, km.count("rollback_info_trimmed_to"));
+
+  e.version = eversion_t(1, 2);
+  e.soid.set_hash(2);
+  add(e);
+  km.clear();
+  write_log_and_missing(t, &km, coll, log_oid, true);
+  EXPECT_EQ(1u, km.count(e.get_key_name()));
+  EXPECT_EQ(0u, km.count("can_rollback_to"));
+  EXPECT_EQ(0u, km.count("rollback_info_trimmed_to"));
+
+  list<hobject_t> removed;
+  TestHandler h(removed);
+  roll_forward_to(eversion_t(1, 2), &h);
+  km.clear();
+  write_log_and_missing(t, &km, coll, log_oid, true);
+  EXPECT_EQ(1u, km.count("can_rollback_to"));
+  EXPECT_EQ(1u, km.count("rollback_info_trimmed_to"));
+}
+
 TEST_F(PGLogTest, merge_old_entry) {
   // entries > last_backfill are silently ignored
   {
@@ -2333,6 +2407,28 @@ public:
   }
 };
 
+TEST_F(PGLogTestRebuildMissing, MissingKeepsCleanRegions) {
+  pg_log_entry_t e = mk_ple_mod(existing_oid, mk_evt(6, 3), mk_evt(6, 2));
+  e.clean_regions.mark_data_region_dirty(4096, 4096);
+  missing.add_next_event(e);
+
+  ObjectStore::Transaction t;
+  ghobject_t log_oid(mk_obj(2));
+  map<string, bufferlist> km;
+  write_log_and_missing(t, &km, test_coll, log_oid, false);
+  t.omap_setkeys(test_coll, log_oid, km);
+  ASSERT_EQ(0, store->queue_transaction(ch, std::move(t)));
+
+  clear();
+  ostringstream err;
+  read_log_and_missing(store.get(), ch, log_oid, info, err, false);
+  ASSERT_TRUE(missing.is_missing(existing_oid));
+  interval_set<uint64_t> dirty;
+  dirty.insert(4096, 4096);
+  EXPECT_EQ(dirty,
+	    missing.get_items().at(existing_oid).clean_regions.get_dirty_regions());
+}
+
 TEST_F(PGLogTestRebuildMissing, EmptyLog) {
   missing.add(existing_oid, mk_evt(6, 2), mk_evt(6, 3), false);
   missing.add(nonexistent_oid, mk_evt(7, 4), mk_evt(0, 0), false);
@@ -27,6 +27,7 @@
 #include "global/global_context.h"
 #include "global/global_init.h"
 #include "include/msgr.h" // for CEPH_ENTITY_TYPE_CLIENT
+#include "include/stringify.h"
 #include "gtest/gtest.h"
 
 #include <errno.h>
@@ -252,4 +253,102 @@ TEST(PerfCounters, read_avg) {
   std::thread t2(counters_readavg_test, fake_pf);
   t2.join();
   t1.join();
-}
\ No newline at end of file
+}
+enum {
+  TEST_PERFCOUNTERS4_ELEMENT_FIRST = 500,
+  TEST_PERFCOUNTERS4_ELEMENT_COUNT,
+  TEST_PERFCOUNTERS4_ELEMENT_LAT,
+  TEST_PERFCOUNTERS4_ELEMENT_GAUGE,
+  TEST_PERFCOUNTERS4_ELEMENT_LAST,
+};
+
+TEST(PerfCounters, striped) {
+  PerfCountersBuilder bld(g_ceph_context, "test_perfcounter_4",
+      TEST_PERFCOUNTERS4_ELEMENT_FIRST, TEST_PERFCOUNTERS4_ELEMENT_LAST);
+  bld.set_striped(true);
+  bld.add_u64_counter(TEST_PERFCOUNTERS4_ELEMENT_COUNT, "count");
+  bld.add_time_avg(TEST_PERFCOUNTERS4_ELEMENT_LAT, "lat");
+  bld.add_u64(TEST_PERFCOUNTERS4_ELEMENT_GAUGE, "gauge");
+  std::unique_ptr<PerfCounters> pc(bld.create_perf_counters());
+
+  // more threads than stripes, so that some of them share one
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < PerfCounters::STRIPES + 3; ++t) {
+    threads.emplace_back([&pc] {
+      for (int i = 0; i < 1000; ++i) {
+	pc->inc(TEST_PERFCOUNTERS4_ELEMENT_COUNT);
+	pc->tinc(TEST_PERFCOUNTERS4_ELEMENT_LAT, ceph::make_timespan(0.000000001));
+	pc->inc(TEST_PERFCOUNTERS4_ELEMENT_GAUGE, 2);
+	pc->dec(TEST_PERFCOUNTERS4_ELEMENT_GAUGE, 1);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  const uint64_t n = (PerfCounters::STRIPES + 3) * 1000;
+  ASSERT_EQ(n, pc->get(TEST_PERFCOUNTERS4_ELEMENT_COUNT));
+  ASSERT_EQ(n, pc->get(TEST_PERFCOUNTERS4_ELEMENT_GAUGE));
+  auto lat = pc->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_LAT);
+  ASSERT_EQ(n, lat.first);
+  ASSERT_EQ(n, lat.second);
+
+  pc->set(TEST_PERFCOUNTERS4_ELEMENT_COUNT, 5);
+  ASSERT_EQ(5u, pc->get(TEST_PERFCOUNTERS4_ELEMENT_COUNT));
+  pc->inc(TEST_PERFCOUNTERS4_ELEMENT_COUNT);
+  ASSERT_EQ(6u, pc->get(TEST_PERFCOUNTERS4_ELEMENT_COUNT));
+  pc->reset();
+  ASSERT_EQ(0u, pc->get(TEST_PERFCOUNTERS4_ELEMENT_COUNT));
+  ASSERT_EQ(0u, pc->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_LAT).second);
+}
+
+TEST(PerfCounters, publish_shm) {
+  using ceph::common::PerfCountersShm;
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  std::string path = "/tmp/test_perf_counters_shm." + stringify(getpid());
+  // the service thread publishes along with us
+  g_ceph_context->_conf.set_val("perf_shm_path", path);
+  PerfCounters* fake_pf1 = setup_test_perfcounters1(g_ceph_context);
+  coll->add(fake_pf1);
+  fake_pf1->inc(TEST_PERFCOUNTERS1_ELEMENT_1, 7);
+  fake_pf1->tinc(TEST_PERFCOUNTERS1_ELEMENT_3, utime_t(2, 0));
+  fake_pf1->tinc(TEST_PERFCOUNTERS1_ELEMENT_3, utime_t(4, 0));
+  ASSERT_EQ(0, coll->publish_shm(path));
+
+  std::vector<PerfCountersShm::value_t> values;
+  uint64_t stamp = 0;
+  ASSERT_EQ(0, PerfCountersShm::read(path, &values, &stamp));
+  ASSERT_NE(0u, stamp);
+  std::map<std::string, PerfCountersShm::value_t> by_path;
+  for (auto& v : values) {
+    by_path[v.path] = v;
+  }
+  ASSERT_EQ(3u, by_path.size());
+  ASSERT_EQ(7u, by_path["test_perfcounter_1.element1"].value);
+  ASSERT_EQ(PERFCOUNTER_U64, by_path["test_perfcounter_1.element1"].type);
+  ASSERT_EQ(6000000000u, by_path["test_perfcounter_1.element3"].value);
+  ASSERT_EQ(2u, by_path["test_perfcounter_1.element3"].count);
+
+  // values are updated in place
+  fake_pf1->inc(TEST_PERFCOUNTERS1_ELEMENT_1);
+  ASSERT_EQ(0, coll->publish_shm(path));
+  ASSERT_EQ(0, PerfCountersShm::read(path, &values));
+  for (auto& v : values) {
+    if (v.path == "test_perfcounter_1.element1") {
+      ASSERT_EQ(8u, v.value);
+    }
+  }
+
+  // new counters replace the file
+  PerfCounters* fake_pf2 = setup_test_perfcounter2(g_ceph_context);
+  coll->add(fake_pf2);
+  ASSERT_EQ(0, coll->publish_shm(path));
+  ASSERT_EQ(0, PerfCountersShm::read(path, &values));
+  ASSERT_EQ(5u, values.size());
+
+  g_ceph_context->_conf.set_val("perf_shm_path", "");
+  ASSERT_EQ(0, coll->publish_shm(""));
+  ASSERT_EQ(-ENOENT, PerfCountersShm::read(path, &values));
+  coll->clear();
+}
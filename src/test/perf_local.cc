@@ -52,6 +52,7 @@
 #include "common/Thread.h"
 #include "common/Timer.h"
 #include "msg/async/Event.h"
+#include "osdc/Striper.h"
 #include "global/global_init.h"
 
 #include "test/perf_helper.h"
@@ -878,6 +879,37 @@ double perf_ceph_clock_now()
   return Cycles::to_seconds(stop - start)/count;
 }
 
+// Measure the cost of mapping a 64KB file extent, which crosses an object
+// boundary every so often, onto objects.
+double striper_file_to_extents(uint32_t stripe_unit, uint32_t stripe_count)
+{
+  int count = 100000;
+  file_layout_t layout;
+  layout.object_size = 4 << 20;
+  layout.stripe_unit = stripe_unit;
+  layout.stripe_count = stripe_count;
+  uint64_t len = 64 << 10;
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < count; i++) {
+    striper::LightweightObjectExtents extents;
+    Striper::file_to_extents(g_ceph_context, &layout, i * (len + 4096), len,
+                             0, 0, &extents);
+    discard(&extents.front().length);
+  }
+  uint64_t stop = Cycles::rdtsc();
+  return Cycles::to_seconds(stop - start)/count;
+}
+
+double striper_unstriped()
+{
+  return striper_file_to_extents(4 << 20, 1);
+}
+
+double striper_striped()
+{
+  return striper_file_to_extents(16 << 10, 4);
+}
+
 // The following struct and table define each performance test in terms of
 // a string name and a function that implements the test.
 struct TestInfo {
@@ -950,6 +982,10 @@ TestInfo tests[] = {
     "Lfence instruction"},
   {"sfence", sfence,
     "Sfence instruction"},
+  {"striper_unstriped", striper_unstriped,
+    "Map 64KB onto objects, stripe_count 1"},
+  {"striper_striped", striper_striped,
+    "Map 64KB onto objects, 16KB x 4 stripes"},
   {"spin_lock", test_spinlock,
     "Acquire/release SpinLock"},
   {"spawn_thread", spawn_thread,
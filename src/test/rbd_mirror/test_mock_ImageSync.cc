@@ -72,10 +72,12 @@ struct Threads<librbd::MockTestImageCtx> {
   ceph::mutex &timer_lock;
   SafeTimer *timer;
   ContextWQ *work_queue;
+  TransferScheduler *transfer_scheduler;
 
   Threads(Threads<librbd::ImageCtx> *threads)
     : timer_lock(threads->timer_lock), timer(threads->timer),
-      work_queue(threads->work_queue) {
+      work_queue(threads->work_queue),
+      transfer_scheduler(threads->transfer_scheduler) {
   }
 };
 
@@ -170,6 +172,8 @@ public:
   void expect_get_snap_id(librbd::MockTestImageCtx &mock_image_ctx) {
     EXPECT_CALL(mock_image_ctx, get_snap_id(_, _))
       .WillOnce(Return(123));
+    EXPECT_CALL(mock_image_ctx, get_object_count(123))
+      .WillRepeatedly(Return(1));
   }
 
   void expect_notify_sync_request(MockInstanceWatcher &mock_instance_watcher,
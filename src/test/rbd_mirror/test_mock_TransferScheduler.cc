@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/rbd_mirror/test_mock_fixture.h"
+#include "common/Cond.h"
+#include "tools/rbd_mirror/Threads.h"
+#include "tools/rbd_mirror/TransferScheduler.h"
+
+namespace rbd {
+namespace mirror {
+
+class TestMockTransferScheduler : public TestMockFixture {
+public:
+  TransferScheduler *create_scheduler() {
+    return new TransferScheduler(g_ceph_context, m_threads->timer,
+                                 &m_threads->timer_lock,
+                                 m_threads->work_queue);
+  }
+};
+
+TEST_F(TestMockTransferScheduler, Unlimited) {
+  std::unique_ptr<TransferScheduler> scheduler(create_scheduler());
+  scheduler->set_limits(0, 0);
+
+  C_SaferCond on_start1;
+  scheduler->start_transfer(1, &on_start1);
+  C_SaferCond on_start2;
+  scheduler->start_transfer(2, &on_start2);
+  ASSERT_EQ(0, on_start1.wait());
+  ASSERT_EQ(0, on_start2.wait());
+
+  scheduler->handle_transferred(1 << 20);
+  scheduler->finish_transfer();
+  scheduler->finish_transfer();
+}
+
+TEST_F(TestMockTransferScheduler, MaxConcurrentTransfers) {
+  std::unique_ptr<TransferScheduler> scheduler(create_scheduler());
+  scheduler->set_limits(1, 0);
+
+  C_SaferCond on_start1;
+  scheduler->start_transfer(1, &on_start1);
+  C_SaferCond on_start2;
+  scheduler->start_transfer(2, &on_start2);
+  C_SaferCond on_start3;
+  scheduler->start_transfer(3, &on_start3);
+  C_SaferCond on_start4;
+  scheduler->start_transfer(1, &on_start4);
+
+  // held back transfers are started by priority, then in order
+  ASSERT_EQ(0, on_start1.wait());
+  scheduler->finish_transfer();
+  ASSERT_EQ(0, on_start3.wait());
+  scheduler->finish_transfer();
+  ASSERT_EQ(0, on_start2.wait());
+  scheduler->finish_transfer();
+  ASSERT_EQ(0, on_start4.wait());
+  scheduler->finish_transfer();
+}
+
+TEST_F(TestMockTransferScheduler, BytesPerSecond) {
+  std::unique_ptr<TransferScheduler> scheduler(create_scheduler());
+  scheduler->set_limits(0, 1000);
+
+  C_SaferCond on_start1;
+  scheduler->start_transfer(1, &on_start1);
+  ASSERT_EQ(0, on_start1.wait());
+  scheduler->handle_transferred(1200);
+
+  // held back until the bytes owed are paid off
+  auto start = ceph::mono_clock::now();
+  C_SaferCond on_start2;
+  scheduler->start_transfer(1, &on_start2);
+  ASSERT_EQ(0, on_start2.wait());
+  ASSERT_LE(std::chrono::milliseconds(100),
+            ceph::mono_clock::now() - start);
+
+  scheduler->finish_transfer();
+  scheduler->finish_transfer();
+}
+
+} // namespace mirror
+} // namespace rbd
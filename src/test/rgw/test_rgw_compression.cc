@@ -182,3 +182,45 @@ TEST(Compress, BillionZeros)
 
   ASSERT_EQ(d_sink.get_sink().length() , size*1000);
 }
+
+TEST(Compress, ParallelChunksInOrder)
+{
+  CompressorRef plugin;
+  ut_put_sink c_sink;
+  plugin = Compressor::create(g_ceph_context, Compressor::COMP_ALG_ZLIB);
+  ASSERT_NE(plugin.get(), nullptr);
+  RGWPutObj_Compress compressor(g_ceph_context, plugin, &c_sink);
+
+  // chunks of different contents, compressed by the workers at once
+  constexpr size_t size = 100000;
+  constexpr int chunks = 32;
+  bufferlist orig;
+  for (int i = 0; i < chunks; i++) {
+    bufferlist bl;
+    bl.append_zero(size);
+    memset(bl.c_str(), 'a' + i % 26, size / 2);
+    orig.append(bl);
+    ASSERT_EQ(0, compressor.process(std::move(bl), size*i));
+  }
+  ASSERT_EQ(0, compressor.process({}, size*chunks)); // flush
+  ASSERT_TRUE(compressor.is_compressed());
+
+  RGWCompressionInfo cs_info;
+  cs_info.compression_type = plugin->get_type_name();
+  cs_info.orig_size = size*chunks;
+  cs_info.blocks = move(compressor.get_compression_blocks());
+  ASSERT_EQ((size_t)chunks, cs_info.blocks.size());
+
+  ut_get_sink d_sink;
+  RGWGetObj_Decompress decompress(g_ceph_context, &cs_info, false, &d_sink);
+
+  off_t f_begin = 0;
+  off_t f_end = size*chunks - 1;
+  decompress.fixup_range(f_begin, f_end);
+
+  decompress.handle_data(c_sink.get_sink(), 0, c_sink.get_sink().length());
+  bufferlist empty;
+  decompress.handle_data(empty, 0, 0);
+
+  ASSERT_TRUE(d_sink.get_sink().contents_equal(orig));
+}
@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+#include "common/ceph_context.h"
+#include "global/global_context.h"
+#include "rgw/rgw_d3n_datacache.h"
+
+using ceph::bufferlist;
+
+class D3nDataCacheTest : public ::testing::Test {
+protected:
+  std::string path;
+  std::unique_ptr<D3nDataCache> cache;
+
+  void SetUp() override {
+    path = "/tmp/test_rgw_d3n_datacache." + std::to_string(::getpid());
+    g_ceph_context->_conf.set_val_or_die("rgw_d3n_l1_datacache_persistent_path", path);
+    g_ceph_context->_conf.set_val_or_die("rgw_d3n_l1_datacache_size", "64");
+    cache = std::make_unique<D3nDataCache>(g_ceph_context);
+    ASSERT_EQ(0, cache->init());
+  }
+  void TearDown() override {
+    cache.reset();
+    std::string cmd = "rm -rf " + path;
+    ASSERT_EQ(0, ::system(cmd.c_str()));
+  }
+
+  // the fills are asynchronous
+  bool wait_for(const std::string& key, uint64_t len, bufferlist *bl) {
+    for (int i = 0; i < 500; ++i) {
+      bl->clear();
+      if (cache->get(key, 0, len, bl)) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+};
+
+static bufferlist make_data(char c, unsigned len)
+{
+  bufferlist bl;
+  bl.append(std::string(len, c));
+  return bl;
+}
+
+TEST_F(D3nDataCacheTest, ReadThrough)
+{
+  const auto key = D3nDataCache::get_key("pool", "bucket_prefix/tail_1");
+  bufferlist bl;
+  ASSERT_FALSE(cache->get(key, 0, 8, &bl));
+
+  cache->put(key, make_data('a', 32));
+  ASSERT_TRUE(wait_for(key, 32, &bl));
+  ASSERT_EQ(make_data('a', 32), bl);
+
+  // a range within the cached bytes
+  bl.clear();
+  ASSERT_TRUE(cache->get(key, 8, 16, &bl));
+  ASSERT_EQ(make_data('a', 16), bl);
+  // beyond them
+  bl.clear();
+  ASSERT_FALSE(cache->get(key, 24, 16, &bl));
+}
+
+TEST_F(D3nDataCacheTest, EvictLeastRecentlyUsed)
+{
+  const auto key1 = D3nDataCache::get_key("pool", "tail_1");
+  const auto key2 = D3nDataCache::get_key("pool", "tail_2");
+  const auto key3 = D3nDataCache::get_key("pool", "tail_3");
+  bufferlist bl;
+
+  cache->put(key1, make_data('a', 32));
+  ASSERT_TRUE(wait_for(key1, 32, &bl));
+  cache->put(key2, make_data('b', 32));
+  ASSERT_TRUE(wait_for(key2, 32, &bl));
+  // key1 is used after key2
+  bl.clear();
+  ASSERT_TRUE(cache->get(key1, 0, 32, &bl));
+
+  cache->put(key3, make_data('c', 32));
+  ASSERT_TRUE(wait_for(key3, 32, &bl));
+  bl.clear();
+  ASSERT_FALSE(cache->get(key2, 0, 32, &bl));
+  ASSERT_TRUE(cache->get(key1, 0, 32, &bl));
+}
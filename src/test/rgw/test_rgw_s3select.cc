@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#include "gtest/gtest.h"
+
+#include <boost/crc.hpp>
+
+#include "rgw/rgw_s3select.h"
+
+using namespace rgw::s3select;
+
+static std::string run(const std::string& sql, const std::string& data,
+                       const CSVInput& input = CSVInput(),
+                       size_t chunk = 7)
+{
+  Query query;
+  std::string err;
+  EXPECT_TRUE(parse_query(sql, &query, &err)) << err;
+  CSVScanner scanner(query, input, CSVOutput());
+  std::string out;
+  // records are cut at the ends of the chunks
+  for (size_t ofs = 0; ofs < data.size(); ofs += chunk) {
+    EXPECT_TRUE(scanner.process(data.data() + ofs,
+                                std::min(chunk, data.size() - ofs), out))
+      << scanner.get_error();
+  }
+  EXPECT_TRUE(scanner.finish(out)) << scanner.get_error();
+  return out;
+}
+
+static const std::string people =
+  "name,age,city\n"
+  "alice,34,paris\n"
+  "bob,27,\"new york, ny\"\n"
+  "carol,45,berlin\n"
+  "dave,19,paris";
+
+TEST(S3Select, SelectAll)
+{
+  EXPECT_EQ("a,b\nc,d\n", run("select * from s3object", "a,b\nc,d\n"));
+  EXPECT_EQ("a,b\nc,d\n", run("SELECT * FROM S3Object", "a,b\r\nc,d"));
+}
+
+TEST(S3Select, Where)
+{
+  CSVInput input;
+  input.header = CSVInput::Header::USE;
+  EXPECT_EQ("alice\ndave\n",
+            run("select name from s3object where city = 'paris'", people, input));
+  EXPECT_EQ("bob,\"new york, ny\"\n",
+            run("select s.name, s.city from s3object s where s.age < 30 and "
+                "city like 'new%'", people, input));
+  EXPECT_EQ("carol\n",
+            run("select _1 from s3object where cast(_2 as int) between 40 and 50",
+                people, input));
+  EXPECT_EQ("alice\n",
+            run("select name from s3object where name in ('alice', 'eve') "
+                "limit 5", people, input));
+  EXPECT_EQ("bob\ncarol\n",
+            run("select name from s3object where not city = 'paris'",
+                people, input));
+}
+
+TEST(S3Select, HeaderIgnore)
+{
+  CSVInput input;
+  input.header = CSVInput::Header::IGNORE;
+  EXPECT_EQ("ALICE,35\n",
+            run("select upper(_1), _2 + 1 from s3object limit 1", people, input));
+}
+
+TEST(S3Select, Aggregates)
+{
+  CSVInput input;
+  input.header = CSVInput::Header::USE;
+  EXPECT_EQ("4,125,19,45,31.25\n",
+            run("select count(*), sum(age), min(cast(age as int)), "
+                "max(cast(age as int)), avg(age) from s3object", people, input));
+  EXPECT_EQ("2\n",
+            run("select count(*) from s3object where city = 'paris'",
+                people, input));
+}
+
+TEST(S3Select, Quotes)
+{
+  EXPECT_EQ("\"a\"\"b\",\"c\nd\"\n",
+            run("select * from s3object", "\"a\"\"b\",\"c\nd\"\n", CSVInput(), 3));
+}
+
+TEST(S3Select, Errors)
+{
+  Query query;
+  std::string err;
+  EXPECT_FALSE(parse_query("select from s3object", &query, &err));
+  Query q2;
+  EXPECT_FALSE(parse_query("select _1, count(*) from s3object", &q2, &err));
+  Query q3;
+  EXPECT_FALSE(parse_query("select * from table", &q3, &err));
+
+  Query q4;
+  ASSERT_TRUE(parse_query("select name from s3object", &q4, &err));
+  CSVScanner scanner(q4, CSVInput(), CSVOutput());
+  std::string out;
+  const std::string data = "a,b\n";
+  EXPECT_FALSE(scanner.process(data.data(), data.size(), out));
+}
+
+TEST(S3Select, EndEvent)
+{
+  std::string out;
+  append_end_event(out);
+  ASSERT_GE(out.size(), 16u);
+  auto be32 = [&out] (size_t ofs) {
+    return (uint32_t(uint8_t(out[ofs])) << 24) | (uint32_t(uint8_t(out[ofs + 1])) << 16) |
+      (uint32_t(uint8_t(out[ofs + 2])) << 8) | uint32_t(uint8_t(out[ofs + 3]));
+  };
+  EXPECT_EQ(out.size(), be32(0));
+  EXPECT_EQ(out.size() - 16, be32(4));
+  boost::crc_32_type crc;
+  crc.process_bytes(out.data(), out.size() - 4);
+  EXPECT_EQ(crc.checksum(), be32(out.size() - 4));
+  EXPECT_NE(std::string::npos, out.find(":event-type"));
+  EXPECT_NE(std::string::npos, out.find("End"));
+}
@@ -388,6 +388,25 @@ TEST(mempool, btree_map_test)
 }
 
 
+TEST(mempool, sampled)
+{
+  mempool::set_sample_shift(3);
+  size_t items = mempool::osd::allocated_items();
+  {
+    mempool::osd::list<int> l;
+    for (int i = 0; i < 100000; ++i) {
+      l.push_back(i);
+    }
+    // 1 in 8 nodes accounted for as 8
+    size_t sampled = mempool::osd::allocated_items() - items;
+    ASSERT_LT(80000u, sampled);
+    ASSERT_GT(120000u, sampled);
+  }
+  // each node is accounted for when freed iff it was when allocated
+  ASSERT_EQ(items, mempool::osd::allocated_items());
+  mempool::set_sample_shift(0);
+}
+
 
 int main(int argc, char **argv)
 {
@@ -17,7 +17,9 @@
 #include <stdint.h>
 #include <boost/foreach.hpp>
 #include <cstdarg>
+#include "rbd_replay/ActionTypes.h"
 #include "rbd_replay/ImageNameMap.hpp"
+#include "rbd_replay/actions.hpp"
 #include "rbd_replay/ios.hpp"
 #include "rbd_replay/rbd_loc.hpp"
 
@@ -132,3 +134,20 @@ TEST(RBDReplay, rbd_loc_parse) {
   EXPECT_FALSE(m.parse("a@b/c"));
 }
 
+TEST(RBDReplay, action_start_time) {
+  bufferlist bl;
+  ReadIO io(2, 123456789, 1, io_set_t(), 3, 4096, 512);
+  io.encode(bl);
+
+  action::ActionEntry entry;
+  auto it = bl.cbegin();
+  entry.decode(it);
+  EXPECT_TRUE(entry.is_timed());
+  EXPECT_EQ(123456789U, entry.start_time);
+
+  Action::ptr action = Action::construct(entry);
+  ASSERT_TRUE(action);
+  EXPECT_TRUE(action->is_timed());
+  EXPECT_EQ(123456789U, action->start_time());
+  EXPECT_STREQ("ReadAction", action->get_action_name());
+}
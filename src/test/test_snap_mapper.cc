@@ -655,3 +655,35 @@ TEST_F(SnapMapperTest, MultiPG) {
   init(50);
   run();
 }
+
+TEST_F(SnapMapperTest, TrimResumes) {
+  SnapMapper mapper(g_ceph_context, driver.get(), 0, 0, 0, shard_id_t(1));
+  for (unsigned i = 0; i < 4; ++i) {
+    hobject_t obj("obj" + stringify(i), "", snapid_t(1), i, 0, "");
+    PausyAsyncMap::Transaction t;
+    mapper.add_oid(obj, {snapid_t(1)}, &t);
+    driver->submit(&t);
+  }
+  auto remove = [&](const vector<hobject_t> &objs) {
+    for (auto &obj : objs) {
+      PausyAsyncMap::Transaction t;
+      ASSERT_EQ(0, mapper.remove_oid(obj, &t));
+      driver->submit(&t);
+    }
+  };
+
+  vector<hobject_t> first, second, objs;
+  ASSERT_EQ(0, mapper.get_next_objects_to_trim(snapid_t(1), 2, &first));
+  ASSERT_EQ(2u, first.size());
+  // we go on from there even if those were not trimmed...
+  ASSERT_EQ(0, mapper.get_next_objects_to_trim(snapid_t(1), 2, &second));
+  ASSERT_EQ(2u, second.size());
+  ASSERT_NE(first, second);
+  remove(second);
+  // ...but come back for them before calling it done
+  ASSERT_EQ(0, mapper.get_next_objects_to_trim(snapid_t(1), 2, &objs));
+  ASSERT_EQ(first, objs);
+  remove(first);
+  objs.clear();
+  ASSERT_EQ(-ENOENT, mapper.get_next_objects_to_trim(snapid_t(1), 2, &objs));
+}
@@ -52,6 +52,55 @@ TEST(Striper, EmptyPartialResult)
   ASSERT_EQ(65536u, outbl.length());
 }
 
+TEST(Striper, Unstriped)
+{
+  file_layout_t l;
+
+  l.object_size = 4194304;
+  l.stripe_unit = 4194304;
+  l.stripe_count = 1;
+
+  striper::LightweightObjectExtents ex;
+  Striper::file_to_extents(g_ceph_context, &l, 4194304 - 4096, 4194304 + 8192,
+                           0, 100, &ex);
+  ASSERT_EQ(3u, ex.size());
+  ASSERT_EQ(0u, ex[0].object_no);
+  ASSERT_EQ(4194304u - 4096, ex[0].offset);
+  ASSERT_EQ(4096u, ex[0].length);
+  ASSERT_EQ(1u, ex[1].object_no);
+  ASSERT_EQ(0u, ex[1].offset);
+  ASSERT_EQ(4194304u, ex[1].length);
+  ASSERT_EQ(2u, ex[2].object_no);
+  ASSERT_EQ(4096u, ex[2].length);
+  ASSERT_EQ(1u, ex[2].buffer_extents.size());
+  ASSERT_EQ(100u + 4096 + 4194304, ex[2].buffer_extents[0].first);
+
+  // continuing into the last object merges with its extent
+  Striper::file_to_extents(g_ceph_context, &l, 2 * 4194304 + 4096, 4096,
+                           0, 0, &ex);
+  ASSERT_EQ(3u, ex.size());
+  ASSERT_EQ(8192u, ex[2].length);
+  ASSERT_EQ(2u, ex[2].buffer_extents.size());
+
+  // mapping an earlier range keeps the extents in object order
+  Striper::file_to_extents(g_ceph_context, &l, 4096, 4096, 0, 0, &ex);
+  ASSERT_EQ(4u, ex.size());
+  ASSERT_EQ(0u, ex[1].object_no);
+  ASSERT_EQ(4096u, ex[1].offset);
+  ASSERT_EQ(1u, ex[2].object_no);
+
+  // sizes that aren't a power of two
+  l.object_size = l.stripe_unit = 3 << 20;
+  ex.clear();
+  Striper::file_to_extents(g_ceph_context, &l, (3 << 20) - 1, 2, 0, 0, &ex);
+  ASSERT_EQ(2u, ex.size());
+  ASSERT_EQ(0u, ex[0].object_no);
+  ASSERT_EQ((3u << 20) - 1, ex[0].offset);
+  ASSERT_EQ(1u, ex[1].object_no);
+  ASSERT_EQ(0u, ex[1].offset);
+  ASSERT_EQ(1u, ex[1].length);
+}
+
 TEST(Striper, GetNumObj)
 {
   file_layout_t l;
@@ -18,6 +18,7 @@
 #include <boost/optional.hpp>
 
 #include <stdlib.h>
+#include <thread>
 
 #include "common/Formatter.h"
 #include "common/errno.h"
@@ -407,6 +408,7 @@ int file_fd = fd_none;
 bool debug;
 bool force = false;
 bool no_superblock = false;
+unsigned export_threads = 1;
 
 super_header sh;
 
@@ -737,7 +739,8 @@ void get_omap_batch(ObjectMap::ObjectMapIterator &iter, map<string, bufferlist>
   }
 }
 
-int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj)
+int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid,
+				 const ghobject_t &obj, bufferlist &out)
 {
   struct stat st;
   mysize_t total;
@@ -748,8 +751,6 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   if (ret < 0)
     return ret;
 
-  cerr << "Read " << obj << std::endl;
-
   total = st.st_size;
   if (debug)
     cerr << "size=" << total << std::endl;
@@ -772,7 +773,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
 
   // NOTE: we include whiteouts, lost, etc.
 
-  ret = write_section(TYPE_OBJECT_BEGIN, objb, file_fd);
+  ret = write_section(TYPE_OBJECT_BEGIN, objb, out);
   if (ret < 0)
     return ret;
 
@@ -797,7 +798,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
     total -= ret;
     offset += ret;
 
-    ret = write_section(TYPE_DATA, dblock, file_fd);
+    ret = write_section(TYPE_DATA, dblock, out);
     if (ret) return ret;
   }
 
@@ -806,7 +807,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   ret = store->getattrs(ch, obj, aset);
   if (ret) return ret;
   attr_section as(aset);
-  ret = write_section(TYPE_ATTRS, as, file_fd);
+  ret = write_section(TYPE_ATTRS, as, out);
   if (ret)
     return ret;
 
@@ -823,7 +824,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
 
   omap_hdr_section ohs(hdrbuf);
-  ret = write_section(TYPE_OMAP_HDR, ohs, file_fd);
+  ret = write_section(TYPE_OMAP_HDR, ohs, out);
   if (ret)
     return ret;
 
@@ -835,22 +836,22 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
   iter->seek_to_first();
   int mapcount = 0;
-  map<string, bufferlist> out;
+  map<string, bufferlist> oset;
   while(iter->valid()) {
-    get_omap_batch(iter, out);
+    get_omap_batch(iter, oset);
 
-    if (out.empty()) break;
+    if (oset.empty()) break;
 
-    mapcount += out.size();
-    omap_section oms(out);
-    ret = write_section(TYPE_OMAP, oms, file_fd);
+    mapcount += oset.size();
+    omap_section oms(oset);
+    ret = write_section(TYPE_OMAP, oms, out);
     if (ret)
       return ret;
   }
   if (debug)
     cerr << "omap map size " << mapcount << std::endl;
 
-  ret = write_simple(TYPE_OBJECT_END, file_fd);
+  ret = write_simple(TYPE_OBJECT_END, out);
   if (ret)
     return ret;
 
@@ -859,26 +860,114 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
 
 int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
 {
+  // the objects are read by export_threads threads and written to the
+  // export in the order of the listing
+  struct exported_t {
+    ghobject_t obj;
+    bufferlist bl;
+    int r = 0;
+    bool done = false;
+  };
+  ceph::mutex lock = ceph::make_mutex("ObjectStoreTool::export_files");
+  ceph::condition_variable cond;
+  std::deque<std::shared_ptr<exported_t>> window;  // not written yet
+  std::deque<std::shared_ptr<exported_t>> pending; // not read yet
+  const unsigned nthreads = std::max(1u, export_threads);
+  const size_t max_window = 2 * nthreads;
+  bool listed = false;
+  bool stop = false;
+  uint64_t objects = 0, bytes = 0;
+  auto start = ceph::mono_clock::now();
+
+  std::vector<std::thread> readers;
+  for (unsigned i = 0; i < nthreads; ++i) {
+    readers.emplace_back([&] {
+      std::unique_lock l(lock);
+      while (true) {
+	cond.wait(l, [&] { return stop || listed || !pending.empty(); });
+	if (stop || pending.empty()) {
+	  break;
+	}
+	auto e = pending.front();
+	pending.pop_front();
+	l.unlock();
+	e->r = export_file(store, coll, e->obj, e->bl);
+	l.lock();
+	e->done = true;
+	cond.notify_all();
+      }
+    });
+  }
+
+  // write out the objects read at the head of the window
+  auto flush = [&](std::unique_lock<ceph::mutex>& l, size_t limit) {
+    while (!window.empty()) {
+      cond.wait(l, [&] { return window.size() < limit || window.front()->done; });
+      if (window.size() < limit && !window.front()->done) {
+	return 0;
+      }
+      auto e = window.front();
+      window.pop_front();
+      if (e->r < 0) {
+	return e->r;
+      }
+      l.unlock();
+      cerr << "Read " << e->obj << std::endl;
+      int r = dry_run ? 0 : e->bl.write_fd(file_fd);
+      ++objects;
+      bytes += e->bl.length();
+      l.lock();
+      if (r < 0) {
+	return r;
+      }
+    }
+    return 0;
+  };
+
+  int r = 0;
   ghobject_t next;
   auto ch = store->open_collection(coll);
-  while (!next.is_max()) {
-    vector<ghobject_t> objects;
-    int r = store->collection_list(ch, next, ghobject_t::get_max(), 300,
-      &objects, &next);
+  std::unique_lock l(lock);
+  while (!next.is_max() && r == 0) {
+    vector<ghobject_t> ls;
+    l.unlock();
+    r = store->collection_list(ch, next, ghobject_t::get_max(), 300,
+      &ls, &next);
+    l.lock();
     if (r < 0)
-      return r;
-    for (vector<ghobject_t>::iterator i = objects.begin();
-	 i != objects.end();
-	 ++i) {
-      ceph_assert(!i->hobj.is_meta());
-      if (i->is_pgmeta() || i->hobj.is_temp() || !i->is_no_gen()) {
+      break;
+    for (auto& obj : ls) {
+      ceph_assert(!obj.hobj.is_meta());
+      if (obj.is_pgmeta() || obj.hobj.is_temp() || !obj.is_no_gen()) {
 	continue;
       }
-      r = export_file(store, coll, *i);
+      auto e = std::make_shared<exported_t>();
+      e->obj = obj;
+      window.push_back(e);
+      pending.push_back(e);
+      cond.notify_all();
+      r = flush(l, max_window);
       if (r < 0)
-        return r;
+	break;
     }
   }
+  listed = true;
+  cond.notify_all();
+  if (r == 0) {
+    r = flush(l, 1);
+  }
+  stop = true;
+  cond.notify_all();
+  l.unlock();
+  for (auto& t : readers) {
+    t.join();
+  }
+  if (r < 0)
+    return r;
+
+  std::chrono::duration<double> elapsed = ceph::mono_clock::now() - start;
+  cerr << "Exported " << objects << " objects, " << bytes << " bytes in "
+       << elapsed.count() << " seconds" << std::endl;
   return 0;
 }
 
@@ -3244,6 +3333,8 @@ int main(int argc, char **argv)
     ("rmtype", po::value<string>(&rmtypestr), "Specify corrupting object removal 'snapmap' or 'nosnapmap' - TESTING USE ONLY")
     ("slow-omap-threshold", po::value<unsigned>(&slow_threshold),
       "Threshold (in seconds) to consider omap listing slow (for op=list-slow-omap)")
+    ("threads", po::value<unsigned>(&export_threads)->default_value(1),
+      "Number of threads reading the objects of the PG (for op=export and export-remove)")
     ;
 
   po::options_description positional("Positional options");
@@ -32,12 +32,13 @@ class ObjectStoreTool : public RadosDump
           const OSDSuperblock& superblock,
           PastIntervals &past_intervals);
     int dump_object(Formatter *formatter,
-				bufferlist &bl);
+				bufferlist &out);
     int get_object(
       ObjectStore *store, OSDriver& driver, SnapMapper& mapper, coll_t coll,
       bufferlist &bl, OSDMap &curmap, bool *skipped_objects);
     int export_file(
-        ObjectStore *store, coll_t cid, ghobject_t &obj);
+        ObjectStore *store, coll_t cid, const ghobject_t &obj,
+        bufferlist &out);
     int export_files(ObjectStore *store, coll_t coll);
 };
 
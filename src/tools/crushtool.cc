@@ -229,6 +229,8 @@ void usage()
   cout << "   --set-subtree-class <bucket-name> <class>\n";
   cout << "                         set class for all items beneath bucket-name\n";
   cout << "   --compare <otherfile> compare two maps using --test parameters\n";
+  cout << "   --bench <rounds>      time the mappings of the --test range, rounds\n";
+  cout << "                         times over\n";
   cout << "\n";
   cout << "Options for the output stage\n";
   cout << "\n";
@@ -385,6 +387,7 @@ int main(int argc, const char **argv)
   bool check = false;
   int max_id = -1;
   bool test = false;
+  int bench = 0;
   bool display = false;
   bool tree = false;
   bool bucket_tree = false;
@@ -467,6 +470,15 @@ int main(int argc, const char **argv)
       verbose += 1;
     } else if (ceph_argparse_witharg(args, i, &val, "--compare", (char*)NULL)) {
       compare = val;
+    } else if (ceph_argparse_witharg(args, i, &bench, err, "--bench", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+      if (bench <= 0) {
+	cerr << "--bench rounds must be positive" << std::endl;
+	return EXIT_FAILURE;
+      }
     } else if (ceph_argparse_flag(args, i, "--reclassify", (char*)NULL)) {
       reclassify = true;
     } else if (ceph_argparse_witharg(args, i, &val, "--reclassify-bucket",
@@ -1278,6 +1290,10 @@ int main(int argc, const char **argv)
       return EXIT_FAILURE;
   }
 
+  if (bench) {
+    tester.bench(bench);
+  }
+
   if (compare.size()) {
     CrushWrapper crush2;
     bufferlist in;
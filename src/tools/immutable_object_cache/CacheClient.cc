@@ -110,11 +110,12 @@ namespace immutable_obj_cache {
   }
 
   void CacheClient::lookup_object(std::string pool_nspace, uint64_t pool_id,
-                                  uint64_t snap_id, std::string oid,
+                                  uint64_t snap_id, uint64_t object_off,
+                                  uint64_t object_len, std::string oid,
                                   CacheGenContextURef&& on_finish) {
     ldout(m_cct, 20) << dendl;
     ObjectCacheRequest* req = new ObjectCacheReadData(RBDSC_READ,
-                                    ++m_sequence_id, 0, 0,
+                                    ++m_sequence_id, object_off, object_len,
                                     pool_id, snap_id, oid, pool_nspace);
     req->process_msg = std::move(on_finish);
     req->encode();
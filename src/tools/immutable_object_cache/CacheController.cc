@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "CacheController.h"
+#include "common/admin_socket.h"
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_immutable_obj_cache
@@ -12,6 +13,35 @@
 namespace ceph {
 namespace immutable_obj_cache {
 
+class CacheControllerAdminSocketHook : public AdminSocketHook {
+public:
+  CacheControllerAdminSocketHook(CephContext *cct,
+                                 CacheController *cache_controller)
+    : admin_socket(cct->get_admin_socket()),
+      cache_controller(cache_controller) {
+    admin_socket->register_command("cache status", this,
+                                   "get the status of the object cache");
+  }
+
+  ~CacheControllerAdminSocketHook() override {
+    admin_socket->unregister_commands(this);
+  }
+
+  int call(std::string_view command, const cmdmap_t& cmdmap,
+           Formatter *f,
+           std::ostream& errss,
+           bufferlist& out) override {
+    f->open_object_section("cache_status");
+    cache_controller->dump(f);
+    f->close_section();
+    return 0;
+  }
+
+private:
+  AdminSocket *admin_socket;
+  CacheController *cache_controller;
+};
+
 CacheController::CacheController(CephContext *cct,
                                  const std::vector<const char*> &args):
   m_args(args), m_cct(cct) {
@@ -19,6 +49,7 @@ CacheController::CacheController(CephContext *cct,
 }
 
 CacheController::~CacheController() {
+  delete m_asok_hook;
   delete m_cache_server;
   delete m_object_cache_store;
 }
@@ -37,8 +68,10 @@ int CacheController::init() {
   r = m_object_cache_store->init_cache();
   if (r < 0) {
     lderr(m_cct) << "init error\n" << dendl;
+    return r;
   }
 
+  m_asok_hook = new CacheControllerAdminSocketHook(m_cct, this);
   return r;
 }
 
@@ -103,7 +136,8 @@ void CacheController::handle_request(CacheSession* session,
         reinterpret_cast <ObjectCacheReadData*> (req);
       int ret = m_object_cache_store->lookup_object(
         req_read_data->pool_namespace, req_read_data->pool_id,
-        req_read_data->snap_id, req_read_data->oid, cache_path);
+        req_read_data->snap_id, req_read_data->oid, cache_path,
+        req_read_data->read_offset, req_read_data->read_len);
       ObjectCacheRequest* reply = nullptr;
       if (ret != OBJ_CACHE_PROMOTED) {
         reply = new ObjectCacheReadRadosData(RBDSC_READ_RADOS, req->seq);
@@ -120,5 +154,9 @@ void CacheController::handle_request(CacheSession* session,
   }
 }
 
+void CacheController::dump(Formatter* f) {
+  m_object_cache_store->dump(f);
+}
+
 }  // namespace immutable_obj_cache
 }  // namespace ceph
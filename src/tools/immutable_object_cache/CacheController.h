@@ -12,6 +12,8 @@
 namespace ceph {
 namespace immutable_obj_cache {
 
+class CacheControllerAdminSocketHook;
+
 class CacheController {
  public:
   CacheController(CephContext *cct, const std::vector<const char*> &args);
@@ -27,11 +29,14 @@ class CacheController {
 
   void handle_request(CacheSession* session, ObjectCacheRequest* msg);
 
+  void dump(Formatter* f);
+
  private:
   CacheServer *m_cache_server;
   std::vector<const char*> m_args;
   CephContext *m_cct;
   ObjectCacheStore *m_object_cache_store;
+  CacheControllerAdminSocketHook *m_asok_hook = nullptr;
 };
 
 }  // namespace immutable_obj_cache
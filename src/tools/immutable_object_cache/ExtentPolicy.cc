@@ -0,0 +1,396 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/debug.h"
+#include "include/intarith.h"
+#include "ExtentPolicy.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_immutable_obj_cache
+#undef dout_prefix
+#define dout_prefix *_dout << "ceph::cache::ExtentPolicy: " << this << " " \
+                           << __func__ << ": "
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+ExtentPolicy::ExtentPolicy(CephContext *cct, uint64_t cache_size,
+                           uint64_t max_inflight, double watermark,
+                           uint64_t block_size, uint64_t admission_threshold)
+  : cct(cct), m_watermark(watermark), m_max_inflight_ops(max_inflight),
+    m_max_cache_size(cache_size), m_block_size(block_size),
+    m_admission_threshold(admission_threshold) {
+  ceph_assert(m_block_size > 0);
+
+  // remember the misses of about as many objects as could be cached
+  m_max_tracked_objects = std::max<uint64_t>(1024,
+                                             m_max_cache_size / m_block_size);
+
+  ldout(cct, 20) << "max cache size= " << m_max_cache_size
+                 << " ,watermark= " << m_watermark
+                 << " ,max inflight ops= " << m_max_inflight_ops
+                 << " ,block size= " << m_block_size
+                 << " ,admission threshold= " << m_admission_threshold
+                 << dendl;
+}
+
+ExtentPolicy::~ExtentPolicy() {
+  ldout(cct, 20) << dendl;
+
+  for (auto& it : m_cache_map) {
+    delete it.second;
+  }
+}
+
+cache_status_t ExtentPolicy::lookup_object(std::string file_name) {
+  return lookup_extent(file_name, 0, 0);
+}
+
+cache_status_t ExtentPolicy::lookup_extent(std::string file_name,
+                                           uint64_t offset, uint64_t length) {
+  ldout(cct, 20) << "lookup: " << file_name << " " << offset << "~" << length
+                 << dendl;
+
+  std::lock_guard locker{m_lock};
+  auto& stats = get_image_stats(file_name);
+
+  Entry* entry = nullptr;
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it != m_cache_map.end()) {
+    entry = entry_it->second;
+    if (entry->evicting) {
+      stats.misses++;
+      stats.miss_bytes += length;
+      return OBJ_CACHE_SKIP;
+    }
+
+    entry->freq++;
+    update_priority(entry);
+    if (is_cached(entry, offset, length)) {
+      stats.hits++;
+      stats.hit_bytes += length;
+      return OBJ_CACHE_PROMOTED;
+    }
+  }
+
+  stats.misses++;
+  stats.miss_bytes += length;
+
+  uint64_t start;
+  uint64_t end;
+  get_extent(nullptr, offset, length, &start, &end);
+  if (entry != nullptr && entry->promoting.intersects(start, end - start)) {
+    ldout(cct, 20) << "extent is under promoting: " << file_name << dendl;
+    return OBJ_CACHE_SKIP;
+  }
+  if (m_cache_size >= m_max_cache_size ||
+      m_inflight_ops >= m_max_inflight_ops) {
+    return OBJ_CACHE_SKIP;
+  }
+
+  if (entry == nullptr) {
+    // the blocks of the admitted objects are promoted on their first miss
+    if (!track_miss(file_name)) {
+      return OBJ_CACHE_SKIP;
+    }
+
+    ldout(cct, 20) << "admit: " << file_name << dendl;
+    entry = new Entry();
+    entry->file_name = file_name;
+    entry->freq = std::max<uint64_t>(m_admission_threshold, 1);
+    m_cache_map[file_name] = entry;
+    update_priority(entry);
+  }
+
+  entry->promoting.insert(start, end - start);
+  m_inflight_ops++;
+  return OBJ_CACHE_NONE;  // start promotion request
+}
+
+void ExtentPolicy::get_promote_extent(uint64_t offset, uint64_t length,
+                                      uint64_t* promote_offset,
+                                      uint64_t* promote_length) {
+  if (length == 0) {
+    *promote_offset = 0;
+    *promote_length = 0;
+    return;
+  }
+
+  uint64_t end;
+  get_extent(nullptr, offset, length, promote_offset, &end);
+  *promote_length = end - *promote_offset;
+}
+
+cache_status_t ExtentPolicy::get_status(std::string file_name) {
+  ldout(cct, 20) << file_name << dendl;
+
+  std::lock_guard locker{m_lock};
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it == m_cache_map.end()) {
+    return OBJ_CACHE_NONE;
+  }
+
+  Entry* entry = entry_it->second;
+  if (entry->evicting || !entry->promoting.empty()) {
+    return OBJ_CACHE_SKIP;
+  }
+  return OBJ_CACHE_PROMOTED;
+}
+
+bool ExtentPolicy::is_complete(std::string file_name) {
+  std::lock_guard locker{m_lock};
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it == m_cache_map.end()) {
+    return false;
+  }
+
+  Entry* entry = entry_it->second;
+  return !entry->evicting && entry->object_size != UNKNOWN_SIZE &&
+         is_cached(entry, 0, 0);
+}
+
+void ExtentPolicy::update_status(std::string file_name,
+                                 cache_status_t new_status, uint64_t size) {
+  // whole object promotion
+  update_extent_status(file_name, new_status, size, 0, 0);
+}
+
+void ExtentPolicy::update_extent_status(std::string file_name,
+                                        cache_status_t new_status,
+                                        uint64_t size, uint64_t offset,
+                                        uint64_t length) {
+  ldout(cct, 20) << "update status for: " << file_name << " " << offset
+                 << "~" << length << " new status = " << new_status << dendl;
+
+  std::lock_guard locker{m_lock};
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it == m_cache_map.end()) {
+    return;
+  }
+
+  Entry* entry = entry_it->second;
+  uint64_t start;
+  uint64_t end;
+  get_extent(nullptr, offset, length, &start, &end);
+  if (new_status == OBJ_CACHE_SKIP ||
+      !entry->promoting.contains(start, end - start)) {
+    return;
+  }
+  entry->promoting.erase(start, end - start);
+  m_inflight_ops--;
+
+  // promoting failed
+  if (new_status == OBJ_CACHE_NONE) {
+    if (entry->promoting.empty() && entry->cached.empty() &&
+        entry->object_size == UNKNOWN_SIZE) {
+      remove_entry(entry_it);
+    }
+    return;
+  }
+
+  // promoting done
+  ceph_assert(new_status == OBJ_CACHE_PROMOTED);
+  if (size < end - start) {
+    // the object ends in the extent, or before it if nothing was read
+    entry->object_size = std::min(entry->object_size, start + size);
+  }
+  if (entry->object_size != UNKNOWN_SIZE) {
+    end = std::min(end, round_up_to(entry->object_size, m_block_size));
+  }
+  if (start < end) {
+    entry->cached.union_insert(start, end - start);
+  }
+
+  uint64_t cached_bytes = get_cached_bytes(entry);
+  get_image_stats(file_name).promoted_bytes += cached_bytes - entry->size;
+  m_cache_size += cached_bytes - entry->size;
+  entry->size = cached_bytes;
+  update_priority(entry);
+}
+
+int ExtentPolicy::evict_entry(std::string file_name) {
+  ldout(cct, 20) << "to evict: " << file_name << dendl;
+
+  std::lock_guard locker{m_lock};
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it != m_cache_map.end()) {
+    remove_entry(entry_it);
+  }
+  return 0;
+}
+
+void ExtentPolicy::get_evict_list(std::list<std::string>* obj_list) {
+  ldout(cct, 20) << dendl;
+
+  std::lock_guard locker{m_lock};
+  if ((double)m_cache_size / m_max_cache_size <= (1 - m_watermark)) {
+    return;
+  }
+
+  // leave some room below the watermark, so as not to evict on every
+  // promotion
+  uint64_t target_size = m_max_cache_size * (1 - m_watermark) * 0.9;
+  uint64_t evict_size = 0;
+  for (auto it = m_priorities.begin();
+       it != m_priorities.end() && m_cache_size - evict_size > target_size;) {
+    Entry* entry = it->second;
+    if (!entry->promoting.empty()) {
+      ++it;
+      continue;
+    }
+
+    ldout(cct, 20) << "evict: " << entry->file_name << " priority="
+                   << it->first << dendl;
+    m_base_priority = it->first;
+    entry->evicting = true;
+    entry->queued = false;
+    evict_size += entry->size;
+    obj_list->push_back(entry->file_name);
+    it = m_priorities.erase(it);
+  }
+}
+
+void ExtentPolicy::dump(Formatter* f) {
+  std::lock_guard locker{m_lock};
+  f->dump_string("policy", "extent");
+  f->dump_unsigned("cache_size", m_cache_size);
+  f->dump_unsigned("max_cache_size", m_max_cache_size);
+  f->dump_unsigned("block_size", m_block_size);
+  f->dump_unsigned("cached_objects", m_cache_map.size());
+  f->dump_unsigned("tracked_objects", m_tracked_map.size());
+  f->dump_unsigned("inflight_ops", m_inflight_ops);
+  f->open_array_section("images");
+  for (auto& [image, stats] : m_image_stats) {
+    f->open_object_section("image");
+    f->dump_string("image", image);
+    f->dump_unsigned("hits", stats.hits);
+    f->dump_unsigned("misses", stats.misses);
+    f->dump_unsigned("hit_bytes", stats.hit_bytes);
+    f->dump_unsigned("miss_bytes", stats.miss_bytes);
+    f->dump_unsigned("promoted_bytes", stats.promoted_bytes);
+    f->dump_unsigned("evicted_bytes", stats.evicted_bytes);
+    f->close_section();
+  }
+  f->close_section();
+}
+
+// for unit test
+uint64_t ExtentPolicy::get_cache_size() {
+  std::lock_guard locker{m_lock};
+  return m_cache_size;
+}
+
+uint64_t ExtentPolicy::get_promoting_entry_num() {
+  std::lock_guard locker{m_lock};
+  return m_inflight_ops;
+}
+
+uint64_t ExtentPolicy::get_promoted_entry_num() {
+  std::lock_guard locker{m_lock};
+  uint64_t count = 0;
+  for (auto& it : m_cache_map) {
+    if (!it.second->cached.empty() || it.second->object_size == 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+bool ExtentPolicy::track_miss(const std::string& file_name) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  uint64_t misses = 1;
+  auto it = m_tracked_map.find(file_name);
+  if (it != m_tracked_map.end()) {
+    misses = ++it->second->second;
+    m_tracked_lru.splice(m_tracked_lru.begin(), m_tracked_lru, it->second);
+  } else {
+    m_tracked_lru.emplace_front(file_name, misses);
+    m_tracked_map[file_name] = m_tracked_lru.begin();
+    if (m_tracked_lru.size() > m_max_tracked_objects) {
+      // the misses of the coldest object are forgotten
+      m_tracked_map.erase(m_tracked_lru.back().first);
+      m_tracked_lru.pop_back();
+    }
+  }
+
+  if (misses < m_admission_threshold) {
+    return false;
+  }
+  m_tracked_lru.erase(m_tracked_map[file_name]);
+  m_tracked_map.erase(file_name);
+  return true;
+}
+
+void ExtentPolicy::get_extent(const Entry* entry, uint64_t offset,
+                              uint64_t length, uint64_t* start,
+                              uint64_t* end) const {
+  // a length of zero stands for the whole object
+  *start = length == 0 ? 0 : offset - offset % m_block_size;
+  *end = length == 0 ? UNKNOWN_SIZE : round_up_to(offset + length,
+                                                  m_block_size);
+  if (entry != nullptr && entry->object_size != UNKNOWN_SIZE) {
+    // nothing past the end of the object is cached
+    *end = std::min(*end, round_up_to(entry->object_size, m_block_size));
+    *start = std::min(*start, *end);
+  }
+}
+
+bool ExtentPolicy::is_cached(Entry* entry, uint64_t offset,
+                             uint64_t length) const {
+  uint64_t start;
+  uint64_t end;
+  get_extent(entry, offset, length, &start, &end);
+  return start == end || entry->cached.contains(start, end - start);
+}
+
+uint64_t ExtentPolicy::get_cached_bytes(const Entry* entry) const {
+  uint64_t bytes = 0;
+  for (auto [start, len] : entry->cached) {
+    bytes += std::min(start + len, entry->object_size) -
+             std::min(start, entry->object_size);
+  }
+  return bytes;
+}
+
+void ExtentPolicy::update_priority(Entry* entry) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  if (entry->queued) {
+    m_priorities.erase(entry->priority_it);
+  }
+
+  // the fewer the accesses per cached block, the sooner the object goes
+  double blocks = std::max<uint64_t>(div_round_up(entry->size, m_block_size),
+                                     1);
+  entry->priority_it = m_priorities.emplace(
+    m_base_priority + entry->freq / blocks, entry);
+  entry->queued = true;
+}
+
+void ExtentPolicy::remove_entry(
+    std::unordered_map<std::string, Entry*>::iterator it) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  Entry* entry = it->second;
+  if (entry->queued) {
+    m_priorities.erase(entry->priority_it);
+  }
+  if (entry->size > 0) {
+    get_image_stats(entry->file_name).evicted_bytes += entry->size;
+    m_cache_size -= entry->size;
+  }
+  ceph_assert(entry->promoting.empty());
+  m_cache_map.erase(it);
+  delete entry;
+}
+
+ExtentPolicy::ImageStats& ExtentPolicy::get_image_stats(
+    const std::string& file_name) {
+  // the cache files are named after the data objects, <prefix>.<object no>
+  auto pos = file_name.rfind('.');
+  return m_image_stats[file_name.substr(0, pos)];
+}
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
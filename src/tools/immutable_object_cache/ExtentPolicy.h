@@ -0,0 +1,128 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_CACHE_EXTENT_POLICY_H
+#define CEPH_CACHE_EXTENT_POLICY_H
+
+#include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
+#include "include/interval_set.h"
+#include "Policy.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+/**
+ * Caches the blocks of the objects which were read, rather than the whole
+ * objects.
+ *
+ * An object is admitted once it was missed admission_threshold times while
+ * it was tracked; since then the blocks missed are promoted at once. The
+ * objects are evicted as a whole, by GreedyDual-Size-Frequency: the ones
+ * with the fewest accesses per cached byte go first, and the cache ages as
+ * the priority of the last evicted object becomes the base priority of the
+ * new accesses.
+ */
+class ExtentPolicy : public Policy {
+ public:
+  ExtentPolicy(CephContext *cct, uint64_t cache_size, uint64_t max_inflight,
+               double watermark, uint64_t block_size,
+               uint64_t admission_threshold);
+  ~ExtentPolicy();
+
+  cache_status_t lookup_object(std::string file_name) override;
+  cache_status_t lookup_extent(std::string file_name, uint64_t offset,
+                               uint64_t length) override;
+  void get_promote_extent(uint64_t offset, uint64_t length,
+                          uint64_t* promote_offset,
+                          uint64_t* promote_length) override;
+  cache_status_t get_status(std::string file_name) override;
+  bool is_complete(std::string file_name) override;
+
+  void update_status(std::string file_name, cache_status_t new_status,
+                     uint64_t size = 0) override;
+  void update_extent_status(std::string file_name, cache_status_t new_status,
+                            uint64_t size, uint64_t offset,
+                            uint64_t length) override;
+
+  int evict_entry(std::string file_name) override;
+  void get_evict_list(std::list<std::string>* obj_list) override;
+
+  void dump(Formatter* f) override;
+
+  // for unit test
+  uint64_t get_cache_size();
+  uint64_t get_promoting_entry_num();
+  uint64_t get_promoted_entry_num();
+
+ private:
+  static constexpr uint64_t UNKNOWN_SIZE = UINT64_MAX;
+
+  struct Entry {
+    std::string file_name;
+    // the extents cached and being promoted, block aligned
+    interval_set<uint64_t> cached;
+    interval_set<uint64_t> promoting;
+    // known once a read from rados came short
+    uint64_t object_size = UNKNOWN_SIZE;
+    uint64_t size = 0;
+    uint64_t freq = 0;
+    bool evicting = false;
+    // whether the entry is in m_priorities
+    bool queued = false;
+    std::multimap<double, Entry*>::iterator priority_it;
+  };
+
+  struct ImageStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t hit_bytes = 0;
+    uint64_t miss_bytes = 0;
+    uint64_t promoted_bytes = 0;
+    uint64_t evicted_bytes = 0;
+  };
+
+  CephContext* cct;
+  double m_watermark;
+  uint64_t m_max_inflight_ops;
+  uint64_t m_max_cache_size;
+  uint64_t m_block_size;
+  uint64_t m_admission_threshold;
+  uint64_t m_max_tracked_objects;
+  uint64_t m_inflight_ops = 0;
+  uint64_t m_cache_size = 0;
+  // the priority of the last evicted object
+  double m_base_priority = 0;
+
+  std::unordered_map<std::string, Entry*> m_cache_map;
+  std::multimap<double, Entry*> m_priorities;
+
+  // the misses of the objects not admitted yet, most recent first
+  std::list<std::pair<std::string, uint64_t>> m_tracked_lru;
+  std::unordered_map<std::string,
+                     std::list<std::pair<std::string, uint64_t>>::iterator>
+    m_tracked_map;
+
+  std::map<std::string, ImageStats> m_image_stats;
+
+  ceph::mutex m_lock =
+    ceph::make_mutex("ceph::cache::ExtentPolicy::m_lock");
+
+  bool track_miss(const std::string& file_name);
+  bool is_cached(Entry* entry, uint64_t offset, uint64_t length) const;
+  void get_extent(const Entry* entry, uint64_t offset, uint64_t length,
+                  uint64_t* start, uint64_t* end) const;
+  uint64_t get_cached_bytes(const Entry* entry) const;
+  void update_priority(Entry* entry);
+  void remove_entry(std::unordered_map<std::string, Entry*>::iterator it);
+  ImageStats& get_image_stats(const std::string& file_name);
+};
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
+#endif  // CEPH_CACHE_EXTENT_POLICY_H
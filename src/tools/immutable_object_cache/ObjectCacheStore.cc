@@ -3,7 +3,11 @@
 
 #include "ObjectCacheStore.h"
 #include "Utils.h"
+#include "common/errno.h"
+#include "include/compat.h"
 #include <experimental/filesystem>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_immutable_obj_cache
@@ -35,8 +39,19 @@ ObjectCacheStore::ObjectCacheStore(CephContext *cct)
   uint64_t max_inflight_ops =
     m_cct->_conf.get_val<uint64_t>("immutable_object_cache_max_inflight_ops");
 
-  m_policy = new SimplePolicy(m_cct, cache_max_size, max_inflight_ops,
-                              cache_watermark);
+  auto policy =
+    m_cct->_conf.get_val<std::string>("immutable_object_cache_policy");
+  if (policy == "extent") {
+    m_policy = new ExtentPolicy(
+      m_cct, cache_max_size, max_inflight_ops, cache_watermark,
+      m_cct->_conf.get_val<Option::size_t>(
+        "immutable_object_cache_block_size"),
+      m_cct->_conf.get_val<uint64_t>(
+        "immutable_object_cache_admission_threshold"));
+  } else {
+    m_policy = new SimplePolicy(m_cct, cache_max_size, max_inflight_ops,
+                                cache_watermark);
+  }
 }
 
 ObjectCacheStore::~ObjectCacheStore() {
@@ -73,12 +88,31 @@ int ObjectCacheStore::init(bool reset) {
       }
     }
   }
+
+  // the index starts empty, like the policy
+  auto index_path =
+    m_cct->_conf.get_val<std::string>("immutable_object_cache_index_path");
+  if (!index_path.empty()) {
+    m_shared_index = std::make_unique<SharedIndex>(m_cct, index_path);
+    ret = m_shared_index->create(
+      m_cache_root_dir,
+      m_cct->_conf.get_val<uint64_t>("immutable_object_cache_index_slots"));
+    if (ret < 0) {
+      // the clients look the objects up through the daemon
+      lderr(m_cct) << "fail to create shared index: " << cpp_strerror(ret)
+                   << dendl;
+      m_shared_index.reset();
+    }
+  }
   return 0;
 }
 
 int ObjectCacheStore::shutdown() {
   ldout(m_cct, 20) << dendl;
 
+  if (m_shared_index) {
+    m_shared_index->close();
+  }
   m_rados->shutdown();
   return 0;
 }
@@ -92,11 +126,13 @@ int ObjectCacheStore::init_cache() {
 
 int ObjectCacheStore::do_promote(std::string pool_nspace,
                                   uint64_t pool_id, uint64_t snap_id,
-                                  std::string object_name) {
+                                  std::string object_name,
+                                  uint64_t object_off, uint64_t object_len) {
   ldout(m_cct, 20) << "to promote object: " << object_name
                    << " from pool id: " << pool_id
                    << " namespace: " << pool_nspace
-                   << " snapshot: " << snap_id << dendl;
+                   << " snapshot: " << snap_id
+                   << " extent: " << object_off << "~" << object_len << dendl;
 
   int ret = 0;
   std::string cache_file_name = get_cache_file_name(pool_nspace, pool_id, snap_id, object_name);
@@ -118,24 +154,35 @@ int ObjectCacheStore::do_promote(std::string pool_nspace,
   ioctx.set_namespace(pool_nspace);
   ioctx.snap_set_read(snap_id);
 
+  uint64_t promote_off;
+  uint64_t promote_len;
+  m_policy->get_promote_extent(object_off, object_len, &promote_off,
+                               &promote_len);
+
   librados::bufferlist* read_buf = new librados::bufferlist();
 
-  auto ctx = new LambdaContext([this, read_buf, cache_file_name](int ret) {
-    handle_promote_callback(ret, read_buf, cache_file_name);
+  auto ctx = new LambdaContext([this, read_buf, cache_file_name,
+                                promote_off, promote_len](int ret) {
+    handle_promote_callback(ret, read_buf, cache_file_name, promote_off,
+                            promote_len);
   });
 
-  return promote_object(&ioctx, object_name, read_buf, ctx);
+  return promote_object(&ioctx, object_name, read_buf, promote_off,
+                        promote_len, ctx);
 }
 
 int ObjectCacheStore::handle_promote_callback(int ret, bufferlist* read_buf,
-  std::string cache_file_name) {
-  ldout(m_cct, 20) << " cache_file_name: " << cache_file_name << dendl;
+  std::string cache_file_name, uint64_t promote_off, uint64_t promote_len) {
+  ldout(m_cct, 20) << " cache_file_name: " << cache_file_name
+                   << " extent: " << promote_off << "~" << promote_len
+                   << dendl;
 
   // rados read error
   if (ret != -ENOENT && ret < 0) {
     lderr(m_cct) << "fail to read from rados" << dendl;
 
-    m_policy->update_status(cache_file_name, OBJ_CACHE_NONE);
+    m_policy->update_extent_status(cache_file_name, OBJ_CACHE_NONE, 0,
+                                   promote_off, promote_len);
     delete read_buf;
     return ret;
   }
@@ -149,24 +196,35 @@ int ObjectCacheStore::handle_promote_callback(int ret, bufferlist* read_buf,
 
   if (cache_file_path == "") {
     lderr(m_cct) << "fail to write cache file" << dendl;
-    m_policy->update_status(cache_file_name, OBJ_CACHE_NONE);
+    m_policy->update_extent_status(cache_file_name, OBJ_CACHE_NONE, 0,
+                                   promote_off, promote_len);
     delete read_buf;
     return -ENOSPC;
   }
 
-  ret = read_buf->write_file(cache_file_path.c_str());
+  ret = write_cache_file(cache_file_path, read_buf, promote_off, promote_len);
   if (ret < 0) {
     lderr(m_cct) << "fail to write cache file" << dendl;
 
-    m_policy->update_status(cache_file_name, OBJ_CACHE_NONE);
+    m_policy->update_extent_status(cache_file_name, OBJ_CACHE_NONE, 0,
+                                   promote_off, promote_len);
     delete read_buf;
     return ret;
   }
 
   // update metadata
-  ceph_assert(OBJ_CACHE_SKIP == m_policy->get_status(cache_file_name));
-  m_policy->update_status(cache_file_name, OBJ_CACHE_PROMOTED, read_buf->length());
-  ceph_assert(OBJ_CACHE_PROMOTED == m_policy->get_status(cache_file_name));
+  if (promote_len == 0) {
+    ceph_assert(OBJ_CACHE_SKIP == m_policy->get_status(cache_file_name));
+  }
+  m_policy->update_extent_status(cache_file_name, OBJ_CACHE_PROMOTED,
+                                 read_buf->length(), promote_off, promote_len);
+  if (promote_len == 0) {
+    ceph_assert(OBJ_CACHE_PROMOTED == m_policy->get_status(cache_file_name));
+  }
+  // the clients only read the objects cached as a whole without asking
+  if (m_shared_index && m_policy->is_complete(cache_file_name)) {
+    m_shared_index->insert(cache_file_name);
+  }
 
   delete read_buf;
 
@@ -178,18 +236,23 @@ int ObjectCacheStore::handle_promote_callback(int ret, bufferlist* read_buf,
 int ObjectCacheStore::lookup_object(std::string pool_nspace,
                                     uint64_t pool_id, uint64_t snap_id,
                                     std::string object_name,
-                                    std::string& target_cache_file_path) {
+                                    std::string& target_cache_file_path,
+                                    uint64_t object_off,
+                                    uint64_t object_len) {
   ldout(m_cct, 20) << "object name = " << object_name
-                   << " in pool ID : " << pool_id << dendl;
+                   << " in pool ID : " << pool_id
+                   << " extent: " << object_off << "~" << object_len << dendl;
 
   int pret = -1;
   std::string cache_file_name = get_cache_file_name(pool_nspace, pool_id, snap_id, object_name);
 
-  cache_status_t ret = m_policy->lookup_object(cache_file_name);
+  cache_status_t ret = m_policy->lookup_extent(cache_file_name, object_off,
+                                               object_len);
 
   switch (ret) {
     case OBJ_CACHE_NONE: {
-      pret = do_promote(pool_nspace, pool_id, snap_id, object_name);
+      pret = do_promote(pool_nspace, pool_id, snap_id, object_name,
+                        object_off, object_len);
       if (pret < 0) {
         lderr(m_cct) << "fail to start promote" << dendl;
       }
@@ -209,12 +272,14 @@ int ObjectCacheStore::lookup_object(std::string pool_nspace,
 int ObjectCacheStore::promote_object(librados::IoCtx* ioctx,
                                      std::string object_name,
                                      librados::bufferlist* read_buf,
+                                     uint64_t read_off, uint64_t read_len,
                                      Context* on_finish) {
   ldout(m_cct, 20) << "object name = " << object_name << dendl;
 
   librados::AioCompletion* read_completion = create_rados_callback(on_finish);
-  // issue a zero-sized read req to get the entire obj
-  int ret = ioctx->aio_read(object_name, read_completion, read_buf, 0, 0);
+  // a zero-sized read req gets the entire obj
+  int ret = ioctx->aio_read(object_name, read_completion, read_buf, read_len,
+                            read_off);
   if (ret < 0) {
     lderr(m_cct) << "failed to read from rados" << dendl;
   }
@@ -223,6 +288,27 @@ int ObjectCacheStore::promote_object(librados::IoCtx* ioctx,
   return ret;
 }
 
+int ObjectCacheStore::write_cache_file(std::string cache_file_path,
+                                       bufferlist* read_buf,
+                                       uint64_t offset, uint64_t length) {
+  if (length == 0) {
+    return read_buf->write_file(cache_file_path.c_str());
+  }
+
+  // the extents of an object are promoted into the same sparse file
+  int fd = ::open(cache_file_path.c_str(), O_WRONLY|O_CREAT|O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return -errno;
+  }
+  int ret = read_buf->write_fd(fd, offset);
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  return ret;
+}
+
+void ObjectCacheStore::dump(Formatter* f) {
+  m_policy->dump(f);
+}
+
 int ObjectCacheStore::evict_objects() {
   ldout(m_cct, 20) << dendl;
 
@@ -245,6 +331,11 @@ int ObjectCacheStore::do_evict(std::string cache_file) {
 
   ldout(m_cct, 20) << "evict cache: " << cache_file_path << dendl;
 
+  // the clients stop looking the file up before it is removed
+  if (m_shared_index) {
+    m_shared_index->remove(cache_file);
+  }
+
   // TODO(dehao): possible race on read?
   int ret = std::remove(cache_file_path.c_str());
   // evict metadata
@@ -260,19 +351,15 @@ std::string ObjectCacheStore::get_cache_file_name(std::string pool_nspace,
                                                        uint64_t pool_id,
                                                        uint64_t snap_id,
                                                        std::string oid) {
-  return pool_nspace + ":" + std::to_string(pool_id) + ":" +
-         std::to_string(snap_id) + ":" + oid;
+  return immutable_obj_cache::get_cache_file_name(pool_nspace, pool_id,
+                                                  snap_id, oid);
 }
 
 std::string ObjectCacheStore::get_cache_file_path(std::string cache_file_name,
                                                   bool mkdir) {
   ldout(m_cct, 20) << cache_file_name <<dendl;
 
-  uint32_t crc = 0;
-  crc = ceph_crc32c(0, (unsigned char *)cache_file_name.c_str(),
-                    cache_file_name.length());
-
-  std::string cache_file_dir = std::to_string(crc % 100) + "/";
+  std::string cache_file_dir = get_cache_file_dir(cache_file_name);
 
   if (mkdir) {
     ldout(m_cct, 20) << "creating cache dir: " << cache_file_dir <<dendl;
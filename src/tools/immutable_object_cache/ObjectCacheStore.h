@@ -8,6 +8,8 @@
 #include "common/ceph_mutex.h"
 #include "include/rados/librados.hpp"
 
+#include "ExtentPolicy.h"
+#include "SharedIndex.h"
 #include "SimplePolicy.h"
 
 
@@ -31,7 +33,9 @@ class ObjectCacheStore {
   int lookup_object(std::string pool_nspace,
                     uint64_t pool_id, uint64_t snap_id,
                     std::string object_name,
-                    std::string& target_cache_file_path);
+                    std::string& target_cache_file_path,
+                    uint64_t object_off = 0, uint64_t object_len = 0);
+  void dump(Formatter* f);
 
  private:
   std::string get_cache_file_name(std::string pool_nspace, uint64_t pool_id,
@@ -40,11 +44,16 @@ class ObjectCacheStore {
                                   bool mkdir = false);
   int evict_objects();
   int do_promote(std::string pool_nspace, uint64_t pool_id,
-                 uint64_t snap_id, std::string object_name);
+                 uint64_t snap_id, std::string object_name,
+                 uint64_t object_off, uint64_t object_len);
   int promote_object(librados::IoCtx*, std::string object_name,
                      librados::bufferlist* read_buf,
+                     uint64_t read_off, uint64_t read_len,
                      Context* on_finish);
-  int handle_promote_callback(int, bufferlist*, std::string);
+  int handle_promote_callback(int, bufferlist*, std::string,
+                              uint64_t, uint64_t);
+  int write_cache_file(std::string cache_file_path, bufferlist* read_buf,
+                       uint64_t offset, uint64_t length);
   int do_evict(std::string cache_file);
 
   CephContext *m_cct;
@@ -54,6 +63,7 @@ class ObjectCacheStore {
     ceph::make_mutex("ceph::cache::ObjectCacheStore::m_ioctx_map_lock");
   Policy* m_policy;
   std::string m_cache_root_dir;
+  std::unique_ptr<SharedIndex> m_shared_index;
 };
 
 }  // namespace immutable_obj_cache
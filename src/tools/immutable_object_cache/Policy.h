@@ -7,6 +7,8 @@
 #include <list>
 #include <string>
 
+#include "common/Formatter.h"
+
 namespace ceph {
 namespace immutable_obj_cache {
 
@@ -26,6 +28,33 @@ class Policy {
                              uint64_t size = 0) = 0;
   virtual cache_status_t get_status(std::string) = 0;
   virtual void get_evict_list(std::list<std::string>* obj_list) = 0;
+
+  // extent aware policies cache parts of the objects; by default every
+  // extent stands for the whole object.
+  virtual cache_status_t lookup_extent(std::string file_name,
+                                       uint64_t offset, uint64_t length) {
+    return lookup_object(file_name);
+  }
+  // the extent to read from rados once lookup_extent() returned
+  // OBJ_CACHE_NONE; a length of zero stands for the whole object
+  virtual void get_promote_extent(uint64_t offset, uint64_t length,
+                                  uint64_t* promote_offset,
+                                  uint64_t* promote_length) {
+    *promote_offset = 0;
+    *promote_length = 0;
+  }
+  // size is the number of bytes read from rados for the extent
+  virtual void update_extent_status(std::string file_name,
+                                    cache_status_t new_status, uint64_t size,
+                                    uint64_t offset, uint64_t length) {
+    update_status(file_name, new_status, size);
+  }
+  // whether all the object is cached, so that the clients may read it
+  // without asking
+  virtual bool is_complete(std::string file_name) {
+    return get_status(file_name) == OBJ_CACHE_PROMOTED;
+  }
+  virtual void dump(Formatter* f) {}
 };
 
 }  // namespace immutable_obj_cache
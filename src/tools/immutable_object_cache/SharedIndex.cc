@@ -0,0 +1,301 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "SharedIndex.h"
+#include "Utils.h"
+#include "common/debug.h"
+#include "common/errno.h"
+#include "include/compat.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_immutable_obj_cache
+#undef dout_prefix
+#define dout_prefix *_dout << "ceph::cache::SharedIndex: " << this << " " \
+                           << __func__ << ": "
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+namespace {
+
+const char INDEX_MAGIC[8] = {'R', 'O', 'C', 'I', 'N', 'D', 'E', 'X'};
+const uint32_t INDEX_VERSION = 1;
+// set once the daemon replaced or dropped the table
+const uint32_t INDEX_STALE = 1;
+
+// the slots start on their own page
+const size_t HEADER_LEN = 4096;
+
+struct index_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t num_slots;
+  uint32_t cache_root_dir_len;
+  char cache_root_dir[HEADER_LEN - 24];
+};
+static_assert(sizeof(index_header_t) == HEADER_LEN);
+
+const uint64_t SLOT_EMPTY = 0;
+const uint64_t SLOT_REMOVED = 1;
+const uint64_t SLOT_PRESENT = 2;
+
+uint64_t get_slot_value(const std::string &cache_file_name) {
+  auto data = (const unsigned char *)cache_file_name.c_str();
+  uint64_t hash = ceph_crc32c(0, data, cache_file_name.length());
+  hash = (hash << 32) | ceph_crc32c(-1, data, cache_file_name.length());
+  return (hash & ~3ULL) | SLOT_PRESENT;
+}
+
+} // anonymous namespace
+
+SharedIndex::SharedIndex(CephContext *cct, const std::string &path)
+  : m_cct(cct), m_path(path) {
+}
+
+SharedIndex::~SharedIndex() {
+  close();
+}
+
+uint64_t *SharedIndex::get_slots() const {
+  return reinterpret_cast<uint64_t*>(static_cast<char*>(m_map) + HEADER_LEN);
+}
+
+uint32_t SharedIndex::get_num_slots() const {
+  return static_cast<index_header_t*>(m_map)->num_slots;
+}
+
+bool SharedIndex::is_stale() const {
+  auto h = static_cast<index_header_t*>(m_map);
+  return __atomic_load_n(&h->flags, __ATOMIC_ACQUIRE) & INDEX_STALE;
+}
+
+int SharedIndex::create(const std::string &cache_root_dir, uint32_t num_slots) {
+  ldout(m_cct, 20) << "path=" << m_path << ", num_slots=" << num_slots
+                   << dendl;
+
+  if (num_slots == 0 ||
+      cache_root_dir.length() >= sizeof(index_header_t::cache_root_dir)) {
+    return -EINVAL;
+  }
+
+  // build the new table aside and move it over the old one, so that the
+  // clients always find a complete one at the path
+  const size_t len = HEADER_LEN + num_slots * sizeof(uint64_t);
+  const std::string tmp = m_path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (fd < 0) {
+    int r = -errno;
+    lderr(m_cct) << "failed to create " << tmp << ": " << cpp_strerror(r)
+                 << dendl;
+    return r;
+  }
+  if (::ftruncate(fd, len) < 0) {
+    int r = -errno;
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    ::unlink(tmp.c_str());
+    return r;
+  }
+  void *m = ::mmap(nullptr, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  int r = m == MAP_FAILED ? -errno : 0;
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  if (r < 0) {
+    ::unlink(tmp.c_str());
+    return r;
+  }
+
+  // the slots are zeroed (empty) by ftruncate
+  auto h = static_cast<index_header_t*>(m);
+  memcpy(h->magic, INDEX_MAGIC, sizeof(h->magic));
+  h->version = INDEX_VERSION;
+  h->flags = 0;
+  h->num_slots = num_slots;
+  h->cache_root_dir_len = cache_root_dir.length();
+  memcpy(h->cache_root_dir, cache_root_dir.c_str(), cache_root_dir.length());
+
+  if (::rename(tmp.c_str(), m_path.c_str()) < 0) {
+    r = -errno;
+    ::munmap(m, len);
+    ::unlink(tmp.c_str());
+    lderr(m_cct) << "failed to create " << m_path << ": " << cpp_strerror(r)
+                 << dendl;
+    return r;
+  }
+
+  std::unique_lock locker{m_lock};
+  unmap();
+  m_writer = true;
+  m_map = m;
+  m_map_len = len;
+  m_cache_root_dir = cache_root_dir;
+  return 0;
+}
+
+void SharedIndex::insert(const std::string &cache_file_name) {
+  std::unique_lock locker{m_lock};
+  if (m_map == nullptr) {
+    return;
+  }
+  ceph_assert(m_writer);
+
+  uint64_t value = get_slot_value(cache_file_name);
+  auto slots = get_slots();
+  uint32_t num_slots = get_num_slots();
+  uint64_t *free_slot = nullptr;
+  for (uint32_t i = 0; i < std::min(MAX_PROBES, num_slots); ++i) {
+    auto slot = &slots[((value >> 2) + i) % num_slots];
+    uint64_t current = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    if (current == value) {
+      return;
+    } else if (current == SLOT_EMPTY || current == SLOT_REMOVED) {
+      if (free_slot == nullptr) {
+        free_slot = slot;
+      }
+      if (current == SLOT_EMPTY) {
+        break;
+      }
+    }
+  }
+
+  if (free_slot == nullptr) {
+    // the clients look the object up through the daemon instead
+    ldout(m_cct, 20) << "no free slot for " << cache_file_name << dendl;
+    return;
+  }
+  __atomic_store_n(free_slot, value, __ATOMIC_RELEASE);
+}
+
+void SharedIndex::remove(const std::string &cache_file_name) {
+  std::unique_lock locker{m_lock};
+  if (m_map == nullptr) {
+    return;
+  }
+  ceph_assert(m_writer);
+
+  uint64_t value = get_slot_value(cache_file_name);
+  auto slots = get_slots();
+  uint32_t num_slots = get_num_slots();
+  for (uint32_t i = 0; i < std::min(MAX_PROBES, num_slots); ++i) {
+    auto slot = &slots[((value >> 2) + i) % num_slots];
+    uint64_t current = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    if (current == value) {
+      __atomic_store_n(slot, SLOT_REMOVED, __ATOMIC_RELEASE);
+      return;
+    } else if (current == SLOT_EMPTY) {
+      return;
+    }
+  }
+}
+
+int SharedIndex::open() {
+  ldout(m_cct, 20) << "path=" << m_path << dendl;
+
+  int fd = ::open(m_path.c_str(), O_RDONLY|O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int r = -errno;
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    return r;
+  }
+  size_t len = st.st_size;
+  if (len < HEADER_LEN) {
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    return -EINVAL;
+  }
+  void *m = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  int r = m == MAP_FAILED ? -errno : 0;
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  if (r < 0) {
+    return r;
+  }
+
+  auto h = static_cast<const index_header_t*>(m);
+  if (memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) ||
+      h->version != INDEX_VERSION ||
+      h->num_slots == 0 ||
+      HEADER_LEN + (uint64_t)h->num_slots * sizeof(uint64_t) > len ||
+      h->cache_root_dir_len >= sizeof(h->cache_root_dir)) {
+    ::munmap(m, len);
+    return -EINVAL;
+  }
+
+  std::unique_lock locker{m_lock};
+  unmap();
+  m_writer = false;
+  m_map = m;
+  m_map_len = len;
+  m_cache_root_dir.assign(h->cache_root_dir, h->cache_root_dir_len);
+  return 0;
+}
+
+bool SharedIndex::is_open() {
+  std::shared_lock locker{m_lock};
+  return m_map != nullptr;
+}
+
+bool SharedIndex::lookup(const std::string &cache_file_name,
+                         std::string *cache_file_path) {
+  {
+    std::shared_lock locker{m_lock};
+    if (m_map == nullptr) {
+      return false;
+    }
+
+    if (!is_stale()) {
+      uint64_t value = get_slot_value(cache_file_name);
+      auto slots = get_slots();
+      uint32_t num_slots = get_num_slots();
+      for (uint32_t i = 0; i < std::min(MAX_PROBES, num_slots); ++i) {
+        uint64_t current = __atomic_load_n(
+          &slots[((value >> 2) + i) % num_slots], __ATOMIC_ACQUIRE);
+        if (current == value) {
+          *cache_file_path = m_cache_root_dir +
+            get_cache_file_dir(cache_file_name) + cache_file_name;
+          return true;
+        } else if (current == SLOT_EMPTY) {
+          break;
+        }
+      }
+      return false;
+    }
+  }
+
+  ldout(m_cct, 5) << "index was replaced or dropped by the daemon" << dendl;
+  std::unique_lock locker{m_lock};
+  if (m_map != nullptr && is_stale()) {
+    unmap();
+  }
+  return false;
+}
+
+void SharedIndex::close() {
+  std::unique_lock locker{m_lock};
+  unmap();
+}
+
+void SharedIndex::unmap() {
+  ceph_assert(ceph_mutex_is_wlocked(m_lock));
+  if (m_map == nullptr) {
+    return;
+  }
+
+  if (m_writer) {
+    // have the clients look up the objects through the daemon again
+    auto h = static_cast<index_header_t*>(m_map);
+    __atomic_store_n(&h->flags, h->flags | INDEX_STALE, __ATOMIC_RELEASE);
+  }
+  ::munmap(m_map, m_map_len);
+  m_map = nullptr;
+  m_map_len = 0;
+}
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
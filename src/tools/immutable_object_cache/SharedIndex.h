@@ -0,0 +1,69 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_CACHE_SHARED_INDEX_H
+#define CEPH_CACHE_SHARED_INDEX_H
+
+#include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
+
+#include <string>
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+/**
+ * Lookup table of the promoted objects in a file shared with the clients.
+ *
+ * The daemon maps the table read-write and publishes the objects once
+ * their cache file is complete; the clients map it read-only, so that a
+ * cache hit costs neither a round-trip over the domain socket nor a copy
+ * of the cache file path. The table is a fixed size open addressing hash
+ * of the cache file names; each slot is a single word, written atomically.
+ * A hash collision is harmless: the cache file of the client's own object
+ * is then missing, and the client falls back to the daemon.
+ */
+class SharedIndex {
+ public:
+  SharedIndex(CephContext *cct, const std::string &path);
+  ~SharedIndex();
+
+  // daemon side: (re)creates an empty table
+  int create(const std::string &cache_root_dir, uint32_t num_slots);
+  void insert(const std::string &cache_file_name);
+  void remove(const std::string &cache_file_name);
+
+  // client side
+  int open();
+  bool is_open();
+  /// the cache file path of the object if it was promoted; closes the table
+  /// once the daemon replaced it
+  bool lookup(const std::string &cache_file_name,
+              std::string *cache_file_path);
+
+  void close();
+
+ private:
+  static constexpr uint32_t MAX_PROBES = 16;
+
+  CephContext *m_cct;
+  std::string m_path;
+  bool m_writer = false;
+  void *m_map = nullptr;
+  size_t m_map_len = 0;
+  std::string m_cache_root_dir;
+
+  // held shared by the lookups, and exclusively by the daemon's updates and
+  // when (un)mapping the table
+  ceph::shared_mutex m_lock =
+    ceph::make_shared_mutex("ceph::cache::SharedIndex::m_lock");
+
+  uint64_t *get_slots() const;
+  uint32_t get_num_slots() const;
+  bool is_stale() const;
+  void unmap();
+};
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
+#endif  // CEPH_CACHE_SHARED_INDEX_H
@@ -182,6 +182,14 @@ void SimplePolicy::get_evict_list(std::list<std::string>* obj_list) {
   }
 }
 
+void SimplePolicy::dump(Formatter* f) {
+  f->dump_string("policy", "simple");
+  f->dump_unsigned("cache_size", m_cache_size);
+  f->dump_unsigned("max_cache_size", m_max_cache_size);
+  f->dump_unsigned("promoting_objects", get_promoting_entry_num());
+  f->dump_unsigned("promoted_objects", get_promoted_entry_num());
+}
+
 // for unit test
 uint64_t SimplePolicy::get_free_size() {
   return m_max_cache_size - m_cache_size;
@@ -32,6 +32,8 @@ class SimplePolicy : public Policy {
 
   void get_evict_list(std::list<std::string>* obj_list);
 
+  void dump(Formatter* f);
+
   uint64_t get_free_size();
   uint64_t get_promoting_entry_num();
   uint64_t get_promoted_entry_num();
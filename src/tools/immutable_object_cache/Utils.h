@@ -6,6 +6,9 @@
 
 #include "include/rados/librados.hpp"
 #include "include/Context.h"
+#include "include/crc32c.h"
+
+#include <string>
 
 namespace ceph {
 namespace immutable_obj_cache {
@@ -26,6 +29,20 @@ librados::AioCompletion *create_rados_callback(T *obj) {
     obj, &detail::rados_callback<T, MF>);
 }
 
+inline std::string get_cache_file_name(const std::string &pool_nspace,
+                                       uint64_t pool_id, uint64_t snap_id,
+                                       const std::string &oid) {
+  return pool_nspace + ":" + std::to_string(pool_id) + ":" +
+         std::to_string(snap_id) + ":" + oid;
+}
+
+// the sub folder of the cache root dir holding the cache file
+inline std::string get_cache_file_dir(const std::string &cache_file_name) {
+  uint32_t crc = ceph_crc32c(0, (unsigned char *)cache_file_name.c_str(),
+                             cache_file_name.length());
+  return std::to_string(crc % 100) + "/";
+}
+
 }  // namespace immutable_obj_cache
 }  // namespace ceph
 #endif  // CEPH_CACHE_UTILS_H
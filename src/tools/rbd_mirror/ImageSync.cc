@@ -14,9 +14,11 @@
 #include "librbd/internal.h"
 #include "librbd/deep_copy/Handler.h"
 #include "tools/rbd_mirror/Threads.h"
+#include "tools/rbd_mirror/TransferScheduler.h"
 #include "tools/rbd_mirror/image_sync/SyncPointCreateRequest.h"
 #include "tools/rbd_mirror/image_sync/SyncPointPruneRequest.h"
 #include "tools/rbd_mirror/image_sync/Types.h"
+#include <atomic>
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rbd_mirror
@@ -36,15 +38,33 @@ template <typename I>
 class ImageSync<I>::ImageCopyProgressHandler
   : public librbd::deep_copy::NoOpHandler {
 public:
-  ImageCopyProgressHandler(ImageSync *image_sync) : image_sync(image_sync) {
+  ImageCopyProgressHandler(ImageSync *image_sync, uint64_t remaining_objects)
+    : image_sync(image_sync), remaining_objects(remaining_objects) {
+  }
+
+  void start_object_copy(Context* on_start) override {
+    // the images furthest behind are the first to resume copying
+    image_sync->m_threads->transfer_scheduler->start_transfer(
+      remaining_objects, on_start);
+  }
+
+  void finish_object_copy() override {
+    image_sync->m_threads->transfer_scheduler->finish_transfer();
+  }
+
+  void handle_read(uint64_t bytes_read) override {
+    image_sync->m_threads->transfer_scheduler->handle_transferred(bytes_read);
   }
 
   int update_progress(uint64_t object_no, uint64_t object_count) override {
+    remaining_objects = object_count > object_no ?
+      object_count - object_no : 0;
     image_sync->handle_copy_image_update_progress(object_no, object_count);
     return 0;
   }
 
   ImageSync *image_sync;
+  std::atomic<uint64_t> remaining_objects;
 };
 
 template <typename I>
@@ -213,6 +233,7 @@ void ImageSync<I>::send_copy_image() {
   librados::snap_t snap_id_start = 0;
   librados::snap_t snap_id_end;
   librbd::deep_copy::ObjectNumber object_number;
+  uint64_t remaining_objects = 0;
   int r = 0;
 
   m_snap_seqs_copy = m_sync_point_handler->get_snap_seqs();
@@ -237,6 +258,12 @@ void ImageSync<I>::send_copy_image() {
       }
     }
     object_number = sync_point.object_number;
+    if (r == 0) {
+      uint64_t object_count = m_remote_image_ctx->get_object_count(
+        snap_id_end);
+      remaining_objects = object_count > object_number.value_or(0) ?
+        object_count - object_number.value_or(0) : 0;
+    }
   }
   if (r < 0) {
     finish(r);
@@ -254,7 +281,8 @@ void ImageSync<I>::send_copy_image() {
 
   Context *ctx = create_context_callback<
     ImageSync<I>, &ImageSync<I>::handle_copy_image>(this);
-  m_image_copy_prog_handler = new ImageCopyProgressHandler(this);
+  m_image_copy_prog_handler = new ImageCopyProgressHandler(this,
+                                                          remaining_objects);
   m_image_copy_request = librbd::DeepCopyRequest<I>::create(
       m_remote_image_ctx, m_local_image_ctx, snap_id_start, snap_id_end,
       0, false, object_number, m_threads->work_queue, &m_snap_seqs_copy,
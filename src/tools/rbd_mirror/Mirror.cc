@@ -17,6 +17,7 @@
 #include "PoolMetaCache.h"
 #include "ServiceDaemon.h"
 #include "Threads.h"
+#include "TransferScheduler.h"
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rbd_mirror
@@ -600,6 +601,9 @@ void Mirror::print_status(Formatter *f)
     pool_replayer.second->print_status(f);
   }
   f->close_section();
+  f->open_object_section("image_sync_transfers");
+  m_threads->transfer_scheduler->print_status(f);
+  f->close_section();
   f->close_section();
 }
 
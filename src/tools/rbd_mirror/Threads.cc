@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "tools/rbd_mirror/Threads.h"
+#include "tools/rbd_mirror/TransferScheduler.h"
 #include "common/Timer.h"
 #include "common/WorkQueue.h"
 #include "librbd/ImageCtx.h"
@@ -22,10 +23,15 @@ Threads<I>::Threads(CephContext *cct) {
 
   timer = new SafeTimer(cct, timer_lock, true);
   timer->init();
+
+  transfer_scheduler = new TransferScheduler(cct, timer, &timer_lock,
+                                             work_queue);
 }
 
 template <typename I>
 Threads<I>::~Threads() {
+  delete transfer_scheduler;
+
   {
     std::lock_guard timer_locker{timer_lock};
     timer->shutdown();
@@ -16,6 +16,8 @@ namespace librbd { struct ImageCtx; }
 namespace rbd {
 namespace mirror {
 
+class TransferScheduler;
+
 template <typename ImageCtxT = librbd::ImageCtx>
 struct Threads {
   ThreadPool *thread_pool = nullptr;
@@ -25,6 +27,8 @@ struct Threads {
   ceph::mutex timer_lock =
     ceph::make_mutex("Threads::timer_lock");
 
+  TransferScheduler *transfer_scheduler = nullptr;
+
   explicit Threads(CephContext *cct);
   Threads(const Threads&) = delete;
   Threads& operator=(const Threads&) = delete;
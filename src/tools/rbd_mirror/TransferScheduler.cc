@@ -0,0 +1,203 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "TransferScheduler.h"
+#include "common/Formatter.h"
+#include "common/Timer.h"
+#include "common/WorkQueue.h"
+#include "common/debug.h"
+#include "include/Context.h"
+#include <algorithm>
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_rbd_mirror
+#undef dout_prefix
+#define dout_prefix *_dout << "rbd::mirror::TransferScheduler: " << this \
+                           << " " << __func__ << ": "
+
+namespace rbd {
+namespace mirror {
+
+TransferScheduler::TransferScheduler(CephContext *cct, SafeTimer *timer,
+                                     ceph::mutex *timer_lock,
+                                     ContextWQ *work_queue)
+  : m_cct(cct), m_timer(timer), m_timer_lock(timer_lock),
+    m_work_queue(work_queue),
+    m_max_concurrent_transfers(cct->_conf.get_val<uint64_t>(
+      "rbd_mirror_image_sync_max_object_copies")),
+    m_bytes_per_second(cct->_conf.get_val<Option::size_t>(
+      "rbd_mirror_image_sync_bps_limit")),
+    m_byte_credit(m_bytes_per_second),
+    m_last_refill(ceph::mono_clock::now()) {
+  dout(20) << "max_concurrent_transfers=" << m_max_concurrent_transfers << ", "
+           << "bytes_per_second=" << m_bytes_per_second << dendl;
+  m_cct->_conf.add_observer(this);
+}
+
+TransferScheduler::~TransferScheduler() {
+  m_cct->_conf.remove_observer(this);
+
+  std::lock_guard timer_locker{*m_timer_lock};
+  ceph_assert(m_queue.empty());
+  ceph_assert(m_in_flight_transfers == 0);
+  if (m_timer_task != nullptr) {
+    m_timer->cancel_event(m_timer_task);
+  }
+}
+
+void TransferScheduler::set_limits(uint64_t max_concurrent_transfers,
+                                   uint64_t bytes_per_second) {
+  dout(20) << "max_concurrent_transfers=" << max_concurrent_transfers << ", "
+           << "bytes_per_second=" << bytes_per_second << dendl;
+
+  std::lock_guard timer_locker{*m_timer_lock};
+  m_max_concurrent_transfers = max_concurrent_transfers;
+  if (m_bytes_per_second != bytes_per_second) {
+    m_bytes_per_second = bytes_per_second;
+    m_byte_credit = std::min<double>(m_byte_credit, m_bytes_per_second);
+  }
+  process();
+}
+
+void TransferScheduler::start_transfer(uint64_t priority, Context *on_start) {
+  dout(20) << "priority=" << priority << dendl;
+
+  {
+    std::lock_guard timer_locker{*m_timer_lock};
+    if (!m_queue.empty() || !can_start_transfer()) {
+      dout(20) << "transfer has been queued" << dendl;
+      m_queue.emplace(priority, on_start);
+      schedule_timer();
+      return;
+    }
+
+    ++m_in_flight_transfers;
+  }
+
+  on_start->complete(0);
+}
+
+void TransferScheduler::finish_transfer() {
+  dout(20) << dendl;
+
+  std::lock_guard timer_locker{*m_timer_lock};
+  ceph_assert(m_in_flight_transfers > 0);
+  --m_in_flight_transfers;
+  process();
+}
+
+void TransferScheduler::handle_transferred(uint64_t bytes) {
+  dout(20) << "bytes=" << bytes << dendl;
+
+  std::lock_guard timer_locker{*m_timer_lock};
+  if (m_bytes_per_second == 0) {
+    return;
+  }
+
+  // the reads are accounted for once done, so the credit may go into debt
+  refill();
+  m_byte_credit -= bytes;
+}
+
+void TransferScheduler::print_status(ceph::Formatter *f) {
+  std::lock_guard timer_locker{*m_timer_lock};
+  f->dump_unsigned("max_object_copies", m_max_concurrent_transfers);
+  f->dump_unsigned("bps_limit", m_bytes_per_second);
+  f->dump_unsigned("running_object_copies", m_in_flight_transfers);
+  f->dump_unsigned("waiting_object_copies", m_queue.size());
+}
+
+bool TransferScheduler::can_start_transfer() {
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+  if (m_max_concurrent_transfers > 0 &&
+      m_in_flight_transfers >= m_max_concurrent_transfers) {
+    return false;
+  }
+
+  if (m_bytes_per_second > 0) {
+    refill();
+    if (m_byte_credit <= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TransferScheduler::refill() {
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+  auto now = ceph::mono_clock::now();
+  double elapsed = std::chrono::duration<double>(now - m_last_refill).count();
+  m_last_refill = now;
+
+  // at most a second worth of unused bandwidth accrues as credit
+  m_byte_credit = std::min<double>(
+    m_byte_credit + elapsed * m_bytes_per_second, m_bytes_per_second);
+  if (m_bytes_per_second == 0) {
+    m_byte_credit = 0;
+  }
+}
+
+void TransferScheduler::process() {
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+  while (!m_queue.empty() && can_start_transfer()) {
+    auto it = m_queue.begin();
+    dout(20) << "starting transfer: priority=" << it->first << dendl;
+
+    // not started with the timer lock held
+    ++m_in_flight_transfers;
+    m_work_queue->queue(it->second, 0);
+    m_queue.erase(it);
+  }
+
+  schedule_timer();
+}
+
+void TransferScheduler::schedule_timer() {
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+  if (m_timer_task != nullptr || m_queue.empty() || m_bytes_per_second == 0 ||
+      m_byte_credit > 0) {
+    // a finished transfer restarts those held back by the concurrency limit
+    return;
+  }
+
+  // wait until the debt is paid off
+  double delay = -m_byte_credit / m_bytes_per_second;
+  delay = std::max(delay, 0.001);
+  dout(20) << "delay=" << delay << dendl;
+
+  m_timer_task = new LambdaContext([this](int r) {
+      handle_timer();
+    });
+  m_timer->add_event_after(delay, m_timer_task);
+}
+
+void TransferScheduler::handle_timer() {
+  // the timer callback is invoked with the timer lock held
+  ceph_assert(ceph_mutex_is_locked(*m_timer_lock));
+  dout(20) << dendl;
+
+  m_timer_task = nullptr;
+  process();
+}
+
+const char** TransferScheduler::get_tracked_conf_keys() const {
+  static const char* KEYS[] = {
+    "rbd_mirror_image_sync_max_object_copies",
+    "rbd_mirror_image_sync_bps_limit",
+    NULL
+  };
+  return KEYS;
+}
+
+void TransferScheduler::handle_conf_change(
+    const ConfigProxy& conf, const std::set<std::string> &changed) {
+  if (changed.count("rbd_mirror_image_sync_max_object_copies") ||
+      changed.count("rbd_mirror_image_sync_bps_limit")) {
+    set_limits(
+      conf.get_val<uint64_t>("rbd_mirror_image_sync_max_object_copies"),
+      conf.get_val<Option::size_t>("rbd_mirror_image_sync_bps_limit"));
+  }
+}
+
+} // namespace mirror
+} // namespace rbd
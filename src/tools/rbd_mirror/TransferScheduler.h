@@ -0,0 +1,90 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef RBD_MIRROR_TRANSFER_SCHEDULER_H
+#define RBD_MIRROR_TRANSFER_SCHEDULER_H
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "common/config_obs.h"
+#include "include/common_fwd.h"
+
+class Context;
+class ContextWQ;
+class SafeTimer;
+
+namespace ceph { class Formatter; }
+
+namespace rbd {
+namespace mirror {
+
+/**
+ * Schedules the object copies of all of the image syncs of the daemon.
+ *
+ * Where the image sync throttler limits how many images are synced at once,
+ * this limits how many objects all of them copy at once, and at which rate
+ * they read, so that the syncs leave room for the replay of the images. The
+ * copies held back are started by priority: the images with the most
+ * objects left to copy first.
+ */
+class TransferScheduler : public md_config_obs_t {
+public:
+  TransferScheduler(CephContext *cct, SafeTimer *timer,
+                    ceph::mutex *timer_lock, ContextWQ *work_queue);
+  TransferScheduler(const TransferScheduler&) = delete;
+  TransferScheduler& operator=(const TransferScheduler&) = delete;
+  ~TransferScheduler() override;
+
+  void set_limits(uint64_t max_concurrent_transfers,
+                  uint64_t bytes_per_second);
+
+  /// completes on_start once the transfer may start, which may be before it
+  /// returns
+  void start_transfer(uint64_t priority, Context *on_start);
+  void finish_transfer();
+  void handle_transferred(uint64_t bytes);
+
+  void print_status(ceph::Formatter *f);
+
+private:
+  typedef std::multimap<uint64_t, Context*, std::greater<uint64_t>> Queue;
+
+  CephContext *m_cct;
+  SafeTimer *m_timer;
+  /* All of the following are protected by the timer lock, which the timer
+   * callback is invoked with */
+  ceph::mutex *m_timer_lock;
+  ContextWQ *m_work_queue;
+
+  uint64_t m_max_concurrent_transfers;
+  uint64_t m_bytes_per_second;
+
+  Queue m_queue;
+  uint64_t m_in_flight_transfers = 0;
+
+  /* Bytes which may be read before holding back transfers, or owed once
+   * negative */
+  double m_byte_credit = 0;
+  ceph::mono_time m_last_refill;
+  Context *m_timer_task = nullptr;
+
+  bool can_start_transfer();
+  void refill();
+  void process();
+  void schedule_timer();
+  void handle_timer();
+
+  const char **get_tracked_conf_keys() const override;
+  void handle_conf_change(const ConfigProxy& conf,
+                          const std::set<std::string> &changed) override;
+};
+
+} // namespace mirror
+} // namespace rbd
+
+#endif // RBD_MIRROR_TRANSFER_SCHEDULER_H
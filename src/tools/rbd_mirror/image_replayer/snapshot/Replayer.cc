@@ -94,6 +94,12 @@ struct Replayer<I>::DeepCopyHandler : public librbd::deep_copy::Handler {
   DeepCopyHandler(Replayer* replayer) : replayer(replayer) {
   }
 
+  void start_object_copy(Context* on_start) override {
+    on_start->complete(0);
+  }
+  void finish_object_copy() override {
+  }
+
   void handle_read(uint64_t bytes_read) override {
     replayer->handle_copy_image_read(bytes_read);
   }